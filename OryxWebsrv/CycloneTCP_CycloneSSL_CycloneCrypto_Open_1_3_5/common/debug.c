@@ -28,10 +28,53 @@
 #include <stdarg.h>
 #include <stdio.h>
 
-#include "stm32f4xx.h"
-#include "stm32f4_discovery.h"
+#if !defined(USE_POSIX)
+   #include "stm32f4xx.h"
+   #include "stm32f4_discovery.h"
+#endif
+
 #include "debug.h"
 
+//POSIX port?
+#if defined(USE_POSIX)
+
+/**
+ * @brief Debug output initialization
+ *
+ * Trace messages are written to the standard error stream
+ *
+ **/
+
+void debugInit()
+{
+   //Disable buffering so that traces are not lost on a crash
+   setvbuf(stderr, NULL, _IONBF, 0);
+}
+
+
+void usart_putc(const char c)
+{
+   fputc(c, stderr);
+}
+
+
+void usart_puts(const char* s)
+{
+   fputs(s, stderr);
+}
+
+
+void usart_printf(const char *pFormat, ...)
+{
+   va_list ap;
+
+   va_start(ap, pFormat);
+   vfprintf(stderr, pFormat, ap);
+   va_end(ap);
+}
+
+#else
+
 #define USART_BUFF_PRINTF_SIZE		2048
 #define USART_QUEUE_TX_SIZE			2048
 
@@ -163,6 +206,8 @@ void usart_printf(const char *pFormat, ...)
     usart_puts(_usart_printf_buff);
 }
 
+#endif
+
 /**
  * @brief Display the contents of an array
  * @param[in] stream Pointer to a FILE object that identifies an output stream
@@ -172,9 +217,9 @@ void usart_printf(const char *pFormat, ...)
  **/
 
 void debugDisplayArray(FILE *stream,
-   const char_t *prepend, const void *data, uint_t length)
+   const char_t *prepend, const void *data, size_t length)
 {
-   uint_t i;
+   size_t i;
 
    for(i = 0; i < length; i++)
    {
@@ -189,6 +234,8 @@ void debugDisplayArray(FILE *stream,
    }
 }
 
+#if !defined(USE_POSIX)
+
 void USART6_IRQHandler(void)
 {
 	if(USART_GetITStatus(USART6, USART_IT_TXE) != RESET)
@@ -209,3 +256,5 @@ void USART6_IRQHandler(void)
 		}
 	}
 }
+
+#endif
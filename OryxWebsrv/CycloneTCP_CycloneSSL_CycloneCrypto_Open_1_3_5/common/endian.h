@@ -46,12 +46,19 @@
 
 //Load unaligned 32-bit integer (little-endian encoding)
 #define LOAD32LE(p) (((uint8_t *)(p))[0] | (((uint8_t *)(p))[1] << 8) | \
-   (((uint8_t *)(p))[2] << 16) | (((uint8_t *)(p))[3] << 24))
+   (((uint8_t *)(p))[2] << 16) | ((uint32_t)(((uint8_t *)(p))[3]) << 24))
 
 //Load unaligned 32-bit integer (big-endian encoding)
-#define LOAD32BE(p) ((((uint8_t *)(p))[0] << 24) | (((uint8_t *)(p))[1] << 16) | \
+#define LOAD32BE(p) (((uint32_t)(((uint8_t *)(p))[0]) << 24) | (((uint8_t *)(p))[1] << 16) | \
    (((uint8_t *)(p))[2] << 8) | ((uint8_t *)(p))[3])
 
+//Load unaligned 64-bit integer (big-endian encoding)
+#define LOAD64BE(p) ( \
+   ((uint64_t)(((uint8_t *)(p))[0]) << 56) | ((uint64_t)(((uint8_t *)(p))[1]) << 48) | \
+   ((uint64_t)(((uint8_t *)(p))[2]) << 40) | ((uint64_t)(((uint8_t *)(p))[3]) << 32) | \
+   ((uint64_t)(((uint8_t *)(p))[4]) << 24) | ((uint64_t)(((uint8_t *)(p))[5]) << 16) | \
+   ((uint64_t)(((uint8_t *)(p))[6]) << 8) | (uint64_t)(((uint8_t *)(p))[7]))
+
 //Store unaligned 16-bit integer (little-endian encoding)
 #define STORE16LE(a, p) \
    ((uint8_t *)(p))[0] = (a) & 0xFF, \
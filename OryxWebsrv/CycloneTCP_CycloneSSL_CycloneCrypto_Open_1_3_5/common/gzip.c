@@ -0,0 +1,662 @@
+/**
+ * @file gzip.c
+ * @brief Gzip decompression (inflate)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Streaming decoder for gzip members holding a DEFLATE stream. Refer to
+ * the following RFCs for complete details:
+ * - RFC 1951 : DEFLATE Compressed Data Format Specification version 1.3
+ * - RFC 1952 : GZIP file format specification version 4.3
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <string.h>
+#include "os.h"
+#include "gzip.h"
+#include "endian.h"
+
+//Base lengths for length codes 257..285
+static const uint16_t lengthBase[29] =
+{
+   3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+//Extra bits for length codes 257..285
+static const uint8_t lengthExtra[29] =
+{
+   0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+//Base distances for distance codes 0..29
+static const uint16_t distBase[30] =
+{
+   1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+//Extra bits for distance codes 0..29
+static const uint8_t distExtra[30] =
+{
+   0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+   7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+//Order in which code length code lengths are transmitted
+static const uint8_t codeLengthOrder[19] =
+{
+   16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+/**
+ * @brief Read bits from the compressed stream
+ * @param[in] context Pointer to the inflate context
+ * @param[in] n Number of bits to read (0 to 16)
+ * @param[out] value Resulting value
+ * @return Error code
+ **/
+
+static error_t gzipGetBits(GzipContext *context, uint_t n, uint_t *value)
+{
+   //Fill the bit buffer
+   while(context->bitCount < n)
+   {
+      //Truncated stream?
+      if(context->inputPos >= context->inputLength)
+         return ERROR_WRONG_ENCODING;
+
+      //Bits are packed starting with the least significant bit
+      context->bitBuffer |= (uint32_t) context->input[context->inputPos++] << context->bitCount;
+      context->bitCount += 8;
+   }
+
+   //Extract the requested bits
+   *value = context->bitBuffer & ((1UL << n) - 1);
+
+   //Discard them from the bit buffer
+   context->bitBuffer >>= n;
+   context->bitCount -= n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Build a canonical Huffman decoding table
+ * @param[out] table Resulting decoding table
+ * @param[in] lengths Code length of each symbol
+ * @param[in] n Number of symbols
+ * @return Error code
+ **/
+
+static error_t gzipBuildTable(GzipHuffmanTable *table, const uint8_t *lengths, uint_t n)
+{
+   uint_t i;
+   int_t left;
+   uint16_t offset[16];
+
+   //Count the number of codes of each length
+   memset(table->count, 0, sizeof(table->count));
+   for(i = 0; i < n; i++)
+      table->count[lengths[i]]++;
+
+   //Unused symbols are not part of the code
+   table->count[0] = 0;
+
+   //Reject over-subscribed codes
+   for(left = 1, i = 1; i < 16; i++)
+   {
+      left = (left << 1) - table->count[i];
+      if(left < 0) return ERROR_WRONG_ENCODING;
+   }
+
+   //Compute the offset of the first symbol of each length
+   offset[1] = 0;
+   for(i = 1; i < 15; i++)
+      offset[i + 1] = offset[i] + table->count[i];
+
+   //Sort symbols by code
+   for(i = 0; i < n; i++)
+   {
+      if(lengths[i] != 0)
+         table->symbol[offset[lengths[i]]++] = i;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode a symbol
+ * @param[in] context Pointer to the inflate context
+ * @param[in] table Huffman decoding table
+ * @param[out] symbol Decoded symbol
+ * @return Error code
+ **/
+
+static error_t gzipDecodeSymbol(GzipContext *context,
+   const GzipHuffmanTable *table, uint_t *symbol)
+{
+   error_t error;
+   uint_t i;
+   uint_t bit;
+   int_t code;
+   int_t first;
+   int_t index;
+
+   //Huffman codes are packed starting with the most significant bit
+   code = 0;
+   first = 0;
+   index = 0;
+
+   //Codes are at most 15-bit long
+   for(i = 1; i < 16; i++)
+   {
+      //Get next bit
+      error = gzipGetBits(context, 1, &bit);
+      //Any error to report?
+      if(error) return error;
+
+      //Append it to the current code
+      code |= bit;
+
+      //Valid code of the current length?
+      if((code - table->count[i]) < first)
+      {
+         *symbol = table->symbol[index + (code - first)];
+         return NO_ERROR;
+      }
+
+      //Move to the next length
+      index += table->count[i];
+      first = (first + table->count[i]) << 1;
+      code <<= 1;
+   }
+
+   //Incomplete code
+   return ERROR_WRONG_ENCODING;
+}
+
+
+/**
+ * @brief Read the dynamic Huffman codes of a block
+ * @param[in] context Pointer to the inflate context
+ * @return Error code
+ **/
+
+static error_t gzipReadDynamicCodes(GzipContext *context)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint_t symbol;
+   uint_t hlit;
+   uint_t hdist;
+   uint_t hclen;
+   uint8_t lengths[320];
+
+   //Number of literal/length, distance and code length codes
+   error = gzipGetBits(context, 5, &hlit);
+   if(!error) error = gzipGetBits(context, 5, &hdist);
+   if(!error) error = gzipGetBits(context, 4, &hclen);
+   if(error) return error;
+
+   //Adjust values
+   hlit += 257;
+   hdist += 1;
+   hclen += 4;
+
+   //Check parameters
+   if(hlit > 286 || hdist > 30)
+      return ERROR_WRONG_ENCODING;
+
+   //Read code length code lengths
+   memset(lengths, 0, 19);
+   for(i = 0; i < hclen; i++)
+   {
+      error = gzipGetBits(context, 3, &n);
+      if(error) return error;
+      lengths[codeLengthOrder[i]] = n;
+   }
+
+   //The distance table temporarily holds the code length code
+   error = gzipBuildTable(&context->distTable, lengths, 19);
+   if(error) return error;
+
+   //Read literal/length and distance code lengths
+   for(i = 0; i < (hlit + hdist); )
+   {
+      //Decode next code length
+      error = gzipDecodeSymbol(context, &context->distTable, &symbol);
+      if(error) return error;
+
+      //Literal code length?
+      if(symbol < 16)
+      {
+         lengths[i++] = symbol;
+      }
+      else
+      {
+         uint8_t value;
+
+         //Repeat previous length 3 to 6 times?
+         if(symbol == 16)
+         {
+            //There must be a previous length
+            if(i == 0) return ERROR_WRONG_ENCODING;
+            value = lengths[i - 1];
+            error = gzipGetBits(context, 2, &n);
+            n += 3;
+         }
+         //Repeat zero 3 to 10 times?
+         else if(symbol == 17)
+         {
+            value = 0;
+            error = gzipGetBits(context, 3, &n);
+            n += 3;
+         }
+         //Repeat zero 11 to 138 times
+         else
+         {
+            value = 0;
+            error = gzipGetBits(context, 7, &n);
+            n += 11;
+         }
+
+         //Any error to report?
+         if(error) return error;
+         //Make sure the repeat count is valid
+         if((i + n) > (hlit + hdist))
+            return ERROR_WRONG_ENCODING;
+
+         //Repeat the value
+         while(n--) lengths[i++] = value;
+      }
+   }
+
+   //The end-of-block code must be present
+   if(lengths[256] == 0)
+      return ERROR_WRONG_ENCODING;
+
+   //Build the literal/length table
+   error = gzipBuildTable(&context->litTable, lengths, hlit);
+   if(error) return error;
+
+   //Build the distance table
+   error = gzipBuildTable(&context->distTable, lengths + hlit, hdist);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read a block header
+ * @param[in] context Pointer to the inflate context
+ * @return Error code
+ **/
+
+static error_t gzipReadBlockHeader(GzipContext *context)
+{
+   error_t error;
+   uint_t i;
+   uint_t type;
+   uint_t length;
+   uint_t nlength;
+
+   //BFINAL is set if this is the last block of the stream
+   error = gzipGetBits(context, 1, &i);
+   if(error) return error;
+   context->finalBlock = i ? TRUE : FALSE;
+
+   //BTYPE specifies how the data are compressed
+   error = gzipGetBits(context, 2, &type);
+   if(error) return error;
+
+   //Stored block?
+   if(type == 0)
+   {
+      //Skip any remaining bits in the current partially processed byte
+      context->bitBuffer >>= context->bitCount & 7;
+      context->bitCount -= context->bitCount & 7;
+
+      //Read LEN and NLEN fields
+      error = gzipGetBits(context, 16, &length);
+      if(!error) error = gzipGetBits(context, 16, &nlength);
+      if(error) return error;
+
+      //NLEN is the one's complement of LEN
+      if(length != (~nlength & 0xFFFF))
+         return ERROR_WRONG_ENCODING;
+
+      //Save the length of the block
+      context->storedLength = length;
+      context->state = GZIP_STATE_STORED_BLOCK;
+   }
+   //Fixed Huffman codes?
+   else if(type == 1)
+   {
+      //Literal/length codes 256-279 are 7-bit long, 0-143 and 280-287
+      //are 8-bit long, 144-255 are 9-bit long
+      memset(context->litTable.count, 0, sizeof(context->litTable.count));
+      context->litTable.count[7] = 24;
+      context->litTable.count[8] = 152;
+      context->litTable.count[9] = 112;
+
+      //Sort symbols by code
+      for(i = 0; i < 24; i++)
+         context->litTable.symbol[i] = 256 + i;
+      for(i = 0; i < 144; i++)
+         context->litTable.symbol[24 + i] = i;
+      for(i = 0; i < 8; i++)
+         context->litTable.symbol[168 + i] = 280 + i;
+      for(i = 0; i < 112; i++)
+         context->litTable.symbol[176 + i] = 144 + i;
+
+      //Distance codes are represented by fixed-length 5-bit codes
+      memset(context->distTable.count, 0, sizeof(context->distTable.count));
+      context->distTable.count[5] = 30;
+
+      for(i = 0; i < 30; i++)
+         context->distTable.symbol[i] = i;
+
+      //Process block data
+      context->state = GZIP_STATE_HUFFMAN_BLOCK;
+   }
+   //Dynamic Huffman codes?
+   else if(type == 2)
+   {
+      //Read the code definitions
+      error = gzipReadDynamicCodes(context);
+      if(error) return error;
+
+      //Process block data
+      context->state = GZIP_STATE_HUFFMAN_BLOCK;
+   }
+   //Reserved block type?
+   else
+   {
+      return ERROR_WRONG_ENCODING;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse gzip header
+ * @param[in] data Pointer to the gzip member
+ * @param[in] length Length of the gzip member
+ * @param[out] headerLength Length of the header
+ * @param[out] originalSize Size of the uncompressed data (modulo 2^32)
+ * @return Error code
+ **/
+
+error_t gzipParseHeader(const uint8_t *data, size_t length,
+   size_t *headerLength, uint32_t *originalSize)
+{
+   uint8_t flags;
+   size_t n;
+
+   //The member must hold at least a 10-byte header and a 8-byte trailer
+   if(length < 18)
+      return ERROR_INVALID_LENGTH;
+
+   //Check magic number and compression method (deflate)
+   if(data[0] != 0x1F || data[1] != 0x8B || data[2] != 8)
+      return ERROR_INVALID_HEADER;
+
+   //Retrieve flags
+   flags = data[3];
+   //Fixed part of the header
+   n = 10;
+
+   //Skip extra field
+   if(flags & GZIP_FLAG_FEXTRA)
+   {
+      if((n + 2) > (length - 8))
+         return ERROR_INVALID_HEADER;
+      n += 2 + LOAD16LE(data + n);
+   }
+
+   //Skip original file name
+   if(flags & GZIP_FLAG_FNAME)
+   {
+      while(n < (length - 8) && data[n] != '\0') n++;
+      n++;
+   }
+
+   //Skip file comment
+   if(flags & GZIP_FLAG_FCOMMENT)
+   {
+      while(n < (length - 8) && data[n] != '\0') n++;
+      n++;
+   }
+
+   //Skip header CRC
+   if(flags & GZIP_FLAG_FHCRC)
+      n += 2;
+
+   //Malformed header?
+   if(n > (length - 8))
+      return ERROR_INVALID_HEADER;
+
+   //Return the length of the header
+   if(headerLength != NULL)
+      *headerLength = n;
+
+   //The trailer ends with the size of the original input data
+   if(originalSize != NULL)
+      *originalSize = LOAD32LE(data + length - 4);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Prepare to decompress a gzip member
+ *
+ * The CRC of the uncompressed data is not checked since the members
+ * are expected to come from the resource image
+ *
+ * @param[in] context Pointer to the inflate context
+ * @param[in] data Pointer to the gzip member
+ * @param[in] length Length of the gzip member
+ * @return Error code
+ **/
+
+error_t gzipInflateInit(GzipContext *context, const uint8_t *data, size_t length)
+{
+   error_t error;
+   size_t n;
+
+   //Parse gzip header
+   error = gzipParseHeader(data, length, &n, NULL);
+   //Any error to report?
+   if(error) return error;
+
+   //Point to the DEFLATE stream
+   context->input = data + n;
+   context->inputLength = length - n - 8;
+   context->inputPos = 0;
+
+   //Initialize decoder state
+   context->bitBuffer = 0;
+   context->bitCount = 0;
+   context->state = GZIP_STATE_BLOCK_HEADER;
+   context->finalBlock = FALSE;
+   context->storedLength = 0;
+   context->matchLength = 0;
+   context->matchDistance = 0;
+   context->windowPos = 0;
+   context->totalLength = 0;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decompress data
+ * @param[in] context Pointer to the inflate context
+ * @param[out] output Buffer where to store the uncompressed data
+ * @param[in] size Size of the output buffer
+ * @param[out] length Number of bytes that have been produced
+ * @return Error code
+ **/
+
+error_t gzipInflateRead(GzipContext *context, uint8_t *output, size_t size, size_t *length)
+{
+   error_t error;
+   uint_t symbol;
+   uint_t extra;
+   uint8_t c;
+
+   //No data has been produced yet
+   *length = 0;
+
+   //Fill the output buffer
+   while(*length < size)
+   {
+      //Pending match?
+      if(context->matchLength > 0)
+      {
+         //Copy a byte from the sliding window
+         c = context->window[(context->windowPos - context->matchDistance) & (GZIP_WINDOW_SIZE - 1)];
+         context->matchLength--;
+      }
+      //Stored block?
+      else if(context->state == GZIP_STATE_STORED_BLOCK)
+      {
+         //End of block?
+         if(context->storedLength == 0)
+         {
+            context->state = GZIP_STATE_BLOCK_HEADER;
+            continue;
+         }
+
+         //Copy a byte from the input
+         error = gzipGetBits(context, 8, &symbol);
+         if(error) return error;
+
+         c = symbol;
+         context->storedLength--;
+      }
+      //Compressed block?
+      else if(context->state == GZIP_STATE_HUFFMAN_BLOCK)
+      {
+         //Decode literal/length symbol
+         error = gzipDecodeSymbol(context, &context->litTable, &symbol);
+         if(error) return error;
+
+         //Literal byte?
+         if(symbol < 256)
+         {
+            c = symbol;
+         }
+         //End of block?
+         else if(symbol == 256)
+         {
+            context->state = GZIP_STATE_BLOCK_HEADER;
+            continue;
+         }
+         //Length/distance pair
+         else
+         {
+            //Check length code
+            symbol -= 257;
+            if(symbol >= 29) return ERROR_WRONG_ENCODING;
+
+            //Decode match length
+            error = gzipGetBits(context, lengthExtra[symbol], &extra);
+            if(error) return error;
+            context->matchLength = lengthBase[symbol] + extra;
+
+            //Decode distance symbol
+            error = gzipDecodeSymbol(context, &context->distTable, &symbol);
+            if(error) return error;
+            if(symbol >= 30) return ERROR_WRONG_ENCODING;
+
+            //Decode match distance
+            error = gzipGetBits(context, distExtra[symbol], &extra);
+            if(error) return error;
+            context->matchDistance = distBase[symbol] + extra;
+
+            //The match must lie within the sliding window
+            if(context->matchDistance > GZIP_WINDOW_SIZE ||
+               context->matchDistance > context->totalLength)
+            {
+               return ERROR_WRONG_ENCODING;
+            }
+
+            //Copy the match
+            continue;
+         }
+      }
+      //End of a block?
+      else if(context->state == GZIP_STATE_BLOCK_HEADER)
+      {
+         //The last block has been processed?
+         if(context->finalBlock)
+         {
+            context->state = GZIP_STATE_DONE;
+         }
+         else
+         {
+            //Parse the header of the next block
+            error = gzipReadBlockHeader(context);
+            if(error) return error;
+         }
+
+         //Process the block
+         continue;
+      }
+      //End of stream?
+      else
+      {
+         break;
+      }
+
+      //Save the byte in the sliding window
+      context->window[context->windowPos] = c;
+      context->windowPos = (context->windowPos + 1) & (GZIP_WINDOW_SIZE - 1);
+      context->totalLength++;
+
+      //Append the byte to the output buffer
+      output[(*length)++] = c;
+   }
+
+   //Check whether the end of the stream has been reached
+   if(*length == 0 && context->state == GZIP_STATE_DONE)
+      return ERROR_END_OF_STREAM;
+
+   //Successful processing
+   return NO_ERROR;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file gzip.h
+ * @brief Gzip decompression (inflate)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _GZIP_H
+#define _GZIP_H
+
+//Dependencies
+#include "os.h"
+#include "error.h"
+
+//Size of the sliding window (must match the resource compiler)
+#ifndef GZIP_WINDOW_SIZE
+   #define GZIP_WINDOW_SIZE 4096
+#elif (GZIP_WINDOW_SIZE < 256 || GZIP_WINDOW_SIZE > 32768 || (GZIP_WINDOW_SIZE & (GZIP_WINDOW_SIZE - 1)))
+   #error GZIP_WINDOW_SIZE parameter is invalid
+#endif
+
+//Gzip header flags
+#define GZIP_FLAG_FTEXT    0x01
+#define GZIP_FLAG_FHCRC    0x02
+#define GZIP_FLAG_FEXTRA   0x04
+#define GZIP_FLAG_FNAME    0x08
+#define GZIP_FLAG_FCOMMENT 0x10
+
+
+/**
+ * @brief Decoder state
+ **/
+
+typedef enum
+{
+   GZIP_STATE_BLOCK_HEADER = 0,
+   GZIP_STATE_STORED_BLOCK = 1,
+   GZIP_STATE_HUFFMAN_BLOCK = 2,
+   GZIP_STATE_DONE = 3
+} GzipState;
+
+
+/**
+ * @brief Canonical Huffman decoding table
+ **/
+
+typedef struct
+{
+   uint16_t count[16];   ///<Number of codes of each length
+   uint16_t symbol[288]; ///<Symbols ordered by code
+} GzipHuffmanTable;
+
+
+/**
+ * @brief Inflate context
+ *
+ * The compressed stream is entirely available in memory (typically in
+ * flash), so that only the sliding window has to be kept in RAM. Back
+ * references must not reach further than GZIP_WINDOW_SIZE bytes
+ *
+ **/
+
+typedef struct
+{
+   const uint8_t *input;                 ///<Compressed data
+   size_t inputLength;                   ///<Length of the compressed data
+   size_t inputPos;                      ///<Current position in the input
+   uint32_t bitBuffer;                   ///<Bit buffer
+   uint_t bitCount;                      ///<Number of bits in the bit buffer
+   GzipState state;                      ///<Decoder state
+   bool_t finalBlock;                    ///<Last block of the stream
+   size_t storedLength;                  ///<Bytes left in the current stored block
+   uint_t matchLength;                   ///<Bytes left in the current match
+   uint_t matchDistance;                 ///<Distance of the current match
+   GzipHuffmanTable litTable;            ///<Literal/length code
+   GzipHuffmanTable distTable;           ///<Distance code
+   uint8_t window[GZIP_WINDOW_SIZE];     ///<Sliding window
+   uint_t windowPos;                     ///<Current position in the sliding window
+   size_t totalLength;                   ///<Number of bytes produced so far
+} GzipContext;
+
+
+//Gzip related functions
+error_t gzipParseHeader(const uint8_t *data, size_t length,
+   size_t *headerLength, uint32_t *originalSize);
+
+error_t gzipInflateInit(GzipContext *context, const uint8_t *data, size_t length);
+error_t gzipInflateRead(GzipContext *context, uint8_t *output, size_t size, size_t *length);
+
+#endif
@@ -42,10 +42,89 @@
    #include "freertos.h"
    #include "task.h"
    #include "semphr.h"
+#elif defined(USE_POSIX)
+   #include <errno.h>
+   #include <string.h>
+   #include <time.h>
+   #include <pthread.h>
 #elif defined(_WIN32)
    #include <windows.h>
 #endif
 
+//POSIX port?
+#if defined(USE_POSIX)
+
+/**
+ * @brief POSIX task
+ **/
+
+typedef struct
+{
+   pthread_t thread;  ///<Underlying thread
+   TaskCode code;     ///<Task entry function
+   void *params;      ///<Parameter passed to the task
+} OsPosixTask;
+
+
+/**
+ * @brief POSIX event object
+ **/
+
+typedef struct
+{
+   pthread_mutex_t mutex;  ///<Mutex protecting the state of the event
+   pthread_cond_t cond;    ///<Condition signaled when the event is set
+   bool_t manualReset;     ///<Manual-reset or auto-reset event
+   bool_t state;           ///<Signaled or nonsignaled state
+} OsPosixEvent;
+
+
+/**
+ * @brief POSIX semaphore object
+ **/
+
+typedef struct
+{
+   pthread_mutex_t mutex;  ///<Mutex protecting the counter
+   pthread_cond_t cond;    ///<Condition signaled when the counter is released
+   uint_t maxCount;        ///<Maximum count
+   uint_t count;           ///<Current count
+} OsPosixSemaphore;
+
+
+/**
+ * @brief POSIX queue object
+ **/
+
+typedef struct
+{
+   pthread_mutex_t mutex;    ///<Mutex protecting the queue
+   pthread_cond_t notEmpty;  ///<Condition signaled when an item is posted
+   pthread_cond_t notFull;   ///<Condition signaled when an item is removed
+   uint_t length;            ///<Maximum number of items
+   size_t itemSize;          ///<Size of each item
+   uint_t count;             ///<Number of items in the queue
+   uint_t readIndex;         ///<Index of the oldest item
+   uint8_t *buffer;          ///<Storage area
+} OsPosixQueue;
+
+//Lock emulating the scheduler suspension
+static pthread_mutex_t osPosixSchedulerLock;
+//Make sure the lock is initialized only once
+static pthread_once_t osPosixSchedulerOnce = PTHREAD_ONCE_INIT;
+//Handle to the task running on the current thread
+static __thread OsPosixTask *osPosixCurrentTask;
+
+//POSIX port related functions
+static void osPosixInitSchedulerLock(void);
+static void *osPosixTaskWrapper(void *param);
+static void osPosixInitCond(pthread_cond_t *cond);
+static void osPosixGetDeadline(struct timespec *ts, time_t timeout);
+static bool_t osPosixCondWait(pthread_cond_t *cond,
+   pthread_mutex_t *mutex, const struct timespec *deadline, time_t timeout);
+
+#endif
+
 
 /**
  * @brief Start OS scheduler
@@ -57,6 +136,12 @@ void osStart(void)
 #if defined(USE_FREERTOS)
    //Start the scheduler
    vTaskStartScheduler();
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Tasks are already running. Like the FreeRTOS scheduler,
+   //this function never returns
+   while(1)
+      osDelay(INFINITE_DELAY);
 #endif
 }
 
@@ -89,6 +174,43 @@ OsTask *osTaskCreate(const char_t *name, TaskCode taskCode,
       return task;
    else
       return NULL;
+//POSIX port?
+#elif defined(USE_POSIX)
+   int ret;
+   OsPosixTask *task;
+   pthread_attr_t attr;
+
+   //Allocate a new task object
+   task = malloc(sizeof(OsPosixTask));
+   //Failed to allocate memory?
+   if(!task) return NULL;
+
+   //Save the entry point of the task
+   task->code = taskCode;
+   task->params = params;
+
+   //The stack size is expressed in words for the target and does not
+   //account for the host ABI, so the default thread stack is used instead
+   pthread_attr_init(&attr);
+   //Resources are released as soon as the task terminates
+   pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+   //Create a new thread
+   ret = pthread_create(&task->thread, &attr, osPosixTaskWrapper, task);
+   //Release thread attributes
+   pthread_attr_destroy(&attr);
+
+   //Failed to create the thread?
+   if(ret != 0)
+   {
+      //Clean up side effects
+      free(task);
+      //Report an error
+      return NULL;
+   }
+
+   //Return a handle to the newly created task
+   return (OsTask *) task;
 //OS port is not available?
 #else
    //An invalid handle value is returned
@@ -108,6 +230,27 @@ void osTaskDelete(OsTask *task)
 #if defined(USE_FREERTOS)
    //Delete the specified task
    vTaskDelete((xTaskHandle) task);
+//POSIX port?
+#elif defined(USE_POSIX)
+   //A NULL handle refers to the calling task
+   if(task == NULL)
+      task = osPosixCurrentTask;
+
+   //Self deletion?
+   if(task == osPosixCurrentTask)
+   {
+      //Release the task object
+      osPosixCurrentTask = NULL;
+      free(task);
+      //Terminate the calling thread
+      pthread_exit(NULL);
+   }
+   else if(task != NULL)
+   {
+      //Request the cancellation of the specified thread. The task
+      //object is not released since the thread may still use it
+      pthread_cancel(((OsPosixTask *) task)->thread);
+   }
 #endif
 }
 
@@ -123,6 +266,10 @@ OsTask *osTaskGetHandle(void)
 #if defined(USE_FREERTOS)
    //Return a handle to the currently running task
    return xTaskGetCurrentTaskHandle();
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Return a handle to the currently running task
+   return (OsTask *) osPosixCurrentTask;
 #else
    return NULL;
 #endif
@@ -139,6 +286,12 @@ void osTaskSuspendAll(void)
 #if defined(USE_FREERTOS)
    //Suspend all tasks
    vTaskSuspendAll();
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Threads cannot be suspended, so a global recursive lock provides
+   //the same mutual exclusion between the callers
+   pthread_once(&osPosixSchedulerOnce, osPosixInitSchedulerLock);
+   pthread_mutex_lock(&osPosixSchedulerLock);
 #endif
 }
 
@@ -153,6 +306,10 @@ void osTaskResumeAll(void)
 #if defined(USE_FREERTOS)
    //Resume all tasks
    xTaskResumeAll();
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Release the global lock
+   pthread_mutex_unlock(&osPosixSchedulerLock);
 #endif
 }
 
@@ -167,6 +324,10 @@ void osTaskSwitch(void)
 #if defined(USE_FREERTOS)
    //Force a context switch
    taskYIELD();
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Relinquish the CPU
+   sched_yield();
 #endif
 }
 
@@ -226,6 +387,24 @@ OsEvent *osEventCreate(bool_t manualReset, bool_t initialState)
    //Return a handle to the newly created event object
    return (OsEvent *) event;
 
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixEvent *event;
+
+   //Allocate a new event object
+   event = malloc(sizeof(OsPosixEvent));
+   //Failed to allocate memory?
+   if(!event) return NULL;
+
+   //Initialize the event object
+   pthread_mutex_init(&event->mutex, NULL);
+   osPosixInitCond(&event->cond);
+   event->manualReset = manualReset;
+   event->state = initialState;
+
+   //Return a handle to the newly created event object
+   return (OsEvent *) event;
+
 //OS port is not available?
 #else
    //An invalid handle value is returned
@@ -248,6 +427,18 @@ void osEventClose(OsEvent *event)
       //Properly dispose the event object
       vSemaphoreDelete((xSemaphoreHandle) event);
    }
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixEvent *e = (OsPosixEvent *) event;
+
+   //Make sure the handle is valid
+   if(e)
+   {
+      //Properly dispose the event object
+      pthread_cond_destroy(&e->cond);
+      pthread_mutex_destroy(&e->mutex);
+      free(e);
+   }
 #endif
 }
 
@@ -263,6 +454,22 @@ void osEventSet(OsEvent *event)
 #if defined(USE_FREERTOS)
    //Set the specified event to the signaled state
    xSemaphoreGive((xSemaphoreHandle) event);
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixEvent *e = (OsPosixEvent *) event;
+
+   //Set the specified event to the signaled state
+   pthread_mutex_lock(&e->mutex);
+   e->state = TRUE;
+
+   //A manual-reset event releases all the waiting tasks whereas
+   //an auto-reset event releases a single one
+   if(e->manualReset)
+      pthread_cond_broadcast(&e->cond);
+   else
+      pthread_cond_signal(&e->cond);
+
+   pthread_mutex_unlock(&e->mutex);
 #endif
 }
 
@@ -278,6 +485,14 @@ void osEventReset(OsEvent *event)
 #if defined(USE_FREERTOS)
    //Force the specified event to the nonsignaled state
    xSemaphoreTake((xSemaphoreHandle) event, 0);
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixEvent *e = (OsPosixEvent *) event;
+
+   //Force the specified event to the nonsignaled state
+   pthread_mutex_lock(&e->mutex);
+   e->state = FALSE;
+   pthread_mutex_unlock(&e->mutex);
 #endif
 }
 
@@ -301,6 +516,37 @@ bool_t osEventWait(OsEvent *event, time_t timeout)
    //Waits until the specified event is in the signaled
    //state or the time-out interval elapses
    return xSemaphoreTake((xSemaphoreHandle) event, timeout);
+//POSIX port?
+#elif defined(USE_POSIX)
+   bool_t signaled;
+   struct timespec deadline;
+   OsPosixEvent *e = (OsPosixEvent *) event;
+
+   //Compute the absolute time at which the wait ends
+   osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&e->mutex);
+
+   //Wait until the event is signaled or the time-out interval elapses
+   while(!e->state)
+   {
+      if(!osPosixCondWait(&e->cond, &e->mutex, &deadline, timeout))
+         break;
+   }
+
+   //Retrieve the state of the event
+   signaled = e->state;
+
+   //Auto-reset events are reset once a waiting task has been released
+   if(signaled && !e->manualReset)
+      e->state = FALSE;
+
+   //Leave critical section
+   pthread_mutex_unlock(&e->mutex);
+
+   //Return TRUE if the event was signaled
+   return signaled;
 //OS port is not available?
 #else
    //The function has failed
@@ -327,6 +573,12 @@ bool_t osEventSetFromIrq(OsEvent *event)
 
    //A higher priority task has been woken?
    return flag;
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Driver threads play the role of interrupt handlers
+   osEventSet(event);
+   //No context switch is required
+   return FALSE;
 //OS port is not available?
 #else
    //The function has failed
@@ -364,6 +616,24 @@ OsSemaphore *osSemaphoreCreate(uint_t maxCount, uint_t initialCount)
    //Return a handle to the newly created semaphore
    return (OsMutex *) semaphore;
 
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixSemaphore *semaphore;
+
+   //Allocate a new semaphore object
+   semaphore = malloc(sizeof(OsPosixSemaphore));
+   //Failed to allocate memory?
+   if(!semaphore) return NULL;
+
+   //Initialize the semaphore object
+   pthread_mutex_init(&semaphore->mutex, NULL);
+   osPosixInitCond(&semaphore->cond);
+   semaphore->maxCount = maxCount;
+   semaphore->count = initialCount;
+
+   //Return a handle to the newly created semaphore
+   return (OsSemaphore *) semaphore;
+
 //OS port is not available?
 #else
    //An invalid handle value is returned
@@ -386,6 +656,18 @@ void osSemaphoreClose(OsSemaphore *semaphore)
       //Properly dispose the specified semaphore
       vSemaphoreDelete((xSemaphoreHandle) semaphore);
    }
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixSemaphore *s = (OsPosixSemaphore *) semaphore;
+
+   //Make sure the handle is valid
+   if(s)
+   {
+      //Properly dispose the specified semaphore
+      pthread_cond_destroy(&s->cond);
+      pthread_mutex_destroy(&s->mutex);
+      free(s);
+   }
 #endif
 }
 
@@ -409,6 +691,37 @@ bool_t osSemaphoreWait(OsSemaphore *semaphore, time_t timeout)
    //Waits until the specified semaphore is in the signaled
    //state or the time-out interval elapses
    return xSemaphoreTake((xSemaphoreHandle) semaphore, timeout);
+//POSIX port?
+#elif defined(USE_POSIX)
+   bool_t signaled;
+   struct timespec deadline;
+   OsPosixSemaphore *s = (OsPosixSemaphore *) semaphore;
+
+   //Compute the absolute time at which the wait ends
+   osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&s->mutex);
+
+   //Wait until the count is nonzero or the time-out interval elapses
+   while(!s->count)
+   {
+      if(!osPosixCondWait(&s->cond, &s->mutex, &deadline, timeout))
+         break;
+   }
+
+   //The semaphore is signaled when its count is greater than zero
+   signaled = (s->count > 0);
+
+   //Decrement the count
+   if(signaled)
+      s->count--;
+
+   //Leave critical section
+   pthread_mutex_unlock(&s->mutex);
+
+   //Return TRUE if the semaphore was signaled
+   return signaled;
 //OS port is not available?
 #else
    //The function has failed
@@ -428,6 +741,24 @@ void osSemaphoreRelease(OsSemaphore *semaphore)
 #if defined(USE_FREERTOS)
    //Release the semaphore
    xSemaphoreGive((xSemaphoreHandle) semaphore);
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixSemaphore *s = (OsPosixSemaphore *) semaphore;
+
+   //Enter critical section
+   pthread_mutex_lock(&s->mutex);
+
+   //The count cannot exceed the maximum value
+   if(s->count < s->maxCount)
+   {
+      //Increment the count
+      s->count++;
+      //Release a waiting task
+      pthread_cond_signal(&s->cond);
+   }
+
+   //Leave critical section
+   pthread_mutex_unlock(&s->mutex);
 #endif
 }
 
@@ -471,6 +802,28 @@ OsMutex *osMutexCreate(bool_t initialOwner)
    //Return a handle to the newly created mutex
    return (OsMutex *) mutex;
 
+//POSIX port?
+#elif defined(USE_POSIX)
+   pthread_mutex_t *mutex;
+
+   //Allocate a new mutex object
+   mutex = malloc(sizeof(pthread_mutex_t));
+   //Failed to allocate memory?
+   if(!mutex) return NULL;
+
+   //Initialize the mutex object
+   pthread_mutex_init(mutex, NULL);
+
+   //Get the initial ownership of the mutex?
+   if(initialOwner)
+   {
+      //Obtain ownership
+      pthread_mutex_lock(mutex);
+   }
+
+   //Return a handle to the newly created mutex
+   return (OsMutex *) mutex;
+
 //OS port is not available?
 #else
    //An invalid handle value is returned
@@ -493,6 +846,15 @@ void osMutexClose(OsMutex *mutex)
       //Properly dispose the specified mutex
       vSemaphoreDelete((xSemaphoreHandle) mutex);
    }
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Make sure the handle is valid
+   if(mutex)
+   {
+      //Properly dispose the specified mutex
+      pthread_mutex_destroy((pthread_mutex_t *) mutex);
+      free(mutex);
+   }
 #endif
 }
 
@@ -508,6 +870,10 @@ void osMutexAcquire(OsMutex *mutex)
 #if defined(USE_FREERTOS)
    //Obtain ownership of the mutex object
    xSemaphoreTake((xSemaphoreHandle) mutex, portMAX_DELAY);
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Obtain ownership of the mutex object
+   pthread_mutex_lock((pthread_mutex_t *) mutex);
 #endif
 }
 
@@ -523,6 +889,10 @@ void osMutexRelease(OsMutex *mutex)
 #if defined(USE_FREERTOS)
    //Release ownership of the mutex object
    xSemaphoreGive((xSemaphoreHandle) mutex);
+//POSIX port?
+#elif defined(USE_POSIX)
+   //Release ownership of the mutex object
+   pthread_mutex_unlock((pthread_mutex_t *) mutex);
 #endif
 }
 
@@ -533,6 +903,38 @@ OsQueue *osQueueCreate(uint_t length, size_t itemSize)
 #if defined(USE_FREERTOS)
    //Create a queue and return a handle to the newly created object
    return xQueueCreate(length, itemSize);
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixQueue *queue;
+
+   //Allocate a new queue object
+   queue = malloc(sizeof(OsPosixQueue));
+   //Failed to allocate memory?
+   if(!queue) return NULL;
+
+   //Allocate the storage area
+   queue->buffer = malloc(length * itemSize);
+
+   //Failed to allocate memory?
+   if(!queue->buffer)
+   {
+      //Clean up side effects
+      free(queue);
+      //Report an error
+      return NULL;
+   }
+
+   //Initialize the queue object
+   pthread_mutex_init(&queue->mutex, NULL);
+   osPosixInitCond(&queue->notEmpty);
+   osPosixInitCond(&queue->notFull);
+   queue->length = length;
+   queue->itemSize = itemSize;
+   queue->count = 0;
+   queue->readIndex = 0;
+
+   //Return a handle to the newly created queue
+   return (OsQueue *) queue;
 //OS port is not available?
 #else
    //An invalid handle value is returned
@@ -551,6 +953,20 @@ void osQueueClose(OsQueue *queue)
       //Properly dispose the specified queue object
       vQueueDelete((xQueueHandle) queue);
    }
+//POSIX port?
+#elif defined(USE_POSIX)
+   OsPosixQueue *q = (OsPosixQueue *) queue;
+
+   //Make sure the handle is valid
+   if(q)
+   {
+      //Properly dispose the specified queue object
+      pthread_cond_destroy(&q->notEmpty);
+      pthread_cond_destroy(&q->notFull);
+      pthread_mutex_destroy(&q->mutex);
+      free(q->buffer);
+      free(q);
+   }
 #endif
 }
 
@@ -561,6 +977,45 @@ bool_t osQueueSend(OsQueue *queue, const void *item, time_t timeout)
 #if defined(USE_FREERTOS)
    //Send the specified item to the queue
    return xQueueSend(queue, item, timeout);
+//POSIX port?
+#elif defined(USE_POSIX)
+   bool_t ready;
+   uint_t i;
+   struct timespec deadline;
+   OsPosixQueue *q = (OsPosixQueue *) queue;
+
+   //Compute the absolute time at which the wait ends
+   osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&q->mutex);
+
+   //Wait for space to become available
+   while(q->count >= q->length)
+   {
+      if(!osPosixCondWait(&q->notFull, &q->mutex, &deadline, timeout))
+         break;
+   }
+
+   //Any room left in the queue?
+   ready = (q->count < q->length);
+
+   if(ready)
+   {
+      //Index of the first free slot
+      i = (q->readIndex + q->count) % q->length;
+      //Copy the item to the back of the queue
+      memcpy(q->buffer + i * q->itemSize, item, q->itemSize);
+      q->count++;
+      //Release a task waiting for an item
+      pthread_cond_signal(&q->notEmpty);
+   }
+
+   //Leave critical section
+   pthread_mutex_unlock(&q->mutex);
+
+   //Return TRUE if the item was posted
+   return ready;
 //OS port is not available?
 #else
    //The function has failed
@@ -575,6 +1030,44 @@ bool_t osQueueReceive(OsQueue *queue, void *item, time_t timeout)
 #if defined(USE_FREERTOS)
    //Receive an item from the queue
    return xQueueReceive(queue, item, timeout);
+//POSIX port?
+#elif defined(USE_POSIX)
+   bool_t ready;
+   struct timespec deadline;
+   OsPosixQueue *q = (OsPosixQueue *) queue;
+
+   //Compute the absolute time at which the wait ends
+   osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&q->mutex);
+
+   //Wait for an item to be posted
+   while(!q->count)
+   {
+      if(!osPosixCondWait(&q->notEmpty, &q->mutex, &deadline, timeout))
+         break;
+   }
+
+   //Any item available?
+   ready = (q->count > 0);
+
+   if(ready)
+   {
+      //Copy the item at the front of the queue
+      memcpy(item, q->buffer + q->readIndex * q->itemSize, q->itemSize);
+      //Remove the item from the queue
+      q->readIndex = (q->readIndex + 1) % q->length;
+      q->count--;
+      //Release a task waiting for space
+      pthread_cond_signal(&q->notFull);
+   }
+
+   //Leave critical section
+   pthread_mutex_unlock(&q->mutex);
+
+   //Return TRUE if an item was received
+   return ready;
 //OS port is not available?
 #else
    //The function has failed
@@ -589,6 +1082,37 @@ bool_t osQueuePeek(OsQueue *queue, void *item, time_t timeout)
 #if defined(USE_FREERTOS)
    //Look at the next item in the queue
    return xQueueReceive(queue, item, timeout);
+//POSIX port?
+#elif defined(USE_POSIX)
+   bool_t ready;
+   struct timespec deadline;
+   OsPosixQueue *q = (OsPosixQueue *) queue;
+
+   //Compute the absolute time at which the wait ends
+   osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&q->mutex);
+
+   //Wait for an item to be posted
+   while(!q->count)
+   {
+      if(!osPosixCondWait(&q->notEmpty, &q->mutex, &deadline, timeout))
+         break;
+   }
+
+   //Any item available?
+   ready = (q->count > 0);
+
+   //Copy the item at the front of the queue without removing it
+   if(ready)
+      memcpy(item, q->buffer + q->readIndex * q->itemSize, q->itemSize);
+
+   //Leave critical section
+   pthread_mutex_unlock(&q->mutex);
+
+   //Return TRUE if an item is available
+   return ready;
 //OS port is not available?
 #else
    //The function has failed
@@ -603,6 +1127,12 @@ bool_t osQueueSendFromIrq(OsQueue *queue, const void *item, bool_t *higherPriori
 #if defined(USE_FREERTOS)
    //Send the specified item to the queue
    return xQueueSendFromISR(queue, item, (portBASE_TYPE *) higherPriorityTaskWoken);
+//POSIX port?
+#elif defined(USE_POSIX)
+   //No context switch is required
+   *higherPriorityTaskWoken = FALSE;
+   //Driver threads play the role of interrupt handlers
+   return osQueueSend(queue, item, 0);
 //OS port is not available?
 #else
    //The function has failed
@@ -617,6 +1147,12 @@ bool_t osQueueReceiveFromIrq(OsQueue *queue, void *item, bool_t *higherPriorityT
 #if defined(USE_FREERTOS)
    //Receive an item from the queue
    return xQueueReceiveFromISR(queue, item, (portBASE_TYPE *) higherPriorityTaskWoken);
+//POSIX port?
+#elif defined(USE_POSIX)
+   //No context switch is required
+   *higherPriorityTaskWoken = FALSE;
+   //Driver threads play the role of interrupt handlers
+   return osQueueReceive(queue, item, 0);
 //OS port is not available?
 #else
    //The function has failed
@@ -771,6 +1307,16 @@ void osDelay(time_t delay)
 //FreeRTOS port?
 #if defined(USE_FREERTOS)
    vTaskDelay(delay);
+//POSIX port?
+#elif defined(USE_POSIX)
+   struct timespec ts;
+
+   //Convert the delay to seconds and nanoseconds
+   ts.tv_sec = (uint_t) delay / 1000;
+   ts.tv_nsec = ((uint_t) delay % 1000) * 1000000;
+
+   //Sleep until the delay has elapsed, even if a signal is caught
+   while(nanosleep(&ts, &ts) < 0 && errno == EINTR);
 #endif
 }
 
@@ -785,6 +1331,14 @@ time_t osGetTickCount(void)
 //FreeRTOS port?
 #if defined(USE_FREERTOS)
    return xTaskGetTickCount();
+//POSIX port?
+#elif defined(USE_POSIX)
+   struct timespec ts;
+
+   //The monotonic clock is not affected by system time changes
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   //Convert the current time to milliseconds
+   return (time_t) (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 #else
    return 0;
 #endif
@@ -793,7 +1347,7 @@ time_t osGetTickCount(void)
 
 time_t osGetTime(void)
 {
-#ifdef _WIN32
+#if defined(_WIN32) || defined(USE_POSIX)
    return time(NULL);
 #else
    return 0;
@@ -809,6 +1363,9 @@ const char_t *timeFormat(time_t time)
 }
 
 
+//POSIX hosts provide their own usleep and sleep routines
+#if !defined(USE_POSIX)
+
 /**
  * @brief Delay routine
  **/
@@ -830,10 +1387,131 @@ void sleep(uint_t delay)
    while(delay--);
 }
 
+#endif
+
 
-#ifndef _WIN32
+#if !defined(_WIN32) && !defined(USE_POSIX)
 void vApplicationStackOverflowHook(xTaskHandle *pxTask, char *pcTaskName)
 {
    //TRACE_FATAL("FreeRTOS application stack overflow!\r\n");
 }
 #endif
+
+
+//POSIX port?
+#if defined(USE_POSIX)
+
+/**
+ * @brief Initialize the lock emulating the scheduler suspension
+ *
+ * osTaskSuspendAll calls may be nested, hence the recursive lock
+ *
+ **/
+
+static void osPosixInitSchedulerLock(void)
+{
+   pthread_mutexattr_t attr;
+
+   //Create a recursive mutex
+   pthread_mutexattr_init(&attr);
+   pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+   pthread_mutex_init(&osPosixSchedulerLock, &attr);
+   pthread_mutexattr_destroy(&attr);
+}
+
+
+/**
+ * @brief Thread entry point
+ * @param[in] param Pointer to the task object
+ * @return Unused value
+ **/
+
+static void *osPosixTaskWrapper(void *param)
+{
+   //Point to the task object
+   OsPosixTask *task = (OsPosixTask *) param;
+
+   //Save the handle of the task running on this thread
+   osPosixCurrentTask = task;
+   //Run the task
+   task->code(task->params);
+
+   //The task returned without deleting itself
+   osPosixCurrentTask = NULL;
+   free(task);
+
+   //Terminate the thread
+   return NULL;
+}
+
+
+/**
+ * @brief Initialize a condition variable using the monotonic clock
+ * @param[in] cond Condition variable to initialize
+ **/
+
+static void osPosixInitCond(pthread_cond_t *cond)
+{
+   pthread_condattr_t attr;
+
+   //Time-outs must not be affected by system time changes
+   pthread_condattr_init(&attr);
+   pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+   pthread_cond_init(cond, &attr);
+   pthread_condattr_destroy(&attr);
+}
+
+
+/**
+ * @brief Compute the absolute time at which a wait operation ends
+ * @param[out] ts Absolute time based on the monotonic clock
+ * @param[in] timeout Time-out interval, in milliseconds
+ **/
+
+static void osPosixGetDeadline(struct timespec *ts, time_t timeout)
+{
+   //Get current time
+   clock_gettime(CLOCK_MONOTONIC, ts);
+
+   //Infinite time-outs do not need any deadline
+   if(timeout != INFINITE_DELAY)
+   {
+      //Add the time-out interval
+      ts->tv_sec += (uint_t) timeout / 1000;
+      ts->tv_nsec += ((uint_t) timeout % 1000) * 1000000;
+
+      //Normalize the result
+      if(ts->tv_nsec >= 1000000000)
+      {
+         ts->tv_sec++;
+         ts->tv_nsec -= 1000000000;
+      }
+   }
+}
+
+
+/**
+ * @brief Wait for a condition variable to be signaled
+ * @param[in] cond Condition variable
+ * @param[in] mutex Mutex associated with the condition variable
+ * @param[in] deadline Absolute time at which the wait ends
+ * @param[in] timeout Time-out interval, in milliseconds
+ * @return FALSE if the time-out interval elapsed, else TRUE
+ **/
+
+static bool_t osPosixCondWait(pthread_cond_t *cond,
+   pthread_mutex_t *mutex, const struct timespec *deadline, time_t timeout)
+{
+   //Zero time-out?
+   if(!timeout)
+      return FALSE;
+
+   //Infinite time-out?
+   if(timeout == INFINITE_DELAY)
+      return (pthread_cond_wait(cond, mutex) == 0);
+
+   //Wait until the condition is signaled or the deadline is reached
+   return (pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT);
+}
+
+#endif
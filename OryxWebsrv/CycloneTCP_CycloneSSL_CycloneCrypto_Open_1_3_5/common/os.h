@@ -168,8 +168,12 @@ time_t osGetTickCount(void);
 time_t osGetTime(void);
 
 const char_t *timeFormat(time_t time);
-void usleep(uint_t delay);
-void sleep(uint_t delay);
+
+//POSIX hosts provide their own usleep and sleep routines
+#if !defined(USE_POSIX)
+   void usleep(uint_t delay);
+   void sleep(uint_t delay);
+#endif
 
 
 //#define osWaitForEvent2(event, timeout) xQueuePeek(event, NULL, timeout)
@@ -26,6 +26,7 @@
 
 //Dependencies
 #include <string.h>
+#include <ctype.h>
 #include "os.h"
 #include "resource_manager.h"
 #include "debug.h"
@@ -34,7 +35,172 @@
 extern uint8_t res[];
 
 
-error_t resGetData(const char_t *path, uint8_t **data, size_t *length)
+#if (RES_INDEX_SUPPORT == ENABLED)
+
+//Compute the hash of a path (FNV-1a over the normalized characters)
+static bool_t resHashPath(const char_t *path, uint32_t *hash)
+{
+   uint_t n;
+   char_t c;
+   const char_t *p;
+   uint32_t h;
+
+   //FNV offset basis
+   h = 2166136261UL;
+   //Length of the current component
+   n = 0;
+
+   //Loop through the path
+   for(p = path; ; p++)
+   {
+      //Retrieve current character
+      c = *p;
+
+      //End of a component?
+      if(c == '/' || c == '\\' || c == '\0')
+      {
+         //Empty, "." and ".." components can only be resolved by walking
+         //through the directory entries
+         if(n == 0 || (n == 1 && p[-1] == '.') || (n == 2 && p[-1] == '.' && p[-2] == '.'))
+            return FALSE;
+
+         //End of the path?
+         if(c == '\0')
+            break;
+
+         //Both separators are equivalent
+         c = '/';
+         n = 0;
+      }
+      else
+      {
+         //The comparison is case insensitive
+         c = tolower((uint8_t) c);
+         n++;
+      }
+
+      //Update hash value
+      h = (h ^ (uint8_t) c) * 16777619UL;
+   }
+
+   //Return the resulting hash value
+   *hash = h;
+   //The path is in canonical form
+   return TRUE;
+}
+
+
+//Compare a path against a normalized path stored in the index
+static bool_t resComparePath(const char_t *path, const char_t *normalizedPath)
+{
+   char_t c;
+
+   //Compare the paths character by character
+   do
+   {
+      //Normalize current character
+      c = (*path == '\\') ? '/' : tolower((uint8_t) *path);
+
+      //Mismatch?
+      if(c != *normalizedPath)
+         return FALSE;
+
+      //Next character
+      path++;
+      normalizedPath++;
+   } while(c != '\0');
+
+   //The paths are identical
+   return TRUE;
+}
+
+
+//Look up a file in the path index
+static bool_t resSearchIndex(const char_t *path, ResIndexSlot **resSlot)
+{
+   uint_t i;
+   uint_t k;
+   uint32_t h;
+   uint32_t mask;
+   ResIndexDesc *desc;
+   ResIndex *index;
+   ResIndexSlot *slot;
+
+   //Point to the resource header
+   ResHeader *resHeader = (ResHeader *) res;
+
+   //The index descriptor is stored as the name of the root entry
+   if(resHeader->rootEntry.nameLength < sizeof(ResIndexDesc))
+      return FALSE;
+
+   //Point to the index descriptor
+   desc = (ResIndexDesc *) resHeader->rootEntry.name;
+
+   //Older resource images do not embed any index
+   if(memcmp(desc->magic, RES_INDEX_MAGIC, sizeof(desc->magic)))
+      return FALSE;
+   //Make sure the index is valid
+   if(desc->indexLength < sizeof(ResIndex) || desc->indexStart > resHeader->totalSize ||
+      desc->indexLength > (resHeader->totalSize - desc->indexStart))
+   {
+      return FALSE;
+   }
+
+   //Point to the index
+   index = (ResIndex *) (res + desc->indexStart);
+
+   //The number of slots shall be a power of two
+   if(!index->slotCount || (index->slotCount & (index->slotCount - 1)))
+      return FALSE;
+   //Check the length of the slot table
+   if(index->slotCount > ((desc->indexLength - sizeof(ResIndex)) / sizeof(ResIndexSlot)))
+      return FALSE;
+
+   //Skip the leading separator
+   if(path[0] == '/' || path[0] == '\\')
+      path++;
+
+   //Non-canonical paths are resolved by walking through the directories
+   if(!resHashPath(path, &h))
+      return FALSE;
+
+   //Mask used to wrap around the slot table
+   mask = index->slotCount - 1;
+
+   //Linear probing
+   for(i = h & mask, k = 0; k < index->slotCount; i = (i + 1) & mask, k++)
+   {
+      //Point to the current slot
+      slot = &index->slot[i];
+
+      //An empty slot terminates the search
+      if(!slot->entryStart)
+         break;
+
+      //Compare the hash values first, then the paths
+      if(slot->hash == h && slot->pathStart < resHeader->totalSize &&
+         resComparePath(path, (char_t *) res + slot->pathStart))
+      {
+         //Sanity check
+         if(slot->entryStart > (resHeader->totalSize - sizeof(ResEntry)))
+            break;
+
+         //The file has been found
+         *resSlot = slot;
+         return TRUE;
+      }
+   }
+
+   //The index covers every file, hence the file does not exist
+   *resSlot = NULL;
+   return TRUE;
+}
+
+#endif
+
+
+//Walk through the directory entries to locate a file
+static error_t resWalkPath(const char_t *path, ResEntry **entry)
 {
    bool_t found;
    bool_t match;
@@ -82,6 +248,8 @@ error_t resGetData(const char_t *path, uint8_t **data, size_t *length)
             //Check the type of the entry
             if(resEntry->type == RES_TYPE_DIR)
             {
+               //The path designates a directory rather than a file
+               if(path[n] == '\0') return ERROR_NOT_FOUND;
                //Save the length of the directory
                dirLength = resEntry->dataLength;
                //Point to the contents of the directory
@@ -113,6 +281,57 @@ error_t resGetData(const char_t *path, uint8_t **data, size_t *length)
    //Unable to find the specified file?
    if(!found)
       return ERROR_NOT_FOUND;
+
+   //Return the matching entry
+   *entry = resEntry;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+//Locate the entry describing a file
+static error_t resFindEntry(const char_t *path, ResEntry **resEntry)
+{
+#if (RES_INDEX_SUPPORT == ENABLED)
+   ResIndexSlot *slot;
+#endif
+
+   //Point to the resource header
+   ResHeader *resHeader = (ResHeader *) res;
+
+   //Make sure the resource data is valid
+   if(resHeader->totalSize < sizeof(ResHeader))
+      return ERROR_INVALID_RESOURCE;
+
+#if (RES_INDEX_SUPPORT == ENABLED)
+   //Use the path index when available
+   if(resSearchIndex(path, &slot))
+   {
+      //The index covers every file
+      if(slot == NULL)
+         return ERROR_NOT_FOUND;
+
+      //Point to the entry describing the file
+      *resEntry = (ResEntry *) (res + slot->entryStart);
+      return NO_ERROR;
+   }
+#endif
+
+   //Fall back to a directory walk
+   return resWalkPath(path, resEntry);
+}
+
+
+error_t resGetData(const char_t *path, uint8_t **data, size_t *length)
+{
+   error_t error;
+   ResEntry *resEntry;
+
+   //Search the resource data for the specified file
+   error = resFindEntry(path, &resEntry);
+   //Unable to find the specified file?
+   if(error) return error;
+
    //Enforce the entry type
    if(resEntry->type != RES_TYPE_FILE)
       return ERROR_NOT_FOUND;
@@ -127,13 +346,11 @@ error_t resGetData(const char_t *path, uint8_t **data, size_t *length)
 }
 
 
-error_t resSearchFile(const char_t *path, DirEntry *dirEntry)
+//Retrieve the content tag the resource compiler computed for a file
+error_t resGetTag(const char_t *path, uint32_t *tag)
 {
-   bool_t found;
-   bool_t match;
-   uint_t n;
-   uint_t length;
-   ResEntry *resEntry;
+#if (RES_INDEX_SUPPORT == ENABLED)
+   ResIndexSlot *slot;
 
    //Point to the resource header
    ResHeader *resHeader = (ResHeader *) res;
@@ -142,69 +359,30 @@ error_t resSearchFile(const char_t *path, DirEntry *dirEntry)
    if(resHeader->totalSize < sizeof(ResHeader))
       return ERROR_INVALID_RESOURCE;
 
-   //Retrieve the length of the root directory
-   length = resHeader->rootEntry.dataLength;
-   //Point to the contents of the root directory
-   resEntry = (ResEntry *) (res + resHeader->rootEntry.dataStart);
-
-   //Parse the entire path
-   for(found = FALSE; !found && path[0] != '\0'; path += n + 1)
+   //Only the files referenced by the path index carry a tag
+   if(resSearchIndex(path, &slot) && slot != NULL)
    {
-      //Search for the separator that terminates the current token
-      for(n = 0; path[n] != '\\' && path[n] != '/' && path[n] != '\0'; n++);
-
-      if(n == 0 && path[n] != '\0')
-      {
-         path++;
-         for(n = 0; path[n] != '\\' && path[n] != '/' && path[n] != '\0'; n++);
-      }
+      //Return the tag
+      *tag = slot->tag;
+      //Successful processing
+      return NO_ERROR;
+   }
+#endif
 
-      //Loop through the directory
-      for(match = FALSE; !match && length > 0; )
-      {
-         //Check the number of remaining bytes
-         if(length < sizeof(ResEntry))
-            return ERROR_INVALID_RESOURCE;
-         //Make sure the entry is valid
-         if(length < (sizeof(ResEntry) + resEntry->nameLength))
-            return ERROR_INVALID_RESOURCE;
+   //No tag available
+   return ERROR_NOT_FOUND;
+}
 
-         //Compare current entry name against the expected one
-         if(resEntry->nameLength == n && !strncasecmp(resEntry->name, path, n))
-         {
-            //Check the type of the entry
-            if(resEntry->type == RES_TYPE_DIR)
-            {
-               //Save the length of the directory
-               length = resEntry->dataLength;
-               //Point to the contents of the directory
-               resEntry = (ResEntry *) (res + resEntry->dataStart);
-            }
-            else
-            {
-               //A file may only appear at the end of the path
-               if(path[n] != '\0') return ERROR_INVALID_PATH;
-               //The search process is complete
-               found = TRUE;
-            }
-            //The current entry matches the specified path
-            match = TRUE;
-         }
-         else
-         {
-            //Remaining bytes to process
-            length -= sizeof(ResEntry) + resEntry->nameLength;
-            //Point to the next entry
-            resEntry = (ResEntry *) ((uint8_t *) resEntry + sizeof(ResEntry) + resEntry->nameLength);
-         }
-      }
 
-      //Unable to find the specified file?
-      if(!match) return ERROR_NOT_FOUND;
-   }
+error_t resSearchFile(const char_t *path, DirEntry *dirEntry)
+{
+   error_t error;
+   ResEntry *resEntry;
 
+   //Search the resource data for the specified file
+   error = resFindEntry(path, &resEntry);
    //Unable to find the specified file?
-   if(!found) return ERROR_NOT_FOUND;
+   if(error) return error;
 
    //Return information about the file
    dirEntry->type = resEntry->type;
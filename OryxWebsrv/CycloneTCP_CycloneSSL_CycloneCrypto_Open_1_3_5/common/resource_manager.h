@@ -28,6 +28,7 @@
 #define _RESOURCE_MANAGER_H
 
 //Dependencies
+#include "os.h"
 #include "error.h"
 
 #define MODE_BINARY 0
@@ -37,6 +38,16 @@
 #define SEEK_CUR 1
 #define SEEK_END 2
 
+//Path index support
+#ifndef RES_INDEX_SUPPORT
+   #define RES_INDEX_SUPPORT ENABLED
+#elif (RES_INDEX_SUPPORT != ENABLED && RES_INDEX_SUPPORT != DISABLED)
+   #error RES_INDEX_SUPPORT parameter is invalid
+#endif
+
+//Signature identifying the path index descriptor
+#define RES_INDEX_MAGIC "RIDX"
+
 /**
  * @brief Resource type
  **/
@@ -83,6 +94,45 @@ typedef __packed struct
 } ResHeader;
 
 
+/**
+ * @brief Path index descriptor
+ *
+ * Stored as the name of the root entry, which older
+ * firmware ignores
+ **/
+
+typedef __packed struct
+{
+   char_t magic[4];
+   uint32_t indexStart;
+   uint32_t indexLength;
+} ResIndexDesc;
+
+
+/**
+ * @brief Path index slot
+ **/
+
+typedef __packed struct
+{
+   uint32_t hash;
+   uint32_t entryStart;
+   uint32_t pathStart;
+   uint32_t tag;
+} ResIndexSlot;
+
+
+/**
+ * @brief Path index
+ **/
+
+typedef __packed struct
+{
+   uint32_t slotCount;
+   ResIndexSlot slot[];
+} ResIndex;
+
+
 #if (defined(__GNUC__) || defined(_WIN32))
    #undef __packed
    #pragma pack(pop)
@@ -111,6 +161,7 @@ typedef struct
 
 //Resource management
 error_t resGetData(const char_t *path, uint8_t **data, size_t *length);
+error_t resGetTag(const char_t *path, uint32_t *tag);
 
 error_t resSearchFile(const char_t *path, DirEntry *dirEntry);
 
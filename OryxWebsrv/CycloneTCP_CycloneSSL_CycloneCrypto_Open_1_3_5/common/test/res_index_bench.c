@@ -0,0 +1,227 @@
+/**
+ * @file res_index_bench.c
+ * @brief Resource lookup benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * A tree of 1000 files is generated and packed twice, with the layout of
+ * the resource compiler: once as an old image (directory walk only) and
+ * once with the hashed path index. Every file is looked up in both images
+ * and must resolve to the same contents, then the number of lookups per
+ * second is measured for each image
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "os.h"
+#include "resource_manager.h"
+#include "res_image.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Shape of the generated tree
+#define TREE_DIR_COUNT 10
+#define TREE_FILES_PER_DIR 90
+#define TREE_FILES_PER_SUBDIR 9
+#define TREE_ROOT_FILE_COUNT 10
+#define TREE_FILE_COUNT (TREE_ROOT_FILE_COUNT + TREE_DIR_COUNT * \
+   (TREE_FILES_PER_DIR + TREE_FILES_PER_SUBDIR))
+
+//Number of passes over the whole tree
+#define BENCH_PASSES 200
+
+//Resource image used by the resource manager
+uint8_t res[1024 * 1024];
+
+//Generated tree
+static char_t treePath[TREE_FILE_COUNT][RES_IMAGE_MAX_PATH];
+static char_t requestPath[TREE_FILE_COUNT][RES_IMAGE_MAX_PATH + 1];
+static ResImageFile treeFile[TREE_FILE_COUNT];
+
+
+/**
+ * @brief Generate the file tree
+ **/
+
+static void generateTree(void)
+{
+   uint_t i;
+   uint_t j;
+   uint_t n;
+
+   //Files located in the root directory
+   for(n = 0, i = 0; i < TREE_ROOT_FILE_COUNT; i++)
+      sprintf(treePath[n++], "page%02u.htm", i);
+
+   //Loop through directories
+   for(i = 0; i < TREE_DIR_COUNT; i++)
+   {
+      //Scripts and style sheets
+      for(j = 0; j < TREE_FILES_PER_DIR; j++)
+         sprintf(treePath[n++], "app%02u/module%03u.%s", i, j, (j & 1) ? "css" : "js");
+      //Images
+      for(j = 0; j < TREE_FILES_PER_SUBDIR; j++)
+         sprintf(treePath[n++], "app%02u/images/icon%02u.png", i, j);
+   }
+
+   //Each file holds its own path
+   for(i = 0; i < TREE_FILE_COUNT; i++)
+   {
+      treeFile[i].path = treePath[i];
+      treeFile[i].data = treePath[i];
+      treeFile[i].length = strlen(treePath[i]);
+
+      //Request the file the way the HTTP server does
+      sprintf(requestPath[i], "/%s", treePath[i]);
+   }
+}
+
+
+/**
+ * @brief Check that every file resolves to its contents
+ * @return Error code
+ **/
+
+static error_t checkLookups(void)
+{
+   error_t error;
+   uint_t i;
+   uint8_t *data;
+   size_t length;
+
+   //Loop through files
+   for(i = 0; i < TREE_FILE_COUNT; i++)
+   {
+      //Look up the file
+      error = resGetData(requestPath[i], &data, &length);
+
+      //Check the contents
+      if(error || length != treeFile[i].length || memcmp(data, treeFile[i].data, length))
+      {
+         printf("Lookup of %s failed\r\n", requestPath[i]);
+         return ERROR_FAILURE;
+      }
+   }
+
+   //Missing files must not be found
+   if(!resGetData("/app03/module999.js", &data, &length) ||
+      !resGetData("/app03/images", &data, &length))
+   {
+      printf("Lookup of a missing file succeeded\r\n");
+      return ERROR_FAILURE;
+   }
+
+   //Successful test
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Measure lookup rate
+ * @return Lookups per second
+ **/
+
+static double benchLookups(void)
+{
+   uint_t i;
+   uint_t j;
+   uint64_t time;
+   uint8_t *data;
+   size_t length;
+
+   //Start of the measurement
+   time = benchGetTime();
+
+   //Look up every file repeatedly
+   for(j = 0; j < BENCH_PASSES; j++)
+   {
+      for(i = 0; i < TREE_FILE_COUNT; i++)
+         resGetData(requestPath[i], &data, &length);
+   }
+
+   //End of the measurement
+   time = benchGetTime() - time;
+
+   //Return the lookup rate
+   return (double) BENCH_PASSES * TREE_FILE_COUNT * 1e9 / (time ? time : 1);
+}
+
+
+/**
+ * @brief Run the benchmark over one image
+ * @param[in] index Build the image with the path index
+ * @return Error code
+ **/
+
+static error_t benchImage(bool_t index)
+{
+   error_t error;
+
+   //Pack the tree
+   error = resImageBuild(res, sizeof(res), treeFile, TREE_FILE_COUNT, index);
+   //Any error to report?
+   if(error) return error;
+
+   //Both images must give the same answers
+   error = checkLookups();
+
+   //Display results
+   printf("%-24s %-6s %12.0f\r\n", index ? "hashed path index" : "directory walk",
+      error ? "FAILED" : "OK", benchLookups());
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+
+   //Initialize debug output
+   debugInit();
+
+   //Generate the file tree
+   generateTree();
+
+   //Display header
+   printf("%u files\r\n%-24s %-6s %12s\r\n", TREE_FILE_COUNT, "Image", "Check", "lookups/s");
+
+   //Old image, then indexed image
+   error = benchImage(FALSE);
+   if(!error)
+      error = benchImage(TRUE);
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
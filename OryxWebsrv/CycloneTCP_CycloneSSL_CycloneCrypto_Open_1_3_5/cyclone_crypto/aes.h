@@ -32,6 +32,15 @@
 //Dependencies
 #include "crypto.h"
 
+//AES-NI instruction set support (x86 hosts)
+#ifndef AES_NI_SUPPORT
+   #define AES_NI_SUPPORT DISABLED
+#elif (AES_NI_SUPPORT != ENABLED && AES_NI_SUPPORT != DISABLED)
+   #error AES_NI_SUPPORT parameter is invalid
+#elif (AES_NI_SUPPORT == ENABLED && !defined(__AES__))
+   #error AES_NI_SUPPORT requires the AES-NI instruction set to be enabled (-maes)
+#endif
+
 //AES block size
 #define AES_BLOCK_SIZE 16
 //Common interface for encryption algorithms
@@ -44,25 +53,12 @@
 
 typedef struct
 {
-   uint_t nr;
-   uint32_t w[60];
+   uint_t nr;       ///<Number of rounds
+   uint32_t ek[60]; ///<Encryption round keys
+   uint32_t dk[60]; ///<Decryption round keys
 } AesContext;
 
 
-/**
- * @brief AES state array
- **/
-
-typedef struct
-{
-   union
-   {
-      uint32_t w[4];
-      uint8_t b[16];
-   };
-} AesState;
-
-
 //AES related constants
 extern const CipherAlgo aesCipherAlgo;
 
@@ -70,5 +66,7 @@ extern const CipherAlgo aesCipherAlgo;
 error_t aesInit(AesContext *context, const uint8_t *key, size_t keyLength);
 void aesEncryptBlock(AesContext *context, const uint8_t *input, uint8_t *output);
 void aesDecryptBlock(AesContext *context, const uint8_t *input, uint8_t *output);
+void aesEncryptBlocks(AesContext *context, const uint8_t *input, uint8_t *output, size_t n);
+void aesDecryptBlocks(AesContext *context, const uint8_t *input, uint8_t *output, size_t n);
 
 #endif
@@ -40,12 +40,28 @@
 #include <string.h>
 #include "crypto.h"
 #include "cipher_mode_cbc.h"
+#include "cipher_mode_misc.h"
 #include "debug.h"
 
 //Check crypto library configuration
 #if (CBC_SUPPORT == ENABLED)
 
 
+/**
+ * @brief CBC decryption job parameters
+ **/
+
+typedef struct
+{
+   const CipherAlgo *cipher;
+   void *context;
+   const uint8_t *c;
+   uint8_t *p;
+   size_t n;
+   uint8_t iv[CIPHER_MODE_WORKER_COUNT + 1][16];
+} CbcParams;
+
+
 /**
  * @brief CBC encryption
  * @param[in] cipher Cipher algorithm
@@ -60,21 +76,23 @@
 error_t cbcEncrypt(const CipherAlgo *cipher, void *context,
    uint8_t *iv, const uint8_t *p, uint8_t *c, size_t length)
 {
-   size_t i;
+   const uint8_t *v;
 
-   //CBC mode operates in a block-by-block fashion
+   //The first block is combined with the IV
+   v = iv;
+
+   //CBC encryption is inherently sequential
    while(length >= cipher->blockSize)
    {
-      //XOR input block with IV contents
-      for(i = 0; i < cipher->blockSize; i++)
-         c[i] = p[i] ^ iv[i];
+      //XOR input block with the previous output block
+      cipherXorBlock(c, p, v, cipher->blockSize);
 
       //Encrypt the current block based upon the output
       //of the previous encryption
       cipher->encryptBlock(context, c, c);
 
-      //Update IV with output block contents
-      memcpy(iv, c, cipher->blockSize);
+      //The output block is chained to the next block
+      v = c;
 
       //Next block
       p += cipher->blockSize;
@@ -82,6 +100,10 @@ error_t cbcEncrypt(const CipherAlgo *cipher, void *context,
       length -= cipher->blockSize;
    }
 
+   //Update IV with the last output block
+   if(v != iv)
+      memcpy(iv, v, cipher->blockSize);
+
    //The plaintext must be a multiple of the block size
    if(length != 0)
       return ERROR_INVALID_LENGTH;
@@ -91,6 +113,88 @@ error_t cbcEncrypt(const CipherAlgo *cipher, void *context,
 }
 
 
+/**
+ * @brief Decrypt consecutive blocks in CBC mode
+ *
+ * The blocks are decrypted a batch at a time. The plaintext blocks are
+ * then formed in reverse order, so that the ciphertext can be decrypted
+ * in place
+ *
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher algorithm context
+ * @param[in,out] iv Initialization vector
+ * @param[in] c Ciphertext to be decrypted
+ * @param[out] p Plaintext resulting from the decryption
+ * @param[in] n Number of blocks
+ **/
+
+static void cbcDecryptBlocks(const CipherAlgo *cipher, void *context,
+   uint8_t *iv, const uint8_t *c, uint8_t *p, size_t n)
+{
+   size_t i;
+   size_t k;
+   uint32_t t[4];
+   uint32_t o[CIPHER_MODE_BATCH_SIZE * 4];
+
+   //Process the blocks
+   while(n > 0)
+   {
+      //Number of blocks in the current batch
+      k = min(n, CIPHER_MODE_BATCH_SIZE);
+
+      //Save the last input block of the batch
+      memcpy(t, c + (k - 1) * cipher->blockSize, cipher->blockSize);
+      //Decrypt the whole batch
+      cipherDecryptBlocks(cipher, context, c, (uint8_t *) o, k);
+
+      //XOR each output block with the previous input block
+      for(i = k - 1; i > 0; i--)
+      {
+         cipherXorBlock(p + i * cipher->blockSize,
+            (uint8_t *) o + i * cipher->blockSize,
+            c + (i - 1) * cipher->blockSize, cipher->blockSize);
+      }
+
+      //The first output block is combined with the IV
+      cipherXorBlock(p, (uint8_t *) o, iv, cipher->blockSize);
+      //Update IV with the last input block
+      memcpy(iv, t, cipher->blockSize);
+
+      //Next batch
+      c += k * cipher->blockSize;
+      p += k * cipher->blockSize;
+      n -= k;
+   }
+}
+
+
+/**
+ * @brief Decrypt a slice of a CBC job
+ * @param[in] param Pointer to the CBC job parameters
+ * @param[in] index Index of the current slice
+ * @param[in] count Total number of slices
+ **/
+
+static void cbcDecryptJob(void *param, uint_t index, uint_t count)
+{
+   size_t first;
+   size_t last;
+   CbcParams *params;
+
+   //Point to the job parameters
+   params = (CbcParams *) param;
+
+   //Blocks processed by the current slice
+   first = params->n * index / count;
+   last = params->n * (index + 1) / count;
+
+   //Decrypt the blocks
+   cbcDecryptBlocks(params->cipher, params->context, params->iv[index],
+      params->c + first * params->cipher->blockSize,
+      params->p + first * params->cipher->blockSize, last - first);
+}
+
+
 /**
  * @brief CBC decryption
  * @param[in] cipher Cipher algorithm
@@ -105,36 +209,57 @@ error_t cbcEncrypt(const CipherAlgo *cipher, void *context,
 error_t cbcDecrypt(const CipherAlgo *cipher, void *context,
    uint8_t *iv, const uint8_t *c, uint8_t *p, size_t length)
 {
-   size_t i;
-   uint8_t t[16];
+   uint_t i;
+   uint_t count;
+   size_t n;
+   size_t first;
+   CbcParams params;
 
-   //CBC mode operates in a block-by-block fashion
-   while(length >= cipher->blockSize)
+   //Number of complete blocks
+   n = length / cipher->blockSize;
+   //Large buffers may be split across the worker tasks
+   count = cipherModeGetSliceCount(n * cipher->blockSize);
+
+   //Parallel processing?
+   if(count > 1)
    {
-      //Save input block
-      memcpy(t, c, cipher->blockSize);
+      //Save job parameters
+      params.cipher = cipher;
+      params.context = context;
+      params.c = c;
+      params.p = p;
+      params.n = n;
 
-      //Decrypt the current block
-      cipher->decryptBlock(context, c, p);
+      //Each slice is chained to the input block that precedes it
+      for(i = 0; i < count; i++)
+      {
+         //Blocks processed by the current slice
+         first = n * i / count;
 
-      //XOR output block with IV contents
-      for(i = 0; i < cipher->blockSize; i++)
-         p[i] ^= iv[i];
+         //Save the IV of the slice before the ciphertext is overwritten
+         if(first == 0)
+            memcpy(params.iv[i], iv, cipher->blockSize);
+         else
+            memcpy(params.iv[i], c + (first - 1) * cipher->blockSize, cipher->blockSize);
+      }
 
-      //Update IV with input block contents
-      memcpy(iv, t, cipher->blockSize);
+      //Update IV with the last input block
+      memcpy(iv, c + (n - 1) * cipher->blockSize, cipher->blockSize);
 
-      //Next block
-      c += cipher->blockSize;
-      p += cipher->blockSize;
-      length -= cipher->blockSize;
+      //Decrypt the slices
+      cipherModeRunJob(cbcDecryptJob, &params, count);
+   }
+   else
+   {
+      //Process the blocks sequentially
+      cbcDecryptBlocks(cipher, context, iv, c, p, n);
    }
 
    //The ciphertext must be a multiple of the block size
-   if(length != 0)
+   if((length % cipher->blockSize) != 0)
       return ERROR_INVALID_LENGTH;
 
-   //Successful encryption
+   //Successful decryption
    return NO_ERROR;
 }
 
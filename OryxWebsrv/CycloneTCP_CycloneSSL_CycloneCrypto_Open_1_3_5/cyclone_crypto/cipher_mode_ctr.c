@@ -40,6 +40,7 @@
 #include <string.h>
 #include "crypto.h"
 #include "cipher_mode_ctr.h"
+#include "cipher_mode_misc.h"
 #include "debug.h"
 
 //Check crypto library configuration
@@ -61,7 +62,6 @@
 error_t ctrEncrypt(const CipherAlgo *cipher, void *context, uint_t m,
    uint8_t *t, const uint8_t *p, uint8_t *c, size_t length)
 {
-   size_t i;
    size_t n;
    uint8_t o[16];
 
@@ -77,31 +77,26 @@ error_t ctrEncrypt(const CipherAlgo *cipher, void *context, uint_t m,
    if(m > cipher->blockSize)
       return ERROR_INVALID_PARAMETER;
 
-   //Process plaintext
-   while(length > 0)
-   {
-      //CTR mode operates in a block-by-block fashion
-      n = min(length, cipher->blockSize);
+   //Number of complete blocks
+   n = length / cipher->blockSize;
 
-      //Compute O(j) = CIPH(T(j))
-      cipher->encryptBlock(context, t, o);
+   //Generate the key stream a batch of blocks at a time
+   cipherCtrBlocks(cipher, context, m, t, p, c, n);
 
-      //Compute C(j) = P(j) XOR T(j)
-      for(i = 0; i < n; i++)
-         c[i] = p[i] ^ o[i];
+   //Point to the last block
+   p += n * cipher->blockSize;
+   c += n * cipher->blockSize;
+   length -= n * cipher->blockSize;
 
+   //The last block may be partial
+   if(length > 0)
+   {
+      //Compute O(j) = CIPH(T(j))
+      cipher->encryptBlock(context, t, o);
+      //Compute C(j) = P(j) XOR O(j)
+      cipherXorBlock(c, p, o, length);
       //Standard incrementing function
-      for(i = 0; i < m; i++)
-      {
-         //Increment the current byte and propagate the carry if necessary
-         if(++(t[cipher->blockSize - 1 - i]) != 0)
-            break;
-      }
-
-      //Next block
-      p += n;
-      c += n;
-      length -= n;
+      cipherAddCounter(t, cipher->blockSize, m, 1);
    }
 
    //Successful encryption
@@ -124,7 +119,6 @@ error_t ctrEncrypt(const CipherAlgo *cipher, void *context, uint_t m,
 error_t ctrDecrypt(const CipherAlgo *cipher, void *context, uint_t m,
    uint8_t *t, const uint8_t *c, uint8_t *p, size_t length)
 {
-   size_t i;
    size_t n;
    uint8_t o[16];
 
@@ -140,31 +134,26 @@ error_t ctrDecrypt(const CipherAlgo *cipher, void *context, uint_t m,
    if(m > cipher->blockSize)
       return ERROR_INVALID_PARAMETER;
 
-   //Process ciphertext
-   while(length > 0)
-   {
-      //CTR mode operates in a block-by-block fashion
-      n = min(length, cipher->blockSize);
+   //Number of complete blocks
+   n = length / cipher->blockSize;
 
-      //Compute O(j) = CIPH(T(j))
-      cipher->encryptBlock(context, t, o);
+   //Generate the key stream a batch of blocks at a time
+   cipherCtrBlocks(cipher, context, m, t, c, p, n);
 
-      //Compute P(j) = C(j) XOR T(j)
-      for(i = 0; i < n; i++)
-         p[i] = c[i] ^ o[i];
+   //Point to the last block
+   c += n * cipher->blockSize;
+   p += n * cipher->blockSize;
+   length -= n * cipher->blockSize;
 
+   //The last block may be partial
+   if(length > 0)
+   {
+      //Compute O(j) = CIPH(T(j))
+      cipher->encryptBlock(context, t, o);
+      //Compute P(j) = C(j) XOR O(j)
+      cipherXorBlock(p, c, o, length);
       //Standard incrementing function
-      for(i = 0; i < m; i++)
-      {
-         //Increment the current byte and propagate the carry if necessary
-         if(++(t[cipher->blockSize - 1 - i]) != 0)
-            break;
-      }
-
-      //Next block
-      c += n;
-      p += n;
-      length -= n;
+      cipherAddCounter(t, cipher->blockSize, m, 1);
    }
 
    //Successful encryption
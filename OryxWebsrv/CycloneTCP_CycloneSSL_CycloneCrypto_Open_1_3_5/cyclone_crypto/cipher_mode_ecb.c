@@ -40,12 +40,81 @@
 #include <string.h>
 #include "crypto.h"
 #include "cipher_mode_ecb.h"
+#include "cipher_mode_misc.h"
 #include "debug.h"
 
 //Check crypto library configuration
 #if (ECB_SUPPORT == ENABLED)
 
 
+/**
+ * @brief ECB job parameters
+ **/
+
+typedef struct
+{
+   const CipherAlgo *cipher;
+   void *context;
+   const uint8_t *input;
+   uint8_t *output;
+   size_t n;
+} EcbParams;
+
+
+/**
+ * @brief Encrypt a slice of an ECB job
+ * @param[in] param Pointer to the ECB job parameters
+ * @param[in] index Index of the current slice
+ * @param[in] count Total number of slices
+ **/
+
+static void ecbEncryptJob(void *param, uint_t index, uint_t count)
+{
+   size_t first;
+   size_t last;
+   EcbParams *params;
+
+   //Point to the job parameters
+   params = (EcbParams *) param;
+
+   //Blocks processed by the current slice
+   first = params->n * index / count;
+   last = params->n * (index + 1) / count;
+
+   //Encrypt the blocks
+   cipherEncryptBlocks(params->cipher, params->context,
+      params->input + first * params->cipher->blockSize,
+      params->output + first * params->cipher->blockSize, last - first);
+}
+
+
+/**
+ * @brief Decrypt a slice of an ECB job
+ * @param[in] param Pointer to the ECB job parameters
+ * @param[in] index Index of the current slice
+ * @param[in] count Total number of slices
+ **/
+
+static void ecbDecryptJob(void *param, uint_t index, uint_t count)
+{
+   size_t first;
+   size_t last;
+   EcbParams *params;
+
+   //Point to the job parameters
+   params = (EcbParams *) param;
+
+   //Blocks processed by the current slice
+   first = params->n * index / count;
+   last = params->n * (index + 1) / count;
+
+   //Decrypt the blocks
+   cipherDecryptBlocks(params->cipher, params->context,
+      params->input + first * params->cipher->blockSize,
+      params->output + first * params->cipher->blockSize, last - first);
+}
+
+
 /**
  * @brief ECB encryption
  * @param[in] cipher Cipher algorithm
@@ -59,20 +128,22 @@
 error_t ecbEncrypt(const CipherAlgo *cipher, void *context,
    const uint8_t *p, uint8_t *c, size_t length)
 {
-   //ECB mode operates in a block-by-block fashion
-   while(length >= cipher->blockSize)
-   {
-      //Encrypt current block
-      cipher->encryptBlock(context, p, c);
-
-      //Next block
-      p += cipher->blockSize;
-      c += cipher->blockSize;
-      length -= cipher->blockSize;
-   }
+   EcbParams params;
+
+   //Save job parameters
+   params.cipher = cipher;
+   params.context = context;
+   params.input = p;
+   params.output = c;
+   params.n = length / cipher->blockSize;
+
+   //Blocks are independent, so that large buffers can be split
+   //across the worker tasks
+   cipherModeRunJob(ecbEncryptJob, &params,
+      cipherModeGetSliceCount(params.n * cipher->blockSize));
 
    //The plaintext must be a multiple of the block size
-   if(length != 0)
+   if((length % cipher->blockSize) != 0)
       return ERROR_INVALID_LENGTH;
 
    //Successful encryption
@@ -93,23 +164,25 @@ error_t ecbEncrypt(const CipherAlgo *cipher, void *context,
 error_t ecbDecrypt(const CipherAlgo *cipher, void *context,
    const uint8_t *c, uint8_t *p, size_t length)
 {
-   //ECB mode operates in a block-by-block fashion
-   while(length >= cipher->blockSize)
-   {
-      //Decrypt current block
-      cipher->decryptBlock(context, c, p);
-
-      //Next block
-      c += cipher->blockSize;
-      p += cipher->blockSize;
-      length -= cipher->blockSize;
-   }
+   EcbParams params;
+
+   //Save job parameters
+   params.cipher = cipher;
+   params.context = context;
+   params.input = c;
+   params.output = p;
+   params.n = length / cipher->blockSize;
+
+   //Blocks are independent, so that large buffers can be split
+   //across the worker tasks
+   cipherModeRunJob(ecbDecryptJob, &params,
+      cipherModeGetSliceCount(params.n * cipher->blockSize));
 
    //The ciphertext must be a multiple of the block size
-   if(length != 0)
+   if((length % cipher->blockSize) != 0)
       return ERROR_INVALID_LENGTH;
 
-   //Successful encryption
+   //Successful decryption
    return NO_ERROR;
 }
 
@@ -39,11 +39,64 @@
 #include <string.h>
 #include "crypto.h"
 #include "cipher_mode_gcm.h"
+#include "cipher_mode_misc.h"
 #include "debug.h"
 
+//Carry-less multiplication intrinsics
+#if (GCM_PCLMUL_SUPPORT == ENABLED)
+   #include <wmmintrin.h>
+   #include <tmmintrin.h>
+#endif
+
 //Check crypto library configuration
 #if (GCM_SUPPORT == ENABLED)
 
+#if (GCM_PCLMUL_SUPPORT == DISABLED)
+
+//Reduction table used when the accumulator is multiplied by x^W
+static const uint32_t r[GCM_TABLE_N] =
+{
+#if (GCM_TABLE_W == 4)
+   0x00000000, 0x1C200000, 0x38400000, 0x24600000, 0x70800000, 0x6CA00000, 0x48C00000, 0x54E00000,
+   0xE1000000, 0xFD200000, 0xD9400000, 0xC5600000, 0x91800000, 0x8DA00000, 0xA9C00000, 0xB5E00000
+#else
+   0x00000000, 0x01C20000, 0x03840000, 0x02460000, 0x07080000, 0x06CA0000, 0x048C0000, 0x054E0000,
+   0x0E100000, 0x0FD20000, 0x0D940000, 0x0C560000, 0x09180000, 0x08DA0000, 0x0A9C0000, 0x0B5E0000,
+   0x1C200000, 0x1DE20000, 0x1FA40000, 0x1E660000, 0x1B280000, 0x1AEA0000, 0x18AC0000, 0x196E0000,
+   0x12300000, 0x13F20000, 0x11B40000, 0x10760000, 0x15380000, 0x14FA0000, 0x16BC0000, 0x177E0000,
+   0x38400000, 0x39820000, 0x3BC40000, 0x3A060000, 0x3F480000, 0x3E8A0000, 0x3CCC0000, 0x3D0E0000,
+   0x36500000, 0x37920000, 0x35D40000, 0x34160000, 0x31580000, 0x309A0000, 0x32DC0000, 0x331E0000,
+   0x24600000, 0x25A20000, 0x27E40000, 0x26260000, 0x23680000, 0x22AA0000, 0x20EC0000, 0x212E0000,
+   0x2A700000, 0x2BB20000, 0x29F40000, 0x28360000, 0x2D780000, 0x2CBA0000, 0x2EFC0000, 0x2F3E0000,
+   0x70800000, 0x71420000, 0x73040000, 0x72C60000, 0x77880000, 0x764A0000, 0x740C0000, 0x75CE0000,
+   0x7E900000, 0x7F520000, 0x7D140000, 0x7CD60000, 0x79980000, 0x785A0000, 0x7A1C0000, 0x7BDE0000,
+   0x6CA00000, 0x6D620000, 0x6F240000, 0x6EE60000, 0x6BA80000, 0x6A6A0000, 0x682C0000, 0x69EE0000,
+   0x62B00000, 0x63720000, 0x61340000, 0x60F60000, 0x65B80000, 0x647A0000, 0x663C0000, 0x67FE0000,
+   0x48C00000, 0x49020000, 0x4B440000, 0x4A860000, 0x4FC80000, 0x4E0A0000, 0x4C4C0000, 0x4D8E0000,
+   0x46D00000, 0x47120000, 0x45540000, 0x44960000, 0x41D80000, 0x401A0000, 0x425C0000, 0x439E0000,
+   0x54E00000, 0x55220000, 0x57640000, 0x56A60000, 0x53E80000, 0x522A0000, 0x506C0000, 0x51AE0000,
+   0x5AF00000, 0x5B320000, 0x59740000, 0x58B60000, 0x5DF80000, 0x5C3A0000, 0x5E7C0000, 0x5FBE0000,
+   0xE1000000, 0xE0C20000, 0xE2840000, 0xE3460000, 0xE6080000, 0xE7CA0000, 0xE58C0000, 0xE44E0000,
+   0xEF100000, 0xEED20000, 0xEC940000, 0xED560000, 0xE8180000, 0xE9DA0000, 0xEB9C0000, 0xEA5E0000,
+   0xFD200000, 0xFCE20000, 0xFEA40000, 0xFF660000, 0xFA280000, 0xFBEA0000, 0xF9AC0000, 0xF86E0000,
+   0xF3300000, 0xF2F20000, 0xF0B40000, 0xF1760000, 0xF4380000, 0xF5FA0000, 0xF7BC0000, 0xF67E0000,
+   0xD9400000, 0xD8820000, 0xDAC40000, 0xDB060000, 0xDE480000, 0xDF8A0000, 0xDDCC0000, 0xDC0E0000,
+   0xD7500000, 0xD6920000, 0xD4D40000, 0xD5160000, 0xD0580000, 0xD19A0000, 0xD3DC0000, 0xD21E0000,
+   0xC5600000, 0xC4A20000, 0xC6E40000, 0xC7260000, 0xC2680000, 0xC3AA0000, 0xC1EC0000, 0xC02E0000,
+   0xCB700000, 0xCAB20000, 0xC8F40000, 0xC9360000, 0xCC780000, 0xCDBA0000, 0xCFFC0000, 0xCE3E0000,
+   0x91800000, 0x90420000, 0x92040000, 0x93C60000, 0x96880000, 0x974A0000, 0x950C0000, 0x94CE0000,
+   0x9F900000, 0x9E520000, 0x9C140000, 0x9DD60000, 0x98980000, 0x995A0000, 0x9B1C0000, 0x9ADE0000,
+   0x8DA00000, 0x8C620000, 0x8E240000, 0x8FE60000, 0x8AA80000, 0x8B6A0000, 0x892C0000, 0x88EE0000,
+   0x83B00000, 0x82720000, 0x80340000, 0x81F60000, 0x84B80000, 0x857A0000, 0x873C0000, 0x86FE0000,
+   0xA9C00000, 0xA8020000, 0xAA440000, 0xAB860000, 0xAEC80000, 0xAF0A0000, 0xAD4C0000, 0xAC8E0000,
+   0xA7D00000, 0xA6120000, 0xA4540000, 0xA5960000, 0xA0D80000, 0xA11A0000, 0xA35C0000, 0xA29E0000,
+   0xB5E00000, 0xB4220000, 0xB6640000, 0xB7A60000, 0xB2E80000, 0xB32A0000, 0xB16C0000, 0xB0AE0000,
+   0xBBF00000, 0xBA320000, 0xB8740000, 0xB9B60000, 0xBCF80000, 0xBD3A0000, 0xBF7C0000, 0xBEBE0000
+#endif
+};
+
+#endif
+
 
 /**
  * @brief Authenticated encryption using GCM
@@ -64,199 +117,226 @@
 error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
    const uint8_t *a, size_t aLen, const uint8_t *p, uint8_t *c, size_t length, uint8_t *t, size_t tLen)
 {
-   size_t k;
-   size_t n;
-   uint8_t b[16];
-   uint8_t h[16];
-   uint8_t j[16];
-   uint8_t s[16];
-
-   //Check parameters
-   if(cipher == NULL || context == NULL)
-      return ERROR_INVALID_PARAMETER;
-
-   //GCM supports only symmetric block ciphers whose block size is 128 bits
-   if(cipher->type != CIPHER_ALGO_TYPE_BLOCK || cipher->blockSize != 16)
-      return ERROR_INVALID_PARAMETER;
+   error_t error;
+   GcmContext *gcmContext;
 
-   //The length of the IV shall meet SP 800-38D requirements
-   if(ivLen < 1)
-      return ERROR_INVALID_PARAMETER;
    //Check the length of the authentication tag
    if(tLen < 4 || tLen > 16)
       return ERROR_INVALID_PARAMETER;
 
-   //Generate the hash subkey H
-   memset(h, 0, 16 );
-   cipher->encryptBlock(context, h, h);
+   //Allocate a memory buffer to hold the GCM context
+   gcmContext = osMemAlloc(sizeof(GcmContext));
+   //Failed to allocate memory?
+   if(!gcmContext) return ERROR_OUT_OF_MEMORY;
 
-   //Check whether the length of the IV is 96 bits
-   if(ivLen == 12)
+   //Compute the hash subkey H
+   error = gcmInit(gcmContext, cipher, context);
+
+   //Check status code
+   if(!error)
    {
-      //When the length of the IV is 96 bits, the padding string is
-      //appended to the IV to form the pre-counter block
-      memcpy(j, iv, 12);
-      STORE32BE(1, j + 12);
+      //Form the pre-counter block
+      error = gcmStart(gcmContext, iv, ivLen);
    }
-   else
+
+   //Check status code
+   if(!error)
    {
-      //Initialize GHASH calculation
-      memset(j, 0, 16);
+      //Process additional data
+      gcmUpdateAad(gcmContext, a, aLen);
+      //Encrypt plaintext
+      gcmEncryptUpdate(gcmContext, p, c, length);
 
-      //Length of the IV
-      n = ivLen;
+      //Compute the authentication tag
+      error = gcmEncryptFinal(gcmContext, t, tLen);
+   }
 
-      //Process the initialization vector
-      while(n > 0)
-      {
-         //The IV processed in a block-by-block fashion
-         k = min(n, 16);
+   //Free previously allocated memory
+   osMemFree(gcmContext);
+   //Return status code
+   return error;
+}
 
-         //Apply GHASH function
-         gcmXorBlock(j, j, iv, k);
-         gcmMul(j, h);
 
-         //Next block
-         iv += k;
-         n -= k;
-      }
+/**
+ * @brief Authenticated decryption using GCM
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher algorithm context
+ * @param[in] iv Initialization vector
+ * @param[in] ivLen Length of the initialization vector
+ * @param[in] a Additional authenticated data
+ * @param[in] aLen Length of the additional data
+ * @param[in] c Ciphertext to be decrypted
+ * @param[out] p Plaintext resulting from the decryption
+ * @param[in] length Total number of data bytes to be decrypted
+ * @param[in] t Authentication tag
+ * @param[in] tLen Length of the authentication tag
+ * @return Error code
+ **/
 
-      //The string is appended with 64 additional 0 bits, followed by the
-      //64-bit representation of the length of the IV
-      memset(b, 0, 16);
-      STORE32BE(ivLen * 8, b + 12);
+error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
+   const uint8_t *a, size_t aLen, const uint8_t *c, uint8_t *p, size_t length, const uint8_t *t, size_t tLen)
+{
+   error_t error;
+   GcmContext *gcmContext;
 
-      //The GHASH function is applied to the resulting string to form the
-      //pre-counter block
-      gcmXorBlock(j, j, b, 16);
-      gcmMul(j, h);
-   }
+   //Check the length of the authentication tag
+   if(tLen < 4 || tLen > 16)
+      return ERROR_INVALID_PARAMETER;
 
-   //Compute MSB(CIPH(J(0)))
-   cipher->encryptBlock(context, j, b);
-   memcpy(t, b, tLen);
+   //Allocate a memory buffer to hold the GCM context
+   gcmContext = osMemAlloc(sizeof(GcmContext));
+   //Failed to allocate memory?
+   if(!gcmContext) return ERROR_OUT_OF_MEMORY;
 
-   //Initialize GHASH calculation
-   memset(s, 0, 16);
-   //Length of the AAD
-   n = aLen;
+   //Compute the hash subkey H
+   error = gcmInit(gcmContext, cipher, context);
 
-   //Process AAD
-   while(n > 0)
+   //Check status code
+   if(!error)
    {
-      //Additional data are processed in a block-by-block fashion
-      k = min(n, 16);
+      //Form the pre-counter block
+      error = gcmStart(gcmContext, iv, ivLen);
+   }
 
-      //Apply GHASH function
-      gcmXorBlock(s, s, a, k);
-      gcmMul(s, h);
+   //Check status code
+   if(!error)
+   {
+      //Process additional data
+      gcmUpdateAad(gcmContext, a, aLen);
+      //Decrypt ciphertext
+      gcmDecryptUpdate(gcmContext, c, p, length);
 
-      //Next block
-      a += k;
-      n -= k;
+      //Verify the authentication tag
+      error = gcmDecryptFinal(gcmContext, t, tLen);
    }
 
-   //Length of the plaintext
-   n = length;
+   //Free previously allocated memory
+   osMemFree(gcmContext);
+   //Return status code
+   return error;
+}
 
-   //Process plaintext
-   while(n > 0)
-   {
-      //The encryption operates in a block-by-block fashion
-      k = min(n, 16);
 
-      //Increment counter
-      gcmIncCounter(j);
+/**
+ * @brief Initialize a GCM context
+ *
+ * The hash subkey H is generated and the GHASH lookup table is computed.
+ * The cipher context must already hold the expanded key
+ *
+ * @param[out] context Pointer to the GCM context
+ * @param[in] cipher Cipher algorithm
+ * @param[in] cipherContext Cipher algorithm context
+ * @return Error code
+ **/
 
-      //Encrypt plaintext
-      cipher->encryptBlock(context, j, b);
-      gcmXorBlock(c, p, b, k);
+error_t gcmInit(GcmContext *context, const CipherAlgo *cipher, void *cipherContext)
+{
+   uint_t i;
+   uint8_t h[16];
+#if (GCM_PCLMUL_SUPPORT == DISABLED)
+   uint_t j;
+   uint32_t c;
+#endif
 
-      //Apply GHASH function
-      gcmXorBlock(s, s, c, k);
-      gcmMul(s, h);
+   //Check parameters
+   if(context == NULL || cipher == NULL || cipherContext == NULL)
+      return ERROR_INVALID_PARAMETER;
 
-      //Next block
-      p += k;
-      c += k;
-      n -= k;
-   }
+   //GCM supports only symmetric block ciphers whose block size is 128 bits
+   if(cipher->type != CIPHER_ALGO_TYPE_BLOCK || cipher->blockSize != 16)
+      return ERROR_INVALID_PARAMETER;
 
-   //Append the 64-bit representation of the length of the AAD and the ciphertext
-   memset(b, 0, 16);
-   STORE32BE(aLen * 8, b + 4);
-   STORE32BE(length * 8, b + 12);
+   //Save cipher algorithm
+   context->cipher = cipher;
+   context->cipherContext = cipherContext;
 
-   //The GHASH function is applied to the result to produce a single output block S
-   gcmXorBlock(s, s, b, 16);
-   gcmMul(s, h);
+   //Generate the hash subkey H
+   memset(h, 0, 16);
+   cipher->encryptBlock(cipherContext, h, h);
+
+#if (GCM_PCLMUL_SUPPORT == ENABLED)
+   //Store H with the bytes in reverse order, as expected by PCLMULQDQ
+   for(i = 0; i < 16; i++)
+      context->h[i] = h[15 - i];
+#else
+   //M[0] = 0
+   memset(context->m[0], 0, 16);
+
+   //The most significant bit of the index corresponds to x^0
+   j = GCM_TABLE_N / 2;
+
+   //M[N / 2] = H
+   context->m[j][0] = LOAD32BE(h);
+   context->m[j][1] = LOAD32BE(h + 4);
+   context->m[j][2] = LOAD32BE(h + 8);
+   context->m[j][3] = LOAD32BE(h + 12);
+
+   //Compute M[j / 2] = M[j] * x for the remaining powers of two
+   for(; j > 1; j /= 2)
+   {
+      //Check the coefficient of x^127 before shifting
+      c = (context->m[j][3] & 0x01) ? 0xE1000000 : 0;
+
+      //Multiply by x
+      context->m[j / 2][3] = (context->m[j][3] >> 1) | (context->m[j][2] << 31);
+      context->m[j / 2][2] = (context->m[j][2] >> 1) | (context->m[j][1] << 31);
+      context->m[j / 2][1] = (context->m[j][1] >> 1) | (context->m[j][0] << 31);
+      context->m[j / 2][0] = (context->m[j][0] >> 1) ^ c;
+   }
 
-   //Let T = MSB(GCTR(J(0), S)
-   gcmXorBlock(t, t, s, tLen);
+   //Multiplication is linear, so the other entries are sums of the
+   //entries already computed
+   for(i = 2; i < GCM_TABLE_N; i *= 2)
+   {
+      for(j = 1; j < i; j++)
+      {
+         context->m[i + j][0] = context->m[i][0] ^ context->m[j][0];
+         context->m[i + j][1] = context->m[i][1] ^ context->m[j][1];
+         context->m[i + j][2] = context->m[i][2] ^ context->m[j][2];
+         context->m[i + j][3] = context->m[i][3] ^ context->m[j][3];
+      }
+   }
+#endif
 
-   //Successful encryption
+   //Clear the hash subkey from the stack
+   memset(h, 0, 16);
+
+   //Successful initialization
    return NO_ERROR;
 }
 
 
 /**
- * @brief Authenticated decryption using GCM
- * @param[in] cipher Cipher algorithm
- * @param[in] context Cipher algorithm context
+ * @brief Start the encryption or decryption of a new message
+ * @param[in] context Pointer to the GCM context
  * @param[in] iv Initialization vector
  * @param[in] ivLen Length of the initialization vector
- * @param[in] a Additional authenticated data
- * @param[in] aLen Length of the additional data
- * @param[in] c Ciphertext to be decrypted
- * @param[out] p Plaintext resulting from the decryption
- * @param[in] length Total number of data bytes to be decrypted
- * @param[in] t Authentication tag
- * @param[in] tLen Length of the authentication tag
  * @return Error code
  **/
 
-error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
-   const uint8_t *a, size_t aLen, const uint8_t *c, uint8_t *p, size_t length, const uint8_t *t, size_t tLen)
+error_t gcmStart(GcmContext *context, const uint8_t *iv, size_t ivLen)
 {
    size_t k;
    size_t n;
    uint8_t b[16];
-   uint8_t h[16];
-   uint8_t j[16];
-   uint8_t r[16];
-   uint8_t s[16];
-
-   //Check parameters
-   if(cipher == NULL || context == NULL)
-      return ERROR_INVALID_PARAMETER;
-
-   //GCM supports only symmetric block ciphers whose block size is 128 bits
-   if(cipher->type != CIPHER_ALGO_TYPE_BLOCK || cipher->blockSize != 16)
-      return ERROR_INVALID_PARAMETER;
 
    //The length of the IV shall meet SP 800-38D requirements
    if(ivLen < 1)
       return ERROR_INVALID_PARAMETER;
-   //Check the length of the authentication tag
-   if(tLen < 4 || tLen > 16)
-      return ERROR_INVALID_PARAMETER;
-
-   //Generate the hash subkey H
-   memset(h, 0, 16 );
-   cipher->encryptBlock(context, h, h);
 
    //Check whether the length of the IV is 96 bits
    if(ivLen == 12)
    {
       //When the length of the IV is 96 bits, the padding string is
       //appended to the IV to form the pre-counter block
-      memcpy(j, iv, 12);
-      STORE32BE(1, j + 12);
+      memcpy(context->j, iv, 12);
+      STORE32BE(1, context->j + 12);
    }
    else
    {
       //Initialize GHASH calculation
-      memset(j, 0, 16);
+      memset(context->j, 0, 16);
 
       //Length of the IV
       n = ivLen;
@@ -268,8 +348,8 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
          k = min(n, 16);
 
          //Apply GHASH function
-         gcmXorBlock(j, j, iv, k);
-         gcmMul(j, h);
+         cipherXorBlock(context->j, context->j, iv, k);
+         gcmMul(context, context->j);
 
          //Next block
          iv += k;
@@ -283,156 +363,477 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 
       //The GHASH function is applied to the resulting string to form the
       //pre-counter block
-      gcmXorBlock(j, j, b, 16);
-      gcmMul(j, h);
+      cipherXorBlock(context->j, context->j, b, 16);
+      gcmMul(context, context->j);
    }
 
-   //Compute MSB(CIPH(J(0)))
-   cipher->encryptBlock(context, j, b);
-   memcpy(r, b, tLen);
+   //Compute CIPH(J(0)), which is used to mask the authentication tag
+   context->cipher->encryptBlock(context->cipherContext, context->j, context->t);
+   //The first counter block used for encryption is inc32(J(0))
+   gcmIncCounter(context->j);
 
    //Initialize GHASH calculation
-   memset(s, 0, 16);
-   //Length of the AAD
-   n = aLen;
+   memset(context->s, 0, 16);
+   context->aLen = 0;
+   context->cLen = 0;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process additional authenticated data
+ *
+ * This function can be called several times, but all the additional data
+ * must be supplied before the plaintext or the ciphertext
+ *
+ * @param[in] context Pointer to the GCM context
+ * @param[in] a Additional authenticated data
+ * @param[in] aLen Length of the additional data
+ **/
 
-   //Process AAD
-   while(n > 0)
+void gcmUpdateAad(GcmContext *context, const uint8_t *a, size_t aLen)
+{
+   size_t i;
+   size_t k;
+
+   //Process additional data
+   while(aLen > 0)
    {
+      //Current position in the GHASH block
+      i = context->aLen % 16;
       //Additional data are processed in a block-by-block fashion
-      k = min(n, 16);
+      k = min(aLen, 16 - i);
+
+      //Accumulate the additional data
+      cipherXorBlock(context->s + i, context->s + i, a, k);
+      context->aLen += k;
 
-      //Apply GHASH function
-      gcmXorBlock(s, s, a, k);
-      gcmMul(s, h);
+      //Apply GHASH function once a complete block is available
+      if((context->aLen % 16) == 0)
+         gcmMul(context, context->s);
 
       //Next block
       a += k;
-      n -= k;
+      aLen -= k;
    }
+}
+
 
-   //Length of the ciphertext
-   n = length;
+/**
+ * @brief Encrypt a part of the message
+ *
+ * This function can be called several times with any length
+ *
+ * @param[in] context Pointer to the GCM context
+ * @param[in] p Plaintext to be encrypted
+ * @param[out] c Ciphertext resulting from the encryption
+ * @param[in] length Number of data bytes to be encrypted
+ **/
+
+void gcmEncryptUpdate(GcmContext *context, const uint8_t *p, uint8_t *c, size_t length)
+{
+   size_t i;
+   size_t k;
+   size_t n;
+
+   //Process plaintext
+   while(length > 0)
+   {
+      //Current position in the key stream block
+      i = context->cLen % 16;
+
+      //Start of a new block?
+      if(i == 0)
+      {
+         //The last block of additional data is padded with zeroes
+         if(context->cLen == 0 && (context->aLen % 16) != 0)
+            gcmMul(context, context->s);
+
+         //Number of complete blocks
+         n = length / 16;
+
+         //Complete blocks are processed in bulk
+         if(n > 0)
+         {
+            //Encrypt the plaintext a batch of blocks at a time
+            cipherCtrBlocks(context->cipher, context->cipherContext, 4,
+               context->j, p, c, n);
+
+            //Accumulate the ciphertext
+            for(i = 0; i < n; i++)
+            {
+               //Apply GHASH function
+               cipherXorBlock(context->s, context->s, c + i * 16, 16);
+               gcmMul(context, context->s);
+            }
+
+            //Next blocks
+            context->cLen += n * 16;
+            p += n * 16;
+            c += n * 16;
+            length -= n * 16;
+            continue;
+         }
+
+         //Generate the key stream block for the last partial block
+         context->cipher->encryptBlock(context->cipherContext, context->j, context->k);
+         //Increment counter
+         gcmIncCounter(context->j);
+      }
+
+      //The encryption operates in a block-by-block fashion
+      k = min(length, 16 - i);
+
+      //Encrypt plaintext
+      cipherXorBlock(c, p, context->k + i, k);
+      //Accumulate the ciphertext
+      cipherXorBlock(context->s + i, context->s + i, c, k);
+      context->cLen += k;
+
+      //Apply GHASH function once a complete block is available
+      if((context->cLen % 16) == 0)
+         gcmMul(context, context->s);
+
+      //Next block
+      p += k;
+      c += k;
+      length -= k;
+   }
+}
+
+
+/**
+ * @brief Decrypt a part of the message
+ *
+ * This function can be called several times with any length
+ *
+ * @param[in] context Pointer to the GCM context
+ * @param[in] c Ciphertext to be decrypted
+ * @param[out] p Plaintext resulting from the decryption
+ * @param[in] length Number of data bytes to be decrypted
+ **/
+
+void gcmDecryptUpdate(GcmContext *context, const uint8_t *c, uint8_t *p, size_t length)
+{
+   size_t i;
+   size_t k;
+   size_t n;
 
    //Process ciphertext
-   while(n > 0)
+   while(length > 0)
    {
-      //The decryption operates in a block-by-block fashion
-      k = min(n, 16);
+      //Current position in the key stream block
+      i = context->cLen % 16;
 
-      //Apply GHASH function
-      gcmXorBlock(s, s, c, k);
-      gcmMul(s, h);
+      //Start of a new block?
+      if(i == 0)
+      {
+         //The last block of additional data is padded with zeroes
+         if(context->cLen == 0 && (context->aLen % 16) != 0)
+            gcmMul(context, context->s);
+
+         //Number of complete blocks
+         n = length / 16;
+
+         //Complete blocks are processed in bulk
+         if(n > 0)
+         {
+            //Accumulate the ciphertext
+            for(i = 0; i < n; i++)
+            {
+               //Apply GHASH function
+               cipherXorBlock(context->s, context->s, c + i * 16, 16);
+               gcmMul(context, context->s);
+            }
+
+            //Decrypt the ciphertext a batch of blocks at a time
+            cipherCtrBlocks(context->cipher, context->cipherContext, 4,
+               context->j, c, p, n);
+            //Next blocks
+            context->cLen += n * 16;
+            c += n * 16;
+            p += n * 16;
+            length -= n * 16;
+            continue;
+         }
+
+         //Generate the key stream block for the last partial block
+         context->cipher->encryptBlock(context->cipherContext, context->j, context->k);
+         //Increment counter
+         gcmIncCounter(context->j);
+      }
 
-      //Increment counter
-      gcmIncCounter(j);
+      //The decryption operates in a block-by-block fashion
+      k = min(length, 16 - i);
 
+      //Accumulate the ciphertext
+      cipherXorBlock(context->s + i, context->s + i, c, k);
       //Decrypt ciphertext
-      cipher->encryptBlock(context, j, b);
-      gcmXorBlock(p, c, b, k);
+      cipherXorBlock(p, c, context->k + i, k);
+      context->cLen += k;
+
+      //Apply GHASH function once a complete block is available
+      if((context->cLen % 16) == 0)
+         gcmMul(context, context->s);
 
       //Next block
       c += k;
       p += k;
-      n -= k;
+      length -= k;
    }
+}
+
+
+/**
+ * @brief Complete the GHASH computation
+ * @param[in] context Pointer to the GCM context
+ **/
+
+static void gcmFinal(GcmContext *context)
+{
+   uint8_t b[16];
+
+   //The last partial block of additional data or ciphertext is padded
+   //with zeroes
+   if((context->cLen == 0 && (context->aLen % 16) != 0) || (context->cLen % 16) != 0)
+      gcmMul(context, context->s);
 
    //Append the 64-bit representation of the length of the AAD and the ciphertext
-   memset(b, 0, 16);
-   STORE32BE(aLen * 8, b + 4);
-   STORE32BE(length * 8, b + 12);
+   STORE32BE((uint32_t) (context->aLen >> 29), b);
+   STORE32BE((uint32_t) (context->aLen << 3), b + 4);
+   STORE32BE((uint32_t) (context->cLen >> 29), b + 8);
+   STORE32BE((uint32_t) (context->cLen << 3), b + 12);
 
    //The GHASH function is applied to the result to produce a single output block S
-   gcmXorBlock(s, s, b, 16);
-   gcmMul(s, h);
+   cipherXorBlock(context->s, context->s, b, 16);
+   gcmMul(context, context->s);
 
-   //Let R = MSB(GCTR(J(0), S)
-   gcmXorBlock(r, r, s, tLen);
+   //Let S = GCTR(J(0), S)
+   cipherXorBlock(context->s, context->s, context->t, 16);
+}
 
-   //Verify the authentication tag
-   if(memcmp(r, t, tLen))
-      return ERROR_FAILURE;
 
-   //Successful decryption
+/**
+ * @brief Compute the authentication tag of the encrypted message
+ * @param[in] context Pointer to the GCM context
+ * @param[out] t Authentication tag
+ * @param[in] tLen Length of the authentication tag
+ * @return Error code
+ **/
+
+error_t gcmEncryptFinal(GcmContext *context, uint8_t *t, size_t tLen)
+{
+   //Check the length of the authentication tag
+   if(tLen < 4 || tLen > 16)
+      return ERROR_INVALID_PARAMETER;
+
+   //Complete the GHASH computation
+   gcmFinal(context);
+   //Let T = MSB(GCTR(J(0), S)
+   memcpy(t, context->s, tLen);
+
+   //Successful encryption
    return NO_ERROR;
 }
 
 
 /**
- * @brief Multiplication operation
- * @param[in, out] x First block
- * @param[in] y Second block
+ * @brief Verify the authentication tag of the decrypted message
+ * @param[in] context Pointer to the GCM context
+ * @param[in] t Authentication tag
+ * @param[in] tLen Length of the authentication tag
+ * @return Error code
  **/
 
-void gcmMul(uint8_t *x, const uint8_t *y)
+error_t gcmDecryptFinal(GcmContext *context, const uint8_t *t, size_t tLen)
 {
    size_t i;
-   uint8_t z[16];
-   uint8_t v[16];
+   uint8_t mask;
 
-   //Let Z(0) = 0
-   memset(z, 0, 16);
-   //Let V(0) = Y
-   memcpy(v, y, 16);
+   //Check the length of the authentication tag
+   if(tLen < 4 || tLen > 16)
+      return ERROR_INVALID_PARAMETER;
 
-   //Iterate 128 times
-   for(i = 0; i < 128; i++)
-   {
-      if(x[i / 8] & (0x80 >> (i % 8)))
-      {
-         gcmXorBlock(z, z, v, 16);
-      }
+   //Complete the GHASH computation
+   gcmFinal(context);
 
-      if(v[15] & 0x01)
-      {
-         gcmShiftBlock(v);
-         v[0] ^= 0xE1;
-      }
-      else
-      {
-         gcmShiftBlock(v);
-      }
-   }
+   //Compare MSB(GCTR(J(0), S) with the received tag in constant time
+   for(mask = 0, i = 0; i < tLen; i++)
+      mask |= context->s[i] ^ t[i];
 
-   //Copy the resulting block
-   memcpy(x, z, 16);
+   //Verify the authentication tag
+   if(mask != 0)
+      return ERROR_FAILURE;
+
+   //Successful decryption
+   return NO_ERROR;
 }
 
 
+#if (GCM_PCLMUL_SUPPORT == ENABLED)
+
 /**
- * @brief XOR operation
- * @param[out] a Block resulting from the XOR operation
- * @param[in] b First block
- * @param[in] c Second block
- * @param[in] n Size of the block
+ * @brief Multiplication operation in GF(2^128)
+ *
+ * The 256-bit carry-less product is computed with PCLMULQDQ and then
+ * reduced modulo x^128 + x^7 + x^2 + x + 1. Refer to Intel's white paper
+ * "Carry-Less Multiplication and Its Usage for Computing the GCM Mode"
+ *
+ * @param[in] context Pointer to the GCM context
+ * @param[in, out] x Block to be multiplied by H
  **/
 
-void gcmXorBlock(uint8_t *a, const uint8_t *b, const uint8_t *c, size_t n)
+void gcmMul(GcmContext *context, uint8_t *x)
 {
-   size_t i;
+   __m128i a;
+   __m128i b;
+   __m128i t2;
+   __m128i t3;
+   __m128i t4;
+   __m128i t5;
+   __m128i t6;
+   __m128i t7;
+   __m128i t8;
+   __m128i t9;
+   __m128i mask;
+
+   //GCM uses a reflected bit order
+   mask = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+   a = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) x), mask);
+   b = _mm_loadu_si128((__m128i *) context->h);
+
+   //Compute the 256-bit carry-less product T6:T3
+   t3 = _mm_clmulepi64_si128(a, b, 0x00);
+   t4 = _mm_clmulepi64_si128(a, b, 0x10);
+   t5 = _mm_clmulepi64_si128(a, b, 0x01);
+   t6 = _mm_clmulepi64_si128(a, b, 0x11);
+   t4 = _mm_xor_si128(t4, t5);
+   t5 = _mm_slli_si128(t4, 8);
+   t4 = _mm_srli_si128(t4, 8);
+   t3 = _mm_xor_si128(t3, t5);
+   t6 = _mm_xor_si128(t6, t4);
+
+   //Shift the product left by one bit to account for the reflection
+   t7 = _mm_srli_epi32(t3, 31);
+   t8 = _mm_srli_epi32(t6, 31);
+   t3 = _mm_slli_epi32(t3, 1);
+   t6 = _mm_slli_epi32(t6, 1);
+   t9 = _mm_srli_si128(t7, 12);
+   t8 = _mm_slli_si128(t8, 4);
+   t7 = _mm_slli_si128(t7, 4);
+   t3 = _mm_or_si128(t3, t7);
+   t6 = _mm_or_si128(t6, t8);
+   t6 = _mm_or_si128(t6, t9);
+
+   //First phase of the reduction
+   t7 = _mm_slli_epi32(t3, 31);
+   t8 = _mm_slli_epi32(t3, 30);
+   t9 = _mm_slli_epi32(t3, 25);
+   t7 = _mm_xor_si128(t7, t8);
+   t7 = _mm_xor_si128(t7, t9);
+   t8 = _mm_srli_si128(t7, 4);
+   t7 = _mm_slli_si128(t7, 12);
+   t3 = _mm_xor_si128(t3, t7);
+
+   //Second phase of the reduction
+   t2 = _mm_srli_epi32(t3, 1);
+   t4 = _mm_srli_epi32(t3, 2);
+   t5 = _mm_srli_epi32(t3, 7);
+   t2 = _mm_xor_si128(t2, t4);
+   t2 = _mm_xor_si128(t2, t5);
+   t2 = _mm_xor_si128(t2, t8);
+   t3 = _mm_xor_si128(t3, t2);
+   t6 = _mm_xor_si128(t6, t3);
 
-   //Perform XOR operation
-   for(i = 0; i < n; i++)
-      a[i] = b[i] ^ c[i];
+   //Copy the resulting block
+   _mm_storeu_si128((__m128i *) x, _mm_shuffle_epi8(t6, mask));
 }
 
+#else
 
 /**
- * @brief Shift operation
- * @param[in,out] a Block to be shifted
+ * @brief Multiplication operation in GF(2^128)
+ *
+ * X is processed W bits at a time using Horner's rule, starting with the
+ * coefficients of highest degree. At each step, the accumulator is
+ * multiplied by x^W and the precalculated multiple of H is added
+ *
+ * @param[in] context Pointer to the GCM context
+ * @param[in, out] x Block to be multiplied by H
  **/
 
-void gcmShiftBlock(uint8_t *a)
+void gcmMul(GcmContext *context, uint8_t *x)
 {
-   size_t i;
+   int_t i;
+   uint_t b;
+   uint_t c;
+   uint32_t z[4];
+
+   //Let Z = 0
+   z[0] = 0;
+   z[1] = 0;
+   z[2] = 0;
+   z[3] = 0;
+
+   //Process the bytes of X in reverse order
+   for(i = 15; i >= 0; i--)
+   {
+#if (GCM_TABLE_W == 4)
+      //Process the least significant nibble first
+      b = x[i] & 0x0F;
+
+      //Multiply Z by x^4
+      c = z[3] & 0x0F;
+      z[3] = (z[3] >> 4) | (z[2] << 28);
+      z[2] = (z[2] >> 4) | (z[1] << 28);
+      z[1] = (z[1] >> 4) | (z[0] << 28);
+      z[0] = (z[0] >> 4) ^ r[c];
+
+      //Add the corresponding multiple of H
+      z[0] ^= context->m[b][0];
+      z[1] ^= context->m[b][1];
+      z[2] ^= context->m[b][2];
+      z[3] ^= context->m[b][3];
+
+      //Then process the most significant nibble
+      b = (x[i] >> 4) & 0x0F;
+
+      //Multiply Z by x^4
+      c = z[3] & 0x0F;
+      z[3] = (z[3] >> 4) | (z[2] << 28);
+      z[2] = (z[2] >> 4) | (z[1] << 28);
+      z[1] = (z[1] >> 4) | (z[0] << 28);
+      z[0] = (z[0] >> 4) ^ r[c];
+#else
+      //Process the whole byte at once
+      b = x[i];
+
+      //Multiply Z by x^8
+      c = z[3] & 0xFF;
+      z[3] = (z[3] >> 8) | (z[2] << 24);
+      z[2] = (z[2] >> 8) | (z[1] << 24);
+      z[1] = (z[1] >> 8) | (z[0] << 24);
+      z[0] = (z[0] >> 8) ^ r[c];
+#endif
 
-   //Shift the block to the right
-   for(i = 0; i < 15; i++)
-      a[15 - i] = (a[15 - i] >> 1) | (a[14 - i] << 7);
+      //Add the corresponding multiple of H
+      z[0] ^= context->m[b][0];
+      z[1] ^= context->m[b][1];
+      z[2] ^= context->m[b][2];
+      z[3] ^= context->m[b][3];
+   }
 
-   a[0] = (a[0] >> 1);
+   //Copy the resulting block
+   STORE32BE(z[0], x);
+   STORE32BE(z[1], x + 4);
+   STORE32BE(z[2], x + 8);
+   STORE32BE(z[3], x + 12);
 }
 
+#endif
+
 
 /**
  * @brief Increment counter block
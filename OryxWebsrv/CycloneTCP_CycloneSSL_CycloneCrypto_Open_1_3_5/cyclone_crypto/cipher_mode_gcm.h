@@ -32,6 +32,57 @@
 //Dependencies
 #include "crypto.h"
 
+//Size of the GHASH lookup table (4-bit or 8-bit multipliers). The table
+//is part of GcmContext and takes 256 bytes with 4-bit multipliers, against
+//4 KB with 8-bit multipliers. gcmEncrypt and gcmDecrypt allocate their
+//context from the heap, but a context declared by the caller for the
+//incremental API has the same size
+#ifndef GCM_TABLE_W
+   #define GCM_TABLE_W 4
+#elif (GCM_TABLE_W != 4 && GCM_TABLE_W != 8)
+   #error GCM_TABLE_W parameter is invalid
+#endif
+
+//Carry-less multiplication instruction support (x86 hosts)
+#ifndef GCM_PCLMUL_SUPPORT
+   #define GCM_PCLMUL_SUPPORT DISABLED
+#elif (GCM_PCLMUL_SUPPORT != ENABLED && GCM_PCLMUL_SUPPORT != DISABLED)
+   #error GCM_PCLMUL_SUPPORT parameter is invalid
+#elif (GCM_PCLMUL_SUPPORT == ENABLED && (!defined(__PCLMUL__) || !defined(__SSSE3__)))
+   #error GCM_PCLMUL_SUPPORT requires the PCLMULQDQ and SSSE3 instruction sets (-mpclmul -mssse3)
+#endif
+
+//Number of entries of the GHASH lookup table
+#define GCM_TABLE_N (1 << GCM_TABLE_W)
+
+
+/**
+ * @brief GCM context
+ *
+ * The hash subkey H and the associated lookup table only depend on the key,
+ * so the context can be reused for any number of messages once gcmInit has
+ * been called
+ *
+ **/
+
+typedef struct
+{
+   const CipherAlgo *cipher;   ///<Cipher algorithm
+   void *cipherContext;        ///<Cipher algorithm context
+#if (GCM_PCLMUL_SUPPORT == ENABLED)
+   uint8_t h[16];              ///<Hash subkey H (byte-reversed)
+#else
+   uint32_t m[GCM_TABLE_N][4]; ///<Precalculated multiples of H
+#endif
+   uint8_t j[16];              ///<Next counter block
+   uint8_t s[16];              ///<GHASH accumulator
+   uint8_t t[16];              ///<Encrypted pre-counter block
+   uint8_t k[16];              ///<Current key stream block
+   uint64_t aLen;              ///<Length of the additional data
+   uint64_t cLen;              ///<Length of the ciphertext
+} GcmContext;
+
+
 //GCM related functions
 error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
    const uint8_t *a, size_t aLen, const uint8_t *p, uint8_t *c, size_t length, uint8_t *t, size_t tLen);
@@ -39,9 +90,15 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
    const uint8_t *a, size_t aLen, const uint8_t *c, uint8_t *p, size_t length, const uint8_t *t, size_t tLen);
 
-void gcmMul(uint8_t *x, const uint8_t *y);
-void gcmXorBlock(uint8_t *a, const uint8_t *b, const uint8_t *c, size_t n);
-void gcmShiftBlock(uint8_t *a);
+error_t gcmInit(GcmContext *context, const CipherAlgo *cipher, void *cipherContext);
+error_t gcmStart(GcmContext *context, const uint8_t *iv, size_t ivLen);
+void gcmUpdateAad(GcmContext *context, const uint8_t *a, size_t aLen);
+void gcmEncryptUpdate(GcmContext *context, const uint8_t *p, uint8_t *c, size_t length);
+void gcmDecryptUpdate(GcmContext *context, const uint8_t *c, uint8_t *p, size_t length);
+error_t gcmEncryptFinal(GcmContext *context, uint8_t *t, size_t tLen);
+error_t gcmDecryptFinal(GcmContext *context, const uint8_t *t, size_t tLen);
+
+void gcmMul(GcmContext *context, uint8_t *x);
 void gcmIncCounter(uint8_t *a);
 
 #endif
@@ -0,0 +1,523 @@
+/**
+ * @file cipher_mode_misc.c
+ * @brief Helper functions for block cipher modes of operation
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The modes of operation hand several blocks at a time to the underlying
+ * cipher and combine them with the data using word-wise XOR operations.
+ * When CIPHER_MODE_WORKER_SUPPORT is enabled, the modes whose blocks are
+ * independent (ECB, CTR, GCM and CBC decryption) also split large buffers
+ * across a pool of worker tasks. The cipher context is then shared by
+ * several tasks, which is safe since block encryption and decryption
+ * never modify it
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "crypto.h"
+#include "cipher_mode_misc.h"
+#include "debug.h"
+
+
+/**
+ * @brief CTR job parameters
+ **/
+
+typedef struct
+{
+   const CipherAlgo *cipher;
+   void *context;
+   uint_t m;
+   const uint8_t *t;
+   const uint8_t *input;
+   uint8_t *output;
+   size_t n;
+} CipherCtrParams;
+
+
+#if (CIPHER_MODE_WORKER_SUPPORT == ENABLED)
+
+//The worker tasks are running
+static bool_t cipherModeWorkerReady = FALSE;
+//Mutex preventing concurrent jobs
+static OsMutex *cipherModeMutex;
+//Semaphore used to wake up the worker tasks
+static OsSemaphore *cipherModeStartSemaphore;
+//Semaphore used to signal the completion of a slice
+static OsSemaphore *cipherModeDoneSemaphore;
+
+//Job being processed
+static CipherModeJob cipherModeJob;
+static void *cipherModeParam;
+static uint_t cipherModeCount;
+//Number of slices already assigned
+static uint32_t cipherModeIndex;
+
+#endif
+
+
+/**
+ * @brief XOR operation
+ *
+ * The operation is performed a word at a time when the three buffers are
+ * 32-bit aligned
+ *
+ * @param[out] a Block resulting from the XOR operation
+ * @param[in] b First block
+ * @param[in] c Second block
+ * @param[in] n Size of the block
+ **/
+
+void cipherXorBlock(uint8_t *a, const uint8_t *b, const uint8_t *c, size_t n)
+{
+   size_t i;
+
+   //Clear index
+   i = 0;
+
+   //Check the alignment of the buffers
+   if(!(((uintptr_t) a | (uintptr_t) b | (uintptr_t) c) & 3))
+   {
+      //Process the data a word at a time
+      for(; (i + 4) <= n; i += 4)
+         *((uint32_t *) (a + i)) = *((uint32_t *) (b + i)) ^ *((uint32_t *) (c + i));
+   }
+
+   //Process the remaining bytes
+   for(; i < n; i++)
+      a[i] = b[i] ^ c[i];
+}
+
+
+/**
+ * @brief Encrypt consecutive blocks
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher algorithm context
+ * @param[in] input Blocks to encrypt
+ * @param[out] output Blocks resulting from the encryption
+ * @param[in] n Number of blocks
+ **/
+
+void cipherEncryptBlocks(const CipherAlgo *cipher, void *context,
+   const uint8_t *input, uint8_t *output, size_t n)
+{
+   //Check whether the cipher can process several blocks at a time
+   if(cipher->encryptBlocks != NULL)
+   {
+      //Encrypt all the blocks at once
+      cipher->encryptBlocks(context, input, output, n);
+   }
+   else
+   {
+      //Process each block
+      while(n > 0)
+      {
+         //Encrypt current block
+         cipher->encryptBlock(context, input, output);
+
+         //Next block
+         input += cipher->blockSize;
+         output += cipher->blockSize;
+         n--;
+      }
+   }
+}
+
+
+/**
+ * @brief Decrypt consecutive blocks
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher algorithm context
+ * @param[in] input Blocks to decrypt
+ * @param[out] output Blocks resulting from the decryption
+ * @param[in] n Number of blocks
+ **/
+
+void cipherDecryptBlocks(const CipherAlgo *cipher, void *context,
+   const uint8_t *input, uint8_t *output, size_t n)
+{
+   //Check whether the cipher can process several blocks at a time
+   if(cipher->decryptBlocks != NULL)
+   {
+      //Decrypt all the blocks at once
+      cipher->decryptBlocks(context, input, output, n);
+   }
+   else
+   {
+      //Process each block
+      while(n > 0)
+      {
+         //Decrypt current block
+         cipher->decryptBlock(context, input, output);
+
+         //Next block
+         input += cipher->blockSize;
+         output += cipher->blockSize;
+         n--;
+      }
+   }
+}
+
+
+/**
+ * @brief Generate and apply CTR key stream, one batch of blocks at a time
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher algorithm context
+ * @param[in] m Size in bytes of the specific part of the block to be incremented
+ * @param[in,out] t Counter block
+ * @param[in] input Data to be processed
+ * @param[out] output Resulting data
+ * @param[in] n Number of blocks
+ **/
+
+static void cipherCtrBatch(const CipherAlgo *cipher, void *context, uint_t m,
+   uint8_t *t, const uint8_t *input, uint8_t *output, size_t n)
+{
+   size_t i;
+   size_t k;
+   uint32_t o[CIPHER_MODE_BATCH_SIZE * 4];
+
+   //Process the blocks
+   while(n > 0)
+   {
+      //Number of blocks in the current batch
+      k = min(n, CIPHER_MODE_BATCH_SIZE);
+
+      //Form the counter blocks T(j) to T(j + k - 1)
+      for(i = 0; i < k; i++)
+      {
+         memcpy((uint8_t *) o + i * cipher->blockSize, t, cipher->blockSize);
+         cipherAddCounter(t, cipher->blockSize, m, 1);
+      }
+
+      //Compute O(j) = CIPH(T(j)) for the whole batch
+      cipherEncryptBlocks(cipher, context, (uint8_t *) o, (uint8_t *) o, k);
+      //XOR the data with the key stream
+      cipherXorBlock(output, input, (uint8_t *) o, k * cipher->blockSize);
+
+      //Next batch
+      input += k * cipher->blockSize;
+      output += k * cipher->blockSize;
+      n -= k;
+   }
+}
+
+
+/**
+ * @brief Process a slice of a CTR job
+ * @param[in] param Pointer to the CTR job parameters
+ * @param[in] index Index of the current slice
+ * @param[in] count Total number of slices
+ **/
+
+static void cipherCtrJob(void *param, uint_t index, uint_t count)
+{
+   size_t first;
+   size_t last;
+   uint8_t t[16];
+   CipherCtrParams *params;
+
+   //Point to the job parameters
+   params = (CipherCtrParams *) param;
+
+   //Blocks processed by the current slice
+   first = params->n * index / count;
+   last = params->n * (index + 1) / count;
+
+   //Compute the value of the counter for the first block of the slice
+   memcpy(t, params->t, params->cipher->blockSize);
+   cipherAddCounter(t, params->cipher->blockSize, params->m, first);
+
+   //Process the slice
+   cipherCtrBatch(params->cipher, params->context, params->m, t,
+      params->input + first * params->cipher->blockSize,
+      params->output + first * params->cipher->blockSize, last - first);
+}
+
+
+/**
+ * @brief Apply CTR key stream to consecutive blocks
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher algorithm context
+ * @param[in] m Size in bytes of the specific part of the block to be incremented
+ * @param[in,out] t Counter block, updated to the value following the last block
+ * @param[in] input Data to be processed
+ * @param[out] output Resulting data
+ * @param[in] n Number of blocks
+ **/
+
+void cipherCtrBlocks(const CipherAlgo *cipher, void *context, uint_t m,
+   uint8_t *t, const uint8_t *input, uint8_t *output, size_t n)
+{
+   uint_t count;
+   CipherCtrParams params;
+
+   //Large buffers may be split across the worker tasks
+   count = cipherModeGetSliceCount(n * cipher->blockSize);
+
+   //Parallel processing?
+   if(count > 1)
+   {
+      //Save job parameters
+      params.cipher = cipher;
+      params.context = context;
+      params.m = m;
+      params.t = t;
+      params.input = input;
+      params.output = output;
+      params.n = n;
+
+      //Each slice computes its own counter blocks
+      cipherModeRunJob(cipherCtrJob, &params, count);
+      //Update the counter
+      cipherAddCounter(t, cipher->blockSize, m, n);
+   }
+   else
+   {
+      //Process the blocks sequentially
+      cipherCtrBatch(cipher, context, m, t, input, output, n);
+   }
+}
+
+
+/**
+ * @brief Add a value to the counter block
+ *
+ * The specific part of the counter block is interpreted as a big-endian
+ * integer modulo 2^(8 * m)
+ *
+ * @param[in,out] t Counter block
+ * @param[in] blockSize Size of the counter block
+ * @param[in] m Size in bytes of the specific part of the block to be incremented
+ * @param[in] n Value to add
+ **/
+
+void cipherAddCounter(uint8_t *t, size_t blockSize, uint_t m, size_t n)
+{
+   uint_t i;
+
+   //Propagate the carry as long as necessary
+   for(i = 0; i < m && n != 0; i++)
+   {
+      //Add the current byte
+      n += t[blockSize - 1 - i];
+      //Update the counter block
+      t[blockSize - 1 - i] = n & 0xFF;
+      //Carry
+      n >>= 8;
+   }
+}
+
+
+#if (CIPHER_MODE_WORKER_SUPPORT == ENABLED)
+
+/**
+ * @brief Worker task
+ * @param[in] param Unused parameter
+ **/
+
+static void cipherModeWorkerTask(void *param)
+{
+   uint_t index;
+
+   //Endless loop
+   while(1)
+   {
+      //Wait for a slice to be assigned
+      osSemaphoreWait(cipherModeStartSemaphore, INFINITE_DELAY);
+
+      //Get the index of the slice
+      index = osAtomicInc32(&cipherModeIndex) - 1;
+      //Process the slice
+      cipherModeJob(cipherModeParam, index, cipherModeCount);
+
+      //Notify the task that has submitted the job
+      osSemaphoreRelease(cipherModeDoneSemaphore);
+   }
+}
+
+
+/**
+ * @brief Start the worker tasks
+ *
+ * This function is optional. As long as it is not called, all the data
+ * are processed by the calling task
+ *
+ * @return Error code
+ **/
+
+error_t cipherModeWorkerInit(void)
+{
+   uint_t i;
+   OsTask *task;
+
+   //The worker tasks are already running?
+   if(cipherModeWorkerReady)
+      return NO_ERROR;
+
+   //Create a mutex to serialize the jobs
+   cipherModeMutex = osMutexCreate(FALSE);
+   //Failed to create mutex?
+   if(cipherModeMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Create the semaphores used to dispatch the slices
+   cipherModeStartSemaphore = osSemaphoreCreate(CIPHER_MODE_WORKER_COUNT, 0);
+   cipherModeDoneSemaphore = osSemaphoreCreate(CIPHER_MODE_WORKER_COUNT, 0);
+   //Failed to create semaphores?
+   if(cipherModeStartSemaphore == OS_INVALID_HANDLE ||
+      cipherModeDoneSemaphore == OS_INVALID_HANDLE)
+   {
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Create the worker tasks
+   for(i = 0; i < CIPHER_MODE_WORKER_COUNT; i++)
+   {
+      task = osTaskCreate("Cipher Worker", cipherModeWorkerTask, NULL,
+         CIPHER_MODE_WORKER_STACK_SIZE, CIPHER_MODE_WORKER_PRIORITY);
+      //Unable to create the task?
+      if(task == OS_INVALID_HANDLE)
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //The worker tasks can now be used
+   cipherModeWorkerReady = TRUE;
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Determine how many slices a buffer should be split into
+ * @param[in] length Length of the buffer, in bytes
+ * @return Number of slices
+ **/
+
+uint_t cipherModeGetSliceCount(size_t length)
+{
+   //Small buffers are processed by the calling task alone
+   if(!cipherModeWorkerReady || length < CIPHER_MODE_WORKER_THRESHOLD)
+      return 1;
+
+   //The calling task processes one slice
+   return CIPHER_MODE_WORKER_COUNT + 1;
+}
+
+
+/**
+ * @brief Run a job split into several slices
+ *
+ * The first slice is processed by the calling task while the others are
+ * assigned to the worker tasks. The function returns when all the slices
+ * have been processed
+ *
+ * @param[in] job Function that processes a slice
+ * @param[in] param Parameters shared by all the slices
+ * @param[in] count Number of slices (as returned by cipherModeGetSliceCount)
+ **/
+
+void cipherModeRunJob(CipherModeJob job, void *param, uint_t count)
+{
+   uint_t i;
+
+   //Sequential processing?
+   if(count <= 1)
+   {
+      job(param, 0, 1);
+      return;
+   }
+
+   //Only one job can be dispatched at a time
+   osMutexAcquire(cipherModeMutex);
+
+   //Save job parameters
+   cipherModeJob = job;
+   cipherModeParam = param;
+   cipherModeCount = count;
+   //The first slice is reserved for the calling task
+   cipherModeIndex = 1;
+
+   //Wake up the worker tasks
+   for(i = 1; i < count; i++)
+      osSemaphoreRelease(cipherModeStartSemaphore);
+
+   //Process the first slice
+   job(param, 0, count);
+
+   //Wait for the worker tasks to complete
+   for(i = 1; i < count; i++)
+      osSemaphoreWait(cipherModeDoneSemaphore, INFINITE_DELAY);
+
+   //Release exclusive access
+   osMutexRelease(cipherModeMutex);
+}
+
+#else
+
+/**
+ * @brief Start the worker tasks
+ * @return Error code
+ **/
+
+error_t cipherModeWorkerInit(void)
+{
+   //Worker tasks are not supported
+   return ERROR_NOT_IMPLEMENTED;
+}
+
+
+/**
+ * @brief Determine how many slices a buffer should be split into
+ * @param[in] length Length of the buffer, in bytes
+ * @return Number of slices
+ **/
+
+uint_t cipherModeGetSliceCount(size_t length)
+{
+   //All the data are processed by the calling task
+   return 1;
+}
+
+
+/**
+ * @brief Run a job split into several slices
+ * @param[in] job Function that processes a slice
+ * @param[in] param Parameters shared by all the slices
+ * @param[in] count Number of slices
+ **/
+
+void cipherModeRunJob(CipherModeJob job, void *param, uint_t count)
+{
+   //Process the whole job in the calling task
+   job(param, 0, 1);
+}
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file cipher_mode_misc.h
+ * @brief Helper functions for block cipher modes of operation
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _BLOCK_CIPHER_MODE_MISC_H
+#define _BLOCK_CIPHER_MODE_MISC_H
+
+//Dependencies
+#include "crypto.h"
+
+//Number of blocks processed per iteration
+#ifndef CIPHER_MODE_BATCH_SIZE
+   #define CIPHER_MODE_BATCH_SIZE 8
+#elif (CIPHER_MODE_BATCH_SIZE < 1 || CIPHER_MODE_BATCH_SIZE > 16)
+   #error CIPHER_MODE_BATCH_SIZE parameter is invalid
+#endif
+
+//Worker tasks that process large buffers in parallel
+#ifndef CIPHER_MODE_WORKER_SUPPORT
+   #define CIPHER_MODE_WORKER_SUPPORT DISABLED
+#elif (CIPHER_MODE_WORKER_SUPPORT != ENABLED && CIPHER_MODE_WORKER_SUPPORT != DISABLED)
+   #error CIPHER_MODE_WORKER_SUPPORT parameter is invalid
+#endif
+
+//Number of worker tasks
+#ifndef CIPHER_MODE_WORKER_COUNT
+   #define CIPHER_MODE_WORKER_COUNT 3
+#elif (CIPHER_MODE_WORKER_COUNT < 1 || CIPHER_MODE_WORKER_COUNT > 15)
+   #error CIPHER_MODE_WORKER_COUNT parameter is invalid
+#endif
+
+//Minimum length of the buffers that are split across the worker tasks
+#ifndef CIPHER_MODE_WORKER_THRESHOLD
+   #define CIPHER_MODE_WORKER_THRESHOLD 65536
+#elif (CIPHER_MODE_WORKER_THRESHOLD < 256)
+   #error CIPHER_MODE_WORKER_THRESHOLD parameter is invalid
+#endif
+
+//Stack size required to run the worker tasks
+#ifndef CIPHER_MODE_WORKER_STACK_SIZE
+   #define CIPHER_MODE_WORKER_STACK_SIZE 500
+#elif (CIPHER_MODE_WORKER_STACK_SIZE < 1)
+   #error CIPHER_MODE_WORKER_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the worker tasks should run
+#ifndef CIPHER_MODE_WORKER_PRIORITY
+   #define CIPHER_MODE_WORKER_PRIORITY 1
+#elif (CIPHER_MODE_WORKER_PRIORITY < 0)
+   #error CIPHER_MODE_WORKER_PRIORITY parameter is invalid
+#endif
+
+
+/**
+ * @brief Slice of a job
+ * @param[in] param Parameters shared by all the slices
+ * @param[in] index Index of the current slice
+ * @param[in] count Total number of slices
+ **/
+
+typedef void (*CipherModeJob)(void *param, uint_t index, uint_t count);
+
+
+//Block cipher modes related functions
+void cipherXorBlock(uint8_t *a, const uint8_t *b, const uint8_t *c, size_t n);
+
+void cipherEncryptBlocks(const CipherAlgo *cipher, void *context,
+   const uint8_t *input, uint8_t *output, size_t n);
+
+void cipherDecryptBlocks(const CipherAlgo *cipher, void *context,
+   const uint8_t *input, uint8_t *output, size_t n);
+
+void cipherCtrBlocks(const CipherAlgo *cipher, void *context, uint_t m,
+   uint8_t *t, const uint8_t *input, uint8_t *output, size_t n);
+
+void cipherAddCounter(uint8_t *t, size_t blockSize, uint_t m, size_t n);
+
+error_t cipherModeWorkerInit(void);
+uint_t cipherModeGetSliceCount(size_t length);
+void cipherModeRunJob(CipherModeJob job, void *param, uint_t count);
+
+#endif
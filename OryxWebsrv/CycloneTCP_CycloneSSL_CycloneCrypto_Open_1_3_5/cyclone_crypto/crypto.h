@@ -253,7 +253,9 @@
 #endif
 
 //Maximum context size (hash functions)
-#if (SHA512_SUPPORT == ENABLED)
+#if (WHIRLPOOL_SUPPORT == ENABLED)
+   #define MAX_HASH_CONTEXT_SIZE sizeof(WhirlpoolContext)
+#elif (SHA512_SUPPORT == ENABLED)
    #define MAX_HASH_CONTEXT_SIZE sizeof(Sha512Context)
 #elif (SHA384_SUPPORT == ENABLED)
    #define MAX_HASH_CONTEXT_SIZE sizeof(Sha384Context)
@@ -261,8 +263,6 @@
    #define MAX_HASH_CONTEXT_SIZE sizeof(Sha512_256Context)
 #elif (SHA512_224_SUPPORT == ENABLED)
    #define MAX_HASH_CONTEXT_SIZE sizeof(Sha512_224Context)
-#elif (WHIRLPOOL_SUPPORT == ENABLED)
-   #define MAX_HASH_CONTEXT_SIZE sizeof(WhirlpoolContext)
 #elif (SHA256_SUPPORT == ENABLED)
    #define MAX_HASH_CONTEXT_SIZE sizeof(Sha256Context)
 #elif (SHA224_SUPPORT == ENABLED)
@@ -400,6 +400,8 @@ typedef void (*CipherAlgoEncryptStream)(void *context, const uint8_t *input, uin
 typedef void (*CipherAlgoDecryptStream)(void *context, const uint8_t *input, uint8_t *output, size_t length);
 typedef void (*CipherAlgoEncryptBlock)(void *context, const uint8_t *input, uint8_t *output);
 typedef void (*CipherAlgoDecryptBlock)(void *context, const uint8_t *input, uint8_t *output);
+typedef void (*CipherAlgoEncryptBlocks)(void *context, const uint8_t *input, uint8_t *output, size_t n);
+typedef void (*CipherAlgoDecryptBlocks)(void *context, const uint8_t *input, uint8_t *output, size_t n);
 
 //Common API for pseudo-random number generators
 typedef error_t (*PrngAlgoInit)(void *context);
@@ -453,6 +455,8 @@ typedef struct
    CipherAlgoDecryptStream decryptStream;
    CipherAlgoEncryptBlock encryptBlock;
    CipherAlgoDecryptBlock decryptBlock;
+   CipherAlgoEncryptBlocks encryptBlocks;
+   CipherAlgoDecryptBlocks decryptBlocks;
 } CipherAlgo;
 
 
@@ -55,6 +55,10 @@ void dhInitParameters(DhParameters *params)
    mpiInit(&params->xa);
    mpiInit(&params->ya);
    mpiInit(&params->yb);
+
+   //Initialize precomputed data
+   mpiMontgomeryInit(&params->pContext);
+   mpiCombInit(&params->gComb);
 }
 
 
@@ -71,6 +75,48 @@ void dhFreeParameters(DhParameters *params)
    mpiFree(&params->xa);
    mpiFree(&params->ya);
    mpiFree(&params->yb);
+
+   //Free precomputed data
+   mpiMontgomeryFree(&params->pContext);
+   mpiCombFree(&params->gComb);
+}
+
+
+/**
+ * @brief Update the Montgomery context of the prime modulus
+ *
+ * The context is only recomputed when the prime modulus has been
+ * modified since the previous call
+ *
+ * @param[in,out] params Pointer to the Diffie-Hellman parameters
+ * @return Error code
+ **/
+
+static error_t dhUpdateMontgomeryContext(DhParameters *params)
+{
+   error_t error;
+
+   //Montgomery arithmetic requires an odd modulus
+   if(mpiIsEven(&params->p))
+   {
+      //Invalidate precomputed data
+      params->pContext.k = 0;
+      params->gComb.d = 0;
+      //Plain modular arithmetic will be used instead
+      return NO_ERROR;
+   }
+
+   //The context is still valid?
+   if(params->pContext.k && !mpiComp(&params->pContext.p, &params->p))
+      return NO_ERROR;
+
+   //The comb depends on the modulus as well
+   params->gComb.d = 0;
+
+   //Precompute R^2 mod p
+   error = mpiMontgomerySetModulus(&params->pContext, &params->p);
+   //Return status code
+   return error;
 }
 
 
@@ -113,8 +159,34 @@ error_t dhGenerateKeyPair(DhParameters *params, const PrngAlgo *prngAlgo, void *
    TRACE_DEBUG("  Private value:\r\n");
    TRACE_DEBUG_MPI("    ", &params->xa);
 
-   //Calculate the corresponding public value (ya = g ^ xa mod p)
-   error = mpiExpMod(&params->ya, &params->g, &params->xa, &params->p);
+   //Update the Montgomery context if necessary
+   error = dhUpdateMontgomeryContext(params);
+   //Any error to report?
+   if(error) return error;
+
+   //The generator is the same for every key pair, so that its powers
+   //can be precomputed once and for all
+   if(params->pContext.k)
+   {
+      //The comb has to be recomputed?
+      if(!params->gComb.d || mpiComp(&params->gComb.g, &params->g) ||
+         (params->gComb.d * MPI_COMB_TEETH) < k)
+      {
+         //Precompute the powers of the generator
+         error = mpiCombSetBase(&params->gComb, &params->g, k, &params->pContext);
+         //Any error to report?
+         if(error) return error;
+      }
+
+      //Calculate the corresponding public value (ya = g ^ xa mod p)
+      error = mpiCombExpMod(&params->ya, &params->gComb, &params->xa, &params->pContext);
+   }
+   else
+   {
+      //Calculate the corresponding public value (ya = g ^ xa mod p)
+      error = mpiExpMod(&params->ya, &params->g, &params->xa, &params->p);
+   }
+
    //Any error to report?
    if(error) return error;
 
@@ -198,10 +270,19 @@ error_t dhComputeSharedSecret(DhParameters *params,
    //Start of exception handling block
    do
    {
+      //Update the Montgomery context if necessary
+      error = dhUpdateMontgomeryContext(params);
+      //Any error to report?
+      if(error) break;
+
       //Calculate the shared secret key (k = yb ^ xa mod p)
-      error = mpiExpMod(&z, &params->yb, &params->xa, &params->p);
+      if(params->pContext.k)
+         error = mpiExpModMontgomery(&z, &params->yb, &params->xa, &params->pContext);
+      else
+         error = mpiExpMod(&z, &params->yb, &params->xa, &params->p);
+
       //Any error to report?
-      if(error) return error;
+      if(error) break;
 
       //Convert the resulting integer to an octet string
       error = mpiWriteRaw(&z, output, k);
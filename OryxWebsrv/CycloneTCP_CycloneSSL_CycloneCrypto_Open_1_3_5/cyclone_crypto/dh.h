@@ -45,6 +45,8 @@ typedef struct
    Mpi xa; ///<Out private value
    Mpi ya; ///<Our public value
    Mpi yb; ///<Peer's public value
+   MpiMontgomeryContext pContext; ///<Montgomery context for the prime modulus
+   MpiCombContext gComb;          ///<Fixed-base comb for the generator
 } DhParameters;
 
 
@@ -960,20 +960,20 @@ error_t mpiShiftRight(Mpi *x, uint_t n)
 }
 
 
-#define ADDC(x, a, c) \
-   x += c; \
-   if((x) != 0) c = 0; \
-   x += a; \
-   if((x) < (a)) c = 1
+/**
+ * @brief Multiple precision multiplication
+ * @param[out] x Resulting product A*B
+ * @param[in] a First operand A
+ * @param[in] b Second operand B
+ * @return Error code
+ **/
 
 error_t mpiMul(Mpi *x, const Mpi *a, const Mpi *b)
 {
    error_t error;
-   int_t i;
-   int_t k;
-   int_t m;
-   int_t n;
-   uint64_t p;
+   uint_t i;
+   uint_t m;
+   uint_t n;
    Mpi ta;
    Mpi tb;
 
@@ -1024,16 +1024,11 @@ error_t mpiMul(Mpi *x, const Mpi *a, const Mpi *b)
    //Clear the contents of X
    memset(x->data, 0, x->size * MPI_INT_SIZE);
 
-   for(k = 0; k <= (m + n - 2); k++)
+   //The product is computed one row at a time
+   for(i = 0; i < m; i++)
    {
-      for(i = max(k - n + 1, 0); i <= min(k, m - 1); i++)
-      {
-         uint_t c = 0;
-         p = (uint64_t) a->data[i] * b->data[k - i];
-         ADDC(x->data[k], (uint32_t ) p, c);
-         ADDC(x->data[k + 1], (uint32_t) (p >> 32), c);
-         ADDC(x->data[k + 2], 0, c);
-      }
+      //Compute X = X + A[i] * B * 2^(32 * i)
+      mpiMulAccCore(x->data + i, b->data, n, a->data[i]);
    }
 
    //Release previously allocated memory
@@ -1262,15 +1257,13 @@ error_t mpiExpMod(Mpi *x, const Mpi *a, const Mpi *e, const Mpi *p)
 {
    error_t error;
    int_t i;
-   uint_t k;
    Mpi b;
-   Mpi y;
-   Mpi r2;
+   MpiMontgomeryContext context;
 
-   //Initialize multiple precision integers
+   //Initialize multiple precision integer
    mpiInit(&b);
-   mpiInit(&y);
-   mpiInit(&r2);
+   //Initialize Montgomery context
+   mpiMontgomeryInit(&context);
 
    if(mpiIsEven(p))
    {
@@ -1294,51 +1287,482 @@ error_t mpiExpMod(Mpi *x, const Mpi *a, const Mpi *e, const Mpi *p)
    }
    else
    {
-      //Compute the smaller R = (2^32)^k such as R > P
-      k = mpiGetLength(p);
+      //Precompute R^2 mod P
+      MPI_CHECK(mpiMontgomerySetModulus(&context, p));
+      //Sliding window exponentiation in the Montgomery domain
+      MPI_CHECK(mpiExpModMontgomery(x, a, e, &context));
+   }
+
+end:
+   //Release multiple precision integer
+   mpiFree(&b);
+   //Release Montgomery context
+   mpiMontgomeryFree(&context);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Initialize a Montgomery context
+ * @param[in] context Pointer to the Montgomery context to initialize
+ **/
+
+void mpiMontgomeryInit(MpiMontgomeryContext *context)
+{
+   //The context is not bound to any modulus yet
+   context->k = 0;
+   //Initialize multiple precision integers
+   mpiInit(&context->p);
+   mpiInit(&context->r2);
+}
+
+
+/**
+ * @brief Release a Montgomery context
+ * @param[in] context Pointer to the Montgomery context to free
+ **/
+
+void mpiMontgomeryFree(MpiMontgomeryContext *context)
+{
+   //Free multiple precision integers
+   mpiFree(&context->p);
+   mpiFree(&context->r2);
+   //The context is no longer valid
+   context->k = 0;
+}
+
+
+/**
+ * @brief Bind a Montgomery context to a given modulus
+ *
+ * R^2 mod P only depends on the modulus, hence it can be computed once
+ * and then reused for any number of modular exponentiations
+ *
+ * @param[in,out] context Pointer to the Montgomery context
+ * @param[in] p Odd modulus P
+ * @return Error code
+ **/
+
+error_t mpiMontgomerySetModulus(MpiMontgomeryContext *context, const Mpi *p)
+{
+   error_t error;
+
+   //The modulus shall be positive and odd
+   if(mpiCompInt(p, 0) <= 0 || mpiIsEven(p))
+      return ERROR_INVALID_PARAMETER;
+
+   //Invalidate the context until it is fully initialized
+   context->k = 0;
+
+   //Start of exception handling block
+   do
+   {
+      //Save a copy of the modulus
+      error = mpiCopy(&context->p, p);
+      //Any error to report?
+      if(error) break;
+
+      //Compute R^2 mod P, where R = (2^32)^k is the smaller power such as R > P
+      error = mpiSetValue(&context->r2, 1);
+      //Any error to report?
+      if(error) break;
+
+      error = mpiShiftLeft(&context->r2, 2 * mpiGetLength(p) * (MPI_INT_SIZE * 8));
+      //Any error to report?
+      if(error) break;
+
+      error = mpiMod(&context->r2, &context->r2, p);
+      //Any error to report?
+      if(error) break;
+
+      //The context is now ready to use
+      context->k = mpiGetLength(p);
+
+      //End of exception handling block
+   } while(0);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Convert an integer to Montgomery form (X = A * R mod P)
+ * @param[out] x Resulting value X
+ * @param[in] a Non-negative integer A
+ * @param[in] context Pointer to the Montgomery context
+ * @param[in,out] t Workspace
+ * @return Error code
+ **/
+
+static error_t mpiMontgomeryConvert(Mpi *x, const Mpi *a,
+   const MpiMontgomeryContext *context, Mpi *t)
+{
+   error_t error;
+
+   //The Montgomery multiplication requires A to be less than P
+   if(mpiComp(a, &context->p) >= 0)
+   {
+      //Reduce A modulo P
+      error = mpiMod(x, a, &context->p);
+      //Any error to report?
+      if(error) return error;
+
+      //Compute X = A * R^2 * R^-1 mod P
+      return mpiMontgomeryMul(x, x, &context->r2, context->k, &context->p, t);
+   }
+   else
+   {
+      //Compute X = A * R^2 * R^-1 mod P
+      return mpiMontgomeryMul(x, a, &context->r2, context->k, &context->p, t);
+   }
+}
+
 
-      //Compute R^2 mod P
-      MPI_CHECK(mpiSetValue(&r2, 1));
-      MPI_CHECK(mpiShiftLeft(&r2, 2 * k * (MPI_INT_SIZE * 8)));
-      MPI_CHECK(mpiMod(&r2, &r2, p));
+/**
+ * @brief Select the size of the window for a given exponent
+ * @param[in] n Length of the exponent, in bits
+ * @return Window size, in bits
+ **/
+
+static uint_t mpiGetWindowSize(uint_t n)
+{
+   uint_t w;
+
+   //The optimal size balances the cost of the precomputation
+   //against the number of multiplications saved while scanning
+   if(n > 671)
+      w = 6;
+   else if(n > 239)
+      w = 5;
+   else if(n > 79)
+      w = 4;
+   else if(n > 23)
+      w = 3;
+   else if(n > 6)
+      w = 2;
+   else
+      w = 1;
 
-      //Compute B = A * R mod P
-      if(mpiComp(a, p) >= 0)
+   //Enforce the maximum window size
+   return min(w, MPI_EXP_WINDOW_SIZE);
+}
+
+
+/**
+ * @brief Modular exponentiation using a precomputed Montgomery context
+ *
+ * The exponent is scanned from left to right with a sliding window. The
+ * odd powers A, A^3, ..., A^(2^w - 1) are precomputed, so that a single
+ * multiplication is required for each window of w bits
+ *
+ * @param[out] x Resulting value X = A ^ E mod P
+ * @param[in] a Non-negative base A
+ * @param[in] e Non-negative exponent E
+ * @param[in] context Montgomery context bound to the modulus P
+ * @return Error code
+ **/
+
+error_t mpiExpModMontgomery(Mpi *x, const Mpi *a, const Mpi *e, const MpiMontgomeryContext *context)
+{
+   error_t error;
+   int_t i;
+   int_t j;
+   uint_t n;
+   uint_t u;
+   uint_t w;
+   bool_t first;
+   Mpi b[1 << (MPI_EXP_WINDOW_SIZE - 1)];
+   Mpi c;
+   Mpi y;
+   Mpi t;
+
+   //Make sure the Montgomery context is valid
+   if(!context->k)
+      return ERROR_INVALID_PARAMETER;
+
+   //Get the length of the exponent, in bits
+   n = mpiGetBitLength(e);
+   //Select the most suitable window size
+   w = mpiGetWindowSize(n);
+
+   //Initialize multiple precision integers
+   for(i = 0; i < (1 << (MPI_EXP_WINDOW_SIZE - 1)); i++)
+      mpiInit(&b[i]);
+
+   mpiInit(&c);
+   mpiInit(&y);
+   mpiInit(&t);
+
+   //Compute B[0] = A * R mod P
+   MPI_CHECK(mpiMontgomeryConvert(&b[0], a, context, &t));
+
+   //Precompute the odd powers of A
+   if(w > 1)
+   {
+      //Compute C = A^2 * R mod P
+      MPI_CHECK(mpiMontgomerySqr(&c, &b[0], context->k, &context->p, &t));
+
+      //Compute B[i] = A^(2 * i + 1) * R mod P
+      for(i = 1; i < (1 << (w - 1)); i++)
       {
-         MPI_CHECK(mpiMod(&b, a, p));
-         MPI_CHECK(mpiMontgomeryMul(&b, &b, &r2, k, p));
+         MPI_CHECK(mpiMontgomeryMul(&b[i], &b[i - 1], &c,
+            context->k, &context->p, &t));
+      }
+   }
+
+   //Compute Y = R mod P
+   MPI_CHECK(mpiCopy(&y, &context->r2));
+   MPI_CHECK(mpiMontgomeryRed(&y, context->k, &context->p));
+
+   //Y is still equal to 1
+   first = TRUE;
+
+   //Scan the exponent from the most significant bit
+   for(i = n - 1; i >= 0; )
+   {
+      //Zero bits are processed one at a time
+      if(!mpiGetBitValue(e, i))
+      {
+         //Compute Y = Y^2 * R^-1 mod P
+         MPI_CHECK(mpiMontgomerySqr(&y, &y, context->k, &context->p, &t));
+         //Next bit
+         i--;
       }
       else
       {
-         MPI_CHECK(mpiMontgomeryMul(&b, a, &r2, k, p));
+         //Find the longest window that ends with a non-zero bit
+         for(j = max(i - (int_t) w + 1, 0); !mpiGetBitValue(e, j); j++);
+
+         //Retrieve the (odd) value of the window
+         for(u = 0; i >= j; i--)
+         {
+            u = (u << 1) | mpiGetBitValue(e, i);
+
+            //Compute Y = Y^2 * R^-1 mod P
+            if(!first)
+            {
+               MPI_CHECK(mpiMontgomerySqr(&y, &y, context->k, &context->p, &t));
+            }
+         }
+
+         //The first window does not require any multiplication
+         if(first)
+         {
+            //Let Y = A^u * R mod P
+            MPI_CHECK(mpiCopy(&y, &b[u >> 1]));
+            first = FALSE;
+         }
+         else
+         {
+            //Compute Y = Y * A^u * R^-1 mod P
+            MPI_CHECK(mpiMontgomeryMul(&y, &y, &b[u >> 1],
+               context->k, &context->p, &t));
+         }
       }
+   }
 
-      //Compute X = R mod P
-      MPI_CHECK(mpiCopy(&y, &r2));
-      MPI_CHECK(mpiMontgomeryRed(&y, k, p));
+   //Compute X = Y * R^-1 mod P
+   MPI_CHECK(mpiMontgomeryRed(&y, context->k, &context->p));
+   MPI_CHECK(mpiCopy(x, &y));
 
-      for(i = mpiGetBitLength(e) - 1; i >= 0; i--)
+end:
+   //Release multiple precision integers
+   for(i = 0; i < (1 << (MPI_EXP_WINDOW_SIZE - 1)); i++)
+      mpiFree(&b[i]);
+
+   mpiFree(&c);
+   mpiFree(&y);
+   mpiFree(&t);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Initialize a fixed-base comb
+ * @param[in] comb Pointer to the comb to initialize
+ **/
+
+void mpiCombInit(MpiCombContext *comb)
+{
+   uint_t i;
+
+   //The comb is not bound to any base yet
+   comb->d = 0;
+
+   //Initialize multiple precision integers
+   mpiInit(&comb->g);
+
+   for(i = 0; i < (1 << MPI_COMB_TEETH); i++)
+      mpiInit(&comb->table[i]);
+}
+
+
+/**
+ * @brief Release a fixed-base comb
+ * @param[in] comb Pointer to the comb to free
+ **/
+
+void mpiCombFree(MpiCombContext *comb)
+{
+   uint_t i;
+
+   //Free multiple precision integers
+   mpiFree(&comb->g);
+
+   for(i = 0; i < (1 << MPI_COMB_TEETH); i++)
+      mpiFree(&comb->table[i]);
+
+   //The comb is no longer valid
+   comb->d = 0;
+}
+
+
+/**
+ * @brief Precompute a fixed-base comb
+ *
+ * The exponent is split into h blocks of d bits. The table holds the
+ * 2^h products of G^(2^(j * d)), 0 <= j < h, in Montgomery form. Each
+ * column of the exponent is then processed with a single squaring and
+ * a single multiplication
+ *
+ * @param[in,out] comb Pointer to the comb
+ * @param[in] g Non-negative base G
+ * @param[in] n Maximum length of the exponents, in bits
+ * @param[in] context Montgomery context bound to the modulus P
+ * @return Error code
+ **/
+
+error_t mpiCombSetBase(MpiCombContext *comb, const Mpi *g, uint_t n,
+   const MpiMontgomeryContext *context)
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   uint_t d;
+   Mpi t;
+
+   //Check parameters
+   if(!context->k || !n)
+      return ERROR_INVALID_PARAMETER;
+
+   //Invalidate the comb until it is fully initialized
+   comb->d = 0;
+   //Number of bits handled by each tooth
+   d = (n + MPI_COMB_TEETH - 1) / MPI_COMB_TEETH;
+
+   //Initialize multiple precision integer
+   mpiInit(&t);
+
+   //Save a copy of the base
+   MPI_CHECK(mpiCopy(&comb->g, g));
+
+   //The first entry is R mod P
+   MPI_CHECK(mpiCopy(&comb->table[0], &context->r2));
+   MPI_CHECK(mpiMontgomeryRed(&comb->table[0], context->k, &context->p));
+
+   //Compute G * R mod P
+   MPI_CHECK(mpiMontgomeryConvert(&comb->table[1], g, context, &t));
+
+   //Process each tooth
+   for(j = 0; j < MPI_COMB_TEETH; j++)
+   {
+      if(j > 0)
       {
-         //Compute X = X^2 * R^-1 mod P
-         MPI_CHECK(mpiMontgomeryMul(&y, &y, &y, k, p));
+         //Compute G^(2^(j * d)) * R mod P
+         MPI_CHECK(mpiMontgomerySqr(&comb->table[1 << j], &comb->table[1 << (j - 1)],
+            context->k, &context->p, &t));
 
-         if(mpiGetBitValue(e, i))
+         for(i = 1; i < d; i++)
          {
-            //Compute X = X * B * R^-1 mod P
-            MPI_CHECK(mpiMontgomeryMul(&y, &y, &b, k, p));
+            MPI_CHECK(mpiMontgomerySqr(&comb->table[1 << j], &comb->table[1 << j],
+               context->k, &context->p, &t));
          }
       }
 
-      //Compute X = X * R^-1 mod N
-      MPI_CHECK(mpiMontgomeryRed(&y, k, p));
-      MPI_CHECK(mpiCopy(x, &y));
+      //Combine the new tooth with the previous entries
+      for(i = 1; i < (1U << j); i++)
+      {
+         MPI_CHECK(mpiMontgomeryMul(&comb->table[(1 << j) + i], &comb->table[1 << j],
+            &comb->table[i], context->k, &context->p, &t));
+      }
+   }
+
+   //The comb is now ready to use
+   comb->d = d;
+
+end:
+   //Release multiple precision integer
+   mpiFree(&t);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Fixed-base modular exponentiation
+ * @param[out] x Resulting value X = G ^ E mod P
+ * @param[in] comb Comb precomputed for the base G
+ * @param[in] e Non-negative exponent E
+ * @param[in] context Montgomery context bound to the modulus P
+ * @return Error code
+ **/
+
+error_t mpiCombExpMod(Mpi *x, const MpiCombContext *comb, const Mpi *e,
+   const MpiMontgomeryContext *context)
+{
+   error_t error;
+   int_t i;
+   int_t j;
+   uint_t u;
+   Mpi y;
+   Mpi t;
+
+   //Make sure the comb and the Montgomery context are valid
+   if(!comb->d || !context->k)
+      return ERROR_INVALID_PARAMETER;
+   //The exponent shall not exceed the capacity of the comb
+   if(mpiGetBitLength(e) > (comb->d * MPI_COMB_TEETH))
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize multiple precision integers
+   mpiInit(&y);
+   mpiInit(&t);
+
+   //Let Y = R mod P
+   MPI_CHECK(mpiCopy(&y, &comb->table[0]));
+
+   //Process the columns of the exponent, starting with the leftmost one
+   for(i = comb->d - 1; i >= 0; i--)
+   {
+      //Compute Y = Y^2 * R^-1 mod P
+      MPI_CHECK(mpiMontgomerySqr(&y, &y, context->k, &context->p, &t));
+
+      //Gather the bits of the current column
+      for(u = 0, j = MPI_COMB_TEETH - 1; j >= 0; j--)
+         u = (u << 1) | mpiGetBitValue(e, j * comb->d + i);
+
+      //Compute Y = Y * Table[u] * R^-1 mod P
+      if(u)
+      {
+         MPI_CHECK(mpiMontgomeryMul(&y, &y, &comb->table[u],
+            context->k, &context->p, &t));
+      }
    }
 
+   //Compute X = Y * R^-1 mod P
+   MPI_CHECK(mpiMontgomeryRed(&y, context->k, &context->p));
+   MPI_CHECK(mpiCopy(x, &y));
+
 end:
    //Release multiple precision integers
-   mpiFree(&b);
    mpiFree(&y);
-   mpiFree(&r2);
+   mpiFree(&t);
 
    //Return status code
    return error;
@@ -1346,89 +1770,296 @@ end:
 
 
 /**
- * @brief Montgomery multiplication (X = A * B / 2^k mod P)
+ * @brief Compute the Montgomery factor -1/P[0] mod 2^32
+ * @param[in] p Odd modulus
+ * @return Montgomery factor
  **/
 
-error_t mpiMontgomeryMul(Mpi *x, const Mpi *a, const Mpi *b, uint_t k, const Mpi *p)
+static uint_t mpiMontgomeryFactor(const Mpi *p)
+{
+   uint_t i;
+   uint_t m;
+
+   //Any odd number is its own inverse mod 2^3. Newton's method then
+   //doubles the number of correct bits at each iteration
+   for(m = p->data[0], i = 0; i < 4; i++)
+      m = m * (2 - m * p->data[0]);
+
+   //Return -1/P[0] mod 2^32
+   return ~m + 1;
+}
+
+
+/**
+ * @brief Final step of the Montgomery multiplication
+ * @param[out] x Resulting value T / 2^(32 * k) mod P
+ * @param[in] t Pointer to the (2 * k + 1)-word result of the reduction
+ * @param[in] k Number of words of the modulus
+ * @param[in] p Modulus P
+ * @return Error code
+ **/
+
+static error_t mpiMontgomeryFinal(Mpi *x, const uint_t *t, uint_t k, const Mpi *p)
 {
    error_t error;
 
-   //Perform Montgomery multiplication
-   MPI_CHECK(mpiMul(x, a, b));
-   MPI_CHECK(mpiMontgomeryRed(x, k, p));
+   //Adjust the size of the destination operand
+   error = mpiGrow(x, k + 1);
+   //Any error to report?
+   if(error) return error;
+
+   //The lower half of T is zero. Compute X = T / 2^(32 * k)
+   memmove(x->data, t + k, (k + 1) * MPI_INT_SIZE);
+   memset(x->data + k + 1, 0, (x->size - k - 1) * MPI_INT_SIZE);
+   //The result is always positive
+   x->sign = 1;
+
+   //X is less than 2 * P, so a final subtraction may be required
+   if(mpiComp(x, p) >= 0)
+      error = mpiSub(x, x, p);
 
-end:
    //Return status code
    return error;
 }
 
 
 /**
- * @brief Montgomery reduction (X = X / 2^k mod P)
- * @param[in,out] x Pointer to a multiple precision integer
- * @param[in] k
- * @param[in] p
+ * @brief Montgomery multiplication (X = A * B / 2^(32 * k) mod P)
+ *
+ * The product and the reduction are interleaved word by word (CIOS method),
+ * so that the intermediate result never exceeds 2 * k + 1 words. The
+ * workspace T is only allocated when it is too small, hence no memory
+ * allocation takes place when T is reused across successive calls
+ *
+ * @param[out] x Resulting value X
+ * @param[in] a First operand A (less than P)
+ * @param[in] b Second operand B (less than P)
+ * @param[in] k Number of words of the modulus
+ * @param[in] p Odd modulus P
+ * @param[in,out] t Workspace (must not be X, A, B or P)
  * @return Error code
  **/
 
-error_t mpiMontgomeryRed(Mpi *x, uint_t k, const Mpi *p)
+error_t mpiMontgomeryMul(Mpi *x, const Mpi *a, const Mpi *b, uint_t k, const Mpi *p, Mpi *t)
 {
-#if 0
-   Mpi r, rinv;
+   error_t error;
+   uint_t i;
+   uint_t m;
+   uint_t n;
+   uint_t q;
 
-   //Compute R mod N
-   mpiInit(&r);
-   mpiSetValue(&r, 1);
-   mpiShiftLeft(&r, k * (MPI_INT_SIZE * 8));
-   mpiMod(&r, &r, p);
+   //Compute -1/P[0] mod 2^32
+   m = mpiMontgomeryFactor(p);
+   //Determine the actual length of A and B
+   n = mpiGetLength(b);
 
-   //Compute R^-1 mod N
-   mpiInit(&rinv);
-   mpiInvMod(&rinv, &r, p);
+   //Make sure the workspace is large enough
+   error = mpiGrow(t, 2 * k + 1);
+   //Any error to report?
+   if(error) return error;
 
-   mpiMul(x, x, &rinv);
-   mpiMod(x, x, p);
+   //Let T = 0
+   memset(t->data, 0, t->size * MPI_INT_SIZE);
 
-   return NO_ERROR;
-#else
+   //Process A one word at a time
+   for(i = 0; i < k; i++)
+   {
+      //Compute T = T + A[i] * B * 2^(32 * i)
+      if(i < a->size)
+         mpiMulAccCore(t->data + i, b->data, n, a->data[i]);
+
+      //Compute q = T[i] * m mod 2^32
+      q = t->data[i] * m;
+      //Compute T = T + q * P * 2^(32 * i), which clears T[i]
+      mpiMulAccCore(t->data + i, p->data, k, q);
+   }
+
+   //Compute X = T / 2^(32 * k) mod P
+   return mpiMontgomeryFinal(x, t->data, k, p);
+}
+
+
+/**
+ * @brief Montgomery squaring (X = A * A / 2^(32 * k) mod P)
+ *
+ * The cross products A[i] * A[j] (i < j) are computed once and doubled,
+ * which saves nearly half of the multiplications. The Montgomery
+ * reduction is then performed in place
+ *
+ * @param[out] x Resulting value X
+ * @param[in] a Operand A (less than P)
+ * @param[in] k Number of words of the modulus
+ * @param[in] p Odd modulus P
+ * @param[in,out] t Workspace (must not be X, A or P)
+ * @return Error code
+ **/
+
+error_t mpiMontgomerySqr(Mpi *x, const Mpi *a, uint_t k, const Mpi *p, Mpi *t)
+{
    error_t error;
    uint_t i;
-   uint32_t m;
-   Mpi ll;
+   uint_t m;
+   uint_t n;
+   uint_t c;
+   uint_t u;
+   uint64_t v;
 
-   //Initialize multiple precision integer
-   mpiInit(&ll);
+   //Compute -1/P[0] mod 2^32
+   m = mpiMontgomeryFactor(p);
+   //Determine the actual length of A
+   n = mpiGetLength(a);
+
+   //Make sure the workspace is large enough
+   error = mpiGrow(t, 2 * k + 1);
+   //Any error to report?
+   if(error) return error;
 
-   //Use Newton's method to compute the inverse of P[0] mod 2^32
-   for(m = 2 - p->data[0], i = 0; i < 4; i++)
-         m = m * (2 - m * p->data[0]);
+   //Let T = 0
+   memset(t->data, 0, t->size * MPI_INT_SIZE);
 
-   //Precompute -1/P[0] mod 2^32;
-   m = ~m + 1;
+   //Compute the cross products A[i] * A[j] with i < j
+   for(i = 0; (i + 1) < n; i++)
+      mpiMulAccCore(t->data + 2 * i + 1, a->data + i + 1, n - i - 1, a->data[i]);
 
+   //Double the cross products
+   for(c = 0, i = 0; i < (2 * n); i++)
+   {
+      u = t->data[i];
+      t->data[i] = (u << 1) | c;
+      c = u >> 31;
+   }
+
+   //Add the squares A[i] * A[i]
+   for(c = 0, i = 0; i < n; i++)
+   {
+      v = (uint64_t) a->data[i] * a->data[i] + t->data[2 * i] + c;
+      t->data[2 * i] = (uint32_t) v;
+      v = (v >> 32) + t->data[2 * i + 1];
+      t->data[2 * i + 1] = (uint32_t) v;
+      c = (uint32_t) (v >> 32);
+   }
+
+   //Montgomery reduction
    for(i = 0; i < k; i++)
    {
-      MPI_CHECK(mpiSetValue(&ll, 1));
-      ll.data[0] = x->data[0] * m;
+      //Compute T = T + (T[i] * m mod 2^32) * P * 2^(32 * i)
+      mpiMulAccCore(t->data + i, p->data, k, t->data[i] * m);
+   }
+
+   //Compute X = T / 2^(32 * k) mod P
+   return mpiMontgomeryFinal(x, t->data, k, p);
+}
 
-      MPI_CHECK(mpiMul(&ll, p, &ll));
-      MPI_CHECK(mpiAdd(x, x, &ll));
-      MPI_CHECK(mpiShiftRight(x, MPI_INT_SIZE * 8));
+
+/**
+ * @brief Montgomery reduction (X = X / 2^(32 * k) mod P)
+ * @param[in,out] x Value to be reduced (less than P * 2^(32 * k))
+ * @param[in] k Number of words of the modulus
+ * @param[in] p Odd modulus P
+ * @return Error code
+ **/
+
+error_t mpiMontgomeryRed(Mpi *x, uint_t k, const Mpi *p)
+{
+   error_t error;
+   uint_t i;
+   uint_t m;
+
+   //Compute -1/P[0] mod 2^32
+   m = mpiMontgomeryFactor(p);
+
+   //The reduction is performed in place
+   error = mpiGrow(x, 2 * k + 1);
+   //Any error to report?
+   if(error) return error;
+
+   //Clear the words of X that are not significant
+   memset(x->data + 2 * k, 0, (x->size - 2 * k) * MPI_INT_SIZE);
+
+   //Montgomery reduction
+   for(i = 0; i < k; i++)
+   {
+      //Compute X = X + (X[i] * m mod 2^32) * P * 2^(32 * i)
+      mpiMulAccCore(x->data + i, p->data, k, x->data[i] * m);
    }
 
-   if(mpiComp(x, p) >= 0)
+   //Compute X = X / 2^(32 * k) mod P
+   return mpiMontgomeryFinal(x, x->data, k, p);
+}
+
+
+/**
+ * @brief Multiply-accumulate operation (R = R + A * B)
+ *
+ * The carry is propagated beyond the M words of R as far as necessary.
+ * R must be large enough to hold the result
+ *
+ * @param[in,out] r Pointer to the accumulator R
+ * @param[in] a Pointer to the first operand A
+ * @param[in] m Number of words of A
+ * @param[in] b Second operand B (a single word)
+ **/
+
+#if (MPI_ASM_SUPPORT == ENABLED && defined(__GNUC__) && defined(__ARM_ARCH_7EM__))
+
+void mpiMulAccCore(uint_t *r, const uint_t *a, uint_t m, uint_t b)
+{
+   uint_t i;
+   uint_t c;
+   uint_t u;
+
+   //Clear carry
+   c = 0;
+
+   //Process the words of A
+   for(i = 0; i < m; i++)
    {
-      MPI_CHECK(mpiSub(x, x, p));
+      u = r[i];
+      //UMAAL computes (C:U) = A[i] * B + U + C without overflow
+      __asm__ ("umaal %0, %1, %2, %3" : "+r" (u), "+r" (c) : "r" (a[i]), "r" (b));
+      r[i] = u;
    }
 
-end:
-   //Release multiple precision integer
-   mpiFree(&ll);
-   //Return status code
-   return error;
-#endif
+   //Propagate carry
+   for(; c != 0; i++)
+   {
+      r[i] += c;
+      c = (r[i] < c);
+   }
+}
+
+#else
+
+void mpiMulAccCore(uint_t *r, const uint_t *a, uint_t m, uint_t b)
+{
+   uint_t i;
+   uint_t c;
+   uint64_t p;
+
+   //Clear carry
+   c = 0;
+
+   //Process the words of A
+   for(i = 0; i < m; i++)
+   {
+      //Compute R[i] + A[i] * B + C, which cannot overflow 64 bits
+      p = (uint64_t) a[i] * b + r[i] + c;
+      //Save the lower part of the result
+      r[i] = (uint32_t) p;
+      //The upper part is the new carry
+      c = (uint32_t) (p >> 32);
+   }
+
+   //Propagate carry
+   for(; c != 0; i++)
+   {
+      r[i] += c;
+      c = (r[i] < c);
+   }
 }
 
+#endif
+
 
 /**
  * @brief Display the contents of a big number
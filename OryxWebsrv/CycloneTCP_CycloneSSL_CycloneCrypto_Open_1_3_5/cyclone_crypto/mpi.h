@@ -33,6 +33,27 @@
 #include <stdio.h>
 #include "crypto.h"
 
+//Assembly optimizations (UMAAL instruction of the Cortex-M4 core)
+#ifndef MPI_ASM_SUPPORT
+   #define MPI_ASM_SUPPORT DISABLED
+#elif (MPI_ASM_SUPPORT != ENABLED && MPI_ASM_SUPPORT != DISABLED)
+   #error MPI_ASM_SUPPORT parameter is invalid
+#endif
+
+//Maximum window size for modular exponentiation
+#ifndef MPI_EXP_WINDOW_SIZE
+   #define MPI_EXP_WINDOW_SIZE 5
+#elif (MPI_EXP_WINDOW_SIZE < 1 || MPI_EXP_WINDOW_SIZE > 6)
+   #error MPI_EXP_WINDOW_SIZE parameter is invalid
+#endif
+
+//Number of teeth of the fixed-base comb
+#ifndef MPI_COMB_TEETH
+   #define MPI_COMB_TEETH 4
+#elif (MPI_COMB_TEETH < 1 || MPI_COMB_TEETH > 8)
+   #error MPI_COMB_TEETH parameter is invalid
+#endif
+
 //Size of the sub data type
 #define MPI_INT_SIZE sizeof(uint_t)
 
@@ -56,6 +77,30 @@ typedef struct
 } Mpi;
 
 
+/**
+ * @brief Montgomery context
+ **/
+
+typedef struct
+{
+   Mpi p;    ///<Odd modulus P
+   uint_t k; ///<Number of words of the modulus (0 if the context is not valid)
+   Mpi r2;   ///<R^2 mod P, where R = (2^32)^k
+} MpiMontgomeryContext;
+
+
+/**
+ * @brief Fixed-base comb
+ **/
+
+typedef struct
+{
+   Mpi g;                          ///<Base G
+   uint_t d;                       ///<Number of bits per tooth (0 if the comb is not valid)
+   Mpi table[1 << MPI_COMB_TEETH]; ///<Precomputed powers of G, in Montgomery form
+} MpiCombContext;
+
+
 //MPI related functions
 void mpiInit(Mpi *x);
 void mpiFree(Mpi *x);
@@ -104,9 +149,24 @@ error_t mpiMulMod(Mpi *x, const Mpi *a, const Mpi *b, const Mpi *p);
 error_t mpiInvMod(Mpi *x, const Mpi *a, const Mpi *p);
 error_t mpiExpMod(Mpi *x, const Mpi *a, const Mpi *e, const Mpi *p);
 
-error_t mpiMontgomeryMul(Mpi *x, const Mpi *a, const Mpi *b, uint_t k, const Mpi *p);
+void mpiMontgomeryInit(MpiMontgomeryContext *context);
+void mpiMontgomeryFree(MpiMontgomeryContext *context);
+error_t mpiMontgomerySetModulus(MpiMontgomeryContext *context, const Mpi *p);
+error_t mpiExpModMontgomery(Mpi *x, const Mpi *a, const Mpi *e, const MpiMontgomeryContext *context);
+
+void mpiCombInit(MpiCombContext *comb);
+void mpiCombFree(MpiCombContext *comb);
+error_t mpiCombSetBase(MpiCombContext *comb, const Mpi *g, uint_t n,
+   const MpiMontgomeryContext *context);
+error_t mpiCombExpMod(Mpi *x, const MpiCombContext *comb, const Mpi *e,
+   const MpiMontgomeryContext *context);
+
+error_t mpiMontgomeryMul(Mpi *x, const Mpi *a, const Mpi *b, uint_t k, const Mpi *p, Mpi *t);
+error_t mpiMontgomerySqr(Mpi *x, const Mpi *a, uint_t k, const Mpi *p, Mpi *t);
 error_t mpiMontgomeryRed(Mpi *x, uint_t k, const Mpi *p);
 
+void mpiMulAccCore(uint_t *r, const uint_t *a, uint_t m, uint_t b);
+
 void mpiDump(FILE *stream, const char_t *prepend, const Mpi *a);
 
 #endif
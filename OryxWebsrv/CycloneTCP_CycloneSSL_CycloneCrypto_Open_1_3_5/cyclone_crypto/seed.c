@@ -225,7 +225,9 @@ const CipherAlgo seedCipherAlgo =
    NULL,
    NULL,
    (CipherAlgoEncryptBlock) seedEncryptBlock,
-   (CipherAlgoDecryptBlock) seedDecryptBlock
+   (CipherAlgoDecryptBlock) seedDecryptBlock,
+   NULL,
+   NULL
 };
 
 
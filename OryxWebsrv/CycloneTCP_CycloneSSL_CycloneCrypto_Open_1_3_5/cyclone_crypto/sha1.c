@@ -39,6 +39,11 @@
 #include "crypto.h"
 #include "sha1.h"
 
+//SHA-NI intrinsics
+#if (SHA1_NI_SUPPORT == ENABLED)
+   #include <immintrin.h>
+#endif
+
 //Check crypto library configuration
 #if (SHA1_SUPPORT == ENABLED)
 
@@ -46,9 +51,41 @@
 #define MASK(t) ((t) & 0x0F)
 
 //SHA-1 auxiliary functions
-#define CH(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define CH(x, y, z) (((x) & ((y) ^ (z))) ^ (z))
 #define PARITY(x, y, z) ((x) ^ (y) ^ (z))
-#define MAJ(x, y, z) (((x) & (y)) | ((x) & (z)) | ((y) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) | (((x) | (y)) & (z)))
+
+//Message schedule (the first 16 words are loaded from the block, the next
+//ones are computed on the fly in a 16-word circular buffer)
+#define W(t) ((t) < 16 ? (w[MASK(t)] = LOAD32BE(data + MASK(t) * 4)) : \
+   (w[MASK(t)] = ROL32(w[MASK((t) + 13)] ^ w[MASK((t) + 8)] ^ w[MASK((t) + 2)] ^ w[MASK(t)], 1)))
+
+//SHA-1 round function
+#define ROUND(a, b, c, d, e, F, K, t) \
+   e += ROL32(a, 5) + F(b, c, d) + K + W(t); \
+   b = ROL32(b, 30)
+
+//5 consecutive rounds (the working registers are renamed instead of moved)
+#define ROUNDS5(F, K, t) \
+   ROUND(a, b, c, d, e, F, K, (t) + 0); \
+   ROUND(e, a, b, c, d, F, K, (t) + 1); \
+   ROUND(d, e, a, b, c, F, K, (t) + 2); \
+   ROUND(c, d, e, a, b, F, K, (t) + 3); \
+   ROUND(b, c, d, e, a, F, K, (t) + 4)
+
+#if (SHA1_NI_SUPPORT == ENABLED)
+
+//Compute the next 4 words of the message schedule
+#define NI_SCHEDULE(m0, m1, m2, m3) \
+   m0 = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(m0, m1), m2), m3)
+
+//4 consecutive rounds
+#define NI_ROUNDS4(m, f) \
+   e = _mm_sha1nexte_epu32(prev, m); \
+   prev = abcd; \
+   abcd = _mm_sha1rnds4_epu32(abcd, e, f)
+
+#endif
 
 //SHA-1 padding
 static const uint8_t padding[64] =
@@ -146,31 +183,49 @@ void sha1Init(Sha1Context *context)
 
 void sha1Update(Sha1Context *context, const void *data, size_t length)
 {
+   size_t n;
+
    //Process the incoming data
    while(length > 0)
    {
-      //The buffer can hold at most 64 bytes
-      size_t n = min(length, 64 - context->size);
+      //Complete blocks can be processed without being copied to the buffer
+      if(context->size == 0 && length >= 64)
+      {
+         //Number of bytes in the complete blocks
+         n = length - (length % 64);
 
-      //Copy the data to the buffer
-      memcpy(context->buffer + context->size, data, n);
+         //Transform the 16-word blocks
+         sha1ProcessBlocks(context, data, n / 64);
+
+         //Update the SHA-1 context
+         context->totalSize += n;
+      }
+      else
+      {
+         //The buffer can hold at most 64 bytes
+         n = min(length, 64 - context->size);
+
+         //Copy the data to the buffer
+         memcpy(context->buffer + context->size, data, n);
+
+         //Update the SHA-1 context
+         context->size += n;
+         context->totalSize += n;
+
+         //Process message in 16-word blocks
+         if(context->size == 64)
+         {
+            //Transform the 16-word block
+            sha1ProcessBlock(context);
+            //Empty the buffer
+            context->size = 0;
+         }
+      }
 
-      //Update the SHA-1 context
-      context->size += n;
-      context->totalSize += n;
       //Advance the data pointer
       data = (uint8_t *) data + n;
       //Remaining bytes to process
       length -= n;
-
-      //Process message in 16-word blocks
-      if(context->size == 64)
-      {
-         //Transform the 16-word block
-         sha1ProcessBlock(context);
-         //Empty the buffer
-         context->size = 0;
-      }
    }
 }
 
@@ -213,64 +268,186 @@ void sha1Final(Sha1Context *context, uint8_t *digest)
 
 
 /**
- * @brief Process message in 16-word blocks
+ * @brief Process the 16-word block held in the buffer
  * @param[in] context Pointer to the SHA-1 context
  **/
 
 void sha1ProcessBlock(Sha1Context *context)
 {
-   uint_t s;
-   uint_t t;
-   uint32_t temp;
-
-   //Initialize the 5 working registers
-   uint32_t a = context->h[0];
-   uint32_t b = context->h[1];
-   uint32_t c = context->h[2];
-   uint32_t d = context->h[3];
-   uint32_t e = context->h[4];
-
-   //Process message in 16-word blocks
-   uint32_t *w = context->w;
-
-   //Convert from big-endian byte order to host byte order
-   for(t = 0; t < 16; t++)
-      w[t] = betoh32(w[t]);
-
-   //SHA-1 hash computation (alternate method)
-   for(t = 0; t < 80; t++)
+   //Transform the contents of the buffer
+   sha1ProcessBlocks(context, context->buffer, 1);
+}
+
+
+#if (SHA1_NI_SUPPORT == ENABLED)
+
+/**
+ * @brief Process message in 16-word blocks (SHA-NI)
+ * @param[in] context Pointer to the SHA-1 context
+ * @param[in] data Pointer to the blocks
+ * @param[in] n Number of blocks
+ **/
+
+void sha1ProcessBlocks(Sha1Context *context, const uint8_t *data, size_t n)
+{
+   __m128i abcd;
+   __m128i abcd0;
+   __m128i e;
+   __m128i e0;
+   __m128i prev;
+   __m128i m0;
+   __m128i m1;
+   __m128i m2;
+   __m128i m3;
+   __m128i mask;
+
+   //Shuffle mask that converts the message words to host byte order
+   //and reverses their order
+   mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+
+   //The SHA-NI instructions expect A in the most significant word
+   abcd = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *) context->h), 0x1B);
+   e0 = _mm_set_epi32(context->h[4], 0, 0, 0);
+
+   //Process the blocks
+   while(n > 0)
    {
-      //Current index in the circular buffer
-      s = MASK(t);
-
-      //The alternate method requires preprocessing
-      if(t >= 16)
-         w[s] = ROL32(w[MASK(s + 13)] ^ w[MASK(s + 8)] ^ w[MASK(s + 2)] ^ w[s], 1);
-
-      //Calculate T
-      if(t < 20)
-         temp = ROL32(a, 5) + CH(b, c, d) + e + w[s] + k[0];
-      else if(t < 40)
-         temp = ROL32(a, 5) + PARITY(b, c, d) + e + w[s] + k[1];
-      else if(t < 60)
-         temp = ROL32(a, 5) + MAJ(b, c, d) + e + w[s] + k[2];
-      else
-         temp = ROL32(a, 5) + PARITY(b, c, d) + e + w[s] + k[3];
-
-      //Update the working registers
-      e = d;
-      d = c;
-      c = ROL32(b, 30);
-      b = a;
-      a = temp;
+      //Save the working registers
+      abcd0 = abcd;
+
+      //Load the message words
+      m0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) data), mask);
+      m1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (data + 16)), mask);
+      m2 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (data + 32)), mask);
+      m3 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (data + 48)), mask);
+
+      //Rounds 0 to 3
+      e = _mm_add_epi32(e0, m0);
+      prev = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e, 0);
+
+      //Rounds 4 to 19
+      NI_ROUNDS4(m1, 0);
+      NI_ROUNDS4(m2, 0);
+      NI_ROUNDS4(m3, 0);
+      NI_SCHEDULE(m0, m1, m2, m3);
+      NI_ROUNDS4(m0, 0);
+
+      //Rounds 20 to 39
+      NI_SCHEDULE(m1, m2, m3, m0);
+      NI_ROUNDS4(m1, 1);
+      NI_SCHEDULE(m2, m3, m0, m1);
+      NI_ROUNDS4(m2, 1);
+      NI_SCHEDULE(m3, m0, m1, m2);
+      NI_ROUNDS4(m3, 1);
+      NI_SCHEDULE(m0, m1, m2, m3);
+      NI_ROUNDS4(m0, 1);
+      NI_SCHEDULE(m1, m2, m3, m0);
+      NI_ROUNDS4(m1, 1);
+
+      //Rounds 40 to 59
+      NI_SCHEDULE(m2, m3, m0, m1);
+      NI_ROUNDS4(m2, 2);
+      NI_SCHEDULE(m3, m0, m1, m2);
+      NI_ROUNDS4(m3, 2);
+      NI_SCHEDULE(m0, m1, m2, m3);
+      NI_ROUNDS4(m0, 2);
+      NI_SCHEDULE(m1, m2, m3, m0);
+      NI_ROUNDS4(m1, 2);
+      NI_SCHEDULE(m2, m3, m0, m1);
+      NI_ROUNDS4(m2, 2);
+
+      //Rounds 60 to 79
+      NI_SCHEDULE(m3, m0, m1, m2);
+      NI_ROUNDS4(m3, 3);
+      NI_SCHEDULE(m0, m1, m2, m3);
+      NI_ROUNDS4(m0, 3);
+      NI_SCHEDULE(m1, m2, m3, m0);
+      NI_ROUNDS4(m1, 3);
+      NI_SCHEDULE(m2, m3, m0, m1);
+      NI_ROUNDS4(m2, 3);
+      NI_SCHEDULE(m3, m0, m1, m2);
+      NI_ROUNDS4(m3, 3);
+
+      //Update the hash value
+      e0 = _mm_sha1nexte_epu32(prev, e0);
+      abcd = _mm_add_epi32(abcd, abcd0);
+
+      //Next block
+      data += 64;
+      n--;
    }
 
-   //Update the hash value
-   context->h[0] += a;
-   context->h[1] += b;
-   context->h[2] += c;
-   context->h[3] += d;
-   context->h[4] += e;
+   //Save the resulting hash value
+   _mm_storeu_si128((__m128i *) context->h, _mm_shuffle_epi32(abcd, 0x1B));
+   context->h[4] = _mm_extract_epi32(e0, 3);
 }
 
+#else
+
+/**
+ * @brief Process message in 16-word blocks
+ * @param[in] context Pointer to the SHA-1 context
+ * @param[in] data Pointer to the blocks
+ * @param[in] n Number of blocks
+ **/
+
+void sha1ProcessBlocks(Sha1Context *context, const uint8_t *data, size_t n)
+{
+   uint32_t a;
+   uint32_t b;
+   uint32_t c;
+   uint32_t d;
+   uint32_t e;
+   uint32_t w[16];
+
+   //Process the blocks
+   while(n > 0)
+   {
+      //Initialize the 5 working registers
+      a = context->h[0];
+      b = context->h[1];
+      c = context->h[2];
+      d = context->h[3];
+      e = context->h[4];
+
+      //Rounds 0 to 19
+      ROUNDS5(CH, k[0], 0);
+      ROUNDS5(CH, k[0], 5);
+      ROUNDS5(CH, k[0], 10);
+      ROUNDS5(CH, k[0], 15);
+
+      //Rounds 20 to 39
+      ROUNDS5(PARITY, k[1], 20);
+      ROUNDS5(PARITY, k[1], 25);
+      ROUNDS5(PARITY, k[1], 30);
+      ROUNDS5(PARITY, k[1], 35);
+
+      //Rounds 40 to 59
+      ROUNDS5(MAJ, k[2], 40);
+      ROUNDS5(MAJ, k[2], 45);
+      ROUNDS5(MAJ, k[2], 50);
+      ROUNDS5(MAJ, k[2], 55);
+
+      //Rounds 60 to 79
+      ROUNDS5(PARITY, k[3], 60);
+      ROUNDS5(PARITY, k[3], 65);
+      ROUNDS5(PARITY, k[3], 70);
+      ROUNDS5(PARITY, k[3], 75);
+
+      //Update the hash value
+      context->h[0] += a;
+      context->h[1] += b;
+      context->h[2] += c;
+      context->h[3] += d;
+      context->h[4] += e;
+
+      //Next block
+      data += 64;
+      n--;
+   }
+}
+
+#endif
+
 #endif
@@ -32,6 +32,15 @@
 //Dependencies
 #include "crypto.h"
 
+//SHA-NI instruction set support (x86 hosts)
+#ifndef SHA1_NI_SUPPORT
+   #define SHA1_NI_SUPPORT DISABLED
+#elif (SHA1_NI_SUPPORT != ENABLED && SHA1_NI_SUPPORT != DISABLED)
+   #error SHA1_NI_SUPPORT parameter is invalid
+#elif (SHA1_NI_SUPPORT == ENABLED && (!defined(__SHA__) || !defined(__SSE4_1__)))
+   #error SHA1_NI_SUPPORT requires the SHA and SSE4.1 instruction sets to be enabled (-msha -msse4.1)
+#endif
+
 //SHA-1 block size
 #define SHA1_BLOCK_SIZE 64
 //SHA-1 digest size
@@ -70,5 +79,6 @@ void sha1Init(Sha1Context *context);
 void sha1Update(Sha1Context *context, const void *data, size_t length);
 void sha1Final(Sha1Context *context, uint8_t *digest);
 void sha1ProcessBlock(Sha1Context *context);
+void sha1ProcessBlocks(Sha1Context *context, const uint8_t *data, size_t n);
 
 #endif
@@ -39,17 +39,68 @@
 #include "crypto.h"
 #include "sha256.h"
 
+//SHA-NI intrinsics
+#if (SHA256_NI_SUPPORT == ENABLED)
+   #include <immintrin.h>
+#endif
+
 //Check crypto library configuration
 #if (SHA224_SUPPORT == ENABLED || SHA256_SUPPORT == ENABLED)
 
 //SHA-256 auxiliary functions
-#define CH(x, y, z) (((x) & (y)) | (~(x) & (z)))
-#define MAJ(x, y, z) (((x) & (y)) | ((x) & (z)) | ((y) & (z)))
+#define CH(x, y, z) (((x) & ((y) ^ (z))) ^ (z))
+#define MAJ(x, y, z) (((x) & (y)) | (((x) | (y)) & (z)))
 #define SIGMA1(x) (ROR32(x, 2) ^ ROR32(x, 13) ^ ROR32(x, 22))
 #define SIGMA2(x) (ROR32(x, 6) ^ ROR32(x, 11) ^ ROR32(x, 25))
 #define SIGMA3(x) (ROR32(x, 7) ^ ROR32(x, 18) ^ SHR32(x, 3))
 #define SIGMA4(x) (ROR32(x, 17) ^ ROR32(x, 19) ^ SHR32(x, 10))
 
+//Message words used by the first 16 rounds
+#define MSG(t) (w[t] = LOAD32BE(data + (t) * 4))
+//Message schedule, computed on the fly in a 16-word circular buffer
+#define W(t) (w[(t) & 15] += SIGMA4(w[((t) - 2) & 15]) + w[((t) - 7) & 15] + SIGMA3(w[((t) - 15) & 15]))
+
+//SHA-256 round function
+#define ROUND(a, b, c, d, e, f, g, h, x, t) \
+   h += SIGMA2(e) + CH(e, f, g) + k[t] + x; \
+   d += h; \
+   h += SIGMA1(a) + MAJ(a, b, c)
+
+//16 consecutive rounds (the working registers are renamed instead of moved)
+#define ROUNDS16(X, t) \
+   ROUND(a, b, c, d, e, f, g, h, X(0), (t) + 0); \
+   ROUND(h, a, b, c, d, e, f, g, X(1), (t) + 1); \
+   ROUND(g, h, a, b, c, d, e, f, X(2), (t) + 2); \
+   ROUND(f, g, h, a, b, c, d, e, X(3), (t) + 3); \
+   ROUND(e, f, g, h, a, b, c, d, X(4), (t) + 4); \
+   ROUND(d, e, f, g, h, a, b, c, X(5), (t) + 5); \
+   ROUND(c, d, e, f, g, h, a, b, X(6), (t) + 6); \
+   ROUND(b, c, d, e, f, g, h, a, X(7), (t) + 7); \
+   ROUND(a, b, c, d, e, f, g, h, X(8), (t) + 8); \
+   ROUND(h, a, b, c, d, e, f, g, X(9), (t) + 9); \
+   ROUND(g, h, a, b, c, d, e, f, X(10), (t) + 10); \
+   ROUND(f, g, h, a, b, c, d, e, X(11), (t) + 11); \
+   ROUND(e, f, g, h, a, b, c, d, X(12), (t) + 12); \
+   ROUND(d, e, f, g, h, a, b, c, X(13), (t) + 13); \
+   ROUND(c, d, e, f, g, h, a, b, X(14), (t) + 14); \
+   ROUND(b, c, d, e, f, g, h, a, X(15), (t) + 15)
+
+#if (SHA256_NI_SUPPORT == ENABLED)
+
+//Compute the next 4 words of the message schedule
+#define NI_SCHEDULE(m0, m1, m2, m3) \
+   m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), \
+      _mm_alignr_epi8(m3, m2, 4)), m3)
+
+//4 consecutive rounds
+#define NI_ROUNDS4(m, t) \
+   x = _mm_add_epi32(m, _mm_loadu_si128((__m128i *) (k + (t)))); \
+   state1 = _mm_sha256rnds2_epu32(state1, state0, x); \
+   x = _mm_shuffle_epi32(x, 0x0E); \
+   state0 = _mm_sha256rnds2_epu32(state0, state1, x)
+
+#endif
+
 //SHA-256 padding
 static const uint8_t padding[64] =
 {
@@ -153,31 +204,49 @@ void sha256Init(Sha256Context *context)
 
 void sha256Update(Sha256Context *context, const void *data, size_t length)
 {
+   size_t n;
+
    //Process the incoming data
    while(length > 0)
    {
-      //The buffer can hold at most 64 bytes
-      size_t n = min(length, 64 - context->size);
+      //Complete blocks can be processed without being copied to the buffer
+      if(context->size == 0 && length >= 64)
+      {
+         //Number of bytes in the complete blocks
+         n = length - (length % 64);
+
+         //Transform the 16-word blocks
+         sha256ProcessBlocks(context, data, n / 64);
 
-      //Copy the data to the buffer
-      memcpy(context->buffer + context->size, data, n);
+         //Update the SHA-256 context
+         context->totalSize += n;
+      }
+      else
+      {
+         //The buffer can hold at most 64 bytes
+         n = min(length, 64 - context->size);
+
+         //Copy the data to the buffer
+         memcpy(context->buffer + context->size, data, n);
+
+         //Update the SHA-256 context
+         context->size += n;
+         context->totalSize += n;
+
+         //Process message in 16-word blocks
+         if(context->size == 64)
+         {
+            //Transform the 16-word block
+            sha256ProcessBlock(context);
+            //Empty the buffer
+            context->size = 0;
+         }
+      }
 
-      //Update the SHA-256 context
-      context->size += n;
-      context->totalSize += n;
       //Advance the data pointer
       data = (uint8_t *) data + n;
       //Remaining bytes to process
       length -= n;
-
-      //Process message in 16-word blocks
-      if(context->size == 64)
-      {
-         //Transform the 16-word block
-         sha256ProcessBlock(context);
-         //Empty the buffer
-         context->size = 0;
-      }
    }
 }
 
@@ -220,64 +289,159 @@ void sha256Final(Sha256Context *context, uint8_t *digest)
 
 
 /**
- * @brief Process message in 16-word blocks
+ * @brief Process the 16-word block held in the buffer
  * @param[in] context Pointer to the SHA-256 context
  **/
 
 void sha256ProcessBlock(Sha256Context *context)
+{
+   //Transform the contents of the buffer
+   sha256ProcessBlocks(context, context->buffer, 1);
+}
+
+
+#if (SHA256_NI_SUPPORT == ENABLED)
+
+/**
+ * @brief Process message in 16-word blocks (SHA-NI)
+ * @param[in] context Pointer to the SHA-256 context
+ * @param[in] data Pointer to the blocks
+ * @param[in] n Number of blocks
+ **/
+
+void sha256ProcessBlocks(Sha256Context *context, const uint8_t *data, size_t n)
 {
    uint_t t;
-   uint32_t temp1;
-   uint32_t temp2;
-
-   //Initialize the 8 working registers
-   uint32_t a = context->h[0];
-   uint32_t b = context->h[1];
-   uint32_t c = context->h[2];
-   uint32_t d = context->h[3];
-   uint32_t e = context->h[4];
-   uint32_t f = context->h[5];
-   uint32_t g = context->h[6];
-   uint32_t h = context->h[7];
-
-   //Process message in 16-word blocks
-   uint32_t *w = context->w;
-
-   //Convert from big-endian byte order to host byte order
-   for(t = 0; t < 16; t++)
-      w[t] = betoh32(w[t]);
-
-   //Prepare the message schedule
-   for(t = 16; t < 64; t++)
-      w[t] = SIGMA4(w[t - 2]) + w[t - 7] + SIGMA3(w[t - 15]) + w[t - 16];
-
-   //SHA-256 hash computation
-   for(t = 0; t < 64; t++)
+   __m128i state0;
+   __m128i state1;
+   __m128i abef;
+   __m128i cdgh;
+   __m128i m0;
+   __m128i m1;
+   __m128i m2;
+   __m128i m3;
+   __m128i x;
+   __m128i mask;
+
+   //Shuffle mask that converts the message words to host byte order
+   mask = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+   //The SHA-NI instructions operate on the working registers
+   //ordered as ABEF and CDGH
+   x = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *) context->h), 0xB1);
+   state1 = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *) (context->h + 4)), 0x1B);
+   state0 = _mm_alignr_epi8(x, state1, 8);
+   state1 = _mm_blend_epi16(state1, x, 0xF0);
+
+   //Process the blocks
+   while(n > 0)
    {
-      //Calculate T1 and T2
-      temp1 = h + SIGMA2(e) + CH(e, f, g) + k[t] + w[t];
-      temp2 = SIGMA1(a) + MAJ(a, b, c);
-
-      //Update the working registers
-      h = g;
-      g = f;
-      f = e;
-      e = d + temp1;
-      d = c;
-      c = b;
-      b = a;
-      a = temp1 + temp2;
+      //Save the working registers
+      abef = state0;
+      cdgh = state1;
+
+      //Load the message words
+      m0 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) data), mask);
+      m1 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (data + 16)), mask);
+      m2 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (data + 32)), mask);
+      m3 = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (data + 48)), mask);
+
+      //Rounds 0 to 15
+      NI_ROUNDS4(m0, 0);
+      NI_ROUNDS4(m1, 4);
+      NI_ROUNDS4(m2, 8);
+      NI_ROUNDS4(m3, 12);
+
+      //Rounds 16 to 63
+      for(t = 16; t < 64; t += 16)
+      {
+         NI_SCHEDULE(m0, m1, m2, m3);
+         NI_ROUNDS4(m0, t);
+         NI_SCHEDULE(m1, m2, m3, m0);
+         NI_ROUNDS4(m1, t + 4);
+         NI_SCHEDULE(m2, m3, m0, m1);
+         NI_ROUNDS4(m2, t + 8);
+         NI_SCHEDULE(m3, m0, m1, m2);
+         NI_ROUNDS4(m3, t + 12);
+      }
+
+      //Update the hash value
+      state0 = _mm_add_epi32(state0, abef);
+      state1 = _mm_add_epi32(state1, cdgh);
+
+      //Next block
+      data += 64;
+      n--;
    }
 
-   //Update the hash value
-   context->h[0] += a;
-   context->h[1] += b;
-   context->h[2] += c;
-   context->h[3] += d;
-   context->h[4] += e;
-   context->h[5] += f;
-   context->h[6] += g;
-   context->h[7] += h;
+   //Restore the natural order of the hash value
+   x = _mm_shuffle_epi32(state0, 0x1B);
+   state1 = _mm_shuffle_epi32(state1, 0xB1);
+   state0 = _mm_blend_epi16(x, state1, 0xF0);
+   state1 = _mm_alignr_epi8(state1, x, 8);
+
+   //Save the resulting hash value
+   _mm_storeu_si128((__m128i *) context->h, state0);
+   _mm_storeu_si128((__m128i *) (context->h + 4), state1);
 }
 
+#else
+
+/**
+ * @brief Process message in 16-word blocks
+ * @param[in] context Pointer to the SHA-256 context
+ * @param[in] data Pointer to the blocks
+ * @param[in] n Number of blocks
+ **/
+
+void sha256ProcessBlocks(Sha256Context *context, const uint8_t *data, size_t n)
+{
+   uint32_t a;
+   uint32_t b;
+   uint32_t c;
+   uint32_t d;
+   uint32_t e;
+   uint32_t f;
+   uint32_t g;
+   uint32_t h;
+   uint32_t w[16];
+
+   //Process the blocks
+   while(n > 0)
+   {
+      //Initialize the 8 working registers
+      a = context->h[0];
+      b = context->h[1];
+      c = context->h[2];
+      d = context->h[3];
+      e = context->h[4];
+      f = context->h[5];
+      g = context->h[6];
+      h = context->h[7];
+
+      //Rounds 0 to 15 use the message words directly
+      ROUNDS16(MSG, 0);
+      //Rounds 16 to 63 extend the message schedule as they go
+      ROUNDS16(W, 16);
+      ROUNDS16(W, 32);
+      ROUNDS16(W, 48);
+
+      //Update the hash value
+      context->h[0] += a;
+      context->h[1] += b;
+      context->h[2] += c;
+      context->h[3] += d;
+      context->h[4] += e;
+      context->h[5] += f;
+      context->h[6] += g;
+      context->h[7] += h;
+
+      //Next block
+      data += 64;
+      n--;
+   }
+}
+
+#endif
+
 #endif
@@ -32,6 +32,15 @@
 //Dependencies
 #include "crypto.h"
 
+//SHA-NI instruction set support (x86 hosts)
+#ifndef SHA256_NI_SUPPORT
+   #define SHA256_NI_SUPPORT DISABLED
+#elif (SHA256_NI_SUPPORT != ENABLED && SHA256_NI_SUPPORT != DISABLED)
+   #error SHA256_NI_SUPPORT parameter is invalid
+#elif (SHA256_NI_SUPPORT == ENABLED && (!defined(__SHA__) || !defined(__SSE4_1__)))
+   #error SHA256_NI_SUPPORT requires the SHA and SSE4.1 instruction sets to be enabled (-msha -msse4.1)
+#endif
+
 //SHA-256 block size
 #define SHA256_BLOCK_SIZE 64
 //SHA-256 digest size
@@ -53,7 +62,7 @@ typedef struct
    };
    union
    {
-      uint32_t w[64];
+      uint32_t w[16];
       uint8_t buffer[64];
    };
    size_t size;
@@ -70,5 +79,6 @@ void sha256Init(Sha256Context *context);
 void sha256Update(Sha256Context *context, const void *data, size_t length);
 void sha256Final(Sha256Context *context, uint8_t *digest);
 void sha256ProcessBlock(Sha256Context *context);
+void sha256ProcessBlocks(Sha256Context *context, const uint8_t *data, size_t n);
 
 #endif
@@ -43,13 +43,43 @@
 #if (SHA384_SUPPORT == ENABLED || SHA512_SUPPORT == ENABLED || SHA512_224_SUPPORT == ENABLED || SHA512_256_SUPPORT == ENABLED)
 
 //SHA-512 auxiliary functions
-#define CH(x, y, z) (((x) & (y)) | (~(x) & (z)))
-#define MAJ(x, y, z) (((x) & (y)) | ((x) & (z)) | ((y) & (z)))
+#define CH(x, y, z) (((x) & ((y) ^ (z))) ^ (z))
+#define MAJ(x, y, z) (((x) & (y)) | (((x) | (y)) & (z)))
 #define SIGMA1(x) (ROR64(x, 28) ^ ROR64(x, 34) ^ ROR64(x, 39))
 #define SIGMA2(x) (ROR64(x, 14) ^ ROR64(x, 18) ^ ROR64(x, 41))
 #define SIGMA3(x) (ROR64(x, 1) ^ ROR64(x, 8) ^ SHR64(x, 7))
 #define SIGMA4(x) (ROR64(x, 19) ^ ROR64(x, 61) ^ SHR64(x, 6))
 
+//Message words used by the first 16 rounds
+#define MSG(t) (w[t] = LOAD64BE(data + (t) * 8))
+//Message schedule, computed on the fly in a 16-word circular buffer
+#define W(t) (w[(t) & 15] += SIGMA4(w[((t) - 2) & 15]) + w[((t) - 7) & 15] + SIGMA3(w[((t) - 15) & 15]))
+
+//SHA-512 round function
+#define ROUND(a, b, c, d, e, f, g, h, x, t) \
+   h += SIGMA2(e) + CH(e, f, g) + k[t] + x; \
+   d += h; \
+   h += SIGMA1(a) + MAJ(a, b, c)
+
+//16 consecutive rounds (the working registers are renamed instead of moved)
+#define ROUNDS16(X, t) \
+   ROUND(a, b, c, d, e, f, g, h, X(0), (t) + 0); \
+   ROUND(h, a, b, c, d, e, f, g, X(1), (t) + 1); \
+   ROUND(g, h, a, b, c, d, e, f, X(2), (t) + 2); \
+   ROUND(f, g, h, a, b, c, d, e, X(3), (t) + 3); \
+   ROUND(e, f, g, h, a, b, c, d, X(4), (t) + 4); \
+   ROUND(d, e, f, g, h, a, b, c, X(5), (t) + 5); \
+   ROUND(c, d, e, f, g, h, a, b, X(6), (t) + 6); \
+   ROUND(b, c, d, e, f, g, h, a, X(7), (t) + 7); \
+   ROUND(a, b, c, d, e, f, g, h, X(8), (t) + 8); \
+   ROUND(h, a, b, c, d, e, f, g, X(9), (t) + 9); \
+   ROUND(g, h, a, b, c, d, e, f, X(10), (t) + 10); \
+   ROUND(f, g, h, a, b, c, d, e, X(11), (t) + 11); \
+   ROUND(e, f, g, h, a, b, c, d, X(12), (t) + 12); \
+   ROUND(d, e, f, g, h, a, b, c, X(13), (t) + 13); \
+   ROUND(c, d, e, f, g, h, a, b, X(14), (t) + 14); \
+   ROUND(b, c, d, e, f, g, h, a, X(15), (t) + 15)
+
 //SHA-512 padding
 static const uint8_t padding[128] =
 {
@@ -169,31 +199,49 @@ void sha512Init(Sha512Context *context)
 
 void sha512Update(Sha512Context *context, const void *data, size_t length)
 {
+   size_t n;
+
    //Process the incoming data
    while(length > 0)
    {
-      //The buffer can hold at most 128 bytes
-      size_t n = min(length, 128 - context->size);
+      //Complete blocks can be processed without being copied to the buffer
+      if(context->size == 0 && length >= 128)
+      {
+         //Number of bytes in the complete blocks
+         n = length - (length % 128);
 
-      //Copy the data to the buffer
-      memcpy(context->buffer + context->size, data, n);
+         //Transform the 16-word blocks
+         sha512ProcessBlocks(context, data, n / 128);
+
+         //Update the SHA-512 context
+         context->totalSize += n;
+      }
+      else
+      {
+         //The buffer can hold at most 128 bytes
+         n = min(length, 128 - context->size);
+
+         //Copy the data to the buffer
+         memcpy(context->buffer + context->size, data, n);
+
+         //Update the SHA-512 context
+         context->size += n;
+         context->totalSize += n;
+
+         //Process message in 16-word blocks
+         if(context->size == 128)
+         {
+            //Transform the 16-word block
+            sha512ProcessBlock(context);
+            //Empty the buffer
+            context->size = 0;
+         }
+      }
 
-      //Update the SHA-512 context
-      context->size += n;
-      context->totalSize += n;
       //Advance the data pointer
       data = (uint8_t *) data + n;
       //Remaining bytes to process
       length -= n;
-
-      //Process message in 16-word blocks
-      if(context->size == 128)
-      {
-         //Transform the 16-word block
-         sha512ProcessBlock(context);
-         //Empty the buffer
-         context->size = 0;
-      }
    }
 }
 
@@ -236,64 +284,73 @@ void sha512Final(Sha512Context *context, uint8_t *digest)
 
 
 /**
- * @brief Process message in 16-word blocks
+ * @brief Process the 16-word block held in the buffer
  * @param[in] context Pointer to the SHA-512 context
  **/
 
 void sha512ProcessBlock(Sha512Context *context)
+{
+   //Transform the contents of the buffer
+   sha512ProcessBlocks(context, context->buffer, 1);
+}
+
+
+/**
+ * @brief Process message in 16-word blocks
+ * @param[in] context Pointer to the SHA-512 context
+ * @param[in] data Pointer to the blocks
+ * @param[in] n Number of blocks
+ **/
+
+void sha512ProcessBlocks(Sha512Context *context, const uint8_t *data, size_t n)
 {
    uint_t t;
-   uint64_t temp1;
-   uint64_t temp2;
-
-   //Initialize the 8 working registers
-   uint64_t a = context->h[0];
-   uint64_t b = context->h[1];
-   uint64_t c = context->h[2];
-   uint64_t d = context->h[3];
-   uint64_t e = context->h[4];
-   uint64_t f = context->h[5];
-   uint64_t g = context->h[6];
-   uint64_t h = context->h[7];
-
-   //Process message in 16-word blocks
-   uint64_t *w = context->w;
-
-   //Convert from big-endian byte order to host byte order
-   for(t = 0; t < 16; t++)
-      w[t] = betoh64(w[t]);
-
-   //Prepare the message schedule
-   for(t = 16; t < 80; t++)
-      w[t] = SIGMA4(w[t - 2]) + w[t - 7] + SIGMA3(w[t - 15]) + w[t - 16];
-
-   //SHA-512 hash computation
-   for(t = 0; t < 80; t++)
+   uint64_t a;
+   uint64_t b;
+   uint64_t c;
+   uint64_t d;
+   uint64_t e;
+   uint64_t f;
+   uint64_t g;
+   uint64_t h;
+   uint64_t w[16];
+
+   //Process the blocks
+   while(n > 0)
    {
-      //Calculate T1 and T2
-      temp1 = h + SIGMA2(e) + CH(e, f, g) + k[t] + w[t];
-      temp2 = SIGMA1(a) + MAJ(a, b, c);
-
-      //Update the working registers
-      h = g;
-      g = f;
-      f = e;
-      e = d + temp1;
-      d = c;
-      c = b;
-      b = a;
-      a = temp1 + temp2;
-   }
+      //Initialize the 8 working registers
+      a = context->h[0];
+      b = context->h[1];
+      c = context->h[2];
+      d = context->h[3];
+      e = context->h[4];
+      f = context->h[5];
+      g = context->h[6];
+      h = context->h[7];
+
+      //Rounds 0 to 15 use the message words directly
+      ROUNDS16(MSG, 0);
+
+      //Rounds 16 to 79 extend the message schedule as they go
+      for(t = 16; t < 80; t += 16)
+      {
+         ROUNDS16(W, t);
+      }
 
-   //Update the hash value
-   context->h[0] += a;
-   context->h[1] += b;
-   context->h[2] += c;
-   context->h[3] += d;
-   context->h[4] += e;
-   context->h[5] += f;
-   context->h[6] += g;
-   context->h[7] += h;
+      //Update the hash value
+      context->h[0] += a;
+      context->h[1] += b;
+      context->h[2] += c;
+      context->h[3] += d;
+      context->h[4] += e;
+      context->h[5] += f;
+      context->h[6] += g;
+      context->h[7] += h;
+
+      //Next block
+      data += 128;
+      n--;
+   }
 }
 
 #endif
@@ -53,7 +53,7 @@ typedef struct
    };
    union
    {
-      uint64_t w[80];
+      uint64_t w[16];
       uint8_t buffer[128];
    };
    size_t size;
@@ -70,5 +70,6 @@ void sha512Init(Sha512Context *context);
 void sha512Update(Sha512Context *context, const void *data, size_t length);
 void sha512Final(Sha512Context *context, uint8_t *digest);
 void sha512ProcessBlock(Sha512Context *context);
+void sha512ProcessBlocks(Sha512Context *context, const uint8_t *data, size_t n);
 
 #endif
@@ -0,0 +1,836 @@
+/**
+ * @file aes_bench.c
+ * @brief AES benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The AES engine of aes.c is compared with a textbook implementation,
+ * which runs the byte-oriented SubBytes, ShiftRows, MixColumns and
+ * AddRoundKey sequence one block at a time, as aes.c used to. Both are
+ * checked against the FIPS-197 test vectors, and GCM is checked against
+ * test cases 4 and 6 of the GCM specification (AES-128, with a 96-bit and
+ * a 480-bit IV), both in one shot and through the incremental interface
+ * fed with chunks of odd lengths. AES-128 and AES-256 are then timed in
+ * ECB, CBC, CTR and GCM modes, in cycles per byte of the time stamp
+ * counter. The textbook cipher has no multi-block entry, so the modes
+ * feed it one block at a time, and its ciphertexts and tags must match
+ * the ones of aes.c. Both share the same GHASH, hence the known answers.
+ * The program is built with the portable engine and 4-bit or 8-bit GHASH
+ * tables, and with AES-NI and PCLMULQDQ (see demo/posix/Makefile)
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "crypto.h"
+#include "aes.h"
+#include "cipher_mode_ecb.h"
+#include "cipher_mode_cbc.h"
+#include "cipher_mode_ctr.h"
+#include "cipher_mode_gcm.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Size of the buffers being processed
+#define BENCH_SIZE 16384
+//Number of measurements (the best one is kept)
+#define BENCH_RUNS 20
+
+//AES engine being measured
+#if (AES_NI_SUPPORT == ENABLED && GCM_PCLMUL_SUPPORT == ENABLED)
+   #define BENCH_ENGINE "AES-NI/PCLMULQDQ"
+#elif (AES_NI_SUPPORT == ENABLED)
+   #define BENCH_ENGINE "AES-NI"
+#else
+   #define BENCH_ENGINE "T-table"
+#endif
+
+//GHASH implementation being checked
+#if (GCM_PCLMUL_SUPPORT == ENABLED)
+   #define BENCH_GHASH "PCLMULQDQ"
+#elif (GCM_TABLE_W == 8)
+   #define BENCH_GHASH "8-bit table"
+#else
+   #define BENCH_GHASH "4-bit table"
+#endif
+
+
+/**
+ * @brief Textbook AES context
+ **/
+
+typedef struct
+{
+   uint_t nr;         ///<Number of rounds
+   uint8_t rk[240];   ///<Round keys
+} RefAesContext;
+
+
+/**
+ * @brief Block cipher modes
+ **/
+
+typedef enum
+{
+   BENCH_MODE_ECB = 0,
+   BENCH_MODE_CBC = 1,
+   BENCH_MODE_CTR = 2,
+   BENCH_MODE_GCM = 3
+} BenchMode;
+
+
+//Textbook AES related functions
+static error_t refAesInit(RefAesContext *context, const uint8_t *key, size_t keyLength);
+static void refAesEncryptBlock(RefAesContext *context, const uint8_t *input, uint8_t *output);
+static void refAesDecryptBlock(RefAesContext *context, const uint8_t *input, uint8_t *output);
+
+//Common interface of the textbook cipher
+static const CipherAlgo refAesCipherAlgo =
+{
+   "AES (textbook)",
+   sizeof(RefAesContext),
+   CIPHER_ALGO_TYPE_BLOCK,
+   AES_BLOCK_SIZE,
+   (CipherAlgoInit) refAesInit,
+   NULL,
+   NULL,
+   (CipherAlgoEncryptBlock) refAesEncryptBlock,
+   (CipherAlgoDecryptBlock) refAesDecryptBlock,
+   NULL,
+   NULL
+};
+
+//Names of the modes
+static const char_t *modeName[] = {"ECB", "CBC", "CTR", "GCM"};
+
+//FIPS-197 test vectors (appendix C)
+static const uint8_t testKey[32] =
+{
+   0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+   0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F
+};
+
+static const uint8_t testPlaintext[16] =
+{
+   0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+};
+
+static const uint8_t testCiphertext[3][16] =
+{
+   {0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A},
+   {0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0, 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91},
+   {0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF, 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89}
+};
+
+//GCM test cases 4 and 6 (AES-128)
+static const uint8_t gcmTestKey[16] =
+{
+   0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08
+};
+
+static const uint8_t gcmTestPlaintext[60] =
+{
+   0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59, 0x09, 0xC5, 0xAF, 0xF5, 0x26, 0x9A,
+   0x86, 0xA7, 0xA9, 0x53, 0x15, 0x34, 0xF7, 0xDA, 0x2E, 0x4C, 0x30, 0x3D, 0x8A, 0x31, 0x8A, 0x72,
+   0x1C, 0x3C, 0x0C, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2F, 0xCF, 0x0E, 0x24, 0x49, 0xA6, 0xB5, 0x25,
+   0xB1, 0x6A, 0xED, 0xF5, 0xAA, 0x0D, 0xE6, 0x57, 0xBA, 0x63, 0x7B, 0x39
+};
+
+static const uint8_t gcmTestAad[20] =
+{
+   0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF,
+   0xAB, 0xAD, 0xDA, 0xD2
+};
+
+static const uint8_t gcmTestIv4[12] =
+{
+   0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88
+};
+
+static const uint8_t gcmTestIv6[60] =
+{
+   0x93, 0x13, 0x22, 0x5D, 0xF8, 0x84, 0x06, 0xE5, 0x55, 0x90, 0x9C, 0x5A, 0xFF, 0x52, 0x69, 0xAA,
+   0x6A, 0x7A, 0x95, 0x38, 0x53, 0x4F, 0x7D, 0xA1, 0xE4, 0xC3, 0x03, 0xD2, 0xA3, 0x18, 0xA7, 0x28,
+   0xC3, 0xC0, 0xC9, 0x51, 0x56, 0x80, 0x95, 0x39, 0xFC, 0xF0, 0xE2, 0x42, 0x9A, 0x6B, 0x52, 0x54,
+   0x16, 0xAE, 0xDB, 0xF5, 0xA0, 0xDE, 0x6A, 0x57, 0xA6, 0x37, 0xB3, 0x9B
+};
+
+static const uint8_t gcmTestCiphertext[2][60] =
+{
+   {
+      0x42, 0x83, 0x1E, 0xC2, 0x21, 0x77, 0x74, 0x24, 0x4B, 0x72, 0x21, 0xB7, 0x84, 0xD0, 0xD4, 0x9C,
+      0xE3, 0xAA, 0x21, 0x2F, 0x2C, 0x02, 0xA4, 0xE0, 0x35, 0xC1, 0x7E, 0x23, 0x29, 0xAC, 0xA1, 0x2E,
+      0x21, 0xD5, 0x14, 0xB2, 0x54, 0x66, 0x93, 0x1C, 0x7D, 0x8F, 0x6A, 0x5A, 0xAC, 0x84, 0xAA, 0x05,
+      0x1B, 0xA3, 0x0B, 0x39, 0x6A, 0x0A, 0xAC, 0x97, 0x3D, 0x58, 0xE0, 0x91
+   },
+   {
+      0x8C, 0xE2, 0x49, 0x98, 0x62, 0x56, 0x15, 0xB6, 0x03, 0xA0, 0x33, 0xAC, 0xA1, 0x3F, 0xB8, 0x94,
+      0xBE, 0x91, 0x12, 0xA5, 0xC3, 0xA2, 0x11, 0xA8, 0xBA, 0x26, 0x2A, 0x3C, 0xCA, 0x7E, 0x2C, 0xA7,
+      0x01, 0xE4, 0xA9, 0xA4, 0xFB, 0xA4, 0x3C, 0x90, 0xCC, 0xDC, 0xB2, 0x81, 0xD4, 0x8C, 0x7C, 0x6F,
+      0xD6, 0x28, 0x75, 0xD2, 0xAC, 0xA4, 0x17, 0x03, 0x4C, 0x34, 0xAE, 0xE5
+   }
+};
+
+static const uint8_t gcmTestTag[2][16] =
+{
+   {0x5B, 0xC9, 0x4F, 0xBC, 0x32, 0x21, 0xA5, 0xDB, 0x94, 0xFA, 0xE9, 0x5A, 0xE7, 0x12, 0x1A, 0x47},
+   {0x61, 0x9C, 0xC5, 0xAE, 0xFF, 0xFE, 0x0B, 0xFA, 0x46, 0x2A, 0xF4, 0x3C, 0x16, 0x99, 0xD0, 0x50}
+};
+
+//Chunk lengths fed to the incremental interface
+static const size_t gcmChunkLength[] = {1, 15, 3, 17, 5, 33, 7};
+
+//S-box and inverse S-box of the textbook cipher
+static uint8_t sbox[256];
+static uint8_t isbox[256];
+//Multiplication by x in GF(2^8)
+static uint8_t mul2[256];
+
+//Global variables
+static uint8_t plaintext[BENCH_SIZE];
+static uint8_t ciphertext[BENCH_SIZE];
+static uint8_t refCiphertext[BENCH_SIZE];
+static uint8_t decrypted[BENCH_SIZE];
+static uint_t failures;
+
+
+/**
+ * @brief Multiplication by x in GF(2^8)
+ * @param[in] a Operand
+ * @return Product
+ **/
+
+static uint8_t refXtime(uint8_t a)
+{
+   return (a << 1) ^ ((a & 0x80) ? 0x1B : 0x00);
+}
+
+
+/**
+ * @brief Compute the S-box, its inverse and the multiplication table
+ **/
+
+static void refAesInitSbox(void)
+{
+   uint_t i;
+   uint8_t p;
+   uint8_t q;
+   uint8_t x;
+
+   //Walk through the multiplicative group, using 3 as generator
+   p = 1;
+   q = 1;
+
+   do
+   {
+      //Multiply P by 3
+      p = p ^ refXtime(p);
+
+      //Divide Q by 3
+      q ^= q << 1;
+      q ^= q << 2;
+      q ^= q << 4;
+      if(q & 0x80)
+         q ^= 0x09;
+
+      //Affine transformation of the inverse of P
+      x = q ^ (q << 1 | q >> 7) ^ (q << 2 | q >> 6) ^ (q << 3 | q >> 5) ^ (q << 4 | q >> 4);
+      sbox[p] = x ^ 0x63;
+   } while(p != 1);
+
+   //Zero has no inverse
+   sbox[0] = 0x63;
+
+   //Inverse S-box and multiplication table
+   for(i = 0; i < 256; i++)
+   {
+      isbox[sbox[i]] = i;
+      mul2[i] = refXtime(i);
+   }
+}
+
+
+/**
+ * @brief Key expansion of the textbook cipher
+ * @param[in] context Pointer to the textbook AES context
+ * @param[in] key Pointer to the key
+ * @param[in] keyLength Length of the key (16, 24 or 32 bytes)
+ * @return Error code
+ **/
+
+static error_t refAesInit(RefAesContext *context, const uint8_t *key, size_t keyLength)
+{
+   uint_t i;
+   uint_t nk;
+   uint8_t rcon;
+   uint8_t temp[4];
+
+   //Check the length of the key
+   if(keyLength != 16 && keyLength != 24 && keyLength != 32)
+      return ERROR_INVALID_KEY_LENGTH;
+
+   //Number of words of the key and number of rounds
+   nk = keyLength / 4;
+   context->nr = nk + 6;
+
+   //The first round keys are the key itself
+   memcpy(context->rk, key, keyLength);
+
+   //Generate the other round keys
+   for(rcon = 1, i = nk; i < (4 * (context->nr + 1)); i++)
+   {
+      memcpy(temp, context->rk + 4 * (i - 1), 4);
+
+      if(!(i % nk))
+      {
+         //RotWord, SubWord and round constant
+         uint8_t t = temp[0];
+         temp[0] = sbox[temp[1]] ^ rcon;
+         temp[1] = sbox[temp[2]];
+         temp[2] = sbox[temp[3]];
+         temp[3] = sbox[t];
+         rcon = refXtime(rcon);
+      }
+      else if(nk > 6 && (i % nk) == 4)
+      {
+         //SubWord
+         temp[0] = sbox[temp[0]];
+         temp[1] = sbox[temp[1]];
+         temp[2] = sbox[temp[2]];
+         temp[3] = sbox[temp[3]];
+      }
+
+      context->rk[4 * i] = context->rk[4 * (i - nk)] ^ temp[0];
+      context->rk[4 * i + 1] = context->rk[4 * (i - nk) + 1] ^ temp[1];
+      context->rk[4 * i + 2] = context->rk[4 * (i - nk) + 2] ^ temp[2];
+      context->rk[4 * i + 3] = context->rk[4 * (i - nk) + 3] ^ temp[3];
+   }
+
+   //No error to report
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief AddRoundKey transformation
+ * @param[in,out] s State
+ * @param[in] rk Round key
+ **/
+
+static void refAddRoundKey(uint8_t *s, const uint8_t *rk)
+{
+   uint_t i;
+
+   for(i = 0; i < 16; i++)
+      s[i] ^= rk[i];
+}
+
+
+/**
+ * @brief SubBytes and ShiftRows transformations (or their inverses)
+ * @param[in,out] s State
+ * @param[in] box S-box or inverse S-box
+ * @param[in] dir 1 to shift the rows to the left, 3 to shift them to the right
+ **/
+
+static void refSubShift(uint8_t *s, const uint8_t *box, uint_t dir)
+{
+   uint_t r;
+   uint_t c;
+   uint8_t t[16];
+
+   //Row r of column c is taken from column (c + r * dir) mod 4
+   for(c = 0; c < 4; c++)
+   {
+      for(r = 0; r < 4; r++)
+         t[r + 4 * c] = box[s[r + 4 * ((c + r * dir) % 4)]];
+   }
+
+   //Update the state
+   memcpy(s, t, 16);
+}
+
+
+/**
+ * @brief Common step of MixColumns and InvMixColumns on one column
+ * @param[in,out] b Column
+ * @param[in] p Term added to the even rows
+ * @param[in] q Term added to the odd rows
+ **/
+
+static void refMixColumn(uint8_t *b, uint8_t p, uint8_t q)
+{
+   uint8_t b0 = b[0];
+
+   b[0] = p ^ b[0] ^ mul2[b[0] ^ b[1]];
+   b[1] = q ^ b[1] ^ mul2[b[1] ^ b[2]];
+   b[2] = p ^ b[2] ^ mul2[b[2] ^ b[3]];
+   b[3] = q ^ b[3] ^ mul2[b[3] ^ b0];
+}
+
+
+/**
+ * @brief MixColumns transformation
+ * @param[in,out] s State
+ **/
+
+static void refMixColumns(uint8_t *s)
+{
+   uint_t i;
+   uint8_t p;
+
+   //Loop through the columns of the state array
+   for(i = 0; i < 16; i += 4, s += 4)
+   {
+      //Intermediate variable
+      p = s[0] ^ s[1] ^ s[2] ^ s[3];
+      //Apply transformation
+      refMixColumn(s, p, p);
+   }
+}
+
+
+/**
+ * @brief InvMixColumns transformation
+ * @param[in,out] s State
+ **/
+
+static void refInvMixColumns(uint8_t *s)
+{
+   uint_t i;
+   uint8_t p;
+   uint8_t q;
+
+   //Loop through the columns of the state array
+   for(i = 0; i < 16; i += 4, s += 4)
+   {
+      //Compute {09}{b0^b1^b2^b3}
+      q = s[0] ^ s[1] ^ s[2] ^ s[3];
+      q = q ^ mul2[mul2[mul2[q]]];
+      //Add {04}{b0^b2} and {04}{b1^b3}
+      p = q ^ mul2[mul2[s[0] ^ s[2]]];
+      q = q ^ mul2[mul2[s[1] ^ s[3]]];
+      //Apply transformation
+      refMixColumn(s, p, q);
+   }
+}
+
+
+/**
+ * @brief Encrypt a 16-byte block with the textbook cipher
+ * @param[in] context Pointer to the textbook AES context
+ * @param[in] input Plaintext block to encrypt
+ * @param[out] output Ciphertext block resulting from encryption
+ **/
+
+static void refAesEncryptBlock(RefAesContext *context, const uint8_t *input, uint8_t *output)
+{
+   uint_t i;
+   uint8_t s[16];
+
+   //Copy the input block to the state
+   memcpy(s, input, 16);
+   //Initial round key addition
+   refAddRoundKey(s, context->rk);
+
+   //Rounds
+   for(i = 1; i <= context->nr; i++)
+   {
+      refSubShift(s, sbox, 1);
+
+      //The last round has no MixColumns transformation
+      if(i < context->nr)
+         refMixColumns(s);
+
+      refAddRoundKey(s, context->rk + 16 * i);
+   }
+
+   //Copy the state to the output block
+   memcpy(output, s, 16);
+}
+
+
+/**
+ * @brief Decrypt a 16-byte block with the textbook cipher
+ * @param[in] context Pointer to the textbook AES context
+ * @param[in] input Ciphertext block to decrypt
+ * @param[out] output Plaintext block resulting from decryption
+ **/
+
+static void refAesDecryptBlock(RefAesContext *context, const uint8_t *input, uint8_t *output)
+{
+   uint_t i;
+   uint8_t s[16];
+
+   //Copy the input block to the state
+   memcpy(s, input, 16);
+   //Initial round key addition
+   refAddRoundKey(s, context->rk + 16 * context->nr);
+
+   //Rounds, in reverse order
+   for(i = context->nr; i > 0; i--)
+   {
+      refSubShift(s, isbox, 3);
+      refAddRoundKey(s, context->rk + 16 * (i - 1));
+
+      //The last round has no InvMixColumns transformation
+      if(i > 1)
+         refInvMixColumns(s);
+   }
+
+   //Copy the state to the output block
+   memcpy(output, s, 16);
+}
+
+
+/**
+ * @brief Check both ciphers against the FIPS-197 test vectors
+ **/
+
+static void benchCheckVectors(void)
+{
+   uint_t i;
+   uint8_t block[16];
+   AesContext context;
+   RefAesContext refContext;
+
+   //AES-128, AES-192 and AES-256
+   for(i = 0; i < 3; i++)
+   {
+      //Current engine
+      aesInit(&context, testKey, 16 + 8 * i);
+      aesEncryptBlock(&context, testPlaintext, block);
+      if(memcmp(block, testCiphertext[i], 16))
+         failures++;
+      aesDecryptBlock(&context, block, block);
+      if(memcmp(block, testPlaintext, 16))
+         failures++;
+
+      //Textbook cipher
+      refAesInit(&refContext, testKey, 16 + 8 * i);
+      refAesEncryptBlock(&refContext, testPlaintext, block);
+      if(memcmp(block, testCiphertext[i], 16))
+         failures++;
+      refAesDecryptBlock(&refContext, block, block);
+      if(memcmp(block, testPlaintext, 16))
+         failures++;
+   }
+
+   //Any error to report?
+   if(failures)
+      printf("FIPS-197 test vectors: FAILED\r\n");
+}
+
+
+/**
+ * @brief Check GCM against test cases 4 and 6 of the GCM specification
+ **/
+
+static void benchCheckGcm(void)
+{
+   uint_t i;
+   uint_t j;
+   uint_t errors;
+   size_t k;
+   size_t n;
+   size_t ivLen;
+   const uint8_t *iv;
+   uint8_t c[60];
+   uint8_t p[60];
+   uint8_t t[16];
+   AesContext aesContext;
+   GcmContext gcmContext;
+
+   //Initialize the AES-128 context
+   aesInit(&aesContext, gcmTestKey, 16);
+   //Errors found so far
+   errors = failures;
+
+   //96-bit IV (test case 4) and 480-bit IV (test case 6)
+   for(i = 0; i < 2; i++)
+   {
+      iv = i ? gcmTestIv6 : gcmTestIv4;
+      ivLen = i ? sizeof(gcmTestIv6) : sizeof(gcmTestIv4);
+
+      //One-shot encryption
+      gcmEncrypt(AES_CIPHER_ALGO, &aesContext, iv, ivLen, gcmTestAad, 20,
+         gcmTestPlaintext, c, 60, t, 16);
+      if(memcmp(c, gcmTestCiphertext[i], 60) || memcmp(t, gcmTestTag[i], 16))
+         failures++;
+
+      //One-shot decryption
+      if(gcmDecrypt(AES_CIPHER_ALGO, &aesContext, iv, ivLen, gcmTestAad, 20,
+         gcmTestCiphertext[i], p, 60, gcmTestTag[i], 16) ||
+         memcmp(p, gcmTestPlaintext, 60))
+      {
+         failures++;
+      }
+
+      //A modified tag must be rejected
+      memcpy(t, gcmTestTag[i], 16);
+      t[15] ^= 0x01;
+      if(!gcmDecrypt(AES_CIPHER_ALGO, &aesContext, iv, ivLen, gcmTestAad, 20,
+         gcmTestCiphertext[i], p, 60, t, 16))
+      {
+         failures++;
+      }
+
+      //Each chunk sequence starts at a different position
+      for(j = 0; j < arraysize(gcmChunkLength); j++)
+      {
+         //Incremental encryption
+         gcmInit(&gcmContext, AES_CIPHER_ALGO, &aesContext);
+         gcmStart(&gcmContext, iv, ivLen);
+
+         for(n = 0, k = j; n < 20; n += gcmChunkLength[k++ % arraysize(gcmChunkLength)])
+            gcmUpdateAad(&gcmContext, gcmTestAad + n,
+               min(gcmChunkLength[k % arraysize(gcmChunkLength)], 20 - n));
+
+         for(n = 0; n < 60; n += gcmChunkLength[k++ % arraysize(gcmChunkLength)])
+            gcmEncryptUpdate(&gcmContext, gcmTestPlaintext + n, c + n,
+               min(gcmChunkLength[k % arraysize(gcmChunkLength)], 60 - n));
+
+         gcmEncryptFinal(&gcmContext, t, 16);
+
+         if(memcmp(c, gcmTestCiphertext[i], 60) || memcmp(t, gcmTestTag[i], 16))
+            failures++;
+
+         //Incremental decryption, with the context of the previous message
+         gcmStart(&gcmContext, iv, ivLen);
+
+         for(n = 0; n < 20; n += gcmChunkLength[k++ % arraysize(gcmChunkLength)])
+            gcmUpdateAad(&gcmContext, gcmTestAad + n,
+               min(gcmChunkLength[k % arraysize(gcmChunkLength)], 20 - n));
+
+         for(n = 0; n < 60; n += gcmChunkLength[k++ % arraysize(gcmChunkLength)])
+            gcmDecryptUpdate(&gcmContext, gcmTestCiphertext[i] + n, p + n,
+               min(gcmChunkLength[k % arraysize(gcmChunkLength)], 60 - n));
+
+         if(gcmDecryptFinal(&gcmContext, gcmTestTag[i], 16) ||
+            memcmp(p, gcmTestPlaintext, 60))
+         {
+            failures++;
+         }
+      }
+   }
+
+   //Display result
+   printf("GCM test cases 4 and 6 (%s GHASH): %s\r\n", BENCH_GHASH,
+      (failures != errors) ? "FAILED" : "OK");
+}
+
+
+/**
+ * @brief Encrypt or decrypt the buffer in the given mode
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher context
+ * @param[in] mode Block cipher mode
+ * @param[in] input Data to process
+ * @param[out] output Resulting data
+ * @param[in,out] tag Authentication tag (GCM only)
+ * @param[in] decrypt Decrypt instead of encrypt
+ * @return Number of cycles
+ **/
+
+static uint64_t benchProcess(const CipherAlgo *cipher, void *context, BenchMode mode,
+   const uint8_t *input, uint8_t *output, uint8_t *tag, bool_t decrypt)
+{
+   error_t error;
+   uint64_t cycles;
+   uint8_t iv[16];
+
+   //Same IV or initial counter block every time
+   memset(iv, 0x5A, sizeof(iv));
+
+   //Start of the measurement
+   cycles = benchGetCycles();
+
+   //Process the buffer
+   if(mode == BENCH_MODE_ECB && !decrypt)
+      error = ecbEncrypt(cipher, context, input, output, BENCH_SIZE);
+   else if(mode == BENCH_MODE_ECB)
+      error = ecbDecrypt(cipher, context, input, output, BENCH_SIZE);
+   else if(mode == BENCH_MODE_CBC && !decrypt)
+      error = cbcEncrypt(cipher, context, iv, input, output, BENCH_SIZE);
+   else if(mode == BENCH_MODE_CBC)
+      error = cbcDecrypt(cipher, context, iv, input, output, BENCH_SIZE);
+   else if(mode == BENCH_MODE_CTR && !decrypt)
+      error = ctrEncrypt(cipher, context, 32, iv, input, output, BENCH_SIZE);
+   else if(mode == BENCH_MODE_CTR)
+      error = ctrDecrypt(cipher, context, 32, iv, input, output, BENCH_SIZE);
+   else if(!decrypt)
+      error = gcmEncrypt(cipher, context, iv, 12, plaintext, 13, input, output,
+         BENCH_SIZE, tag, 16);
+   else
+      error = gcmDecrypt(cipher, context, iv, 12, plaintext, 13, input, output,
+         BENCH_SIZE, tag, 16);
+
+   //End of the measurement
+   cycles = benchGetCycles() - cycles;
+
+   //Any error to report?
+   if(error)
+      failures++;
+
+   //Return the number of cycles
+   return cycles;
+}
+
+
+/**
+ * @brief Measure a cipher in the given mode
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher context
+ * @param[in] mode Block cipher mode
+ * @param[out] output Ciphertext
+ * @param[out] tag Authentication tag (GCM only)
+ * @param[out] encCycles Cycles per byte to encrypt
+ * @param[out] decCycles Cycles per byte to decrypt
+ **/
+
+static void benchMode(const CipherAlgo *cipher, void *context, BenchMode mode,
+   uint8_t *output, uint8_t *tag, double *encCycles, double *decCycles)
+{
+   uint_t i;
+   uint64_t n;
+   uint64_t enc;
+   uint64_t dec;
+
+   //Keep the best of several runs
+   for(enc = UINT64_MAX, dec = UINT64_MAX, i = 0; i < BENCH_RUNS; i++)
+   {
+      //Encrypt the buffer
+      n = benchProcess(cipher, context, mode, plaintext, output, tag, FALSE);
+      enc = min(enc, n);
+
+      //Decrypt it back
+      n = benchProcess(cipher, context, mode, output, decrypted, tag, TRUE);
+      dec = min(dec, n);
+
+      //Check the round trip
+      if(memcmp(decrypted, plaintext, BENCH_SIZE))
+         failures++;
+   }
+
+   //Cycles per byte
+   *encCycles = (double) enc / BENCH_SIZE;
+   *decCycles = (double) dec / BENCH_SIZE;
+}
+
+
+/**
+ * @brief Measure AES with a given key length
+ * @param[in] keyLength Length of the key
+ **/
+
+static void benchRun(size_t keyLength)
+{
+   uint_t mode;
+   uint8_t tag[16];
+   uint8_t refTag[16];
+   double enc;
+   double dec;
+   double refEnc;
+   double refDec;
+   AesContext context;
+   RefAesContext refContext;
+
+   //Initialize both ciphers with the same key
+   aesInit(&context, testKey, keyLength);
+   refAesInit(&refContext, testKey, keyLength);
+
+   //Measure each mode
+   for(mode = BENCH_MODE_ECB; mode <= BENCH_MODE_GCM; mode++)
+   {
+      //Current engine
+      benchMode(AES_CIPHER_ALGO, &context, mode, ciphertext, tag, &enc, &dec);
+      //Textbook cipher
+      benchMode(&refAesCipherAlgo, &refContext, mode, refCiphertext, refTag, &refEnc, &refDec);
+
+      //Both ciphers must produce the same ciphertext and tag
+      if(memcmp(ciphertext, refCiphertext, BENCH_SIZE) ||
+         (mode == BENCH_MODE_GCM && memcmp(tag, refTag, 16)))
+      {
+         failures++;
+      }
+
+      //Display results
+      printf("AES-%u %-4s %9.1f %9.1f %9.1f %9.1f %7.1fx\r\n", (uint_t) keyLength * 8,
+         modeName[mode], refEnc, refDec, enc, dec, refEnc / enc);
+   }
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   uint_t i;
+
+   //Initialize debug output
+   debugInit();
+
+#if (AES_NI_SUPPORT == ENABLED || GCM_PCLMUL_SUPPORT == ENABLED)
+   //The host processor must support the instructions the program was built for
+   if(!__builtin_cpu_supports("aes") || !__builtin_cpu_supports("pclmul"))
+   {
+      printf("AES-NI or PCLMULQDQ not supported by this processor, skipped\r\n");
+      return EXIT_SUCCESS;
+   }
+#endif
+
+   //Compute the tables of the textbook cipher
+   refAesInitSbox();
+
+   //Check both ciphers against the test vectors
+   benchCheckVectors();
+   //Check GCM against its known answers
+   benchCheckGcm();
+
+   //Data to encrypt
+   for(i = 0; i < BENCH_SIZE; i++)
+      plaintext[i] = i * 7 + 3;
+
+   //Display header
+   printf("%u-byte buffers, cycles per byte (textbook cipher against %s engine)\r\n",
+      BENCH_SIZE, BENCH_ENGINE);
+   printf("%-9s %9s %9s %9s %9s %8s\r\n", "Cipher", "text enc", "text dec",
+      "encrypt", "decrypt", "speedup");
+
+   //Measure AES-128 and AES-256
+   benchRun(16);
+   benchRun(32);
+
+   //Display result
+   printf("AES (%s): %s\r\n", BENCH_ENGINE, failures ? "FAILED" : "OK");
+
+   //Return status code
+   return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
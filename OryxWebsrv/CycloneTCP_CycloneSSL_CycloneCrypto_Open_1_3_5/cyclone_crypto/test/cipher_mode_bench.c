@@ -0,0 +1,311 @@
+/**
+ * @file cipher_mode_bench.c
+ * @brief Block cipher mode throughput benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * AES-128 is run in ECB, CBC, CTR and GCM modes over 1 KB, 16 KB and 1 MB
+ * buffers, twice: through the multi-block entry points of the cipher, so
+ * that the modes process CIPHER_MODE_BATCH_SIZE blocks per iteration, and
+ * through a copy of the cipher that only has single-block entry points,
+ * which the modes then call one block at a time. Both must produce the
+ * same ciphertexts and tags, and every buffer must decrypt back to the
+ * plaintext. The throughput is the best of several runs. The program is
+ * built with the portable engine, with AES-NI (whose multi-block entry
+ * points interleave several blocks) and with worker tasks, in which case
+ * 1 MB buffers are split across CIPHER_MODE_WORKER_COUNT tasks (see
+ * demo/posix/Makefile)
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "crypto.h"
+#include "aes.h"
+#include "cipher_mode_ecb.h"
+#include "cipher_mode_cbc.h"
+#include "cipher_mode_ctr.h"
+#include "cipher_mode_gcm.h"
+#include "cipher_mode_misc.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Size of the largest buffer
+#define BENCH_SIZE (1024 * 1024)
+//Amount of data processed per measurement
+#define BENCH_VOLUME (1024 * 1024)
+//Number of measurements (the best one is kept)
+#define BENCH_RUNS 5
+
+//AES engine being measured
+#if (AES_NI_SUPPORT == ENABLED)
+   #define BENCH_ENGINE "AES-NI"
+#else
+   #define BENCH_ENGINE "T-table"
+#endif
+
+
+/**
+ * @brief Block cipher modes
+ **/
+
+typedef enum
+{
+   BENCH_MODE_ECB = 0,
+   BENCH_MODE_CBC = 1,
+   BENCH_MODE_CTR = 2,
+   BENCH_MODE_GCM = 3
+} BenchMode;
+
+
+//Mode names
+static const char_t *modeName[] = {"ECB", "CBC", "CTR", "GCM"};
+
+//Buffer lengths
+static const size_t length[] = {1024, 16384, BENCH_SIZE};
+
+//AES-128 key
+static const uint8_t testKey[16] =
+{
+   0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+   0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+
+//Global variables
+static CipherAlgo singleBlockAlgo;
+static uint8_t plaintext[BENCH_SIZE];
+static uint8_t ciphertext[BENCH_SIZE];
+static uint8_t refCiphertext[BENCH_SIZE];
+static uint8_t decrypted[BENCH_SIZE];
+static uint_t failures;
+
+
+/**
+ * @brief Encrypt or decrypt a buffer in the given mode
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher context
+ * @param[in] mode Block cipher mode
+ * @param[in] input Data to process
+ * @param[out] output Resulting data
+ * @param[in] length Number of bytes to process
+ * @param[in,out] tag Authentication tag (GCM only)
+ * @param[in] decrypt Decrypt rather than encrypt
+ **/
+
+static void benchProcess(const CipherAlgo *cipher, void *context, BenchMode mode,
+   const uint8_t *input, uint8_t *output, size_t length, uint8_t *tag, bool_t decrypt)
+{
+   error_t error;
+   uint8_t iv[16];
+
+   //Same IV or initial counter block every time
+   memset(iv, 0x5A, sizeof(iv));
+
+   //Process the buffer
+   if(mode == BENCH_MODE_ECB && !decrypt)
+      error = ecbEncrypt(cipher, context, input, output, length);
+   else if(mode == BENCH_MODE_ECB)
+      error = ecbDecrypt(cipher, context, input, output, length);
+   else if(mode == BENCH_MODE_CBC && !decrypt)
+      error = cbcEncrypt(cipher, context, iv, input, output, length);
+   else if(mode == BENCH_MODE_CBC)
+      error = cbcDecrypt(cipher, context, iv, input, output, length);
+   else if(mode == BENCH_MODE_CTR && !decrypt)
+      error = ctrEncrypt(cipher, context, 32, iv, input, output, length);
+   else if(mode == BENCH_MODE_CTR)
+      error = ctrDecrypt(cipher, context, 32, iv, input, output, length);
+   else if(!decrypt)
+      error = gcmEncrypt(cipher, context, iv, 12, testKey, 13, input, output,
+         length, tag, 16);
+   else
+      error = gcmDecrypt(cipher, context, iv, 12, testKey, 13, input, output,
+         length, tag, 16);
+
+   //Any error to report?
+   if(error)
+      failures++;
+}
+
+
+/**
+ * @brief Measure a cipher in the given mode
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher context
+ * @param[in] mode Block cipher mode
+ * @param[in] length Length of the buffers
+ * @param[out] output Ciphertext
+ * @param[out] tag Authentication tag (GCM only)
+ * @param[out] encRate Encryption throughput (MB/s)
+ * @param[out] decRate Decryption throughput (MB/s)
+ **/
+
+static void benchMode(const CipherAlgo *cipher, void *context, BenchMode mode,
+   size_t length, uint8_t *output, uint8_t *tag, double *encRate, double *decRate)
+{
+   uint_t i;
+   uint_t j;
+   uint_t count;
+   uint64_t n;
+   uint64_t enc;
+   uint64_t dec;
+
+   //Number of buffers per measurement
+   count = max(BENCH_VOLUME / length, 1);
+
+   //Keep the best of several runs
+   for(enc = UINT64_MAX, dec = UINT64_MAX, i = 0; i < BENCH_RUNS; i++)
+   {
+      //Encrypt the buffers
+      for(n = benchGetTime(), j = 0; j < count; j++)
+         benchProcess(cipher, context, mode, plaintext, output, length, tag, FALSE);
+      enc = min(enc, benchGetTime() - n);
+
+      //Decrypt them back
+      for(n = benchGetTime(), j = 0; j < count; j++)
+         benchProcess(cipher, context, mode, output, decrypted, length, tag, TRUE);
+      dec = min(dec, benchGetTime() - n);
+
+      //Check the round trip
+      if(memcmp(decrypted, plaintext, length))
+         failures++;
+   }
+
+   //Throughput
+   *encRate = benchMbps((uint64_t) count * length, enc);
+   *decRate = benchMbps((uint64_t) count * length, dec);
+}
+
+
+/**
+ * @brief Measure each mode with a given buffer length
+ * @param[in] context AES context
+ * @param[in] length Length of the buffers
+ **/
+
+static void benchRun(AesContext *context, size_t length)
+{
+   uint_t mode;
+   uint8_t tag[16];
+   uint8_t refTag[16];
+   double enc;
+   double dec;
+   double refEnc;
+   double refDec;
+
+   //Measure each mode
+   for(mode = BENCH_MODE_ECB; mode <= BENCH_MODE_GCM; mode++)
+   {
+      //One block at a time
+      benchMode(&singleBlockAlgo, context, mode, length, refCiphertext, refTag,
+         &refEnc, &refDec);
+      //Several blocks at a time
+      benchMode(AES_CIPHER_ALGO, context, mode, length, ciphertext, tag, &enc, &dec);
+
+      //Both must produce the same ciphertext and tag
+      if(memcmp(ciphertext, refCiphertext, length) ||
+         (mode == BENCH_MODE_GCM && memcmp(tag, refTag, 16)))
+      {
+         failures++;
+      }
+
+      //Display results
+      printf("%-4s %7u %9.1f %9.1f %9.1f %9.1f %7.1fx\r\n", modeName[mode],
+         (uint_t) length, refEnc, refDec, enc, dec, enc / refEnc);
+   }
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   uint_t i;
+   AesContext context;
+
+   //Initialize debug output
+   debugInit();
+
+#if (AES_NI_SUPPORT == ENABLED || GCM_PCLMUL_SUPPORT == ENABLED)
+   //The host processor must support the instructions the program was built for
+   if(!__builtin_cpu_supports("aes") || !__builtin_cpu_supports("pclmul"))
+   {
+      printf("AES-NI or PCLMULQDQ not supported by this processor, skipped\r\n");
+      return EXIT_SUCCESS;
+   }
+#endif
+
+#if (CIPHER_MODE_WORKER_SUPPORT == ENABLED)
+   //Start the worker tasks
+   error = cipherModeWorkerInit();
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the worker tasks!\r\n");
+      return EXIT_FAILURE;
+   }
+#endif
+
+   //Same cipher, without its multi-block entry points
+   singleBlockAlgo = *AES_CIPHER_ALGO;
+   singleBlockAlgo.encryptBlocks = NULL;
+   singleBlockAlgo.decryptBlocks = NULL;
+
+   //Initialize the AES-128 context
+   error = aesInit(&context, testKey, sizeof(testKey));
+   //Any error to report?
+   if(error)
+      return EXIT_FAILURE;
+
+   //Data to encrypt
+   for(i = 0; i < BENCH_SIZE; i++)
+      plaintext[i] = i * 7 + 3;
+
+   //Display header
+#if (CIPHER_MODE_WORKER_SUPPORT == ENABLED)
+   printf("AES-128 (%s), MB/s, %u worker tasks above %u bytes\r\n", BENCH_ENGINE,
+      CIPHER_MODE_WORKER_COUNT, CIPHER_MODE_WORKER_THRESHOLD);
+#else
+   printf("AES-128 (%s), MB/s, no worker tasks\r\n", BENCH_ENGINE);
+#endif
+   printf("%-4s %7s %9s %9s %9s %9s %8s\r\n", "Mode", "length", "1-blk enc",
+      "1-blk dec", "encrypt", "decrypt", "speedup");
+
+   //Measure each buffer length
+   for(i = 0; i < arraysize(length); i++)
+      benchRun(&context, length[i]);
+
+   //Display result
+   printf("Cipher modes (%s): %s\r\n", BENCH_ENGINE, failures ? "FAILED" : "OK");
+
+   //Return status code
+   return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+/**
+ * @file cipher_mode_worker_test.c
+ * @brief Worker tasks of the block cipher modes
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The program is built with many worker tasks and a low threshold (see
+ * demo/posix/Makefile), so that most buffers are split into slices of a
+ * few blocks, and slice boundaries fall at every possible position. Every
+ * operation is first run before the worker tasks are started, which gives
+ * the single-threaded results, then again once they are running. ECB, CBC
+ * decryption (in place or not), CTR (with a counter that wraps around in
+ * the middle of the buffer) and GCM are checked with AES-128 and, except
+ * for GCM, with Triple DES, whose blocks are 8 bytes long. The outputs,
+ * the updated IVs and counters and the GCM tags must be identical
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "crypto.h"
+#include "aes.h"
+#include "des3.h"
+#include "cipher_mode_ecb.h"
+#include "cipher_mode_cbc.h"
+#include "cipher_mode_ctr.h"
+#include "cipher_mode_gcm.h"
+#include "cipher_mode_misc.h"
+#include "debug.h"
+
+//Size of the largest buffer
+#define TEST_SIZE (96 * 1024)
+
+
+/**
+ * @brief Operations
+ **/
+
+typedef enum
+{
+   TEST_OP_ECB_ENCRYPT         = 0,
+   TEST_OP_ECB_DECRYPT         = 1,
+   TEST_OP_CBC_DECRYPT         = 2,
+   TEST_OP_CBC_DECRYPT_INPLACE = 3,
+   TEST_OP_CTR                 = 4,
+   TEST_OP_CTR_WRAP            = 5,
+   TEST_OP_GCM_ENCRYPT         = 6,
+   TEST_OP_GCM_DECRYPT         = 7,
+   TEST_OP_COUNT               = 8
+} TestOp;
+
+
+/**
+ * @brief Single-threaded result of an operation
+ **/
+
+typedef struct
+{
+   uint8_t *output;
+   uint8_t state[16];
+} TestResult;
+
+
+//Operation names
+static const char_t *opName[] = {"ECB enc", "ECB dec", "CBC dec", "CBC dec in place",
+   "CTR", "CTR wrap", "GCM enc", "GCM dec"};
+
+//Buffer lengths (below, around and well above the threshold)
+static const size_t length[] = {16, 240, 256, 264, 272, 1000, 4096, 4100,
+   65536, 65543, 98304};
+
+//Key (AES-128 uses the first 16 bytes)
+static const uint8_t testKey[24] =
+{
+   0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+   0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+   0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17
+};
+
+//Global variables
+static AesContext aesContext;
+static Des3Context des3Context;
+static uint8_t input[TEST_SIZE];
+static uint8_t output[TEST_SIZE];
+static TestResult result[2][arraysize(length)][TEST_OP_COUNT];
+static uint_t failures;
+
+
+/**
+ * @brief Run an operation
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher context
+ * @param[in] op Operation
+ * @param[in] length Number of bytes to process
+ * @param[out] state IV, counter or tag after the operation
+ * @return Error code
+ **/
+
+static error_t testRun(const CipherAlgo *cipher, void *context, TestOp op,
+   size_t length, uint8_t *state)
+{
+   error_t error;
+   uint8_t iv[12];
+
+   //Modes other than CTR and GCM only process complete blocks
+   if(op <= TEST_OP_CBC_DECRYPT_INPLACE)
+      length -= length % cipher->blockSize;
+
+   //Same IV or initial counter block every time
+   memset(iv, 0x5A, sizeof(iv));
+   memset(state, 0x5A, 16);
+
+   //The counter of the wrap-around case overflows after 12 blocks
+   if(op == TEST_OP_CTR_WRAP)
+   {
+      state[cipher->blockSize - 2] = 0xFF;
+      state[cipher->blockSize - 1] = 0xF4;
+   }
+
+   //Process the buffer
+   switch(op)
+   {
+   case TEST_OP_ECB_ENCRYPT:
+      error = ecbEncrypt(cipher, context, input, output, length);
+      break;
+   case TEST_OP_ECB_DECRYPT:
+      error = ecbDecrypt(cipher, context, input, output, length);
+      break;
+   case TEST_OP_CBC_DECRYPT:
+      error = cbcDecrypt(cipher, context, state, input, output, length);
+      break;
+   case TEST_OP_CBC_DECRYPT_INPLACE:
+      memcpy(output, input, length);
+      error = cbcDecrypt(cipher, context, state, output, output, length);
+      break;
+   case TEST_OP_CTR:
+      error = ctrEncrypt(cipher, context, cipher->blockSize * 8, state,
+         input, output, length);
+      break;
+   case TEST_OP_CTR_WRAP:
+      error = ctrEncrypt(cipher, context, 16, state, input, output, length);
+      break;
+   case TEST_OP_GCM_ENCRYPT:
+      error = gcmEncrypt(cipher, context, iv, sizeof(iv), testKey, 13, input,
+         output, length, state, 16);
+      break;
+   default:
+      //Encrypt the buffer, then decrypt it in place
+      error = gcmEncrypt(cipher, context, iv, sizeof(iv), testKey, 13, input,
+         output, length, state, 16);
+      if(!error)
+         error = gcmDecrypt(cipher, context, iv, sizeof(iv), testKey, 13, output,
+            output, length, state, 16);
+      //The plaintext must be recovered
+      if(!error && memcmp(output, input, length))
+         error = ERROR_FAILURE;
+      break;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Run every operation over every length
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher context
+ * @param[in] index Index of the cipher in the result table
+ * @param[in] workers The worker tasks are running
+ **/
+
+static void testPass(const CipherAlgo *cipher, void *context, uint_t index,
+   bool_t workers)
+{
+   uint_t i;
+   uint_t op;
+   error_t error;
+   TestResult *ref;
+   uint8_t state[16];
+
+   //Loop through the buffer lengths
+   for(i = 0; i < arraysize(length); i++)
+   {
+      //Loop through the operations
+      for(op = 0; op < TEST_OP_COUNT; op++)
+      {
+         //GCM is only defined for 128-bit block ciphers
+         if(op >= TEST_OP_GCM_ENCRYPT && cipher->blockSize != 16)
+            continue;
+
+         //Run the operation
+         error = testRun(cipher, context, op, length[i], state);
+
+         //Point to the single-threaded result
+         ref = &result[index][i][op];
+
+         //First pass?
+         if(!workers)
+         {
+            //Save the result
+            ref->output = malloc(length[i]);
+            if(ref->output)
+               memcpy(ref->output, output, length[i]);
+            memcpy(ref->state, state, 16);
+         }
+
+         //Compare with the single-threaded result
+         if(error || !ref->output || memcmp(output, ref->output, length[i] -
+            ((op <= TEST_OP_CBC_DECRYPT_INPLACE) ? length[i] % cipher->blockSize : 0)) ||
+            memcmp(state, ref->state, 16))
+         {
+            printf("%s, %s, %u bytes: mismatch\r\n", cipher->name, opName[op],
+               (uint_t) length[i]);
+            failures++;
+         }
+
+         //Release the result once it has been checked
+         if(workers)
+         {
+            free(ref->output);
+            ref->output = NULL;
+         }
+      }
+   }
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   uint_t i;
+
+   //Initialize debug output
+   debugInit();
+
+   //Data to process
+   for(i = 0; i < TEST_SIZE; i++)
+      input[i] = i * 7 + (i >> 9);
+
+   //Initialize the cipher contexts
+   error = aesInit(&aesContext, testKey, 16);
+   if(!error)
+      error = des3Init(&des3Context, testKey, 24);
+   //Any error to report?
+   if(error)
+      return EXIT_FAILURE;
+
+   //The calling task processes all the data
+   if(cipherModeGetSliceCount(TEST_SIZE) != 1)
+      failures++;
+
+   //Single-threaded results
+   testPass(AES_CIPHER_ALGO, &aesContext, 0, FALSE);
+   testPass(DES3_CIPHER_ALGO, &des3Context, 1, FALSE);
+
+   //Start the worker tasks
+   error = cipherModeWorkerInit();
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the worker tasks!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Buffers above the threshold are now split
+   if(cipherModeGetSliceCount(CIPHER_MODE_WORKER_THRESHOLD - 1) != 1 ||
+      cipherModeGetSliceCount(CIPHER_MODE_WORKER_THRESHOLD) != (CIPHER_MODE_WORKER_COUNT + 1))
+   {
+      failures++;
+   }
+
+   //Same operations, split across the worker tasks
+   testPass(AES_CIPHER_ALGO, &aesContext, 0, TRUE);
+   testPass(DES3_CIPHER_ALGO, &des3Context, 1, TRUE);
+
+   //Display result
+   printf("Cipher mode workers (%u slices above %u bytes): %s\r\n",
+      CIPHER_MODE_WORKER_COUNT + 1, CIPHER_MODE_WORKER_THRESHOLD,
+      failures ? "FAILED" : "OK");
+
+   //Return status code
+   return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
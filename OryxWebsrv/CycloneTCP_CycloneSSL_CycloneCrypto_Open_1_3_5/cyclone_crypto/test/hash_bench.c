@@ -0,0 +1,265 @@
+/**
+ * @file hash_bench.c
+ * @brief Hash algorithm benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Every hash algorithm of the library is first checked against the digest
+ * of "abc" given by its specification, and the one-shot digest of a large
+ * message is compared with the one obtained by feeding the same message,
+ * misaligned, in chunks of varying length. The throughput of the one-shot
+ * compute function is then measured for 64-byte, 1 KB, 16 KB and 1 MB
+ * messages, in cycles per byte of the time stamp counter. The program is
+ * built once with the portable compression functions and once with the
+ * SHA-NI backends of SHA-1 and SHA-256 (see demo/posix/Makefile)
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "crypto.h"
+#include "md2.h"
+#include "md4.h"
+#include "md5.h"
+#include "ripemd128.h"
+#include "ripemd160.h"
+#include "sha1.h"
+#include "sha224.h"
+#include "sha256.h"
+#include "sha384.h"
+#include "sha512.h"
+#include "sha512_224.h"
+#include "sha512_256.h"
+#include "tiger.h"
+#include "whirlpool.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Size of the largest message
+#define BENCH_SIZE (1024 * 1024)
+//Amount of data hashed per measurement
+#define BENCH_VOLUME (1024 * 1024)
+//Number of measurements (the best one is kept)
+#define BENCH_RUNS 3
+
+//Compression functions being measured
+#if (SHA1_NI_SUPPORT == ENABLED || SHA256_NI_SUPPORT == ENABLED)
+   #define BENCH_ENGINE "SHA-NI"
+#else
+   #define BENCH_ENGINE "portable"
+#endif
+
+
+/**
+ * @brief Hash algorithm and its known answer
+ **/
+
+typedef struct
+{
+   const HashAlgo *algo;
+   const char_t *digest;
+} BenchHash;
+
+
+//Hash algorithms, with the digest of "abc"
+static const BenchHash hash[] =
+{
+   {MD2_HASH_ALGO, "da853b0d3f88d99b30283a69e6ded6bb"},
+   {MD4_HASH_ALGO, "a448017aaf21d8525fc10ae87aa6729d"},
+   {MD5_HASH_ALGO, "900150983cd24fb0d6963f7d28e17f72"},
+   {RIPEMD128_HASH_ALGO, "c14a12199c66e4ba84636b0f69144c77"},
+   {RIPEMD160_HASH_ALGO, "8eb208f7e05d987a9b044a8e98c6b087f15a0bfc"},
+   {SHA1_HASH_ALGO, "a9993e364706816aba3e25717850c26c9cd0d89d"},
+   {SHA224_HASH_ALGO, "23097d223405d8228642a477bda255b32aadbce4bda0b3f7e36c9da7"},
+   {SHA256_HASH_ALGO, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+   {SHA384_HASH_ALGO, "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded163"
+      "1a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7"},
+   {SHA512_HASH_ALGO, "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+      "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"},
+   {SHA512_224_HASH_ALGO, "4634270f707b6a54daae7530460842e20e37ed265ceee9a43e8924aa"},
+   {SHA512_256_HASH_ALGO, "53048e2681941ef99b2e29b76b4c7dabe4c2d0c634fc6d46e0e2f13107e7af23"},
+   {TIGER_HASH_ALGO, "2aab1484e8c158f2bfb8c5ff41b57a525129131c957b5f93"},
+   {WHIRLPOOL_HASH_ALGO, "4e2448a4c6f486bb16b6562c73b4020bf3043e3a731bce721ae1b303d97e6d4c"
+      "7181eebdb6c57e277d0e34957114cbd6c797fc9d95d8b582d225292076d4eef5"}
+};
+
+//Message lengths
+static const size_t length[] = {64, 1024, 16384, BENCH_SIZE};
+
+//Global variables
+static uint8_t message[BENCH_SIZE + 8];
+static uint8_t context[MAX_HASH_CONTEXT_SIZE];
+static uint_t failures;
+
+
+/**
+ * @brief Check a hash algorithm
+ * @param[in] hash Hash algorithm and its known answer
+ **/
+
+static void benchCheck(const BenchHash *hash)
+{
+   uint_t i;
+   size_t n;
+   size_t offset;
+   char_t hex[2 * MAX_HASH_DIGEST_SIZE + 1];
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+   uint8_t ref[MAX_HASH_DIGEST_SIZE];
+   const HashAlgo *algo = hash->algo;
+
+   //Digest of "abc"
+   algo->compute("abc", 3, digest);
+
+   //Format it as a hex string
+   for(i = 0; i < algo->digestSize; i++)
+      sprintf(hex + 2 * i, "%02x", digest[i]);
+
+   //Compare it with the known answer
+   if(strcmp(hex, hash->digest))
+   {
+      printf("%s: wrong digest of \"abc\"\r\n", algo->name);
+      failures++;
+   }
+
+   //Hash the message in one shot
+   algo->compute(message + 1, BENCH_SIZE - 5, ref);
+
+   //Feed it again in chunks of varying length, from an odd address
+   algo->init(context);
+
+   for(i = 0, offset = 0; offset < (BENCH_SIZE - 5); i++, offset += n)
+   {
+      //Lengths around the block size, including several blocks at once
+      n = min((i * 37) % (3 * algo->blockSize + 1), BENCH_SIZE - 5 - offset);
+      algo->update(context, message + 1 + offset, n);
+   }
+
+   algo->final(context, digest);
+
+   //Both digests must agree
+   if(memcmp(digest, ref, algo->digestSize))
+   {
+      printf("%s: incremental digest differs from one-shot digest\r\n", algo->name);
+      failures++;
+   }
+}
+
+
+/**
+ * @brief Measure a hash algorithm
+ * @param[in] algo Hash algorithm
+ **/
+
+static void benchRun(const HashAlgo *algo)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   uint_t count;
+   uint64_t n;
+   uint64_t best;
+   uint64_t time;
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //Algorithm name
+   printf("%-12s", algo->name);
+
+   //Loop through the message lengths
+   for(i = 0; i < arraysize(length); i++)
+   {
+      //Number of messages per measurement
+      count = max(BENCH_VOLUME / length[i], 1);
+
+      //Keep the best of several runs
+      for(best = UINT64_MAX, time = 0, j = 0; j < BENCH_RUNS; j++)
+      {
+         //Start of the measurement
+         n = benchGetCycles();
+         time -= benchGetTime();
+
+         //Hash the messages
+         for(k = 0; k < count; k++)
+            algo->compute(message, length[i], digest);
+
+         //End of the measurement
+         time += benchGetTime();
+         n = benchGetCycles() - n;
+         best = min(best, n);
+      }
+
+      //Cycles per byte
+      printf(" %9.1f", (double) best / (count * length[i]));
+   }
+
+   //Average throughput on the largest messages
+   printf(" %9.1f\r\n", benchMbps((uint64_t) BENCH_RUNS * count * length[i - 1], time));
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   uint_t i;
+
+   //Initialize debug output
+   debugInit();
+
+#if (SHA1_NI_SUPPORT == ENABLED || SHA256_NI_SUPPORT == ENABLED)
+   //The host processor must support the instructions the program was built for
+   if(!__builtin_cpu_supports("sha") || !__builtin_cpu_supports("sse4.1"))
+   {
+      printf("SHA-NI not supported by this processor, skipped\r\n");
+      return EXIT_SUCCESS;
+   }
+#endif
+
+   //Message to hash
+   for(i = 0; i < sizeof(message); i++)
+      message[i] = i * 131 + (i >> 8);
+
+   //Check each algorithm
+   for(i = 0; i < arraysize(hash); i++)
+      benchCheck(&hash[i]);
+
+   //Display header
+   printf("One-shot digest, cycles per byte (%s compression functions)\r\n", BENCH_ENGINE);
+   printf("%-12s %9s %9s %9s %9s %9s\r\n", "Algo", "64 B", "1 KB", "16 KB", "1 MB", "MB/s");
+
+   //Measure each algorithm
+   for(i = 0; i < arraysize(hash); i++)
+      benchRun(hash[i].algo);
+
+   //Display result
+   printf("Hash (%s): %s\r\n", BENCH_ENGINE, failures ? "FAILED" : "OK");
+
+   //Return status code
+   return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
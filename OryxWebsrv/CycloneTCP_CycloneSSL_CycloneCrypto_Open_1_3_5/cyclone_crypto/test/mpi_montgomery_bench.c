@@ -0,0 +1,442 @@
+/**
+ * @file mpi_montgomery_bench.c
+ * @brief Montgomery multiplication benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The interleaved Montgomery multiplication and squaring kernels of mpi.c
+ * are compared with the method they replaced, where the full product was
+ * computed by mpiMul, then reduced one word at a time with a temporary
+ * integer, mpiMul, mpiAdd and mpiShiftRight. Both methods are first checked
+ * against each other on random operands, then timed for 1024-bit and
+ * 2048-bit moduli, together with a full-size modular exponentiation
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include "crypto.h"
+#include "mpi.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Number of random operands checked per modulus size
+#define CHECK_COUNT 200
+//Minimum duration of each measurement (ns)
+#define BENCH_DURATION 200000000
+
+//Global variables
+static uint32_t seed = 1;
+static uint_t failures;
+
+
+/**
+ * @brief Pseudo-random number generator (xorshift)
+ * @return Random value
+ **/
+
+static uint32_t benchRand(void)
+{
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+
+/**
+ * @brief Generate a random integer
+ * @param[out] x Resulting value
+ * @param[in] k Number of words
+ * @return Error code
+ **/
+
+static error_t benchRandMpi(Mpi *x, uint_t k)
+{
+   error_t error;
+   uint_t i;
+
+   //Make sure the integer is large enough
+   error = mpiGrow(x, k);
+   //Any error to report?
+   if(error) return error;
+
+   //Random words
+   for(i = 0; i < x->size; i++)
+      x->data[i] = (i < k) ? benchRand() : 0;
+
+   //Positive value
+   x->sign = 1;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Textbook Montgomery multiplication (X = A * B / 2^(32 * k) mod P)
+ *
+ * This is the method used before the interleaved kernels: the full product
+ * is computed first, then reduced one word at a time
+ *
+ * @param[out] x Resulting value X
+ * @param[in] a First operand A
+ * @param[in] b Second operand B
+ * @param[in] k Number of words of the modulus
+ * @param[in] p Odd modulus P
+ * @return Error code
+ **/
+
+static error_t refMontgomeryMul(Mpi *x, const Mpi *a, const Mpi *b, uint_t k, const Mpi *p)
+{
+   error_t error;
+   uint_t i;
+   uint32_t m;
+   Mpi ll;
+
+   //Initialize multiple precision integer
+   mpiInit(&ll);
+
+   //Compute the full product
+   MPI_CHECK(mpiMul(x, a, b));
+
+   //Use Newton's method to compute the inverse of P[0] mod 2^32
+   for(m = 2 - p->data[0], i = 0; i < 4; i++)
+      m = m * (2 - m * p->data[0]);
+
+   //Precompute -1/P[0] mod 2^32
+   m = ~m + 1;
+
+   //Reduce the product one word at a time
+   for(i = 0; i < k; i++)
+   {
+      MPI_CHECK(mpiSetValue(&ll, 1));
+      ll.data[0] = x->data[0] * m;
+
+      MPI_CHECK(mpiMul(&ll, p, &ll));
+      MPI_CHECK(mpiAdd(x, x, &ll));
+      MPI_CHECK(mpiShiftRight(x, MPI_INT_SIZE * 8));
+   }
+
+   //Final subtraction
+   if(mpiComp(x, p) >= 0)
+      MPI_CHECK(mpiSub(x, x, p));
+
+end:
+   //Release multiple precision integer
+   mpiFree(&ll);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Textbook modular exponentiation (X = A ^ E mod P)
+ *
+ * Binary exponentiation built on the textbook Montgomery multiplication,
+ * with R^2 mod P computed by a shift and a division
+ *
+ * @param[out] x Resulting value X
+ * @param[in] a Base A (less than P)
+ * @param[in] e Exponent E
+ * @param[in] p Odd modulus P
+ * @return Error code
+ **/
+
+static error_t refExpMod(Mpi *x, const Mpi *a, const Mpi *e, const Mpi *p)
+{
+   error_t error;
+   int_t i;
+   uint_t k;
+   Mpi b;
+   Mpi y;
+   Mpi r2;
+   Mpi one;
+
+   //Initialize multiple precision integers
+   mpiInit(&b);
+   mpiInit(&y);
+   mpiInit(&r2);
+   mpiInit(&one);
+
+   //Number of words of the modulus
+   k = mpiGetLength(p);
+
+   //Compute R^2 mod P
+   MPI_CHECK(mpiSetValue(&r2, 1));
+   MPI_CHECK(mpiShiftLeft(&r2, 2 * k * (MPI_INT_SIZE * 8)));
+   MPI_CHECK(mpiMod(&r2, &r2, p));
+
+   //Compute B = A * R mod P and Y = R mod P
+   MPI_CHECK(refMontgomeryMul(&b, a, &r2, k, p));
+   MPI_CHECK(mpiSetValue(&one, 1));
+   MPI_CHECK(refMontgomeryMul(&y, &r2, &one, k, p));
+
+   //Scan the exponent from the most significant bit
+   for(i = mpiGetBitLength(e) - 1; i >= 0; i--)
+   {
+      //Compute Y = Y^2 * R^-1 mod P
+      MPI_CHECK(refMontgomeryMul(&y, &y, &y, k, p));
+
+      //Compute Y = Y * B * R^-1 mod P
+      if(mpiGetBitValue(e, i))
+         MPI_CHECK(refMontgomeryMul(&y, &y, &b, k, p));
+   }
+
+   //Compute X = Y * R^-1 mod P
+   MPI_CHECK(refMontgomeryMul(x, &y, &one, k, p));
+
+end:
+   //Release multiple precision integers
+   mpiFree(&b);
+   mpiFree(&y);
+   mpiFree(&r2);
+   mpiFree(&one);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Generate a random odd modulus and two operands less than the modulus
+ * @param[out] p Odd modulus P with its most significant bit set
+ * @param[out] a First operand A
+ * @param[out] b Second operand B
+ * @param[in] k Number of words of the modulus
+ * @return Error code
+ **/
+
+static error_t benchRandOperands(Mpi *p, Mpi *a, Mpi *b, uint_t k)
+{
+   error_t error;
+
+   //Random modulus
+   MPI_CHECK(benchRandMpi(p, k));
+   p->data[0] |= 1;
+   p->data[k - 1] |= 0x80000000;
+
+   //Random operands, reduced modulo P
+   MPI_CHECK(benchRandMpi(a, k));
+   MPI_CHECK(mpiMod(a, a, p));
+   MPI_CHECK(benchRandMpi(b, k));
+   MPI_CHECK(mpiMod(b, b, p));
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check the Montgomery kernels against the textbook method
+ * @param[in] k Number of words of the modulus
+ **/
+
+static void benchCheck(uint_t k)
+{
+   error_t error;
+   uint_t i;
+   Mpi p;
+   Mpi a;
+   Mpi b;
+   Mpi e;
+   Mpi t;
+   Mpi x;
+   Mpi y;
+
+   //Initialize multiple precision integers
+   mpiInit(&p);
+   mpiInit(&a);
+   mpiInit(&b);
+   mpiInit(&e);
+   mpiInit(&t);
+   mpiInit(&x);
+   mpiInit(&y);
+
+   //Check random operands
+   for(error = NO_ERROR, i = 0; !error && i < CHECK_COUNT; i++)
+   {
+      //Generate a random modulus and random operands
+      error = benchRandOperands(&p, &a, &b, k);
+
+      //Corner cases
+      if(!error && i == 1)
+         error = mpiSetValue(&a, 0);
+      if(!error && i == 2)
+         error = mpiSetValue(&b, 1);
+      if(!error && i == 3)
+         error = mpiSubInt(&a, &p, 1);
+
+      //Compare the multiplication kernel with the textbook method
+      if(!error)
+         error = mpiMontgomeryMul(&x, &a, &b, k, &p, &t);
+      if(!error)
+         error = refMontgomeryMul(&y, &a, &b, k, &p);
+      if(!error && mpiComp(&x, &y))
+         error = ERROR_FAILURE;
+
+      //Compare the squaring kernel with the textbook method
+      if(!error)
+         error = mpiMontgomerySqr(&x, &a, k, &p, &t);
+      if(!error)
+         error = refMontgomeryMul(&y, &a, &a, k, &p);
+      if(!error && mpiComp(&x, &y))
+         error = ERROR_FAILURE;
+
+      //Only a few exponents are full-size, the others are 64-bit long
+      if(!error)
+         error = benchRandMpi(&e, (i < 4) ? k : 2);
+
+      //Compare the modular exponentiations
+      if(!error)
+         error = mpiExpMod(&x, &a, &e, &p);
+      if(!error)
+         error = refExpMod(&y, &a, &e, &p);
+      if(!error && mpiComp(&x, &y))
+         error = ERROR_FAILURE;
+   }
+
+   //Any error to report?
+   if(error)
+   {
+      //Update statistics
+      failures++;
+      //Debug message
+      printf("%u-bit: Montgomery kernels FAILED (operands #%u)\r\n", k * 32, i - 1);
+   }
+
+   //Release multiple precision integers
+   mpiFree(&p);
+   mpiFree(&a);
+   mpiFree(&b);
+   mpiFree(&e);
+   mpiFree(&t);
+   mpiFree(&x);
+   mpiFree(&y);
+}
+
+
+/**
+ * @brief Measure the Montgomery kernels
+ * @param[in] k Number of words of the modulus
+ **/
+
+static void benchRun(uint_t k)
+{
+   uint_t n;
+   uint64_t time;
+   double refMul;
+   double newMul;
+   double newSqr;
+   double refExp;
+   double newExp;
+   Mpi p;
+   Mpi a;
+   Mpi b;
+   Mpi e;
+   Mpi t;
+   Mpi x;
+
+   //Initialize multiple precision integers
+   mpiInit(&p);
+   mpiInit(&a);
+   mpiInit(&b);
+   mpiInit(&e);
+   mpiInit(&t);
+   mpiInit(&x);
+
+   //Random modulus, operands and full-size exponent
+   benchRandOperands(&p, &a, &b, k);
+   benchRandMpi(&e, k);
+
+   //Textbook multiplication
+   for(time = benchGetTime(), n = 0; (benchGetTime() - time) < BENCH_DURATION; n++)
+      refMontgomeryMul(&x, &a, &b, k, &p);
+   refMul = (benchGetTime() - time) / 1000.0 / n;
+
+   //Interleaved multiplication
+   for(time = benchGetTime(), n = 0; (benchGetTime() - time) < BENCH_DURATION; n++)
+      mpiMontgomeryMul(&x, &a, &b, k, &p, &t);
+   newMul = (benchGetTime() - time) / 1000.0 / n;
+
+   //Dedicated squaring
+   for(time = benchGetTime(), n = 0; (benchGetTime() - time) < BENCH_DURATION; n++)
+      mpiMontgomerySqr(&x, &a, k, &p, &t);
+   newSqr = (benchGetTime() - time) / 1000.0 / n;
+
+   //Textbook exponentiation
+   for(time = benchGetTime(), n = 0; (benchGetTime() - time) < BENCH_DURATION; n++)
+      refExpMod(&x, &a, &e, &p);
+   refExp = (benchGetTime() - time) / 1000000.0 / n;
+
+   //Current exponentiation
+   for(time = benchGetTime(), n = 0; (benchGetTime() - time) < BENCH_DURATION; n++)
+      mpiExpMod(&x, &a, &e, &p);
+   newExp = (benchGetTime() - time) / 1000000.0 / n;
+
+   //Display results
+   printf("%5u %10.2f %10.2f %10.2f %7.1fx %10.2f %10.2f %7.1fx\r\n", k * 32,
+      refMul, newMul, newSqr, refMul / newMul, refExp, newExp, refExp / newExp);
+
+   //Release multiple precision integers
+   mpiFree(&p);
+   mpiFree(&a);
+   mpiFree(&b);
+   mpiFree(&e);
+   mpiFree(&t);
+   mpiFree(&x);
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   //Initialize debug output
+   debugInit();
+
+   //Check the kernels
+   benchCheck(1024 / 32);
+   benchCheck(2048 / 32);
+
+   //Display header
+   printf("Textbook method against current code (mul/sqr in us, exp in ms)\r\n");
+   printf("%5s %10s %10s %10s %8s %10s %10s %8s\r\n", "Bits", "text mul", "mul",
+      "sqr", "speedup", "text exp", "exp", "speedup");
+
+   //Measure the kernels
+   benchRun(1024 / 32);
+   benchRun(2048 / 32);
+
+   //Display result
+   printf("Montgomery kernels: %s\r\n", failures ? "FAILED" : "OK");
+
+   //Return status code
+   return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -46,6 +46,20 @@
    #error ETH_FAST_CRC_SUPPORT parameter is invalid
 #endif
 
+//Number of bytes processed per iteration by the table-driven CRC (1, 4 or 8)
+#ifndef ETH_FAST_CRC_SLICES
+   #define ETH_FAST_CRC_SLICES 8
+#elif (ETH_FAST_CRC_SLICES != 1 && ETH_FAST_CRC_SLICES != 4 && ETH_FAST_CRC_SLICES != 8)
+   #error ETH_FAST_CRC_SLICES parameter is invalid
+#endif
+
+//CRC32 calculation using a hardware CRC unit
+#ifndef ETH_HW_CRC_SUPPORT
+   #define ETH_HW_CRC_SUPPORT DISABLED
+#elif (ETH_HW_CRC_SUPPORT != ENABLED && ETH_HW_CRC_SUPPORT != DISABLED)
+   #error ETH_HW_CRC_SUPPORT parameter is invalid
+#endif
+
 //Minimum Ethernet frame size
 #define ETH_MIN_FRAME_SIZE 64
 //Maximum Ethernet frame size
@@ -152,6 +166,12 @@ error_t ethDropMulticastAddr(NetInterface *interface, const MacAddr *macAddr);
 
 uint32_t ethCalcCrc(const void *data, size_t length);
 uint32_t ethCalcCrcEx(const ChunkedBuffer *buffer, size_t offset, size_t length);
+uint32_t ethUpdateCrc(uint32_t crc, const void *data, size_t length);
+
+//Hardware CRC calculation (provided by the target-specific code)
+#if (ETH_HW_CRC_SUPPORT == ENABLED)
+   uint32_t ethHwCalcCrc(const uint32_t *data, size_t count);
+#endif
 
 ChunkedBuffer *ethAllocBuffer(size_t length, size_t *offset);
 
@@ -134,38 +134,118 @@ error_t ipSelectSourceAddr(NetInterface **interface,
 
 
 /**
- * @brief IP checksum calculation
- * @param[in] data Pointer to the data over which to calculate the IP checksum
+ * @brief Compute the 16-bit one's complement sum of a data block
+ *
+ * The data is summed 32 bits at a time into a 64-bit accumulator, so that
+ * carries never need to be folded inside the loop. A block that starts on
+ * an odd address is processed as if it were shifted by one byte, and the
+ * result is byte-swapped afterwards (see RFC 1071, section 2)
+ *
+ * @param[in] data Pointer to the data to process
  * @param[in] length Number of bytes to process
- * @return Checksum value
+ * @return One's complement sum (not complemented)
  **/
 
-uint16_t ipCalcChecksum(const void *data, size_t length)
+static uint16_t ipCalcSum(const void *data, size_t length)
 {
-   //Checksum preset value
-   uint32_t checksum = 0x0000;
+   bool_t odd;
+   uint32_t sum32;
+   uint64_t sum;
+   const uint8_t *p;
+
+   //Point to the first byte
+   p = data;
+   //Initialize the accumulator
+   sum = 0;
+
+   //Check whether the data block starts on an odd address
+   odd = ((uintptr_t) p & 1) ? TRUE : FALSE;
+
+   //Restore the alignment on 16-bit boundaries
+   if(odd && length > 0)
+   {
+#ifdef _BIG_ENDIAN
+      sum += *p;
+#else
+      sum += *p << 8;
+#endif
+      p += 1;
+      length -= 1;
+   }
+
+   //Restore the alignment on 32-bit boundaries
+   if(((uintptr_t) p & 2) && length > 1)
+   {
+      sum += *((uint16_t *) p);
+      p += 2;
+      length -= 2;
+   }
+
+   //Process the data 16 bytes at a time
+   while(length >= 16)
+   {
+      sum += ((uint32_t *) p)[0];
+      sum += ((uint32_t *) p)[1];
+      sum += ((uint32_t *) p)[2];
+      sum += ((uint32_t *) p)[3];
+      p += 16;
+      length -= 16;
+   }
+
+   //Process the remaining data 4 bytes at a time
+   while(length >= 4)
+   {
+      sum += *((uint32_t *) p);
+      p += 4;
+      length -= 4;
+   }
 
-   //Process all the data
-   while(length > 1)
+   //Process the last 16-bit word, if any
+   if(length > 1)
    {
-      //Update checksum value
-      checksum += *((uint16_t *) data);
-      //Point to the next 16-bit word
-      data = (uint16_t *) data + 1;
-      //Adjust the number of remaining words to process
+      sum += *((uint16_t *) p);
+      p += 2;
       length -= 2;
    }
 
    //Add left-over byte, if any
    if(length > 0)
-      checksum += *((uint8_t *) data);
+   {
+#ifdef _BIG_ENDIAN
+      sum += *p << 8;
+#else
+      sum += *p;
+#endif
+   }
+
+   //Fold 64-bit sum to 32 bits
+   sum = (sum & 0xFFFFFFFF) + (sum >> 32);
+   sum32 = (uint32_t) ((sum & 0xFFFFFFFF) + (sum >> 32));
 
    //Fold 32-bit sum to 16 bits
-   while(checksum >> 16)
-      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+   sum32 = (sum32 & 0xFFFF) + (sum32 >> 16);
+   sum32 = (sum32 & 0xFFFF) + (sum32 >> 16);
 
+   //Undo the byte swap caused by an odd start address
+   if(odd)
+      sum32 = SWAP16(sum32);
+
+   //Return the 16-bit sum
+   return sum32;
+}
+
+
+/**
+ * @brief IP checksum calculation
+ * @param[in] data Pointer to the data over which to calculate the IP checksum
+ * @param[in] length Number of bytes to process
+ * @return Checksum value
+ **/
+
+uint16_t ipCalcChecksum(const void *data, size_t length)
+{
    //Return 1's complement value
-   return checksum ^ 0xFFFF;
+   return ipCalcSum(data, length) ^ 0xFFFF;
 }
 
 
@@ -180,10 +260,9 @@ uint16_t ipCalcChecksum(const void *data, size_t length)
 uint16_t ipCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t length)
 {
    uint_t i;
-   uint_t m;
-   uint_t n;
-   bool_t odd;
-   uint8_t *data;
+   size_t m;
+   size_t n;
+   uint16_t sum;
    uint32_t checksum;
 
    //Checksum preset value
@@ -197,105 +276,24 @@ uint16_t ipCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t len
       //Is there any data to process in the current chunk?
       if(offset < buffer->chunk[i].length)
       {
-         //Check whether the total number of bytes already processed is odd
-         odd = (n & 1) ? TRUE : FALSE;
-
-         //Point to the first data byte
-         data = (uint8_t *) buffer->chunk[i].address + offset;
-
          //Number of bytes available in the current chunk
          m = buffer->chunk[i].length - offset;
          //Limit the number of byte to process
          m = min(m, length - n);
 
-         //Now adjust the total length
-         n += m;
+         //Compute the sum of the current chunk
+         sum = ipCalcSum((uint8_t *) buffer->chunk[i].address + offset, m);
+
+         //If the chunk starts at an odd position in the message, its
+         //bytes are paired the other way round
+         if(n & 1)
+            sum = SWAP16(sum);
 
-         //Data buffer is not aligned on 16-bit boundaries?
-         if((uint32_t) data & 1)
-         {
-            //The total number of bytes is even?
-            if(!odd)
-            {
-               //Fold 32-bit sum to 16 bits
-               while(checksum >> 16)
-                  checksum = (checksum & 0xFFFF) + (checksum >> 16);
-               //Swap checksum value
-               checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-            }
-
-            //Restore the alignment on 16-bit boundaries
-            if(m > 0)
-            {
-               //Update checksum value
-               checksum += *data << 8;
-               //Point to the next byte
-               data += 1;
-               m -= 1;
-            }
-
-            //Process the data 2 bytes at a time
-            while(m > 1)
-            {
-               //Update checksum value
-               checksum += *((uint16_t *) data);
-               //Point to the next 16-bit word
-               data += 2;
-               m -= 2;
-            }
-
-            //Add left-over byte, if any
-            if(m > 0)
-               checksum += *data;
-
-            //Restore checksum endianness
-            if(!odd)
-            {
-               //Fold 32-bit sum to 16 bits
-               while(checksum >> 16)
-                  checksum = (checksum & 0xFFFF) + (checksum >> 16);
-               //Swap checksum value
-               checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-            }
-         }
-         //Data buffer is aligned on 16-bit boundaries?
-         else
-         {
-            //The total number of bytes is odd?
-            if(odd)
-            {
-               //Fold 32-bit sum to 16 bits
-               while(checksum >> 16)
-                  checksum = (checksum & 0xFFFF) + (checksum >> 16);
-               //Swap checksum value
-               checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-            }
-
-            //Process the data 2 bytes at a time
-            while(m > 1)
-            {
-               //Update checksum value
-               checksum += *((uint16_t *) data);
-               //Point to the next 16-bit word
-               data += 2;
-               m -= 2;
-            }
-
-            //Add left-over byte, if any
-            if(m > 0)
-               checksum += *data;
-
-            //Restore checksum endianness
-            if(odd)
-            {
-               //Fold 32-bit sum to 16 bits
-               while(checksum >> 16)
-                  checksum = (checksum & 0xFFFF) + (checksum >> 16);
-               //Swap checksum value
-               checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-            }
-         }
+         //Update checksum value
+         checksum += sum;
 
+         //Now adjust the total length
+         n += m;
          //Process the next block from the start
          offset = 0;
       }
@@ -307,8 +305,8 @@ uint16_t ipCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t len
    }
 
    //Fold 32-bit sum to 16 bits
-   while(checksum >> 16)
-      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+   checksum = (checksum & 0xFFFF) + (checksum >> 16);
+   checksum = (checksum & 0xFFFF) + (checksum >> 16);
 
    //Return 1's complement value
    return checksum ^ 0xFFFF;
@@ -327,38 +325,14 @@ uint16_t ipCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t len
 uint16_t ipCalcUpperLayerChecksum(const void *pseudoHeader,
    size_t pseudoHeaderLength, const void *data, size_t dataLength)
 {
-   //Checksum preset value
-   uint32_t checksum = 0x0000;
-
-   //Process pseudo header
-   while(pseudoHeaderLength > 1)
-   {
-      //Update checksum value
-      checksum += *((uint16_t *) pseudoHeader);
-      //Point to the next 16-bit word
-      pseudoHeader = (uint16_t *) pseudoHeader + 1;
-      //Adjust the number of remaining words to process
-      pseudoHeaderLength -= 2;
-   }
-
-   //Process upper-layer data
-   while(dataLength > 1)
-   {
-      //Update checksum value
-      checksum += *((uint16_t *) data);
-      //Point to the next 16-bit word
-      data = (uint16_t *) data + 1;
-      //Adjust the number of remaining words to process
-      dataLength -= 2;
-   }
+   uint32_t checksum;
 
-   //Add left-over byte, if any
-   if(dataLength > 0)
-      checksum += *((uint8_t *) data);
+   //Process pseudo header and upper-layer data
+   checksum = ipCalcSum(pseudoHeader, pseudoHeaderLength);
+   checksum += ipCalcSum(data, dataLength);
 
    //Fold 32-bit sum to 16 bits
-   while(checksum >> 16)
-      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+   checksum = (checksum & 0xFFFF) + (checksum >> 16);
 
    //Calculate 1's complement value
    checksum = checksum ^ 0xFFFF;
@@ -389,19 +363,10 @@ uint16_t ipCalcUpperLayerChecksumEx(const void *pseudoHeader,
    checksum = checksum ^ 0xFFFF;
 
    //Process pseudo header
-   while(pseudoHeaderLength > 1)
-   {
-      //Update checksum value
-      checksum += *((uint16_t *) pseudoHeader);
-      //Point to the next 16-bit word
-      pseudoHeader = (uint16_t *) pseudoHeader + 1;
-      //Adjust the number of remaining words to process
-      pseudoHeaderLength -= 2;
-   }
+   checksum += ipCalcSum(pseudoHeader, pseudoHeaderLength);
 
    //Fold 32-bit sum to 16 bits
-   while(checksum >> 16)
-      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+   checksum = (checksum & 0xFFFF) + (checksum >> 16);
 
    //Calculate 1's complement value
    checksum = checksum ^ 0xFFFF;
@@ -411,6 +376,42 @@ uint16_t ipCalcUpperLayerChecksumEx(const void *pseudoHeader,
 }
 
 
+/**
+ * @brief Update an IP checksum after some of the covered data changed
+ *
+ * The new checksum is derived from the old one without summing the whole
+ * message again, using HC' = ~(~HC + ~m + m') (see RFC 1624, equation 3).
+ * The modified field must be located at an even offset within the data
+ * covered by the checksum
+ *
+ * @param[in] checksum Checksum value before the modification
+ * @param[in] oldData Previous contents of the modified field
+ * @param[in] newData New contents of the modified field
+ * @param[in] length Length of the modified field, in bytes
+ * @return Updated checksum value
+ **/
+
+uint16_t ipUpdateChecksum(uint16_t checksum, const void *oldData,
+   const void *newData, size_t length)
+{
+   uint32_t sum;
+
+   //~HC
+   sum = checksum ^ 0xFFFF;
+   //~m
+   sum += ipCalcSum(oldData, length) ^ 0xFFFF;
+   //m'
+   sum += ipCalcSum(newData, length);
+
+   //Fold 32-bit sum to 16 bits
+   sum = (sum & 0xFFFF) + (sum >> 16);
+   sum = (sum & 0xFFFF) + (sum >> 16);
+
+   //Return 1's complement value
+   return sum ^ 0xFFFF;
+}
+
+
 /**
  * @brief Allocate a buffer to hold an IP packet
  * @param[in] length Desired payload length
@@ -103,6 +103,9 @@ uint16_t ipCalcUpperLayerChecksum(const void *pseudoHeader,
 uint16_t ipCalcUpperLayerChecksumEx(const void *pseudoHeader,
    size_t pseudoHeaderLength, const ChunkedBuffer *buffer, size_t offset, size_t length);
 
+uint16_t ipUpdateChecksum(uint16_t checksum, const void *oldData,
+   const void *newData, size_t length);
+
 ChunkedBuffer *ipAllocBuffer(size_t length, size_t *offset);
 
 error_t ipJoinMulticastGroup(NetInterface *interface, const IpAddr *groupAddr);
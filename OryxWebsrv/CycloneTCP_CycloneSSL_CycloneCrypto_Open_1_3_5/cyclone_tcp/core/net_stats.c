@@ -0,0 +1,211 @@
+/**
+ * @file net_stats.c
+ * @brief Performance counters and latency histograms
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Each network interface maintains packet, byte and drop counters. When
+ * NET_STATS_SUPPORT is enabled, latencies are also sampled with a free
+ * running counter and accumulated in histograms whose buckets are powers
+ * of two. The DWT cycle counter of the Cortex-M core is used on target,
+ * while the monotonic clock provides nanoseconds on POSIX hosts. The
+ * counters are 32-bit wide, so that a latency sample is only meaningful
+ * as long as it does not exceed the wrap-around period of the counter
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL ETH_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "net_stats.h"
+#include "debug.h"
+
+#if (NET_STATS_SUPPORT == ENABLED)
+
+#if defined(USE_POSIX)
+   #include <time.h>
+#elif defined(_WIN32)
+   #include <windows.h>
+#else
+   //Debug Exception and Monitor Control Register
+   #define DEMCR (*((volatile uint32_t *) 0xE000EDFC))
+   //DWT Control Register
+   #define DWT_CTRL (*((volatile uint32_t *) 0xE0001000))
+   //DWT Cycle Count Register
+   #define DWT_CYCCNT (*((volatile uint32_t *) 0xE0001004))
+
+   //DEMCR register bits
+   #define DEMCR_TRCENA 0x01000000
+   //DWT_CTRL register bits
+   #define DWT_CTRL_CYCCNTENA 0x00000001
+#endif
+
+//Latency between the reception of a frame and the delivery of its payload
+NetHistogram netRxLatencyHistogram;
+
+#endif
+
+
+/**
+ * @brief Retrieve the statistics of a network interface
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Statistics
+ **/
+
+void netStatsGetInterfaceStats(NetInterface *interface, NetInterfaceStats *stats)
+{
+   //Take a consistent snapshot of the statistics
+   osTaskSuspendAll();
+   *stats = interface->stats;
+   osTaskResumeAll();
+}
+
+
+#if (NET_STATS_SUPPORT == ENABLED)
+
+/**
+ * @brief Initialize performance monitoring
+ **/
+
+void netStatsInit(void)
+{
+   //Clear latency histograms
+   memset(&netRxLatencyHistogram, 0, sizeof(NetHistogram));
+
+#if !defined(USE_POSIX) && !defined(_WIN32)
+   //Enable the DWT unit
+   DEMCR |= DEMCR_TRCENA;
+   //Start the cycle counter
+   DWT_CYCCNT = 0;
+   DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+
+/**
+ * @brief Read the free running counter used to measure latencies
+ * @return Current value of the counter
+ **/
+
+uint32_t netStatsGetTimestamp(void)
+{
+#if defined(USE_POSIX)
+   struct timespec ts;
+
+   //Read the monotonic clock
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   //Convert the result to nanoseconds
+   return (uint32_t) ts.tv_sec * 1000000000UL + (uint32_t) ts.tv_nsec;
+#elif defined(_WIN32)
+   LARGE_INTEGER counter;
+
+   //Read the performance counter
+   QueryPerformanceCounter(&counter);
+   //Return the lower part of the counter
+   return (uint32_t) counter.QuadPart;
+#else
+   //Read the cycle counter
+   return DWT_CYCCNT;
+#endif
+}
+
+
+/**
+ * @brief Record the delivery of the payload of the current frame
+ *
+ * This function is called when the payload of the frame being processed
+ * by the RX task of the interface is made available to a socket
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void netStatsRecordRxLatency(NetInterface *interface)
+{
+   //Time elapsed since the frame has been passed to the stack
+   netHistogramAdd(&netRxLatencyHistogram,
+      netStatsGetTimestamp() - interface->rxTimestamp);
+}
+
+
+/**
+ * @brief Add a sample to a latency histogram
+ * @param[in] histogram Pointer to the histogram
+ * @param[in] value Value of the sample
+ **/
+
+void netHistogramAdd(NetHistogram *histogram, uint32_t value)
+{
+   uint_t i;
+
+   //Compute the number of significant bits of the sample
+   for(i = 0; i < 32 && (value >> i) != 0; i++);
+   //Large samples are accumulated in the last bucket
+   i = min(i, NET_STATS_HISTOGRAM_SIZE - 1);
+
+   //Histograms are shared by all the tasks
+   osTaskSuspendAll();
+
+   //First sample?
+   if(histogram->count == 0)
+   {
+      histogram->min = value;
+      histogram->max = value;
+   }
+   else
+   {
+      histogram->min = min(histogram->min, value);
+      histogram->max = max(histogram->max, value);
+   }
+
+   //Update the histogram
+   histogram->count++;
+   histogram->sum += value;
+   histogram->bucket[i]++;
+
+   //Release exclusive access to the histogram
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Take a consistent snapshot of a latency histogram
+ * @param[in] histogram Pointer to the histogram
+ * @param[out] copy Copy of the histogram
+ **/
+
+void netHistogramGet(NetHistogram *histogram, NetHistogram *copy)
+{
+   //Get exclusive access to the histogram
+   osTaskSuspendAll();
+   //Copy the histogram
+   *copy = *histogram;
+   //Release exclusive access to the histogram
+   osTaskResumeAll();
+}
+
+#endif
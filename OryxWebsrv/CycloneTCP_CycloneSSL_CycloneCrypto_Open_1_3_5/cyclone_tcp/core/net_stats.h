@@ -0,0 +1,113 @@
+/**
+ * @file net_stats.h
+ * @brief Performance counters and latency histograms
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _NET_STATS_H
+#define _NET_STATS_H
+
+//Dependencies
+#include "tcp_ip_stack_config.h"
+#include "os.h"
+#include "error.h"
+
+//Latency histograms and statistics web service
+#ifndef NET_STATS_SUPPORT
+   #define NET_STATS_SUPPORT DISABLED
+#elif (NET_STATS_SUPPORT != ENABLED && NET_STATS_SUPPORT != DISABLED)
+   #error NET_STATS_SUPPORT parameter is invalid
+#endif
+
+//Number of buckets of the latency histograms
+#ifndef NET_STATS_HISTOGRAM_SIZE
+   #define NET_STATS_HISTOGRAM_SIZE 32
+#elif (NET_STATS_HISTOGRAM_SIZE < 2 || NET_STATS_HISTOGRAM_SIZE > 33)
+   #error NET_STATS_HISTOGRAM_SIZE parameter is invalid
+#endif
+
+//Unit of the timestamps used to measure latencies
+#if defined(USE_POSIX)
+   #define NET_STATS_TIMESTAMP_UNIT "ns"
+#elif defined(_WIN32)
+   #define NET_STATS_TIMESTAMP_UNIT "ticks"
+#else
+   #define NET_STATS_TIMESTAMP_UNIT "cycles"
+#endif
+
+
+/**
+ * @brief Network interface statistics
+ **/
+
+typedef struct
+{
+   uint32_t rxPackets;      ///<Frames passed to the stack by the NIC driver
+   uint32_t rxBytes;        ///<Bytes passed to the stack by the NIC driver
+   uint32_t rxDrops;        ///<Frames discarded by the Ethernet layer
+   uint32_t txPackets;      ///<Frames accepted by the NIC driver
+   uint32_t txBytes;        ///<Bytes accepted by the NIC driver
+   uint32_t txDrops;        ///<Frames the NIC driver failed to send
+   uint32_t checksumErrors; ///<Packets discarded because of a wrong checksum
+} NetInterfaceStats;
+
+
+/**
+ * @brief Latency histogram
+ *
+ * Bucket 0 counts the null samples, and bucket n (n > 0) counts the samples
+ * in the range [2^(n-1), 2^n). The last bucket also collects all the
+ * samples that are too large to fit in the range of the histogram
+ *
+ **/
+
+typedef struct
+{
+   uint32_t count;                            ///<Number of samples
+   uint32_t min;                              ///<Smallest sample
+   uint32_t max;                              ///<Largest sample
+   uint64_t sum;                              ///<Sum of all the samples
+   uint32_t bucket[NET_STATS_HISTOGRAM_SIZE]; ///<Number of samples per power of two
+} NetHistogram;
+
+
+//Performance monitoring related functions
+void netStatsGetInterfaceStats(NetInterface *interface, NetInterfaceStats *stats);
+
+#if (NET_STATS_SUPPORT == ENABLED)
+
+//Latency between the reception of a frame and the delivery of its payload
+extern NetHistogram netRxLatencyHistogram;
+
+void netStatsInit(void);
+uint32_t netStatsGetTimestamp(void);
+void netStatsRecordRxLatency(NetInterface *interface);
+
+void netHistogramAdd(NetHistogram *histogram, uint32_t value);
+void netHistogramGet(NetHistogram *histogram, NetHistogram *copy);
+
+#endif
+
+#endif
@@ -0,0 +1,598 @@
+/**
+ * @file net_timer.c
+ * @brief Timer wheel
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The modules of the TCP/IP stack register their deadlines (retransmission,
+ * persist, FIN-WAIT-2 and 2MSL timers, ARP and NDP retries and aging,
+ * fragment reassembly timeout) with a hierarchical hashed timer wheel.
+ * Level 0 holds the timers expiring within the next 64 ticks, and each
+ * upper level covers 64 times the range of the level below. Timers are
+ * cascaded down one level whenever the lower level wraps around. Both
+ * insertion and removal are done in constant time, and the tick task
+ * sleeps until the next deadline instead of polling every module
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL ETH_TRACE_LEVEL
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "net_timer.h"
+#include "debug.h"
+
+//Mask used to extract a slot index
+#define NET_TIMER_SLOT_MASK (NET_TIMER_SLOT_COUNT - 1)
+
+//Mutex preventing simultaneous access to the wheel
+static OsMutex *netTimerMutex;
+//Event used to wake up the tick task
+static OsEvent *netTimerEvent;
+//Next tick to be processed
+static uint32_t netTimerTicks;
+//Time at which the next tick elapses
+static time_t netTimerTime;
+//Time at which the tick task is going to wake up
+static time_t netTimerWakeTime;
+//The tick task is sleeping with no deadline
+static bool_t netTimerIdle;
+//Number of pending timers
+static uint_t netTimerCount;
+//Slots of the wheel
+static NetTimer *netTimerWheel[NET_TIMER_LEVEL_COUNT][NET_TIMER_SLOT_COUNT];
+//Timers whose deadline has been reached
+static NetTimer *netTimerExpired;
+
+//Timer wheel related functions
+static void netTimerLink(NetTimer *timer);
+static void netTimerLinkHead(NetTimer **head, NetTimer *timer);
+static void netTimerUnlink(NetTimer *timer);
+static void netTimerCascade(uint_t level, uint_t index);
+static void netTimerSync(time_t time);
+static time_t netTimerGetDelay(time_t time);
+
+
+/**
+ * @brief Timer wheel initialization
+ * @return Error code
+ **/
+
+error_t netTimerInit(void)
+{
+   //Create a mutex to prevent simultaneous access to the wheel
+   netTimerMutex = osMutexCreate(FALSE);
+   //Any error to report?
+   if(netTimerMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Create an event object used to wake up the tick task
+   netTimerEvent = osEventCreate(FALSE, FALSE);
+   //Any error to report?
+   if(netTimerEvent == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      osMutexClose(netTimerMutex);
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //The wheel is initially empty
+   memset(netTimerWheel, 0, sizeof(netTimerWheel));
+   netTimerExpired = NULL;
+   netTimerCount = 0;
+
+   //Initialize time reference
+   netTimerTicks = 0;
+   netTimerTime = osGetTickCount();
+   netTimerWakeTime = netTimerTime;
+   netTimerIdle = FALSE;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Initialize a timer
+ * @param[in] timer Timer to initialize
+ * @param[in] callback Function to invoke upon expiration
+ * @param[in] param Callback parameter
+ **/
+
+void netTimerSetup(NetTimer *timer, NetTimerCallback callback, void *param)
+{
+   //The timer is not linked in the wheel yet
+   timer->next = NULL;
+   timer->pprev = NULL;
+   timer->expires = 0;
+   timer->pending = FALSE;
+   //Save callback function
+   timer->callback = callback;
+   timer->param = param;
+}
+
+
+/**
+ * @brief Register a deadline
+ *
+ * If the timer is already pending with an earlier deadline, the call has no
+ * effect. Modules can therefore simply register each deadline they set, and
+ * recompute their next deadline when the callback is invoked
+ *
+ * @param[in] timer Timer to schedule
+ * @param[in] delay Delay before the callback is invoked, in milliseconds
+ **/
+
+void netTimerSchedule(NetTimer *timer, time_t delay)
+{
+   int32_t t;
+   uint32_t ticks;
+   uint32_t expires;
+   time_t time;
+   time_t deadline;
+
+   //Make sure the timer has been initialized
+   if(timer->callback == NULL)
+      return;
+
+   //Acquire exclusive access to the wheel
+   osMutexAcquire(netTimerMutex);
+
+   //Get current time
+   time = osGetTickCount();
+
+   //The time reference is not updated while the tick task sleeps with
+   //no deadline, so it must catch up before the wheel is used again
+   if(!netTimerCount)
+      netTimerSync(time);
+
+   //Time remaining from the next tick to the deadline
+   t = timeCompare(time + delay, netTimerTime);
+
+   //Round up so that the callback never runs before the delay has elapsed
+   if(t <= 0)
+      ticks = 0;
+   else
+      ticks = (t + NET_TIMER_RESOLUTION - 1) / NET_TIMER_RESOLUTION;
+
+   //Limit the range of the wheel
+   ticks = min(ticks, NET_TIMER_MAX_TICKS);
+   //Tick at which the timer expires
+   expires = netTimerTicks + ticks;
+
+   //Timer already pending?
+   if(timer->pending)
+   {
+      //Keep the earliest deadline
+      if((int32_t) (timer->expires - expires) <= 0)
+      {
+         //Release exclusive access to the wheel
+         osMutexRelease(netTimerMutex);
+         //The timer is already due sooner
+         return;
+      }
+
+      //Remove the timer from its current slot
+      netTimerUnlink(timer);
+   }
+
+   //Insert the timer in the appropriate slot
+   timer->expires = expires;
+   netTimerLink(timer);
+
+   //Time at which the new deadline occurs
+   deadline = netTimerTime + ticks * NET_TIMER_RESOLUTION;
+
+   //The tick task must wake up earlier than planned?
+   if(netTimerIdle || timeCompare(deadline, netTimerWakeTime) < 0)
+   {
+      //Update wake-up time
+      netTimerWakeTime = deadline;
+      netTimerIdle = FALSE;
+      //Notify the tick task
+      osEventSet(netTimerEvent);
+   }
+
+   //Release exclusive access to the wheel
+   osMutexRelease(netTimerMutex);
+}
+
+
+/**
+ * @brief Cancel a timer
+ * @param[in] timer Timer to cancel
+ **/
+
+void netTimerCancel(NetTimer *timer)
+{
+   //Acquire exclusive access to the wheel
+   osMutexAcquire(netTimerMutex);
+
+   //Remove the timer from the wheel
+   if(timer->pending)
+      netTimerUnlink(timer);
+
+   //Release exclusive access to the wheel
+   osMutexRelease(netTimerMutex);
+}
+
+
+/**
+ * @brief Check whether a timer is pending
+ * @param[in] timer Timer to check
+ * @return TRUE if the timer is linked in the wheel, else FALSE
+ **/
+
+bool_t netTimerPending(NetTimer *timer)
+{
+   return timer->pending;
+}
+
+
+/**
+ * @brief Invoke the callbacks of the timers that have expired
+ *
+ * This function is called by the tick task each time it wakes up
+ *
+ * @return Delay before the next deadline, in milliseconds
+ **/
+
+time_t netTimerProcess(void)
+{
+   uint_t i;
+   uint_t level;
+   uint_t index;
+   time_t time;
+   time_t delay;
+   NetTimer *timer;
+   NetTimer *next;
+   NetTimerCallback callback;
+   void *param;
+
+   //Acquire exclusive access to the wheel
+   osMutexAcquire(netTimerMutex);
+
+   //Get current time
+   time = osGetTickCount();
+
+   //No pending timer?
+   if(!netTimerCount)
+      netTimerSync(time);
+
+   //Process each tick that has elapsed
+   while(timeCompare(time, netTimerTime) >= 0)
+   {
+      //Index of the current slot at level 0
+      index = netTimerTicks & NET_TIMER_SLOT_MASK;
+
+      //Level 0 wraps around?
+      if(index == 0)
+      {
+         //Cascade the timers of the upper levels
+         for(level = 1; level < NET_TIMER_LEVEL_COUNT; level++)
+         {
+            //Index of the current slot at this level
+            i = (netTimerTicks >> (level * NET_TIMER_SLOT_BITS)) & NET_TIMER_SLOT_MASK;
+            //Move the timers down
+            netTimerCascade(level, i);
+
+            //The next level is concerned only if this one wraps around as well
+            if(i != 0) break;
+         }
+      }
+
+      //Move the timers of the current slot to the list of expired timers
+      for(timer = netTimerWheel[0][index]; timer != NULL; timer = next)
+      {
+         //Keep track of the next timer in the slot
+         next = timer->next;
+         //Link the timer in the list of expired timers
+         netTimerLinkHead(&netTimerExpired, timer);
+      }
+
+      //The slot is now empty
+      netTimerWheel[0][index] = NULL;
+
+      //Next tick
+      netTimerTicks++;
+      netTimerTime += NET_TIMER_RESOLUTION;
+   }
+
+   //Invoke the callbacks of the expired timers
+   while(netTimerExpired != NULL)
+   {
+      //Remove the first timer from the list
+      timer = netTimerExpired;
+      netTimerUnlink(timer);
+
+      //Save callback function
+      callback = timer->callback;
+      param = timer->param;
+
+      //The callback may reschedule the timer
+      osMutexRelease(netTimerMutex);
+      //Invoke callback function
+      callback(param);
+      //Acquire exclusive access to the wheel
+      osMutexAcquire(netTimerMutex);
+   }
+
+   //Get current time
+   time = osGetTickCount();
+   //Compute the delay before the next deadline
+   delay = netTimerGetDelay(time);
+
+   //Save the time at which the tick task is going to wake up
+   if(delay == INFINITE_DELAY)
+   {
+      netTimerIdle = TRUE;
+   }
+   else
+   {
+      netTimerWakeTime = time + delay;
+      netTimerIdle = FALSE;
+   }
+
+   //Release exclusive access to the wheel
+   osMutexRelease(netTimerMutex);
+
+   //Return the delay before the next deadline
+   return delay;
+}
+
+
+/**
+ * @brief Wait for the next deadline
+ *
+ * The function returns as soon as the delay has elapsed, or when an
+ * earlier deadline is registered
+ *
+ * @param[in] delay Delay returned by netTimerProcess()
+ **/
+
+void netTimerWait(time_t delay)
+{
+   //Sleep until the next deadline (INFINITE_DELAY if no timer is pending)
+   if(delay != 0)
+      osEventWait(netTimerEvent, delay);
+}
+
+
+/**
+ * @brief Insert a timer in the slot matching its deadline
+ * @param[in] timer Timer to insert
+ **/
+
+static void netTimerLink(NetTimer *timer)
+{
+   uint_t level;
+   uint_t index;
+   int32_t delta;
+
+   //Number of ticks before the timer expires
+   delta = timer->expires - netTimerTicks;
+
+   //The deadline has already been reached?
+   if(delta < 0)
+   {
+      //The timer will expire at the next tick
+      timer->expires = netTimerTicks;
+      delta = 0;
+   }
+
+   //Select the level whose range covers the deadline
+   for(level = 0; level < (NET_TIMER_LEVEL_COUNT - 1); level++)
+   {
+      if(delta < (1L << ((level + 1) * NET_TIMER_SLOT_BITS)))
+         break;
+   }
+
+   //Index of the slot within the selected level
+   index = (timer->expires >> (level * NET_TIMER_SLOT_BITS)) & NET_TIMER_SLOT_MASK;
+
+   //Insert the timer in the slot
+   netTimerLinkHead(&netTimerWheel[level][index], timer);
+
+   //One more pending timer
+   if(!timer->pending)
+   {
+      timer->pending = TRUE;
+      netTimerCount++;
+   }
+}
+
+
+/**
+ * @brief Insert a timer at the head of a list
+ * @param[in] head Head of the list
+ * @param[in] timer Timer to insert
+ **/
+
+static void netTimerLinkHead(NetTimer **head, NetTimer *timer)
+{
+   //Insert the timer before the first element
+   timer->next = *head;
+   timer->pprev = head;
+
+   //Update the back link of the former first element
+   if(*head != NULL)
+      (*head)->pprev = &timer->next;
+
+   //The timer is now the first element of the list
+   *head = timer;
+}
+
+
+/**
+ * @brief Remove a timer from the wheel
+ * @param[in] timer Timer to remove
+ **/
+
+static void netTimerUnlink(NetTimer *timer)
+{
+   //Remove the timer from the list it belongs to
+   *timer->pprev = timer->next;
+
+   //Update the back link of the next element
+   if(timer->next != NULL)
+      timer->next->pprev = timer->pprev;
+
+   //The timer is not linked anymore
+   timer->next = NULL;
+   timer->pprev = NULL;
+   timer->pending = FALSE;
+
+   //One less pending timer
+   netTimerCount--;
+}
+
+
+/**
+ * @brief Move the timers of an upper level slot to the lower levels
+ * @param[in] level Level of the slot
+ * @param[in] index Index of the slot
+ **/
+
+static void netTimerCascade(uint_t level, uint_t index)
+{
+   NetTimer *timer;
+   NetTimer *next;
+
+   //Detach the list of timers from the slot
+   timer = netTimerWheel[level][index];
+   netTimerWheel[level][index] = NULL;
+
+   //Insert each timer again according to its remaining delay
+   while(timer != NULL)
+   {
+      //Keep track of the next timer in the slot
+      next = timer->next;
+      //Insert the timer in the appropriate slot
+      netTimerLink(timer);
+      //Point to the next timer
+      timer = next;
+   }
+}
+
+
+/**
+ * @brief Move the time reference of an empty wheel to the current time
+ * @param[in] time Current time
+ **/
+
+static void netTimerSync(time_t time)
+{
+   uint32_t n;
+
+   //The wheel can jump straight to the current time
+   if(timeCompare(time, netTimerTime) >= 0)
+   {
+      //Number of ticks that have elapsed
+      n = timeCompare(time, netTimerTime) / NET_TIMER_RESOLUTION + 1;
+      //Update time reference
+      netTimerTicks += n;
+      netTimerTime += n * NET_TIMER_RESOLUTION;
+   }
+}
+
+
+/**
+ * @brief Compute the delay before the next deadline
+ * @param[in] time Current time
+ * @return Delay in milliseconds, or INFINITE_DELAY if no timer is pending
+ **/
+
+static time_t netTimerGetDelay(time_t time)
+{
+   uint_t i;
+   uint_t level;
+   uint_t index;
+   bool_t found;
+   uint32_t next;
+   int32_t delay;
+   NetTimer *timer;
+
+   //Expired timers are still waiting for their callback?
+   if(netTimerExpired != NULL)
+      return 0;
+   //No pending timer?
+   if(!netTimerCount)
+      return INFINITE_DELAY;
+
+   //No deadline found yet
+   found = FALSE;
+   next = 0;
+
+   //Level 0 slots are sorted by deadline, starting from the current tick
+   for(i = 0; i < NET_TIMER_SLOT_COUNT; i++)
+   {
+      //Non-empty slot?
+      if(netTimerWheel[0][(netTimerTicks + i) & NET_TIMER_SLOT_MASK] != NULL)
+      {
+         //All the timers of this slot expire at the same tick
+         next = netTimerTicks + i;
+         found = TRUE;
+         break;
+      }
+   }
+
+   //A timer of an upper level may expire before the next level 0 cascade
+   for(level = 1; level < NET_TIMER_LEVEL_COUNT; level++)
+   {
+      //Index of the current slot at this level
+      index = (netTimerTicks >> (level * NET_TIMER_SLOT_BITS)) & NET_TIMER_SLOT_MASK;
+
+      //The current slot may either hold timers waiting to be cascaded
+      //or timers that expire after a full revolution of this level, so
+      //it is always examined in addition to the next non-empty slot
+      for(i = 0; i < NET_TIMER_SLOT_COUNT; i++)
+      {
+         //Point to the first timer of the slot
+         timer = netTimerWheel[level][(index + i) & NET_TIMER_SLOT_MASK];
+
+         //Find the earliest deadline within the slot
+         for(; timer != NULL; timer = timer->next)
+         {
+            if(!found || (int32_t) (timer->expires - next) < 0)
+            {
+               next = timer->expires;
+               found = TRUE;
+            }
+         }
+
+         //The following slots of this level expire later
+         if(i > 0 && netTimerWheel[level][(index + i) & NET_TIMER_SLOT_MASK] != NULL)
+            break;
+      }
+   }
+
+   //Time remaining before the next deadline
+   delay = timeCompare(netTimerTime + (next - netTimerTicks) * NET_TIMER_RESOLUTION, time);
+
+   //Return the delay before the next deadline
+   return max(delay, 0);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file net_timer.h
+ * @brief Timer wheel
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _NET_TIMER_H
+#define _NET_TIMER_H
+
+//Dependencies
+#include "tcp_ip_stack_config.h"
+#include "os.h"
+#include "error.h"
+
+//Timer wheel resolution, in milliseconds
+#ifndef NET_TIMER_RESOLUTION
+   #define NET_TIMER_RESOLUTION 10
+#elif (NET_TIMER_RESOLUTION < 1 || NET_TIMER_RESOLUTION > 100)
+   #error NET_TIMER_RESOLUTION parameter is invalid
+#endif
+
+//Number of slots per level (log2)
+#define NET_TIMER_SLOT_BITS 6
+//Number of slots per level
+#define NET_TIMER_SLOT_COUNT (1 << NET_TIMER_SLOT_BITS)
+//Number of levels in the hierarchy
+#define NET_TIMER_LEVEL_COUNT 4
+//Longest delay that can be represented, in ticks
+#define NET_TIMER_MAX_TICKS ((1UL << (NET_TIMER_SLOT_BITS * NET_TIMER_LEVEL_COUNT)) - 1)
+
+
+/**
+ * @brief Timer callback
+ *
+ * Callbacks are invoked from the TCP/IP stack tick task, without any lock
+ * held. They must tolerate being invoked before the deadline that motivated
+ * the registration, and re-register the timer if more work is pending
+ **/
+
+typedef void (*NetTimerCallback)(void *param);
+
+
+/**
+ * @brief Timer wheel entry
+ **/
+
+typedef struct _NetTimer
+{
+   struct _NetTimer *next;     ///<Next entry in the same slot
+   struct _NetTimer **pprev;   ///<Link pointing to this entry
+   uint32_t expires;           ///<Tick at which the timer expires
+   bool_t pending;             ///<The timer is linked in the wheel
+   NetTimerCallback callback;  ///<Function to invoke upon expiration
+   void *param;                ///<Callback parameter
+} NetTimer;
+
+
+//Timer wheel related functions
+error_t netTimerInit(void);
+
+void netTimerSetup(NetTimer *timer, NetTimerCallback callback, void *param);
+void netTimerSchedule(NetTimer *timer, time_t delay);
+void netTimerCancel(NetTimer *timer);
+bool_t netTimerPending(NetTimer *timer);
+
+time_t netTimerProcess(void);
+void netTimerWait(time_t delay);
+
+#endif
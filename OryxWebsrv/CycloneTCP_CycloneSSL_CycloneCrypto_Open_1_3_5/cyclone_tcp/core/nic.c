@@ -106,15 +106,14 @@ error_t nicSetMacFilter(NetInterface *interface)
 error_t nicSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size_t offset)
 {
    error_t error;
+   size_t length;
 
-#if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
    //Retrieve the length of the packet
-   size_t length = chunkedBufferGetLength(buffer) - offset;
+   length = chunkedBufferGetLength(buffer) - offset;
 
    //Debug message
    TRACE_DEBUG("Sending packet (%u bytes)...\r\n", length);
    TRACE_DEBUG_CHUNKED_BUFFER("  ", buffer, offset, length);
-#endif
 
    //Wait for the transmitter to be ready to send
    osEventWait(interface->nicTxEvent, INFINITE_DELAY);
@@ -127,6 +126,17 @@ error_t nicSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size
    //Send Ethernet frame
    error = interface->nicDriver->sendPacket(interface, buffer, offset);
 
+   //Update statistics
+   if(!error)
+   {
+      interface->stats.txPackets++;
+      interface->stats.txBytes += length;
+   }
+   else
+   {
+      interface->stats.txDrops++;
+   }
+
    //Re-enable interrupts
    interface->nicDriver->enableIrq(interface);
    //Release exclusive access to the device
@@ -137,6 +147,61 @@ error_t nicSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size
 }
 
 
+/**
+ * @brief Make sure the network controllers no longer read a buffer
+ *
+ * Some drivers transmit chunks flagged with CHUNK_FLAG_ZERO_COPY in place.
+ * The memory of such chunks must not be released as long as a DMA
+ * descriptor refers to it. Drivers that do not reference data in place
+ * do not provide this service
+ *
+ * @param[in] buffer Multi-part buffer about to be released
+ **/
+
+void nicReleaseTxData(const ChunkedBuffer *buffer)
+{
+   uint_t i;
+   time_t delay;
+   bool_t released;
+   NetInterface *interface;
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //Point to the current interface
+      interface = &netInterface[i];
+
+      //Skip the interfaces whose driver never transmits data in place
+      if(!interface->nicDriver || !interface->nicDriver->releaseTxData)
+         continue;
+
+      //Wait for the pending frames to be transmitted
+      for(delay = 0; ; delay++)
+      {
+         //Get exclusive access to the device
+         osTaskSuspendAll();
+         //Disable interrupts
+         interface->nicDriver->disableIrq(interface);
+
+         //Once the timeout has elapsed, the driver takes its descriptors back
+         released = interface->nicDriver->releaseTxData(interface, buffer,
+            delay >= NIC_TX_RELEASE_TIMEOUT);
+
+         //Re-enable interrupts
+         interface->nicDriver->enableIrq(interface);
+         //Release exclusive access to the device
+         osTaskResumeAll();
+
+         //The buffer is not referenced anymore?
+         if(released) break;
+
+         //Give the DMA some time to proceed
+         osDelay(1);
+      }
+   }
+}
+
+
 /**
  * @brief Handle a packet received by the network controller
  * @param[in] interface Underlying network interface
@@ -146,11 +211,20 @@ error_t nicSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size
 
 void nicProcessPacket(NetInterface *interface, void *packet, size_t length)
 {
+   //Update statistics
+   interface->stats.rxPackets++;
+   interface->stats.rxBytes += length;
+
    //Re-enable interrupts
    interface->nicDriver->enableIrq(interface);
    //Release exclusive access to the device
    osTaskResumeAll();
 
+#if (NET_STATS_SUPPORT == ENABLED)
+   //Save the time at which the frame is passed to the stack
+   interface->rxTimestamp = netStatsGetTimestamp();
+#endif
+
    //Debug message
    TRACE_DEBUG("Packet received (%u bytes)...\r\n", length);
    TRACE_DEBUG_ARRAY("  ", packet, length);
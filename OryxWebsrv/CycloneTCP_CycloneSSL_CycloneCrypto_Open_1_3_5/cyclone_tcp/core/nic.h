@@ -39,6 +39,13 @@
    #error NIC_TICK_INTERVAL parameter is invalid
 #endif
 
+//Maximum time to wait for the transmission of data sent in place
+#ifndef NIC_TX_RELEASE_TIMEOUT
+   #define NIC_TX_RELEASE_TIMEOUT 100
+#elif (NIC_TX_RELEASE_TIMEOUT < 1)
+   #error NIC_TX_RELEASE_TIMEOUT parameter is invalid
+#endif
+
 //Size of the NIC driver context
 #ifndef NIC_CONTEXT_SIZE
    #define NIC_CONTEXT_SIZE 8
@@ -56,6 +63,7 @@ typedef error_t (*NicSetMacFilter)(NetInterface *interface);
 typedef error_t (*NicSendPacket)(NetInterface *interface, const ChunkedBuffer *buffer, size_t offset);
 typedef void (*NicWritePhyReg)(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
 typedef uint16_t (*NicReadPhyReg)(uint8_t phyAddr, uint8_t regAddr);
+typedef bool_t (*NicReleaseTxData)(NetInterface *interface, const ChunkedBuffer *buffer, bool_t force);
 
 //PHY abstraction layer
 typedef error_t (*PhyInit)(NetInterface *interface);
@@ -80,6 +88,7 @@ typedef struct
    NicSendPacket sendPacket;
    NicWritePhyReg writePhyReg;
    NicReadPhyReg readPhyReg;
+   NicReleaseTxData releaseTxData;
    bool_t autoPadding;
    bool_t autoCrcGen;
    bool_t autoCrcCheck;
@@ -104,6 +113,7 @@ typedef struct
 void nicTick(NetInterface *interface);
 error_t nicSetMacFilter(NetInterface *interface);
 error_t nicSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size_t offset);
+void nicReleaseTxData(const ChunkedBuffer *buffer);
 void nicProcessPacket(NetInterface *interface, void *packet, size_t length);
 void nicNotifyLinkChange(NetInterface *interface);
 
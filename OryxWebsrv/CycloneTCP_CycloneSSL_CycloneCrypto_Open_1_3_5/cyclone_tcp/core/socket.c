@@ -37,6 +37,8 @@
 #include "udp.h"
 #include "tcp.h"
 #include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_congestion.h"
 #include "debug.h"
 
 //Ephemeral ports are used for dynamic port assignment
@@ -45,6 +47,10 @@ static uint_t ephemeralPort;
 OsMutex *socketMutex;
 //Socket table
 Socket socketTable[SOCKET_MAX_COUNT];
+//Fully specified sockets, hashed by local port and remote endpoint
+static Socket *socketConnTable[SOCKET_HASH_TABLE_SIZE];
+//Partially specified sockets (listeners), hashed by local port
+static Socket *socketListenTable[SOCKET_HASH_TABLE_SIZE];
 
 
 /**
@@ -68,6 +74,8 @@ error_t socketInit(void)
 
    //Initialize socket related data
    memset(socketTable, 0, sizeof(socketTable));
+   memset(socketConnTable, 0, sizeof(socketConnTable));
+   memset(socketListenTable, 0, sizeof(socketListenTable));
 
    //Loop through socket descriptors
    for(i = 0; i < SOCKET_MAX_COUNT; i++)
@@ -144,11 +152,21 @@ Socket *socketOpen(uint_t type, uint8_t protocol)
          socket->timeout = INFINITE_DELAY;
          socket->txBufferSize = TCP_DEFAULT_TX_BUFFER_SIZE;
          socket->rxBufferSize = TCP_DEFAULT_RX_BUFFER_SIZE;
+         socket->congestionControl = TCP_DEFAULT_CONGESTION_CONTROL;
+
+#if (TCP_SUPPORT == ENABLED)
+         //TCP timers are driven by the timer wheel
+         if(type == SOCKET_TYPE_STREAM)
+            netTimerSetup(&socket->timer, tcpTimerHandler, socket);
+#endif
 
          //Next dynamic port to use
          if(ephemeralPort++ >= SOCKET_EPHEMERAL_PORT_MAX)
             ephemeralPort = SOCKET_EPHEMERAL_PORT_MIN;
 
+         //Register the socket in the lookup tables
+         socketHashUpdate(socket);
+
          //Socket is successfully initialized
          break;
       }
@@ -182,6 +200,45 @@ error_t socketSetTimeout(Socket *socket, time_t timeout)
 }
 
 
+/**
+ * @brief Select the congestion control algorithm of a TCP socket
+ * @param[in] socket Handle to a socket
+ * @param[in] algo Congestion control algorithm (NewReno or CUBIC)
+ * @return Error code
+ **/
+
+error_t socketSetCongestionControl(Socket *socket, TcpCongestionControl algo)
+{
+   error_t error;
+
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+
+#if (TCP_SUPPORT == ENABLED)
+   //Connection-oriented socket?
+   if(socket->type == SOCKET_TYPE_STREAM)
+   {
+      //Enter critical section
+      osMutexAcquire(socketMutex);
+      //Select the specified algorithm
+      error = tcpSetCongestionControl(socket, algo);
+      //Leave critical section
+      osMutexRelease(socketMutex);
+   }
+   else
+#endif
+   //Connectionless socket?
+   {
+      //Congestion control only applies to TCP
+      error = ERROR_INVALID_SOCKET;
+   }
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Bind a socket to a particular network interface
  * @param[in] socket Handle to a socket
@@ -220,9 +277,17 @@ error_t socketBind(Socket *socket, const IpAddr *localIpAddr, uint16_t localPort
    if(socket->type != SOCKET_TYPE_STREAM && socket->type != SOCKET_TYPE_DGRAM)
       return ERROR_INVALID_SOCKET;
 
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
    //Associate the specified IP address and port number
    socket->localIpAddr = *localIpAddr;
    socket->localPort = localPort;
+   //Update the lookup tables accordingly
+   socketHashUpdate(socket);
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
 
    //No error to report
    return NO_ERROR;
@@ -266,6 +331,8 @@ error_t socketConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remot
 
       //Enter critical section
       osMutexAcquire(socketMutex);
+      //The socket is now fully specified
+      socketHashUpdate(socket);
       //Establish TCP connection
       error = tcpConnect(socket);
       //Leave critical section
@@ -276,9 +343,15 @@ error_t socketConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remot
    //Connectionless socket?
    if(socket->type == SOCKET_TYPE_DGRAM)
    {
+      //Enter critical section
+      osMutexAcquire(socketMutex);
       //Save port number and IP address of the remote host
       socket->remoteIpAddr = *remoteIpAddr;
       socket->remotePort = remotePort;
+      //Update the lookup tables accordingly
+      socketHashUpdate(socket);
+      //Leave critical section
+      osMutexRelease(socketMutex);
       //No error to report
       error = NO_ERROR;
    }
@@ -682,6 +755,8 @@ void socketClose(Socket *socket)
          queueItem = nextQueueItem;
       }
 
+      //Remove the socket from the lookup tables
+      socketHashRemove(socket);
       //Mark the socket as closed
       socket->type = SOCKET_TYPE_UNUSED;
    }
@@ -911,6 +986,314 @@ error_t socketGetLastError(Socket *socket)
 }
 
 
+/**
+ * @brief Compute the hash of a socket endpoint
+ * @param[in] type Socket type
+ * @param[in] localPort Local port number
+ * @param[in] remoteAddr Remote IP address (optional parameter)
+ * @param[in] remoteAddrLength Length of the remote IP address
+ * @param[in] remotePort Remote port number
+ * @return Index of the relevant bucket
+ **/
+
+static uint_t socketHash(uint_t type, uint16_t localPort,
+   const void *remoteAddr, size_t remoteAddrLength, uint16_t remotePort)
+{
+   size_t i;
+   uint32_t h;
+
+   //Mix the socket type and the port numbers
+   h = (type << 24) ^ (localPort << 8) ^ remotePort;
+
+   //Mix the remote IP address
+   for(i = 0; i < remoteAddrLength; i++)
+      h = (h * 33) ^ ((const uint8_t *) remoteAddr)[i];
+
+   //Spread the upper bits over the lower ones
+   h ^= h >> 16;
+
+   //Return the index of the bucket
+   return h % SOCKET_HASH_TABLE_SIZE;
+}
+
+
+/**
+ * @brief Update the position of a socket in the lookup tables
+ *
+ * A socket whose remote IP address and port are both known is stored in
+ * the connection table, keyed by its local port and remote endpoint. Any
+ * other TCP or UDP socket is stored in the listener table, keyed by its
+ * local port. This function must be called with the socket mutex held
+ * whenever one of these parameters is changed
+ *
+ * @param[in] socket Handle to a socket
+ **/
+
+void socketHashUpdate(Socket *socket)
+{
+   uint_t i;
+   const void *remoteAddr;
+
+   //Unlink the socket from its current bucket
+   socketHashRemove(socket);
+
+   //Only TCP and UDP sockets are demultiplexed using the lookup tables
+   if(socket->type != SOCKET_TYPE_STREAM && socket->type != SOCKET_TYPE_DGRAM)
+      return;
+
+   //Point to the remote IP address, if any
+   remoteAddr = NULL;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 remote address?
+   if(socket->remoteIpAddr.length == sizeof(Ipv4Addr))
+      remoteAddr = &socket->remoteIpAddr.ipv4Addr;
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 remote address?
+   if(socket->remoteIpAddr.length == sizeof(Ipv6Addr))
+      remoteAddr = &socket->remoteIpAddr.ipv6Addr;
+#endif
+
+   //Fully specified socket?
+   if(remoteAddr && socket->remotePort)
+   {
+      //Select the relevant bucket
+      i = socketHash(socket->type, socket->localPort, remoteAddr,
+         socket->remoteIpAddr.length, socket->remotePort);
+      //Point to the bucket
+      socket->hashBucket = &socketConnTable[i];
+   }
+   else
+   {
+      //Select the relevant bucket
+      i = socketHash(socket->type, socket->localPort, NULL, 0, 0);
+      //Point to the bucket
+      socket->hashBucket = &socketListenTable[i];
+   }
+
+   //Insert the socket at the head of the bucket
+   socket->hashNext = *socket->hashBucket;
+   *socket->hashBucket = socket;
+}
+
+
+/**
+ * @brief Remove a socket from the lookup tables
+ * @param[in] socket Handle to a socket
+ **/
+
+void socketHashRemove(Socket *socket)
+{
+   Socket **p;
+
+   //The socket is not currently registered?
+   if(!socket->hashBucket)
+      return;
+
+   //Loop through the sockets that share the same bucket
+   for(p = socket->hashBucket; *p; p = &(*p)->hashNext)
+   {
+      //Matching entry?
+      if(*p == socket)
+      {
+         //Unlink the socket
+         *p = socket->hashNext;
+         break;
+      }
+   }
+
+   //The socket does not belong to any bucket anymore
+   socket->hashBucket = NULL;
+   socket->hashNext = NULL;
+}
+
+
+/**
+ * @brief Check whether the IP addresses of a socket match an incoming packet
+ * @param[in] socket Handle to a socket
+ * @param[in] pseudoHeader Pseudo header of the incoming packet
+ * @return TRUE if the addresses match, else FALSE
+ **/
+
+static bool_t socketMatchAddr(const Socket *socket, const IpPseudoHeader *pseudoHeader)
+{
+#if (IPV4_SUPPORT == ENABLED)
+   //An IPv4 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Destination IP address filtering
+      if(socket->localIpAddr.length)
+      {
+         //An IPv4 address is expected
+         if(socket->localIpAddr.length != sizeof(Ipv4Addr))
+            return FALSE;
+         //Filter out non-matching addresses
+         if(socket->localIpAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
+            return FALSE;
+      }
+      //Source IP address filtering
+      if(socket->remoteIpAddr.length)
+      {
+         //An IPv4 address is expected
+         if(socket->remoteIpAddr.length != sizeof(Ipv4Addr))
+            return FALSE;
+         //Filter out non-matching addresses
+         if(socket->remoteIpAddr.ipv4Addr != pseudoHeader->ipv4Data.srcAddr)
+            return FALSE;
+      }
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //An IPv6 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Destination IP address filtering
+      if(socket->localIpAddr.length)
+      {
+         //An IPv6 address is expected
+         if(socket->localIpAddr.length != sizeof(Ipv6Addr))
+            return FALSE;
+         //Filter out non-matching addresses
+         if(!ipv6CompAddr(&socket->localIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
+            return FALSE;
+      }
+      //Source IP address filtering
+      if(socket->remoteIpAddr.length)
+      {
+         //An IPv6 address is expected
+         if(socket->remoteIpAddr.length != sizeof(Ipv6Addr))
+            return FALSE;
+         //Filter out non-matching addresses
+         if(!ipv6CompAddr(&socket->remoteIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.srcAddr))
+            return FALSE;
+      }
+   }
+   else
+#endif
+   //An invalid packet was received?
+   {
+      //This should never occur...
+      return FALSE;
+   }
+
+   //The addresses match
+   return TRUE;
+}
+
+
+/**
+ * @brief Find the socket an incoming TCP segment or UDP datagram belongs to
+ *
+ * Fully specified sockets are searched first. Then the listener table is
+ * searched for a socket in the LISTEN state (TCP) or a socket that accepts
+ * datagrams from any remote port (UDP). This function must be called with
+ * the socket mutex held
+ *
+ * @param[in] type Socket type (SOCKET_TYPE_STREAM or SOCKET_TYPE_DGRAM)
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader Pseudo header of the incoming packet
+ * @param[in] srcPort Source port number (host byte order)
+ * @param[in] destPort Destination port number (host byte order)
+ * @return Handle to the matching socket or NULL if no socket was found
+ **/
+
+Socket *socketHashLookup(uint_t type, NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, uint16_t srcPort, uint16_t destPort)
+{
+   uint_t i;
+   Socket *socket;
+   Socket *passiveSocket;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //An IPv4 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Select the relevant bucket
+      i = socketHash(type, destPort, &pseudoHeader->ipv4Data.srcAddr,
+         sizeof(Ipv4Addr), srcPort);
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //An IPv6 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Select the relevant bucket
+      i = socketHash(type, destPort, &pseudoHeader->ipv6Data.srcAddr,
+         sizeof(Ipv6Addr), srcPort);
+   }
+   else
+#endif
+   //An invalid packet was received?
+   {
+      //This should never occur...
+      return NULL;
+   }
+
+   //Search the connection table
+   for(socket = socketConnTable[i]; socket; socket = socket->hashNext)
+   {
+      //Check socket type
+      if(socket->type != type)
+         continue;
+      //Check whether the socket is bound to a particular interface
+      if(socket->interface && socket->interface != interface)
+         continue;
+      //Check port numbers
+      if(socket->localPort != destPort || socket->remotePort != srcPort)
+         continue;
+      //Check IP addresses
+      if(!socketMatchAddr(socket, pseudoHeader))
+         continue;
+
+      //A matching socket has been found
+      return socket;
+   }
+
+   //No matching socket in the LISTEN state for the moment
+   passiveSocket = NULL;
+
+   //Select the relevant bucket
+   i = socketHash(type, destPort, NULL, 0, 0);
+
+   //Search the listener table
+   for(socket = socketListenTable[i]; socket; socket = socket->hashNext)
+   {
+      //Check socket type
+      if(socket->type != type)
+         continue;
+      //Check whether the socket is bound to a particular interface
+      if(socket->interface && socket->interface != interface)
+         continue;
+      //Check destination port number
+      if(socket->localPort != destPort)
+         continue;
+      //Check IP addresses
+      if(!socketMatchAddr(socket, pseudoHeader))
+         continue;
+
+      //Exact match on the source port?
+      if(socket->remotePort == srcPort)
+         return socket;
+
+      //Keep track of the first socket that accepts any remote port
+      if(!passiveSocket && !socket->remotePort)
+      {
+#if (TCP_SUPPORT == ENABLED)
+         //Only TCP sockets in the LISTEN state accept new connections
+         if(type != SOCKET_TYPE_STREAM || socket->state == TCP_STATE_LISTEN)
+#endif
+            passiveSocket = socket;
+      }
+   }
+
+   //Return the first matching socket that accepts any remote port
+   return passiveSocket;
+}
+
+
 /**
  * @brief Resolve a host name into an IP address
  * @param[in] interface Underlying network interface (optional parameter)
@@ -41,6 +41,13 @@
    #error SOCKET_MAX_COUNT parameter is invalid
 #endif
 
+//Number of buckets in the socket lookup tables
+#ifndef SOCKET_HASH_TABLE_SIZE
+   #define SOCKET_HASH_TABLE_SIZE 16
+#elif (SOCKET_HASH_TABLE_SIZE < 1)
+   #error SOCKET_HASH_TABLE_SIZE parameter is invalid
+#endif
+
 //Dynamic port range (lower limit)
 #ifndef SOCKET_EPHEMERAL_PORT_MIN
    #define SOCKET_EPHEMERAL_PORT_MIN 49152
@@ -168,6 +175,8 @@ typedef struct _Socket
    uint_t eventMask;
    uint_t eventFlags;
    OsEvent *userEvent;
+   struct _Socket **hashBucket;
+   struct _Socket *hashNext;
    //TCP specific variables
    TcpControlBlock;
    //UDP specific variables
@@ -197,6 +206,7 @@ error_t socketInit(void);
 Socket *socketOpen(uint_t type, uint8_t protocol);
 
 error_t socketSetTimeout(Socket *socket, time_t timeout);
+error_t socketSetCongestionControl(Socket *socket, TcpCongestionControl algo);
 error_t socketBindToInterface(Socket *socket, NetInterface *interface);
 error_t socketBind(Socket *socket, const IpAddr *localIpAddr, uint16_t localPort);
 error_t socketConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePort);
@@ -229,6 +239,12 @@ error_t socketGetEvents(Socket *socket, uint_t *eventFlags);
 error_t socketError(Socket *socket, error_t error);
 error_t socketGetLastError(Socket *socket);
 
+void socketHashUpdate(Socket *socket);
+void socketHashRemove(Socket *socket);
+
+Socket *socketHashLookup(uint_t type, NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, uint16_t srcPort, uint16_t destPort);
+
 error_t getHostByName(NetInterface *interface, const char_t *name,
    IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries, uint_t flags);
 
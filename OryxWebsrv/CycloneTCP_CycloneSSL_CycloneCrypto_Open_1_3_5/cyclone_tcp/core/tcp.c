@@ -36,11 +36,16 @@
 #include "socket.h"
 #include "tcp.h"
 #include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_congestion.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
 #if (TCP_SUPPORT == ENABLED)
 
+//TCP statistics
+TcpStats tcpStats;
+
 
 /**
  * @brief Establish a TCP connection
@@ -91,6 +96,24 @@ error_t tcpConnect(Socket *socket)
    //Default retransmission timeout
    socket->rto = TCP_INITIAL_RTO;
 
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+   //Select the smallest shift count that allows the whole
+   //receive buffer to be advertised (see RFC 7323 2.3)
+   while((socket->rxBufferSize >> socket->rcvWndShift) > UINT16_MAX &&
+      socket->rcvWndShift < TCP_MAX_WINDOW_SCALE)
+   {
+      socket->rcvWndShift++;
+   }
+
+   //Offer the Window Scale option in the SYN segment
+   socket->wndScaleEnabled = TRUE;
+#endif
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //Offer the Timestamps option in the SYN segment
+   socket->tsEnabled = TRUE;
+#endif
+
    //Send a SYN segment
    error = tcpSendSegment(socket, TCP_FLAG_SYN, socket->iss, 0, 0, TRUE);
    //Failed to send TCP segment?
@@ -252,6 +275,8 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
       //Save the port number and the IP address of the remote host
       newSocket->remoteIpAddr = queueItem->srcAddr;
       newSocket->remotePort = queueItem->srcPort;
+      //The socket is now fully specified
+      socketHashUpdate(newSocket);
       //Save the maximum segment size
       newSocket->mss = queueItem->mss;
 
@@ -266,10 +291,46 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
 
       //Default retransmission timeout
       newSocket->rto = TCP_INITIAL_RTO;
-      //Initial congestion window
-      newSocket->cwnd = min(TCP_INITIAL_WINDOW * newSocket->mss, newSocket->txBufferSize);
-      //Slow start threshold should be set arbitrarily high
-      newSocket->ssthresh = UINT16_MAX;
+      //Inherit the congestion control algorithm of the listening socket
+      newSocket->congestionControl = socket->congestionControl;
+      //Initialize congestion window and slow start threshold
+      tcpCongestionInit(newSocket);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //SACK is used only if the SYN segment carried the SACK Permitted option
+      newSocket->sackPermitted = queueItem->sackPermitted;
+#endif
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Window scaling is enabled only if both sides sent the option
+      if(queueItem->wndScalePermitted)
+      {
+         //Shift count to be applied to the windows advertised by the peer
+         newSocket->sndWndShift = min(queueItem->wndScale, TCP_MAX_WINDOW_SCALE);
+
+         //Select the smallest shift count that allows the whole
+         //receive buffer to be advertised (see RFC 7323 2.3)
+         while((newSocket->rxBufferSize >> newSocket->rcvWndShift) > UINT16_MAX &&
+            newSocket->rcvWndShift < TCP_MAX_WINDOW_SCALE)
+         {
+            newSocket->rcvWndShift++;
+         }
+
+         //The Window Scale option will be sent in the SYN ACK segment
+         newSocket->wndScaleEnabled = TRUE;
+      }
+#endif
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Timestamps are used only if the SYN segment carried the option
+      if(queueItem->tsPermitted)
+      {
+         //Save the timestamp to be echoed in the SYN ACK segment
+         newSocket->tsRecent = queueItem->tsVal;
+         //The Timestamps option will be sent in every segment
+         newSocket->tsEnabled = TRUE;
+      }
+#endif
 
       //Send a SYN ACK control segment
       error = tcpSendSegment(newSocket, TCP_FLAG_SYN | TCP_FLAG_ACK,
@@ -393,7 +454,7 @@ error_t tcpSend(Socket *socket, const uint8_t *data,
       //transmission of data, overriding the SWS avoidance algorithm. In
       //practice, this timeout should seldom occur (see RFC 1122 4.2.3.4)
       if(socket->sndUser == n)
-         osTimerStart(&socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
+         tcpTimerStart(socket, &socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
 
       //The Nagle algorithm should be implemented to coalesce
       //short segments (refer to RFC 1122 4.2.3.4)
@@ -721,6 +782,8 @@ error_t tcpAbort(Socket *socket)
       tcpChangeState(socket, TCP_STATE_CLOSED);
       //Delete TCB
       tcpDeleteControlBlock(socket);
+      //Remove the socket from the lookup tables
+      socketHashRemove(socket);
       //Mark the socket as closed
       socket->type = SOCKET_TYPE_UNUSED;
       //Return status code
@@ -740,6 +803,8 @@ error_t tcpAbort(Socket *socket)
       tcpChangeState(socket, TCP_STATE_CLOSED);
       //Delete TCB
       tcpDeleteControlBlock(socket);
+      //Remove the socket from the lookup tables
+      socketHashRemove(socket);
       //Mark the socket as closed
       socket->type = SOCKET_TYPE_UNUSED;
       //No error to report
@@ -769,4 +834,20 @@ TcpState tcpGetState(Socket *socket)
    return state;
 }
 
+
+/**
+ * @brief Retrieve TCP statistics
+ * @param[out] stats Snapshot of the TCP counters
+ **/
+
+void tcpGetStats(TcpStats *stats)
+{
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Take a consistent snapshot of the counters
+   *stats = tcpStats;
+   //Leave critical section
+   osMutexRelease(socketMutex);
+}
+
 #endif
@@ -32,6 +32,7 @@
 //Dependencies
 #include "tcp_ip_stack_config.h"
 #include "ip.h"
+#include "net_timer.h"
 
 //TCP support
 #ifndef TCP_SUPPORT
@@ -40,13 +41,6 @@
    #error TCP_SUPPORT parameter is invalid
 #endif
 
-//TCP tick interval
-#ifndef TCP_TICK_INTERVAL
-   #define TCP_TICK_INTERVAL 100
-#elif (TCP_TICK_INTERVAL < 100)
-   #error TCP_TICK_INTERVAL parameter is invalid
-#endif
-
 //Maximum segment size
 #ifndef TCP_MAX_MSS
    #define TCP_MAX_MSS 1430
@@ -145,6 +139,18 @@
    #error TCP_LOSS_WINDOW parameter is invalid
 #endif
 
+//CUBIC congestion control support
+#ifndef TCP_CUBIC_SUPPORT
+   #define TCP_CUBIC_SUPPORT DISABLED
+#elif (TCP_CUBIC_SUPPORT != ENABLED && TCP_CUBIC_SUPPORT != DISABLED)
+   #error TCP_CUBIC_SUPPORT parameter is invalid
+#endif
+
+//Congestion control algorithm used by newly created sockets
+#ifndef TCP_DEFAULT_CONGESTION_CONTROL
+   #define TCP_DEFAULT_CONGESTION_CONTROL TCP_CONGESTION_CONTROL_NEW_RENO
+#endif
+
 //Default interval between successive window probes
 #ifndef TCP_DEFAULT_PROBE_INTERVAL
    #define TCP_DEFAULT_PROBE_INTERVAL 1000
@@ -194,10 +200,45 @@
    #error TCP_MAX_SACK_BLOCKS parameter is invalid
 #endif
 
+//Window scale option support
+#ifndef TCP_WINDOW_SCALE_SUPPORT
+   #define TCP_WINDOW_SCALE_SUPPORT DISABLED
+#elif (TCP_WINDOW_SCALE_SUPPORT != ENABLED && TCP_WINDOW_SCALE_SUPPORT != DISABLED)
+   #error TCP_WINDOW_SCALE_SUPPORT parameter is invalid
+#endif
+
+//Receive windows larger than 64 KB require the window scale option
+#if (TCP_WINDOW_SCALE_SUPPORT == DISABLED && TCP_MAX_RX_BUFFER_SIZE > 65535)
+   #error TCP_MAX_RX_BUFFER_SIZE parameter is invalid
+#endif
+
+//Timestamps option support
+#ifndef TCP_TIMESTAMP_SUPPORT
+   #define TCP_TIMESTAMP_SUPPORT DISABLED
+#elif (TCP_TIMESTAMP_SUPPORT != ENABLED && TCP_TIMESTAMP_SUPPORT != DISABLED)
+   #error TCP_TIMESTAMP_SUPPORT parameter is invalid
+#endif
+
+//Delayed acknowledgment support
+#ifndef TCP_DELAYED_ACK_SUPPORT
+   #define TCP_DELAYED_ACK_SUPPORT ENABLED
+#elif (TCP_DELAYED_ACK_SUPPORT != ENABLED && TCP_DELAYED_ACK_SUPPORT != DISABLED)
+   #error TCP_DELAYED_ACK_SUPPORT parameter is invalid
+#endif
+
+//Delayed ACK timeout (must be less than 0.5 seconds)
+#ifndef TCP_DELAYED_ACK_TIMEOUT
+   #define TCP_DELAYED_ACK_TIMEOUT 200
+#elif (TCP_DELAYED_ACK_TIMEOUT < 1 || TCP_DELAYED_ACK_TIMEOUT > 500)
+   #error TCP_DELAYED_ACK_TIMEOUT parameter is invalid
+#endif
+
 //Maximum TCP header length
 #define TCP_MAX_HEADER_LENGTH 60
 //Default maximum segment size
 #define TCP_DEFAULT_MSS 536
+//Maximum shift count of the window scale option
+#define TCP_MAX_WINDOW_SCALE 14
 
 //Sequence number comparison macro
 #define TCP_CMP_SEQ(a, b) ((int32_t) ((a) - (b)))
@@ -308,6 +349,8 @@ typedef struct _TcpQueueItem
    struct _TcpQueueItem *next;
    uint_t length;
    uint_t sacked;
+   uint_t lost;
+   uint_t retransmitted;
    union
    {
       TcpHeader header;
@@ -331,6 +374,17 @@ typedef struct _TcpSynQueueItem
    IpAddr destAddr;
    uint32_t isn;
    uint16_t mss;
+#if (TCP_SACK_SUPPORT == ENABLED)
+   bool_t sackPermitted;
+#endif
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+   bool_t wndScalePermitted;
+   uint8_t wndScale;
+#endif
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   bool_t tsPermitted;
+   uint32_t tsVal;
+#endif
 } TcpSynQueueItem;
 
 
@@ -369,6 +423,47 @@ typedef struct
 } TcpRxBuffer;
 
 
+/**
+ * @brief Congestion control algorithms
+ **/
+
+typedef enum
+{
+   TCP_CONGESTION_CONTROL_NEW_RENO = 0,
+   TCP_CONGESTION_CONTROL_CUBIC    = 1
+} TcpCongestionControl;
+
+
+/**
+ * @brief Loss recovery states
+ **/
+
+typedef enum
+{
+   TCP_CONGEST_STATE_IDLE          = 0,
+   TCP_CONGEST_STATE_RECOVERY      = 1,
+   TCP_CONGEST_STATE_LOSS_RECOVERY = 2
+} TcpCongestState;
+
+
+//Forward declaration of TcpCongestionOps structure
+struct _TcpCongestionOps;
+
+
+/**
+ * @brief Loss recovery statistics of a TCP connection
+ **/
+
+typedef struct
+{
+   uint32_t retransmits;          ///<Segments retransmitted
+   uint32_t timeouts;             ///<Retransmission timer expirations
+   uint32_t dupAcks;              ///<Duplicate ACKs received
+   uint32_t fastRecoveries;       ///<Fast recovery episodes (NewReno)
+   uint32_t sackRecoveries;       ///<Fast recovery episodes driven by the SACK scoreboard
+} TcpSocketStats;
+
+
 /**
  * @brief TCP Control Block (TCP)
  **/
@@ -386,15 +481,15 @@ typedef struct
 
    uint32_t sndUna;               ///<Data that have been sent but not yet acknowledged
    uint32_t sndNxt;               ///<Sequence number of the next byte to be sent
-   uint16_t sndUser;              ///<Amount of data buffered but not yet sent
-   uint16_t sndWnd;               ///<Size of the send window
-   uint16_t maxSndWnd;            ///<Maximum send window it has seen so far on the connection
+   uint32_t sndUser;              ///<Amount of data buffered but not yet sent
+   uint32_t sndWnd;               ///<Size of the send window
+   uint32_t maxSndWnd;            ///<Maximum send window it has seen so far on the connection
    uint32_t sndWl1;               ///<Segment sequence number used for last window update
    uint32_t sndWl2;               ///<Segment acknowledgment number used for last window update
 
    uint32_t rcvNxt;               ///<Receive next
-   uint16_t rcvUser;              ///<Number of data received but not yet consumed
-   uint16_t rcvWnd;               ///<Receive window
+   uint32_t rcvUser;              ///<Number of data received but not yet consumed
+   uint32_t rcvWnd;               ///<Receive window
 
    bool_t rttBusy;                ///<RTT measurement is being performed
    uint32_t rttSeqNum;            ///<Sequence number identifying a TCP segment
@@ -403,10 +498,26 @@ typedef struct
    time_t rttvar;                 ///<Round-trip time variation
    time_t rto;                    ///<Retransmission timeout
 
-   uint16_t cwnd;                 ///<Congestion window
-   uint16_t ssthresh;             ///<Slow start threshold
+   uint32_t cwnd;                 ///<Congestion window
+   uint32_t ssthresh;             ///<Slow start threshold
    uint_t dupAckCount;            ///<Number of consecutive duplicate ACKs
-   uint_t n;                      ///<Number of bytes acknowledged during the whole round-trip
+   uint_t n;                      ///<Number of bytes acknowledged since cwnd was last increased
+
+   TcpCongestionControl congestionControl;          ///<Selected congestion control algorithm
+   const struct _TcpCongestionOps *congestionOps;   ///<Congestion control operations
+   TcpCongestState congestState;                    ///<Loss recovery state
+   uint32_t recover;                                ///<Highest sequence number sent when loss was detected
+   uint32_t retransmitNxt;                          ///<Next sequence number to resend after a timeout
+
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+   uint32_t cubicWmax;            ///<Congestion window before the last reduction
+   uint32_t cubicLastWmax;        ///<Previous value of W_max (fast convergence)
+   uint32_t cubicOrigin;          ///<Origin point of the cubic function
+   uint32_t cubicK;               ///<Time to reach the origin point (ms)
+   uint32_t cubicEstWnd;          ///<Window estimated for standard TCP
+   uint32_t cubicCount;           ///<Fractional window increment accumulator
+   time_t cubicEpochStart;        ///<Beginning of the current congestion avoidance epoch
+#endif
 
    TcpTxBuffer txBuffer;          ///<Send buffer
    size_t txBufferSize;           ///<Size of the send buffer
@@ -426,17 +537,62 @@ typedef struct
    OsTimer overrideTimer;         ///<Override timer
    OsTimer finWait2Timer;         ///<FIN-WAIT-2 timer
    OsTimer timeWaitTimer;         ///<2MSL timer
+   NetTimer timer;                ///<Timer wheel entry of the connection
 
    bool_t sackPermitted;                        ///<SACK Permitted option received
    TcpSackBlock sackBlock[TCP_MAX_SACK_BLOCKS]; ///<List of non-contiguous blocks that have been received
    uint_t sackBlockCount;                       ///<Number of non-contiguous blocks that have been received
+   uint32_t sackHighSeq;                        ///<Highest sequence number SACKed by the peer
+   uint32_t pipe;                               ///<Estimate of the data outstanding in the network
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+   bool_t wndScaleEnabled;        ///<Window scale option in use
+   uint8_t sndWndShift;           ///<Shift count applied to the windows advertised by the peer
+   uint8_t rcvWndShift;           ///<Shift count applied to the windows we advertise
+#endif
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   bool_t tsEnabled;              ///<Timestamps option in use
+   uint32_t tsRecent;             ///<Timestamp to be echoed in the next segment sent
+   uint32_t tsEcr;                ///<Timestamp echoed by the incoming segment
+   uint32_t lastAckSent;          ///<Last acknowledgment number sent
+#endif
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   uint_t rcvUnacked;             ///<Amount of data received but not yet acknowledged
+   OsTimer delayedAckTimer;       ///<Delayed ACK timer
+   uint32_t rcvAdvEdge;           ///<Right edge of the last advertised receive window
+#endif
+
+   TcpSocketStats stats;          ///<Loss recovery statistics of the connection
 } TcpControlBlock;
 
 
+/**
+ * @brief TCP statistics
+ **/
+
+typedef struct
+{
+   uint32_t ackSent;              ///<Pure ACK segments sent
+   uint32_t ackDelayed;           ///<Data segments whose acknowledgment was deferred
+   uint32_t ackPiggybacked;       ///<Deferred acknowledgments carried by outgoing segments
+   uint32_t ackTimeouts;          ///<Deferred acknowledgments sent when the timer expired
+   uint32_t retransmits;          ///<Segments retransmitted
+   uint32_t timeouts;             ///<Retransmission timer expirations
+   uint32_t dupAcks;              ///<Duplicate ACKs received
+   uint32_t fastRecoveries;       ///<Fast recovery episodes (NewReno)
+   uint32_t sackRecoveries;       ///<Fast recovery episodes driven by the SACK scoreboard
+} TcpStats;
+
+
 //Forward declaration of Socket structure
 struct _Socket;
 typedef struct _Socket Socket;
 
+//TCP statistics
+extern TcpStats tcpStats;
+
 //TCP related functions
 error_t tcpConnect(Socket *socket);
 error_t tcpListen(Socket *socket);
@@ -451,5 +607,6 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
 error_t tcpShutdown(Socket *socket, uint_t how);
 error_t tcpAbort(Socket *socket);
 TcpState tcpGetState(Socket *socket);
+void tcpGetStats(TcpStats *stats);
 
 #endif
@@ -0,0 +1,640 @@
+/**
+ * @file tcp_congestion.c
+ * @brief TCP congestion control
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "socket.h"
+#include "tcp.h"
+#include "tcp_misc.h"
+#include "tcp_congestion.h"
+#include "tcp_cubic.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED)
+
+//Congestion control related functions
+static const TcpCongestionOps *tcpGetCongestionOps(TcpCongestionControl algo);
+static void tcpCongestionGoBackN(Socket *socket);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+static void tcpCongestionSackRecovery(Socket *socket);
+static TcpQueueItem *tcpCongestionSackNextSeg(Socket *socket);
+#endif
+
+//NewReno callbacks
+static void tcpNewRenoInit(Socket *socket);
+static void tcpNewRenoOnAck(Socket *socket, uint_t n);
+static uint32_t tcpNewRenoOnLoss(Socket *socket);
+
+//NewReno congestion control (RFC 5681 and RFC 6582)
+const TcpCongestionOps tcpNewRenoOps =
+{
+   TCP_CONGESTION_CONTROL_NEW_RENO,
+   "newreno",
+   tcpNewRenoInit,
+   tcpNewRenoOnAck,
+   tcpNewRenoOnLoss,
+   NULL,
+   NULL
+};
+
+//List of available congestion control algorithms
+static const TcpCongestionOps *const tcpCongestionOpsTable[] =
+{
+   &tcpNewRenoOps,
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+   &tcpCubicOps,
+#endif
+};
+
+
+/**
+ * @brief Select the congestion control algorithm of a socket
+ * @param[in] socket Handle referencing the socket
+ * @param[in] algo Congestion control algorithm
+ * @return Error code
+ **/
+
+error_t tcpSetCongestionControl(Socket *socket, TcpCongestionControl algo)
+{
+   //The algorithm cannot be changed once the connection is established
+   if(socket->state != TCP_STATE_CLOSED && socket->state != TCP_STATE_LISTEN)
+      return ERROR_ALREADY_CONNECTED;
+
+   //The algorithm has been compiled out?
+   if(!tcpGetCongestionOps(algo))
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the selected algorithm
+   socket->congestionControl = algo;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Initialize congestion control state
+ *
+ * This function is called once the MSS has been negotiated,
+ * before the connection enters the ESTABLISHED state
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpCongestionInit(Socket *socket)
+{
+   //Resolve the selected algorithm
+   socket->congestionOps = tcpGetCongestionOps(socket->congestionControl);
+
+   //Fall back to NewReno if the algorithm is not available
+   if(!socket->congestionOps)
+      socket->congestionOps = &tcpNewRenoOps;
+
+   //No loss recovery in progress
+   socket->congestState = TCP_CONGEST_STATE_IDLE;
+   socket->recover = socket->iss;
+   //Reset the byte counter
+   socket->n = 0;
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //Empty scoreboard
+   socket->sackHighSeq = socket->iss;
+   socket->pipe = 0;
+#endif
+
+   //Initial congestion window
+   socket->cwnd = min(TCP_INITIAL_WINDOW * socket->mss, socket->txBufferSize);
+   //Slow start threshold should be set arbitrarily high
+   socket->ssthresh = UINT32_MAX;
+
+   //Algorithm specific initialization
+   socket->congestionOps->init(socket);
+
+   //Debug message
+   TRACE_DEBUG("TCP congestion control: %s\r\n", socket->congestionOps->name);
+}
+
+
+/**
+ * @brief Congestion control processing of an ACK that acknowledges new data
+ *
+ * SND.UNA and the retransmission queue must have been updated
+ * before this function is called
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] n Number of bytes acknowledged by the incoming ACK
+ **/
+
+void tcpCongestionOnAck(Socket *socket, uint_t n)
+{
+   //Amount of data that has been sent but not yet acknowledged
+   uint_t flightSize = socket->sndNxt - socket->sndUna;
+
+   //Fast recovery in progress?
+   if(socket->congestState == TCP_CONGEST_STATE_RECOVERY)
+   {
+      //Full acknowledgment?
+      if(TCP_CMP_SEQ(socket->sndUna, socket->recover) >= 0)
+      {
+         //Deflate the congestion window (see RFC 6582 3.2 step 3)
+         socket->cwnd = min(socket->ssthresh, max(flightSize, socket->mss) + socket->mss);
+         //Exit fast recovery
+         socket->congestState = TCP_CONGEST_STATE_IDLE;
+         //Reset the byte counter
+         socket->n = 0;
+
+         //Debug message
+         TRACE_INFO("TCP fast recovery complete (cwnd=%u)\r\n", socket->cwnd);
+      }
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //Partial acknowledgment with SACK in use?
+      else if(socket->sackPermitted)
+      {
+         //The first unacknowledged segment is assumed to be lost as well
+         if(socket->retransmitQueue && !socket->retransmitQueue->sacked)
+            socket->retransmitQueue->lost = TRUE;
+
+         //Fill the holes reported by the receiver
+         tcpCongestionSackRecovery(socket);
+      }
+#endif
+      //Partial acknowledgment?
+      else
+      {
+         //The first unacknowledged segment is assumed to be lost as well
+         //and must be retransmitted immediately (see RFC 6582 3.2 step 3)
+         tcpRetransmitSegment(socket);
+
+         //Deflate the congestion window by the amount of new data
+         //acknowledged, then add back one SMSS
+         socket->cwnd = (socket->cwnd > n) ? (socket->cwnd - n) : 0;
+         if(n >= socket->mss)
+            socket->cwnd += socket->mss;
+
+         //Debug message
+         TRACE_INFO("TCP partial ACK (cwnd=%u)\r\n", socket->cwnd);
+      }
+   }
+   else
+   {
+      //Let the algorithm grow the congestion window
+      socket->congestionOps->onAck(socket, n);
+
+      //Recovering from a retransmission timeout?
+      if(socket->congestState == TCP_CONGEST_STATE_LOSS_RECOVERY)
+      {
+         //All the data outstanding when the timer expired has been acknowledged?
+         if(TCP_CMP_SEQ(socket->sndUna, socket->recover) >= 0)
+         {
+            //Exit loss recovery
+            socket->congestState = TCP_CONGEST_STATE_IDLE;
+         }
+         else
+         {
+            //Keep on resending the outstanding data as cwnd opens up
+            tcpCongestionGoBackN(socket);
+         }
+      }
+   }
+
+   //Limit the size of the congestion window
+   socket->cwnd = max(socket->cwnd, socket->mss);
+   socket->cwnd = min(socket->cwnd, socket->txBufferSize);
+}
+
+
+/**
+ * @brief Congestion control processing of a duplicate ACK
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpCongestionOnDupAck(Socket *socket)
+{
+   bool_t lossDetected;
+
+   //Loss is detected upon the receipt of DupThresh duplicate ACKs
+   lossDetected = (socket->dupAckCount == TCP_FAST_RETRANSMIT_THRES);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //With SACK, loss is also detected as soon as the scoreboard
+   //shows that the first unacknowledged segment has been lost
+   if(socket->sackPermitted && socket->retransmitQueue && socket->retransmitQueue->lost)
+      lossDetected = TRUE;
+
+   //Fast recovery in progress with SACK in use?
+   if(socket->congestState == TCP_CONGEST_STATE_RECOVERY && socket->sackPermitted)
+   {
+      //The congestion window is not inflated. Instead, the holes are
+      //retransmitted as the pipe estimate allows (see RFC 6675 5)
+      tcpCongestionSackRecovery(socket);
+   }
+   else
+#endif
+   //Fast recovery in progress?
+   if(socket->congestState == TCP_CONGEST_STATE_RECOVERY)
+   {
+      //For each additional duplicate ACK received, cwnd must be incremented
+      //by SMSS. This artificially inflates the congestion window in order
+      //to reflect the additional segment that has left the network
+      socket->cwnd += socket->mss;
+   }
+   //Check whether a segment has been lost
+   else if(lossDetected && socket->congestState == TCP_CONGEST_STATE_IDLE)
+   {
+      //Duplicate ACKs that do not cover the data outstanding at the time of
+      //a previous loss must not trigger fast retransmit (see RFC 6582 3.2)
+      if(TCP_CMP_SEQ(socket->sndUna, socket->recover) >= 0)
+      {
+         //Debug message
+         TRACE_INFO("%s: TCP fast retransmit...\r\n", timeFormat(osGetTickCount()));
+
+         //Adjust ssthresh value
+         socket->ssthresh = socket->congestionOps->onLoss(socket);
+         //Record the highest sequence number transmitted so far
+         socket->recover = socket->sndNxt;
+
+         //TCP performs a retransmission of what appears to be the missing
+         //segment, without waiting for the retransmission timer to expire
+         tcpRetransmitSegment(socket);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+         //SACK based loss recovery?
+         if(socket->sackPermitted)
+         {
+            //The congestion window is set to ssthresh (see RFC 6675 5 step 4)
+            socket->cwnd = socket->ssthresh;
+            //Enter fast recovery
+            socket->congestState = TCP_CONGEST_STATE_RECOVERY;
+            //Update statistics
+            socket->stats.sackRecoveries++;
+            tcpStats.sackRecoveries++;
+            //Retransmit the remaining holes if the pipe allows
+            tcpCongestionSackRecovery(socket);
+         }
+         else
+#endif
+         {
+            //cwnd must set to ssthresh plus 3*SMSS. This artificially inflates
+            //the congestion window by the number of segments (three) that have
+            //left the network and which the receiver has buffered
+            socket->cwnd = socket->ssthresh + TCP_FAST_RETRANSMIT_THRES * socket->mss;
+            //Enter fast recovery
+            socket->congestState = TCP_CONGEST_STATE_RECOVERY;
+            //Update statistics
+            socket->stats.fastRecoveries++;
+            tcpStats.fastRecoveries++;
+         }
+      }
+   }
+
+   //Limit the size of the congestion window
+   socket->cwnd = min(socket->cwnd, socket->txBufferSize);
+}
+
+
+/**
+ * @brief Congestion control processing of a retransmission timeout
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpCongestionOnRto(Socket *socket)
+{
+#if (TCP_SACK_SUPPORT == ENABLED)
+   TcpQueueItem *queueItem;
+#endif
+
+   //The algorithm is only selected once the connection is established,
+   //hence SYN retransmissions leave the congestion state untouched
+   if(!socket->congestionOps)
+      return;
+
+   //When a TCP sender detects segment loss using the retransmission
+   //timer and the given segment has not yet been resent by way of
+   //the retransmission timer, the value of ssthresh must be updated
+   if(!socket->retransmitCount)
+      socket->ssthresh = socket->congestionOps->onLoss(socket);
+
+   //Furthermore, upon a timeout cwnd must be set to no more than
+   //the loss window, LW, which equals 1 full-sized segment
+   socket->cwnd = min(TCP_LOSS_WINDOW * socket->mss, socket->txBufferSize);
+
+   //Any fast recovery in progress is terminated. The data sent so far
+   //must be acknowledged before fast retransmit can be used again
+   socket->congestState = TCP_CONGEST_STATE_LOSS_RECOVERY;
+   socket->recover = socket->sndNxt;
+   //The earliest segment is about to be resent by the caller
+   socket->retransmitNxt = socket->sndUna;
+
+   //Point to the earliest unacknowledged segment
+   if(socket->retransmitQueue)
+   {
+      socket->retransmitNxt = ntohl(socket->retransmitQueue->header.seqNum) +
+         socket->retransmitQueue->length;
+   }
+   //Reset the byte counter
+   socket->n = 0;
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //The receiver may have discarded the data it reported, hence the SACK
+   //information must be cleared after a timeout (see RFC 2018 8)
+   for(queueItem = socket->retransmitQueue; queueItem != NULL; queueItem = queueItem->next)
+   {
+      queueItem->sacked = FALSE;
+      queueItem->lost = FALSE;
+      queueItem->retransmitted = FALSE;
+   }
+
+   //Reset the scoreboard
+   socket->sackHighSeq = socket->sndUna;
+   socket->pipe = 0;
+#endif
+
+   //Algorithm specific processing
+   if(socket->congestionOps->onRto)
+      socket->congestionOps->onRto(socket);
+}
+
+
+/**
+ * @brief Resend the data outstanding when the retransmission timer expired
+ *
+ * After a timeout, the receiver may have discarded any out-of-order data.
+ * The segments of the retransmission queue are therefore resent in
+ * sequence, at most once per timeout, as allowed by the congestion
+ * window (see RFC 5681 section 3.1)
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpCongestionGoBackN(Socket *socket)
+{
+   uint32_t seqNum;
+   uint32_t length;
+   TcpQueueItem *queueItem;
+
+   //Segments acknowledged in the meantime need not be resent
+   if(TCP_CMP_SEQ(socket->retransmitNxt, socket->sndUna) < 0)
+      socket->retransmitNxt = socket->sndUna;
+
+   //Loop through the retransmission queue
+   for(queueItem = socket->retransmitQueue; queueItem != NULL; queueItem = queueItem->next)
+   {
+      //Sequence number and length of the current segment
+      seqNum = ntohl(queueItem->header.seqNum);
+      length = queueItem->length;
+
+      //The FIN flag occupies one sequence number
+      if(queueItem->header.flags & TCP_FLAG_FIN)
+         length++;
+
+      //Skip the segments that have already been resent
+      if(TCP_CMP_SEQ(seqNum, socket->retransmitNxt) < 0)
+         continue;
+      //Skip the segments SACKed since the timer expired
+      if(queueItem->sacked)
+         continue;
+      //Only the data outstanding when the timer expired is concerned
+      if(TCP_CMP_SEQ(seqNum, socket->recover) >= 0)
+         break;
+      //Retransmissions are clocked by the congestion window
+      if((seqNum + length - socket->sndUna) > socket->cwnd)
+         break;
+
+      //Resend the current segment
+      tcpRetransmitQueueItem(socket, queueItem);
+      //Update the retransmission pointer
+      socket->retransmitNxt = seqNum + length;
+   }
+}
+
+
+/**
+ * @brief Get the congestion window usable for transmission
+ * @param[in] socket Handle referencing the socket
+ * @return Congestion window, in bytes
+ **/
+
+uint32_t tcpCongestionGetWindow(Socket *socket)
+{
+   uint32_t cwnd;
+#if (TCP_SACK_SUPPORT == ENABLED)
+   uint32_t flightSize;
+#endif
+
+   //The algorithm may override the congestion window
+   if(socket->congestionOps && socket->congestionOps->getCwnd)
+      cwnd = socket->congestionOps->getCwnd(socket);
+   else
+      cwnd = socket->cwnd;
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //During SACK based loss recovery, new data can be sent as long as
+   //cwnd - pipe is at least one SMSS (see RFC 6675 5 step C)
+   if(socket->congestState == TCP_CONGEST_STATE_RECOVERY && socket->sackPermitted)
+   {
+      //Amount of data that has been sent but not yet acknowledged
+      flightSize = socket->sndNxt - socket->sndUna;
+
+      //The caller subtracts the flight size from the returned value
+      if(socket->pipe < (cwnd + flightSize))
+         cwnd = cwnd + flightSize - socket->pipe;
+      else
+         cwnd = 0;
+   }
+#endif
+
+   //Return the usable congestion window
+   return cwnd;
+}
+
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+
+/**
+ * @brief Retransmit the holes reported by the receiver
+ *
+ * Segments are retransmitted as long as the congestion window allows
+ * at least one more full-sized segment to be in flight. New data is
+ * sent afterwards by the regular transmission path
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpCongestionSackRecovery(Socket *socket)
+{
+   error_t error;
+   TcpQueueItem *queueItem;
+
+   //Transmit while cwnd - pipe >= SMSS (see RFC 6675 5 step C)
+   while((socket->pipe + socket->mss) <= socket->cwnd)
+   {
+      //Select the next segment to be retransmitted
+      queueItem = tcpCongestionSackNextSeg(socket);
+      //No more holes to fill?
+      if(!queueItem) break;
+
+      //Debug message
+      TRACE_INFO("TCP selective retransmission (seq=%u, pipe=%u)\r\n",
+         ntohl(queueItem->header.seqNum) - socket->iss, socket->pipe);
+
+      //Retransmit the segment. This also updates the pipe estimate
+      error = tcpRetransmitQueueItem(socket, queueItem);
+      //Failed to send TCP segment?
+      if(error) break;
+   }
+}
+
+
+/**
+ * @brief Select the next segment to be retransmitted
+ * @param[in] socket Handle referencing the socket
+ * @return Pointer to the segment, or NULL if no hole is eligible
+ **/
+
+static TcpQueueItem *tcpCongestionSackNextSeg(Socket *socket)
+{
+   TcpQueueItem *queueItem;
+   TcpQueueItem *candidate = NULL;
+
+   //Loop through the retransmission queue
+   for(queueItem = socket->retransmitQueue; queueItem != NULL; queueItem = queueItem->next)
+   {
+      //Only the holes below the highest SACKed sequence number are concerned
+      if(TCP_CMP_SEQ(ntohl(queueItem->header.seqNum), socket->sackHighSeq) >= 0)
+         break;
+      //Skip the segments held by the receiver or already resent
+      if(queueItem->sacked || queueItem->retransmitted)
+         continue;
+
+      //The first segment deemed lost is resent first (rule 1)
+      if(queueItem->lost)
+         return queueItem;
+
+      //Remember the first hole that is not yet deemed lost
+      if(!candidate)
+         candidate = queueItem;
+   }
+
+   //When no new data is available for transmission, the first
+   //hole that is not yet deemed lost can be resent (rule 3)
+   if(!socket->sndUser)
+      return candidate;
+
+   //New data will be sent instead (rule 2)
+   return NULL;
+}
+
+#endif
+
+
+/**
+ * @brief Retrieve the operations implementing a congestion control algorithm
+ * @param[in] algo Congestion control algorithm
+ * @return Pointer to the matching operations, or NULL if not supported
+ **/
+
+static const TcpCongestionOps *tcpGetCongestionOps(TcpCongestionControl algo)
+{
+   uint_t i;
+
+   //Loop through the list of available algorithms
+   for(i = 0; i < arraysize(tcpCongestionOpsTable); i++)
+   {
+      //Matching entry?
+      if(tcpCongestionOpsTable[i]->algo == algo)
+         return tcpCongestionOpsTable[i];
+   }
+
+   //The algorithm has been compiled out
+   return NULL;
+}
+
+
+/**
+ * @brief NewReno initialization
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpNewRenoInit(Socket *socket)
+{
+   //The default initial window and ssthresh are used
+}
+
+
+/**
+ * @brief NewReno window growth
+ * @param[in] socket Handle referencing the socket
+ * @param[in] n Number of bytes acknowledged by the incoming ACK
+ **/
+
+static void tcpNewRenoOnAck(Socket *socket, uint_t n)
+{
+   //Slow start algorithm is used when cwnd is lower than ssthresh
+   if(socket->cwnd < socket->ssthresh)
+   {
+      //During slow start, TCP increments cwnd by at most SMSS bytes
+      //for each ACK received that cumulatively acknowledges new data
+      socket->cwnd += min(n, socket->mss);
+   }
+   //Congestion avoidance algorithm is used when cwnd exceeds ssthresh
+   else
+   {
+      //Count the number of bytes acknowledged (see RFC 5681 3.1)
+      socket->n += n;
+
+      //Increment cwnd by one SMSS each time a full window has been acknowledged
+      if(socket->n >= socket->cwnd)
+      {
+         socket->n -= socket->cwnd;
+         socket->cwnd += socket->mss;
+      }
+   }
+}
+
+
+/**
+ * @brief NewReno reaction to a loss
+ * @param[in] socket Handle referencing the socket
+ * @return New value of ssthresh
+ **/
+
+static uint32_t tcpNewRenoOnLoss(Socket *socket)
+{
+   //Amount of data that has been sent but not yet acknowledged
+   uint_t flightSize = socket->sndNxt - socket->sndUna;
+
+   //Reduce ssthresh to half of the flight size (see RFC 5681 3.1)
+   return max(flightSize / 2, 2 * socket->mss);
+}
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file tcp_congestion.h
+ * @brief TCP congestion control
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _TCP_CONGESTION_H
+#define _TCP_CONGESTION_H
+
+//Dependencies
+#include "tcp.h"
+
+
+/**
+ * @brief Congestion control operations
+ **/
+
+typedef struct _TcpCongestionOps
+{
+   TcpCongestionControl algo;                ///<Algorithm identifier
+   const char_t *name;                       ///<Algorithm name
+   void (*init)(Socket *socket);             ///<Initialize cwnd and ssthresh once the MSS is known
+   void (*onAck)(Socket *socket, uint_t n);  ///<Grow cwnd when new data is acknowledged
+   uint32_t (*onLoss)(Socket *socket);       ///<React to a loss and return the new ssthresh
+   void (*onRto)(Socket *socket);            ///<React to a retransmission timeout (optional)
+   uint32_t (*getCwnd)(Socket *socket);      ///<Return the usable congestion window (optional)
+} TcpCongestionOps;
+
+
+//NewReno congestion control
+extern const TcpCongestionOps tcpNewRenoOps;
+
+//Congestion control related functions
+error_t tcpSetCongestionControl(Socket *socket, TcpCongestionControl algo);
+
+void tcpCongestionInit(Socket *socket);
+void tcpCongestionOnAck(Socket *socket, uint_t n);
+void tcpCongestionOnDupAck(Socket *socket);
+void tcpCongestionOnRto(Socket *socket);
+uint32_t tcpCongestionGetWindow(Socket *socket);
+
+#endif
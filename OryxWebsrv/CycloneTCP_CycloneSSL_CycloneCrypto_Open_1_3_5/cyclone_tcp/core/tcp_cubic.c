@@ -0,0 +1,250 @@
+/**
+ * @file tcp_cubic.c
+ * @brief CUBIC congestion control (RFC 8312)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * CUBIC replaces the linear window growth of standard TCP by a cubic
+ * function of the time elapsed since the last congestion event, which
+ * scales better on paths with a large bandwidth-delay product. Window
+ * sizes are expressed in bytes and time in milliseconds, so that the
+ * whole computation is carried out with integer arithmetic
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "socket.h"
+#include "tcp.h"
+#include "tcp_cubic.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED && TCP_CUBIC_SUPPORT == ENABLED)
+
+//CUBIC callbacks
+static void tcpCubicInit(Socket *socket);
+static void tcpCubicOnAck(Socket *socket, uint_t n);
+static uint32_t tcpCubicOnLoss(Socket *socket);
+static void tcpCubicOnRto(Socket *socket);
+static uint32_t tcpCubicRoot(uint64_t a);
+
+//CUBIC congestion control
+const TcpCongestionOps tcpCubicOps =
+{
+   TCP_CONGESTION_CONTROL_CUBIC,
+   "cubic",
+   tcpCubicInit,
+   tcpCubicOnAck,
+   tcpCubicOnLoss,
+   tcpCubicOnRto,
+   NULL
+};
+
+
+/**
+ * @brief CUBIC initialization
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpCubicInit(Socket *socket)
+{
+   //No congestion event has occurred yet
+   socket->cubicWmax = 0;
+   socket->cubicLastWmax = 0;
+   socket->cubicEpochStart = 0;
+}
+
+
+/**
+ * @brief CUBIC window growth
+ * @param[in] socket Handle referencing the socket
+ * @param[in] n Number of bytes acknowledged by the incoming ACK
+ **/
+
+static void tcpCubicOnAck(Socket *socket, uint_t n)
+{
+   time_t time;
+   time_t rtt;
+   int64_t d;
+   int64_t target;
+   int64_t estimate;
+   uint64_t acc;
+
+   //Slow start algorithm is used when cwnd is lower than ssthresh
+   if(socket->cwnd < socket->ssthresh)
+   {
+      //During slow start, TCP increments cwnd by at most SMSS bytes
+      //for each ACK received that cumulatively acknowledges new data
+      socket->cwnd += min(n, socket->mss);
+      //Exit immediately
+      return;
+   }
+
+   //Get current time
+   time = osGetTickCount();
+   //Use a conservative RTT until the first measurement is available
+   rtt = socket->srtt ? socket->srtt : TCP_INITIAL_RTO;
+
+   //Beginning of a new congestion avoidance epoch?
+   if(!socket->cubicEpochStart)
+   {
+      //Record the start of the epoch (zero is reserved)
+      socket->cubicEpochStart = time ? time : 1;
+      //Reset the increment accumulator
+      socket->cubicCount = 0;
+      //Window estimated for standard TCP
+      socket->cubicEstWnd = socket->cwnd;
+
+      //The window is below the value reached before the last reduction?
+      if(socket->cwnd < socket->cubicWmax)
+      {
+         //Time needed to grow back to W_max, K = cbrt((W_max - cwnd) / C),
+         //where C = 0.4 segments per second cubed (see RFC 8312 4.1)
+         socket->cubicK = tcpCubicRoot((uint64_t) (socket->cubicWmax - socket->cwnd) *
+            2500000000ULL / socket->mss);
+         //The cubic function is centered on W_max
+         socket->cubicOrigin = socket->cubicWmax;
+      }
+      else
+      {
+         //Start probing from the current window
+         socket->cubicK = 0;
+         socket->cubicOrigin = socket->cwnd;
+      }
+   }
+
+   //Time elapsed in the current epoch. The window targeted is the one
+   //to be reached one RTT later (see RFC 8312 4.1)
+   d = (int64_t) (time - socket->cubicEpochStart) + rtt - socket->cubicK;
+   //Keep the cube within 64 bits
+   d = max(d, -2000000);
+   d = min(d, 2000000);
+
+   //W_cubic(t) = C * (t - K)^3 + W_max
+   target = (d * d * d / 1000000) * 4 * socket->mss / 10000 + socket->cubicOrigin;
+   target = max(target, 0);
+
+   //Window standard TCP would have reached during the same period,
+   //W_est = W_max * beta + 3 * (1 - beta) / (1 + beta) * t / RTT
+   estimate = (int64_t) socket->cubicWmax * TCP_CUBIC_BETA_NUM / TCP_CUBIC_BETA_DEN +
+      (int64_t) 9 * socket->mss * (time - socket->cubicEpochStart) / (17 * rtt);
+
+   //In the TCP-friendly region, CUBIC must grow at least as fast
+   //as standard TCP (see RFC 8312 4.2)
+   target = max(target, estimate);
+   //The window must not grow by more than 50% per RTT (see RFC 8312 4.3)
+   target = min(target, (int64_t) socket->cwnd * 3 / 2);
+   //Keep probing slowly around the plateau
+   target = max(target, (int64_t) socket->cwnd + socket->cwnd / 100);
+
+   //cwnd is increased by (W_cubic(t + RTT) - cwnd) / cwnd for each
+   //segment acknowledged, with fractional increments carried over
+   acc = socket->cubicCount + (uint64_t) (target - socket->cwnd) * n;
+   socket->cubicCount = acc % socket->cwnd;
+   socket->cwnd += (uint32_t) (acc / socket->cwnd);
+}
+
+
+/**
+ * @brief CUBIC reaction to a loss
+ * @param[in] socket Handle referencing the socket
+ * @return New value of ssthresh
+ **/
+
+static uint32_t tcpCubicOnLoss(Socket *socket)
+{
+   uint32_t w;
+
+   //A new congestion avoidance epoch will start
+   socket->cubicEpochStart = 0;
+
+   //The congestion window may exceed the amount of data actually in
+   //flight when the sender is limited by the application or by the
+   //send buffer. The flight size is used instead (see RFC 8312 4.5)
+   w = min(socket->cwnd, socket->sndNxt - socket->sndUna);
+
+   //Fast convergence releases bandwidth for new flows when the
+   //window keeps on decreasing (see RFC 8312 4.6)
+   if(w < socket->cubicLastWmax)
+   {
+      socket->cubicLastWmax = w;
+      socket->cubicWmax = w * (TCP_CUBIC_BETA_DEN + TCP_CUBIC_BETA_NUM) /
+         (2 * TCP_CUBIC_BETA_DEN);
+   }
+   else
+   {
+      socket->cubicLastWmax = w;
+      socket->cubicWmax = w;
+   }
+
+   //Multiplicative decrease (see RFC 8312 4.5)
+   return max(w * TCP_CUBIC_BETA_NUM / TCP_CUBIC_BETA_DEN, 2 * socket->mss);
+}
+
+
+/**
+ * @brief CUBIC reaction to a retransmission timeout
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpCubicOnRto(Socket *socket)
+{
+   //Restart from slow start with a new epoch (see RFC 8312 4.7)
+   socket->cubicEpochStart = 0;
+}
+
+
+/**
+ * @brief Integer cube root
+ * @param[in] a Input value
+ * @return Largest integer whose cube does not exceed the input value
+ **/
+
+static uint32_t tcpCubicRoot(uint64_t a)
+{
+   int_t i;
+   uint32_t x;
+   uint32_t y;
+
+   //Compute the result bit by bit, starting from the most significant one
+   for(x = 0, i = 20; i >= 0; i--)
+   {
+      //Try to set the current bit
+      y = x | (1UL << i);
+
+      //Keep the bit if the cube does not exceed the input value
+      if((uint64_t) y * y * y <= a)
+         x = y;
+   }
+
+   //Return the cube root
+   return x;
+}
+
+#endif
@@ -49,6 +49,8 @@
 #include "tcp.h"
 #include "tcp_fsm.h"
 #include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_congestion.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -66,11 +68,12 @@
 void tcpProcessSegment(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, const ChunkedBuffer *buffer, size_t offset)
 {
-   uint_t i;
    size_t length;
    Socket *socket;
-   Socket *passiveSocket;
    TcpHeader *segment;
+#if (NET_STATS_SUPPORT == ENABLED)
+   uint32_t rcvNxt;
+#endif
 
    //A TCP implementation must silently discard an incoming
    //segment that is addressed to a broadcast or multicast
@@ -131,6 +134,8 @@ void tcpProcessSegment(NetInterface *interface,
    {
       //Debug message
       TRACE_WARNING("Wrong TCP header checksum!\r\n");
+      //Update statistics
+      interface->stats.checksumErrors++;
       //Exit immediately
       return;
    }
@@ -138,99 +143,10 @@ void tcpProcessSegment(NetInterface *interface,
    //Enter critical section
    osMutexAcquire(socketMutex);
 
-   //No matching socket in the LISTEN state for the moment
-   passiveSocket = NULL;
-
-   //Look through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
-   {
-      //Point to the current socket
-      socket = socketTable + i;
-
-      //TCP socket found?
-      if(socket->type != SOCKET_TYPE_STREAM)
-         continue;
-      //Check whether the socket is bound to a particular interface
-      if(socket->interface && socket->interface != interface)
-         continue;
-      //Check destination port number
-      if(socket->localPort != ntohs(segment->destPort))
-         continue;
-
-#if (IPV4_SUPPORT == ENABLED)
-      //An IPv4 packet was received?
-      if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
-      {
-         //Destination IP address filtering
-         if(socket->localIpAddr.length)
-         {
-            //An IPv4 address is expected
-            if(socket->localIpAddr.length != sizeof(Ipv4Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(socket->localIpAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
-               continue;
-         }
-         //Source IP address filtering
-         if(socket->remoteIpAddr.length)
-         {
-            //An IPv4 address is expected
-            if(socket->remoteIpAddr.length != sizeof(Ipv4Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(socket->remoteIpAddr.ipv4Addr != pseudoHeader->ipv4Data.srcAddr)
-               continue;
-         }
-      }
-      else
-#endif
-#if (IPV6_SUPPORT == ENABLED)
-      //An IPv6 packet was received?
-      if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
-      {
-         //Destination IP address filtering
-         if(socket->localIpAddr.length)
-         {
-            //An IPv6 address is expected
-            if(socket->localIpAddr.length != sizeof(Ipv6Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(!ipv6CompAddr(&socket->localIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
-               continue;
-         }
-         //Source IP address filtering
-         if(socket->remoteIpAddr.length)
-         {
-            //An IPv6 address is expected
-            if(socket->remoteIpAddr.length != sizeof(Ipv6Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(!ipv6CompAddr(&socket->remoteIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.srcAddr))
-               continue;
-         }
-      }
-      else
-#endif
-      //An invalid packet was received?
-      {
-         //This should never occur...
-         continue;
-      }
-
-      //Keep track of the first matching socket in the LISTEN state
-      if(socket->state == TCP_STATE_LISTEN && !passiveSocket)
-         passiveSocket = socket;
-      //Source port filtering
-      if(socket->remotePort != ntohs(segment->srcPort))
-         continue;
-
-      //A matching socket has been found
-      break;
-   }
-
-   //If no matching socket has been found then try to
-   //use the first matching socket in the LISTEN state
-   if(i >= SOCKET_MAX_COUNT) socket = passiveSocket;
+   //Find the socket the segment belongs to. If no fully specified
+   //socket matches, the first matching socket in the LISTEN state is used
+   socket = socketHashLookup(SOCKET_TYPE_STREAM, interface, pseudoHeader,
+      ntohs(segment->srcPort), ntohs(segment->destPort));
 
    //Offset to the first data byte
    offset += segment->dataOffset * 4;
@@ -268,6 +184,11 @@ void tcpProcessSegment(NetInterface *interface,
       return;
    }
 
+#if (NET_STATS_SUPPORT == ENABLED)
+   //Save the sequence number of the next byte expected
+   rcvNxt = socket->rcvNxt;
+#endif
+
    //Check current state
    switch(socket->state)
    {
@@ -348,6 +269,12 @@ void tcpProcessSegment(NetInterface *interface,
       break;
    }
 
+#if (NET_STATS_SUPPORT == ENABLED)
+   //The payload has been added to the receive buffer?
+   if(length > 0 && socket->rcvNxt != rcvNxt)
+      netStatsRecordRxLatency(interface);
+#endif
+
    //Leave critical section
    osMutexRelease(socketMutex);
 }
@@ -508,6 +435,47 @@ void tcpStateListen(Socket *socket, NetInterface *interface,
          queueItem->mss = max(queueItem->mss, TCP_MIN_MSS);
       }
 
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //Get the SACK Permitted option
+      option = tcpGetOption(segment, TCP_OPTION_SACK_PERMITTED);
+      //The peer is willing to receive SACK options?
+      queueItem->sackPermitted = (option && option->length == 2);
+#endif
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Get the window scale factor
+      option = tcpGetOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR);
+      //Specified option found?
+      if(option && option->length == 3)
+      {
+         //The peer is willing to perform window scaling
+         queueItem->wndScalePermitted = TRUE;
+         //Retrieve the shift count
+         queueItem->wndScale = option->value[0];
+      }
+      else
+      {
+         //Window scaling is not supported by the peer
+         queueItem->wndScalePermitted = FALSE;
+         queueItem->wndScale = 0;
+      }
+#endif
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Get the Timestamps option
+      if(!tcpGetTimestampOption(segment, &queueItem->tsVal, NULL))
+      {
+         //The peer is willing to use timestamps
+         queueItem->tsPermitted = TRUE;
+      }
+      else
+      {
+         //Timestamps are not supported by the peer
+         queueItem->tsPermitted = FALSE;
+         queueItem->tsVal = 0;
+      }
+#endif
+
       //Notify user that a connection request is pending
       tcpUpdateEvents(socket);
 
@@ -574,6 +542,46 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
       if(segment->flags & TCP_FLAG_ACK)
          socket->sndUna = segment->ackNum;
 
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //Get the SACK Permitted option
+      option = tcpGetOption(segment, TCP_OPTION_SACK_PERMITTED);
+      //SACK is in use only if both sides sent the option
+      socket->sackPermitted = (option && option->length == 2);
+#endif
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Get the window scale factor
+      option = tcpGetOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR);
+      //Window scaling is in effect only if both sides sent the option
+      if(option && option->length == 3)
+      {
+         //Shift count to be applied to the windows advertised by the peer
+         socket->sndWndShift = min(option->value[0], TCP_MAX_WINDOW_SCALE);
+      }
+      else
+      {
+         //Fall back to unscaled windows in both directions
+         socket->wndScaleEnabled = FALSE;
+         socket->sndWndShift = 0;
+         socket->rcvWndShift = 0;
+      }
+#endif
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Get the Timestamps option
+      if(!tcpGetTimestampOption(segment, &socket->tsRecent, &socket->tsEcr))
+      {
+         //The echoed timestamp is only meaningful when the ACK bit is set
+         if(!(segment->flags & TCP_FLAG_ACK))
+            socket->tsEcr = 0;
+      }
+      else
+      {
+         //The peer does not support timestamps
+         socket->tsEnabled = FALSE;
+      }
+#endif
+
       //Compute retransmission timeout
       tcpComputeRto(socket);
 
@@ -597,10 +605,8 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
          socket->mss = max(socket->mss, TCP_MIN_MSS);
       }
 
-      //Initial congestion window
-      socket->cwnd = min(TCP_INITIAL_WINDOW * socket->mss, socket->txBufferSize);
-      //Slow start threshold should be set arbitrarily high
-      socket->ssthresh = UINT16_MAX;
+      //Initialize congestion window and slow start threshold
+      tcpCongestionInit(socket);
 
       //Check whether our SYN has been acknowledged (SND.UNA > ISS)
       if(TCP_CMP_SEQ(socket->sndUna, socket->iss) > 0)
@@ -678,11 +684,11 @@ void tcpStateSynReceived(Socket *socket, TcpHeader *segment,
    }
 
    //Update the send window before entering ESTABLISHED state (see RFC 1122 4.2.2.20)
-   socket->sndWnd = segment->window;
+   socket->sndWnd = tcpGetSendWindow(socket, segment);
    socket->sndWl1 = segment->seqNum;
    socket->sndWl2 = segment->ackNum;
    //Maximum send window it has seen so far on the connection
-   socket->maxSndWnd = segment->window;
+   socket->maxSndWnd = socket->sndWnd;
 
    //Enter ESTABLISHED state
    tcpChangeState(socket, TCP_STATE_ESTABLISHED);
@@ -888,7 +894,7 @@ void tcpStateFinWait1(Socket *socket, TcpHeader *segment,
    {
       //Start the FIN-WAIT-2 timer to prevent the connection
       //from staying in the FIN-WAIT-2 state forever
-      osTimerStart(&socket->finWait2Timer, TCP_FIN_WAIT_2_TIMER);
+      tcpTimerStart(socket, &socket->finWait2Timer, TCP_FIN_WAIT_2_TIMER);
       //enter FIN-WAIT-2 and continue processing in that state
       tcpChangeState(socket, TCP_STATE_FIN_WAIT_2);
    }
@@ -912,7 +918,7 @@ void tcpStateFinWait1(Socket *socket, TcpHeader *segment,
          if(segment->ackNum == socket->sndNxt)
          {
             //Start the 2MSL timer
-            osTimerStart(&socket->timeWaitTimer , TCP_2MSL_TIMER);
+            tcpTimerStart(socket, &socket->timeWaitTimer, TCP_2MSL_TIMER);
             //Switch to the TIME-WAIT state
             tcpChangeState(socket, TCP_STATE_TIME_WAIT);
          }
@@ -980,7 +986,7 @@ void tcpStateFinWait2(Socket *socket, TcpHeader *segment,
          //Send an acknowledgement for the FIN
          tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
          //Start the 2MSL timer
-         osTimerStart(&socket->timeWaitTimer , TCP_2MSL_TIMER);
+         tcpTimerStart(socket, &socket->timeWaitTimer, TCP_2MSL_TIMER);
          //Switch to the TIME_WAIT state
          tcpChangeState(socket, TCP_STATE_TIME_WAIT);
       }
@@ -1029,7 +1035,7 @@ void tcpStateClosing(Socket *socket, TcpHeader *segment, size_t length)
    if(segment->ackNum == socket->sndNxt)
    {
       //Start the 2MSL timer
-      osTimerStart(&socket->timeWaitTimer , TCP_2MSL_TIMER);
+      tcpTimerStart(socket, &socket->timeWaitTimer, TCP_2MSL_TIMER);
       //Switch to the TIME-WAIT state
       tcpChangeState(socket, TCP_STATE_TIME_WAIT);
    }
@@ -1069,6 +1075,8 @@ void tcpStateTimeWait(Socket *socket, TcpHeader *segment, size_t length)
       {
          //Delete the TCB
          tcpDeleteControlBlock(socket);
+         //Remove the socket from the lookup tables
+         socketHashRemove(socket);
          //Mark the socket as closed
          socket->type = SOCKET_TYPE_UNUSED;
       }
@@ -1091,7 +1099,7 @@ void tcpStateTimeWait(Socket *socket, TcpHeader *segment, size_t length)
       //Send an acknowledgement for the FIN
       tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
       //Restart the 2MSL timer
-      osTimerStart(&socket->timeWaitTimer , TCP_2MSL_TIMER);
+      tcpTimerStart(socket, &socket->timeWaitTimer, TCP_2MSL_TIMER);
    }
 }
 
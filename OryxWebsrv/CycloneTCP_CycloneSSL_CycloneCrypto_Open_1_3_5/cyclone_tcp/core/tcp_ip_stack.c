@@ -32,7 +32,6 @@
 //Dependencies
 #include "tcp_ip_stack.h"
 #include "socket.h"
-#include "tcp_timer.h"
 #include "ethernet.h"
 #include "arp.h"
 #include "ipv4.h"
@@ -72,6 +71,16 @@ error_t tcpIpStackInit(void)
       sprintf(netInterface[i].name, "eth%u", i);
    }
 
+#if (NET_STATS_SUPPORT == ENABLED)
+   //Performance monitoring initialization
+   netStatsInit();
+#endif
+
+   //Timer wheel initialization
+   error = netTimerInit();
+   //Any error to report?
+   if(error) return error;
+
    //Socket related initialization
    error = socketInit();
    //Any error to report?
@@ -111,6 +120,27 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
    //Disable Ethernet controller interrupts
    interface->nicDriver->disableIrq(interface);
 
+   //Register the timers of the interface with the timer wheel
+   netTimerSetup(&interface->nicTimer, tcpIpStackNicTimer, interface);
+#if (IPV4_SUPPORT == ENABLED)
+   netTimerSetup(&interface->arpTimer, tcpIpStackArpTimer, interface);
+#endif
+#if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
+   netTimerSetup(&interface->ipv4FragTimer, tcpIpStackIpv4FragTimer, interface);
+#endif
+#if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
+   netTimerSetup(&interface->igmpTimer, tcpIpStackIgmpTimer, interface);
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   netTimerSetup(&interface->ndpTimer, tcpIpStackNdpTimer, interface);
+#endif
+#if (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
+   netTimerSetup(&interface->ipv6FragTimer, tcpIpStackIpv6FragTimer, interface);
+#endif
+#if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
+   netTimerSetup(&interface->mldTimer, tcpIpStackMldTimer, interface);
+#endif
+
    //Start of exception handling block
    do
    {
@@ -217,6 +247,15 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
       interface->configured = TRUE;
       //Interrupts can be safely enabled
       interface->nicDriver->enableIrq(interface);
+
+      //Start periodic timers
+      netTimerSchedule(&interface->nicTimer, NIC_TICK_INTERVAL);
+#if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
+      netTimerSchedule(&interface->igmpTimer, IGMP_TICK_INTERVAL);
+#endif
+#if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
+      netTimerSchedule(&interface->mldTimer, MLD_TICK_INTERVAL);
+#endif
    }
    else
    {
@@ -232,196 +271,139 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
 
 /**
  * @brief Task responsible for handling periodic operations
+ *
+ * The task sleeps until the next deadline registered with the timer
+ * wheel, so that no processing occurs while the stack is idle
+ *
  **/
 
 void tcpIpStackTickTask(void *param)
 {
-   uint_t i;
-
-   //Initialize prescalers
-   uint_t nicTickPrescaler = 0;
-#if (IPV4_SUPPORT == ENABLED)
-   uint_t arpTickPrescaler = 0;
-#endif
-#if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
-   uint_t ipv4FragTickPrescaler = 0;
-#endif
-#if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
-   uint_t igmpTickPrescaler = 0;
-#endif
-#if (IPV6_SUPPORT == ENABLED)
-   uint_t ndpTickPrescaler = 0;
-#endif
-#if (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
-   uint_t ipv6FragTickPrescaler = 0;
-#endif
-#if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
-   uint_t mldTickPrescaler = 0;
-#endif
-#if (TCP_SUPPORT == ENABLED)
-   uint_t tcpTickPrescaler = 0;
-#endif
+   time_t delay;
 
    //Main loop
    while(1)
    {
-      //Wait for the TCP/IP stack tick interval
-      osDelay(TCP_IP_TICK_INTERVAL);
+      //Invoke the handlers whose deadline has been reached
+      delay = netTimerProcess();
+      //Sleep until the next deadline
+      netTimerWait(delay);
+   }
+}
 
-      //Update prescaler
-      nicTickPrescaler += TCP_IP_TICK_INTERVAL;
 
-      //Handle periodic operations such as polling the link state
-      if(nicTickPrescaler >= NIC_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               nicTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         nicTickPrescaler = 0;
-      }
+/**
+ * @brief NIC timer handler
+ * @param[in] param Underlying network interface
+ **/
+
+void tcpIpStackNicTimer(void *param)
+{
+   //Point to the structure describing the network interface
+   NetInterface *interface = (NetInterface *) param;
+
+   //Handle periodic operations such as polling the link state
+   nicTick(interface);
+   //Restart timer
+   netTimerSchedule(&interface->nicTimer, NIC_TICK_INTERVAL);
+}
+
 
 #if (IPV4_SUPPORT == ENABLED)
-      //Update prescaler
-      arpTickPrescaler += TCP_IP_TICK_INTERVAL;
 
-      //Manage ARP cache
-      if(arpTickPrescaler >= ARP_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               arpTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         arpTickPrescaler = 0;
-      }
-#endif
+/**
+ * @brief ARP timer handler
+ * @param[in] param Underlying network interface
+ **/
 
-#if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
-      //Update prescaler
-      ipv4FragTickPrescaler += TCP_IP_TICK_INTERVAL;
+void tcpIpStackArpTimer(void *param)
+{
+   //Manage ARP cache
+   arpTick((NetInterface *) param);
+}
 
-      //Handle IPv4 fragment reassembly timeout
-      if(ipv4FragTickPrescaler >= IPV4_FRAG_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               ipv4FragTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         ipv4FragTickPrescaler = 0;
-      }
 #endif
+#if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
 
-#if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
-      //Update prescaler
-      igmpTickPrescaler += TCP_IP_TICK_INTERVAL;
+/**
+ * @brief IPv4 fragment reassembly timer handler
+ * @param[in] param Underlying network interface
+ **/
+
+void tcpIpStackIpv4FragTimer(void *param)
+{
+   //Handle IPv4 fragment reassembly timeout
+   ipv4FragTick((NetInterface *) param);
+}
 
-      //Handle IGMP related timers
-      if(igmpTickPrescaler >= IGMP_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               igmpTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         igmpTickPrescaler = 0;
-      }
 #endif
+#if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
 
-#if (IPV6_SUPPORT == ENABLED)
-      //Update prescaler
-      ndpTickPrescaler += TCP_IP_TICK_INTERVAL;
+/**
+ * @brief IGMP timer handler
+ * @param[in] param Underlying network interface
+ **/
 
-      //Manage Neighbor cache
-      if(ndpTickPrescaler >= NDP_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               ndpTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         ndpTickPrescaler = 0;
-      }
-#endif
+void tcpIpStackIgmpTimer(void *param)
+{
+   //Point to the structure describing the network interface
+   NetInterface *interface = (NetInterface *) param;
 
-#if (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
-      //Update prescaler
-      ipv6FragTickPrescaler += TCP_IP_TICK_INTERVAL;
+   //Handle IGMP related timers
+   igmpTick(interface);
+   //Restart timer
+   netTimerSchedule(&interface->igmpTimer, IGMP_TICK_INTERVAL);
+}
 
-      //Handle IPv4 fragment reassembly timeout
-      if(ipv6FragTickPrescaler >= IPV6_FRAG_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               ipv6FragTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         ipv6FragTickPrescaler = 0;
-      }
 #endif
+#if (IPV6_SUPPORT == ENABLED)
 
-#if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
-      //Update prescaler
-      mldTickPrescaler += TCP_IP_TICK_INTERVAL;
+/**
+ * @brief Neighbor Discovery timer handler
+ * @param[in] param Underlying network interface
+ **/
+
+void tcpIpStackNdpTimer(void *param)
+{
+   //Manage Neighbor cache
+   ndpTick((NetInterface *) param);
+}
 
-      //Handle MLD related timers
-      if(mldTickPrescaler >= MLD_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               mldTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         mldTickPrescaler = 0;
-      }
 #endif
+#if (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
 
-#if (TCP_SUPPORT == ENABLED)
-      //Update TCP tick prescaler
-      tcpTickPrescaler += TCP_IP_TICK_INTERVAL;
+/**
+ * @brief IPv6 fragment reassembly timer handler
+ * @param[in] param Underlying network interface
+ **/
+
+void tcpIpStackIpv6FragTimer(void *param)
+{
+   //Handle IPv6 fragment reassembly timeout
+   ipv6FragTick((NetInterface *) param);
+}
 
-      //Manage TCP related timers
-      if(tcpTickPrescaler >= TCP_TICK_INTERVAL)
-      {
-         //TCP timer handler
-         tcpTick();
-         //Clear prescaler
-         tcpTickPrescaler = 0;
-      }
 #endif
-   }
+#if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
+
+/**
+ * @brief MLD timer handler
+ * @param[in] param Underlying network interface
+ **/
+
+void tcpIpStackMldTimer(void *param)
+{
+   //Point to the structure describing the network interface
+   NetInterface *interface = (NetInterface *) param;
+
+   //Handle MLD related timers
+   mldTick(interface);
+   //Restart timer
+   netTimerSchedule(&interface->mldTimer, MLD_TICK_INTERVAL);
 }
 
+#endif
+
 
 /**
  * @brief Task in charge of processing incoming frames
@@ -43,6 +43,8 @@ typedef struct _NetInterface NetInterface;
 #include "os.h"
 #include "endian.h"
 #include "error.h"
+#include "net_timer.h"
+#include "net_stats.h"
 #include "nic.h"
 #include "ethernet.h"
 #include "ipv4.h"
@@ -74,13 +76,6 @@ typedef struct _NetInterface NetInterface;
    #error TCP_IP_TICK_PRIORITY parameter is invalid
 #endif
 
-//TCP/IP stack tick interval
-#ifndef TCP_IP_TICK_INTERVAL
-   #define TCP_IP_TICK_INTERVAL 100
-#elif (TCP_IP_TICK_INTERVAL < 100)
-   #error TCP_IP_TICK_INTERVAL parameter is invalid
-#endif
-
 //Stack size required to run the TCP/IP RX task
 #ifndef TCP_IP_RX_STACK_SIZE
    #define TCP_IP_RX_STACK_SIZE 550
@@ -124,6 +119,11 @@ typedef struct _NetInterface
    bool_t speed100;                                     ///<Link speed
    bool_t fullDuplex;                                   ///<Duplex mode
    bool_t configured;                                   ///<Configuration done
+   NetTimer nicTimer;                                   ///<NIC periodic timer
+   NetInterfaceStats stats;                             ///<Interface statistics
+#if (NET_STATS_SUPPORT == ENABLED)
+   uint32_t rxTimestamp;                                ///<Time at which the current frame was passed to the stack
+#endif
 
 #if (IPV4_SUPPORT == ENABLED)
    Ipv4Config ipv4Config;                               ///<IPv4 configuration
@@ -131,15 +131,28 @@ typedef struct _NetInterface
 #if (IPV4_FRAG_SUPPORT == ENABLED)
    OsMutex *ipv4FragQueueMutex;                         ///<Mutex preventing simultaneous access to reassembly queue
    Ipv4FragDesc ipv4FragQueue[IPV4_MAX_FRAG_DATAGRAMS]; ///<IPv4 fragment reassembly queue
+   Ipv4FragDesc *ipv4FragHashTable[IPV4_FRAG_HASH_TABLE_SIZE]; ///<Hash table used to index the reassembly queue
+   Ipv4FragDesc *ipv4FragAgeHead;                       ///<Oldest datagram being reassembled
+   Ipv4FragDesc *ipv4FragAgeTail;                       ///<Newest datagram being reassembled
+   size_t ipv4FragMemUsage;                             ///<Memory used by the reassembly queue
+   Ipv4FragStats ipv4FragStats;                         ///<IPv4 reassembly statistics
+   NetTimer ipv4FragTimer;                              ///<IPv4 fragment reassembly timer
 #endif
    OsMutex *arpCacheMutex;                              ///<Mutex preventing simultaneous access to ARP cache
    ArpCacheEntry arpCache[ARP_CACHE_SIZE];              ///<ARP cache
+   ArpCacheEntry *arpHashTable[ARP_HASH_TABLE_SIZE];    ///<Hash table used to index the ARP cache
+   ArpCacheEntry *arpLruHead;                           ///<Most recently used ARP entry
+   ArpCacheEntry *arpLruTail;                           ///<Least recently used ARP entry
+   ArpCacheEntry *arpLastEntry;                         ///<Last destination looked up
+   ArpStats arpStats;                                   ///<ARP cache statistics
+   NetTimer arpTimer;                                   ///<ARP cache timer
    OsMutex *ipv4FilterMutex;                            ///<Mutex preventing simultaneous access to the IPv4 filter table
    Ipv4FilterEntry ipv4Filter[IPV4_FILTER_MAX_SIZE];    ///<IPv4 filter table
    uint_t ipv4FilterSize;                               ///<Number of entries in the IPv4 filter table
 #if (IGMP_SUPPORT == ENABLED)
    time_t igmpv1RouterPresentTimer;                     ///<IGMPv1 router present timer
    bool_t igmpv1RouterPresent;                          ///<An IGMPv1 query has been recently heard
+   NetTimer igmpTimer;                                  ///<IGMP periodic timer
 #endif
 #endif
 
@@ -149,12 +162,27 @@ typedef struct _NetInterface
    uint32_t ipv6Identification;                         ///<IPv6 Fragment identification field
    OsMutex *ipv6FragQueueMutex;                         ///<Mutex preventing simultaneous access to reassembly queue
    Ipv6FragDesc ipv6FragQueue[IPV6_MAX_FRAG_DATAGRAMS]; ///<IPv6 fragment reassembly queue
+   Ipv6FragDesc *ipv6FragHashTable[IPV6_FRAG_HASH_TABLE_SIZE]; ///<Hash table used to index the reassembly queue
+   Ipv6FragDesc *ipv6FragAgeHead;                       ///<Oldest datagram being reassembled
+   Ipv6FragDesc *ipv6FragAgeTail;                       ///<Newest datagram being reassembled
+   size_t ipv6FragMemUsage;                             ///<Memory used by the reassembly queue
+   Ipv6FragStats ipv6FragStats;                         ///<IPv6 reassembly statistics
+   NetTimer ipv6FragTimer;                              ///<IPv6 fragment reassembly timer
 #endif
    OsMutex *ndpCacheMutex;                              ///<Mutex preventing simultaneous access to Neighbor cache
    NdpCacheEntry ndpCache[NDP_CACHE_SIZE];              ///<Neighbor cache
+   NdpCacheEntry *ndpHashTable[NDP_HASH_TABLE_SIZE];    ///<Hash table used to index the Neighbor cache
+   NdpCacheEntry *ndpLruHead;                           ///<Most recently used Neighbor cache entry
+   NdpCacheEntry *ndpLruTail;                           ///<Least recently used Neighbor cache entry
+   NdpCacheEntry *ndpLastEntry;                         ///<Last destination looked up
+   NdpStats ndpStats;                                   ///<Neighbor cache statistics
+   NetTimer ndpTimer;                                   ///<Neighbor cache timer
    OsMutex *ipv6FilterMutex;                            ///<Mutex preventing simultaneous access to the IPv6 filter table
    Ipv6FilterEntry ipv6Filter[IPV6_FILTER_MAX_SIZE];    ///<IPv6 filter table
    uint_t ipv6FilterSize;                               ///<Number of entries in the IPv6 filter table
+#if (MLD_SUPPORT == ENABLED)
+   NetTimer mldTimer;                                   ///<MLD periodic timer
+#endif
 #endif
 } NetInterface;
 
@@ -169,6 +197,14 @@ error_t tcpIpStackConfigInterface(NetInterface *interface);
 void tcpIpStackTickTask(void *param);
 void tcpIpStackRxTask(void *param);
 
+void tcpIpStackNicTimer(void *param);
+void tcpIpStackArpTimer(void *param);
+void tcpIpStackIpv4FragTimer(void *param);
+void tcpIpStackIgmpTimer(void *param);
+void tcpIpStackNdpTimer(void *param);
+void tcpIpStackIpv6FragTimer(void *param);
+void tcpIpStackMldTimer(void *param);
+
 NetInterface *tcpIpStackGetDefaultInterface(void);
 
 #endif
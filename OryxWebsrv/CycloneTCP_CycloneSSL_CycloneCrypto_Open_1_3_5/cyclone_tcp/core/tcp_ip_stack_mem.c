@@ -36,18 +36,113 @@
 
 //Maximum number of chunks for dynamically allocated buffers
 #if (IPV4_SUPPORT == ENABLED && IPV6_SUPPORT == ENABLED)
-   #define MAX_CHUNK_COUNT (N(max(IPV4_MAX_FRAG_DATAGRAM_SIZE, IPV6_MAX_FRAG_DATAGRAM_SIZE)) + 3)
+   #define MAX_CHUNK_COUNT (max(max(N(IPV4_MAX_FRAG_DATAGRAM_SIZE), IPV4_MAX_FRAG_COUNT), \
+      max(N(IPV6_MAX_FRAG_DATAGRAM_SIZE), IPV6_MAX_FRAG_COUNT)) + 3)
 #elif (IPV4_SUPPORT == ENABLED)
-   #define MAX_CHUNK_COUNT (N(IPV4_MAX_FRAG_DATAGRAM_SIZE) + 3)
+   #define MAX_CHUNK_COUNT (max(N(IPV4_MAX_FRAG_DATAGRAM_SIZE), IPV4_MAX_FRAG_COUNT) + 3)
 #elif (IPV6_SUPPORT == ENABLED)
-   #define MAX_CHUNK_COUNT (N(IPV6_MAX_FRAG_DATAGRAM_SIZE) + 3)
+   #define MAX_CHUNK_COUNT (max(N(IPV6_MAX_FRAG_DATAGRAM_SIZE), IPV6_MAX_FRAG_COUNT) + 3)
 #endif
 
+//Size of the header that precedes the first chunk of a multi-part buffer
+#define CHUNKED_BUFFER_HEADER_SIZE (sizeof(ChunkedBuffer) + MAX_CHUNK_COUNT * sizeof(ChunkDesc))
+
 //Use fixed-size blocks allocation?
 #if (MEM_POOL_SUPPORT == ENABLED)
 
-static uint8_t memPool[MEM_POOL_BUFFER_COUNT][MEM_POOL_BUFFER_SIZE];
-static bool_t memPoolAllocTable[MEM_POOL_BUFFER_COUNT];
+//Blocks are stored as arrays of 64-bit words to guarantee proper alignment
+#define MEM_POOL_WORDS(size) (((size) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+//Number of size classes
+#if (MEM_POOL_SMALL_BUFFER_COUNT > 0)
+   #define MEM_POOL_CLASS_COUNT 2
+#else
+   #define MEM_POOL_CLASS_COUNT 1
+#endif
+
+
+/**
+ * @brief Free block (the link is stored in the block itself)
+ **/
+
+typedef struct _MemPoolBlock
+{
+   struct _MemPoolBlock *next;
+} MemPoolBlock;
+
+
+/**
+ * @brief Pool of fixed-size blocks
+ **/
+
+typedef struct
+{
+   uint8_t *base;          ///<Address of the first block
+   uint8_t *allocTable;    ///<Allocation flag of each block
+   MemPoolBlock *freeList; ///<List of free blocks
+   MemPoolStats stats;     ///<Statistics
+} MemPool;
+
+#if (MEM_POOL_SMALL_BUFFER_COUNT > 0)
+static uint64_t memPoolSmall[MEM_POOL_SMALL_BUFFER_COUNT][MEM_POOL_WORDS(MEM_POOL_SMALL_BUFFER_SIZE)];
+static uint8_t memPoolSmallAllocTable[MEM_POOL_SMALL_BUFFER_COUNT];
+#endif
+
+static uint64_t memPoolLarge[MEM_POOL_BUFFER_COUNT][MEM_POOL_WORDS(MEM_POOL_BUFFER_SIZE)];
+static uint8_t memPoolLargeAllocTable[MEM_POOL_BUFFER_COUNT];
+
+//Size classes, sorted by increasing block size
+static MemPool memPoolTable[MEM_POOL_CLASS_COUNT];
+
+#else
+
+//Heap usage statistics
+static MemPoolStats memPoolStats;
+
+#endif
+
+
+//Use fixed-size blocks allocation?
+#if (MEM_POOL_SUPPORT == ENABLED)
+
+/**
+ * @brief Initialize a pool of fixed-size blocks
+ * @param[in] pool Pointer to the pool descriptor
+ * @param[in] base Address of the first block
+ * @param[in] allocTable Allocation table
+ * @param[in] blockSize Size of the blocks
+ * @param[in] blockCount Number of blocks
+ **/
+
+static void memPoolCreate(MemPool *pool, void *base,
+   uint8_t *allocTable, size_t blockSize, uint_t blockCount)
+{
+   uint_t i;
+   MemPoolBlock *block;
+
+   //Save parameters
+   pool->base = base;
+   pool->allocTable = allocTable;
+
+   //Clear statistics
+   memset(&pool->stats, 0, sizeof(MemPoolStats));
+   pool->stats.blockSize = blockSize;
+   pool->stats.blockCount = blockCount;
+
+   //Clear allocation table
+   memset(allocTable, 0, blockCount);
+
+   //Chain all the blocks together
+   pool->freeList = NULL;
+
+   //Build the list in reverse order so that the first block is used first
+   for(i = blockCount; i > 0; i--)
+   {
+      block = (MemPoolBlock *) (pool->base + (i - 1) * blockSize);
+      block->next = pool->freeList;
+      pool->freeList = block;
+   }
+}
 
 #endif
 
@@ -60,8 +155,20 @@ void memPoolInit(void)
 {
 //Use fixed-size blocks allocation?
 #if (MEM_POOL_SUPPORT == ENABLED)
-   //Clear allocation table
-   memset(memPoolAllocTable, 0, sizeof(memPoolAllocTable));
+   uint_t i = 0;
+
+#if (MEM_POOL_SMALL_BUFFER_COUNT > 0)
+   //Small blocks are suitable for ACKs, ARP packets and queue items
+   memPoolCreate(&memPoolTable[i++], memPoolSmall, memPoolSmallAllocTable,
+      sizeof(memPoolSmall[0]), MEM_POOL_SMALL_BUFFER_COUNT);
+#endif
+
+   //Large blocks can hold a full Ethernet frame
+   memPoolCreate(&memPoolTable[i++], memPoolLarge, memPoolLargeAllocTable,
+      sizeof(memPoolLarge[0]), MEM_POOL_BUFFER_COUNT);
+#else
+   //Clear statistics
+   memset(&memPoolStats, 0, sizeof(MemPoolStats));
 #endif
 }
 
@@ -76,6 +183,9 @@ void *memPoolAlloc(size_t size)
 {
 #if (MEM_POOL_SUPPORT == ENABLED)
    uint_t i;
+   MemPool *pool;
+   MemPool *first;
+   MemPoolBlock *block;
 #endif
 
    //Pointer to the allocated memory block
@@ -89,30 +199,75 @@ void *memPoolAlloc(size_t size)
    //Enter critical section
    osTaskSuspendAll();
 
-   //Enforce block size
-   if(size <= MEM_POOL_BUFFER_SIZE)
+   //Smallest size class that can satisfy the request
+   first = NULL;
+
+   //Select the smallest size class that can satisfy the request. If that
+   //class is exhausted, spill over to the next larger one
+   for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
    {
-      //Loop through allocation table
-      for(i = 0; i < MEM_POOL_BUFFER_COUNT; i++)
+      //Point to the current size class
+      pool = &memPoolTable[i];
+
+      //Enforce block size
+      if(size <= pool->stats.blockSize)
       {
-         //Check whether the current block is free
-         if(!memPoolAllocTable[i])
+         //The request is accounted to the smallest suitable class
+         if(!first)
+            first = pool;
+
+         //Any free block available?
+         if(pool->freeList)
          {
-            //Mark the current entry as used
-            memPoolAllocTable[i] = TRUE;
-            //Point to the corresponding memory block
-            p = memPool[i];
+            //Remove the first block from the free list
+            block = pool->freeList;
+            pool->freeList = block->next;
+
+            //Mark the corresponding entry as used
+            pool->allocTable[((uint8_t *) block - pool->base) / pool->stats.blockSize] = TRUE;
+
+            //Update statistics
+            pool->stats.usedCount++;
+            pool->stats.highWaterMark = max(pool->stats.highWaterMark, pool->stats.usedCount);
+
+            //Point to the allocated memory block
+            p = block;
             //Exit immediately
             break;
          }
       }
    }
 
+   //Requests larger than any block are accounted to the largest class
+   if(!first)
+      first = &memPoolTable[MEM_POOL_CLASS_COUNT - 1];
+
+   //Update statistics
+   if(!p)
+      first->stats.failCount++;
+   else if(pool != first)
+      first->stats.spillCount++;
+
    //Leave critical section
    osTaskResumeAll();
 #else
    //Allocate a memory block
    p = osMemAlloc(size);
+
+   //Update statistics
+   osTaskSuspendAll();
+
+   if(p)
+   {
+      memPoolStats.usedCount++;
+      memPoolStats.highWaterMark = max(memPoolStats.highWaterMark, memPoolStats.usedCount);
+   }
+   else
+   {
+      memPoolStats.failCount++;
+   }
+
+   osTaskResumeAll();
 #endif
 
    //Failed to allocate memory?
@@ -137,19 +292,44 @@ void memPoolFree(void *p)
 //Use fixed-size blocks allocation?
 #if (MEM_POOL_SUPPORT == ENABLED)
    uint_t i;
+   size_t offset;
+   size_t index;
+   MemPool *pool;
+   MemPoolBlock *block;
 
    //Enter critical section
    osTaskSuspendAll();
 
-   //Loop through allocation table
-   for(i = 0; i < MEM_POOL_BUFFER_COUNT; i++)
+   //Find out which size class the block belongs to
+   for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
    {
-      if(memPool[i] == p)
+      //Point to the current size class
+      pool = &memPoolTable[i];
+
+      //Check whether the address lies within the pool
+      if((uint8_t *) p >= pool->base)
       {
-         //Mark the current block as free
-         memPoolAllocTable[i] = FALSE;
-         //Exit immediately
-         break;
+         //Retrieve the index of the block
+         offset = (uint8_t *) p - pool->base;
+         index = offset / pool->stats.blockSize;
+
+         //Make sure the pointer refers to the start of an allocated block
+         if(index < pool->stats.blockCount &&
+            (offset % pool->stats.blockSize) == 0 && pool->allocTable[index])
+         {
+            //Mark the current block as free
+            pool->allocTable[index] = FALSE;
+
+            //Insert the block at the head of the free list
+            block = p;
+            block->next = pool->freeList;
+            pool->freeList = block;
+
+            //Update statistics
+            pool->stats.usedCount--;
+            //Exit immediately
+            break;
+         }
       }
    }
 
@@ -158,10 +338,54 @@ void memPoolFree(void *p)
 #else
    //Release memory block
    osMemFree(p);
+
+   //Update statistics
+   if(p)
+   {
+      osTaskSuspendAll();
+      memPoolStats.usedCount--;
+      osTaskResumeAll();
+   }
 #endif
 }
 
 
+/**
+ * @brief Retrieve memory pool statistics
+ * @param[in] index Zero-based index of the size class, from the
+ *   smallest blocks to the largest ones
+ * @param[out] stats Statistics of the specified size class
+ * @return Error code
+ **/
+
+error_t memPoolGetStats(uint_t index, MemPoolStats *stats)
+{
+//Use fixed-size blocks allocation?
+#if (MEM_POOL_SUPPORT == ENABLED)
+   //Make sure the size class exists
+   if(index >= MEM_POOL_CLASS_COUNT)
+      return ERROR_INVALID_PARAMETER;
+
+   //Take a consistent snapshot of the statistics
+   osTaskSuspendAll();
+   *stats = memPoolTable[index].stats;
+   osTaskResumeAll();
+#else
+   //The heap is reported as a single size class
+   if(index > 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //Take a consistent snapshot of the statistics
+   osTaskSuspendAll();
+   *stats = memPoolStats;
+   osTaskResumeAll();
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Allocate a multi-part buffer
  * @param[in] length Desired length
@@ -172,19 +396,29 @@ void memPoolFree(void *p)
 ChunkedBuffer *chunkedBufferAlloc(size_t length)
 {
    error_t error;
+   size_t size;
    ChunkedBuffer *buffer;
 
+#if (MEM_POOL_SMALL_BUFFER_COUNT > 0)
+   //Small packets (ACKs, ARP requests...) do not need a full-size block
+   if((CHUNKED_BUFFER_HEADER_SIZE + length) <= MEM_POOL_SMALL_BUFFER_SIZE)
+      size = MEM_POOL_SMALL_BUFFER_SIZE;
+   else
+#endif
+      size = MEM_POOL_BUFFER_SIZE;
+
    //Allocate memory to hold the multi-part buffer
-   buffer = memPoolAlloc(MEM_POOL_BUFFER_SIZE);
+   buffer = memPoolAlloc(size);
    //Failed to allocate memory?
    if(!buffer) return NULL;
 
    //The multi-part buffer consists of a single chunk
    buffer->chunkCount = 1;
    buffer->maxChunkCount = MAX_CHUNK_COUNT;
-   buffer->chunk[0].address = (uint8_t *) buffer + MAX_CHUNK_COUNT * sizeof(ChunkDesc);
-   buffer->chunk[0].length = MEM_POOL_BUFFER_SIZE - MAX_CHUNK_COUNT * sizeof(ChunkDesc);
+   buffer->chunk[0].address = (uint8_t *) buffer + CHUNKED_BUFFER_HEADER_SIZE;
+   buffer->chunk[0].length = size - CHUNKED_BUFFER_HEADER_SIZE;
    buffer->chunk[0].size = 0;
+   buffer->chunk[0].flags = 0;
 
    //Adjust the length of the buffer
    error = chunkedBufferSetLength(buffer, length);
@@ -294,6 +528,7 @@ error_t chunkedBufferSetLength(ChunkedBuffer *buffer, size_t length)
          chunk->address = NULL;
          chunk->length = 0;
          chunk->size = 0;
+         chunk->flags = 0;
 
          //Next chunk
          i++;
@@ -315,6 +550,7 @@ error_t chunkedBufferSetLength(ChunkedBuffer *buffer, size_t length)
 
          //Allocated memory
          chunk->size = MEM_POOL_BUFFER_SIZE;
+         chunk->flags = 0;
          //Actual length of the data chunk
          chunk->length = min(length, MEM_POOL_BUFFER_SIZE);
 
@@ -397,6 +633,8 @@ error_t chunkedBufferConcat(ChunkedBuffer *dest,
       dest->chunk[i].address = (uint8_t *) src->chunk[j].address + srcOffset;
       dest->chunk[i].length = src->chunk[j].length - srcOffset;
       dest->chunk[i].size = 0;
+      //The referenced data has the same lifetime as the source chunk
+      dest->chunk[i].flags = src->chunk[j].flags;
 
       //Limit the number of bytes to copy
       if(length < dest->chunk[i].length)
@@ -525,6 +763,7 @@ error_t chunkedBufferAppend(ChunkedBuffer *dest, const void *src, size_t length)
    dest->chunk[i].address = (void *) src;
    dest->chunk[i].length = length;
    dest->chunk[i].size = 0;
+   dest->chunk[i].flags = 0;
 
    //Increment the number of chunks
    dest->chunkCount++;
@@ -55,10 +55,34 @@
    #error MEM_POOL_BUFFER_SIZE parameter is invalid
 #endif
 
+//Number of small buffers available
+#ifndef MEM_POOL_SMALL_BUFFER_COUNT
+   #define MEM_POOL_SMALL_BUFFER_COUNT 16
+#elif (MEM_POOL_SMALL_BUFFER_COUNT < 0)
+   #error MEM_POOL_SMALL_BUFFER_COUNT parameter is invalid
+#endif
+
+//Size of the small buffers
+#ifndef MEM_POOL_SMALL_BUFFER_SIZE
+   #define MEM_POOL_SMALL_BUFFER_SIZE 256
+#elif (MEM_POOL_SMALL_BUFFER_SIZE < 64 || MEM_POOL_SMALL_BUFFER_SIZE >= MEM_POOL_BUFFER_SIZE)
+   #error MEM_POOL_SMALL_BUFFER_SIZE parameter is invalid
+#endif
+
 //Miscellaneous macro declarations
 #define N(size) (((size) + MEM_POOL_BUFFER_SIZE - 1) / MEM_POOL_BUFFER_SIZE)
 
 
+/**
+ * @brief Chunk flags
+ **/
+
+typedef enum
+{
+   CHUNK_FLAG_ZERO_COPY = 0x0001 ///<Data remains valid after the buffer is released (no copy required for DMA)
+} ChunkFlags;
+
+
 /**
  * @brief Structure describing a chunk of data
  **/
@@ -68,6 +92,7 @@ typedef struct
    void *address;
    uint16_t length;
    uint16_t size;
+   uint16_t flags;
 } ChunkDesc;
 
 
@@ -91,10 +116,26 @@ typedef struct
 } ChunkedBuffer1;
 
 
+/**
+ * @brief Memory pool statistics
+ **/
+
+typedef struct
+{
+   size_t blockSize;     ///<Size of the blocks (0 when using the heap)
+   uint_t blockCount;    ///<Total number of blocks (0 when using the heap)
+   uint_t usedCount;     ///<Number of blocks currently allocated
+   uint_t highWaterMark; ///<Maximum number of blocks allocated at the same time
+   uint_t spillCount;    ///<Number of requests served by a larger class because this one was exhausted
+   uint_t failCount;     ///<Number of requests for this class that no class could serve
+} MemPoolStats;
+
+
 //Memory management functions
 void memPoolInit(void);
 void *memPoolAlloc(size_t size);
 void memPoolFree(void *p);
+error_t memPoolGetStats(uint_t index, MemPoolStats *stats);
 
 ChunkedBuffer *chunkedBufferAlloc(size_t length);
 void chunkedBufferFree(ChunkedBuffer *buffer);
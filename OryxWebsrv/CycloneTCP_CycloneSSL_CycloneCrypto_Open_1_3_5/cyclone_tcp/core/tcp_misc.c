@@ -36,6 +36,9 @@
 #include "socket.h"
 #include "tcp.h"
 #include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_congestion.h"
+#include "nic.h"
 #include "ip.h"
 #include "ipv4.h"
 #include "debug.h"
@@ -56,7 +59,7 @@
  **/
 
 error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
-   uint32_t ackNum, uint_t length, bool_t addToQueue)
+   uint32_t ackNum, size_t length, bool_t addToQueue)
 {
    error_t error;
    size_t offset;
@@ -66,6 +69,14 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    TcpHeader *segment;
    TcpQueueItem *queueItem;
    IpPseudoHeader pseudoHeader;
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   uint32_t timestamp[2];
+#endif
+#if (TCP_SACK_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t n;
+   TcpSackBlock sackBlock[4];
+#endif
 
    //Maximum segment size
    const uint16_t mss = HTONS(TCP_MAX_MSS);
@@ -87,7 +98,7 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    segment->dataOffset = 5;
    segment->flags = flags;
    segment->reserved2 = 0;
-   segment->window = htons(socket->rcvWnd);
+   segment->window = htons(tcpGetReceiveWindow(socket, flags));
    segment->checksum = 0;
    segment->urgentPointer = 0;
 
@@ -98,10 +109,61 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
       tcpAddOption(segment, TCP_OPTION_MAX_SEGMENT_SIZE, &mss, sizeof(mss));
 
 #if (TCP_SACK_SUPPORT == ENABLED)
-      //Append SACK Permitted option
-      tcpAddOption(segment, TCP_OPTION_SACK_PERMITTED, NULL, 0);
+      //The SYN ACK segment carries the SACK Permitted option only
+      //if it was received in the SYN segment (see RFC 2018 2)
+      if(!(flags & TCP_FLAG_ACK) || socket->sackPermitted)
+         tcpAddOption(segment, TCP_OPTION_SACK_PERMITTED, NULL, 0);
+#endif
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Append Window Scale option
+      if(socket->wndScaleEnabled)
+         tcpAddOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR, &socket->rcvWndShift, 1);
+#endif
+   }
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //Once negotiated, the Timestamps option is sent in every
+   //segment except resets (see RFC 7323 3.2)
+   if(socket->tsEnabled && !(flags & TCP_FLAG_RST))
+   {
+      //TSval field is set to the current value of the timestamp clock
+      timestamp[0] = htonl((uint32_t) osGetTickCount());
+      //TSecr field echoes the most recent timestamp received from the peer
+      timestamp[1] = (flags & TCP_FLAG_ACK) ? htonl(socket->tsRecent) : 0;
+      //Append Timestamps option
+      tcpAddOption(segment, TCP_OPTION_TIMESTAMP, timestamp, sizeof(timestamp));
+   }
+
+   //Remember the last acknowledgment number sent (see RFC 7323 4.3)
+   if(flags & TCP_FLAG_ACK)
+      socket->lastAckSent = ackNum;
 #endif
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //Acknowledgments that do not cover all the data held in the receive
+   //buffer should report the non-contiguous blocks (see RFC 2018 4)
+   if(socket->sackPermitted && socket->sackBlockCount > 0 &&
+      flags == TCP_FLAG_ACK && !addToQueue)
+   {
+      //Number of blocks that fit in the remaining option space
+      n = (TCP_MAX_HEADER_LENGTH - segment->dataOffset * 4 - 4) / sizeof(TcpSackBlock);
+      n = min(n, arraysize(sackBlock));
+      n = min(n, socket->sackBlockCount);
+
+      //The first block must specify the most recently received data,
+      //which is always kept at the head of the list
+      for(i = 0; i < n; i++)
+      {
+         sackBlock[i].leftEdge = htonl(socket->sackBlock[i].leftEdge);
+         sackBlock[i].rightEdge = htonl(socket->sackBlock[i].rightEdge);
+      }
+
+      //Append SACK option
+      if(n > 0)
+         tcpAddOption(segment, TCP_OPTION_SACK, sackBlock, n * sizeof(TcpSackBlock));
    }
+#endif
 
    //Adjust the length of the multi-part buffer
    chunkedBufferSetLength(buffer, offset + segment->dataOffset * 4);
@@ -210,6 +272,8 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
       queueItem->next = NULL;
       queueItem->length = length;
       queueItem->sacked = FALSE;
+      queueItem->lost = FALSE;
+      queueItem->retransmitted = FALSE;
       //Save TCP header
       memcpy(&queueItem->header, segment, segment->dataOffset * 4);
       //Save pseudo header
@@ -226,8 +290,6 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
          socket->rttSeqNum = ntohl(segment->seqNum);
          //Wait for an acknowledgment that covers that sequence number...
          socket->rttBusy = TRUE;
-         //Reset the byte counter
-         socket->n = 0;
       }
 
       //Check whether the RTO timer is already running
@@ -235,11 +297,37 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
       {
          //If the timer is not running, start it running so that
          //it will expire after RTO seconds
-         osTimerStart(&socket->retransmitTimer, socket->rto);
+         tcpTimerStart(socket, &socket->retransmitTimer, socket->rto);
          //Reset retransmission counter
          socket->retransmitCount = 0;
       }
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //The new segment is now outstanding in the network
+      socket->pipe += length;
+#endif
+   }
+
+   //Pure acknowledgment?
+   if(flags == TCP_FLAG_ACK && !length)
+      tcpStats.ackSent++;
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //Any segment carrying the ACK flag acknowledges all the data
+   //received so far
+   if(flags & TCP_FLAG_ACK)
+   {
+      //Deferred acknowledgment carried by data or control flags?
+      if(osTimerRunning(&socket->delayedAckTimer) && flags != TCP_FLAG_ACK)
+         tcpStats.ackPiggybacked++;
+
+      //No need to send a separate ACK anymore
+      socket->rcvUnacked = 0;
+      osTimerStop(&socket->delayedAckTimer);
+      //Remember the window advertised to the peer
+      socket->rcvAdvEdge = ackNum + socket->rcvWnd;
    }
+#endif
 
    //Debug message
    TRACE_DEBUG("%s: Sending TCP segment (%u data bytes)...\r\n",
@@ -426,7 +514,9 @@ error_t tcpAddOption(TcpHeader *segment, uint8_t kind, const void *value, uint8_
    //Write specified option
    option->kind = kind;
    option->length = length;
-   memcpy(option->value, value, length - sizeof(TcpOption));
+   //Options such as SACK Permitted have no value
+   if(length > sizeof(TcpOption))
+      memcpy(option->value, value, length - sizeof(TcpOption));
    //Adjust index value
    i += length;
 
@@ -478,7 +568,7 @@ TcpOption *tcpGetOption(TcpHeader *segment, uint8_t kind)
       if(option->kind == TCP_OPTION_END)
          break;
       //Check option length
-      if((i + 1) >= length || (i + option->length) > length)
+      if((i + 1) >= length || option->length < 2 || (i + option->length) > length)
          break;
 
       //Current option kind match the specified one?
@@ -494,6 +584,88 @@ TcpOption *tcpGetOption(TcpHeader *segment, uint8_t kind)
 }
 
 
+/**
+ * @brief Retrieve the Timestamps option of a TCP segment
+ * @param[in] segment Pointer to the TCP header
+ * @param[out] tsVal Timestamp value (optional parameter)
+ * @param[out] tsEcr Timestamp echo reply (optional parameter)
+ * @return NO_ERROR if a valid Timestamps option is present, ERROR_NOT_FOUND otherwise
+ **/
+
+error_t tcpGetTimestampOption(TcpHeader *segment, uint32_t *tsVal, uint32_t *tsEcr)
+{
+   uint32_t value;
+   TcpOption *option;
+
+   //Search for the Timestamps option
+   option = tcpGetOption(segment, TCP_OPTION_TIMESTAMP);
+   //Malformed or missing option?
+   if(!option || option->length != 10)
+      return ERROR_NOT_FOUND;
+
+   //Retrieve TSval field
+   if(tsVal)
+   {
+      memcpy(&value, option->value, sizeof(uint32_t));
+      *tsVal = ntohl(value);
+   }
+
+   //Retrieve TSecr field
+   if(tsEcr)
+   {
+      memcpy(&value, option->value + 4, sizeof(uint32_t));
+      *tsEcr = ntohl(value);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get the window to be advertised in an outgoing segment
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] flags Value of the control bits of the outgoing segment
+ * @return Value of the window field, in host byte order
+ **/
+
+uint16_t tcpGetReceiveWindow(Socket *socket, uint8_t flags)
+{
+   uint32_t window = socket->rcvWnd;
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+   //The window field of a SYN segment is never scaled (see RFC 7323 2.2)
+   if(socket->wndScaleEnabled && !(flags & TCP_FLAG_SYN))
+      window >>= socket->rcvWndShift;
+#endif
+
+   //The window field is limited to 16 bits
+   return min(window, UINT16_MAX);
+}
+
+
+/**
+ * @brief Get the send window advertised by an incoming segment
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] segment Pointer to the incoming TCP segment (host byte order)
+ * @return Send window, in bytes
+ **/
+
+uint32_t tcpGetSendWindow(Socket *socket, TcpHeader *segment)
+{
+   uint32_t window = segment->window;
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+   //The window field of a SYN segment is never scaled (see RFC 7323 2.2)
+   if(socket->wndScaleEnabled && !(segment->flags & TCP_FLAG_SYN))
+      window <<= socket->sndWndShift;
+#endif
+
+   //Return the send window
+   return window;
+}
+
+
 /**
  * @brief Test the sequence number of an incoming segment
  * @param[in] socket Handle referencing the current socket
@@ -507,6 +679,34 @@ error_t tcpCheckSequenceNumber(Socket *socket, TcpHeader *segment, size_t length
    //Acceptability test for an incoming segment
    bool_t acceptable = FALSE;
 
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   uint32_t tsVal;
+   uint32_t tsEcr;
+   error_t tsError = ERROR_NOT_FOUND;
+
+   //Timestamps option in use?
+   if(socket->tsEnabled)
+   {
+      //Retrieve the Timestamps option from the incoming segment
+      tsError = tcpGetTimestampOption(segment, &tsVal, &tsEcr);
+
+      //Protection against wrapped sequence numbers (see RFC 7323 5.3)
+      if(!tsError && TCP_CMP_SEQ(tsVal, socket->tsRecent) < 0 &&
+         !(segment->flags & TCP_FLAG_RST))
+      {
+         //Debug message
+         TRACE_WARNING("TCP segment rejected by PAWS!\r\n");
+         //Send an acknowledgment in reply and drop the segment
+         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+         //Return status code
+         return ERROR_FAILURE;
+      }
+
+      //Save the echoed timestamp for RTT measurement purpose
+      socket->tsEcr = (!tsError && (segment->flags & TCP_FLAG_ACK)) ? tsEcr : 0;
+   }
+#endif
+
    //Case where both segment length and receive window are zero
    if(!length && !socket->rcvWnd)
    {
@@ -548,6 +748,16 @@ error_t tcpCheckSequenceNumber(Socket *socket, TcpHeader *segment, size_t length
       return ERROR_FAILURE;
    }
 
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //Record the timestamp to be echoed if the segment covers
+   //the last acknowledgment number sent (see RFC 7323 4.3)
+   if(socket->tsEnabled && !tsError && TCP_CMP_SEQ(tsVal, socket->tsRecent) >= 0 &&
+      TCP_CMP_SEQ(segment->seqNum, socket->lastAckSent) <= 0)
+   {
+      socket->tsRecent = tsVal;
+   }
+#endif
+
    //Sequence number is acceptable
    return NO_ERROR;
 }
@@ -592,6 +802,8 @@ error_t tcpCheckSyn(Socket *socket, TcpHeader *segment, size_t length)
 
 error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
 {
+   uint32_t window;
+
    //If the ACK bit is off drop the segment and return
    if(!(segment->flags & TCP_FLAG_ACK))
       return ERROR_FAILURE;
@@ -620,6 +832,9 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
       if(segment->flags & (TCP_FLAG_SYN | TCP_FLAG_FIN))
          length++;
 
+      //Apply the window scale factor to the advertised window
+      window = tcpGetSendWindow(socket, segment);
+
       //An acknowledgment is considered a duplicate when the receiver of the
       //ACK has outstanding data, the incoming acknowledgment carries no data,
       //the SYN and FIN bits are both off, the acknowledgment number is equal
@@ -627,9 +842,18 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
       //advertised window in the incoming acknowledgment equals the advertised
       //window in the last incoming acknowledgment (refer to RFC 5681 section 2)
       if(socket->retransmitQueue && !length && segment->ackNum == socket->sndUna)
+      {
+         //Update statistics
+         socket->stats.dupAcks++;
+         tcpStats.dupAcks++;
+         //Increment duplicate ACK counter
          socket->dupAckCount++;
+      }
       else
+      {
+         //Reset duplicate ACK counter
          socket->dupAckCount = 0;
+      }
 
       //Case where neither the sequence nor the acknowledgment number is increased
       if(segment->seqNum == socket->sndWl1 && segment->ackNum == socket->sndWl2)
@@ -637,15 +861,15 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
          //TCP may ignore a window update with a smaller window than
          //previously offered if neither the sequence number nor the
          //acknowledgment number is increased (see RFC 1122 4.2.2.16)
-         if(segment->window > socket->sndWnd)
+         if(window > socket->sndWnd)
          {
             //Update the send window and record the sequence number and
             //the acknowledgment number used to update SND.WND
-            socket->sndWnd = segment->window;
+            socket->sndWnd = window;
             socket->sndWl1 = segment->seqNum;
             socket->sndWl2 = segment->ackNum;
             //Maximum send window it has seen so far on the connection
-            socket->maxSndWnd = max(socket->maxSndWnd, segment->window);
+            socket->maxSndWnd = max(socket->maxSndWnd, window);
 
             //Reset duplicate ACK counter since the advertised window
             //has changed (refer to RFC 5681 section 2)
@@ -657,21 +881,21 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
          TCP_CMP_SEQ(segment->ackNum, socket->sndWl2) >= 0)
       {
          //The remote host advertises a zero window?
-         if(!segment->window && socket->sndWnd)
+         if(!window && socket->sndWnd)
          {
             //Start the persist timer
             socket->wndProbeCount = 0;
             socket->wndProbeInterval = TCP_DEFAULT_PROBE_INTERVAL;
-            osTimerStart(&socket->persistTimer, socket->wndProbeInterval);
+            tcpTimerStart(socket, &socket->persistTimer, socket->wndProbeInterval);
          }
 
          //Update the send window and record the sequence number and
          //the acknowledgment number used to update SND.WND
-         socket->sndWnd = segment->window;
+         socket->sndWnd = window;
          socket->sndWl1 = segment->seqNum;
          socket->sndWl2 = segment->ackNum;
          //Maximum send window it has seen so far on the connection
-         socket->maxSndWnd = max(socket->maxSndWnd, segment->window);
+         socket->maxSndWnd = max(socket->maxSndWnd, window);
 
          //Reset duplicate ACK counter since the advertised window
          //has changed (refer to RFC 5681 section 2)
@@ -683,29 +907,7 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
       {
          //Compute the number of bytes acknowledged by the incoming ACK
          uint_t n = segment->ackNum - socket->sndUna;
-         //Total number of bytes acknowledged during the whole round-trip
-         socket->n += n;
-
-         //Slow start algorithm is used when cwnd is lower than ssthresh
-         if(socket->cwnd < socket->ssthresh)
-         {
-            //During slow start, TCP increments cwnd by at most SMSS bytes
-            //for each ACK received that cumulatively acknowledges new data
-            socket->cwnd += min(n, socket->mss);
-         }
-         //Congestion avoidance algorithm is used when cwnd exceeds ssthres
-         else
-         {
-            //Congestion window is updated once per RTT
-            if(socket->rttBusy && TCP_CMP_SEQ(segment->ackNum, socket->rttSeqNum) > 0)
-            {
-               //TCP must not increment cwnd by more than SMSS bytes
-               socket->cwnd += min(socket->n, socket->mss);
-            }
-         }
 
-         //Limit the size of the congestion window
-         socket->cwnd = min(socket->cwnd, socket->txBufferSize);
          //Update SND.UNA pointer
          socket->sndUna = segment->ackNum;
 
@@ -715,47 +917,28 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
          //Any segments on the retransmission queue which are thereby
          //entirely acknowledged are removed
          tcpUpdateRetransmitQueue(socket);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+         //Record the data selectively acknowledged by the peer
+         tcpUpdateScoreboard(socket, segment);
+#endif
+
+         //Update the congestion window and complete loss recovery
+         tcpCongestionOnAck(socket, n);
       }
       //The incoming ACK segment does not acknowledge new data?
-      else
+      else if(socket->dupAckCount > 0)
       {
          //Debug message
-         if(socket->dupAckCount > 0)
-         {
-            TRACE_INFO("TCP duplicate ACK #%u\r\n", socket->dupAckCount);
-         }
+         TRACE_INFO("TCP duplicate ACK #%u\r\n", socket->dupAckCount);
 
-         //Check the number of duplicate ACKs that have been received
-         if(socket->dupAckCount == TCP_FAST_RETRANSMIT_THRES)
-         {
-            //Amount of data that has been sent but not yet acknowledged
-            uint_t flightSize = socket->sndNxt - socket->sndUna;
-            //After receiving 3 duplicate ACKs, ssthresh must be adjusted
-            socket->ssthresh = max(flightSize / 2, 2 * socket->mss);
-
-            //Debug message
-            TRACE_INFO("%s: TCP fast retransmit...\r\n", timeFormat(osGetTickCount()));
-
-            //TCP performs a retransmission of what appears to be the missing
-            //segment, without waiting for the retransmission timer to expire
-            tcpRetransmitSegment(socket);
-
-            //cwnd must set to ssthresh plus 3*SMSS. This artificially inflates
-            //the congestion window by the number of segments (three) that have
-            //left the network and which the receiver has buffered
-            socket->cwnd = socket->ssthresh + TCP_FAST_RETRANSMIT_THRES * socket->mss;
-         }
-         else if(socket->dupAckCount > TCP_FAST_RETRANSMIT_THRES)
-         {
-            //For each additional duplicate ACK received (after the third),
-            //cwnd must be incremented by SMSS. This artificially inflates
-            //the congestion window in order to reflect the additional
-            //segment that has left the network
-            socket->cwnd += socket->mss;
-         }
+#if (TCP_SACK_SUPPORT == ENABLED)
+         //Record the data selectively acknowledged by the peer
+         tcpUpdateScoreboard(socket, segment);
+#endif
 
-         //Limit the size of the congestion window
-         socket->cwnd = min(socket->cwnd, socket->txBufferSize);
+         //Fast retransmit and fast recovery
+         tcpCongestionOnDupAck(socket);
       }
 
       //Update TX events
@@ -783,6 +966,8 @@ void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
    uint32_t leftEdge = segment->seqNum;
    //Sequence number immediately following the incoming segment
    uint32_t rightEdge = segment->seqNum + length;
+   //Out-of-order data is waiting to be merged with the incoming segment
+   bool_t gap = (socket->sackBlockCount > 0);
 
    //Ignore the data that falls outside the receive window
    if(TCP_CMP_SEQ(leftEdge, socket->rcvNxt) < 0)
@@ -812,8 +997,41 @@ void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
       socket->rcvUser += rightEdge - leftEdge;
       //Update the receive window
       socket->rcvWnd -= rightEdge - leftEdge;
-      //Acknowledge the received data (delayed ACK not supported)
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+      //Amount of data that has not been acknowledged yet
+      socket->rcvUnacked += rightEdge - leftEdge;
+
+      //An ACK should be generated for at least every second full-sized
+      //segment, and immediately when a segment fills in a gap in the
+      //sequence space (refer to RFC 1122 4.2.3.2 and RFC 5681 4.2). An
+      //ACK that would only advertise a closed window is left to the
+      //window update sent once the application consumes the data
+      if((socket->rcvUnacked >= (2 * socket->mss) && socket->rcvWnd >= socket->mss) || gap)
+      {
+         //Acknowledge the received data
+         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+      }
+      //The sender is limited by a small window that can now be enlarged?
+      else if(tcpIsWindowUpdateDue(socket))
+      {
+         //Acknowledge the received data
+         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+      }
+      else
+      {
+         //Defer the ACK, hoping that it can be piggybacked on outgoing data
+         if(!osTimerRunning(&socket->delayedAckTimer))
+            tcpTimerStart(socket, &socket->delayedAckTimer, TCP_DELAYED_ACK_TIMEOUT);
+
+         //Update statistics
+         tcpStats.ackDelayed++;
+      }
+#else
+      //Acknowledge the received data
       tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+#endif
+
       //Notify user task that data is available
       tcpUpdateEvents(socket);
    }
@@ -833,11 +1051,24 @@ void tcpDeleteControlBlock(Socket *socket)
    //Delete SYN queue
    tcpFlushSynQueue(socket);
 
+   //The network controllers may still be transmitting data that
+   //point to the send buffer
+   nicReleaseTxData((ChunkedBuffer *) &socket->txBuffer);
+
    //Release transmit buffer
    chunkedBufferSetLength((ChunkedBuffer *) &socket->txBuffer, 0);
 
    //Release receive buffer
    chunkedBufferSetLength((ChunkedBuffer *) &socket->rxBuffer, 0);
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //Discard any pending acknowledgment
+   socket->rcvUnacked = 0;
+   osTimerStop(&socket->delayedAckTimer);
+#endif
+
+   //The TCP timers are not needed anymore
+   netTimerCancel(&socket->timer);
 }
 
 
@@ -893,7 +1124,7 @@ void tcpUpdateRetransmitQueue(Socket *socket)
 
          //When an ACK is received that acknowledges new data, restart the
          //retransmission timer so that it will expire after RTO seconds
-         osTimerStart(&socket->retransmitTimer, socket->rto);
+         tcpTimerStart(socket, &socket->retransmitTimer, socket->rto);
          //Reset retransmission counter
          socket->retransmitCount = 0;
       }
@@ -913,6 +1144,142 @@ void tcpUpdateRetransmitQueue(Socket *socket)
 }
 
 
+#if (TCP_SACK_SUPPORT == ENABLED)
+
+/**
+ * @brief Update the SACK scoreboard
+ *
+ * The segments of the retransmission queue that are covered by the SACK
+ * blocks of the incoming ACK are marked as such. The segments that are
+ * deemed lost are then identified and the amount of data outstanding in
+ * the network is estimated (refer to RFC 6675 section 4)
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] segment Incoming ACK segment
+ **/
+
+void tcpUpdateScoreboard(Socket *socket, TcpHeader *segment)
+{
+   uint_t i;
+   uint_t n;
+   uint_t sackedCount;
+   uint32_t sackedBytes;
+   uint32_t seqNum;
+   uint32_t leftEdge;
+   uint32_t rightEdge;
+   TcpOption *option;
+   TcpQueueItem *queueItem;
+
+   //SACK is not in use on this connection?
+   if(!socket->sackPermitted)
+      return;
+
+   //Search for the SACK option
+   option = tcpGetOption(segment, TCP_OPTION_SACK);
+
+   //Each block occupies 8 bytes
+   if(option && option->length >= 10 && ((option->length - 2) % 8) == 0)
+   {
+      //Number of blocks carried by the option
+      n = (option->length - 2) / 8;
+
+      //Loop through the blocks
+      for(i = 0; i < n; i++)
+      {
+         //Retrieve the edges of the current block
+         memcpy(&leftEdge, option->value + i * 8, sizeof(uint32_t));
+         memcpy(&rightEdge, option->value + i * 8 + 4, sizeof(uint32_t));
+         //Convert from network byte order to host byte order
+         leftEdge = ntohl(leftEdge);
+         rightEdge = ntohl(rightEdge);
+
+         //Discard invalid blocks as well as the blocks that
+         //report data that has already been acknowledged
+         if(TCP_CMP_SEQ(leftEdge, socket->sndUna) < 0)
+            continue;
+         if(TCP_CMP_SEQ(rightEdge, socket->sndNxt) > 0)
+            continue;
+         if(TCP_CMP_SEQ(rightEdge, leftEdge) <= 0)
+            continue;
+
+         //Keep track of the highest sequence number SACKed so far
+         if(TCP_CMP_SEQ(rightEdge, socket->sackHighSeq) > 0)
+            socket->sackHighSeq = rightEdge;
+
+         //Mark the segments that are entirely covered by the block
+         for(queueItem = socket->retransmitQueue; queueItem != NULL; queueItem = queueItem->next)
+         {
+            //Sequence number of the current segment
+            seqNum = ntohl(queueItem->header.seqNum);
+
+            //The retransmission queue is sorted by sequence number
+            if(TCP_CMP_SEQ(seqNum, rightEdge) >= 0)
+               break;
+
+            //Segment held by the receiver?
+            if(TCP_CMP_SEQ(seqNum, leftEdge) >= 0 &&
+               TCP_CMP_SEQ(seqNum + queueItem->length, rightEdge) <= 0)
+            {
+               queueItem->sacked = TRUE;
+            }
+         }
+      }
+   }
+
+   //The highest SACKed sequence number cannot lag behind SND.UNA
+   if(TCP_CMP_SEQ(socket->sackHighSeq, socket->sndUna) < 0)
+      socket->sackHighSeq = socket->sndUna;
+
+   //Total amount of data that has been SACKed
+   sackedCount = 0;
+   sackedBytes = 0;
+
+   //Loop through the retransmission queue
+   for(queueItem = socket->retransmitQueue; queueItem != NULL; queueItem = queueItem->next)
+   {
+      if(queueItem->sacked)
+      {
+         sackedCount++;
+         sackedBytes += queueItem->length;
+      }
+   }
+
+   //Estimate the number of bytes outstanding in the network
+   socket->pipe = 0;
+
+   //Loop through the retransmission queue
+   for(queueItem = socket->retransmitQueue; queueItem != NULL; queueItem = queueItem->next)
+   {
+      //SACKed segments have left the network
+      if(queueItem->sacked)
+      {
+         //Only the data SACKed above the following segments is counted
+         sackedCount--;
+         sackedBytes -= queueItem->length;
+         continue;
+      }
+
+      //A segment is deemed lost when either DupThresh discontiguous
+      //segments or more than (DupThresh - 1) * SMSS bytes with higher
+      //sequence numbers have been SACKed
+      if(sackedCount >= TCP_FAST_RETRANSMIT_THRES ||
+         sackedBytes > ((TCP_FAST_RETRANSMIT_THRES - 1) * socket->mss))
+      {
+         queueItem->lost = TRUE;
+      }
+
+      //Original transmission still in flight?
+      if(!queueItem->lost)
+         socket->pipe += queueItem->length;
+      //Retransmission still in flight?
+      if(queueItem->retransmitted)
+         socket->pipe += queueItem->length;
+   }
+}
+
+#endif
+
+
 /**
  * @brief Flush retransmission queue
  * @param[in] socket Handle referencing the socket
@@ -990,7 +1357,7 @@ void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge
          *leftEdge = min(*leftEdge, socket->sackBlock[i].leftEdge);
          *rightEdge = max(*rightEdge, socket->sackBlock[i].rightEdge);
          //Delete current block
-         memcpy(socket->sackBlock + i, socket->sackBlock + i + 1,
+         memmove(socket->sackBlock + i, socket->sackBlock + i + 1,
             (TCP_MAX_SACK_BLOCKS - i - 1) * sizeof(TcpSackBlock));
          //Decrement the number of non-contiguous blocks
          socket->sackBlockCount--;
@@ -1004,7 +1371,7 @@ void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge
    if(TCP_CMP_SEQ(*leftEdge, socket->rcvNxt) > 0)
    {
       //Make room for the new non-contiguous block
-      memcpy(socket->sackBlock + 1, socket->sackBlock,
+      memmove(socket->sackBlock + 1, socket->sackBlock,
          (TCP_MAX_SACK_BLOCKS - 1) * sizeof(TcpSackBlock));
       //Insert the element in the list
       socket->sackBlock[0].leftEdge = *leftEdge;
@@ -1024,7 +1391,7 @@ void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge
 void tcpUpdateReceiveWindow(Socket *socket)
 {
    //Space available but not yet advertised
-   uint16_t reduction = socket->rxBufferSize - socket->rcvUser - socket->rcvWnd;
+   uint32_t reduction = socket->rxBufferSize - socket->rcvUser - socket->rcvWnd;
 
    //To avoid SWS, the receiver should not advertise small windows
    if((socket->rcvWnd + reduction) >= min(socket->mss, socket->rxBufferSize / 2))
@@ -1045,11 +1412,52 @@ void tcpUpdateReceiveWindow(Socket *socket)
       {
          //The receive window can be updated
          socket->rcvWnd += reduction;
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+         //The ACK of the data received so far is being delayed, but
+         //the sender may be waiting for a window update?
+         if(socket->rcvUnacked > 0 && tcpIsWindowUpdateDue(socket))
+         {
+            //Send an ACK segment to advertise the new window size
+            tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+         }
+#endif
       }
    }
 }
 
 
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+
+/**
+ * @brief Check whether a delayed ACK should be sent to update the window
+ *
+ * When the peer can only send a small amount of data within the window
+ * that was last advertised, an ACK is sent as soon as the receive window
+ * is at least twice as large. Otherwise the sender would stall until
+ * the delayed ACK timer expires (refer to RFC 1122 4.2.3.3)
+ *
+ * @param[in] socket Handle referencing the socket
+ * @return TRUE if the ACK should be sent immediately, else FALSE
+ **/
+
+bool_t tcpIsWindowUpdateDue(Socket *socket)
+{
+   //Amount of data the peer can still send within the advertised window
+   int32_t remaining = TCP_CMP_SEQ(socket->rcvAdvEdge, socket->rcvNxt);
+
+   //The advertised window is not small?
+   if(remaining > 0 && (uint32_t) (2 * remaining) > socket->rxBufferSize)
+      return FALSE;
+
+   //Check whether the receive window has at least doubled
+   return (socket->rcvWnd >= socket->mss &&
+      socket->rcvWnd >= (uint32_t) (2 * max(remaining, 0)));
+}
+
+#endif
+
+
 /**
  * @brief Compute retransmission timeout
  * @param[in] socket Handle referencing the socket
@@ -1057,12 +1465,39 @@ void tcpUpdateReceiveWindow(Socket *socket)
 
 void tcpComputeRto(Socket *socket)
 {
+   time_t r;
+   bool_t valid = FALSE;
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //When timestamps are in use, every ACK that advances the left
+   //edge of the send window provides an RTT sample (see RFC 7323 4.1)
+   if(socket->tsEnabled && socket->tsEcr)
+   {
+      //Calculate round-time trip from the echoed timestamp
+      r = (uint32_t) osGetTickCount() - socket->tsEcr;
+      //The echoed timestamp is consumed
+      socket->tsEcr = 0;
+      //The timed sequence number is no longer needed
+      socket->rttBusy = FALSE;
+      //The sample is valid
+      valid = TRUE;
+   }
+   else
+#endif
    //Ensure the incoming ACK number covers the expected sequence number
    if(socket->rttBusy && TCP_CMP_SEQ(socket->sndUna, socket->rttSeqNum) > 0)
    {
       //Calculate round-time trip
-      time_t r = osGetTickCount() - socket->rttStartTime;
+      r = osGetTickCount() - socket->rttStartTime;
+      //RTT measurement is complete
+      socket->rttBusy = FALSE;
+      //The sample is valid
+      valid = TRUE;
+   }
 
+   //New RTT sample available?
+   if(valid)
+   {
       //First RTT measurement?
       if(!socket->srtt && !socket->rttvar)
       {
@@ -1089,9 +1524,6 @@ void tcpComputeRto(Socket *socket)
 
       //Debug message
       TRACE_DEBUG("R=%u, SRTT=%u, RTTVAR=%u, RTO=%u\r\n", r, socket->srtt, socket->rttvar, socket->rto);
-
-      //RTT measurement is complete
-      socket->rttBusy = FALSE;
    }
 }
 
@@ -1103,24 +1535,106 @@ void tcpComputeRto(Socket *socket)
  **/
 
 error_t tcpRetransmitSegment(Socket *socket)
+{
+   //Make sure the retransmission queue is not empty
+   if(!socket->retransmitQueue)
+      return NO_ERROR;
+
+   //Retransmit the earliest unacknowledged segment
+   return tcpRetransmitQueueItem(socket, socket->retransmitQueue);
+}
+
+
+/**
+ * @brief Retransmit a given segment of the retransmission queue
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Segment to be retransmitted
+ * @return Error code
+ **/
+
+error_t tcpRetransmitQueueItem(Socket *socket, TcpQueueItem *queueItem)
 {
    error_t error;
    size_t offset;
+   uint32_t ackNum;
+   uint16_t window;
    ChunkedBuffer *buffer;
-   TcpQueueItem *queueItem;
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   uint32_t timestamp[2];
+   TcpOption *option;
+#endif
 
-   //Make sure the retransmission queue is not empty
-   if(!socket->retransmitQueue)
-      return NO_ERROR;
+   //The retransmitted segment should carry the current acknowledgment
+   //number and window
+   if(queueItem->header.flags & TCP_FLAG_ACK)
+   {
+      //Convert from host byte order to network byte order
+      ackNum = htonl(socket->rcvNxt);
+      window = htons(tcpGetReceiveWindow(socket, queueItem->header.flags));
+
+      //Patch the checksum rather than summing the payload again
+      queueItem->header.checksum = ipUpdateChecksum(queueItem->header.checksum,
+         &queueItem->header.ackNum, &ackNum, sizeof(uint32_t));
+      queueItem->header.checksum = ipUpdateChecksum(queueItem->header.checksum,
+         &queueItem->header.window, &window, sizeof(uint16_t));
+
+      //Update TCP header
+      queueItem->header.ackNum = ackNum;
+      queueItem->header.window = window;
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Search for the Timestamps option
+      option = tcpGetOption(&queueItem->header, TCP_OPTION_TIMESTAMP);
+
+      //The retransmitted segment carries fresh timestamps so that the
+      //RTT sample taken from its acknowledgment remains valid
+      if(socket->tsEnabled && option && option->length == 10)
+      {
+         //Current timestamp clock and most recent timestamp received
+         timestamp[0] = htonl((uint32_t) osGetTickCount());
+         timestamp[1] = htonl(socket->tsRecent);
 
-   //Point to the segment to be retransmitted
-   queueItem = socket->retransmitQueue;
+         //Patch the checksum rather than summing the payload again
+         queueItem->header.checksum = ipUpdateChecksum(queueItem->header.checksum,
+            option->value, timestamp, sizeof(timestamp));
+
+         //Update the Timestamps option
+         memcpy(option->value, timestamp, sizeof(timestamp));
+      }
+
+      //Remember the last acknowledgment number sent
+      socket->lastAckSent = socket->rcvNxt;
+#endif
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+      //The retransmitted segment acknowledges all the data received so far
+      if(osTimerRunning(&socket->delayedAckTimer))
+         tcpStats.ackPiggybacked++;
+
+      //No need to send a separate ACK anymore
+      socket->rcvUnacked = 0;
+      osTimerStop(&socket->delayedAckTimer);
+#endif
+   }
 
    //Allocate a memory buffer to hold the TCP segment
    buffer = ipAllocBuffer(0, &offset);
    //Failed to allocate memory?
    if(!buffer) return ERROR_OUT_OF_MEMORY;
 
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //The retransmitted copy is now outstanding in the network
+   if(!queueItem->retransmitted)
+      socket->pipe += queueItem->length;
+#endif
+
+   //The segment has been resent at least once
+   queueItem->retransmitted = TRUE;
+
+   //Update statistics
+   socket->stats.retransmits++;
+   tcpStats.retransmits++;
+
    //Start of exception handling block
    do
    {
@@ -1165,7 +1679,7 @@ error_t tcpNagleAlgo(Socket *socket)
 
    //The amount of data that can be sent at any given time is
    //limited by the receiver window and the congestion window
-   n = min(socket->sndWnd, socket->cwnd);
+   n = min(socket->sndWnd, tcpCongestionGetWindow(socket));
    n = min(n, socket->txBufferSize);
 
    //Retrieve the size of the usable window
@@ -1457,11 +1971,15 @@ void tcpWriteTxBuffer(Socket *socket, uint32_t seqNum,
 error_t tcpReadTxBuffer(Socket *socket, uint32_t seqNum,
    ChunkedBuffer *buffer, size_t length)
 {
+   uint_t i;
    error_t error;
 
    //Offset of the first byte to read in the circular buffer
    size_t offset = (seqNum - socket->iss - 1) % socket->txBufferSize;
 
+   //Index of the first chunk that will reference the send buffer
+   i = buffer->chunkCount;
+
    //Check whether the specified data crosses buffer boundaries
    if((offset + length) <= socket->txBufferSize)
    {
@@ -1484,6 +2002,12 @@ error_t tcpReadTxBuffer(Socket *socket, uint32_t seqNum,
       }
    }
 
+   //The payload is referenced rather than copied. Since the send buffer
+   //is left untouched until the data is acknowledged, the network driver
+   //may hand these chunks directly to the DMA
+   for(; i < buffer->chunkCount; i++)
+      buffer->chunk[i].flags |= CHUNK_FLAG_ZERO_COPY;
+
    //Return status code
    return error;
 }
@@ -41,6 +41,10 @@ error_t tcpSendResetSegment(NetInterface *interface,
 
 error_t tcpAddOption(TcpHeader *segment, uint8_t kind, const void *value, uint8_t length);
 TcpOption *tcpGetOption(TcpHeader *segment, uint8_t kind);
+error_t tcpGetTimestampOption(TcpHeader *segment, uint32_t *tsVal, uint32_t *tsEcr);
+
+uint16_t tcpGetReceiveWindow(Socket *socket, uint8_t flags);
+uint32_t tcpGetSendWindow(Socket *socket, TcpHeader *segment);
 
 error_t tcpCheckSequenceNumber(Socket *socket, TcpHeader *segment, size_t length);
 error_t tcpCheckSyn(Socket *socket, TcpHeader *segment, size_t length);
@@ -52,15 +56,18 @@ void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
 void tcpDeleteControlBlock(Socket *socket);
 
 void tcpUpdateRetransmitQueue(Socket *socket);
+void tcpUpdateScoreboard(Socket *socket, TcpHeader *segment);
 void tcpFlushRetransmitQueue(Socket *socket);
 
 void tcpFlushSynQueue(Socket *socket);
 
 void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge);
 void tcpUpdateReceiveWindow(Socket *socket);
+bool_t tcpIsWindowUpdateDue(Socket *socket);
 
 void tcpComputeRto(Socket *socket);
 error_t tcpRetransmitSegment(Socket *socket);
+error_t tcpRetransmitQueueItem(Socket *socket, TcpQueueItem *queueItem);
 error_t tcpNagleAlgo(Socket *socket);
 
 void tcpChangeState(Socket *socket, TcpState newState);
@@ -34,6 +34,8 @@
 #include "socket.h"
 #include "tcp.h"
 #include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_congestion.h"
 #include "ipv4.h"
 #include "debug.h"
 
@@ -41,212 +43,342 @@
 #if (TCP_SUPPORT == ENABLED)
 
 
+/**
+ * @brief Start a TCP timer
+ *
+ * The deadline is registered with the timer wheel so that the
+ * TCP timer handler is invoked when the timer elapses
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] timer TCP timer to start
+ * @param[in] delay Time interval
+ **/
+
+void tcpTimerStart(Socket *socket, OsTimer *timer, time_t delay)
+{
+   //Start the timer
+   osTimerStart(timer, delay);
+   //Make sure the handler is invoked when the timer elapses
+   netTimerSchedule(&socket->timer, delay);
+}
+
+
 /**
  * @brief TCP timer handler
  *
- * This routine must be periodically called by the TCP/IP stack to
- * handle retransmissions and TCP related timers (persist timer,
- * FIN-WAIT-2 timer and TIME-WAIT timer)
+ * This routine is invoked by the timer wheel when one of the
+ * timers of the socket may have elapsed
  *
+ * @param[in] param Handle referencing the socket
  **/
 
-void tcpTick(void)
+void tcpTimerHandler(void *param)
 {
-   error_t error;
-   uint_t i;
-   uint_t n;
-   uint_t u;
+   int32_t delay;
+   Socket *socket;
+
+   //Point to the socket
+   socket = (Socket *) param;
 
    //Enter critical section
    osMutexAcquire(socketMutex);
 
-   //Loop through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   //The socket may have been closed in the meantime
+   if(socket->type == SOCKET_TYPE_STREAM && socket->state != TCP_STATE_CLOSED)
    {
-      //Shortcut to the current socket
-      Socket *socket = socketTable + i;
-      //Check socket type
-      if(socket->type != SOCKET_TYPE_STREAM)
-         continue;
-      //Check the current state of the TCP state machine
-      if(socket->state == TCP_STATE_CLOSED)
-         continue;
-
-      //Is there any packet in the retransmission queue?
-      if(socket->retransmitQueue != NULL)
+      //Handle retransmissions and TCP related timers
+      tcpTick(socket);
+
+      //Check whether the socket is still in use
+      if(socket->type == SOCKET_TYPE_STREAM && socket->state != TCP_STATE_CLOSED)
       {
-         //Retransmission timeout?
-         if(osTimerElapsed(&socket->retransmitTimer))
-         {
-            //When a TCP sender detects segment loss using the retransmission
-            //timer and the given segment has not yet been resent by way of
-            //the retransmission timer, the value of ssthresh must be updated
-            if(!socket->retransmitCount)
-            {
-               //Amount of data that has been sent but not yet acknowledged
-               uint_t flightSize = socket->sndNxt - socket->sndUna;
-               //Adjust ssthresh value
-               socket->ssthresh = max(flightSize / 2, 2 * socket->mss);
-            }
-
-            //Furthermore, upon a timeout cwnd must be set to no more than
-            //the loss window, LW, which equals 1 full-sized segment
-            socket->cwnd = min(TCP_LOSS_WINDOW * socket->mss, socket->txBufferSize);
-
-            //Make sure the maximum number of retransmissions has not been reached
-            if(socket->retransmitCount < TCP_MAX_RETRIES)
-            {
-               //Debug message
-               TRACE_INFO("%s: TCP segment retransmission #%u (%u data bytes)...\r\n",
-                  timeFormat(osGetTickCount()), socket->retransmitCount + 1, socket->retransmitQueue->length);
-
-               //Retransmit the earliest segment that has not been
-               //acknowledged by the TCP receiver
-               tcpRetransmitSegment(socket);
-
-               //Use exponential back-off algorithm to calculate the new RTO
-               socket->rto = min(socket->rto * 2, TCP_MAX_RTO);
-               //Restart retransmission timer
-               osTimerStart(&socket->retransmitTimer, socket->rto);
-               //Increment retransmission counter
-               socket->retransmitCount++;
-            }
-            else
-            {
-               //The maximum number of retransmissions has been exceeded
-               tcpChangeState(socket, TCP_STATE_CLOSED);
-               //Turn off the retransmission timer
-               osTimerStop(&socket->retransmitTimer);
-            }
-
-            //TCP must use Karn's algorithm for taking RTT samples. That is, RTT
-            //samples must not be made using segments that were retransmitted
-            socket->rttBusy = FALSE;
-         }
+         //Compute the delay before the next timer elapses
+         delay = tcpTimerGetDelay(socket);
+
+         //Re-arm the timer if necessary
+         if(delay >= 0)
+            netTimerSchedule(&socket->timer, delay);
       }
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+}
+
+
+/**
+ * @brief Compute the delay before the next TCP timer elapses
+ *
+ * Only the timers that are relevant in the current state of the
+ * connection are taken into account
+ *
+ * @param[in] socket Handle referencing the socket
+ * @return Delay in milliseconds, or -1 if no timer is running
+ **/
+
+int32_t tcpTimerGetDelay(Socket *socket)
+{
+   int32_t delay;
+   time_t time;
+
+   //Get current time
+   time = osGetTickCount();
+   //No timer running yet
+   delay = -1;
+
+   //Retransmission timer
+   if(socket->retransmitQueue != NULL)
+      delay = tcpTimerGetRemaining(&socket->retransmitTimer, time, delay);
+
+   //Persist timer
+   if(!socket->sndWnd && socket->wndProbeInterval)
+      delay = tcpTimerGetRemaining(&socket->persistTimer, time, delay);
+
+   //Override timer
+   if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+   {
+      if(socket->sndUser)
+         delay = tcpTimerGetRemaining(&socket->overrideTimer, time, delay);
+   }
+
+   //FIN-WAIT-2 timer
+   if(socket->state == TCP_STATE_FIN_WAIT_2)
+      delay = tcpTimerGetRemaining(&socket->finWait2Timer, time, delay);
+
+   //2MSL timer
+   if(socket->state == TCP_STATE_TIME_WAIT)
+      delay = tcpTimerGetRemaining(&socket->timeWaitTimer, time, delay);
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //Delayed ACK timer
+   delay = tcpTimerGetRemaining(&socket->delayedAckTimer, time, delay);
+#endif
+
+   //Return the delay before the next timer elapses
+   return delay;
+}
+
+
+/**
+ * @brief Update the earliest deadline with the remaining time of a timer
+ * @param[in] timer TCP timer
+ * @param[in] time Current time
+ * @param[in] delay Earliest deadline found so far (-1 if none)
+ * @return Earliest deadline
+ **/
+
+int32_t tcpTimerGetRemaining(OsTimer *timer, time_t time, int32_t delay)
+{
+   int32_t remaining;
+
+   //Make sure the timer is running
+   if(!osTimerRunning(timer))
+      return delay;
+
+   //Time remaining before the timer elapses
+   remaining = max(timeCompare(timer->startTime + timer->interval, time), 0);
+
+   //Keep track of the earliest deadline
+   if(delay < 0 || remaining < delay)
+      return remaining;
+   else
+      return delay;
+}
+
+
+/**
+ * @brief Process the timers of a TCP connection
+ *
+ * This routine handles retransmissions and TCP related timers (delayed
+ * ACK timer, persist timer, FIN-WAIT-2 timer and TIME-WAIT timer)
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
 
-      //Check the current state of the TCP state machine
-      if(socket->state == TCP_STATE_CLOSED)
-         continue;
+void tcpTick(Socket *socket)
+{
+   error_t error;
+   uint_t n;
+   uint_t u;
 
-      //The persist timer is used when the remote host advertises
-      //a window size of zero
-      if(!socket->sndWnd && socket->wndProbeInterval)
+   //Is there any packet in the retransmission queue?
+   if(socket->retransmitQueue != NULL)
+   {
+      //Retransmission timeout?
+      if(osTimerElapsed(&socket->retransmitTimer))
       {
-         //Time to send a new probe?
-         if(osTimerElapsed(&socket->persistTimer))
+         //Update statistics
+         socket->stats.timeouts++;
+         tcpStats.timeouts++;
+
+         //Adjust ssthresh and cwnd and enter loss recovery
+         tcpCongestionOnRto(socket);
+
+         //Make sure the maximum number of retransmissions has not been reached
+         if(socket->retransmitCount < TCP_MAX_RETRIES)
          {
-            //Make sure the maximum number of retransmissions has not been reached
-            if(socket->wndProbeCount < TCP_MAX_RETRIES)
-            {
-               //Debug message
-               TRACE_INFO("%s: TCP zero window probe #%u...\r\n",
-                  timeFormat(osGetTickCount()), socket->wndProbeCount + 1);
-
-               //Zero window probes usually have the sequence number one less than expected
-               tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt - 1, socket->rcvNxt, 0, FALSE);
-               //The interval between successive probes should be increased exponentially
-               socket->wndProbeInterval = min(socket->wndProbeInterval * 2, TCP_MAX_PROBE_INTERVAL);
-               //Restart the persist timer
-               osTimerStart(&socket->persistTimer, socket->wndProbeInterval);
-               //Increment window probe counter
-               socket->wndProbeCount++;
-            }
-            else
-            {
-               //Enter CLOSED state
-               tcpChangeState(socket, TCP_STATE_CLOSED);
-            }
-         }
-      }
+            //Debug message
+            TRACE_INFO("%s: TCP segment retransmission #%u (%u data bytes)...\r\n",
+               timeFormat(osGetTickCount()), socket->retransmitCount + 1, socket->retransmitQueue->length);
 
-      //To avoid a deadlock, it is necessary to have a timeout to force
-      //transmission of data, overriding the SWS avoidance algorithm. In
-      //practice, this timeout should seldom occur (see RFC 1122 4.2.3.4)
-      if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
-      {
-         //The override timeout occurred?
-         if(socket->sndUser && osTimerElapsed(&socket->overrideTimer))
+            //Retransmit the earliest segment that has not been
+            //acknowledged by the TCP receiver
+            tcpRetransmitSegment(socket);
+
+            //Use exponential back-off algorithm to calculate the new RTO
+            socket->rto = min(socket->rto * 2, TCP_MAX_RTO);
+            //Restart retransmission timer
+            tcpTimerStart(socket, &socket->retransmitTimer, socket->rto);
+            //Increment retransmission counter
+            socket->retransmitCount++;
+         }
+         else
          {
-            //The amount of data that can be sent at any given time is
-            //limited by the receiver window and the congestion window
-            n = min(socket->sndWnd, socket->cwnd);
-            n = min(n, socket->txBufferSize);
-
-            //Retrieve the size of the usable window
-            u = n - (socket->sndNxt - socket->sndUna);
-
-            //Send as much data as possible
-            while(socket->sndUser > 0)
-            {
-               //The usable window size may become zero or negative,
-               //preventing packet transmission
-               if((int_t) u <= 0) break;
-
-               //Calculate the number of bytes to send at a time
-               n = min(u, socket->sndUser);
-               n = min(n, socket->mss);
-
-               //Send TCP segment
-               error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
-                  socket->sndNxt, socket->rcvNxt, n, TRUE);
-               //Failed to send TCP segment?
-               if(error) break;
-
-               //Advance SND.NXT pointer
-               socket->sndNxt += n;
-               //Adjust the number of bytes buffered but not yet sent
-               socket->sndUser -= n;
-            }
-
-            //Check whether the transmitter can accept more data
-            tcpUpdateEvents(socket);
-
-            //Restart override timer if necessary
-            if(socket->sndUser > 0)
-               osTimerStart(&socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
+            //The maximum number of retransmissions has been exceeded
+            tcpChangeState(socket, TCP_STATE_CLOSED);
+            //Turn off the retransmission timer
+            osTimerStop(&socket->retransmitTimer);
          }
+
+         //TCP must use Karn's algorithm for taking RTT samples. That is, RTT
+         //samples must not be made using segments that were retransmitted
+         socket->rttBusy = FALSE;
       }
+   }
+
+   //Check the current state of the TCP state machine
+   if(socket->state == TCP_STATE_CLOSED)
+      return;
 
-      //The FIN-WAIT-2 timer prevents the connection
-      //from staying in the FIN-WAIT-2 state forever
-      if(socket->state == TCP_STATE_FIN_WAIT_2)
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //Delayed ACK timer elapsed?
+   if(osTimerElapsed(&socket->delayedAckTimer))
+   {
+      //Update statistics
+      tcpStats.ackTimeouts++;
+      //Acknowledge the data received so far
+      tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+   }
+#endif
+
+   //The persist timer is used when the remote host advertises
+   //a window size of zero
+   if(!socket->sndWnd && socket->wndProbeInterval)
+   {
+      //Time to send a new probe?
+      if(osTimerElapsed(&socket->persistTimer))
       {
-         //Maximum FIN-WAIT-2 time has elapsed?
-         if(osTimerElapsed(&socket->finWait2Timer))
+         //Make sure the maximum number of retransmissions has not been reached
+         if(socket->wndProbeCount < TCP_MAX_RETRIES)
          {
             //Debug message
-            TRACE_WARNING("TCP FIN-WAIT-2 timer elapsed...\r\n");
+            TRACE_INFO("%s: TCP zero window probe #%u...\r\n",
+               timeFormat(osGetTickCount()), socket->wndProbeCount + 1);
+
+            //Zero window probes usually have the sequence number one less than expected
+            tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt - 1, socket->rcvNxt, 0, FALSE);
+            //The interval between successive probes should be increased exponentially
+            socket->wndProbeInterval = min(socket->wndProbeInterval * 2, TCP_MAX_PROBE_INTERVAL);
+            //Restart the persist timer
+            tcpTimerStart(socket, &socket->persistTimer, socket->wndProbeInterval);
+            //Increment window probe counter
+            socket->wndProbeCount++;
+         }
+         else
+         {
             //Enter CLOSED state
             tcpChangeState(socket, TCP_STATE_CLOSED);
          }
       }
+   }
 
-      //TIME-WAIT timer
-      if(socket->state == TCP_STATE_TIME_WAIT)
+   //To avoid a deadlock, it is necessary to have a timeout to force
+   //transmission of data, overriding the SWS avoidance algorithm. In
+   //practice, this timeout should seldom occur (see RFC 1122 4.2.3.4)
+   if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+   {
+      //The override timeout occurred?
+      if(socket->sndUser && osTimerElapsed(&socket->overrideTimer))
       {
-         //2MSL time has elapsed?
-         if(osTimerElapsed(&socket->timeWaitTimer))
+         //The amount of data that can be sent at any given time is
+         //limited by the receiver window and the congestion window
+         n = min(socket->sndWnd, tcpCongestionGetWindow(socket));
+         n = min(n, socket->txBufferSize);
+
+         //Retrieve the size of the usable window
+         u = n - (socket->sndNxt - socket->sndUna);
+
+         //Send as much data as possible
+         while(socket->sndUser > 0)
          {
-            //Debug message
-            TRACE_WARNING("TCP 2MSL timer elapsed (socket %u)...\r\n", i);
-            //Enter CLOSED state
-            tcpChangeState(socket, TCP_STATE_CLOSED);
+            //The usable window size may become zero or negative,
+            //preventing packet transmission
+            if((int_t) u <= 0) break;
+
+            //Calculate the number of bytes to send at a time
+            n = min(u, socket->sndUser);
+            n = min(n, socket->mss);
+
+            //Send TCP segment
+            error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
+               socket->sndNxt, socket->rcvNxt, n, TRUE);
+            //Failed to send TCP segment?
+            if(error) break;
 
-            //Dispose the socket if the user does not have the ownership anymore
-            if(!socket->ownedFlag)
-            {
-               //Delete the TCB
-               tcpDeleteControlBlock(socket);
-               //Mark the socket as closed
-               socket->type = SOCKET_TYPE_UNUSED;
-            }
+            //Advance SND.NXT pointer
+            socket->sndNxt += n;
+            //Adjust the number of bytes buffered but not yet sent
+            socket->sndUser -= n;
+            //Update the size of the usable window
+            u -= n;
          }
+
+         //Check whether the transmitter can accept more data
+         tcpUpdateEvents(socket);
+
+         //Restart override timer if necessary
+         if(socket->sndUser > 0)
+            tcpTimerStart(socket, &socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
       }
    }
 
-   //Leave critical section
-   osMutexRelease(socketMutex);
+   //The FIN-WAIT-2 timer prevents the connection
+   //from staying in the FIN-WAIT-2 state forever
+   if(socket->state == TCP_STATE_FIN_WAIT_2)
+   {
+      //Maximum FIN-WAIT-2 time has elapsed?
+      if(osTimerElapsed(&socket->finWait2Timer))
+      {
+         //Debug message
+         TRACE_WARNING("TCP FIN-WAIT-2 timer elapsed...\r\n");
+         //Enter CLOSED state
+         tcpChangeState(socket, TCP_STATE_CLOSED);
+      }
+   }
+
+   //TIME-WAIT timer
+   if(socket->state == TCP_STATE_TIME_WAIT)
+   {
+      //2MSL time has elapsed?
+      if(osTimerElapsed(&socket->timeWaitTimer))
+      {
+         //Debug message
+         TRACE_WARNING("TCP 2MSL timer elapsed (socket %u)...\r\n", socket->descriptor);
+         //Enter CLOSED state
+         tcpChangeState(socket, TCP_STATE_CLOSED);
+
+         //Dispose the socket if the user does not have the ownership anymore
+         if(!socket->ownedFlag)
+         {
+            //Delete the TCB
+            tcpDeleteControlBlock(socket);
+            //Remove the socket from the lookup tables
+            socketHashRemove(socket);
+            //Mark the socket as closed
+            socket->type = SOCKET_TYPE_UNUSED;
+         }
+      }
+   }
 }
 
 #endif
@@ -29,7 +29,16 @@
 #ifndef _TCP_TIMER_H
 #define _TCP_TIMER_H
 
+//Dependencies
+#include "tcp.h"
+
 //TCP timer related functions
-void tcpTick(void);
+void tcpTimerStart(Socket *socket, OsTimer *timer, time_t delay);
+void tcpTimerHandler(void *param);
+
+int32_t tcpTimerGetDelay(Socket *socket);
+int32_t tcpTimerGetRemaining(OsTimer *timer, time_t time, int32_t delay);
+
+void tcpTick(Socket *socket);
 
 #endif
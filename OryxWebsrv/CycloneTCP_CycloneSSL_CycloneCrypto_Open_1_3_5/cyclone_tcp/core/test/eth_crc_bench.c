@@ -0,0 +1,262 @@
+/**
+ * @file eth_crc_bench.c
+ * @brief Ethernet CRC benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The CRC engine is selected at compile time, so this program is built
+ * once per variant (ETH_FAST_CRC_SUPPORT and ETH_FAST_CRC_SLICES, see
+ * demo/posix/Makefile). Each build checks ethCalcCrc and ethCalcCrcEx
+ * against a bitwise reference, then reports its throughput over
+ * contiguous and multi-part frames
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "ethernet.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Number of random test vectors
+#define TEST_ITERATIONS 20000
+//Maximum number of chunks of a multi-part buffer
+#define TEST_MAX_CHUNK_COUNT 8
+//Amount of data processed by each benchmark
+#define BENCH_DATA_SIZE (64 * 1024 * 1024)
+
+//Name of the variant being measured
+#if (ETH_FAST_CRC_SUPPORT == DISABLED)
+   #define BENCH_VARIANT "bit by bit"
+#elif (ETH_FAST_CRC_SLICES == 1)
+   #define BENCH_VARIANT "byte table"
+#elif (ETH_FAST_CRC_SLICES == 4)
+   #define BENCH_VARIANT "slicing-by-4"
+#else
+   #define BENCH_VARIANT "slicing-by-8"
+#endif
+
+//Multi-part buffer used by the tests
+typedef struct
+{
+   uint_t chunkCount;
+   uint_t maxChunkCount;
+   ChunkDesc chunk[TEST_MAX_CHUNK_COUNT];
+} TestBuffer;
+
+//Random test data
+static uint8_t testData[2048];
+
+
+/**
+ * @brief Reference CRC (bit by bit)
+ **/
+
+static uint32_t refCalcCrc(const uint8_t *data, size_t length)
+{
+   uint_t j;
+   uint32_t crc = 0xFFFFFFFF;
+
+   //Loop through data
+   while(length > 0)
+   {
+      //Update CRC value
+      crc ^= *data;
+
+      //The message is processed bit by bit
+      for(j = 0; j < 8; j++)
+         crc = (crc & 0x00000001) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+
+      //Next byte
+      data++;
+      length--;
+   }
+
+   //Return 1's complement value
+   return ~crc;
+}
+
+
+/**
+ * @brief Split a contiguous block into random chunks
+ **/
+
+static void splitData(TestBuffer *buffer, uint8_t *data, size_t length, uint_t count)
+{
+   uint_t i;
+   size_t n;
+
+   //Initialize the multi-part buffer
+   buffer->chunkCount = 0;
+   buffer->maxChunkCount = TEST_MAX_CHUNK_COUNT;
+
+   //Loop through chunks
+   for(i = 0; i < count; i++)
+   {
+      //The last chunk holds the remaining data
+      n = (i == count - 1) ? length : (size_t) rand() % (length + 1);
+
+      //Fill the chunk descriptor
+      buffer->chunk[i].address = data;
+      buffer->chunk[i].length = n;
+      buffer->chunk[i].size = 0;
+      buffer->chunk[i].flags = 0;
+      buffer->chunkCount++;
+
+      //Next chunk
+      data += n;
+      length -= n;
+   }
+}
+
+
+/**
+ * @brief Check the CRC engine against the reference
+ * @return Error code
+ **/
+
+static error_t checkCrc(void)
+{
+   uint_t i;
+   size_t offset;
+   size_t length;
+   uint32_t crc;
+   TestBuffer buffer;
+
+   //Run the random test vectors
+   for(i = 0; i < TEST_ITERATIONS; i++)
+   {
+      //Random alignment and length
+      offset = rand() % 8;
+      length = rand() % 1600;
+
+      //Contiguous data
+      if(ethCalcCrc(testData + offset, length) != refCalcCrc(testData + offset, length))
+      {
+         printf("ethCalcCrc mismatch (offset %u, length %u)\r\n", (uint_t) offset, (uint_t) length);
+         return ERROR_FAILURE;
+      }
+
+      //Same data split into random chunks
+      splitData(&buffer, testData, length + offset, 1 + rand() % TEST_MAX_CHUNK_COUNT);
+
+      //The CRC state must be carried over from one chunk to the next
+      if(ethCalcCrcEx((ChunkedBuffer *) &buffer, offset, length) !=
+         refCalcCrc(testData + offset, length))
+      {
+         printf("ethCalcCrcEx mismatch (%u chunks, offset %u, length %u)\r\n",
+            buffer.chunkCount, (uint_t) offset, (uint_t) length);
+         return ERROR_FAILURE;
+      }
+   }
+
+   //A frame followed by its FCS leaves the well-known residue
+   crc = ethCalcCrc(testData, 60);
+   memcpy(testData + 60, &crc, ETH_CRC_SIZE);
+
+   //Check the residue used by ethProcessFrame
+   if(ethCalcCrc(testData, 64) != 0x2144DF1C)
+   {
+      printf("Unexpected residue\r\n");
+      return ERROR_FAILURE;
+   }
+
+   //Successful test
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Measure CRC throughput
+ * @param[in] length Frame length
+ * @param[in] chunkCount Number of chunks the frame is split into (0 for contiguous data)
+ * @return Throughput in MB/s
+ **/
+
+static double benchCrc(size_t length, uint_t chunkCount)
+{
+   uint_t i;
+   uint_t n;
+   uint64_t time;
+   TestBuffer buffer;
+   volatile uint32_t crc;
+
+   //Split the frame, for multi-part measurements
+   if(chunkCount > 0)
+      splitData(&buffer, testData, length, chunkCount);
+
+   //Number of computations
+   n = BENCH_DATA_SIZE / length;
+
+   //Start of the measurement
+   time = benchGetTime();
+
+   //Compute the CRC repeatedly
+   for(i = 0; i < n; i++)
+   {
+      if(chunkCount > 0)
+         crc = ethCalcCrcEx((ChunkedBuffer *) &buffer, 0, length);
+      else
+         crc = ethCalcCrc(testData, length);
+   }
+
+   //End of the measurement
+   time = benchGetTime() - time;
+
+   //Return the throughput
+   return benchMbps((uint64_t) n * length, time);
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   uint_t i;
+
+   //Initialize debug output
+   debugInit();
+
+   //Generate random test data
+   for(i = 0; i < sizeof(testData); i++)
+      testData[i] = rand();
+
+   //Check the CRC engine
+   error = checkCrc();
+
+   //Display results (MB/s)
+   printf("CRC %-14s %s, 64 B: %6.0f, 1514 B: %6.0f, 1514 B in 3 chunks: %6.0f MB/s\r\n",
+      BENCH_VARIANT, error ? "FAILED" : "OK", benchCrc(64, 0), benchCrc(1514, 0), benchCrc(1514, 3));
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
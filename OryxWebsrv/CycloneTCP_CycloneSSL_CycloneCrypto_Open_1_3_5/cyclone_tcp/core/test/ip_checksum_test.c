@@ -0,0 +1,298 @@
+/**
+ * @file ip_checksum_test.c
+ * @brief Internet checksum equivalence test and benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The checksum routines of ip.c are compared with the 16-bit loops of
+ * earlier releases over random lengths, alignments and chunk layouts.
+ * The incremental update (RFC 1624) is checked against a full computation
+ * of the modified data. The throughput of both implementations is then
+ * measured over typical segment sizes
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "ip.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Number of random test vectors
+#define TEST_ITERATIONS 200000
+//Maximum number of chunks of a multi-part buffer
+#define TEST_MAX_CHUNK_COUNT 8
+//Amount of data processed by each benchmark
+#define BENCH_DATA_SIZE (256 * 1024 * 1024)
+
+//Multi-part buffer used by the tests
+typedef struct
+{
+   uint_t chunkCount;
+   uint_t maxChunkCount;
+   ChunkDesc chunk[TEST_MAX_CHUNK_COUNT];
+} TestBuffer;
+
+//Random test data
+static uint8_t testData[65536 + 64];
+
+
+/**
+ * @brief Reference checksum (16 bits at a time)
+ **/
+
+static uint16_t refCalcChecksum(const void *data, size_t length)
+{
+   //Checksum preset value
+   uint32_t checksum = 0x0000;
+
+   //Process all the data
+   while(length > 1)
+   {
+      //Update checksum value
+      checksum += *((uint16_t *) data);
+      //Point to the next 16-bit word
+      data = (uint16_t *) data + 1;
+      //Adjust the number of remaining words to process
+      length -= 2;
+   }
+
+   //Add left-over byte, if any
+   if(length > 0)
+      checksum += *((uint8_t *) data);
+
+   //Fold 32-bit sum to 16 bits
+   while(checksum >> 16)
+      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+
+   //Return 1's complement value
+   return checksum ^ 0xFFFF;
+}
+
+
+/**
+ * @brief Reference checksum over a multi-part buffer
+ *
+ * Same definition as refCalcChecksum, the data being the concatenation
+ * of the chunks, so the reference is computed over a contiguous copy
+ *
+ **/
+
+static uint16_t refCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t length)
+{
+   size_t n;
+   static uint8_t temp[TEST_MAX_CHUNK_COUNT * 1024];
+
+   //Gather the requested data
+   n = chunkedBufferRead(temp, buffer, offset, length);
+   //Compute the checksum of the contiguous copy
+   return refCalcChecksum(temp, n);
+}
+
+
+/**
+ * @brief Pseudo-random number
+ **/
+
+static uint_t testRand(uint_t n)
+{
+   //Return a value in the range 0 to n - 1
+   return n ? (uint_t) rand() % n : 0;
+}
+
+
+/**
+ * @brief Randomized equivalence test
+ * @return Error code
+ **/
+
+static error_t checkEquivalence(void)
+{
+   uint_t i;
+   uint_t j;
+   size_t offset;
+   size_t length;
+   size_t total;
+   uint16_t checksum;
+   uint8_t *data;
+   uint8_t field[8];
+   uint8_t packet[64];
+   TestBuffer buffer;
+
+   //Run the random test vectors
+   for(i = 0; i < TEST_ITERATIONS; i++)
+   {
+      //Random alignment and length (long buffers are tested less often)
+      data = testData + testRand(64);
+      length = testRand((i % 64) ? 2048 : 65536);
+
+      //Contiguous data
+      if(ipCalcChecksum(data, length) != refCalcChecksum(data, length))
+      {
+         printf("ipCalcChecksum mismatch (offset %u, length %u)\r\n",
+            (uint_t) (data - testData), (uint_t) length);
+         return ERROR_FAILURE;
+      }
+
+      //Build a multi-part buffer with random chunks
+      buffer.chunkCount = 1 + testRand(TEST_MAX_CHUNK_COUNT);
+      buffer.maxChunkCount = TEST_MAX_CHUNK_COUNT;
+
+      //Loop through chunks
+      for(total = 0, j = 0; j < buffer.chunkCount; j++)
+      {
+         buffer.chunk[j].address = testData + testRand(60000);
+         buffer.chunk[j].length = testRand(1024);
+         buffer.chunk[j].size = 0;
+         buffer.chunk[j].flags = 0;
+         total += buffer.chunk[j].length;
+      }
+
+      //Random range within the buffer
+      offset = testRand(total + 1);
+      length = testRand(total - offset + 1);
+
+      //Multi-part data
+      if(ipCalcChecksumEx((ChunkedBuffer *) &buffer, offset, length) !=
+         refCalcChecksumEx((ChunkedBuffer *) &buffer, offset, length))
+      {
+         printf("ipCalcChecksumEx mismatch (%u chunks, offset %u, length %u)\r\n",
+            buffer.chunkCount, (uint_t) offset, (uint_t) length);
+         return ERROR_FAILURE;
+      }
+
+      //Take a header-sized packet and compute its checksum
+      memcpy(packet, testData + testRand(60000), sizeof(packet));
+      checksum = ipCalcChecksum(packet, sizeof(packet));
+
+      //Modify a field located at an even offset
+      offset = 2 * testRand((sizeof(packet) - sizeof(field)) / 2 + 1);
+      length = 2 * (1 + testRand(sizeof(field) / 2));
+
+      //Random contents
+      for(j = 0; j < length; j++)
+         field[j] = testRand(256);
+
+      //Update the checksum incrementally
+      checksum = ipUpdateChecksum(checksum, packet + offset, field, length);
+      memcpy(packet + offset, field, length);
+
+      //0x0000 and 0xFFFF both represent zero in 1's complement
+      if(checksum != ipCalcChecksum(packet, sizeof(packet)) &&
+         (checksum ^ ipCalcChecksum(packet, sizeof(packet))) != 0xFFFF)
+      {
+         printf("ipUpdateChecksum mismatch (offset %u, length %u)\r\n",
+            (uint_t) offset, (uint_t) length);
+         return ERROR_FAILURE;
+      }
+   }
+
+   //Successful test
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Measure checksum throughput
+ * @param[in] reference Use the reference implementation
+ * @param[in] length Length of each computation
+ * @param[in] misaligned Start on an odd address
+ * @return Throughput in MB/s
+ **/
+
+static double benchChecksum(bool_t reference, size_t length, bool_t misaligned)
+{
+   uint_t i;
+   uint_t n;
+   uint64_t time;
+   uint8_t *data;
+   volatile uint16_t checksum;
+
+   //Point to the data
+   data = testData + (misaligned ? 3 : 0);
+   //Number of computations
+   n = BENCH_DATA_SIZE / length;
+
+   //Start of the measurement
+   time = benchGetTime();
+
+   //Compute the checksum repeatedly
+   for(i = 0; i < n; i++)
+   {
+      if(reference)
+         checksum = refCalcChecksum(data, length);
+      else
+         checksum = ipCalcChecksum(data, length);
+   }
+
+   //End of the measurement
+   time = benchGetTime() - time;
+
+   //Return the throughput
+   return benchMbps((uint64_t) n * length, time);
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   uint_t i;
+   static const size_t lengths[] = {20, 40, 536, 1460, 16384};
+
+   //Initialize debug output
+   debugInit();
+
+   //Generate random test data
+   for(i = 0; i < sizeof(testData); i++)
+      testData[i] = testRand(256);
+
+   //Compare both implementations
+   error = checkEquivalence();
+   //Display result
+   printf("Checksum equivalence (%u vectors): %s\r\n", TEST_ITERATIONS, error ? "FAILED" : "OK");
+
+   //Display header
+   printf("\r\n%-28s %12s %12s\r\n", "ipCalcChecksum (MB/s)", "16-bit loop", "current");
+
+   //Measure throughput for typical lengths
+   for(i = 0; i < arraysize(lengths); i++)
+   {
+      printf("%5u bytes, aligned         %12.0f %12.0f\r\n", (uint_t) lengths[i],
+         benchChecksum(TRUE, lengths[i], FALSE), benchChecksum(FALSE, lengths[i], FALSE));
+      printf("%5u bytes, odd address     %12.0f %12.0f\r\n", (uint_t) lengths[i],
+         benchChecksum(TRUE, lengths[i], TRUE), benchChecksum(FALSE, lengths[i], TRUE));
+   }
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,349 @@
+/**
+ * @file mem_pool_bench.c
+ * @brief Memory pool microbenchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Replays the allocation patterns of the RX/TX path (the blocks requested
+ * by chunkedBufferAlloc for full frames and for bare ACKs, with a varying
+ * number of buffers held by sockets and queues) against the size-class
+ * pools, and against the linear scan of the allocation table used by
+ * earlier releases. Also
+ * checks the statistics reported by memPoolGetStats. Built with
+ * MEM_POOL_SUPPORT enabled (see demo/posix/Makefile)
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include "tcp_ip_stack.h"
+#include "tcp_ip_stack_mem.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Number of iterations of each pattern
+#define BENCH_ITERATIONS 2000000
+
+//Check memory pool configuration
+#if (MEM_POOL_SUPPORT != ENABLED || MEM_POOL_SMALL_BUFFER_COUNT == 0)
+   #error The benchmark requires both size classes
+#endif
+
+//Reference allocator (linear scan of a flag table)
+static uint64_t refPool[MEM_POOL_BUFFER_COUNT][(MEM_POOL_BUFFER_SIZE + 7) / 8];
+static bool_t refPoolAllocTable[MEM_POOL_BUFFER_COUNT];
+
+//Buffers held between allocations
+static void *heldBuffer[MEM_POOL_BUFFER_COUNT + MEM_POOL_SMALL_BUFFER_COUNT];
+
+
+/**
+ * @brief Reference allocation (first free entry of the table)
+ **/
+
+static void *refPoolAlloc(size_t size)
+{
+   uint_t i;
+   void *p = NULL;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Enforce block size
+   if(size <= MEM_POOL_BUFFER_SIZE)
+   {
+      //Loop through allocation table
+      for(i = 0; i < MEM_POOL_BUFFER_COUNT; i++)
+      {
+         //Check whether the current block is free
+         if(!refPoolAllocTable[i])
+         {
+            //Mark the current entry as used
+            refPoolAllocTable[i] = TRUE;
+            p = refPool[i];
+            break;
+         }
+      }
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+   //Return a pointer to the allocated memory block
+   return p;
+}
+
+
+/**
+ * @brief Reference release (pointer comparison against every block)
+ **/
+
+static void refPoolFree(void *p)
+{
+   uint_t i;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Loop through allocation table
+   for(i = 0; i < MEM_POOL_BUFFER_COUNT; i++)
+   {
+      if(refPool[i] == p)
+      {
+         //Mark the current block as free
+         refPoolAllocTable[i] = FALSE;
+         break;
+      }
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Allocate a block with the pools or with the reference allocator
+ **/
+
+static void *benchAlloc(bool_t reference, size_t size)
+{
+   //The reference allocator only has full-size blocks
+   if(reference)
+      return refPoolAlloc(MEM_POOL_BUFFER_SIZE);
+   else
+      return memPoolAlloc(size);
+}
+
+
+/**
+ * @brief Release a block
+ **/
+
+static void benchFree(bool_t reference, void *p)
+{
+   if(reference)
+      refPoolFree(p);
+   else
+      memPoolFree(p);
+}
+
+
+/**
+ * @brief Time an allocation pattern
+ * @param[in] reference Use the reference allocator
+ * @param[in] held Number of full-size buffers held while the pattern runs
+ * @param[in] size Size of the blocks allocated by the pattern
+ * @return Nanoseconds per allocation/release pair
+ **/
+
+static double benchPattern(bool_t reference, uint_t held, size_t size)
+{
+   uint_t i;
+   uint64_t time;
+   void *p;
+
+   //Occupy part of the pool, as sockets and queues would
+   for(i = 0; i < held; i++)
+      heldBuffer[i] = benchAlloc(reference, MEM_POOL_BUFFER_SIZE);
+
+   //Start of the measurement
+   time = benchGetTime();
+
+   //Allocate and release a buffer, like the RX path does for each frame
+   for(i = 0; i < BENCH_ITERATIONS; i++)
+   {
+      p = benchAlloc(reference, size);
+      //Allocation failure?
+      if(!p) break;
+      benchFree(reference, p);
+   }
+
+   //End of the measurement
+   time = benchGetTime() - time;
+
+   //Release the buffers
+   for(i = 0; i < held; i++)
+      benchFree(reference, heldBuffer[i]);
+
+   //Return the average time of each iteration
+   return (double) time / BENCH_ITERATIONS;
+}
+
+
+/**
+ * @brief Time a burst pattern
+ *
+ * A burst of frames is received and queued, then the queue drains
+ * in arrival order (worst case for a pointer comparison on release)
+ *
+ * @param[in] reference Use the reference allocator
+ * @return Nanoseconds per allocation/release pair
+ **/
+
+static double benchBurst(bool_t reference)
+{
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   uint64_t time;
+
+   //Size of each burst
+   n = MEM_POOL_BUFFER_COUNT;
+
+   //Start of the measurement
+   time = benchGetTime();
+
+   //Repeat the burst
+   for(i = 0; i < BENCH_ITERATIONS / n; i++)
+   {
+      //Receive a burst of frames
+      for(j = 0; j < n; j++)
+         heldBuffer[j] = benchAlloc(reference, MEM_POOL_BUFFER_SIZE);
+      //Process the queue in order
+      for(j = 0; j < n; j++)
+         benchFree(reference, heldBuffer[j]);
+   }
+
+   //End of the measurement
+   time = benchGetTime() - time;
+
+   //Return the average time of each allocation/release pair
+   return (double) time / (i * n);
+}
+
+
+/**
+ * @brief Check the statistics of both size classes
+ * @return Error code
+ **/
+
+static error_t checkStats(void)
+{
+   uint_t i;
+   void *p;
+   MemPoolStats small;
+   MemPoolStats large;
+
+   //Exhaust the small class
+   for(i = 0; i < MEM_POOL_SMALL_BUFFER_COUNT; i++)
+      heldBuffer[i] = memPoolAlloc(MEM_POOL_SMALL_BUFFER_SIZE);
+
+   //The next small request spills over to the large class
+   p = memPoolAlloc(MEM_POOL_SMALL_BUFFER_SIZE);
+
+   //Retrieve statistics
+   memPoolGetStats(0, &small);
+   memPoolGetStats(1, &large);
+
+   //A spill is not a failure
+   if(!p || small.spillCount != 1 || small.failCount != 0 || large.usedCount != 1)
+      return ERROR_FAILURE;
+
+   //Exhaust the large class
+   for(i = 1; i < MEM_POOL_BUFFER_COUNT; i++)
+      heldBuffer[MEM_POOL_SMALL_BUFFER_COUNT + i] = memPoolAlloc(MEM_POOL_BUFFER_SIZE);
+
+   //Neither class can serve these requests
+   if(memPoolAlloc(MEM_POOL_SMALL_BUFFER_SIZE) || memPoolAlloc(MEM_POOL_BUFFER_SIZE))
+      return ERROR_FAILURE;
+
+   //Retrieve statistics
+   memPoolGetStats(0, &small);
+   memPoolGetStats(1, &large);
+
+   //Each failure is accounted to the class that was asked for
+   if(small.failCount != 1 || small.spillCount != 1 || large.failCount != 1 ||
+      large.spillCount != 0 || large.highWaterMark != MEM_POOL_BUFFER_COUNT)
+   {
+      return ERROR_FAILURE;
+   }
+
+   //Release everything
+   for(i = 0; i < MEM_POOL_SMALL_BUFFER_COUNT; i++)
+      memPoolFree(heldBuffer[i]);
+   for(i = 1; i < MEM_POOL_BUFFER_COUNT; i++)
+      memPoolFree(heldBuffer[MEM_POOL_SMALL_BUFFER_COUNT + i]);
+   memPoolFree(p);
+
+   //Retrieve statistics
+   memPoolGetStats(0, &small);
+   memPoolGetStats(1, &large);
+
+   //All the blocks must be back in the pools
+   if(small.usedCount != 0 || large.usedCount != 0)
+      return ERROR_FAILURE;
+
+   //Successful test
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   uint_t held;
+
+   //Initialize debug output
+   debugInit();
+   //Initialize the pools
+   memPoolInit();
+
+   //Check statistics first, while the counters are still zero
+   error = checkStats();
+   //Display result
+   printf("Statistics (spill and failure accounting): %s\r\n", error ? "FAILED" : "OK");
+
+   //Display header
+   printf("\r\n%u blocks of %u bytes, %u blocks of %u bytes\r\n",
+      MEM_POOL_BUFFER_COUNT, MEM_POOL_BUFFER_SIZE,
+      MEM_POOL_SMALL_BUFFER_COUNT, MEM_POOL_SMALL_BUFFER_SIZE);
+   printf("%-36s %12s %12s\r\n", "Pattern (ns per alloc/free)", "linear scan", "size classes");
+
+   //Full frames, with a growing number of buffers held
+   for(held = 0; held < MEM_POOL_BUFFER_COUNT; held += MEM_POOL_BUFFER_COUNT / 4)
+   {
+      printf("Full-size frame, %2u blocks held      %12.1f %12.1f\r\n", held,
+         benchPattern(TRUE, held, MEM_POOL_BUFFER_SIZE),
+         benchPattern(FALSE, held, MEM_POOL_BUFFER_SIZE));
+   }
+
+   //Bare ACKs, with most of the pool in use
+   held = MEM_POOL_BUFFER_COUNT * 3 / 4;
+   printf("Bare ACK, %2u blocks held             %12.1f %12.1f\r\n", held,
+      benchPattern(TRUE, held, MEM_POOL_SMALL_BUFFER_SIZE),
+      benchPattern(FALSE, held, MEM_POOL_SMALL_BUFFER_SIZE));
+
+   //Bursts
+   printf("Burst of %2u frames, FIFO release     %12.1f %12.1f\r\n", MEM_POOL_BUFFER_COUNT,
+      benchBurst(TRUE), benchBurst(FALSE));
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
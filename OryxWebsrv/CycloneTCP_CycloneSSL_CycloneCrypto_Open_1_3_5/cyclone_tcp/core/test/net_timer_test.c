@@ -0,0 +1,416 @@
+/**
+ * @file net_timer_test.c
+ * @brief Timer wheel test
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The wheel is linked with the mutex, event and tick count functions of
+ * this file instead of the OS port (see demo/posix/Makefile), so that the
+ * tick task can be run against a simulated clock, which starts just before
+ * the 32-bit tick count wraps around. The task first sleeps with no timer
+ * for periods of 2^24 ticks and more, until the tick counter of the wheel
+ * is about to wrap around as well, and a single timer is registered after
+ * each period. Random operations are then applied to 2000 timers, with
+ * delays of up to 5.5 hours so that every level of the wheel is used and
+ * timers are cascaded: timers are scheduled, rescheduled (the earliest
+ * deadline must be kept), cancelled, and rescheduled from their callback.
+ * Every callback must run within one tick after the earliest deadline
+ * registered for its timer, cancelled timers must never fire, and the
+ * wheel must be empty once every deadline has elapsed
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include "tcp_ip_stack.h"
+#include "net_timer.h"
+#include "debug.h"
+
+//Number of timers
+#define TEST_TIMER_COUNT 2000
+//Number of random operations
+#define TEST_OP_COUNT 40000
+//Longest delay (5.5 hours)
+#define TEST_MAX_DELAY 19800000
+//Longest period during which the tick task sleeps with no timer
+#define TEST_MAX_IDLE_PERIOD 0x40000000
+
+
+/**
+ * @brief Timer under test
+ **/
+
+typedef struct
+{
+   NetTimer timer;     ///<Timer wheel entry
+   bool_t pending;     ///<A deadline is outstanding
+   uint32_t deadline;  ///<Earliest deadline registered
+   uint_t fired;       ///<Number of callbacks
+} TestTimer;
+
+
+//Global variables
+static TestTimer testTimer[TEST_TIMER_COUNT];
+static uint32_t testTime;
+static uint32_t testSeed = 1;
+static bool_t testEvent;
+static bool_t testReschedule;
+static uint_t testCallbacks;
+static uint_t failures;
+
+//Dummy handles of the mutex and the event
+static uint8_t testMutex;
+static uint8_t testEventHandle;
+
+
+/**
+ * @brief Simulated tick count
+ * @return Current time, in milliseconds
+ **/
+
+time_t osGetTickCount(void)
+{
+   return testTime;
+}
+
+
+/**
+ * @brief Mutex of the wheel (the test runs in a single task)
+ **/
+
+OsMutex *osMutexCreate(bool_t initialOwner)
+{
+   return &testMutex;
+}
+
+void osMutexClose(OsMutex *mutex)
+{
+}
+
+void osMutexAcquire(OsMutex *mutex)
+{
+}
+
+void osMutexRelease(OsMutex *mutex)
+{
+}
+
+
+/**
+ * @brief Event used to wake up the tick task
+ **/
+
+OsEvent *osEventCreate(bool_t manualReset, bool_t initialState)
+{
+   return &testEventHandle;
+}
+
+void osEventClose(OsEvent *event)
+{
+}
+
+void osEventSet(OsEvent *event)
+{
+   testEvent = TRUE;
+}
+
+bool_t osEventWait(OsEvent *event, time_t timeout)
+{
+   return FALSE;
+}
+
+
+/**
+ * @brief Pseudo-random number generator (xorshift)
+ * @return Random value
+ **/
+
+static uint32_t testRand(void)
+{
+   testSeed ^= testSeed << 13;
+   testSeed ^= testSeed >> 17;
+   testSeed ^= testSeed << 5;
+   return testSeed;
+}
+
+
+/**
+ * @brief Random delay, uniform over a random number of decimal digits
+ * @return Delay in milliseconds
+ **/
+
+static time_t testRandDelay(void)
+{
+   uint_t i;
+   uint32_t range;
+
+   //From a few milliseconds up to several hours
+   for(range = 10, i = testRand() % 8; i > 0; i--)
+      range *= 10;
+
+   //Return a delay within the range
+   return testRand() % (min(range, TEST_MAX_DELAY) + 1);
+}
+
+
+/**
+ * @brief Register a deadline and keep track of the earliest one
+ * @param[in] t Timer to schedule
+ * @param[in] delay Delay in milliseconds
+ **/
+
+static void testSchedule(TestTimer *t, time_t delay)
+{
+   //Expected deadline
+   if(!t->pending || timeCompare(testTime + delay, t->deadline) < 0)
+      t->deadline = testTime + delay;
+
+   t->pending = TRUE;
+
+   //Register the deadline with the wheel
+   netTimerSchedule(&t->timer, delay);
+}
+
+
+/**
+ * @brief Timer callback
+ * @param[in] param Timer under test
+ **/
+
+static void testCallback(void *param)
+{
+   int32_t late;
+   TestTimer *t = param;
+
+   //One more callback
+   t->fired++;
+   testCallbacks++;
+
+   //Time elapsed since the earliest deadline
+   late = timeCompare(testTime, t->deadline);
+
+   //The timer must be pending and fire within one tick after its deadline
+   if(!t->pending || late < 0 || late > NET_TIMER_RESOLUTION)
+   {
+      printf("Timer %u fired at %u (deadline %u, %s)\r\n",
+         (uint_t) (t - testTimer), (uint_t) testTime, (uint_t) t->deadline,
+         t->pending ? "pending" : "not pending");
+      failures++;
+   }
+
+   //The deadline has been reached
+   t->pending = FALSE;
+
+   //Some timers are rescheduled from their callback
+   if(testReschedule && (testRand() % 4) == 0)
+      testSchedule(t, testRandDelay());
+}
+
+
+/**
+ * @brief Run the tick task
+ *
+ * The task runs once the event has been set, or when the clock reaches
+ * the wake-up time given by the previous run
+ *
+ * @param[in] time Time until which the task runs
+ * @param[in,out] wakeTime Time at which the task is going to wake up
+ * @param[in,out] idle The task sleeps with no deadline
+ **/
+
+static void testRunTask(uint32_t time, uint32_t *wakeTime, bool_t *idle)
+{
+   time_t delay;
+
+   //Loop until the clock reaches the specified time
+   while(1)
+   {
+      //The event wakes up the task immediately
+      if(!testEvent)
+      {
+         //Nothing to do before the specified time?
+         if(*idle || timeCompare(*wakeTime, time) > 0)
+            break;
+
+         //Advance the clock to the wake-up time
+         testTime = *wakeTime;
+      }
+
+      //The event is reset when the task wakes up
+      testEvent = FALSE;
+
+      //Invoke the callbacks of the expired timers
+      delay = netTimerProcess();
+
+      //Save the time at which the task is going to wake up
+      *idle = (delay == INFINITE_DELAY);
+      *wakeTime = testTime + delay;
+   }
+
+   //Advance the clock to the specified time
+   testTime = time;
+}
+
+
+/**
+ * @brief Check that the wheel agrees with the expected state of each timer
+ **/
+
+static void testCheckPending(void)
+{
+   uint_t i;
+
+   //Loop through the timers
+   for(i = 0; i < TEST_TIMER_COUNT; i++)
+   {
+      if(netTimerPending(&testTimer[i].timer) != testTimer[i].pending)
+      {
+         printf("Timer %u: wrong pending state\r\n", i);
+         failures++;
+      }
+   }
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   bool_t idle;
+   uint32_t time;
+   uint32_t wakeTime;
+   uint64_t elapsed;
+   uint64_t target;
+   TestTimer *t;
+
+   //Initialize debug output
+   debugInit();
+
+   //The 32-bit tick count wraps around after one minute
+   testTime = 0xFFFFFFFF - 60000;
+
+   //Initialize the wheel
+   error = netTimerInit();
+   //Any error to report?
+   if(error)
+      return EXIT_FAILURE;
+
+   //Initialize the timers
+   for(i = 0; i < TEST_TIMER_COUNT; i++)
+      netTimerSetup(&testTimer[i].timer, testCallback, &testTimer[i]);
+
+   //The task has not run yet
+   idle = FALSE;
+   wakeTime = testTime;
+   testRunTask(testTime, &wakeTime, &idle);
+
+   //The tick counter of the wheel is to wrap around about 2^19 ticks after
+   //the last idle period
+   target = ((1ULL << 32) - (1UL << 19)) * NET_TIMER_RESOLUTION;
+
+   //The tick task sleeps with no timer, then a single deadline is registered
+   for(elapsed = 0, n = 0; elapsed < target; n++)
+   {
+      //Start of the period
+      time = testTime;
+
+      //The first period is 2^24 ticks long
+      if(n == 0)
+         testTime += (NET_TIMER_MAX_TICKS + 1) * NET_TIMER_RESOLUTION;
+      else
+         testTime += min(target - elapsed, TEST_MAX_IDLE_PERIOD);
+
+      //Register a deadline
+      testSchedule(&testTimer[0], 1 + testRand() % 60000);
+      //The task runs until the timer has fired
+      testRunTask(testTimer[0].deadline + NET_TIMER_RESOLUTION, &wakeTime, &idle);
+
+      //The wheel must be empty again
+      if(testTimer[0].fired != (n + 1) || !idle)
+      {
+         printf("Timer 0 did not fire after idle period %u\r\n", n);
+         failures++;
+         break;
+      }
+
+      //Total time elapsed since the wheel was initialized
+      elapsed += (uint32_t) (testTime - time);
+   }
+
+   //Callbacks may now reschedule their timer
+   testReschedule = TRUE;
+
+   //Random operations
+   for(n = 0; n < TEST_OP_COUNT; n++)
+   {
+      //Time passes
+      testRunTask(testTime + testRand() % 1000, &wakeTime, &idle);
+
+      //Pick a timer
+      t = &testTimer[testRand() % TEST_TIMER_COUNT];
+
+      //Schedule or cancel it
+      if((testRand() % 4) != 0)
+      {
+         testSchedule(t, testRandDelay());
+      }
+      else
+      {
+         netTimerCancel(&t->timer);
+         t->pending = FALSE;
+      }
+
+      //Check the state of the timers from time to time
+      if((n % 1000) == 0)
+         testCheckPending();
+   }
+
+   //Wait for the remaining deadlines, until no timer is rescheduled
+   for(n = 0; !idle && n < 1000; n++)
+      testRunTask(testTime + TEST_MAX_DELAY + NET_TIMER_RESOLUTION, &wakeTime, &idle);
+
+   //The wheel must be empty
+   testCheckPending();
+
+   if(!idle)
+   {
+      printf("The tick task still has a deadline\r\n");
+      failures++;
+   }
+
+   //Display result
+   printf("Timer wheel (%u timers, %u callbacks): %s\r\n", TEST_TIMER_COUNT,
+      testCallbacks, failures ? "FAILED" : "OK");
+
+   //Return status code
+   return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file tcp_congestion_sim.c
+ * @brief Congestion control simulation
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Bulk transfers are run over the lossy link with each congestion control
+ * algorithm, under two link models: random losses on a path with spare
+ * capacity, and a bottleneck whose queue is smaller than the bandwidth-delay
+ * product, so that losses are caused by the sender itself. Random losses
+ * only depend on the seed and on the offset in the stream, hence every
+ * algorithm faces the same loss pattern. The goodput and the loss recovery
+ * statistics of the sender are reported. The link runs in real time, so
+ * the figures vary slightly from one run to another
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include "tcp_ip_stack.h"
+#include "lossy_link.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Default amount of data per transfer
+#define BENCH_SIZE (4 * 1024 * 1024)
+
+
+/**
+ * @brief Link model of a scenario
+ **/
+
+typedef struct
+{
+   const char_t *name;
+   LossyLinkSettings settings;
+} SimScenario;
+
+
+/**
+ * @brief Congestion control algorithm
+ **/
+
+typedef struct
+{
+   const char_t *name;
+   TcpCongestionControl algo;
+} SimAlgo;
+
+
+//Link models (delay, rate, queue size, loss rate, seed)
+static const SimScenario scenario[] =
+{
+   {"random loss 0.2%", {25, 12500000, 1024, 20, 1}},
+   {"drop-tail queue", {25, 2500000, 32, 0, 1}}
+};
+
+//Algorithms to compare
+static const SimAlgo algo[] =
+{
+   {"NewReno", TCP_CONGESTION_CONTROL_NEW_RENO},
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+   {"CUBIC", TCP_CONGESTION_CONTROL_CUBIC}
+#endif
+};
+
+
+/**
+ * @brief Run a bulk transfer
+ * @param[in] scenario Link model
+ * @param[in] algo Congestion control algorithm of the sender
+ * @param[in] length Number of bytes to transfer
+ * @return Error code
+ **/
+
+static error_t simTransfer(const SimScenario *scenario, const SimAlgo *algo, size_t length)
+{
+   error_t error;
+   LossyLinkStats stats;
+   LossyLinkTransfer transfer;
+
+   //Apply the link model
+   lossyLinkConfig(&scenario->settings);
+
+   //Transfer the data
+   error = lossyLinkTransfer(algo->algo, length, &transfer);
+   //Retrieve link statistics
+   lossyLinkGetStats(&stats);
+
+   //Display results
+   printf("%-18s %-8s %8.2f %6u %6u %7u %9u %10u %6s\r\n", scenario->name, algo->name,
+      benchMbps(transfer.length, transfer.time), stats.lossDrops + stats.queueDrops,
+      transfer.stats.retransmits, transfer.stats.timeouts,
+      transfer.stats.fastRecoveries + transfer.stats.sackRecoveries,
+      transfer.srtt, error ? "FAILED" : "OK");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Main entry point
+ * @param[in] argc Number of arguments
+ * @param[in] argv Number of bytes per transfer (optional)
+ * @return Exit status
+ **/
+
+int_t main(int_t argc, char_t *argv[])
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   size_t length;
+
+   //Amount of data per transfer
+   length = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_SIZE;
+
+   //Initialize debug output
+   debugInit();
+
+   //Bring up the lossy link
+   error = lossyLinkStart(&scenario[0].settings);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the lossy link!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Display header
+   printf("%u KB per transfer\r\n%-18s %-8s %8s %6s %6s %7s %9s %10s %6s\r\n",
+      (uint_t) (length / 1024), "Link", "Algo", "MB/s", "lost", "resent",
+      "timeouts", "recoveries", "srtt(ms)", "Check");
+
+   //Run each algorithm under each link model
+   for(error = NO_ERROR, i = 0; !error && i < arraysize(scenario); i++)
+   {
+      for(j = 0; !error && j < arraysize(algo); j++)
+         error = simTransfer(&scenario[i], &algo[j], length);
+   }
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
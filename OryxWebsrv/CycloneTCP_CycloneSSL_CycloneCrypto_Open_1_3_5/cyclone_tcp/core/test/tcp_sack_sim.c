@@ -0,0 +1,146 @@
+/**
+ * @file tcp_sack_sim.c
+ * @brief Loss recovery simulation
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Bulk transfers are run over the lossy link at increasing loss rates, so
+ * that windows with several losses become common. The program is built
+ * once with SACK (selective retransmission of the holes) and once without
+ * (retransmission from the first unacknowledged segment), see
+ * demo/posix/Makefile. For each lost segment, the link measures the time
+ * from the loss to the acknowledgment that covers it. The average and
+ * maximum recovery times are reported, together with the goodput and the
+ * number of segments sent again
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include "tcp_ip_stack.h"
+#include "lossy_link.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Default amount of data per transfer
+#define BENCH_SIZE (2 * 1024 * 1024)
+
+//Loss recovery being measured
+#if (TCP_SACK_SUPPORT == ENABLED)
+   #define BENCH_RECOVERY "SACK"
+#else
+   #define BENCH_RECOVERY "go-back"
+#endif
+
+//Loss rates (per 10000)
+static const uint_t lossRate[] = {50, 200};
+
+
+/**
+ * @brief Run a bulk transfer
+ * @param[in] settings Link model
+ * @param[in] length Number of bytes to transfer
+ * @return Error code
+ **/
+
+static error_t simTransfer(const LossyLinkSettings *settings, size_t length)
+{
+   error_t error;
+   LossyLinkStats stats;
+   LossyLinkTransfer transfer;
+
+   //Apply the link model
+   lossyLinkConfig(settings);
+
+   //Transfer the data
+   error = lossyLinkTransfer(TCP_CONGESTION_CONTROL_NEW_RENO, length, &transfer);
+   //Retrieve link statistics
+   lossyLinkGetStats(&stats);
+
+   //Display results
+   printf("%-8s %5.1f%% %8.2f %6u %6u %8u %9.0f %9.0f %6s\r\n", BENCH_RECOVERY,
+      settings->lossRate / 100.0, benchMbps(transfer.length, transfer.time),
+      stats.lossDrops, stats.resentSegments, transfer.stats.timeouts,
+      stats.recoveries ? stats.recoveryTime / 1e6 / stats.recoveries : 0.0,
+      stats.maxRecoveryTime / 1e6, error ? "FAILED" : "OK");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Main entry point
+ * @param[in] argc Number of arguments
+ * @param[in] argv Number of bytes per transfer (optional)
+ * @return Exit status
+ **/
+
+int_t main(int_t argc, char_t *argv[])
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   LossyLinkSettings settings;
+
+   //Amount of data per transfer
+   length = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_SIZE;
+
+   //Initialize debug output
+   debugInit();
+
+   //50 ms path with spare capacity
+   settings.delay = 25;
+   settings.rate = 12500000;
+   settings.queueSize = 1024;
+   settings.lossRate = 0;
+   settings.seed = 1;
+
+   //Bring up the lossy link
+   error = lossyLinkStart(&settings);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the lossy link!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Display header
+   printf("%u KB per transfer, RTT %u ms\r\n%-8s %6s %8s %6s %6s %8s %9s %9s %6s\r\n",
+      (uint_t) (length / 1024), 2 * settings.delay, "Recovery", "loss", "MB/s", "lost",
+      "resent", "timeouts", "avg(ms)", "max(ms)", "Check");
+
+   //Run a transfer for each loss rate
+   for(error = NO_ERROR, i = 0; !error && i < arraysize(lossRate); i++)
+   {
+      settings.lossRate = lossRate[i];
+      error = simTransfer(&settings, length);
+   }
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file tcp_wnd_scale_bench.c
+ * @brief TCP goodput over a long-delay path
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * A bulk transfer is run over a lossy link with a 100 ms round-trip time
+ * and a 100 Mbit/s bottleneck, whose bandwidth-delay product is well
+ * beyond 64 KB. The program is built once without window scaling and
+ * timestamps (64 KB buffers) and once with both options (1 MB buffers,
+ * see demo/posix/Makefile). The goodput is reported with and without
+ * losses, together with the RTT estimate and the RTO of the sender
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include "tcp_ip_stack.h"
+#include "lossy_link.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Default amount of data per transfer
+#define BENCH_SIZE (4 * 1024 * 1024)
+
+//TCP options being measured
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED && TCP_TIMESTAMP_SUPPORT == ENABLED)
+   #define BENCH_OPTIONS "WS+TS"
+#elif (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+   #define BENCH_OPTIONS "WS"
+#elif (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   #define BENCH_OPTIONS "TS"
+#else
+   #define BENCH_OPTIONS "none"
+#endif
+
+//Loss rates (per 10000)
+static const uint_t lossRate[] = {0, 10};
+
+
+/**
+ * @brief Run a bulk transfer
+ * @param[in] settings Link model
+ * @param[in] length Number of bytes to transfer
+ * @return Error code
+ **/
+
+static error_t benchTransfer(const LossyLinkSettings *settings, size_t length)
+{
+   error_t error;
+   LossyLinkStats stats;
+   LossyLinkTransfer transfer;
+
+   //Apply the link model
+   lossyLinkConfig(settings);
+
+   //Transfer the data
+   error = lossyLinkTransfer(TCP_CONGESTION_CONTROL_NEW_RENO, length, &transfer);
+   //Retrieve link statistics
+   lossyLinkGetStats(&stats);
+
+   //Display results
+   printf("%-7s %8u %6.1f%% %10.2f %7u %8u %8u %8u %6s\r\n", BENCH_OPTIONS,
+      TCP_DEFAULT_RX_BUFFER_SIZE / 1024, settings->lossRate / 100.0,
+      benchMbps(transfer.length, transfer.time), stats.lossDrops,
+      transfer.stats.retransmits, transfer.srtt, transfer.rto, error ? "FAILED" : "OK");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Main entry point
+ * @param[in] argc Number of arguments
+ * @param[in] argv Number of bytes per transfer (optional)
+ * @return Exit status
+ **/
+
+int_t main(int_t argc, char_t *argv[])
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   LossyLinkSettings settings;
+
+   //Amount of data per transfer
+   length = (argc > 1) ? strtoul(argv[1], NULL, 10) : BENCH_SIZE;
+
+   //Initialize debug output
+   debugInit();
+
+   //Long-delay path
+   settings.delay = 50;
+   settings.rate = 12500000;
+   settings.queueSize = 1024;
+   settings.lossRate = 0;
+   settings.seed = 1;
+
+   //Bring up the lossy link
+   error = lossyLinkStart(&settings);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the lossy link!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Display header
+   printf("%u KB per transfer, RTT %u ms, bottleneck %u Mbit/s\r\n", (uint_t) (length / 1024),
+      2 * settings.delay, settings.rate / 125000);
+   printf("%-7s %8s %7s %10s %7s %8s %8s %8s %6s\r\n", "Options", "rwnd(KB)", "loss",
+      "MB/s", "lost", "resent", "srtt(ms)", "rto(ms)", "Check");
+
+   //Run a transfer for each loss rate
+   for(error = NO_ERROR, i = 0; !error && i < arraysize(lossRate); i++)
+   {
+      settings.lossRate = lossRate[i];
+      error = benchTransfer(&settings, length);
+   }
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
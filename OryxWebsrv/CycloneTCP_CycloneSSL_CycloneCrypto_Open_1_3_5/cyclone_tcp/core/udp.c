@@ -93,6 +93,8 @@ error_t udpProcessDatagram(NetInterface *interface,
       {
          //Debug message
          TRACE_WARNING("Wrong UDP header checksum!\r\n");
+         //Update statistics
+         interface->stats.checksumErrors++;
          //Report an error
          return ERROR_WRONG_CHECKSUM;
       }
@@ -101,91 +103,12 @@ error_t udpProcessDatagram(NetInterface *interface,
    //Enter critical section
    osMutexAcquire(socketMutex);
 
-   //Loop through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
-   {
-      //Point to the current socket
-      socket = socketTable + i;
-
-      //UDP socket found?
-      if(socket->type != SOCKET_TYPE_DGRAM)
-         continue;
-      //Check whether the socket is bound to a particular interface
-      if(socket->interface && socket->interface != interface)
-         continue;
-      //Check destination port number
-      if(socket->localPort != ntohs(header->destPort))
-         continue;
-      //Source port number filtering
-      if(socket->remotePort && socket->remotePort != ntohs(header->srcPort))
-         continue;
-
-#if (IPV4_SUPPORT == ENABLED)
-      //An IPv4 packet was received?
-      if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
-      {
-         //Destination IP address filtering
-         if(socket->localIpAddr.length)
-         {
-            //An IPv4 address is expected
-            if(socket->localIpAddr.length != sizeof(Ipv4Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(socket->localIpAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
-               continue;
-         }
-         //Source IP address filtering
-         if(socket->remoteIpAddr.length)
-         {
-            //An IPv4 address is expected
-            if(socket->remoteIpAddr.length != sizeof(Ipv4Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(socket->remoteIpAddr.ipv4Addr != pseudoHeader->ipv4Data.srcAddr)
-               continue;
-         }
-      }
-      else
-#endif
-#if (IPV6_SUPPORT == ENABLED)
-      //An IPv6 packet was received?
-      if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
-      {
-         //Destination IP address filtering
-         if(socket->localIpAddr.length)
-         {
-            //An IPv6 address is expected
-            if(socket->localIpAddr.length != sizeof(Ipv6Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(!ipv6CompAddr(&socket->localIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
-               continue;
-         }
-         //Source IP address filtering
-         if(socket->remoteIpAddr.length)
-         {
-            //An IPv6 address is expected
-            if(socket->remoteIpAddr.length != sizeof(Ipv6Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(!ipv6CompAddr(&socket->remoteIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.srcAddr))
-               continue;
-         }
-      }
-      else
-#endif
-      //An invalid packet was received?
-      {
-         //This should never occur...
-         continue;
-      }
-
-      //The current socket meets all the criteria
-      break;
-   }
+   //Find the socket the datagram is addressed to
+   socket = socketHashLookup(SOCKET_TYPE_DGRAM, interface, pseudoHeader,
+      ntohs(header->srcPort), ntohs(header->destPort));
 
    //Drop incoming packet if no matching socket was found
-   if(i >= SOCKET_MAX_COUNT)
+   if(!socket)
    {
       //Leave critical section
       osMutexRelease(socketMutex);
@@ -295,6 +218,11 @@ error_t udpProcessDatagram(NetInterface *interface,
    //Notify user that data is available
    udpUpdateEvents(socket);
 
+#if (NET_STATS_SUPPORT == ENABLED)
+   //The datagram has been delivered to the socket
+   netStatsRecordRxLatency(interface);
+#endif
+
    //Leave critical section
    osMutexRelease(socketMutex);
    //Successful processing
@@ -55,6 +55,7 @@ const NicDriver dm9000Driver =
    dm9000SendPacket,
    NULL,
    NULL,
+   NULL,
    TRUE,
    TRUE,
    TRUE
@@ -668,29 +669,6 @@ uint16_t dm9000ReadPhyReg(uint8_t address)
 
 uint32_t dm9000CalcCrc(const void *data, uint_t length)
 {
-   uint_t i;
-   uint_t j;
-
-   //Point to the data over which to calculate the CRC
-   const uint8_t *p = (uint8_t *) data;
-   //CRC preset value
-   uint32_t crc = 0xFFFFFFFF;
-
-   //Loop through data
-   for(i = 0; i < length; i++)
-   {
-      //Update CRC value
-      crc ^= p[i];
-      //The message is processed bit by bit
-      for(j = 0; j < 8; j++)
-      {
-         if(crc & 0x00000001)
-            crc = (crc >> 1) ^ 0xEDB88320;
-         else
-            crc = crc >> 1;
-      }
-   }
-
-   //Return CRC value
-   return crc;
+   //The hash filter uses the Ethernet CRC before final inversion
+   return ~ethCalcCrc(data, length);
 }
@@ -0,0 +1,396 @@
+/**
+ * @file loopback_eth.c
+ * @brief In-memory Ethernet link between two network interfaces
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The driver behaves as a crossover cable between two network interfaces
+ * of the same process. Each frame sent on one end is copied to the receive
+ * ring of the other end, and the RX task of the peer interface is notified.
+ * Together with the POSIX port of the OS abstraction layer, this allows a
+ * client and a server to exchange traffic through the whole stack without
+ * any hardware
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL NIC_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "loopback_eth.h"
+#include "debug.h"
+
+//Context of each link endpoint
+static LoopbackEthContext loopbackEthContext[NET_INTERFACE_COUNT];
+
+//Retrieve the context attached to a network interface
+#define LOOPBACK_ETH_CONTEXT(interface) (&loopbackEthContext[(interface) - netInterface])
+
+
+/**
+ * @brief Loopback Ethernet link
+ **/
+
+const NicDriver loopbackEthDriver =
+{
+   loopbackEthInit,
+   loopbackEthTick,
+   loopbackEthEnableIrq,
+   loopbackEthDisableIrq,
+   loopbackEthRxEventHandler,
+   loopbackEthSetMacFilter,
+   loopbackEthSendPacket,
+   loopbackEthWritePhyReg,
+   loopbackEthReadPhyReg,
+   NULL,
+   TRUE,
+   TRUE,
+   TRUE
+};
+
+
+/**
+ * @brief Loopback Ethernet link initialization
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t loopbackEthInit(NetInterface *interface)
+{
+   //Point to the context of the link endpoint
+   LoopbackEthContext *context = LOOPBACK_ETH_CONTEXT(interface);
+
+   //Debug message
+   TRACE_INFO("Initializing loopback Ethernet link...\r\n");
+
+   //Get exclusive access to the receive ring
+   osTaskSuspendAll();
+
+   //Flush the receive ring
+   context->rxReadIndex = 0;
+   context->rxCount = 0;
+   //Clear statistics
+   memset(&context->stats, 0, sizeof(LoopbackEthStats));
+
+   //The link is up as soon as a peer is attached
+   interface->linkState = (context->peer != NULL);
+   interface->speed100 = TRUE;
+   interface->fullDuplex = TRUE;
+   //Report the link state to the TCP/IP stack
+   context->linkEvent = TRUE;
+
+   //Release exclusive access to the receive ring
+   osTaskResumeAll();
+
+   //Force the TCP/IP stack to check the link state
+   osEventSet(interface->nicRxEvent);
+   //The link is now ready to send
+   osEventSet(interface->nicTxEvent);
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Loopback Ethernet link timer handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void loopbackEthTick(NetInterface *interface)
+{
+   //No periodic operation
+}
+
+
+/**
+ * @brief Enable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void loopbackEthEnableIrq(NetInterface *interface)
+{
+   //Frames are delivered by the peer interface
+}
+
+
+/**
+ * @brief Disable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void loopbackEthDisableIrq(NetInterface *interface)
+{
+   //Frames are delivered by the peer interface
+}
+
+
+/**
+ * @brief Loopback Ethernet link event handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void loopbackEthRxEventHandler(NetInterface *interface)
+{
+   uint_t i;
+   LoopbackEthFrame *frame;
+   LoopbackEthContext *context;
+
+   //Point to the context of the link endpoint
+   context = LOOPBACK_ETH_CONTEXT(interface);
+
+   //Link state change pending?
+   if(context->linkEvent)
+   {
+      //Acknowledge the event by clearing the flag
+      context->linkEvent = FALSE;
+      //Process link state change event
+      nicNotifyLinkChange(interface);
+   }
+
+   //Process all the pending frames
+   while(context->rxCount > 0)
+   {
+      //Point to the oldest frame in the receive ring
+      i = context->rxReadIndex;
+      frame = &context->rxFrame[i];
+
+      //Pass the packet to the upper layer. The ring is unlocked while the
+      //frame is processed, but the peer never overwrites an occupied slot
+      nicProcessPacket(interface, frame->data, frame->length);
+
+      //Release the slot
+      context->rxReadIndex = (i + 1) % LOOPBACK_ETH_RX_BUFFER_COUNT;
+      context->rxCount--;
+   }
+}
+
+
+/**
+ * @brief Configure multicast MAC address filtering
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t loopbackEthSetMacFilter(NetInterface *interface)
+{
+   //The link delivers all frames to the peer
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send a packet
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+error_t loopbackEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   uint_t i;
+   size_t length;
+   NetInterface *peer;
+   LoopbackEthFrame *frame;
+   LoopbackEthContext *context;
+   LoopbackEthContext *peerContext;
+
+   //Point to the context of the link endpoint
+   context = LOOPBACK_ETH_CONTEXT(interface);
+   //Point to the interface at the other end of the link
+   peer = context->peer;
+
+   //Retrieve the length of the packet
+   length = chunkedBufferGetLength(buffer) - offset;
+
+   //Check the frame length
+   if(length > (LOOPBACK_ETH_RX_BUFFER_SIZE - ETH_CRC_SIZE))
+   {
+      //The transmitter can accept another packet
+      osEventSet(interface->nicTxEvent);
+      //Report an error
+      return ERROR_INVALID_LENGTH;
+   }
+
+   //No peer attached to the link?
+   if(peer == NULL)
+   {
+      //Update statistics
+      context->stats.txDrops++;
+   }
+   else
+   {
+      //Point to the context of the peer
+      peerContext = LOOPBACK_ETH_CONTEXT(peer);
+
+      //Any room left in the receive ring of the peer?
+      if(peerContext->rxCount < LOOPBACK_ETH_RX_BUFFER_COUNT)
+      {
+         //Index of the first free slot
+         i = (peerContext->rxReadIndex + peerContext->rxCount) %
+            LOOPBACK_ETH_RX_BUFFER_COUNT;
+         //Point to the corresponding frame
+         frame = &peerContext->rxFrame[i];
+
+         //Copy user data to the receive buffer of the peer
+         chunkedBufferRead(frame->data, buffer, offset, length);
+
+         //Pad the frame to the minimum size, as the MAC would do
+         if(length < (ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE))
+         {
+            memset(frame->data + length, 0, ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE - length);
+            length = ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE;
+         }
+
+         //The CRC field is not checked by the receiver
+         memset(frame->data + length, 0, ETH_CRC_SIZE);
+         //Received frames include the CRC field
+         frame->length = length + ETH_CRC_SIZE;
+
+         //Append the frame to the receive ring
+         peerContext->rxCount++;
+
+         //Update statistics
+         context->stats.txPackets++;
+         peerContext->stats.rxPackets++;
+
+         //Notify the TCP/IP stack of the peer that a packet has been received
+         osEventSet(peer->nicRxEvent);
+      }
+      else
+      {
+         //The receive ring of the peer is full
+         peerContext->stats.rxOverruns++;
+      }
+   }
+
+   //The transmitter can accept another packet
+   osEventSet(interface->nicTxEvent);
+
+   //Frames are lost silently, as on a real link
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Write PHY register
+ * @param[in] phyAddr PHY address
+ * @param[in] regAddr Register address
+ * @param[in] data Register value
+ **/
+
+void loopbackEthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data)
+{
+   //The loopback link has no PHY
+}
+
+
+/**
+ * @brief Read PHY register
+ * @param[in] phyAddr PHY address
+ * @param[in] regAddr Register address
+ * @return Register value
+ **/
+
+uint16_t loopbackEthReadPhyReg(uint8_t phyAddr, uint8_t regAddr)
+{
+   //The loopback link has no PHY
+   return 0;
+}
+
+
+/**
+ * @brief Connect two network interfaces together
+ *
+ * This function is typically called before the interfaces are configured.
+ * When an interface is already running, its link comes up immediately
+ *
+ * @param[in] interface1 First network interface
+ * @param[in] interface2 Second network interface
+ * @return Error code
+ **/
+
+error_t loopbackEthConnect(NetInterface *interface1, NetInterface *interface2)
+{
+   uint_t i;
+   NetInterface *interface[2];
+
+   //Check parameters
+   if(interface1 == NULL || interface2 == NULL || interface1 == interface2)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the endpoints of the link
+   interface[0] = interface1;
+   interface[1] = interface2;
+
+   //Get exclusive access to the link
+   osTaskSuspendAll();
+
+   //Attach each interface to the other one
+   LOOPBACK_ETH_CONTEXT(interface1)->peer = interface2;
+   LOOPBACK_ETH_CONTEXT(interface2)->peer = interface1;
+
+   //Bring up the link of the interfaces that are already running
+   for(i = 0; i < 2; i++)
+   {
+      //Make sure the interface is configured
+      if(interface[i]->configured && !interface[i]->linkState)
+      {
+         //Update link state
+         interface[i]->linkState = TRUE;
+         //Report the link state to the TCP/IP stack
+         LOOPBACK_ETH_CONTEXT(interface[i])->linkEvent = TRUE;
+         //Notify the RX task
+         osEventSet(interface[i]->nicRxEvent);
+      }
+   }
+
+   //Release exclusive access to the link
+   osTaskResumeAll();
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve loopback link statistics
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Statistics
+ **/
+
+void loopbackEthGetStats(NetInterface *interface, LoopbackEthStats *stats)
+{
+   //Get exclusive access to the statistics
+   osTaskSuspendAll();
+   //Copy statistics
+   *stats = LOOPBACK_ETH_CONTEXT(interface)->stats;
+   //Release exclusive access to the statistics
+   osTaskResumeAll();
+}
@@ -0,0 +1,107 @@
+/**
+ * @file loopback_eth.h
+ * @brief In-memory Ethernet link between two network interfaces
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _LOOPBACK_ETH_H
+#define _LOOPBACK_ETH_H
+
+//Dependencies
+#include "nic.h"
+
+//RX buffers
+#ifndef LOOPBACK_ETH_RX_BUFFER_COUNT
+   #define LOOPBACK_ETH_RX_BUFFER_COUNT 32
+#elif (LOOPBACK_ETH_RX_BUFFER_COUNT < 1)
+   #error LOOPBACK_ETH_RX_BUFFER_COUNT parameter is invalid
+#endif
+
+#define LOOPBACK_ETH_RX_BUFFER_SIZE 1536
+
+
+/**
+ * @brief Frame queued in the receive ring
+ **/
+
+typedef struct
+{
+   size_t length;                              ///<Length of the frame, CRC included
+   uint8_t data[LOOPBACK_ETH_RX_BUFFER_SIZE];  ///<Frame contents
+} LoopbackEthFrame;
+
+
+/**
+ * @brief Loopback link statistics
+ **/
+
+typedef struct
+{
+   uint32_t rxPackets;   ///<Frames received from the peer
+   uint32_t rxOverruns;  ///<Frames dropped because the receive ring was full
+   uint32_t txPackets;   ///<Frames delivered to the peer
+   uint32_t txDrops;     ///<Frames dropped because no peer is attached
+} LoopbackEthStats;
+
+
+/**
+ * @brief Loopback link endpoint
+ **/
+
+typedef struct
+{
+   NetInterface *peer;                                      ///<Interface at the other end of the link
+   bool_t linkEvent;                                        ///<A link state change is pending
+   uint_t rxReadIndex;                                      ///<Index of the oldest frame in the ring
+   uint_t rxCount;                                          ///<Number of frames in the ring
+   LoopbackEthFrame rxFrame[LOOPBACK_ETH_RX_BUFFER_COUNT];  ///<Receive ring
+   LoopbackEthStats stats;                                  ///<Statistics
+} LoopbackEthContext;
+
+
+//Loopback Ethernet link
+extern const NicDriver loopbackEthDriver;
+
+//Loopback Ethernet link related functions
+error_t loopbackEthInit(NetInterface *interface);
+
+void loopbackEthTick(NetInterface *interface);
+
+void loopbackEthEnableIrq(NetInterface *interface);
+void loopbackEthDisableIrq(NetInterface *interface);
+void loopbackEthRxEventHandler(NetInterface *interface);
+
+error_t loopbackEthSetMacFilter(NetInterface *interface);
+
+error_t loopbackEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
+void loopbackEthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
+uint16_t loopbackEthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
+
+error_t loopbackEthConnect(NetInterface *interface1, NetInterface *interface2);
+void loopbackEthGetStats(NetInterface *interface, LoopbackEthStats *stats);
+
+#endif
@@ -0,0 +1,498 @@
+/**
+ * @file sim_eth.c
+ * @brief Simulated Ethernet controller (host testing)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL NIC_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "sim_eth.h"
+#include "debug.h"
+
+//Transmit buffer
+static uint8_t txBuffer[SIM_ETH_TX_BUFFER_COUNT][SIM_ETH_TX_BUFFER_SIZE];
+//Receive buffer
+static uint8_t rxBuffer[SIM_ETH_RX_BUFFER_COUNT][SIM_ETH_RX_BUFFER_SIZE];
+//Spare receive buffers
+static uint8_t rxSpareBuffer[SIM_ETH_RX_SPARE_BUFFER_COUNT][SIM_ETH_RX_BUFFER_SIZE];
+//Transmit DMA descriptors
+static SimEthDmaDesc txDmaDesc[SIM_ETH_TX_BUFFER_COUNT];
+//Receive DMA descriptors
+static SimEthDmaDesc rxDmaDesc[SIM_ETH_RX_BUFFER_COUNT];
+//Pointer to the current TX DMA descriptor
+static SimEthDmaDesc *txCurDmaDesc;
+//Pointer to the current RX DMA descriptor (driver side)
+static SimEthDmaDesc *rxCurDmaDesc;
+//Pointer to the next RX DMA descriptor to be filled (DMA side)
+static SimEthDmaDesc *rxDmaCurDmaDesc;
+//Pool of spare receive buffers that are not attached to any descriptor
+static uint8_t *rxSparePool[SIM_ETH_RX_SPARE_BUFFER_COUNT];
+//Number of buffers in the spare pool
+static uint_t rxSpareCount;
+//A link state change is pending
+static bool_t linkEvent;
+//Callback invoked for each transmitted frame
+static SimEthTxCallback txCallback;
+//Statistics
+static SimEthStats simEthStats;
+
+
+/**
+ * @brief Simulated Ethernet controller
+ **/
+
+const NicDriver simEthDriver =
+{
+   simEthInit,
+   simEthTick,
+   simEthEnableIrq,
+   simEthDisableIrq,
+   simEthRxEventHandler,
+   simEthSetMacFilter,
+   simEthSendPacket,
+   simEthWritePhyReg,
+   simEthReadPhyReg,
+   NULL,
+   TRUE,
+   TRUE,
+   TRUE
+};
+
+
+/**
+ * @brief Simulated Ethernet controller initialization
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t simEthInit(NetInterface *interface)
+{
+   //Debug message
+   TRACE_INFO("Initializing simulated Ethernet controller...\r\n");
+
+   //Initialize DMA descriptor lists
+   simEthInitDmaDesc(interface);
+   //Clear statistics
+   memset(&simEthStats, 0, sizeof(SimEthStats));
+
+   //The simulated link is always up
+   interface->linkState = TRUE;
+   interface->speed100 = TRUE;
+   interface->fullDuplex = TRUE;
+   //Report the link state to the TCP/IP stack
+   linkEvent = TRUE;
+
+   //Force the TCP/IP stack to check the link state
+   osEventSet(interface->nicRxEvent);
+   //The simulated controller is now ready to send
+   osEventSet(interface->nicTxEvent);
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Initialize DMA descriptor lists
+ * @param[in] interface Underlying network interface
+ **/
+
+void simEthInitDmaDesc(NetInterface *interface)
+{
+   uint_t i;
+
+   //Initialize TX DMA descriptor list
+   for(i = 0; i < SIM_ETH_TX_BUFFER_COUNT; i++)
+   {
+      //The descriptor is initially owned by the driver
+      txDmaDesc[i].des0 = 0;
+      //Transmit buffer address
+      txDmaDesc[i].buffer = txBuffer[i];
+      //Next descriptor address
+      txDmaDesc[i].next = &txDmaDesc[(i + 1) % SIM_ETH_TX_BUFFER_COUNT];
+   }
+
+   //Point to the very first descriptor
+   txCurDmaDesc = &txDmaDesc[0];
+
+   //Initialize RX DMA descriptor list
+   for(i = 0; i < SIM_ETH_RX_BUFFER_COUNT; i++)
+   {
+      //The descriptor is initially owned by the DMA
+      rxDmaDesc[i].des0 = SIM_ETH_DES0_OWN;
+      //Receive buffer address
+      rxDmaDesc[i].buffer = rxBuffer[i];
+      //Next descriptor address
+      rxDmaDesc[i].next = &rxDmaDesc[(i + 1) % SIM_ETH_RX_BUFFER_COUNT];
+   }
+
+   //Point to the very first descriptor
+   rxCurDmaDesc = &rxDmaDesc[0];
+   rxDmaCurDmaDesc = &rxDmaDesc[0];
+
+   //All the spare buffers are initially available
+   for(i = 0; i < SIM_ETH_RX_SPARE_BUFFER_COUNT; i++)
+      rxSparePool[i] = rxSpareBuffer[i];
+
+   //Number of buffers in the spare pool
+   rxSpareCount = SIM_ETH_RX_SPARE_BUFFER_COUNT;
+}
+
+
+/**
+ * @brief Simulated Ethernet controller timer handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void simEthTick(NetInterface *interface)
+{
+   //No periodic operation
+}
+
+
+/**
+ * @brief Enable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void simEthEnableIrq(NetInterface *interface)
+{
+   //Interrupts are emulated by simEthInjectFrame
+}
+
+
+/**
+ * @brief Disable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void simEthDisableIrq(NetInterface *interface)
+{
+   //Interrupts are emulated by simEthInjectFrame
+}
+
+
+/**
+ * @brief Simulated Ethernet controller event handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void simEthRxEventHandler(NetInterface *interface)
+{
+   size_t length;
+   uint8_t *frame;
+
+   //Link state change pending?
+   if(linkEvent)
+   {
+      //Acknowledge the event by clearing the flag
+      linkEvent = FALSE;
+      //Process link state change event
+      nicNotifyLinkChange(interface);
+   }
+
+   //Process all the pending packets
+   while(1)
+   {
+      //Borrow the DMA buffer holding the next packet
+      length = simEthLoanRxBuffer(interface, &frame);
+      //No packet is pending in the receive buffer?
+      if(!length) break;
+
+      //Pass the packet to the upper layer
+      nicProcessPacket(interface, frame, length);
+
+      //The upper layer is done with the packet
+      simEthReleaseRxBuffer(interface, frame);
+   }
+}
+
+
+/**
+ * @brief Configure multicast MAC address filtering
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t simEthSetMacFilter(NetInterface *interface)
+{
+   //The simulated controller accepts all frames
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send a packet
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+error_t simEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   //Retrieve the length of the packet
+   size_t length = chunkedBufferGetLength(buffer) - offset;
+
+   //Check the frame length
+   if(length > SIM_ETH_TX_BUFFER_SIZE)
+   {
+      //The transmitter can accept another packet
+      osEventSet(interface->nicTxEvent);
+      //Report an error
+      return ERROR_INVALID_LENGTH;
+   }
+
+   //Make sure the current buffer is available for writing
+   if(txCurDmaDesc->des0 & SIM_ETH_DES0_OWN)
+      return ERROR_FAILURE;
+
+   //Copy user data to the transmit buffer
+   chunkedBufferRead(txCurDmaDesc->buffer, buffer, offset, length);
+   //Give the ownership of the descriptor to the DMA
+   txCurDmaDesc->des0 = SIM_ETH_DES0_OWN | SIM_ETH_DES0_FS |
+      SIM_ETH_DES0_LS | ((length << 16) & SIM_ETH_DES0_FL);
+
+   //The simulated DMA transmits the frame immediately
+   if(txCallback != NULL)
+      txCallback(interface, txCurDmaDesc->buffer, length);
+
+   //Update statistics
+   simEthStats.txPackets++;
+   //The DMA releases the descriptor
+   txCurDmaDesc->des0 = 0;
+
+   //Point to the next descriptor in the list
+   txCurDmaDesc = txCurDmaDesc->next;
+
+   //The transmitter can accept another packet
+   osEventSet(interface->nicTxEvent);
+
+   //Data successfully written
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Borrow the DMA buffer holding the next received packet
+ *
+ * Same semantics as the STM32F4x7 driver: the buffer is detached from
+ * its descriptor, which is re-armed with a spare buffer. The caller
+ * must hand the buffer back with simEthReleaseRxBuffer(). As with the
+ * other driver callbacks, the caller holds exclusive access to the device
+ *
+ * @param[in] interface Underlying network interface
+ * @param[out] buffer Pointer to the buffer that holds the packet
+ * @return Number of bytes that have been received
+ **/
+
+size_t simEthLoanRxBuffer(NetInterface *interface, uint8_t **buffer)
+{
+   //Total number of bytes received
+   size_t length = 0;
+
+   //Process the pending descriptors until a valid packet is found
+   while(!length && !(rxCurDmaDesc->des0 & SIM_ETH_DES0_OWN))
+   {
+      //FS and LS flags should be set
+      if((rxCurDmaDesc->des0 & SIM_ETH_DES0_FS) && (rxCurDmaDesc->des0 & SIM_ETH_DES0_LS))
+      {
+         //Make sure no error occurred
+         if(!(rxCurDmaDesc->des0 & SIM_ETH_DES0_ES))
+         {
+            //Retrieve the length of the frame
+            length = (rxCurDmaDesc->des0 & SIM_ETH_DES0_FL) >> 16;
+            //Limit the number of data to read
+            length = min(length, ETH_MAX_FRAME_SIZE);
+
+            //Any spare buffer available?
+            if(rxSpareCount > 0)
+            {
+               //Loan the DMA buffer to the upper layer
+               *buffer = rxCurDmaDesc->buffer;
+               //Re-arm the descriptor with a spare buffer
+               rxCurDmaDesc->buffer = rxSparePool[--rxSpareCount];
+               //Update statistics
+               simEthStats.rxLoans++;
+            }
+            else
+            {
+               //Fall back to copying the packet
+               memcpy(interface->ethFrame, rxCurDmaDesc->buffer, length);
+               //The copy will not be returned to the spare pool
+               *buffer = interface->ethFrame;
+               //Update statistics
+               simEthStats.rxCopies++;
+            }
+         }
+      }
+
+      //Give the ownership of the descriptor back to the DMA
+      rxCurDmaDesc->des0 = SIM_ETH_DES0_OWN;
+      //Point to the next descriptor in the list
+      rxCurDmaDesc = rxCurDmaDesc->next;
+   }
+
+   //Return the number of bytes that have been received
+   return length;
+}
+
+
+/**
+ * @brief Return a loaned RX buffer to the spare pool
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Buffer obtained from simEthLoanRxBuffer()
+ **/
+
+void simEthReleaseRxBuffer(NetInterface *interface, uint8_t *buffer)
+{
+   //Packets copied to the interface buffer do not belong to the pool
+   if(buffer != interface->ethFrame)
+   {
+      //Sanity check
+      if(rxSpareCount < SIM_ETH_RX_SPARE_BUFFER_COUNT)
+         rxSparePool[rxSpareCount++] = buffer;
+   }
+}
+
+
+/**
+ * @brief Write PHY register
+ * @param[in] phyAddr PHY address
+ * @param[in] regAddr Register address
+ * @param[in] data Register value
+ **/
+
+void simEthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data)
+{
+   //The simulated controller has no PHY
+}
+
+
+/**
+ * @brief Read PHY register
+ * @param[in] phyAddr PHY address
+ * @param[in] regAddr Register address
+ * @return Register value
+ **/
+
+uint16_t simEthReadPhyReg(uint8_t phyAddr, uint8_t regAddr)
+{
+   //The simulated controller has no PHY
+   return 0;
+}
+
+
+/**
+ * @brief Deliver a frame to the simulated controller
+ *
+ * This function plays the role of the receive DMA and interrupt
+ * handler. The frame is written to the next descriptor owned by the
+ * DMA and the TCP/IP stack is notified
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] data Ethernet frame (CRC field included)
+ * @param[in] length Length of the frame
+ * @return Error code
+ **/
+
+error_t simEthInjectFrame(NetInterface *interface, const void *data, size_t length)
+{
+   error_t error;
+
+   //Check the frame length
+   if(length > SIM_ETH_RX_BUFFER_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //Get exclusive access to the descriptor list
+   osTaskSuspendAll();
+
+   //Make sure the current descriptor is owned by the DMA
+   if(rxDmaCurDmaDesc->des0 & SIM_ETH_DES0_OWN)
+   {
+      //Copy the frame to the receive buffer
+      memcpy(rxDmaCurDmaDesc->buffer, data, length);
+      //Give the ownership of the descriptor to the driver
+      rxDmaCurDmaDesc->des0 = SIM_ETH_DES0_FS | SIM_ETH_DES0_LS |
+         ((length << 16) & SIM_ETH_DES0_FL);
+      //Point to the next descriptor in the list
+      rxDmaCurDmaDesc = rxDmaCurDmaDesc->next;
+
+      //Update statistics
+      simEthStats.rxPackets++;
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //The receive ring is full
+      simEthStats.rxOverruns++;
+      //Report an error
+      error = ERROR_RECEIVE_QUEUE_FULL;
+   }
+
+   //Release exclusive access to the descriptor list
+   osTaskResumeAll();
+
+   //Notify the TCP/IP stack that a packet has been received
+   if(!error)
+      osEventSet(interface->nicRxEvent);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Register the callback invoked for each transmitted frame
+ * @param[in] callback Callback function (NULL to discard frames)
+ **/
+
+void simEthSetTxCallback(SimEthTxCallback callback)
+{
+   //Save callback function
+   txCallback = callback;
+}
+
+
+/**
+ * @brief Retrieve simulated controller statistics
+ * @param[out] stats Statistics
+ **/
+
+void simEthGetStats(SimEthStats *stats)
+{
+   //Get exclusive access to the statistics
+   osTaskSuspendAll();
+   //Copy statistics
+   *stats = simEthStats;
+   //Release exclusive access to the statistics
+   osTaskResumeAll();
+}
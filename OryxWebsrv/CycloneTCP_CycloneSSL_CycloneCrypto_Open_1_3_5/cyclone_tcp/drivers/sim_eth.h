@@ -0,0 +1,126 @@
+/**
+ * @file sim_eth.h
+ * @brief Simulated Ethernet controller (host testing)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _SIM_ETH_H
+#define _SIM_ETH_H
+
+//Dependencies
+#include "nic.h"
+
+//TX buffers
+#ifndef SIM_ETH_TX_BUFFER_COUNT
+   #define SIM_ETH_TX_BUFFER_COUNT 2
+#elif (SIM_ETH_TX_BUFFER_COUNT < 1)
+   #error SIM_ETH_TX_BUFFER_COUNT parameter is invalid
+#endif
+
+#define SIM_ETH_TX_BUFFER_SIZE 1536
+
+//RX buffers
+#ifndef SIM_ETH_RX_BUFFER_COUNT
+   #define SIM_ETH_RX_BUFFER_COUNT 6
+#elif (SIM_ETH_RX_BUFFER_COUNT < 1)
+   #error SIM_ETH_RX_BUFFER_COUNT parameter is invalid
+#endif
+
+#define SIM_ETH_RX_BUFFER_SIZE 1536
+
+//Spare buffers used to re-arm RX descriptors
+#ifndef SIM_ETH_RX_SPARE_BUFFER_COUNT
+   #define SIM_ETH_RX_SPARE_BUFFER_COUNT 1
+#elif (SIM_ETH_RX_SPARE_BUFFER_COUNT < 1)
+   #error SIM_ETH_RX_SPARE_BUFFER_COUNT parameter is invalid
+#endif
+
+//Descriptor flags (same layout as the STM32F4x7 RDES0 word)
+#define SIM_ETH_DES0_OWN 0x80000000
+#define SIM_ETH_DES0_FL  0x3FFF0000
+#define SIM_ETH_DES0_ES  0x00008000
+#define SIM_ETH_DES0_FS  0x00000200
+#define SIM_ETH_DES0_LS  0x00000100
+
+
+/**
+ * @brief Simulated DMA descriptor
+ **/
+
+typedef struct _SimEthDmaDesc
+{
+   uint32_t des0;
+   uint8_t *buffer;
+   struct _SimEthDmaDesc *next;
+} SimEthDmaDesc;
+
+
+/**
+ * @brief Simulated controller statistics
+ **/
+
+typedef struct
+{
+   uint32_t rxPackets;
+   uint32_t rxOverruns;
+   uint32_t rxLoans;
+   uint32_t rxCopies;
+   uint32_t txPackets;
+} SimEthStats;
+
+
+//Callback invoked when the simulated DMA transmits a frame
+typedef void (*SimEthTxCallback)(NetInterface *interface,
+   const uint8_t *frame, size_t length);
+
+//Simulated Ethernet controller
+extern const NicDriver simEthDriver;
+
+//Simulated Ethernet controller related functions
+error_t simEthInit(NetInterface *interface);
+void simEthInitDmaDesc(NetInterface *interface);
+
+void simEthTick(NetInterface *interface);
+
+void simEthEnableIrq(NetInterface *interface);
+void simEthDisableIrq(NetInterface *interface);
+void simEthRxEventHandler(NetInterface *interface);
+
+error_t simEthSetMacFilter(NetInterface *interface);
+
+error_t simEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
+size_t simEthLoanRxBuffer(NetInterface *interface, uint8_t **buffer);
+void simEthReleaseRxBuffer(NetInterface *interface, uint8_t *buffer);
+
+void simEthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
+uint16_t simEthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
+
+error_t simEthInjectFrame(NetInterface *interface, const void *data, size_t length);
+void simEthSetTxCallback(SimEthTxCallback callback);
+void simEthGetStats(SimEthStats *stats);
+
+#endif
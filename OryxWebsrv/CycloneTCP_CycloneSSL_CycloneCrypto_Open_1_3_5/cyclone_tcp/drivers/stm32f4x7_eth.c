@@ -35,6 +35,7 @@
 #include "stm32f4xx_rcc.h"
 #include "misc.h"
 #include "tcp_ip_stack.h"
+#include "ethernet.h"
 #include "stm32f4x7_eth.h"
 #include "debug.h"
 
@@ -51,6 +52,15 @@ static Stm32f4x7TxDmaDesc *txCurDmaDesc;
 //Pointer to the current RX DMA descriptor
 static Stm32f4x7RxDmaDesc *rxCurDmaDesc;
 
+#if (STM32F4X7_ZERO_COPY_RX_SUPPORT == ENABLED)
+//Spare receive buffers
+static uint8_t rxSpareBuffer[STM32F4X7_RX_SPARE_BUFFER_COUNT][STM32F4X7_RX_BUFFER_SIZE] __attribute__((aligned(4)));
+//Pool of spare receive buffers that are not attached to any descriptor
+static uint8_t *rxSparePool[STM32F4X7_RX_SPARE_BUFFER_COUNT];
+//Number of buffers in the spare pool
+static uint_t rxSpareCount;
+#endif
+
 
 /**
  * @brief STM32F407/417/427/437 Ethernet MAC driver
@@ -67,6 +77,11 @@ const NicDriver stm32f4x7EthDriver =
    stm32f4x7EthSendPacket,
    stm32f4x7EthWritePhyReg,
    stm32f4x7EthReadPhyReg,
+#if (STM32F4X7_ZERO_COPY_TX_SUPPORT == ENABLED)
+   stm32f4x7EthReleaseTxData,
+#else
+   NULL,
+#endif
    TRUE,
    TRUE,
    TRUE
@@ -195,6 +210,11 @@ error_t stm32f4x7EthInit(NetInterface *interface)
    RCC_AHB1PeriphResetCmd(RCC_AHB1Periph_ETH_MAC, ENABLE);
    RCC_AHB1PeriphResetCmd(RCC_AHB1Periph_ETH_MAC, DISABLE);
 
+#if (ETH_HW_CRC_SUPPORT == ENABLED)
+   //Enable CRC calculation unit clock
+   RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+#endif
+
    //Perform a software reset
    ETH->DMABMR |= ETH_DMABMR_SR;
    //Wait for the reset to complete
@@ -326,6 +346,15 @@ void stm32f4x7EthInitDmaDesc(NetInterface *interface)
    //Point to the very first descriptor
    rxCurDmaDesc = &rxDmaDesc[0];
 
+#if (STM32F4X7_ZERO_COPY_RX_SUPPORT == ENABLED)
+   //All the spare buffers are initially available
+   for(i = 0; i < STM32F4X7_RX_SPARE_BUFFER_COUNT; i++)
+      rxSparePool[i] = rxSpareBuffer[i];
+
+   //Number of buffers in the spare pool
+   rxSpareCount = STM32F4X7_RX_SPARE_BUFFER_COUNT;
+#endif
+
    //Start location of the TX descriptor list
    ETH->DMATDLAR = (uint32_t) txDmaDesc;
    //Start location of the RX descriptor list
@@ -436,6 +465,9 @@ void stm32f4x7EthRxEventHandler(NetInterface *interface)
 {
    size_t length;
    bool_t linkStateChange;
+#if (STM32F4X7_ZERO_COPY_RX_SUPPORT == ENABLED)
+   uint8_t *frame;
+#endif
 
    //PHY event is pending?
    if(interface->phyEvent)
@@ -484,6 +516,18 @@ void stm32f4x7EthRxEventHandler(NetInterface *interface)
       //Process all the pending packets
       while(1)
       {
+#if (STM32F4X7_ZERO_COPY_RX_SUPPORT == ENABLED)
+         //Borrow the DMA buffer holding the next packet
+         length = stm32f4x7EthLoanRxBuffer(interface, &frame);
+         //No packet is pending in the receive buffer?
+         if(!length) break;
+
+         //Pass the packet to the upper layer
+         nicProcessPacket(interface, frame, length);
+
+         //The upper layer is done with the packet
+         stm32f4x7EthReleaseRxBuffer(interface, frame);
+#else
          //Check whether a packet has been received
          length = stm32f4x7EthReceivePacket(interface, interface->ethFrame, ETH_MAX_FRAME_SIZE);
          //No packet is pending in the receive buffer?
@@ -491,6 +535,7 @@ void stm32f4x7EthRxEventHandler(NetInterface *interface)
 
          //Pass the packet to the upper layer
          nicProcessPacket(interface, interface->ethFrame, length);
+#endif
       }
    }
 
@@ -555,6 +600,17 @@ error_t stm32f4x7EthSetMacFilter(NetInterface *interface)
 error_t stm32f4x7EthSendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset)
 {
+#if (STM32F4X7_ZERO_COPY_TX_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t j;
+   uint_t count;
+   size_t n;
+   size_t k;
+   bool_t copy;
+   uint8_t *p;
+   Stm32f4x7TxDmaDesc *desc;
+#endif
+
    //Retrieve the length of the packet
    size_t length = chunkedBufferGetLength(buffer) - offset;
 
@@ -571,15 +627,148 @@ error_t stm32f4x7EthSendPacket(NetInterface *interface,
    if(txCurDmaDesc->tdes0 & ETH_TDES0_OWN)
       return ERROR_FAILURE;
 
-   //Copy user data to the transmit buffer
-   chunkedBufferRead((uint8_t *) txCurDmaDesc->tdes2, buffer, offset, length);
+#if (STM32F4X7_ZERO_COPY_TX_SUPPORT == ENABLED)
+   //Skip the beginning of the multi-part buffer
+   for(i = 0; i < buffer->chunkCount && offset >= buffer->chunk[i].length; i++)
+      offset -= buffer->chunk[i].length;
+
+   //Consecutive chunks that cannot be referenced are gathered in the
+   //buffer of a single descriptor. Count the descriptors needed
+   for(count = 0, copy = FALSE, j = i, k = offset; j < buffer->chunkCount; j++, k = 0)
+   {
+      //Number of bytes in the current chunk
+      n = buffer->chunk[j].length - k;
+
+      //Can the DMA read the chunk in place?
+      if(stm32f4x7EthCanReferenceChunk(&buffer->chunk[j], n))
+      {
+         //Close the pending copy descriptor, if any
+         count += copy ? 2 : 1;
+         copy = FALSE;
+      }
+      else if(n > 0)
+      {
+         //The chunk will be copied
+         copy = TRUE;
+      }
+   }
+
+   //Close the pending copy descriptor, if any
+   if(copy) count++;
+
+   //Make sure enough descriptors are available to chain the frame
+   for(j = 0, desc = txCurDmaDesc; j < count; j++)
+   {
+      //Descriptor in use?
+      if(desc->tdes0 & ETH_TDES0_OWN)
+         break;
+
+      //Point to the next descriptor in the list
+      desc = (Stm32f4x7TxDmaDesc *) desc->tdes3;
+
+      //The list must not wrap around to the first descriptor
+      if(desc == txCurDmaDesc && (j + 1) < count)
+         break;
+   }
+
+   //Not enough descriptors or single-part frame?
+   if(j < count || count <= 1)
+   {
+#endif
+      //Restore the buffer attached to the current descriptor
+      txCurDmaDesc->tdes2 = (uint32_t) txBuffer[txCurDmaDesc - txDmaDesc];
+      //Copy user data to the transmit buffer
+      chunkedBufferRead((uint8_t *) txCurDmaDesc->tdes2, buffer, offset, length);
+
+      //Write the number of bytes to send
+      txCurDmaDesc->tdes1 = length & ETH_TDES1_TBS1;
+      //Set LS and FS flags as the data fits in a single buffer
+      txCurDmaDesc->tdes0 = ETH_TDES0_IC | ETH_TDES0_TCH | ETH_TDES0_LS | ETH_TDES0_FS;
+      //Give the ownership of the descriptor to the DMA
+      txCurDmaDesc->tdes0 |= ETH_TDES0_OWN;
+
+      //Point to the next descriptor in the list
+      txCurDmaDesc = (Stm32f4x7TxDmaDesc *) txCurDmaDesc->tdes3;
+#if (STM32F4X7_ZERO_COPY_TX_SUPPORT == ENABLED)
+   }
+   else
+   {
+      //Point to the first descriptor of the chain
+      desc = txCurDmaDesc;
+      //Number of bytes gathered in the current copy buffer
+      k = 0;
+
+      //Loop through data chunks
+      for(; i < buffer->chunkCount && length > 0; i++, offset = 0)
+      {
+         //Point to the data to send
+         p = (uint8_t *) buffer->chunk[i].address + offset;
+         //Number of bytes in the current chunk
+         n = min(buffer->chunk[i].length - offset, length);
+
+         //Empty chunk?
+         if(!n) continue;
+
+         //Can the DMA read the chunk in place?
+         if(stm32f4x7EthCanReferenceChunk(&buffer->chunk[i], n))
+         {
+            //Close the pending copy descriptor, if any
+            if(k > 0)
+            {
+               desc->tdes1 = k & ETH_TDES1_TBS1;
+               desc = (Stm32f4x7TxDmaDesc *) desc->tdes3;
+               k = 0;
+            }
+
+            //The descriptor points directly to the chunk
+            desc->tdes2 = (uint32_t) p;
+            desc->tdes1 = n & ETH_TDES1_TBS1;
+            desc = (Stm32f4x7TxDmaDesc *) desc->tdes3;
+         }
+         else
+         {
+            //Start a new copy descriptor?
+            if(!k) desc->tdes2 = (uint32_t) txBuffer[desc - txDmaDesc];
+
+            //Gather the data in the buffer attached to the descriptor
+            memcpy((uint8_t *) desc->tdes2 + k, p, n);
+            k += n;
+         }
+
+         //Number of bytes left to process
+         length -= n;
+      }
+
+      //Close the pending copy descriptor, if any
+      if(k > 0)
+         desc->tdes1 = k & ETH_TDES1_TBS1;
+
+      //Set the control bits of the chained descriptors. The ownership of
+      //the first descriptor is given to the DMA last
+      for(j = count, desc = txCurDmaDesc; j > 0; j--)
+      {
+         desc->tdes0 = ETH_TDES0_IC | ETH_TDES0_TCH;
+
+         //First segment of the frame?
+         if(desc == txCurDmaDesc)
+            desc->tdes0 |= ETH_TDES0_FS;
+         else
+            desc->tdes0 |= ETH_TDES0_OWN;
 
-   //Write the number of bytes to send
-   txCurDmaDesc->tdes1 = length & ETH_TDES1_TBS1;
-   //Set LS and FS flags as the data fits in a single buffer
-   txCurDmaDesc->tdes0 |= ETH_TDES0_LS | ETH_TDES0_FS;
-   //Give the ownership of the descriptor to the DMA
-   txCurDmaDesc->tdes0 |= ETH_TDES0_OWN;
+         //Last segment of the frame?
+         if(j == 1)
+            desc->tdes0 |= ETH_TDES0_LS;
+
+         //Point to the next descriptor in the list
+         desc = (Stm32f4x7TxDmaDesc *) desc->tdes3;
+      }
+
+      //Give the ownership of the first descriptor to the DMA
+      txCurDmaDesc->tdes0 |= ETH_TDES0_OWN;
+      //Point to the descriptor that follows the chain
+      txCurDmaDesc = desc;
+   }
+#endif
 
    //Transmission is currently suspended?
    if(ETH->DMASR & ETH_DMASR_TBUS)
@@ -590,9 +779,6 @@ error_t stm32f4x7EthSendPacket(NetInterface *interface,
       ETH->DMATPDR = 0;
    }
 
-   //Point to the next descriptor in the list
-   txCurDmaDesc = (Stm32f4x7TxDmaDesc *) txCurDmaDesc->tdes3;
-
    //Check whether the next buffer is available for writing
    if(!(txCurDmaDesc->tdes0 & ETH_TDES0_OWN))
    {
@@ -605,6 +791,142 @@ error_t stm32f4x7EthSendPacket(NetInterface *interface,
 }
 
 
+#if (STM32F4X7_ZERO_COPY_TX_SUPPORT == ENABLED)
+
+/**
+ * @brief Check whether the DMA can transmit a chunk without copying it
+ * @param[in] chunk Pointer to the chunk descriptor
+ * @param[in] length Number of bytes to transmit from the chunk
+ * @return TRUE if the chunk can be referenced by a TX DMA descriptor
+ **/
+
+bool_t stm32f4x7EthCanReferenceChunk(const ChunkDesc *chunk, size_t length)
+{
+   //The data must remain valid after the multi-part buffer is released
+   if(!(chunk->flags & CHUNK_FLAG_ZERO_COPY))
+      return FALSE;
+
+   //Small chunks are cheaper to copy than to chain
+   if(length < STM32F4X7_ZERO_COPY_TX_THRESHOLD)
+      return FALSE;
+
+   //The Ethernet DMA cannot access the CCM data RAM
+   if(((uint32_t) chunk->address & 0xFFFF0000) == 0x10000000)
+      return FALSE;
+
+   //The chunk can be referenced
+   return TRUE;
+}
+
+
+/**
+ * @brief Make sure the DMA no longer reads a buffer
+ *
+ * Chunks transmitted in place belong to the upper layer, typically the
+ * send buffer of a TCP socket. Before that memory is released, the TX
+ * DMA descriptors that still refer to it must have been processed. If
+ * the DMA does not get to them in time, every descriptor is taken back
+ * and the frames that were not sent yet are dropped
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer about to be released
+ * @param[in] force Take the descriptors back from the DMA if necessary
+ * @return TRUE if no descriptor refers to the buffer anymore
+ **/
+
+bool_t stm32f4x7EthReleaseTxData(NetInterface *interface,
+   const ChunkedBuffer *buffer, bool_t force)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   uint32_t address;
+
+   //Loop through the TX DMA descriptors
+   for(i = 0; i < STM32F4X7_TX_BUFFER_COUNT; i++)
+   {
+      //Skip the descriptors that have already been processed
+      if(!(txDmaDesc[i].tdes0 & ETH_TDES0_OWN)) continue;
+
+      //Address of the data to be read by the DMA
+      address = txDmaDesc[i].tdes2;
+
+      //Check whether the descriptor points to one of the chunks
+      for(j = 0; j < buffer->chunkCount; j++)
+      {
+         if(address >= (uint32_t) buffer->chunk[j].address &&
+            address < ((uint32_t) buffer->chunk[j].address + buffer->chunk[j].length))
+         {
+            break;
+         }
+      }
+
+      //The buffer is still referenced?
+      if(j < buffer->chunkCount) break;
+   }
+
+   //The buffer can be safely released?
+   if(i >= STM32F4X7_TX_BUFFER_COUNT)
+      return TRUE;
+
+   //Let the DMA process the pending descriptors
+   if(!force)
+   {
+      //Transmission is currently suspended?
+      if(ETH->DMASR & ETH_DMASR_TBUS)
+      {
+         //Clear TBUS flag to resume processing
+         ETH->DMASR = ETH_DMASR_TBUS;
+         //Instruct the DMA to poll the transmit descriptor list
+         ETH->DMATPDR = 0;
+      }
+
+      //The caller has to wait
+      return FALSE;
+   }
+
+   //Debug message
+   TRACE_WARNING("Reclaiming TX DMA descriptors...\r\n");
+
+   //Stop the transmission DMA once the current frame is complete
+   ETH->DMAOMR &= ~ETH_DMAOMR_ST;
+
+   //Wait for the DMA to reach the stopped state (bounded, since the
+   //current frame may never complete)
+   for(k = 0; k < 100000; k++)
+   {
+      if((ETH->DMASR & ETH_DMASR_TPS) == ETH_DMASR_TPS_Stopped)
+         break;
+   }
+
+   //Flush the transmit FIFO
+   ETH->DMAOMR |= ETH_DMAOMR_FTF;
+
+   //Take back the ownership of every descriptor
+   for(i = 0; i < STM32F4X7_TX_BUFFER_COUNT; i++)
+   {
+      txDmaDesc[i].tdes0 = ETH_TDES0_IC | ETH_TDES0_TCH;
+      txDmaDesc[i].tdes1 = 0;
+      txDmaDesc[i].tdes2 = (uint32_t) txBuffer[i];
+   }
+
+   //Restart from the very first descriptor
+   txCurDmaDesc = &txDmaDesc[0];
+   ETH->DMATDLAR = (uint32_t) txDmaDesc;
+
+   //Restart the transmission DMA
+   ETH->DMAOMR |= ETH_DMAOMR_ST;
+
+   //The transmitter can accept another packet
+   osEventSet(interface->nicTxEvent);
+
+   //The buffer can now be released
+   return TRUE;
+}
+
+#endif
+
+
 /**
  * @brief Receive a packet
  * @param[in] interface Underlying network interface
@@ -657,6 +979,98 @@ size_t stm32f4x7EthReceivePacket(NetInterface *interface,
 }
 
 
+#if (STM32F4X7_ZERO_COPY_RX_SUPPORT == ENABLED)
+
+/**
+ * @brief Borrow the DMA buffer holding the next received packet
+ *
+ * The buffer is detached from its descriptor, which is immediately
+ * re-armed with a spare buffer so that the DMA never runs short of
+ * descriptors while the upper layer processes the packet. The caller
+ * must hand the buffer back with stm32f4x7EthReleaseRxBuffer()
+ *
+ * @param[in] interface Underlying network interface
+ * @param[out] buffer Pointer to the buffer that holds the packet
+ * @return Number of bytes that have been received
+ **/
+
+size_t stm32f4x7EthLoanRxBuffer(NetInterface *interface, uint8_t **buffer)
+{
+   //Total number of bytes received
+   size_t length = 0;
+
+   //Process the pending descriptors until a valid packet is found
+   while(!length && !(rxCurDmaDesc->rdes0 & ETH_RDES0_OWN))
+   {
+      //FS and LS flags should be set
+      if((rxCurDmaDesc->rdes0 & ETH_RDES0_FS) && (rxCurDmaDesc->rdes0 & ETH_RDES0_LS))
+      {
+         //Make sure no error occurred
+         if(!(rxCurDmaDesc->rdes0 & ETH_RDES0_ES))
+         {
+            //Retrieve the length of the frame
+            length = (rxCurDmaDesc->rdes0 & ETH_RDES0_FL) >> 16;
+            //Limit the number of data to read
+            length = min(length, ETH_MAX_FRAME_SIZE);
+
+            //Any spare buffer available?
+            if(rxSpareCount > 0)
+            {
+               //Loan the DMA buffer to the upper layer
+               *buffer = (uint8_t *) rxCurDmaDesc->rdes2;
+               //Re-arm the descriptor with a spare buffer
+               rxCurDmaDesc->rdes2 = (uint32_t) rxSparePool[--rxSpareCount];
+            }
+            else
+            {
+               //Fall back to copying the packet
+               memcpy(interface->ethFrame, (uint8_t *) rxCurDmaDesc->rdes2, length);
+               //The copy will not be returned to the spare pool
+               *buffer = interface->ethFrame;
+            }
+         }
+      }
+
+      //Give the ownership of the descriptor back to the DMA
+      rxCurDmaDesc->rdes0 = ETH_RDES0_OWN;
+      //Point to the next descriptor in the list
+      rxCurDmaDesc = (Stm32f4x7RxDmaDesc *) rxCurDmaDesc->rdes3;
+   }
+
+   //Reception process is suspended?
+   if(ETH->DMASR & ETH_DMASR_RBUS)
+   {
+      //Clear RBUS flag to resume processing
+      ETH->DMASR = ETH_DMASR_RBUS;
+      //Instruct the DMA to poll the receive descriptor list
+      ETH->DMARPDR = 0;
+   }
+
+   //Return the number of bytes that have been received
+   return length;
+}
+
+
+/**
+ * @brief Return a loaned RX buffer to the spare pool
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Buffer obtained from stm32f4x7EthLoanRxBuffer()
+ **/
+
+void stm32f4x7EthReleaseRxBuffer(NetInterface *interface, uint8_t *buffer)
+{
+   //Packets copied to the interface buffer do not belong to the pool
+   if(buffer != interface->ethFrame)
+   {
+      //Sanity check
+      if(rxSpareCount < STM32F4X7_RX_SPARE_BUFFER_COUNT)
+         rxSparePool[rxSpareCount++] = buffer;
+   }
+}
+
+#endif
+
+
 /**
  * @brief Write PHY register
  * @param[in] phyAddr PHY address
@@ -722,28 +1136,41 @@ uint16_t stm32f4x7EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr)
 
 uint32_t stm32f4x7EthCalcCrc(const void *data, size_t length)
 {
-   uint_t i;
-   uint_t j;
+   //The MAC hash filter uses the bit-reversed Ethernet CRC
+   return __RBIT(ethCalcCrc(data, length));
+}
+
 
-   //Point to the data over which to calculate the CRC
-   const uint8_t *p = (uint8_t *) data;
-   //CRC preset value
-   uint32_t crc = 0xFFFFFFFF;
+#if (ETH_HW_CRC_SUPPORT == ENABLED)
+
+/**
+ * @brief Ethernet CRC calculation using the CRC unit
+ *
+ * The CRC unit is reset to its preset value before processing
+ * the data. Since it shifts the data MSB first, input words and the
+ * final register contents are bit-reversed to match the Ethernet CRC
+ *
+ * @param[in] data Pointer to the 32-bit words to process
+ * @param[in] count Number of words to process
+ * @return Internal state of the CRC register (not complemented)
+ **/
+
+uint32_t ethHwCalcCrc(const uint32_t *data, size_t count)
+{
+   size_t i;
+
+   //Reset the CRC unit
+   CRC->CR = CRC_CR_RESET;
 
    //Loop through data
-   for(i = 0; i < length; i++)
+   for(i = 0; i < count; i++)
    {
-      //The message is processed bit by bit
-      for(j = 0; j < 8; j++)
-      {
-         //Update CRC value
-         if(((crc >> 31) ^ (p[i] >> j)) & 0x01)
-            crc = (crc << 1) ^ 0x04C11DB7;
-         else
-            crc = crc << 1;
-      }
+      //Feed the CRC unit with the current word
+      CRC->DR = __RBIT(data[i]);
    }
 
-   //Return CRC value
-   return ~crc;
+   //Return the resulting CRC state
+   return __RBIT(CRC->DR);
 }
+
+#endif
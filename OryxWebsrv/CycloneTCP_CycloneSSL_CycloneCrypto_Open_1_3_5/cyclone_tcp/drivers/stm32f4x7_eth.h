@@ -33,12 +33,40 @@
 #include "nic.h"
 
 //TX buffers
-#define STM32F4X7_TX_BUFFER_COUNT 2
+#define STM32F4X7_TX_BUFFER_COUNT 4
 #define STM32F4X7_TX_BUFFER_SIZE 1536
 //RX buffers
 #define STM32F4X7_RX_BUFFER_COUNT 6
 #define STM32F4X7_RX_BUFFER_SIZE 1536
 
+//Zero-copy receive (RX DMA buffers are loaned to the upper layer)
+#ifndef STM32F4X7_ZERO_COPY_RX_SUPPORT
+   #define STM32F4X7_ZERO_COPY_RX_SUPPORT ENABLED
+#elif (STM32F4X7_ZERO_COPY_RX_SUPPORT != ENABLED && STM32F4X7_ZERO_COPY_RX_SUPPORT != DISABLED)
+   #error STM32F4X7_ZERO_COPY_RX_SUPPORT parameter is invalid
+#endif
+
+//Spare buffers used to re-arm RX DMA descriptors
+#ifndef STM32F4X7_RX_SPARE_BUFFER_COUNT
+   #define STM32F4X7_RX_SPARE_BUFFER_COUNT 1
+#elif (STM32F4X7_RX_SPARE_BUFFER_COUNT < 1)
+   #error STM32F4X7_RX_SPARE_BUFFER_COUNT parameter is invalid
+#endif
+
+//Zero-copy transmit (TX DMA descriptors are chained over the data chunks)
+#ifndef STM32F4X7_ZERO_COPY_TX_SUPPORT
+   #define STM32F4X7_ZERO_COPY_TX_SUPPORT ENABLED
+#elif (STM32F4X7_ZERO_COPY_TX_SUPPORT != ENABLED && STM32F4X7_ZERO_COPY_TX_SUPPORT != DISABLED)
+   #error STM32F4X7_ZERO_COPY_TX_SUPPORT parameter is invalid
+#endif
+
+//Chunks smaller than this threshold are copied rather than referenced
+#ifndef STM32F4X7_ZERO_COPY_TX_THRESHOLD
+   #define STM32F4X7_ZERO_COPY_TX_THRESHOLD 128
+#elif (STM32F4X7_ZERO_COPY_TX_THRESHOLD < 1)
+   #error STM32F4X7_ZERO_COPY_TX_THRESHOLD parameter is invalid
+#endif
+
 //Transmit DMA descriptor flags
 #define ETH_TDES0_OWN    0x80000000
 #define ETH_TDES0_IC     0x40000000
@@ -164,9 +192,17 @@ error_t stm32f4x7EthSetMacFilter(NetInterface *interface);
 error_t stm32f4x7EthSendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset);
 
+bool_t stm32f4x7EthCanReferenceChunk(const ChunkDesc *chunk, size_t length);
+
+bool_t stm32f4x7EthReleaseTxData(NetInterface *interface,
+   const ChunkedBuffer *buffer, bool_t force);
+
 size_t stm32f4x7EthReceivePacket(NetInterface *interface,
    uint8_t *buffer, size_t size);
 
+size_t stm32f4x7EthLoanRxBuffer(NetInterface *interface, uint8_t **buffer);
+void stm32f4x7EthReleaseRxBuffer(NetInterface *interface, uint8_t *buffer);
+
 void stm32f4x7EthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
 uint16_t stm32f4x7EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
 
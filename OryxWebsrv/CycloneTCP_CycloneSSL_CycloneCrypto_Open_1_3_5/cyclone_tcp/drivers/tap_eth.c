@@ -0,0 +1,482 @@
+/**
+ * @file tap_eth.c
+ * @brief Linux TAP network device driver (host testing)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The driver attaches a network interface to a Linux TAP device, so that
+ * the TCP/IP stack can exchange Ethernet frames with the host kernel. It
+ * requires the POSIX port of the OS abstraction layer. A dedicated task
+ * plays the role of the receive DMA and interrupt handler. The TAP device
+ * (tap0 for the first interface by default) must be brought up on the host
+ * side, for instance with "ip link set tap0 up"
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL NIC_TRACE_LEVEL
+
+//Dependencies
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "tap_eth.h"
+#include "debug.h"
+
+//Context of each TAP device
+static TapEthContext tapEthContext[NET_INTERFACE_COUNT];
+
+//Retrieve the context attached to a network interface
+#define TAP_ETH_CONTEXT(interface) (&tapEthContext[(interface) - netInterface])
+
+
+/**
+ * @brief TAP network device driver
+ **/
+
+const NicDriver tapEthDriver =
+{
+   tapEthInit,
+   tapEthTick,
+   tapEthEnableIrq,
+   tapEthDisableIrq,
+   tapEthRxEventHandler,
+   tapEthSetMacFilter,
+   tapEthSendPacket,
+   tapEthWritePhyReg,
+   tapEthReadPhyReg,
+   NULL,
+   TRUE,
+   TRUE,
+   TRUE
+};
+
+
+/**
+ * @brief TAP device initialization
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t tapEthInit(NetInterface *interface)
+{
+   struct ifreq ifr;
+   TapEthContext *context;
+
+   //Point to the driver context
+   context = TAP_ETH_CONTEXT(interface);
+
+   //Use a default device name if none has been specified
+   if(context->deviceName[0] == '\0')
+      sprintf(context->deviceName, "tap%u", (uint_t) (interface - netInterface));
+
+   //Debug message
+   TRACE_INFO("Initializing TAP device %s...\r\n", context->deviceName);
+
+   //Open the clone device
+   context->fd = open("/dev/net/tun", O_RDWR);
+
+   //Failed to open the device?
+   if(context->fd < 0)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to open /dev/net/tun (errno %d)!\r\n", errno);
+      //Report an error
+      return ERROR_OPEN_FAILED;
+   }
+
+   //Request a TAP device. Frames are not prefixed with packet information
+   memset(&ifr, 0, sizeof(ifr));
+   ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+   strncpy(ifr.ifr_name, context->deviceName, IFNAMSIZ - 1);
+
+   //Attach the file descriptor to the TAP device
+   if(ioctl(context->fd, TUNSETIFF, &ifr) < 0)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to attach TAP device %s (errno %d)!\r\n",
+         context->deviceName, errno);
+      //Clean up side effects
+      close(context->fd);
+      context->fd = -1;
+      //Report an error
+      return ERROR_OPEN_FAILED;
+   }
+
+   //Initialize driver specific variables
+   context->rxReadIndex = 0;
+   context->rxCount = 0;
+   memset(&context->stats, 0, sizeof(TapEthStats));
+
+   //The link is always up
+   interface->linkState = TRUE;
+   interface->speed100 = TRUE;
+   interface->fullDuplex = TRUE;
+   //Report the link state to the TCP/IP stack
+   context->linkEvent = TRUE;
+
+   //Create a task to read incoming frames
+   context->rxTask = osTaskCreate("TAP Ethernet (RX)", tapEthRxTask,
+      interface, TCP_IP_RX_STACK_SIZE, TCP_IP_RX_PRIORITY);
+
+   //Unable to create the task?
+   if(context->rxTask == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      close(context->fd);
+      context->fd = -1;
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Force the TCP/IP stack to check the link state
+   osEventSet(interface->nicRxEvent);
+   //The device is now ready to send
+   osEventSet(interface->nicTxEvent);
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief TAP device timer handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void tapEthTick(NetInterface *interface)
+{
+   //No periodic operation
+}
+
+
+/**
+ * @brief Enable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void tapEthEnableIrq(NetInterface *interface)
+{
+   //Interrupts are emulated by tapEthRxTask
+}
+
+
+/**
+ * @brief Disable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void tapEthDisableIrq(NetInterface *interface)
+{
+   //Interrupts are emulated by tapEthRxTask
+}
+
+
+/**
+ * @brief TAP device event handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void tapEthRxEventHandler(NetInterface *interface)
+{
+   uint_t i;
+   TapEthFrame *frame;
+   TapEthContext *context;
+
+   //Point to the driver context
+   context = TAP_ETH_CONTEXT(interface);
+
+   //Link state change pending?
+   if(context->linkEvent)
+   {
+      //Acknowledge the event by clearing the flag
+      context->linkEvent = FALSE;
+      //Process link state change event
+      nicNotifyLinkChange(interface);
+   }
+
+   //Process all the pending frames
+   while(context->rxCount > 0)
+   {
+      //Point to the oldest frame in the receive ring
+      i = context->rxReadIndex;
+      frame = &context->rxFrame[i];
+
+      //Pass the packet to the upper layer. The ring is unlocked while the
+      //frame is processed, but the RX task never fills an occupied slot
+      nicProcessPacket(interface, frame->data, frame->length);
+
+      //Release the slot
+      context->rxReadIndex = (i + 1) % TAP_ETH_RX_BUFFER_COUNT;
+      context->rxCount--;
+   }
+}
+
+
+/**
+ * @brief Configure multicast MAC address filtering
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t tapEthSetMacFilter(NetInterface *interface)
+{
+   //The TAP device delivers all frames
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send a packet
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+error_t tapEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   ssize_t n;
+   size_t length;
+   TapEthContext *context;
+
+   //Point to the driver context
+   context = TAP_ETH_CONTEXT(interface);
+
+   //Retrieve the length of the packet
+   length = chunkedBufferGetLength(buffer) - offset;
+
+   //Check the frame length
+   if(length > TAP_ETH_TX_BUFFER_SIZE)
+   {
+      //The transmitter can accept another packet
+      osEventSet(interface->nicTxEvent);
+      //Report an error
+      return ERROR_INVALID_LENGTH;
+   }
+
+   //Copy user data to the transmit buffer
+   chunkedBufferRead(context->txBuffer, buffer, offset, length);
+
+   //Pad the frame to the minimum size, as the MAC would do
+   if(length < (ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE))
+   {
+      memset(context->txBuffer + length, 0, ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE - length);
+      length = ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE;
+   }
+
+   //Write the frame to the TAP device
+   n = write(context->fd, context->txBuffer, length);
+
+   //Update statistics
+   if(n == (ssize_t) length)
+      context->stats.txPackets++;
+   else
+      context->stats.txErrors++;
+
+   //The transmitter can accept another packet
+   osEventSet(interface->nicTxEvent);
+
+   //Frames are lost silently, as on a real link
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Write PHY register
+ * @param[in] phyAddr PHY address
+ * @param[in] regAddr Register address
+ * @param[in] data Register value
+ **/
+
+void tapEthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data)
+{
+   //The TAP device has no PHY
+}
+
+
+/**
+ * @brief Read PHY register
+ * @param[in] phyAddr PHY address
+ * @param[in] regAddr Register address
+ * @return Register value
+ **/
+
+uint16_t tapEthReadPhyReg(uint8_t phyAddr, uint8_t regAddr)
+{
+   //The TAP device has no PHY
+   return 0;
+}
+
+
+/**
+ * @brief Task reading incoming frames from the TAP device
+ *
+ * Frames are read directly into the first free slot of the receive ring.
+ * Only this task fills slots, and the event handler only releases them,
+ * so the slot remains free while the blocking read is in progress
+ *
+ * @param[in] param Underlying network interface
+ **/
+
+void tapEthRxTask(void *param)
+{
+   uint_t i;
+   bool_t full;
+   ssize_t n;
+   size_t length;
+   uint8_t *p;
+   NetInterface *interface;
+   TapEthContext *context;
+
+   //Point to the structure describing the network interface
+   interface = (NetInterface *) param;
+   //Point to the driver context
+   context = TAP_ETH_CONTEXT(interface);
+
+   //Main loop
+   while(1)
+   {
+      //Get exclusive access to the receive ring
+      osTaskSuspendAll();
+      //Check whether the receive ring is full
+      full = (context->rxCount >= TAP_ETH_RX_BUFFER_COUNT);
+      //Index of the first free slot
+      i = (context->rxReadIndex + context->rxCount) % TAP_ETH_RX_BUFFER_COUNT;
+      //Release exclusive access to the receive ring
+      osTaskResumeAll();
+
+      //Frames that do not fit in the ring are read and discarded
+      p = full ? context->rxDiscard : context->rxFrame[i].data;
+
+      //Wait for the next frame. Room is kept for the CRC field
+      n = read(context->fd, p, TAP_ETH_RX_BUFFER_SIZE - ETH_CRC_SIZE);
+
+      //Any error to report?
+      if(n < 0)
+      {
+         //Interrupted system call?
+         if(errno == EINTR)
+            continue;
+
+         //Debug message
+         TRACE_ERROR("Failed to read TAP device %s (errno %d)!\r\n",
+            context->deviceName, errno);
+         //Kill ourselves
+         osTaskDelete(NULL);
+      }
+
+      //Length of the frame
+      length = n;
+
+      //Pad runt frames to the minimum size, as the MAC would do
+      if(length < (ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE))
+      {
+         memset(p + length, 0, ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE - length);
+         length = ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE;
+      }
+
+      //The CRC field is not checked by the receiver
+      memset(p + length, 0, ETH_CRC_SIZE);
+      length += ETH_CRC_SIZE;
+
+      //Get exclusive access to the receive ring
+      osTaskSuspendAll();
+
+      //The ring was full when the read was issued?
+      if(full)
+      {
+         //Update statistics
+         context->stats.rxOverruns++;
+      }
+      else
+      {
+         //Append the frame to the receive ring
+         context->rxFrame[i].length = length;
+         context->rxCount++;
+         //Update statistics
+         context->stats.rxPackets++;
+      }
+
+      //Release exclusive access to the receive ring
+      osTaskResumeAll();
+
+      //Notify the TCP/IP stack that a packet has been received
+      if(!full)
+         osEventSet(interface->nicRxEvent);
+   }
+}
+
+
+/**
+ * @brief Select the TAP device attached to a network interface
+ *
+ * This function must be called before the interface is configured.
+ * When no name is specified, tapN is used for the Nth interface
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] name NULL-terminated string that contains the device name
+ * @return Error code
+ **/
+
+error_t tapEthSetDeviceName(NetInterface *interface, const char_t *name)
+{
+   //Check parameters
+   if(interface == NULL || name == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Make sure the name is not too long
+   if(strlen(name) > TAP_ETH_MAX_NAME_LEN)
+      return ERROR_INVALID_LENGTH;
+
+   //Save the device name
+   strcpy(TAP_ETH_CONTEXT(interface)->deviceName, name);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve TAP driver statistics
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Statistics
+ **/
+
+void tapEthGetStats(NetInterface *interface, TapEthStats *stats)
+{
+   //Get exclusive access to the statistics
+   osTaskSuspendAll();
+   //Copy statistics
+   *stats = TAP_ETH_CONTEXT(interface)->stats;
+   //Release exclusive access to the statistics
+   osTaskResumeAll();
+}
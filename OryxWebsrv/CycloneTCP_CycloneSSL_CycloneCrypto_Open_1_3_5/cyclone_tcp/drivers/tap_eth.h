@@ -0,0 +1,117 @@
+/**
+ * @file tap_eth.h
+ * @brief Linux TAP network device driver (host testing)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _TAP_ETH_H
+#define _TAP_ETH_H
+
+//Dependencies
+#include "nic.h"
+
+//RX buffers
+#ifndef TAP_ETH_RX_BUFFER_COUNT
+   #define TAP_ETH_RX_BUFFER_COUNT 16
+#elif (TAP_ETH_RX_BUFFER_COUNT < 1)
+   #error TAP_ETH_RX_BUFFER_COUNT parameter is invalid
+#endif
+
+#define TAP_ETH_RX_BUFFER_SIZE 1536
+#define TAP_ETH_TX_BUFFER_SIZE 1536
+
+//Maximum length of the TAP device name
+#define TAP_ETH_MAX_NAME_LEN 15
+
+
+/**
+ * @brief Frame queued in the receive ring
+ **/
+
+typedef struct
+{
+   size_t length;                         ///<Length of the frame, CRC included
+   uint8_t data[TAP_ETH_RX_BUFFER_SIZE];  ///<Frame contents
+} TapEthFrame;
+
+
+/**
+ * @brief TAP driver statistics
+ **/
+
+typedef struct
+{
+   uint32_t rxPackets;   ///<Frames read from the TAP device
+   uint32_t rxOverruns;  ///<Frames dropped because the receive ring was full
+   uint32_t txPackets;   ///<Frames written to the TAP device
+   uint32_t txErrors;    ///<Frames that could not be written
+} TapEthStats;
+
+
+/**
+ * @brief TAP driver context
+ **/
+
+typedef struct
+{
+   char_t deviceName[TAP_ETH_MAX_NAME_LEN + 1];  ///<Name of the TAP device
+   int fd;                                       ///<File descriptor of the TAP device
+   OsTask *rxTask;                               ///<Task reading frames from the device
+   bool_t linkEvent;                             ///<A link state change is pending
+   uint_t rxReadIndex;                           ///<Index of the oldest frame in the ring
+   uint_t rxCount;                               ///<Number of frames in the ring
+   TapEthFrame rxFrame[TAP_ETH_RX_BUFFER_COUNT]; ///<Receive ring
+   uint8_t rxDiscard[TAP_ETH_RX_BUFFER_SIZE];    ///<Scratch buffer used when the ring is full
+   uint8_t txBuffer[TAP_ETH_TX_BUFFER_SIZE];     ///<Transmit buffer
+   TapEthStats stats;                            ///<Statistics
+} TapEthContext;
+
+
+//TAP network device driver
+extern const NicDriver tapEthDriver;
+
+//TAP network device related functions
+error_t tapEthInit(NetInterface *interface);
+
+void tapEthTick(NetInterface *interface);
+
+void tapEthEnableIrq(NetInterface *interface);
+void tapEthDisableIrq(NetInterface *interface);
+void tapEthRxEventHandler(NetInterface *interface);
+
+error_t tapEthSetMacFilter(NetInterface *interface);
+
+error_t tapEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
+void tapEthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
+uint16_t tapEthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
+
+void tapEthRxTask(void *param);
+
+error_t tapEthSetDeviceName(NetInterface *interface, const char_t *name);
+void tapEthGetStats(NetInterface *interface, TapEthStats *stats);
+
+#endif
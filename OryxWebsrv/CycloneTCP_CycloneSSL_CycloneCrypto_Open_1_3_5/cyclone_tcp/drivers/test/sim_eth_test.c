@@ -0,0 +1,399 @@
+/**
+ * @file sim_eth_test.c
+ * @brief Receive buffer loans of the simulated Ethernet controller
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The simulated controller has the same descriptor handling as the
+ * STM32F4x7 driver. Its receive path is first driven directly: a loaned
+ * buffer must keep its contents while the ring is refilled, the driver
+ * must fall back to copying once the spare buffers are exhausted, and
+ * a full ring must be reported as an overrun. ARP requests are then
+ * injected into a running TCP/IP stack, which must answer every one of
+ * them with the loan path only
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "sim_eth.h"
+#include "arp.h"
+#include "debug.h"
+
+//Number of ARP requests sent to the stack
+#define TEST_REQUEST_COUNT 1000
+//Time allowed for the stack to answer a burst of requests
+#define TEST_TIMEOUT 5000
+
+//Address of the interface
+#define TEST_HOST_ADDR "192.168.0.1"
+//Address of the simulated peer
+#define TEST_PEER_ADDR "192.168.0.2"
+
+//Global variables
+static NetInterface testInterface;
+static MacAddr peerMacAddr;
+static Ipv4Addr hostIpAddr;
+static Ipv4Addr peerIpAddr;
+static OsSemaphore *replySemaphore;
+static uint_t replyCount;
+static uint_t failures;
+
+
+/**
+ * @brief Format a test frame
+ * @param[out] frame Buffer where to format the frame
+ * @param[in] seqNum Sequence number stored in the frame
+ * @return Length of the frame
+ **/
+
+static size_t formatFrame(uint8_t *frame, uint_t seqNum)
+{
+   //Fill the frame with a pattern that depends on the sequence number
+   memset(frame, seqNum & 0xFF, 256);
+   //Return the length of the frame
+   return 256;
+}
+
+
+/**
+ * @brief Format an ARP request for the address of the interface
+ * @param[out] frame Buffer where to format the frame
+ * @return Length of the frame
+ **/
+
+static size_t formatArpRequest(uint8_t *frame)
+{
+   uint32_t crc;
+   EthHeader *header;
+   ArpPacket *arpRequest;
+
+   //Point to the Ethernet header
+   header = (EthHeader *) frame;
+   //Point to the ARP request
+   arpRequest = (ArpPacket *) header->data;
+
+   //Broadcast frame sent by the peer
+   header->destAddr = MAC_BROADCAST_ADDR;
+   header->srcAddr = peerMacAddr;
+   header->type = HTONS(ETH_TYPE_ARP);
+
+   //Format the ARP request
+   arpRequest->hrd = HTONS(ARP_HARDWARE_TYPE_ETH);
+   arpRequest->pro = HTONS(ARP_PROTOCOL_TYPE_IPV4);
+   arpRequest->hln = sizeof(MacAddr);
+   arpRequest->pln = sizeof(Ipv4Addr);
+   arpRequest->op = HTONS(ARP_OPCODE_ARP_REQUEST);
+   arpRequest->sha = peerMacAddr;
+   arpRequest->spa = peerIpAddr;
+   arpRequest->tha = MAC_UNSPECIFIED_ADDR;
+   arpRequest->tpa = hostIpAddr;
+
+   //Pad the frame to the minimum Ethernet length
+   memset(arpRequest + 1, 0, ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE - sizeof(EthHeader) - sizeof(ArpPacket));
+
+   //Append the CRC field, which the controller passes to the stack
+   crc = ethCalcCrc(frame, ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE);
+   memcpy(frame + ETH_MIN_FRAME_SIZE - ETH_CRC_SIZE, &crc, ETH_CRC_SIZE);
+
+   //Return the length of the frame
+   return ETH_MIN_FRAME_SIZE;
+}
+
+
+/**
+ * @brief Collect the frames sent by the stack
+ * @param[in] interface Underlying network interface
+ * @param[in] frame Transmitted frame
+ * @param[in] length Length of the frame
+ **/
+
+static void txCallback(NetInterface *interface, const uint8_t *frame, size_t length)
+{
+   EthHeader *header;
+   ArpPacket *arpReply;
+
+   //Point to the Ethernet header
+   header = (EthHeader *) frame;
+   //Point to the ARP message
+   arpReply = (ArpPacket *) header->data;
+
+   //Only ARP replies are of interest
+   if(length < (sizeof(EthHeader) + sizeof(ArpPacket)))
+      return;
+   if(header->type != HTONS(ETH_TYPE_ARP))
+      return;
+   if(arpReply->op != HTONS(ARP_OPCODE_ARP_REPLY))
+      return;
+
+   //The reply must be addressed to the peer
+   if(!macCompAddr(&header->destAddr, &peerMacAddr) ||
+      !macCompAddr(&arpReply->tha, &peerMacAddr) ||
+      !macCompAddr(&arpReply->sha, &interface->macAddr) ||
+      arpReply->spa != hostIpAddr || arpReply->tpa != peerIpAddr)
+   {
+      failures++;
+   }
+
+   //Count the replies
+   replyCount++;
+   osSemaphoreRelease(replySemaphore);
+}
+
+
+/**
+ * @brief Drive the receive descriptors without the TCP/IP stack
+ * @return Error code
+ **/
+
+static error_t checkDescriptors(void)
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   uint8_t *loan;
+   uint8_t *copy;
+   uint8_t *buffer;
+   uint8_t frame[256];
+   uint8_t expected[256];
+   SimEthStats stats;
+
+   //The driver signals the stack through these events
+   testInterface.nicTxEvent = osEventCreate(FALSE, FALSE);
+   testInterface.nicRxEvent = osEventCreate(FALSE, FALSE);
+
+   //Initialize the simulated controller
+   error = simEthInit(&testInterface);
+   //Any error to report?
+   if(error) return error;
+
+   //Fill the receive ring
+   for(i = 0; i < SIM_ETH_RX_BUFFER_COUNT; i++)
+   {
+      length = formatFrame(frame, i);
+      error = simEthInjectFrame(&testInterface, frame, length);
+      if(error) return error;
+   }
+
+   //The next frame cannot be received
+   length = formatFrame(frame, i);
+   if(simEthInjectFrame(&testInterface, frame, length) != ERROR_RECEIVE_QUEUE_FULL)
+      return ERROR_FAILURE;
+
+   //The first packet is loaned
+   length = simEthLoanRxBuffer(&testInterface, &loan);
+   formatFrame(expected, 0);
+   if(length != sizeof(expected) || loan == testInterface.ethFrame)
+      return ERROR_FAILURE;
+
+   //The only spare buffer is in use, so the second packet is copied
+   length = simEthLoanRxBuffer(&testInterface, &copy);
+   formatFrame(expected, 1);
+   if(length != sizeof(expected) || copy != testInterface.ethFrame ||
+      memcmp(copy, expected, length))
+   {
+      return ERROR_FAILURE;
+   }
+
+   //Give the copy back (it does not belong to the pool)
+   simEthReleaseRxBuffer(&testInterface, copy);
+
+   //Both descriptors have been re-armed and the DMA can fill them again
+   for(i = 0; i < 2; i++)
+   {
+      length = formatFrame(frame, SIM_ETH_RX_BUFFER_COUNT + i);
+      error = simEthInjectFrame(&testInterface, frame, length);
+      if(error) return error;
+   }
+
+   //The loaned buffer must not have been overwritten in the meantime
+   formatFrame(expected, 0);
+   if(memcmp(loan, expected, sizeof(expected)))
+      return ERROR_FAILURE;
+
+   //Return the loaned buffer to the pool
+   simEthReleaseRxBuffer(&testInterface, loan);
+
+   //The remaining packets are received in order, through loans
+   for(i = 2; i < SIM_ETH_RX_BUFFER_COUNT + 2; i++)
+   {
+      //Borrow the next packet
+      length = simEthLoanRxBuffer(&testInterface, &buffer);
+      formatFrame(expected, i);
+
+      //Check its contents
+      if(length != sizeof(expected) || buffer == testInterface.ethFrame ||
+         memcmp(buffer, expected, length))
+      {
+         return ERROR_FAILURE;
+      }
+
+      //Hand it back
+      simEthReleaseRxBuffer(&testInterface, buffer);
+   }
+
+   //The ring is now empty
+   if(simEthLoanRxBuffer(&testInterface, &buffer))
+      return ERROR_FAILURE;
+
+   //Check the counters
+   simEthGetStats(&stats);
+
+   //Display statistics
+   printf("Descriptors: %u received, %u overruns, %u loans, %u copies\r\n",
+      stats.rxPackets, stats.rxOverruns, stats.rxLoans, stats.rxCopies);
+
+   if(stats.rxPackets != (SIM_ETH_RX_BUFFER_COUNT + 2) || stats.rxOverruns != 1 ||
+      stats.rxLoans != (SIM_ETH_RX_BUFFER_COUNT + 1) || stats.rxCopies != 1)
+   {
+      return ERROR_FAILURE;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Answer ARP requests through the TCP/IP stack
+ * @return Error code
+ **/
+
+static error_t checkStack(void)
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   size_t length;
+   uint8_t frame[ETH_MIN_FRAME_SIZE];
+   NetInterface *interface;
+   SimEthStats stats;
+
+   //Create the semaphore used to wait for the replies
+   replySemaphore = osSemaphoreCreate(TEST_REQUEST_COUNT, 0);
+   //Out of resources?
+   if(replySemaphore == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //TCP/IP stack initialization
+   error = tcpIpStackInit();
+   //Any error to report?
+   if(error) return error;
+
+   //Point to the first interface
+   interface = &netInterface[0];
+
+   //Select the simulated controller
+   interface->nicDriver = &simEthDriver;
+   //Set MAC address
+   macStringToAddr("00-AB-CD-EF-00-01", &interface->macAddr);
+
+   //Collect the frames sent by the stack
+   simEthSetTxCallback(txCallback);
+
+   //Configure the interface
+   error = tcpIpStackConfigInterface(interface);
+   //Any error to report?
+   if(error) return error;
+
+   //Static IPv4 configuration
+   interface->ipv4Config.addr = hostIpAddr;
+   ipv4StringToAddr("255.255.255.0", &interface->ipv4Config.subnetMask);
+
+   //Send the requests in bursts that fill the receive ring
+   for(i = 0; i < TEST_REQUEST_COUNT; i += j)
+   {
+      //Inject a burst
+      for(j = 0; j < SIM_ETH_RX_BUFFER_COUNT && (i + j) < TEST_REQUEST_COUNT; j++)
+      {
+         length = formatArpRequest(frame);
+         error = simEthInjectFrame(interface, frame, length);
+         if(error) return error;
+      }
+
+      //Wait for the stack to answer the whole burst
+      while(replyCount < (i + j))
+      {
+         if(!osSemaphoreWait(replySemaphore, TEST_TIMEOUT))
+            return ERROR_TIMEOUT;
+      }
+   }
+
+   //Check the counters
+   simEthGetStats(&stats);
+
+   //Display statistics
+   printf("Stack: %u requests, %u replies, %u loans, %u copies, %u frames sent\r\n",
+      stats.rxPackets, replyCount, stats.rxLoans, stats.rxCopies, stats.txPackets);
+
+   //The spare buffer is returned after each packet, so nothing is copied
+   if(stats.rxPackets != TEST_REQUEST_COUNT || stats.rxOverruns != 0 ||
+      stats.rxLoans != TEST_REQUEST_COUNT || stats.rxCopies != 0 ||
+      stats.txPackets < TEST_REQUEST_COUNT)
+   {
+      return ERROR_FAILURE;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+
+   //Initialize debug output
+   debugInit();
+
+   //Addresses of both ends
+   macStringToAddr("00-AB-CD-EF-00-02", &peerMacAddr);
+   ipv4StringToAddr(TEST_HOST_ADDR, &hostIpAddr);
+   ipv4StringToAddr(TEST_PEER_ADDR, &peerIpAddr);
+
+   //Receive path of the driver
+   error = checkDescriptors();
+   //Display result
+   printf("Descriptor loans: %s\r\n", error ? "FAILED" : "OK");
+
+   //Receive path through the stack
+   if(!error)
+   {
+      error = checkStack();
+      //Display result
+      printf("Stack loans: %s\r\n", (error || failures) ? "FAILED" : "OK");
+   }
+
+   //Return status code
+   return (error || failures) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
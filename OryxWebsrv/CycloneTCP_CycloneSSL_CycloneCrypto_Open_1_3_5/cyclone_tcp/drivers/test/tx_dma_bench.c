@@ -0,0 +1,347 @@
+/**
+ * @file tx_dma_bench.c
+ * @brief Scatter-gather transmit benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The client end of the loopback link is driven by an emulation of the
+ * STM32F4x7 transmit path. In gather mode, every frame is first copied
+ * into a DMA buffer, as the driver did before descriptors could be chained.
+ * In chain mode, chunks flagged with CHUNK_FLAG_ZERO_COPY are referenced
+ * in place and only headers and small chunks are gathered. The loopback
+ * link then moves the frame to the peer, which stands for the DMA read.
+ * A bulk TCP transfer is run in both modes, and the number of bytes sent
+ * per CPU cycle (all tasks included) is reported
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "tcp_ip_stack.h"
+#include "loopback_eth.h"
+#include "loopback_link.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Constant definitions
+#define BENCH_PORT 5001
+#define BENCH_SIZE (256 * 1024 * 1024)
+#define BENCH_CHUNK_SIZE 8192
+
+//Maximum number of DMA descriptors per frame
+#define DMA_DESC_COUNT 4
+//Chunks smaller than this are gathered rather than referenced
+#define DMA_ZERO_COPY_THRESHOLD 128
+
+//Frame as seen by the emulated DMA (one chunk per descriptor)
+typedef struct
+{
+   uint_t chunkCount;
+   uint_t maxChunkCount;
+   ChunkDesc chunk[DMA_DESC_COUNT];
+} DmaFrame;
+
+//Forward declaration of functions
+error_t dmaEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
+//Loopback driver with the emulated transmit path
+static NicDriver dmaEthDriver;
+
+//Global variables
+bool_t dmaChain;
+uint64_t dmaCopiedBytes;
+uint8_t dmaBuffer[DMA_DESC_COUNT][LOOPBACK_ETH_RX_BUFFER_SIZE];
+OsEvent *sinkEvent;
+Socket *sinkSocket;
+size_t sinkReceived;
+
+
+/**
+ * @brief Send a packet through the emulated DMA
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+error_t dmaEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   uint_t i;
+   size_t n;
+   size_t k;
+   size_t length;
+   uint8_t *p;
+   DmaFrame frame;
+
+   //Retrieve the length of the packet
+   length = chunkedBufferGetLength(buffer) - offset;
+
+   //Each chunk of the frame is a descriptor
+   frame.chunkCount = 0;
+   frame.maxChunkCount = DMA_DESC_COUNT;
+
+   //Chain descriptors over the chunks?
+   if(dmaChain)
+   {
+      //Skip the beginning of the multi-part buffer
+      for(i = 0, k = offset; i < buffer->chunkCount && k >= buffer->chunk[i].length; i++)
+         k -= buffer->chunk[i].length;
+
+      //Loop through data chunks
+      for(n = length; i < buffer->chunkCount && n > 0; i++, k = 0)
+      {
+         //Point to the data to send
+         p = (uint8_t *) buffer->chunk[i].address + k;
+         //Number of bytes in the current chunk
+         k = min(buffer->chunk[i].length - k, n);
+
+         //Empty chunk?
+         if(!k) continue;
+
+         //Can the DMA read the chunk in place?
+         if((buffer->chunk[i].flags & CHUNK_FLAG_ZERO_COPY) && k >= DMA_ZERO_COPY_THRESHOLD)
+         {
+            //Out of descriptors?
+            if(frame.chunkCount == DMA_DESC_COUNT) break;
+
+            //The descriptor points directly to the chunk
+            frame.chunk[frame.chunkCount].address = p;
+            frame.chunk[frame.chunkCount].length = k;
+            frame.chunk[frame.chunkCount].flags = CHUNK_FLAG_ZERO_COPY;
+            frame.chunkCount++;
+         }
+         else
+         {
+            //Start a new copy descriptor unless the previous one is still open
+            if(!frame.chunkCount || frame.chunk[frame.chunkCount - 1].flags)
+            {
+               //Out of descriptors?
+               if(frame.chunkCount == DMA_DESC_COUNT) break;
+
+               //Attach a DMA buffer to the descriptor
+               frame.chunk[frame.chunkCount].address = dmaBuffer[frame.chunkCount];
+               frame.chunk[frame.chunkCount].length = 0;
+               frame.chunk[frame.chunkCount].flags = 0;
+               frame.chunkCount++;
+            }
+
+            //Gather the data in the buffer attached to the descriptor
+            memcpy((uint8_t *) frame.chunk[frame.chunkCount - 1].address +
+               frame.chunk[frame.chunkCount - 1].length, p, k);
+            frame.chunk[frame.chunkCount - 1].length += k;
+            dmaCopiedBytes += k;
+         }
+
+         //Number of bytes left to process
+         n -= k;
+      }
+
+      //Let the DMA read the chained descriptors if the whole frame fits
+      if(!n)
+         return loopbackEthSendPacket(interface, (ChunkedBuffer *) &frame, 0);
+   }
+
+   //Copy the whole frame to the DMA buffer
+   length = chunkedBufferRead(dmaBuffer[0], buffer, offset, length);
+   dmaCopiedBytes += length;
+
+   //Single descriptor
+   frame.chunk[0].address = dmaBuffer[0];
+   frame.chunk[0].length = length;
+   frame.chunk[0].flags = 0;
+   frame.chunkCount = 1;
+
+   //Let the DMA read the buffer
+   return loopbackEthSendPacket(interface, (ChunkedBuffer *) &frame, 0);
+}
+
+
+/**
+ * @brief Sink task
+ *
+ * Accepts connections one after the other and drains them
+ *
+ * @param[in] param Unused parameter
+ **/
+
+void sinkTask(void *param)
+{
+   error_t error;
+   size_t n;
+   IpAddr clientIpAddr;
+   uint16_t clientPort;
+   Socket *socket;
+   static uint8_t buffer[BENCH_CHUNK_SIZE];
+
+   //Endless loop
+   while(1)
+   {
+      //Wait for the client to connect
+      socket = socketAccept(sinkSocket, &clientIpAddr, &clientPort);
+      //Connection failed?
+      if(!socket) continue;
+
+      //Set timeout for blocking functions
+      socketSetTimeout(socket, 10000);
+
+      //Receive data until the client shuts down the connection
+      for(sinkReceived = 0; ; sinkReceived += n)
+      {
+         //Read incoming data
+         error = socketReceive(socket, buffer, sizeof(buffer), &n, 0);
+         //End of stream or error?
+         if(error) break;
+      }
+
+      //Close the connection
+      socketClose(socket);
+      //Notify the client
+      osEventSet(sinkEvent);
+   }
+}
+
+
+/**
+ * @brief Bulk TCP transfer
+ * @param[in] chain Chain descriptors over the chunks
+ * @return Error code
+ **/
+
+error_t bulkTest(bool_t chain)
+{
+   error_t error;
+   size_t n;
+   size_t sent;
+   clock_t time;
+   double cycles;
+   Socket *socket;
+   static uint8_t buffer[BENCH_CHUNK_SIZE];
+
+   //Select the transmit path
+   dmaChain = chain;
+   dmaCopiedBytes = 0;
+
+   //Connect to the sink
+   socket = loopbackLinkConnect(BENCH_PORT, 10000);
+   //Failed to connect?
+   if(!socket) return ERROR_CONNECTION_FAILED;
+
+   //Start of the transfer
+   time = clock();
+
+   //Send data
+   for(error = NO_ERROR, sent = 0; !error && sent < BENCH_SIZE; sent += n)
+      error = socketSend(socket, buffer, min(BENCH_SIZE - sent, sizeof(buffer)), &n, 0);
+
+   //Graceful shutdown
+   if(!error)
+      error = socketShutdown(socket, SOCKET_SD_SEND);
+
+   //Wait for the sink to drain the connection
+   if(!osEventWait(sinkEvent, 30000))
+      error = ERROR_TIMEOUT;
+
+   //CPU time of the whole process, converted to cycles
+   cycles = (double) (clock() - time) / CLOCKS_PER_SEC * benchGetCycleRate();
+   //Close the connection
+   socketClose(socket);
+
+   //Display results
+   printf("%-8s %11.4f %18.2f\r\n", chain ? "chain" : "gather",
+      sinkReceived / cycles, (double) dmaCopiedBytes / sinkReceived);
+
+   //Any error to report?
+   if(error) return error;
+
+   //Check the amount of data
+   if(sinkReceived != BENCH_SIZE)
+      return ERROR_FAILURE;
+
+   //Successful transfer
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+
+   //Initialize debug output
+   debugInit();
+
+   //The emulated driver only differs in the way frames are sent
+   dmaEthDriver = loopbackEthDriver;
+   dmaEthDriver.sendPacket = dmaEthSendPacket;
+
+   //Create the event used to wait for the sink task
+   sinkEvent = osEventCreate(FALSE, FALSE);
+   //Out of resources?
+   if(sinkEvent == OS_INVALID_HANDLE)
+      return EXIT_FAILURE;
+
+   //Bring up the loopback link (the client end sends the bulk data)
+   error = loopbackLinkStart(&dmaEthDriver, NULL);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the loopback link!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Open the listening socket
+   sinkSocket = loopbackLinkListen(BENCH_PORT);
+   //Failed to open socket?
+   if(!sinkSocket) return EXIT_FAILURE;
+
+   //Create the sink task
+   if(!osTaskCreate("Sink", sinkTask, NULL, 500, 1))
+      return EXIT_FAILURE;
+
+   //Display header
+   printf("%u MB per run\r\n%-8s %11s %18s\r\n", BENCH_SIZE / (1024 * 1024),
+      "TX path", "bytes/cycle", "driver copies/byte");
+
+   //Single copy buffer (before) then chained descriptors (after)
+   error = bulkTest(FALSE);
+   if(!error)
+      error = bulkTest(TRUE);
+
+   //Display result
+   printf("Scatter-gather transmit: %s\r\n", error ? "FAILED" : "OK");
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -46,6 +46,7 @@
 #include "mime.h"
 #include "ssi.h"
 #include "resource_manager.h"
+#include "gzip.h"
 #include "str.h"
 #include "debug.h"
 
@@ -73,6 +74,11 @@ static const HttpStatusCodeDesc statusCodeList[] =
    {503, "Service Unavailable"}
 };
 
+#if (NET_STATS_SUPPORT == ENABLED)
+//Time needed to service a request, once its header has been received
+NetHistogram httpServiceTimeHistogram;
+#endif
+
 
 /**
  * @brief Start HTTP server
@@ -119,8 +125,24 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
          break;
       }
 
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //Create an event object to poll the sockets
+      context->event = osEventCreate(FALSE, FALSE);
+      //Out of resources?
+      if(context->event == OS_INVALID_HANDLE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         //Exit immediately
+         break;
+      }
+
+      //Connection requests are accepted only when the socket is readable
+      error = socketSetTimeout(context->socket, 0);
+#else
       //Set timeout for blocking functions
       error = socketSetTimeout(context->socket, INFINITE_DELAY);
+#endif
       //Any error to report?
       if(error) break;
 
@@ -139,9 +161,15 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
       //Any failure to report?
       if(error) break;
 
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //Create the task that services all the connections
+      task = osTaskCreate("HTTP Server", httpEventTask,
+         context, HTTP_SERVER_STACK_SIZE, HTTP_SERVER_PRIORITY);
+#else
       //Create the HTTP server task
       task = osTaskCreate("HTTP Listener", httpListenerTask,
          context, HTTP_SERVER_STACK_SIZE, HTTP_SERVER_PRIORITY);
+#endif
 
       //Unable to create the task?
       if(task == OS_INVALID_HANDLE)
@@ -155,6 +183,10 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
    {
       //Free previously allocated resources
       osSemaphoreClose(context->semaphore);
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      if(context->event != OS_INVALID_HANDLE)
+         osEventClose(context->event);
+#endif
       //Close socket
       socketClose(context->socket);
    }
@@ -278,6 +310,21 @@ void httpConnectionTask(void *param)
          break;
       }
 
+#if (NET_STATS_SUPPORT == ENABLED)
+      //Save the time at which the request has been received
+      connection->startTime = netStatsGetTimestamp();
+#endif
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+      //Responses are not compressed unless a precompressed resource is sent
+      connection->response.gzipEncoding = FALSE;
+      connection->response.varyEncoding = FALSE;
+#endif
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+      //Only static resources are given an entity tag
+      connection->response.etag[0] = '\0';
+#endif
+
       //Debug message
       TRACE_INFO("Sending HTTP response to the client...\r\n");
 
@@ -330,6 +377,12 @@ void httpConnectionTask(void *param)
          break;
       }
 
+#if (NET_STATS_SUPPORT == ENABLED)
+      //The response has been sent
+      netHistogramAdd(&httpServiceTimeHistogram,
+         netStatsGetTimestamp() - connection->startTime);
+#endif
+
       //Check whether the connection is persistent or not
       if(!connection->request.keepAlive || !connection->response.keepAlive)
       {
@@ -367,10 +420,7 @@ void httpConnectionTask(void *param)
 error_t httpReadHeader(HttpConnection *connection)
 {
    error_t error;
-   uint_t length;
-   char_t *token;
-   char_t *p;
-   char_t *s;
+   size_t length;
 
    //Read the first line of the request
    error = socketReceive(connection->socket, connection->buffer,
@@ -383,8 +433,63 @@ error_t httpReadHeader(HttpConnection *connection)
    //Debug message
    TRACE_INFO("%s\r\n", connection->buffer);
 
+   //Parse the Request-Line
+   error = httpParseRequestLine(connection, connection->buffer);
+   //Malformed Request-Line?
+   if(error) return error;
+
+   //HTTP 0.9 does not support Full-Request
+   if(connection->request.version >= HTTP_VERSION_1_0)
+   {
+      //Parse header request fields
+      while(1)
+      {
+         //Read a complete line
+         error = socketReceive(connection->socket, connection->buffer,
+            HTTP_SERVER_BUFFER_SIZE - 1, &length, SOCKET_FLAG_BREAK_CRLF);
+
+         //Any error to report?
+         if(error)
+            return error;
+         //Unable to read any data?
+         if(!length)
+            return ERROR_INVALID_REQUEST;
+
+         //Properly terminate the string with a NULL character
+         connection->buffer[length] = '\0';
+
+         //The end of the header has been reached?
+         if(!strcmp(connection->buffer, "\r\n"))
+            break;
+
+         //Parse the current header field
+         httpParseHeaderField(connection, connection->buffer);
+      }
+   }
+
+   //Prepare to read the HTTP request body
+   httpPrepareRequestBody(connection);
+
+   //The request header has been successfully parsed
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse the Request-Line
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] line NULL-terminated Request-Line (modified)
+ * @return Error code
+ **/
+
+error_t httpParseRequestLine(HttpConnection *connection, char_t *line)
+{
+   char_t *token;
+   char_t *p;
+   char_t *s;
+
    //The Request-Line begins with a method token
-   token = strtok_r(connection->buffer, " \r\n", &p);
+   token = strtok_r(line, " \r\n", &p);
    //Unable to retrieve the method?
    if(!token) return ERROR_INVALID_REQUEST;
 
@@ -479,75 +584,93 @@ error_t httpReadHeader(HttpConnection *connection)
    //Default value for properties
    connection->request.chunkedEncoding = FALSE;
    connection->request.contentLength = 0;
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   connection->request.acceptGzipEncoding = FALSE;
+#endif
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+   connection->request.ifNoneMatch[0] = '\0';
+#endif
 
-   //HTTP 0.9 does not support Full-Request
-   if(connection->request.version >= HTTP_VERSION_1_0)
-   {
-      //Local variables
-      char_t *separator;
-      char_t *property;
-      char_t *value;
+   //The Request-Line has been successfully parsed
+   return NO_ERROR;
+}
 
-      //Parse header request fields
-      while(1)
-      {
-         //Read a complete line
-         error = socketReceive(connection->socket, connection->buffer,
-            HTTP_SERVER_BUFFER_SIZE - 1, &length, SOCKET_FLAG_BREAK_CRLF);
 
-         //Any error to report?
-         if(error)
-            return error;
-         //Unable to read any data?
-         if(!length)
-            return ERROR_INVALID_REQUEST;
+/**
+ * @brief Parse a header field of the request
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] line NULL-terminated header field (modified)
+ **/
 
-         //Properly terminate the string with a NULL character
-         connection->buffer[length] = '\0';
+void httpParseHeaderField(HttpConnection *connection, char_t *line)
+{
+   char_t *separator;
+   char_t *property;
+   char_t *value;
 
-         //The end of the header has been reached?
-         if(!strcmp(connection->buffer, "\r\n"))
-            break;
+   //Check whether a separator is present
+   separator = strchr(line, ':');
+   //Separator not found?
+   if(!separator) return;
 
-         //Check whether a separator is present
-         separator = strchr(connection->buffer, ':');
-         //Separator found?
-         if(separator)
-         {
-            //Split the line
-            *separator = '\0';
+   //Split the line
+   *separator = '\0';
 
-            //Get property name and value
-            property = strTrimWhitespace(connection->buffer);
-            value = strTrimWhitespace(separator + 1);
+   //Get property name and value
+   property = strTrimWhitespace(line);
+   value = strTrimWhitespace(separator + 1);
 
-            //Connection property found?
-            if(!strcasecmp(property, "Connection"))
-            {
-               //Check whether persistent connections are supported or not
-               if(!strcasecmp(value, "keep-alive"))
-                  connection->request.keepAlive = TRUE;
-               else if(!strcasecmp(value, "close"))
-                  connection->request.keepAlive = FALSE;
-            }
-            //Transfer-Encoding property found?
-            else if(!strcasecmp(property, "Transfer-Encoding"))
-            {
-               //Check whether chunked encoding is used
-               if(!strcasecmp(value, "chunked"))
-                  connection->request.chunkedEncoding = TRUE;
-            }
-            //Content-Length property found?
-            else if(!strcasecmp(property, "Content-Length"))
-            {
-               //Get the length of the body data
-               connection->request.contentLength = atoi(value);
-            }
-         }
-      }
+   //Connection property found?
+   if(!strcasecmp(property, "Connection"))
+   {
+      //Check whether persistent connections are supported or not
+      if(!strcasecmp(value, "keep-alive"))
+         connection->request.keepAlive = TRUE;
+      else if(!strcasecmp(value, "close"))
+         connection->request.keepAlive = FALSE;
+   }
+   //Transfer-Encoding property found?
+   else if(!strcasecmp(property, "Transfer-Encoding"))
+   {
+      //Check whether chunked encoding is used
+      if(!strcasecmp(value, "chunked"))
+         connection->request.chunkedEncoding = TRUE;
+   }
+   //Content-Length property found?
+   else if(!strcasecmp(property, "Content-Length"))
+   {
+      //Get the length of the body data
+      connection->request.contentLength = atoi(value);
+   }
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Accept-Encoding property found?
+   else if(!strcasecmp(property, "Accept-Encoding"))
+   {
+      //Check whether gzip content coding is acceptable
+      connection->request.acceptGzipEncoding = httpParseAcceptEncoding(value);
    }
+#endif
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+   //If-None-Match property found?
+   else if(!strcasecmp(property, "If-None-Match"))
+   {
+      //Lists that do not fit are ignored, which only
+      //results in a full response
+      if(strlen(value) <= HTTP_SERVER_IF_NONE_MATCH_MAX_LEN)
+         strcpy(connection->request.ifNoneMatch, value);
+   }
+#endif
+}
 
-   //Prepare to read the HTTP request body
+
+/**
+ * @brief Prepare to read the HTTP request body
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void httpPrepareRequestBody(HttpConnection *connection)
+{
+   //Chunked encoding transfer is used?
    if(connection->request.chunkedEncoding)
    {
       connection->request.byteCount = 0;
@@ -558,9 +681,6 @@ error_t httpReadHeader(HttpConnection *connection)
    {
       connection->request.byteCount = connection->request.contentLength;
    }
-
-   //The request header has been successfully parsed
-   return NO_ERROR;
 }
 
 
@@ -659,9 +779,38 @@ error_t httpWriteHeader(HttpConnection *connection)
       p += sprintf(p, "Cache-Control: post-check=0, pre-check=0\r\n");
    }
 
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+   //Static resource?
+   if(connection->response.etag[0] != '\0')
+   {
+      //Set ETag field
+      p += sprintf(p, "ETag: %s\r\n", connection->response.etag);
+
+      //Let the client cache the resource and revalidate it once stale
+      if(!connection->response.noCache)
+         p += sprintf(p, "Cache-Control: max-age=%u\r\n", HTTP_SERVER_MAX_AGE);
+   }
+#endif
+
    //Content type
    p += sprintf(p, "Content-Type: %s\r\n", connection->response.contentType);
 
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Compressed body?
+   if(connection->response.gzipEncoding)
+   {
+      //Set Content-Encoding field
+      p += sprintf(p, "Content-Encoding: gzip\r\n");
+   }
+
+   //The representation depends on the Accept-Encoding field?
+   if(connection->response.varyEncoding)
+   {
+      //Set Vary field so that caches keep both variants apart
+      p += sprintf(p, "Vary: Accept-Encoding\r\n");
+   }
+#endif
+
    //Use chunked encoding transfer?
    if(connection->response.chunkedEncoding)
    {
@@ -703,7 +852,7 @@ error_t httpWriteHeader(HttpConnection *connection)
 error_t httpReadStream(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags)
 {
    error_t error;
-   uint_t n;
+   size_t n;
 
    //No data has been read yet
    *received = 0;
@@ -801,7 +950,7 @@ error_t httpReadStream(HttpConnection *connection, void *data, size_t size, size
 error_t httpReadChunkSize(HttpConnection *connection)
 {
    error_t error;
-   uint_t n;
+   size_t n;
    char_t *end;
    char_t s[8];
 
@@ -965,6 +1114,185 @@ error_t httpCloseStream(HttpConnection *connection)
 }
 
 
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+
+/**
+ * @brief Decompress a gzip member and write the result to the client
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Pointer to the gzip member
+ * @param[in] length Length of the gzip member
+ * @return Error code
+ **/
+
+error_t httpWriteCompressedStream(HttpConnection *connection, const uint8_t *data, size_t length)
+{
+   error_t error;
+   size_t n;
+   GzipContext *context;
+
+   //Allocate an inflate context
+   context = osMemAlloc(sizeof(GzipContext));
+   //Failed to allocate memory?
+   if(!context) return ERROR_OUT_OF_MEMORY;
+
+   //Prepare to decompress the data
+   error = gzipInflateInit(context, data, length);
+
+   //Decompress the data a buffer at a time
+   while(!error)
+   {
+      //Fill the I/O buffer with decompressed data
+      error = gzipInflateRead(context, (uint8_t *) connection->buffer,
+         HTTP_SERVER_BUFFER_SIZE, &n);
+      //End of stream or decoding error?
+      if(error) break;
+
+      //Send the decompressed data
+      error = httpWriteStream(connection, connection->buffer, n);
+   }
+
+   //The whole stream has been processed?
+   if(error == ERROR_END_OF_STREAM)
+      error = NO_ERROR;
+
+   //Release the inflate context
+   osMemFree(context);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check whether the gzip content coding is acceptable
+ * @param[in] value Value of the Accept-Encoding field (modified)
+ * @return TRUE if the client accepts gzip-encoded responses, else FALSE
+ **/
+
+bool_t httpParseAcceptEncoding(char_t *value)
+{
+   char_t *token;
+   char_t *param;
+   char_t *p;
+   bool_t acceptable;
+   int_t gzip;
+   int_t any;
+
+   //Neither gzip nor the wildcard have been listed yet
+   gzip = -1;
+   any = -1;
+
+   //The field value is a comma-separated list of content codings
+   for(token = strtok_r(value, ",", &p); token != NULL; token = strtok_r(NULL, ",", &p))
+   {
+      //Split the content coding and its parameters
+      param = strchr(token, ';');
+      if(param != NULL) *(param++) = '\0';
+
+      //Remove extra whitespaces
+      token = strTrimWhitespace(token);
+
+      //Only gzip and the wildcard are relevant
+      if(strcasecmp(token, "gzip") && strcasecmp(token, "x-gzip") && strcmp(token, "*"))
+         continue;
+
+      //The content coding is acceptable unless its qvalue is 0
+      acceptable = TRUE;
+
+      //Any parameter?
+      if(param != NULL)
+      {
+         //Remove extra whitespaces
+         param = strTrimWhitespace(param);
+
+         //Check whether the qvalue is zero
+         if(!strncasecmp(param, "q=", 2))
+         {
+            for(param += 2; *param == '0' || *param == '.'; param++);
+            if(*param == '\0') acceptable = FALSE;
+         }
+      }
+
+      //Save the result
+      if(!strcmp(token, "*"))
+         any = acceptable;
+      else
+         gzip = acceptable;
+   }
+
+   //An explicit gzip entry takes precedence over the wildcard
+   if(gzip >= 0)
+      return gzip ? TRUE : FALSE;
+   else
+      return (any > 0) ? TRUE : FALSE;
+}
+
+#endif
+
+
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+
+/**
+ * @brief Check whether an entity tag appears in a list
+ *
+ * The comparison is weak as required for If-None-Match, i.e.
+ * the W/ prefix is ignored
+ *
+ * @param[in] list Comma-separated list of entity tags, or "*"
+ * @param[in] etag Entity tag of the current representation
+ * @return TRUE if the entity tag matches the list, else FALSE
+ **/
+
+bool_t httpCompareEtag(const char_t *list, const char_t *etag)
+{
+   size_t n;
+   const char_t *end;
+
+   //Weak comparison
+   if(!strncmp(etag, "W/", 2))
+      etag += 2;
+
+   //Length of the opaque tag
+   n = strlen(etag);
+
+   //Parse the list
+   while(*list != '\0')
+   {
+      //Skip separators and whitespaces
+      if(*list == ',' || *list == ' ' || *list == '\t')
+      {
+         list++;
+         continue;
+      }
+
+      //The wildcard matches any current representation
+      if(*list == '*')
+         return TRUE;
+
+      //Weak comparison
+      if(!strncmp(list, "W/", 2))
+         list += 2;
+
+      //Find the end of the entity tag
+      end = strchr(list + 1, '\"');
+      //Malformed list?
+      if(*list != '\"' || end == NULL)
+         return FALSE;
+
+      //Compare the opaque tags including the quotes
+      if((size_t) (end + 1 - list) == n && !strncmp(list, etag, n))
+         return TRUE;
+
+      //Next entity tag
+      list = end + 1;
+   }
+
+   //No match
+   return FALSE;
+}
+
+#endif
+
+
 /**
  * @brief Send HTTP response
  * @param[in] connection Structure representing an HTTP connection
@@ -976,14 +1304,94 @@ error_t httpSendResponse(HttpConnection *connection)
    error_t error;
    uint8_t *data;
    size_t length;
+   bool_t inflate;
+
+   //Send the header to the client
+   error = httpSendResponseHeader(connection, &data, &length, &inflate);
+   //Any error to report?
+   if(error) return error;
+
+   //No response body (304 response)?
+   if(!data) return NO_ERROR;
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Decompress the response body?
+   if(inflate)
+      error = httpWriteCompressedStream(connection, data, length);
+   else
+#endif
+      //Send response body
+      error = httpWriteStream(connection, data, length);
+
+   //Any error to report?
+   if(error) return error;
+
+   //Properly close output stream
+   error = httpCloseStream(connection);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Look up the requested resource and send the response header
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Pointer to the response body (NULL if there is no body)
+ * @param[out] length Length of the response body, as stored in the resource image
+ * @param[out] inflate The body must be decompressed before being sent
+ * @return Error code
+ **/
+
+error_t httpSendResponseHeader(HttpConnection *connection,
+   uint8_t **data, size_t *length, bool_t *inflate)
+{
+   error_t error;
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   uint32_t originalSize;
+   bool_t compressed = FALSE;
+#endif
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+   uint32_t tag;
+#endif
 
    //Get absolute path to the specified URI
    httpGetAbsolutePath(connection, connection->request.uri, connection->buffer);
 
+   //No response body has been selected yet
+   *data = NULL;
+   *length = 0;
+   *inflate = FALSE;
+
    //Get the resource data associated with the URI
-   error = resGetData(connection->buffer, &data, &length);
+   error = resGetData(connection->buffer, data, length);
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //The resource may have been stored in compressed form
+   if(error == ERROR_NOT_FOUND)
+   {
+      //Look for the precompressed variant
+      strcat(connection->buffer, ".gz");
+      error = resGetData(connection->buffer, data, length);
+
+      //Precompressed resource found?
+      if(!error)
+      {
+         //Retrieve the size of the uncompressed data
+         error = gzipParseHeader(*data, *length, NULL, &originalSize);
+         //Check whether the gzip member is valid
+         compressed = !error;
+      }
+   }
+#endif
+
    //The specified URI cannot be found?
-   if(error) return error;
+   if(error)
+   {
+      //No response body
+      *data = NULL;
+      //Report an error
+      return error;
+   }
 
    //Format HTTP response header
    connection->response.version = connection->request.version;
@@ -992,20 +1400,54 @@ error_t httpSendResponse(HttpConnection *connection)
    connection->response.noCache = FALSE;
    connection->response.contentType = mimeGetType(connection->request.uri);
    connection->response.chunkedEncoding = FALSE;
-   connection->response.contentLength = length;
+   connection->response.contentLength = *length;
 
-   //Send the header to the client
-   error = httpWriteHeader(connection);
-   //Any error to report?
-   if(error) return error;
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Precompressed resource?
+   if(compressed)
+   {
+      //The response depends on the Accept-Encoding field
+      connection->response.varyEncoding = TRUE;
 
-   //Send response body
-   error = httpWriteStream(connection, data, length);
-   //Any error to report?
-   if(error) return error;
+      //Send the gzip member as is if the client supports it, else
+      //decompress it on the fly
+      if(connection->request.acceptGzipEncoding)
+         connection->response.gzipEncoding = TRUE;
+      else
+         connection->response.contentLength = originalSize;
 
-   //Properly close output stream
-   error = httpCloseStream(connection);
+      //Decompress the body on the fly?
+      *inflate = !connection->response.gzipEncoding;
+   }
+#endif
+
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+   //The resource compiler tags files according to their contents
+   if(!resGetTag(connection->buffer, &tag))
+   {
+      //Each content coding is a distinct representation
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+      if(connection->response.gzipEncoding)
+         sprintf(connection->response.etag, "\"%08X-gz\"", tag);
+      else
+#endif
+         sprintf(connection->response.etag, "\"%08X\"", tag);
+
+      //The client already holds the current representation?
+      if((connection->request.method == HTTP_METHOD_GET ||
+         connection->request.method == HTTP_METHOD_HEAD) &&
+         httpCompareEtag(connection->request.ifNoneMatch, connection->response.etag))
+      {
+         //Send a 304 response, which never contains a body
+         connection->response.statusCode = 304;
+         *data = NULL;
+         return httpWriteHeader(connection);
+      }
+   }
+#endif
+
+   //Send the header to the client
+   error = httpWriteHeader(connection);
    //Return status code
    return error;
 }
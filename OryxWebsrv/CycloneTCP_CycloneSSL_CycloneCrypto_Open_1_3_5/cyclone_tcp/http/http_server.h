@@ -32,6 +32,7 @@
 //Dependencies
 #include "os.h"
 #include "socket.h"
+#include "gzip.h"
 
 //Stack size required to run the HTTP server
 #ifndef HTTP_SERVER_STACK_SIZE
@@ -62,6 +63,22 @@
    #error HTTP_SERVER_MAX_CONNECTIONS parameter is invalid
 #endif
 
+//Event-driven operation (a single task multiplexes all the connections)
+#ifndef HTTP_SERVER_EVENT_DRIVEN_SUPPORT
+   #define HTTP_SERVER_EVENT_DRIVEN_SUPPORT DISABLED
+#elif (HTTP_SERVER_EVENT_DRIVEN_SUPPORT != ENABLED && HTTP_SERVER_EVENT_DRIVEN_SUPPORT != DISABLED)
+   #error HTTP_SERVER_EVENT_DRIVEN_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of connections handled in event-driven mode. In this
+//mode, HTTP_SERVER_MAX_CONNECTIONS limits the number of requests in
+//progress, while idle persistent connections only use a table entry
+#ifndef HTTP_SERVER_EVENT_MAX_CONNECTIONS
+   #define HTTP_SERVER_EVENT_MAX_CONNECTIONS 64
+#elif (HTTP_SERVER_EVENT_MAX_CONNECTIONS < 1)
+   #error HTTP_SERVER_EVENT_MAX_CONNECTIONS parameter is invalid
+#endif
+
 //Maximum number of requests per connection
 #ifndef HTTP_SERVER_MAX_REQUESTS
    #define HTTP_SERVER_MAX_REQUESTS 1000
@@ -125,6 +142,43 @@
    #error HTTP_SERVER_SSI_MAX_RECURSION parameter is invalid
 #endif
 
+//Gzip content coding support (precompressed resources)
+#ifndef HTTP_SERVER_GZIP_TYPE_SUPPORT
+   #define HTTP_SERVER_GZIP_TYPE_SUPPORT DISABLED
+#elif (HTTP_SERVER_GZIP_TYPE_SUPPORT != ENABLED && HTTP_SERVER_GZIP_TYPE_SUPPORT != DISABLED)
+   #error HTTP_SERVER_GZIP_TYPE_SUPPORT parameter is invalid
+#endif
+
+//Entity tags and conditional requests for static resources
+#ifndef HTTP_SERVER_ETAG_SUPPORT
+   #define HTTP_SERVER_ETAG_SUPPORT ENABLED
+#elif (HTTP_SERVER_ETAG_SUPPORT != ENABLED && HTTP_SERVER_ETAG_SUPPORT != DISABLED)
+   #error HTTP_SERVER_ETAG_SUPPORT parameter is invalid
+#endif
+
+//Freshness lifetime of static resources, in seconds (0 forces
+//the client to revalidate its cached copy on every use)
+#ifndef HTTP_SERVER_MAX_AGE
+   #define HTTP_SERVER_MAX_AGE 0
+#elif (HTTP_SERVER_MAX_AGE < 0)
+   #error HTTP_SERVER_MAX_AGE parameter is invalid
+#endif
+
+//Maximum length of the If-None-Match field
+#ifndef HTTP_SERVER_IF_NONE_MATCH_MAX_LEN
+   #define HTTP_SERVER_IF_NONE_MATCH_MAX_LEN 63
+#elif (HTTP_SERVER_IF_NONE_MATCH_MAX_LEN < 15)
+   #error HTTP_SERVER_IF_NONE_MATCH_MAX_LEN parameter is invalid
+#endif
+
+//URI of the statistics web service
+#ifndef HTTP_SERVER_STATS_URI
+   #define HTTP_SERVER_STATS_URI "/stats.json"
+#endif
+
+//Maximum length of entity tags
+#define HTTP_SERVER_ETAG_MAX_LEN 15
+
 //HTTP port number
 #define HTTP_PORT 80
 //HTTPS port number (HTTP over SSL/TLS)
@@ -228,6 +282,12 @@ typedef struct
    size_t byteCount;
    bool_t firstChunk;
    bool_t lastChunk;
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   bool_t acceptGzipEncoding;                                ///<The client accepts gzip content coding
+#endif
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+   char_t ifNoneMatch[HTTP_SERVER_IF_NONE_MATCH_MAX_LEN + 1]; ///<Entity tags held by the client
+#endif
 } HttpRequest;
 
 
@@ -245,10 +305,33 @@ typedef struct
    bool_t chunkedEncoding;
    size_t contentLength;
    size_t byteCount;
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   bool_t gzipEncoding;
+   bool_t varyEncoding;
+#endif
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+   char_t etag[HTTP_SERVER_ETAG_MAX_LEN + 1];
+#endif
 } HttpResponse;
 
 
 
+/**
+ * @brief Connection states (event-driven mode)
+ **/
+
+typedef enum
+{
+   HTTP_EVENT_STATE_IDLE        = 0, ///<Waiting for a new request
+   HTTP_EVENT_STATE_READ_HEADER = 1, ///<Receiving the request header
+   HTTP_EVENT_STATE_SEND_BODY   = 2, ///<Streaming a static resource
+   HTTP_EVENT_STATE_SSI         = 3, ///<Executing a SSI script
+   HTTP_EVENT_STATE_INFLATE     = 4, ///<Decompressing a precompressed resource
+   HTTP_EVENT_STATE_FLUSH       = 5, ///<Waiting for the response to be acknowledged
+   HTTP_EVENT_STATE_SHUTDOWN    = 6  ///<Waiting for the connection to be closed
+} HttpEventState;
+
+
 /**
  * @brief HTTP server settings
  **/
@@ -264,18 +347,6 @@ typedef struct
 } HttpServerSettings;
 
 
-/**
- * @brief HTTP server context
- **/
-
-typedef struct
-{
-   HttpServerSettings settings;  ///<User settings
-   OsSemaphore *semaphore;       ///<Semaphore limiting the number of connections
-   Socket *socket;               ///<Listening socket
-} HttpServerContext;
-
-
 /**
  * @brief HTTP connection
  *
@@ -293,9 +364,61 @@ typedef struct _HttpConnection
    HttpResponse response;                              ///<HTTP response header
    char_t cgiParam[HTTP_SERVER_CGI_PARAM_MAX_LEN + 1]; ///<CGI parameter
    char_t buffer[HTTP_SERVER_BUFFER_SIZE];             ///<Memory buffer for input/output operations
+#if (NET_STATS_SUPPORT == ENABLED)
+   uint32_t startTime;                                 ///<Time at which the request header was received
+#endif
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   size_t rxLength;                                    ///<Number of header bytes received so far
+   const uint8_t *txData;                              ///<Data waiting for room in the send buffer
+   size_t txLength;                                    ///<Number of bytes waiting to be sent
+   bool_t chunkOpen;                                   ///<The current chunk-data has not been terminated
+   const char_t *ssiData;                              ///<Part of the SSI script yet to be processed
+   size_t ssiLength;                                   ///<Length of the remaining part of the script
+   size_t ssiTagLength;                                ///<Length of the directive that follows the pending text
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   GzipContext *gzipContext;                           ///<Inflate context of the resource being decompressed
+#endif
+#endif
 } HttpConnection;
 
 
+/**
+ * @brief Connection handled by the event-driven server
+ **/
+
+typedef struct
+{
+   Socket *socket;             ///<Socket (NULL if the entry is unused)
+   HttpEventState state;       ///<Current state
+   HttpConnection *connection; ///<Context of the request in progress, if any
+   time_t timestamp;           ///<Time of the last activity
+   uint_t counter;             ///<Number of requests served so far
+} HttpEventEntry;
+
+
+/**
+ * @brief HTTP server context
+ **/
+
+typedef struct
+{
+   HttpServerSettings settings;  ///<User settings
+   OsSemaphore *semaphore;       ///<Semaphore limiting the number of connections
+   Socket *socket;               ///<Listening socket
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   OsEvent *event;                                                   ///<Event object used to poll the sockets
+   uint_t requestCount;                                              ///<Number of requests in progress
+   HttpEventEntry entry[HTTP_SERVER_EVENT_MAX_CONNECTIONS];          ///<Connection table
+   SocketEventDesc eventDesc[HTTP_SERVER_EVENT_MAX_CONNECTIONS + 1]; ///<Socket descriptors to poll
+#endif
+} HttpServerContext;
+
+
+#if (NET_STATS_SUPPORT == ENABLED)
+//Time needed to service a request, once its header has been received
+extern NetHistogram httpServiceTimeHistogram;
+#endif
+
 //HTTP server related functions
 error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *settings);
 
@@ -303,6 +426,9 @@ void httpListenerTask(void *param);
 void httpConnectionTask(void *param);
 
 error_t httpReadHeader(HttpConnection *connection);
+error_t httpParseRequestLine(HttpConnection *connection, char_t *line);
+void httpParseHeaderField(HttpConnection *connection, char_t *line);
+void httpPrepareRequestBody(HttpConnection *connection);
 error_t httpWriteHeader(HttpConnection *connection);
 
 error_t httpReadStream(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags);
@@ -310,10 +436,51 @@ error_t httpWriteStream(HttpConnection *connection, const void *data, size_t len
 error_t httpReadChunkSize(HttpConnection *connection);
 error_t httpCloseStream(HttpConnection *connection);
 
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+error_t httpWriteCompressedStream(HttpConnection *connection, const uint8_t *data, size_t length);
+bool_t httpParseAcceptEncoding(char_t *value);
+#endif
+
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+bool_t httpCompareEtag(const char_t *list, const char_t *etag);
+#endif
+
 error_t httpSendResponse(HttpConnection *connection);
+error_t httpSendResponseHeader(HttpConnection *connection,
+   uint8_t **data, size_t *length, bool_t *inflate);
 error_t httpSendErrorResponse(HttpConnection *connection, uint_t statusCode, const char_t *message);
 
 void httpGetAbsolutePath(HttpConnection *connection, const char_t *relative, char_t *absolute);
 bool_t httpCompExtension(const char_t *filename, const char_t *extension);
 
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+void httpEventTask(void *param);
+void httpEventAccept(HttpServerContext *context);
+void httpEventProcess(HttpServerContext *context, HttpEventEntry *entry);
+
+error_t httpEventReadHeader(HttpConnection *connection);
+error_t httpEventParseHeader(HttpConnection *connection);
+error_t httpEventStartRequest(HttpEventEntry *entry);
+error_t httpEventStartScript(HttpEventEntry *entry);
+error_t httpEventProcessScript(HttpConnection *connection);
+error_t httpEventInflate(HttpConnection *connection);
+
+error_t httpEventWriteStream(HttpConnection *connection, const void *data, size_t length);
+error_t httpEventSendData(HttpConnection *connection);
+
+void httpEventEndRequest(HttpServerContext *context, HttpEventEntry *entry, error_t error);
+void httpEventCloseConnection(HttpServerContext *context, HttpEventEntry *entry);
+#endif
+
+#if (NET_STATS_SUPPORT == ENABLED)
+error_t httpStatsCallback(HttpConnection *connection);
+
+error_t httpStatsFormat(HttpConnection *connection, size_t *length, const char_t *format, ...);
+error_t httpStatsWriteInterfaces(HttpConnection *connection, size_t *length);
+error_t httpStatsWriteMemPools(HttpConnection *connection, size_t *length);
+error_t httpStatsWriteTcp(HttpConnection *connection, size_t *length);
+error_t httpStatsWriteHistogram(HttpConnection *connection, size_t *length,
+   const char_t *name, NetHistogram *histogram);
+#endif
+
 #endif
@@ -0,0 +1,1045 @@
+/**
+ * @file http_server_event.c
+ * @brief HTTP server (event-driven mode)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * In event-driven mode, a single task polls the listening socket and all
+ * the connection sockets. Each connection runs a small state machine, so
+ * that an idle persistent connection only costs a table entry. A request
+ * context is allocated when a request starts to arrive and released when
+ * the response has been queued. Static resources, the text of SSI
+ * scripts and precompressed resources decompressed on the fly are
+ * streamed as room becomes available in the send buffer, while SSI
+ * directives, CGI and URI callbacks run to completion as they do in
+ * the connection tasks
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "http_server.h"
+#include "mime.h"
+#include "ssi.h"
+#include "resource_manager.h"
+#include "str.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Task that services all the connections of the HTTP server
+ * @param[in] param Pointer to the HTTP server context
+ **/
+
+void httpEventTask(void *param)
+{
+   uint_t i;
+   uint_t n;
+   time_t time;
+   time_t timeout;
+   int32_t delay;
+   uint_t eventMask;
+   HttpServerContext *context;
+   HttpEventEntry *entry;
+
+   //Retrieve the HTTP server context
+   context = (HttpServerContext *) param;
+
+   //Main loop
+   while(1)
+   {
+      //Get current time
+      time = osGetTickCount();
+      //Wake up at least once per keep-alive period
+      timeout = HTTP_SERVER_TIMEOUT;
+
+      //The first descriptor refers to the listening socket
+      n = 1;
+
+      //Loop through the connection table
+      for(i = 0; i < HTTP_SERVER_EVENT_MAX_CONNECTIONS; i++)
+      {
+         //Point to the current entry
+         entry = &context->entry[i];
+         //Skip unused entries
+         if(!entry->socket) continue;
+
+         //Select the events that drive the state machine
+         switch(entry->state)
+         {
+         //Idle connection?
+         case HTTP_EVENT_STATE_IDLE:
+            //Do not read a new request until a request context is available
+            if(context->requestCount < HTTP_SERVER_MAX_CONNECTIONS)
+               eventMask = SOCKET_EVENT_RX_READY;
+            else
+               eventMask = 0;
+            break;
+         //Receiving the request header?
+         case HTTP_EVENT_STATE_READ_HEADER:
+            eventMask = SOCKET_EVENT_RX_READY;
+            break;
+         //Streaming the response body?
+         case HTTP_EVENT_STATE_SEND_BODY:
+         case HTTP_EVENT_STATE_SSI:
+         case HTTP_EVENT_STATE_INFLATE:
+            eventMask = SOCKET_EVENT_TX_READY;
+            break;
+         //Waiting for the response to be acknowledged?
+         case HTTP_EVENT_STATE_FLUSH:
+            eventMask = SOCKET_EVENT_TX_COMPLETE;
+            break;
+         //Waiting for the client to close its side of the connection?
+         default:
+            eventMask = SOCKET_EVENT_RX_SHUTDOWN;
+            break;
+         }
+
+         //Add the socket to the list of descriptors
+         context->eventDesc[n].socket = entry->socket;
+         context->eventDesc[n].eventMask = eventMask;
+         n++;
+
+         //A connection that waits for a request context may already have
+         //received its request, so it cannot expire in the meantime
+         if(!eventMask) continue;
+
+         //Time left before the connection expires
+         delay = timeCompare(entry->timestamp + HTTP_SERVER_TIMEOUT, time);
+         //Make sure the task wakes up in time to close it
+         timeout = min(timeout, max(delay, 0));
+      }
+
+      //Accept new connections as long as the table is not full
+      context->eventDesc[0].socket = context->socket;
+      context->eventDesc[0].eventMask =
+         (n <= HTTP_SERVER_EVENT_MAX_CONNECTIONS) ? SOCKET_EVENT_RX_READY : 0;
+
+      //Wait for one of the sockets to become ready
+      socketPoll(context->eventDesc, n, context->event, timeout);
+
+      //Get current time
+      time = osGetTickCount();
+
+      //Loop through the connection table in the same order
+      for(i = 0, n = 1; i < HTTP_SERVER_EVENT_MAX_CONNECTIONS; i++)
+      {
+         //Point to the current entry
+         entry = &context->entry[i];
+         //Skip unused entries
+         if(!entry->socket) continue;
+
+         //Any event to process?
+         if(context->eventDesc[n].eventFlags)
+         {
+            //Save the time of the last activity
+            entry->timestamp = time;
+            //Run the state machine of the connection
+            httpEventProcess(context, entry);
+         }
+         //Waiting for a request context?
+         else if(!context->eventDesc[n].eventMask)
+         {
+            //The inactivity timeout restarts once the connection is polled again
+            entry->timestamp = time;
+         }
+         //The connection has been inactive for too long?
+         else if(timeCompare(time, entry->timestamp + HTTP_SERVER_TIMEOUT) >= 0)
+         {
+            //Debug message
+            TRACE_INFO("HTTP connection timeout...\r\n");
+            //Close the connection
+            httpEventCloseConnection(context, entry);
+         }
+
+         //Next descriptor
+         n++;
+      }
+
+      //Any pending connection request?
+      if(context->eventDesc[0].eventFlags)
+         httpEventAccept(context);
+   }
+}
+
+
+/**
+ * @brief Accept pending connection requests
+ * @param[in] context Pointer to the HTTP server context
+ **/
+
+void httpEventAccept(HttpServerContext *context)
+{
+   uint_t i;
+   uint16_t clientPort;
+   IpAddr clientIpAddr;
+   HttpEventEntry *entry;
+   Socket *socket;
+
+   //Loop through the connection table
+   for(i = 0; i < HTTP_SERVER_EVENT_MAX_CONNECTIONS; i++)
+   {
+      //Point to the current entry
+      entry = &context->entry[i];
+      //Look for a free entry
+      if(entry->socket) continue;
+
+      //Accept an incoming connection (the listening socket does not block)
+      socket = socketAccept(context->socket, &clientIpAddr, &clientPort);
+      //No more connection requests?
+      if(!socket) break;
+
+      //Debug message
+      TRACE_INFO("Connection established with client %s port %u...\r\n",
+         ipAddrToString(&clientIpAddr, NULL), clientPort);
+
+      //Set timeout for the operations that complete synchronously
+      socketSetTimeout(socket, HTTP_SERVER_TIMEOUT);
+
+      //Initialize the entry
+      entry->socket = socket;
+      entry->state = HTTP_EVENT_STATE_IDLE;
+      entry->connection = NULL;
+      entry->timestamp = osGetTickCount();
+      entry->counter = 0;
+   }
+}
+
+
+/**
+ * @brief Run the state machine of a connection
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] entry Connection that has been signaled
+ **/
+
+void httpEventProcess(HttpServerContext *context, HttpEventEntry *entry)
+{
+   error_t error;
+   HttpConnection *connection;
+
+   //Check current state
+   switch(entry->state)
+   {
+   //Idle connection?
+   case HTTP_EVENT_STATE_IDLE:
+      //A new request is arriving
+      connection = osMemAlloc(sizeof(HttpConnection));
+
+      //Failed to allocate memory?
+      if(!connection)
+      {
+         //Close the connection
+         httpEventCloseConnection(context, entry);
+         //Exit immediately
+         return;
+      }
+
+      //Reference to the HTTP server settings
+      connection->settings = &context->settings;
+      //Reference to the semaphore
+      connection->semaphore = context->semaphore;
+      //Reference to the socket
+      connection->socket = entry->socket;
+      //No data has been received yet
+      connection->rxLength = 0;
+
+      //Default values used if the Request-Line cannot be parsed
+      connection->request.version = HTTP_VERSION_1_0;
+      connection->request.keepAlive = FALSE;
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+      //No inflate context is allocated until needed
+      connection->gzipContext = NULL;
+#endif
+
+      //Attach the request context to the connection
+      entry->connection = connection;
+      context->requestCount++;
+
+      //Debug message
+      TRACE_INFO("Receiving request...\r\n");
+      //Receive the request header
+      entry->state = HTTP_EVENT_STATE_READ_HEADER;
+
+      //Fall through...
+
+   //Receiving the request header?
+   case HTTP_EVENT_STATE_READ_HEADER:
+      //Read as much of the header as possible
+      error = httpEventReadHeader(entry->connection);
+
+      //The whole header has been received?
+      if(!error)
+      {
+#if (NET_STATS_SUPPORT == ENABLED)
+         //Save the time at which the request has been received
+         entry->connection->startTime = netStatsGetTimestamp();
+#endif
+         //Start sending the response
+         error = httpEventStartRequest(entry);
+      }
+      break;
+
+   //Streaming a static resource?
+   case HTTP_EVENT_STATE_SEND_BODY:
+      //Send the rest of the response body
+      error = httpEventSendData(entry->connection);
+
+      //Properly close output stream
+      if(!error)
+         error = httpCloseStream(entry->connection);
+      break;
+
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+   //Executing a SSI script?
+   case HTTP_EVENT_STATE_SSI:
+      //Resume the execution of the script
+      error = httpEventProcessScript(entry->connection);
+      break;
+#endif
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Decompressing a precompressed resource?
+   case HTTP_EVENT_STATE_INFLATE:
+      //Resume decompression
+      error = httpEventInflate(entry->connection);
+      break;
+#endif
+
+   //Waiting for the response to be acknowledged?
+   case HTTP_EVENT_STATE_FLUSH:
+      //Send a FIN segment (the socket does not block)
+      socketSetTimeout(entry->socket, 0);
+      error = socketShutdown(entry->socket, SOCKET_SD_BOTH);
+
+      //Wait for the client to close the connection
+      if(error == ERROR_TIMEOUT)
+         entry->state = HTTP_EVENT_STATE_SHUTDOWN;
+      else
+         httpEventCloseConnection(context, entry);
+
+      //Exit immediately
+      return;
+
+   //Waiting for the client to close its side of the connection?
+   default:
+      //Close socket
+      httpEventCloseConnection(context, entry);
+      //Exit immediately
+      return;
+   }
+
+   //The request has been completely processed?
+   if(error != ERROR_WOULD_BLOCK)
+      httpEventEndRequest(context, entry, error);
+}
+
+
+/**
+ * @brief Receive the request header without blocking
+ * @param[in] connection Structure representing an HTTP connection
+ * @return NO_ERROR once the whole header has been received,
+ *   ERROR_WOULD_BLOCK if more data is needed, else an error code
+ **/
+
+error_t httpEventReadHeader(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+   char_t *line;
+
+   //Only read the data that has already been received
+   socketSetTimeout(connection->socket, 0);
+
+   //Read the header line by line, so that the request
+   //body is left in the receive buffer
+   while(1)
+   {
+      //The whole header must fit in the buffer
+      if(connection->rxLength >= (HTTP_SERVER_BUFFER_SIZE - 1))
+      {
+         //The request cannot be processed
+         error = ERROR_INVALID_REQUEST;
+         break;
+      }
+
+      //Read data up to the end of the current line
+      error = socketReceive(connection->socket, connection->buffer + connection->rxLength,
+         HTTP_SERVER_BUFFER_SIZE - 1 - connection->rxLength, &n, SOCKET_FLAG_BREAK_CRLF);
+
+      //Partial lines are kept until the rest of the line is received
+      connection->rxLength += n;
+
+      //No more data for the moment?
+      if(error == ERROR_TIMEOUT)
+      {
+         //Wait for the rest of the header
+         error = ERROR_WOULD_BLOCK;
+         break;
+      }
+      //Connection closed or reset?
+      else if(error)
+      {
+         break;
+      }
+
+      //Incomplete line?
+      if(!n || connection->buffer[connection->rxLength - 1] != '\n')
+         continue;
+
+      //Properly terminate the string with a NULL character
+      connection->buffer[connection->rxLength] = '\0';
+
+      //The header is terminated by an empty line
+      if(connection->rxLength >= 4 &&
+         !strcmp(connection->buffer + connection->rxLength - 4, "\r\n\r\n"))
+      {
+         break;
+      }
+
+      //Point to the end of the Request-Line
+      line = strchr(connection->buffer, '\n');
+
+      //HTTP 0.9 requests only consist of a Request-Line
+      if(line == (connection->buffer + connection->rxLength - 1) &&
+         !strstr(connection->buffer, "HTTP/"))
+      {
+         break;
+      }
+   }
+
+   //Restore the timeout used by the operations that complete synchronously
+   socketSetTimeout(connection->socket, HTTP_SERVER_TIMEOUT);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Parse the request header held in the buffer
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpEventParseHeader(HttpConnection *connection)
+{
+   error_t error;
+   char_t *line;
+   char_t *next;
+
+   //Point to the Request-Line
+   line = connection->buffer;
+   //Each line is terminated by a LF character
+   next = strchr(line, '\n') + 1;
+
+   //Split the header
+   next[-1] = '\0';
+   //Debug message
+   TRACE_INFO("%s\r\n", line);
+
+   //Parse the Request-Line
+   error = httpParseRequestLine(connection, line);
+   //Malformed Request-Line?
+   if(error) return error;
+
+   //HTTP 0.9 does not support Full-Request
+   if(connection->request.version >= HTTP_VERSION_1_0)
+   {
+      //Parse header request fields
+      for(line = next; *line != '\0'; line = next)
+      {
+         //The end of the header has been reached?
+         if(!strcmp(line, "\r\n"))
+            break;
+
+         //Point to the next line
+         next = strchr(line, '\n') + 1;
+         //Split the header
+         next[-1] = '\0';
+
+         //Parse the current header field
+         httpParseHeaderField(connection, line);
+      }
+   }
+
+   //Prepare to read the HTTP request body
+   httpPrepareRequestBody(connection);
+
+   //The request header has been successfully parsed
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process a request whose header has been received
+ * @param[in] entry Connection handled by the event-driven server
+ * @return NO_ERROR if the response has been completely queued,
+ *   ERROR_WOULD_BLOCK if the response body is being streamed,
+ *   else an error code
+ **/
+
+error_t httpEventStartRequest(HttpEventEntry *entry)
+{
+   error_t error;
+   uint8_t *data;
+   size_t length;
+   bool_t inflate;
+   HttpConnection *connection;
+
+   //Point to the request context
+   connection = entry->connection;
+
+   //Parse the request header
+   error = httpEventParseHeader(connection);
+   //Any error to report?
+   if(error) return error;
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Responses are not compressed unless a precompressed resource is sent
+   connection->response.gzipEncoding = FALSE;
+   connection->response.varyEncoding = FALSE;
+#endif
+#if (HTTP_SERVER_ETAG_SUPPORT == ENABLED)
+   //Only static resources are given an entity tag
+   connection->response.etag[0] = '\0';
+#endif
+
+   //Debug message
+   TRACE_INFO("Sending HTTP response to the client...\r\n");
+
+   //Redirect to the default home page if necessary
+   if(!strcasecmp(connection->request.uri, "/"))
+      strcpy(connection->request.uri, connection->settings->defaultDocument);
+
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+   //Use server-side scripting to dynamically generate HTML code?
+   if(httpCompExtension(connection->request.uri, ".stm") ||
+      httpCompExtension(connection->request.uri, ".shtm") ||
+      httpCompExtension(connection->request.uri, ".shtml"))
+   {
+      //SSI processing (Server Side Includes)
+      return httpEventStartScript(entry);
+   }
+#endif
+
+   //Send the response header
+   error = httpSendResponseHeader(connection, &data, &length, &inflate);
+   //Any error to report?
+   if(error) return error;
+
+   //No response body (304 response)?
+   if(!data) return NO_ERROR;
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //The body must be decompressed on the fly?
+   if(inflate)
+   {
+      //Allocate an inflate context
+      connection->gzipContext = osMemAlloc(sizeof(GzipContext));
+      //Failed to allocate memory?
+      if(!connection->gzipContext)
+         return ERROR_OUT_OF_MEMORY;
+
+      //Prepare to decompress the data
+      error = gzipInflateInit(connection->gzipContext, data, length);
+      //Any error to report?
+      if(error) return error;
+
+      //Nothing is queued yet
+      connection->txLength = 0;
+      connection->chunkOpen = FALSE;
+
+      //Decompress the data as room becomes available in the send buffer
+      entry->state = HTTP_EVENT_STATE_INFLATE;
+      return httpEventInflate(connection);
+   }
+#endif
+
+   //Stream the response body
+   entry->state = HTTP_EVENT_STATE_SEND_BODY;
+
+   //Queue the contents of the resource
+   error = httpEventWriteStream(connection, data, length);
+   //Send as much data as possible
+   if(!error)
+      error = httpEventSendData(connection);
+   //Properly close output stream
+   if(!error)
+      error = httpCloseStream(connection);
+
+   //Return status code
+   return error;
+}
+
+
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+
+/**
+ * @brief Start the execution of a SSI script
+ * @param[in] entry Connection handled by the event-driven server
+ * @return Error code
+ **/
+
+error_t httpEventStartScript(HttpEventEntry *entry)
+{
+   error_t error;
+   size_t length;
+   uint8_t *data;
+   HttpConnection *connection;
+
+   //Point to the request context
+   connection = entry->connection;
+
+   //Get absolute path to the specified URI
+   httpGetAbsolutePath(connection, connection->request.uri, connection->buffer);
+
+   //Get the resource data associated with the URI
+   error = resGetData(connection->buffer, &data, &length);
+   //The specified URI cannot be found?
+   if(error) return error;
+
+   //Format HTTP response header
+   connection->response.version = connection->request.version;
+   connection->response.statusCode = 200;
+   connection->response.keepAlive = connection->request.keepAlive;
+   connection->response.noCache = FALSE;
+   connection->response.contentType = mimeGetType(connection->request.uri);
+   connection->response.chunkedEncoding = TRUE;
+
+   //Send the header to the client
+   error = httpWriteHeader(connection);
+   //Any error to report?
+   if(error) return error;
+
+   //Point to the beginning of the script
+   connection->ssiData = (char_t *) data;
+   connection->ssiLength = length;
+   connection->ssiTagLength = 0;
+   connection->txLength = 0;
+   connection->chunkOpen = FALSE;
+
+   //Execute the script
+   entry->state = HTTP_EVENT_STATE_SSI;
+   return httpEventProcessScript(connection);
+}
+
+
+/**
+ * @brief Execute a SSI script as long as the send buffer is not full
+ *
+ * The text of the script is streamed. The directives are executed
+ * synchronously, as ssiExecuteScript() does
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpEventProcessScript(HttpConnection *connection)
+{
+   error_t error;
+   int_t i;
+   int_t j;
+   size_t n;
+
+   //Parse the script
+   while(1)
+   {
+      //Send the pending text
+      error = httpEventSendData(connection);
+      //Send buffer full or failed to send data?
+      if(error) return error;
+
+      //Terminate the chunk-data by CRLF
+      if(connection->chunkOpen)
+      {
+         //The chunk is now complete
+         connection->chunkOpen = FALSE;
+
+         //Send the CRLF sequence
+         error = socketSend(connection->socket, "\r\n", 2, NULL, 0);
+         //Failed to send data?
+         if(error) return error;
+      }
+
+      //The text that has just been sent is followed by a SSI tag?
+      if(connection->ssiTagLength > 0)
+      {
+         //Retrieve the length of the directive
+         n = connection->ssiTagLength;
+         connection->ssiTagLength = 0;
+
+         //Execute the directive that follows the opening identifier
+         error = ssiProcessCommand(connection, connection->ssiData + 5,
+            n, connection->request.uri, 0);
+         //Any error to report?
+         if(error) return error;
+
+         //Advance data pointer over the SSI tag
+         connection->ssiData += n + 8;
+         connection->ssiLength -= n + 8;
+      }
+
+      //The end of the script has been reached?
+      if(!connection->ssiLength)
+         break;
+
+      //Search for any SSI tags
+      i = ssiSearchTag(connection->ssiData, connection->ssiLength, "<!--#", 5);
+
+      //Opening identifier found?
+      if(i >= 0)
+      {
+         //Search for the comment terminator
+         j = ssiSearchTag(connection->ssiData + i + 5,
+            connection->ssiLength - i - 5, "-->", 3);
+      }
+      else
+      {
+         j = -1;
+      }
+
+      //Check whether a valid SSI tag has been found?
+      if(i > 0 && j > 0)
+      {
+         //Send the part of the file that precedes the tag
+         n = i;
+         //The directive will be executed once the text has been sent
+         connection->ssiTagLength = j;
+      }
+      else
+      {
+         //Send the rest of the file
+         n = connection->ssiLength;
+      }
+
+      //Queue the text
+      error = httpEventWriteStream(connection, connection->ssiData, n);
+      //Any error to report?
+      if(error) return error;
+
+      //Advance data pointer
+      connection->ssiData += n;
+      connection->ssiLength -= n;
+   }
+
+   //Properly close output stream
+   return httpCloseStream(connection);
+}
+
+#endif
+
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+
+/**
+ * @brief Decompress a precompressed resource as long as the send buffer is not full
+ *
+ * Each call resumes the inflate context of the connection, a buffer
+ * at a time, as httpWriteCompressedStream() does in blocking mode
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpEventInflate(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+
+   //Decompress the data a buffer at a time
+   while(1)
+   {
+      //Send the pending data
+      error = httpEventSendData(connection);
+      //Send buffer full or failed to send data?
+      if(error) return error;
+
+      //Terminate the chunk-data by CRLF
+      if(connection->chunkOpen)
+      {
+         //The chunk is now complete
+         connection->chunkOpen = FALSE;
+
+         //Send the CRLF sequence
+         error = socketSend(connection->socket, "\r\n", 2, NULL, 0);
+         //Failed to send data?
+         if(error) return error;
+      }
+
+      //Fill the I/O buffer with decompressed data
+      error = gzipInflateRead(connection->gzipContext,
+         (uint8_t *) connection->buffer, HTTP_SERVER_BUFFER_SIZE, &n);
+      //End of stream or decoding error?
+      if(error) break;
+
+      //Queue the decompressed data
+      error = httpEventWriteStream(connection, connection->buffer, n);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //The whole stream has been processed?
+   if(error != ERROR_END_OF_STREAM)
+      return error;
+
+   //Properly close output stream
+   return httpCloseStream(connection);
+}
+
+#endif
+
+
+/**
+ * @brief Queue response data
+ *
+ * The chunk-size field is sent immediately, while the data
+ * are sent by httpEventSendData()
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @return Error code
+ **/
+
+error_t httpEventWriteStream(HttpConnection *connection, const void *data, size_t length)
+{
+   error_t error;
+   uint_t n;
+   char_t s[8];
+
+   //Use chunked encoding transfer?
+   if(connection->response.chunkedEncoding)
+   {
+      //Any chunk whose size is zero may terminate the
+      //data transfer and must be discarded
+      if(length > 0)
+      {
+         //The chunk-size field is a string of hex digits
+         //indicating the size of the chunk
+         n = sprintf(s, "%X\r\n", length);
+
+         //Send the chunk-size field
+         error = socketSend(connection->socket, s, n, NULL, 0);
+         //Failed to send data?
+         if(error) return error;
+
+         //The chunk-data must be terminated by CRLF
+         connection->chunkOpen = TRUE;
+      }
+   }
+   //Default encoding?
+   else
+   {
+      //The length of the body shall not exceed the value
+      //specified in the Content-Length field
+      length = min(length, connection->response.byteCount);
+      //Decrement the count of remaining bytes to transfer
+      connection->response.byteCount -= length;
+   }
+
+   //Save the data to be sent
+   connection->txData = data;
+   connection->txLength = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send queued data without blocking
+ * @param[in] connection Structure representing an HTTP connection
+ * @return NO_ERROR if all the data have been sent, ERROR_WOULD_BLOCK
+ *   if the send buffer is full, else an error code
+ **/
+
+error_t httpEventSendData(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+
+   //Nothing to send?
+   if(!connection->txLength)
+      return NO_ERROR;
+
+   //Only use the room available in the send buffer
+   socketSetTimeout(connection->socket, 0);
+
+   //Copy as much data as possible to the send buffer
+   error = socketSend(connection->socket, connection->txData,
+      connection->txLength, &n, 0);
+
+   //Advance data pointer
+   connection->txData += n;
+   connection->txLength -= n;
+
+   //The send buffer is full?
+   if(error == ERROR_TIMEOUT)
+      error = ERROR_WOULD_BLOCK;
+
+   //Restore the timeout used by the operations that complete synchronously
+   socketSetTimeout(connection->socket, HTTP_SERVER_TIMEOUT);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Complete the processing of a request
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] entry Connection handled by the event-driven server
+ * @param[in] error Status of the request
+ **/
+
+void httpEventEndRequest(HttpServerContext *context, HttpEventEntry *entry, error_t error)
+{
+   bool_t close;
+   HttpConnection *connection;
+
+   //Point to the request context
+   connection = entry->connection;
+
+   //The requested resource is not available?
+   if(error == ERROR_NOT_FOUND)
+   {
+      //Invoke user-defined callback, if any
+      if(connection->settings->uriNotFoundCallback != NULL)
+         error = connection->settings->uriNotFoundCallback(connection);
+   }
+
+   //Page not found?
+   if(error == ERROR_NOT_FOUND)
+   {
+      //Send an error 404 and keep the connection alive
+      httpSendErrorResponse(connection, 404, "The requested page could not be found");
+      //The response has been sent
+      close = FALSE;
+   }
+   //Bad request?
+   else if(error == ERROR_INVALID_REQUEST)
+   {
+      //Send an error 400
+      httpSendErrorResponse(connection, 400, "The request is badly formed");
+      //Close the connection immediately
+      close = TRUE;
+   }
+   //Internal error?
+   else if(error)
+   {
+      //Close the connection immediately
+      close = TRUE;
+   }
+   else
+   {
+      //Successful processing
+      close = FALSE;
+   }
+
+#if (NET_STATS_SUPPORT == ENABLED)
+   //The response has been queued
+   if(!close)
+   {
+      netHistogramAdd(&httpServiceTimeHistogram,
+         netStatsGetTimestamp() - connection->startTime);
+   }
+#endif
+
+   //Check whether the connection is persistent or not
+   if(!connection->request.keepAlive || !connection->response.keepAlive)
+      close = TRUE;
+
+   //Limit the number of requests per connection
+   if(++entry->counter >= HTTP_SERVER_MAX_REQUESTS)
+      close = TRUE;
+
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   //Release the inflate context, if any
+   if(connection->gzipContext)
+      osMemFree(connection->gzipContext);
+#endif
+
+   //Release the request context
+   osMemFree(connection);
+   entry->connection = NULL;
+   context->requestCount--;
+
+   //Persistent connection?
+   if(!close)
+   {
+      //Debug message
+      TRACE_INFO("Waiting for request...\r\n");
+      //Wait for the next request
+      entry->state = HTTP_EVENT_STATE_IDLE;
+   }
+   else
+   {
+      //Debug message
+      TRACE_INFO("Graceful shutdown...\r\n");
+      //Shut down the connection once the response has been acknowledged
+      entry->state = HTTP_EVENT_STATE_FLUSH;
+   }
+}
+
+
+/**
+ * @brief Close a connection
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] entry Connection handled by the event-driven server
+ **/
+
+void httpEventCloseConnection(HttpServerContext *context, HttpEventEntry *entry)
+{
+   //A request is in progress?
+   if(entry->connection)
+   {
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+      //Release the inflate context, if any
+      if(entry->connection->gzipContext)
+         osMemFree(entry->connection->gzipContext);
+#endif
+
+      //Release the request context
+      osMemFree(entry->connection);
+      entry->connection = NULL;
+      context->requestCount--;
+   }
+
+   //Debug message
+   TRACE_INFO("Close socket...\r\n");
+   //Close socket
+   socketClose(entry->socket);
+
+   //The entry is now free
+   entry->socket = NULL;
+   entry->state = HTTP_EVENT_STATE_IDLE;
+}
+
+#endif
@@ -0,0 +1,475 @@
+/**
+ * @file http_server_stats.c
+ * @brief HTTP server (statistics web service)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * httpStatsCallback() reports the counters of the TCP/IP stack and the
+ * latency histograms as a JSON document. It follows the prototype of the
+ * URI not found callback, so that it can be registered as is, or invoked
+ * from the callback of the application. The document is generated in the
+ * I/O buffer of the connection and sent with chunked encoding, whatever
+ * the number of interfaces and sockets
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "http_server.h"
+#include "mime.h"
+#include "socket.h"
+#include "tcp.h"
+#include "str.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (NET_STATS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Serve the statistics of the TCP/IP stack
+ * @param[in] connection Structure representing an HTTP connection
+ * @return ERROR_NOT_FOUND if the URI does not match HTTP_SERVER_STATS_URI,
+ *   else the status of the response
+ **/
+
+error_t httpStatsCallback(HttpConnection *connection)
+{
+   error_t error;
+   size_t length;
+
+   //Check the requested URI
+   if(strcasecmp(connection->request.uri, HTTP_SERVER_STATS_URI))
+      return ERROR_NOT_FOUND;
+
+   //Format HTTP response header
+   connection->response.version = connection->request.version;
+   connection->response.statusCode = 200;
+   connection->response.keepAlive = connection->request.keepAlive;
+   connection->response.noCache = TRUE;
+   connection->response.contentType = mimeGetType(".json");
+   connection->response.chunkedEncoding = TRUE;
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+   connection->response.gzipEncoding = FALSE;
+   connection->response.varyEncoding = FALSE;
+#endif
+
+   //Send the header to the client
+   error = httpWriteHeader(connection);
+   //Any error to report?
+   if(error) return error;
+
+   //The I/O buffer is now empty
+   length = 0;
+
+   //Open the document
+   error = httpStatsFormat(connection, &length,
+      "{\"timestampUnit\":\"%s\"", NET_STATS_TIMESTAMP_UNIT);
+
+   //Counters of each network interface
+   if(!error)
+      error = httpStatsWriteInterfaces(connection, &length);
+   //Memory pools
+   if(!error)
+      error = httpStatsWriteMemPools(connection, &length);
+   //TCP counters
+   if(!error)
+      error = httpStatsWriteTcp(connection, &length);
+
+   //Latency histograms
+   if(!error)
+      error = httpStatsFormat(connection, &length, ",\"histograms\":{");
+   if(!error)
+      error = httpStatsWriteHistogram(connection, &length, "rxLatency", &netRxLatencyHistogram);
+   if(!error)
+      error = httpStatsFormat(connection, &length, ",");
+   if(!error)
+      error = httpStatsWriteHistogram(connection, &length, "httpServiceTime", &httpServiceTimeHistogram);
+
+   //Close the document
+   if(!error)
+      error = httpStatsFormat(connection, &length, "}}\r\n");
+
+   //Send the rest of the document
+   if(!error)
+      error = httpWriteStream(connection, connection->buffer, length);
+   //Properly close output stream
+   if(!error)
+      error = httpCloseStream(connection);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Append formatted text to the document
+ *
+ * The text is appended to the I/O buffer of the connection. The contents
+ * of the buffer are sent to the client first if there is not enough room
+ * left. A single call must not generate more than 127 characters
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in,out] length Number of bytes pending in the I/O buffer
+ * @param[in] format NULL-terminated string that contains a format string
+ * @return Error code
+ **/
+
+error_t httpStatsFormat(HttpConnection *connection, size_t *length, const char_t *format, ...)
+{
+   error_t error;
+   int_t n;
+   va_list ap;
+
+   //Format the text at the end of the buffer
+   va_start(ap, format);
+   n = vsnprintf(connection->buffer + *length,
+      HTTP_SERVER_BUFFER_SIZE - *length, format, ap);
+   va_end(ap);
+
+   //Check status code
+   if(n < 0)
+      return ERROR_FAILURE;
+
+   //Not enough room in the buffer?
+   if((*length + n) >= HTTP_SERVER_BUFFER_SIZE)
+   {
+      //Send the pending data
+      error = httpWriteStream(connection, connection->buffer, *length);
+      //Any error to report?
+      if(error) return error;
+
+      //Format the text again, at the beginning of the buffer
+      va_start(ap, format);
+      n = vsnprintf(connection->buffer, HTTP_SERVER_BUFFER_SIZE, format, ap);
+      va_end(ap);
+
+      //The text must fit in an empty buffer
+      if(n < 0 || n >= HTTP_SERVER_BUFFER_SIZE)
+         return ERROR_INVALID_LENGTH;
+
+      //The buffer now holds the new text only
+      *length = 0;
+   }
+
+   //Update the number of pending bytes
+   *length += n;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Report the counters of the network interfaces
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in,out] length Number of bytes pending in the I/O buffer
+ * @return Error code
+ **/
+
+error_t httpStatsWriteInterfaces(HttpConnection *connection, size_t *length)
+{
+   error_t error;
+   uint_t i;
+   NetInterface *interface;
+   NetInterfaceStats stats;
+#if (IPV4_SUPPORT == ENABLED)
+   ArpStats arpStats;
+#endif
+
+   //Open the list of interfaces
+   error = httpStatsFormat(connection, length, ",\"interfaces\":[");
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT && !error; i++)
+   {
+      //Point to the current interface
+      interface = &netInterface[i];
+      //Take a snapshot of the statistics
+      netStatsGetInterfaceStats(interface, &stats);
+
+      //Name of the interface
+      error = httpStatsFormat(connection, length, "%s{\"name\":\"%s\"",
+         (i > 0) ? "," : "", interface->name);
+
+      //Receive counters
+      if(!error)
+      {
+         error = httpStatsFormat(connection, length,
+            ",\"rxPackets\":%u,\"rxBytes\":%u,\"rxDrops\":%u",
+            stats.rxPackets, stats.rxBytes, stats.rxDrops);
+      }
+
+      //Transmit counters
+      if(!error)
+      {
+         error = httpStatsFormat(connection, length,
+            ",\"txPackets\":%u,\"txBytes\":%u,\"txDrops\":%u",
+            stats.txPackets, stats.txBytes, stats.txDrops);
+      }
+
+      //Checksum failures
+      if(!error)
+      {
+         error = httpStatsFormat(connection, length,
+            ",\"checksumErrors\":%u", stats.checksumErrors);
+      }
+
+#if (IPV4_SUPPORT == ENABLED)
+      //ARP cache efficiency
+      if(!error)
+      {
+         arpGetStats(interface, &arpStats);
+
+         error = httpStatsFormat(connection, length,
+            ",\"arpHits\":%u,\"arpMisses\":%u,\"arpEvictions\":%u",
+            arpStats.hits, arpStats.misses, arpStats.evictions);
+      }
+#endif
+
+      //Close the description of the interface
+      if(!error)
+         error = httpStatsFormat(connection, length, "}");
+   }
+
+   //Close the list of interfaces
+   if(!error)
+      error = httpStatsFormat(connection, length, "]");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Report the usage of the memory pools
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in,out] length Number of bytes pending in the I/O buffer
+ * @return Error code
+ **/
+
+error_t httpStatsWriteMemPools(HttpConnection *connection, size_t *length)
+{
+   error_t error;
+   uint_t i;
+   MemPoolStats stats;
+
+   //Open the list of size classes
+   error = httpStatsFormat(connection, length, ",\"memPools\":[");
+
+   //Loop through the size classes
+   for(i = 0; !error && !memPoolGetStats(i, &stats); i++)
+   {
+      //Size and number of blocks
+      error = httpStatsFormat(connection, length,
+         "%s{\"blockSize\":%u,\"blockCount\":%u,\"usedCount\":%u",
+         (i > 0) ? "," : "", (uint_t) stats.blockSize, stats.blockCount, stats.usedCount);
+
+      //High-water mark, spills to a larger class and allocation failures
+      if(!error)
+      {
+         error = httpStatsFormat(connection, length,
+            ",\"highWaterMark\":%u,\"spillCount\":%u,\"failCount\":%u}",
+            stats.highWaterMark, stats.spillCount, stats.failCount);
+      }
+   }
+
+   //Close the list of size classes
+   if(!error)
+      error = httpStatsFormat(connection, length, "]");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Report the TCP counters, globally and per connection
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in,out] length Number of bytes pending in the I/O buffer
+ * @return Error code
+ **/
+
+error_t httpStatsWriteTcp(HttpConnection *connection, size_t *length)
+{
+   error_t error;
+   uint_t i;
+   bool_t first;
+   TcpState state;
+   uint16_t localPort;
+   uint16_t remotePort;
+   TcpStats stats;
+   TcpSocketStats socketStats;
+   Socket *socket;
+
+   //Take a snapshot of the global counters
+   tcpGetStats(&stats);
+
+   //Loss recovery
+   error = httpStatsFormat(connection, length,
+      ",\"tcp\":{\"retransmits\":%u,\"timeouts\":%u,\"dupAcks\":%u",
+      stats.retransmits, stats.timeouts, stats.dupAcks);
+
+   if(!error)
+   {
+      error = httpStatsFormat(connection, length,
+         ",\"fastRecoveries\":%u,\"sackRecoveries\":%u",
+         stats.fastRecoveries, stats.sackRecoveries);
+   }
+
+   //Acknowledgments
+   if(!error)
+   {
+      error = httpStatsFormat(connection, length,
+         ",\"ackSent\":%u,\"ackDelayed\":%u",
+         stats.ackSent, stats.ackDelayed);
+   }
+
+   if(!error)
+   {
+      error = httpStatsFormat(connection, length,
+         ",\"ackPiggybacked\":%u,\"ackTimeouts\":%u",
+         stats.ackPiggybacked, stats.ackTimeouts);
+   }
+
+   //Open the list of connections
+   if(!error)
+      error = httpStatsFormat(connection, length, ",\"sockets\":[");
+
+   //Loop through the socket table
+   for(i = 0, first = TRUE; i < SOCKET_MAX_COUNT && !error; i++)
+   {
+      //Point to the current socket
+      socket = &socketTable[i];
+
+      //The socket table must not be locked while data are sent
+      osMutexAcquire(socketMutex);
+
+      //Take a snapshot of the connection
+      state = socket->state;
+      localPort = socket->localPort;
+      remotePort = socket->remotePort;
+      socketStats = socket->stats;
+
+      //Skip the sockets that are not TCP connections
+      if(socket->type != SOCKET_TYPE_STREAM)
+         state = TCP_STATE_CLOSED;
+
+      //Release exclusive access to the socket table
+      osMutexRelease(socketMutex);
+
+      //Skip closed sockets
+      if(state == TCP_STATE_CLOSED)
+         continue;
+
+      //Identify the connection
+      error = httpStatsFormat(connection, length,
+         "%s{\"localPort\":%u,\"remotePort\":%u,\"state\":%u",
+         first ? "" : ",", localPort, remotePort, state);
+
+      //Loss recovery
+      if(!error)
+      {
+         error = httpStatsFormat(connection, length,
+            ",\"retransmits\":%u,\"timeouts\":%u,\"dupAcks\":%u",
+            socketStats.retransmits, socketStats.timeouts, socketStats.dupAcks);
+      }
+
+      if(!error)
+      {
+         error = httpStatsFormat(connection, length,
+            ",\"fastRecoveries\":%u,\"sackRecoveries\":%u}",
+            socketStats.fastRecoveries, socketStats.sackRecoveries);
+      }
+
+      //At least one connection has been reported
+      first = FALSE;
+   }
+
+   //Close the list of connections
+   if(!error)
+      error = httpStatsFormat(connection, length, "]}");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Report a latency histogram
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in,out] length Number of bytes pending in the I/O buffer
+ * @param[in] name Name of the histogram
+ * @param[in] histogram Pointer to the histogram
+ * @return Error code
+ **/
+
+error_t httpStatsWriteHistogram(HttpConnection *connection, size_t *length,
+   const char_t *name, NetHistogram *histogram)
+{
+   error_t error;
+   uint_t i;
+   uint32_t mean;
+   NetHistogram copy;
+
+   //Take a consistent snapshot of the histogram
+   netHistogramGet(histogram, &copy);
+
+   //Compute the mean value of the samples
+   if(copy.count > 0)
+      mean = (uint32_t) (copy.sum / copy.count);
+   else
+      mean = 0;
+
+   //Summary of the samples
+   error = httpStatsFormat(connection, length,
+      "\"%s\":{\"count\":%u,\"min\":%u,\"max\":%u,\"mean\":%u",
+      name, copy.count, copy.min, copy.max, mean);
+
+   //Open the list of buckets
+   if(!error)
+      error = httpStatsFormat(connection, length, ",\"buckets\":[");
+
+   //Number of samples per power of two
+   for(i = 0; i < NET_STATS_HISTOGRAM_SIZE && !error; i++)
+   {
+      error = httpStatsFormat(connection, length, "%s%u",
+         (i > 0) ? "," : "", copy.bucket[i]);
+   }
+
+   //Close the description of the histogram
+   if(!error)
+      error = httpStatsFormat(connection, length, "]}");
+
+   //Return status code
+   return error;
+}
+
+#endif
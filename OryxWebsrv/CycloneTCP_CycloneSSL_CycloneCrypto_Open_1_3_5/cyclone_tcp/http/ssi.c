@@ -118,45 +118,10 @@ error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t l
          data += i + 5;
          length -= i + 5;
 
-         //Include command found?
-         if(j > 7 && !strncasecmp(data, "include", 7))
-         {
-            //Process SSI include directive
-            error = ssiProcessIncludeCommand(connection, data, j, uri, level);
-         }
-         //Echo command found?
-         else if(j > 4 && !strncasecmp(data, "echo", 4))
-         {
-            //Process SSI echo directive
-            error = ssiProcessEchoCommand(connection, data, j);
-         }
-         //Exec command found?
-         else if(j > 4 && !strncasecmp(data, "exec", 4))
-         {
-            //Process SSI exec directive
-            error = ssiProcessExecCommand(connection, data, j);
-         }
-         //Unknown command?
-         else
-         {
-            //The server is unable to decode the SSI tag
-            error = ERROR_INVALID_TAG;
-         }
-
-         //Check whether the tag was successfully decoded or not
-         if(error == ERROR_INVALID_TAG)
-         {
-            //Report a warning to the user
-            error = httpWriteStream(connection, "Warning: Invalid SSI Tag", 24);
-            //Failed to send data?
-            if(error) return error;
-         }
-         //Any other error to report?
-         else if(error)
-         {
-            //Exit immediately
-            return error;
-         }
+         //Execute the SSI directive
+         error = ssiProcessCommand(connection, data, j, uri, level);
+         //Any error to report?
+         if(error) return error;
 
          //Advance data pointer over the SSI tag
          data += j + 3;
@@ -183,6 +148,58 @@ error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t l
 }
 
 
+/**
+ * @brief Execute a single SSI directive
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] tag Pointer to the directive (following the opening identifier)
+ * @param[in] length Length of the directive
+ * @param[in] uri NULL terminated string containing the file being processed
+ * @param[in] level Current level of recursion
+ * @return Error code
+ **/
+
+error_t ssiProcessCommand(HttpConnection *connection,
+   const char_t *tag, size_t length, const char_t *uri, uint_t level)
+{
+   error_t error;
+
+   //Include command found?
+   if(length > 7 && !strncasecmp(tag, "include", 7))
+   {
+      //Process SSI include directive
+      error = ssiProcessIncludeCommand(connection, tag, length, uri, level);
+   }
+   //Echo command found?
+   else if(length > 4 && !strncasecmp(tag, "echo", 4))
+   {
+      //Process SSI echo directive
+      error = ssiProcessEchoCommand(connection, tag, length);
+   }
+   //Exec command found?
+   else if(length > 4 && !strncasecmp(tag, "exec", 4))
+   {
+      //Process SSI exec directive
+      error = ssiProcessExecCommand(connection, tag, length);
+   }
+   //Unknown command?
+   else
+   {
+      //The server is unable to decode the SSI tag
+      error = ERROR_INVALID_TAG;
+   }
+
+   //Check whether the tag was successfully decoded or not
+   if(error == ERROR_INVALID_TAG)
+   {
+      //Report a warning to the user
+      error = httpWriteStream(connection, "Warning: Invalid SSI Tag", 24);
+   }
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Process SSI include directive
  *
@@ -301,7 +318,22 @@ error_t ssiProcessIncludeCommand(HttpConnection *connection,
 
       //Send the contents of the requested file
       if(!error)
+      {
          error = httpWriteStream(connection, data, length);
+      }
+#if (HTTP_SERVER_GZIP_TYPE_SUPPORT == ENABLED)
+      //The file may have been stored in compressed form
+      else if(error == ERROR_NOT_FOUND)
+      {
+         //Look for the precompressed variant
+         strcat(connection->buffer, ".gz");
+         error = resGetData(connection->buffer, &data, &length);
+
+         //Included files are always sent uncompressed
+         if(!error)
+            error = httpWriteCompressedStream(connection, data, length);
+      }
+#endif
    }
 
    //Cannot found the specified resource?
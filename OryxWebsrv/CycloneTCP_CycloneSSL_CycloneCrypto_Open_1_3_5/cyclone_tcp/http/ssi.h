@@ -36,6 +36,9 @@
 //SSI related functions
 error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t level);
 
+error_t ssiProcessCommand(HttpConnection *connection,
+   const char_t *tag, size_t length, const char_t *uri, uint_t level);
+
 error_t ssiProcessIncludeCommand(HttpConnection *connection,
    const char_t *tag, size_t length, const char_t *uri, uint_t level);
 
@@ -0,0 +1,703 @@
+/**
+ * @file http_load_bench.c
+ * @brief HTTP server load generator
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The HTTP server runs on the server end of the loopback link, in the
+ * mode selected at compile time (one task per connection, or event-driven,
+ * see demo/posix/Makefile). A precompressed resource larger than the send
+ * buffer is first fetched with and without gzip support, so that on-the-fly
+ * decompression has to be resumed several times. In event-driven mode, a
+ * request sent over an idle keep-alive connection while all the request
+ * contexts are busy must still be answered once they become available,
+ * even after the inactivity timeout has elapsed. Then a number of client
+ * tasks issue requests over persistent connections, reconnecting whenever
+ * the server closes or refuses a connection. The number of requests per
+ * second and the latency percentiles are reported. Requests that still fail
+ * after 100 attempts are counted as failures, which is expected only when
+ * there are more clients than the server can handle connections
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "os.h"
+#include "tcp_ip_stack.h"
+#include "ethernet.h"
+#include "http_server.h"
+#include "loopback_link.h"
+#include "res_image.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Default load
+#define BENCH_CLIENT_COUNT 8
+#define BENCH_REQUEST_COUNT 500
+//Maximum number of client tasks
+#define BENCH_MAX_CLIENT_COUNT 64
+//Size of the text stored as a precompressed resource
+#define BENCH_TEXT_SIZE (64 * 1024)
+//Size of the buffer of each client
+#define BENCH_BUFFER_SIZE 2048
+
+//Name of the server mode being measured, and number of connections it can serve
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   #define BENCH_MODE "event-driven"
+   #define BENCH_CAPACITY HTTP_SERVER_EVENT_MAX_CONNECTIONS
+#else
+   #define BENCH_MODE "task per connection"
+   #define BENCH_CAPACITY HTTP_SERVER_MAX_CONNECTIONS
+#endif
+
+//Static page used by the load phase
+static const char_t indexPage[] =
+   "<!doctype html>\r\n"
+   "<html><head><title>CycloneTCP</title></head>\r\n"
+   "<body><p>Served over the loopback link</p></body></html>\r\n";
+
+//Bit stream writer
+typedef struct
+{
+   uint8_t *data;
+   size_t size;
+   size_t length;
+   uint32_t bitBuffer;
+   uint_t bitCount;
+} BitWriter;
+
+//Global variables
+uint8_t res[256 * 1024];
+HttpServerSettings httpServerSettings;
+HttpServerContext httpServerContext;
+static char_t text[BENCH_TEXT_SIZE];
+static uint8_t member[BENCH_TEXT_SIZE + 1024];
+static size_t memberLength;
+static char_t response[2 * BENCH_TEXT_SIZE];
+static uint_t clientCount;
+static uint_t requestCount;
+static uint32_t *latency;
+static uint_t reconnectCount;
+static uint_t failureCount;
+static OsSemaphore *doneSemaphore;
+
+
+/**
+ * @brief Write bits to the stream (least significant bit first)
+ **/
+
+static void bitWrite(BitWriter *writer, uint32_t value, uint_t n)
+{
+   //Append the bits to the bit buffer
+   writer->bitBuffer |= value << writer->bitCount;
+   writer->bitCount += n;
+
+   //Flush complete bytes
+   while(writer->bitCount >= 8)
+   {
+      if(writer->length < writer->size)
+         writer->data[writer->length++] = writer->bitBuffer & 0xFF;
+
+      writer->bitBuffer >>= 8;
+      writer->bitCount -= 8;
+   }
+}
+
+
+/**
+ * @brief Write a Huffman code (most significant bit first)
+ **/
+
+static void bitWriteCode(BitWriter *writer, uint32_t code, uint_t n)
+{
+   uint_t i;
+   uint32_t value;
+
+   //Reverse the order of the bits
+   for(value = 0, i = 0; i < n; i++)
+      value |= ((code >> i) & 1) << (n - 1 - i);
+
+   //Write the code
+   bitWrite(writer, value, n);
+}
+
+
+/**
+ * @brief Build a gzip member
+ *
+ * The first half of the data is stored in a stored block, the second half
+ * in a block using the fixed Huffman code, so that both kinds of blocks
+ * are decoded by the server
+ *
+ * @param[out] output Buffer where to store the gzip member
+ * @param[in] size Size of the output buffer
+ * @param[in] data Data to compress
+ * @param[in] length Length of the data (at most 64 KB)
+ * @return Length of the gzip member
+ **/
+
+static size_t gzipBuildMember(uint8_t *output, size_t size, const uint8_t *data, size_t length)
+{
+   size_t i;
+   size_t n;
+   uint32_t crc;
+   BitWriter writer;
+
+   //Header (no optional fields, unknown OS)
+   static const uint8_t header[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 255};
+
+   //Initialize the bit stream writer
+   memcpy(output, header, sizeof(header));
+   writer.data = output;
+   writer.size = size;
+   writer.length = sizeof(header);
+   writer.bitBuffer = 0;
+   writer.bitCount = 0;
+
+   //Length of the stored block
+   n = length / 2;
+
+   //Stored block (BFINAL = 0, BTYPE = 00), aligned on a byte boundary
+   bitWrite(&writer, 0, 3);
+   bitWrite(&writer, 0, 8 - writer.bitCount);
+   bitWrite(&writer, n, 16);
+   bitWrite(&writer, n ^ 0xFFFF, 16);
+
+   //Copy the data
+   for(i = 0; i < n; i++)
+      bitWrite(&writer, data[i], 8);
+
+   //Fixed Huffman block (BFINAL = 1, BTYPE = 01)
+   bitWrite(&writer, 1, 1);
+   bitWrite(&writer, 1, 2);
+
+   //Literals only
+   for(; i < length; i++)
+   {
+      if(data[i] < 144)
+         bitWriteCode(&writer, 0x30 + data[i], 8);
+      else
+         bitWriteCode(&writer, 0x190 + data[i] - 144, 9);
+   }
+
+   //End of block
+   bitWriteCode(&writer, 0, 7);
+   //Flush the last bits
+   bitWrite(&writer, 0, 7);
+
+   //The CRC of the uncompressed data is the Ethernet CRC
+   crc = ethCalcCrc(data, length);
+
+   //Trailer
+   bitWrite(&writer, crc & 0xFFFF, 16);
+   bitWrite(&writer, crc >> 16, 16);
+   bitWrite(&writer, length & 0xFFFF, 16);
+   bitWrite(&writer, length >> 16, 16);
+
+   //Return the length of the gzip member
+   return writer.length;
+}
+
+
+/**
+ * @brief Fetch the precompressed resource with and without gzip support
+ * @return Error code
+ **/
+
+static error_t checkInflate(void)
+{
+   error_t error;
+   uint_t statusCode;
+   size_t length;
+   char_t *body;
+
+   //The client does not accept gzip, so the server decompresses the body
+   error = loopbackLinkHttpGet("/text.txt", NULL, response,
+      sizeof(response), &statusCode, &body, &length);
+   //Any error to report?
+   if(error) return error;
+
+   //Display result
+   printf("HTTP: GET /text.txt -> %u (%u bytes, inflated)\r\n", statusCode, (uint_t) length);
+
+   //Check the decompressed body
+   if(statusCode != 200 || length != sizeof(text) || memcmp(body, text, length))
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //The client accepts gzip, so the member is sent as is
+   error = loopbackLinkHttpGet("/text.txt", "Accept-Encoding: gzip\r\n", response,
+      sizeof(response), &statusCode, &body, &length);
+   //Any error to report?
+   if(error) return error;
+
+   //Display result
+   printf("HTTP: GET /text.txt -> %u (%u bytes, gzip)\r\n", statusCode, (uint_t) length);
+
+   //Check the compressed body
+   if(statusCode != 200 || length != memberLength || memcmp(body, member, length))
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read the response to a request for the static page
+ * @param[in] socket Connected socket
+ * @param[in] buffer Buffer used to hold the response
+ * @return Error code
+ **/
+
+static error_t clientReadResponse(Socket *socket, char_t *buffer)
+{
+   error_t error;
+   size_t n;
+   size_t length;
+   char_t *p;
+
+   //Read the response header
+   for(length = 0, p = NULL; !p; length += n)
+   {
+      //The header must fit in the buffer
+      if(length >= (BENCH_BUFFER_SIZE - 1))
+         return ERROR_INVALID_SYNTAX;
+
+      //Read incoming data
+      error = socketReceive(socket, buffer + length, BENCH_BUFFER_SIZE - 1 - length, &n, 0);
+      //Connection closed or reset?
+      if(error) return error;
+
+      //Look for the end of the header
+      buffer[length + n] = '\0';
+      p = strstr(buffer, "\r\n\r\n");
+   }
+
+   //Check the status code
+   if(strncmp(buffer, "HTTP/1.1 200", 12))
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //Read the rest of the body
+   for(n = length - (p + 4 - buffer); n < sizeof(indexPage) - 1; n += length)
+   {
+      //Read incoming data
+      error = socketReceive(socket, buffer, BENCH_BUFFER_SIZE, &length, 0);
+      //Connection closed or reset?
+      if(error) return error;
+   }
+
+   //The whole body has been received
+   return (n == sizeof(indexPage) - 1) ? NO_ERROR : ERROR_UNEXPECTED_RESPONSE;
+}
+
+
+/**
+ * @brief Issue a request over a persistent connection
+ * @param[in] socket Connected socket
+ * @param[in] buffer Buffer used to hold the response
+ * @return Error code
+ **/
+
+static error_t clientRequest(Socket *socket, char_t *buffer)
+{
+   error_t error;
+   size_t n;
+
+   //Format the request
+   n = sprintf(buffer, "GET /index.htm HTTP/1.1\r\nHost: %s\r\n\r\n", LOOPBACK_LINK_SERVER_ADDR);
+
+   //Send the request
+   error = socketSend(socket, buffer, n, NULL, 0);
+   //Failed to send data?
+   if(error) return error;
+
+   //Read the response
+   return clientReadResponse(socket, buffer);
+}
+
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+
+/**
+ * @brief Keep a request waiting while all the request contexts are in use
+ *
+ * A first connection completes one request and goes idle. Every request
+ * context is then held by connections that trickle their request header,
+ * and the first connection sends its next request, which the server cannot
+ * read yet. The request contexts stay busy for longer than the inactivity
+ * timeout, after which the pending request must still be answered
+ *
+ * @param[in] buffer Buffer used to hold the responses
+ * @return Error code
+ **/
+
+static error_t checkRequestCap(char_t *buffer)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   time_t time;
+   Socket *waiter;
+   Socket *staller[HTTP_SERVER_MAX_CONNECTIONS];
+
+   //No connection is open yet
+   memset(staller, 0, sizeof(staller));
+
+   //The pending request is answered only after the inactivity timeout
+   waiter = loopbackLinkConnect(80, 3 * HTTP_SERVER_TIMEOUT);
+   //Failed to connect?
+   if(!waiter) return ERROR_CONNECTION_FAILED;
+
+   //Leave the connection idle after a first request
+   error = clientRequest(waiter, buffer);
+
+   //Hold all the request contexts
+   for(i = 0; !error && i < HTTP_SERVER_MAX_CONNECTIONS; i++)
+   {
+      //Open a new connection
+      staller[i] = loopbackLinkConnect(80, 3 * HTTP_SERVER_TIMEOUT);
+      //Failed to connect?
+      if(!staller[i]) error = ERROR_CONNECTION_FAILED;
+
+      //Send the beginning of the request header
+      if(!error)
+      {
+         n = sprintf(buffer, "GET /index.htm HTTP/1.1\r\n");
+         error = socketSend(staller[i], buffer, n, NULL, 0);
+      }
+   }
+
+   //Send the next request over the idle connection
+   if(!error)
+   {
+      n = sprintf(buffer, "GET /index.htm HTTP/1.1\r\nHost: %s\r\n\r\n",
+         LOOPBACK_LINK_SERVER_ADDR);
+      error = socketSend(waiter, buffer, n, NULL, 0);
+   }
+
+   //Keep the request contexts busy beyond the inactivity timeout
+   for(time = 0; !error && time < 3 * HTTP_SERVER_TIMEOUT / 2; time += 500)
+   {
+      //Wait for a while
+      osDelay(500);
+
+      //Send one more header field on each connection
+      for(i = 0; !error && i < HTTP_SERVER_MAX_CONNECTIONS; i++)
+      {
+         n = sprintf(buffer, "X-Delay: %u\r\n", (uint_t) time);
+         error = socketSend(staller[i], buffer, n, NULL, 0);
+      }
+   }
+
+   //Complete the stalled requests
+   for(i = 0; !error && i < HTTP_SERVER_MAX_CONNECTIONS; i++)
+   {
+      //Send the end of the request header
+      error = socketSend(staller[i], "\r\n", 2, NULL, 0);
+      //Read the response
+      if(!error)
+         error = clientReadResponse(staller[i], buffer);
+   }
+
+   //The pending request must be answered
+   if(!error)
+      error = clientReadResponse(waiter, buffer);
+
+   //Close the connections
+   for(i = 0; i < HTTP_SERVER_MAX_CONNECTIONS; i++)
+   {
+      if(staller[i])
+         socketClose(staller[i]);
+   }
+
+   socketClose(waiter);
+
+   //Return status code
+   return error;
+}
+
+#endif
+
+
+/**
+ * @brief Client task
+ * @param[in] param Index of the client
+ **/
+
+void clientTask(void *param)
+{
+   error_t error;
+   uint_t i;
+   uint_t index;
+   uint_t attempts;
+   uint64_t time;
+   Socket *socket;
+   char_t *buffer;
+
+   //Index of the client
+   index = (uint_t) (uintptr_t) param;
+   //Allocate the response buffer
+   buffer = osMemAlloc(BENCH_BUFFER_SIZE);
+
+   //Not connected yet
+   socket = NULL;
+
+   //Issue the requests
+   for(i = 0; buffer && i < requestCount; i++)
+   {
+      //Start of the request
+      time = benchGetTime();
+
+      //The request is retried on a new connection if the server
+      //closes or refuses the current one
+      for(error = ERROR_FAILURE, attempts = 0; error && attempts < 100; attempts++)
+      {
+         //Connection closed by the server?
+         if(socket && attempts > 0)
+         {
+            //Close the socket
+            socketClose(socket);
+            socket = NULL;
+
+            //Back off before reconnecting
+            osDelay(10);
+            //Update statistics
+            osTaskSuspendAll();
+            reconnectCount++;
+            osTaskResumeAll();
+         }
+
+         //Open a persistent connection
+         if(!socket)
+            socket = loopbackLinkConnect(80, 5000);
+
+         //Issue the request
+         if(socket)
+            error = clientRequest(socket, buffer);
+      }
+
+      //Save the latency of the request, in microseconds
+      latency[index * requestCount + i] = (benchGetTime() - time) / 1000;
+
+      //Failed request?
+      if(error)
+      {
+         osTaskSuspendAll();
+         failureCount++;
+         osTaskResumeAll();
+      }
+   }
+
+   //Close the connection
+   if(socket)
+      socketClose(socket);
+
+   //Release resources
+   osMemFree(buffer);
+
+   //Notify the main task
+   osSemaphoreRelease(doneSemaphore);
+   //Kill ourselves
+   osTaskDelete(NULL);
+}
+
+
+/**
+ * @brief Load phase
+ * @return Error code
+ **/
+
+static error_t loadTest(void)
+{
+   uint_t i;
+   uint_t n;
+   uint64_t time;
+
+   //Total number of requests
+   n = clientCount * requestCount;
+
+   //Allocate the latency table
+   latency = osMemAlloc(n * sizeof(uint32_t));
+   //Failed to allocate memory?
+   if(!latency) return ERROR_OUT_OF_MEMORY;
+
+   //Create the semaphore used to wait for the clients
+   doneSemaphore = osSemaphoreCreate(clientCount, 0);
+   //Out of resources?
+   if(doneSemaphore == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Start of the load phase
+   time = benchGetTime();
+
+   //Create the client tasks
+   for(i = 0; i < clientCount; i++)
+   {
+      if(!osTaskCreate("Client", clientTask, (void *) (uintptr_t) i, 500, 1))
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Wait for all the clients to complete
+   for(i = 0; i < clientCount; i++)
+      osSemaphoreWait(doneSemaphore, INFINITE_DELAY);
+
+   //End of the load phase
+   time = benchGetTime() - time;
+
+   //Display results
+   printf("%-20s %7u %8u %10.0f %8u %8u %8u %10u\r\n", BENCH_MODE, clientCount, n,
+      n * 1e9 / (time ? time : 1), benchPercentile(latency, n, 50),
+      benchPercentile(latency, n, 99), reconnectCount, failureCount);
+
+   //Release resources
+   osMemFree(latency);
+
+   //Connections beyond the capacity of the server are refused, otherwise
+   //every request must eventually succeed
+   return (failureCount && clientCount <= BENCH_CAPACITY) ? ERROR_FAILURE : NO_ERROR;
+}
+
+
+/**
+ * @brief Main entry point
+ * @param[in] argc Number of arguments
+ * @param[in] argv Number of clients and number of requests per client (optional)
+ * @return Exit status
+ **/
+
+int_t main(int_t argc, char_t *argv[])
+{
+   error_t error;
+   size_t i;
+   ResImageFile files[2];
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   char_t *buffer;
+#endif
+
+   //Load to generate
+   clientCount = (argc > 1) ? atoi(argv[1]) : BENCH_CLIENT_COUNT;
+   requestCount = (argc > 2) ? atoi(argv[2]) : BENCH_REQUEST_COUNT;
+
+   //Check parameters
+   if(clientCount < 1 || clientCount > BENCH_MAX_CLIENT_COUNT || requestCount < 1)
+      return EXIT_FAILURE;
+
+   //Initialize debug output
+   debugInit();
+
+   //Generate the text of the precompressed resource
+   for(i = 0; i < sizeof(text); i++)
+      text[i] = (i % 64 == 63) ? '\n' : ' ' + (i * 7 + i / 64) % 95;
+
+   //Compress it
+   memberLength = gzipBuildMember(member, sizeof(member), (uint8_t *) text, sizeof(text));
+
+   //Contents of the resource image
+   files[0].path = "www/index.htm";
+   files[0].data = indexPage;
+   files[0].length = sizeof(indexPage) - 1;
+   files[1].path = "www/text.txt.gz";
+   files[1].data = member;
+   files[1].length = memberLength;
+
+   //Build the resource image
+   error = resImageBuild(res, sizeof(res), files, arraysize(files), TRUE);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to build resource image!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Bring up the loopback link
+   error = loopbackLinkStart(NULL, NULL);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the loopback link!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Clear HTTP server settings
+   memset(&httpServerSettings, 0, sizeof(httpServerSettings));
+   //Bind HTTP server to the server end of the link
+   httpServerSettings.interface = LOOPBACK_LINK_SERVER;
+   //Listen to port 80
+   httpServerSettings.port = 80;
+   //Specify the server's root directory
+   strcpy(httpServerSettings.rootDirectory, "/www/");
+   //Set default home page
+   strcpy(httpServerSettings.defaultDocument, "index.htm");
+
+   //Start HTTP server
+   error = httpServerStart(&httpServerContext, &httpServerSettings);
+   //Failed to start HTTP server?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start HTTP server!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //On-the-fly decompression
+   error = checkInflate();
+   //Display result
+   printf("Inflate (%s): %s\r\n", BENCH_MODE, error ? "FAILED" : "OK");
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   //Request waiting for a request context
+   if(!error)
+   {
+      //Allocate a buffer to hold the responses
+      buffer = osMemAlloc(BENCH_BUFFER_SIZE);
+
+      //Keep a request waiting beyond the inactivity timeout
+      error = buffer ? checkRequestCap(buffer) : ERROR_OUT_OF_MEMORY;
+      //Display result
+      printf("Request cap (%s): %s\r\n", BENCH_MODE, error ? "FAILED" : "OK");
+
+      //Release resources
+      osMemFree(buffer);
+   }
+#endif
+
+   //Load phase
+   if(!error)
+   {
+      //Display header
+      printf("%-20s %7s %8s %10s %8s %8s %8s %10s\r\n", "Server mode", "clients",
+         "requests", "req/s", "p50 (us)", "p99 (us)", "reconn.", "failures");
+
+      //Generate load
+      error = loadTest();
+   }
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
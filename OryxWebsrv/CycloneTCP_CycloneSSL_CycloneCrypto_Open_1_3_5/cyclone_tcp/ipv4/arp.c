@@ -53,6 +53,8 @@
 
 error_t arpInit(NetInterface *interface)
 {
+   uint_t i;
+
    //Create a mutex to prevent simultaneous access to ARP cache
    interface->arpCacheMutex = osMutexCreate(FALSE);
    //Any error to report?
@@ -61,6 +63,17 @@ error_t arpInit(NetInterface *interface)
 
    //Initialize ARP cache
    memset(interface->arpCache, 0, sizeof(interface->arpCache));
+   memset(interface->arpHashTable, 0, sizeof(interface->arpHashTable));
+   memset(&interface->arpStats, 0, sizeof(ArpStats));
+
+   //Free entries are chained at the end of the LRU list
+   interface->arpLruHead = NULL;
+   interface->arpLruTail = NULL;
+   interface->arpLastEntry = NULL;
+
+   //Build the LRU list
+   for(i = 0; i < ARP_CACHE_SIZE; i++)
+      arpLruAppend(interface, &interface->arpCache[i]);
 
    //Successful initialization
    return NO_ERROR;
@@ -86,10 +99,9 @@ void arpFlushCache(NetInterface *interface)
       //Point to the current entry
       entry = &interface->arpCache[i];
 
-      //Drop packets that are waiting for address resolution
-      arpFlushQueuedPackets(interface, entry);
       //Release ARP entry
-      entry->state = ARP_STATE_NONE;
+      if(entry->state != ARP_STATE_NONE)
+         arpDeleteEntry(interface, entry);
    }
 
    //Release exclusive access to ARP cache
@@ -99,45 +111,49 @@ void arpFlushCache(NetInterface *interface)
 
 /**
  * @brief Create a new entry in the ARP cache
+ *
+ * Free entries are kept at the tail of the LRU list. When the cache is
+ * full, the least recently used entry is reclaimed
+ *
  * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv4 address
  * @return Pointer to the newly created entry
  **/
 
-ArpCacheEntry *arpCreateEntry(NetInterface *interface)
+ArpCacheEntry *arpCreateEntry(NetInterface *interface, Ipv4Addr ipAddr)
 {
    uint_t i;
    ArpCacheEntry *entry;
-   ArpCacheEntry *oldestEntry;
 
-   //Keep track of the oldest entry
-   oldestEntry = &interface->arpCache[0];
+   //Point to the least recently used entry
+   entry = interface->arpLruTail;
 
-   //Loop through ARP cache entries
-   for(i = 0; i < ARP_CACHE_SIZE; i++)
+   //The table runs out of space?
+   if(entry->state != ARP_STATE_NONE)
    {
-      //Point to the current entry
-      entry = &interface->arpCache[i];
+      //Update statistics
+      interface->arpStats.evictions++;
+      //Drop any pending packets and remove the entry from the hash table
+      arpDeleteEntry(interface, entry);
+   }
 
-      //Check whether the entry is currently in used or not
-      if(entry->state == ARP_STATE_NONE)
-      {
-         //Erase contents
-         memset(entry, 0, sizeof(ArpCacheEntry));
-         //Return a pointer to the ARP entry
-         return entry;
-      }
+   //Remove the entry from the LRU list
+   arpLruRemove(interface, entry);
+   //Erase contents
+   memset(entry, 0, sizeof(ArpCacheEntry));
 
-      //Keep track of the oldest entry in the table
-      if(timeCompare(entry->timestamp, oldestEntry->timestamp) < 0)
-         oldestEntry = entry;
-   }
+   //Record the IPv4 address
+   entry->ipAddr = ipAddr;
+   //The entry becomes the most recently used one
+   arpLruInsert(interface, entry);
+
+   //Insert the entry in the hash table
+   i = arpHashAddr(ipAddr);
+   entry->hashNext = interface->arpHashTable[i];
+   interface->arpHashTable[i] = entry;
 
-   //Drop any pending packets
-   arpFlushQueuedPackets(interface, oldestEntry);
-   //The oldest entry is removed whenever the table runs out of space
-   memset(oldestEntry, 0, sizeof(ArpCacheEntry));
    //Return a pointer to the ARP entry
-   return oldestEntry;
+   return entry;
 }
 
 
@@ -151,26 +167,191 @@ ArpCacheEntry *arpCreateEntry(NetInterface *interface)
 
 ArpCacheEntry *arpFindEntry(NetInterface *interface, Ipv4Addr ipAddr)
 {
-   uint_t i;
    ArpCacheEntry *entry;
 
-   //Loop through ARP cache entries
-   for(i = 0; i < ARP_CACHE_SIZE; i++)
-   {
-      //Point to the current entry
-      entry = &interface->arpCache[i];
+   //Consecutive packets are usually sent to the same destination
+   entry = interface->arpLastEntry;
 
-      //Check whether the entry is currently in used
-      if(entry->state != ARP_STATE_NONE)
+   //Last destination matches the specified address?
+   if(entry != NULL && entry->state != ARP_STATE_NONE && entry->ipAddr == ipAddr)
+   {
+      //Update statistics
+      interface->arpStats.fastPathHits++;
+   }
+   else
+   {
+      //Walk through the relevant hash bucket
+      for(entry = interface->arpHashTable[arpHashAddr(ipAddr)];
+         entry != NULL; entry = entry->hashNext)
       {
          //Current entry matches the specified address?
          if(entry->ipAddr == ipAddr)
-            return entry;
+            break;
       }
+
+      //No matching entry in ARP cache...
+      if(entry == NULL)
+         return NULL;
+
+      //Save the last destination
+      interface->arpLastEntry = entry;
+   }
+
+   //The entry becomes the most recently used one
+   if(interface->arpLruHead != entry)
+   {
+      arpLruRemove(interface, entry);
+      arpLruInsert(interface, entry);
    }
 
-   //No matching entry in ARP cache...
-   return NULL;
+   //Return a pointer to the ARP entry
+   return entry;
+}
+
+
+/**
+ * @brief Delete an entry from the ARP cache
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP entry to be released
+ **/
+
+void arpDeleteEntry(NetInterface *interface, ArpCacheEntry *entry)
+{
+   ArpCacheEntry **p;
+
+   //Drop packets that are waiting for address resolution
+   arpFlushQueuedPackets(interface, entry);
+
+   //Remove the entry from the hash table
+   for(p = &interface->arpHashTable[arpHashAddr(entry->ipAddr)]; *p != NULL; p = &(*p)->hashNext)
+   {
+      if(*p == entry)
+      {
+         *p = entry->hashNext;
+         break;
+      }
+   }
+
+   //Forget the last destination if necessary
+   if(interface->arpLastEntry == entry)
+      interface->arpLastEntry = NULL;
+
+   //Release ARP entry
+   entry->hashNext = NULL;
+   entry->state = ARP_STATE_NONE;
+
+   //Free entries are reused first
+   arpLruRemove(interface, entry);
+   arpLruAppend(interface, entry);
+}
+
+
+/**
+ * @brief Retrieve ARP cache statistics
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Snapshot of the ARP cache counters
+ **/
+
+void arpGetStats(NetInterface *interface, ArpStats *stats)
+{
+   //Acquire exclusive access to ARP cache
+   osMutexAcquire(interface->arpCacheMutex);
+   //Take a consistent snapshot of the counters
+   *stats = interface->arpStats;
+   //Release exclusive access to ARP cache
+   osMutexRelease(interface->arpCacheMutex);
+}
+
+
+/**
+ * @brief Hash function used to index the ARP cache
+ * @param[in] ipAddr IPv4 address
+ * @return Index of the hash bucket
+ **/
+
+uint_t arpHashAddr(Ipv4Addr ipAddr)
+{
+   uint32_t h;
+
+   //Hosts on the same subnet differ in the low-order bits of their
+   //address, which are folded regardless of the byte order
+   h = ipAddr ^ (ipAddr >> 16);
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (ARP_HASH_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief Insert an entry at the head of the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP entry
+ **/
+
+void arpLruInsert(NetInterface *interface, ArpCacheEntry *entry)
+{
+   //The entry becomes the most recently used one
+   entry->lruPrev = NULL;
+   entry->lruNext = interface->arpLruHead;
+
+   //Update the links of the former head
+   if(interface->arpLruHead != NULL)
+      interface->arpLruHead->lruPrev = entry;
+   else
+      interface->arpLruTail = entry;
+
+   //Update the head of the list
+   interface->arpLruHead = entry;
+}
+
+
+/**
+ * @brief Insert an entry at the tail of the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP entry
+ **/
+
+void arpLruAppend(NetInterface *interface, ArpCacheEntry *entry)
+{
+   //The entry will be the first one to be reused
+   entry->lruPrev = interface->arpLruTail;
+   entry->lruNext = NULL;
+
+   //Update the links of the former tail
+   if(interface->arpLruTail != NULL)
+      interface->arpLruTail->lruNext = entry;
+   else
+      interface->arpLruHead = entry;
+
+   //Update the tail of the list
+   interface->arpLruTail = entry;
+}
+
+
+/**
+ * @brief Remove an entry from the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP entry
+ **/
+
+void arpLruRemove(NetInterface *interface, ArpCacheEntry *entry)
+{
+   //Update the link of the previous entry
+   if(entry->lruPrev != NULL)
+      entry->lruPrev->lruNext = entry->lruNext;
+   else
+      interface->arpLruHead = entry->lruNext;
+
+   //Update the link of the next entry
+   if(entry->lruNext != NULL)
+      entry->lruNext->lruPrev = entry->lruPrev;
+   else
+      interface->arpLruTail = entry->lruPrev;
+
+   //The entry is not linked anymore
+   entry->lruPrev = NULL;
+   entry->lruNext = NULL;
 }
 
 
@@ -247,6 +428,9 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
    //Check whether a matching entry has been found
    if(entry)
    {
+      //Update statistics
+      interface->arpStats.hits++;
+
       //Check the state of the ARP entry
       if(entry->state == ARP_STATE_INCOMPLETE)
       {
@@ -264,6 +448,8 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
          entry->timestamp = osGetTickCount();
          //Delay before sending the first probe
          entry->timeout = ARP_DELAY_FIRST_PROBE_TIME;
+         //Register the deadline with the timer wheel
+         netTimerSchedule(&interface->arpTimer, entry->timeout);
          //Switch to the DELAY state
          entry->state = ARP_STATE_DELAY;
 
@@ -284,8 +470,11 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
       }
    }
 
+   //Update statistics
+   interface->arpStats.misses++;
+
    //If no entry exists, then create a new one
-   entry = arpCreateEntry(interface);
+   entry = arpCreateEntry(interface, ipAddr);
 
    //Any error to report?
    if(!entry)
@@ -296,8 +485,7 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
       return ERROR_OUT_OF_RESOURCES;
    }
 
-   //Record the IPv4 address whose MAC address is unknown
-   entry->ipAddr = ipAddr;
+   //The MAC address is not known yet
    entry->macAddr = MAC_UNSPECIFIED_ADDR;
 
    //Reset retransmission counter
@@ -313,6 +501,8 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
    entry->timestamp = osGetTickCount();
    //Set timeout value
    entry->timeout = ARP_REQUEST_TIMEOUT;
+   //Register the deadline with the timer wheel
+   netTimerSchedule(&interface->arpTimer, entry->timeout);
    //Enter INCOMPLETE state
    entry->state = ARP_STATE_INCOMPLETE;
 
@@ -416,8 +606,9 @@ error_t arpEnqueuePacket(NetInterface *interface,
 /**
  * @brief ARP timer handler
  *
- * This routine must be periodically called by the TCP/IP stack to
- * manage ARP cache
+ * This routine is invoked by the timer wheel when the deadline of an entry
+ * has been reached. The timer is then re-armed with the earliest deadline
+ * left in the ARP cache
  *
  * @param[in] interface Underlying network interface
  **/
@@ -426,10 +617,14 @@ void arpTick(NetInterface *interface)
 {
    uint_t i;
    time_t time;
+   int32_t delay;
+   int32_t nextDelay;
    ArpCacheEntry *entry;
 
    //Get current time
    time = osGetTickCount();
+   //No deadline found yet
+   nextDelay = -1;
 
    //Acquire exclusive access to ARP cache
    osMutexAcquire(interface->arpCacheMutex);
@@ -463,10 +658,8 @@ void arpTick(NetInterface *interface)
             }
             else
             {
-               //Drop packets that are waiting for address resolution
-               arpFlushQueuedPackets(interface, entry);
                //The entry should be deleted since address resolution has failed
-               entry->state = ARP_STATE_NONE;
+               arpDeleteEntry(interface, entry);
             }
          }
       }
@@ -524,12 +717,28 @@ void arpTick(NetInterface *interface)
             else
             {
                //The entry should be deleted since the host is not reachable anymore
-               entry->state = ARP_STATE_NONE;
+               arpDeleteEntry(interface, entry);
             }
          }
       }
+
+      //Entries in INCOMPLETE, REACHABLE, DELAY and PROBE states have a deadline
+      if(entry->state == ARP_STATE_INCOMPLETE || entry->state == ARP_STATE_REACHABLE ||
+         entry->state == ARP_STATE_DELAY || entry->state == ARP_STATE_PROBE)
+      {
+         //Time remaining before the deadline
+         delay = max(timeCompare(entry->timestamp + entry->timeout, time), 0);
+
+         //Keep track of the earliest deadline
+         if(nextDelay < 0 || delay < nextDelay)
+            nextDelay = delay;
+      }
    }
 
+   //Any deadline left in the ARP cache?
+   if(nextDelay >= 0)
+      netTimerSchedule(&interface->arpTimer, nextDelay);
+
    //Release exclusive access to ARP cache
    osMutexRelease(interface->arpCacheMutex);
 }
@@ -662,6 +871,8 @@ void arpProcessReply(NetInterface *interface, ArpPacket *arpReply)
          entry->timestamp = osGetTickCount();
          //The validity of the ARP entry is limited in time
          entry->timeout = ARP_REACHABLE_TIME;
+         //Register the deadline with the timer wheel
+         netTimerSchedule(&interface->arpTimer, entry->timeout);
          //Switch to the REACHABLE state
          entry->state = ARP_STATE_REACHABLE;
       }
@@ -684,6 +895,8 @@ void arpProcessReply(NetInterface *interface, ArpPacket *arpReply)
          entry->timestamp = osGetTickCount();
          //The validity of the ARP entry is limited in time
          entry->timeout = ARP_REACHABLE_TIME;
+         //Register the deadline with the timer wheel
+         netTimerSchedule(&interface->arpTimer, entry->timeout);
          //Switch to the REACHABLE state
          entry->state = ARP_STATE_REACHABLE;
       }
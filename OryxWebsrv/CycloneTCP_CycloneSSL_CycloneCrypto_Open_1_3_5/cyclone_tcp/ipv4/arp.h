@@ -32,13 +32,6 @@
 //Dependencies
 #include "tcp_ip_stack.h"
 
-//ARP tick interval
-#ifndef ARP_TICK_INTERVAL
-   #define ARP_TICK_INTERVAL 200
-#elif (ARP_TICK_INTERVAL < 100)
-   #error ARP_TICK_INTERVAL parameter is invalid
-#endif
-
 //Size of ARP cache
 #ifndef ARP_CACHE_SIZE
    #define ARP_CACHE_SIZE 8
@@ -46,6 +39,13 @@
    #error ARP_CACHE_SIZE parameter is invalid
 #endif
 
+//Size of the hash table used to index the ARP cache
+#ifndef ARP_HASH_TABLE_SIZE
+   #define ARP_HASH_TABLE_SIZE 16
+#elif (ARP_HASH_TABLE_SIZE < 1 || (ARP_HASH_TABLE_SIZE & (ARP_HASH_TABLE_SIZE - 1)) != 0)
+   #error ARP_HASH_TABLE_SIZE parameter is invalid
+#endif
+
 //Maximum number of packets waiting for address resolution to complete
 #ifndef ARP_MAX_PENDING_PACKETS
    #define ARP_MAX_PENDING_PACKETS 2
@@ -173,8 +173,11 @@ typedef struct
  * @brief ARP cache entry
  **/
 
-typedef struct
+typedef struct _ArpCacheEntry
 {
+   struct _ArpCacheEntry *hashNext;             //Next entry in the same hash bucket
+   struct _ArpCacheEntry *lruPrev;              //More recently used entry
+   struct _ArpCacheEntry *lruNext;              //Less recently used entry
    ArpState state;                              //Reachability state
    Ipv4Addr ipAddr;                             //Unicast IPv4 address
    MacAddr macAddr;                             //Link layer address associated with the IPv4 address
@@ -186,12 +189,32 @@ typedef struct
 } ArpCacheEntry;
 
 
+/**
+ * @brief ARP cache statistics
+ **/
+
+typedef struct
+{
+   uint32_t hits;                               //Address resolutions satisfied by the cache
+   uint32_t misses;                             //Address resolutions that required a new entry
+   uint32_t fastPathHits;                       //Lookups satisfied by the last destination entry
+   uint32_t evictions;                          //Entries reclaimed to make room for a new one
+} ArpStats;
+
+
 //ARP related functions
 error_t arpInit(NetInterface *interface);
 void arpFlushCache(NetInterface *interface);
 
-ArpCacheEntry *arpCreateEntry(NetInterface *interface);
+ArpCacheEntry *arpCreateEntry(NetInterface *interface, Ipv4Addr ipAddr);
 ArpCacheEntry *arpFindEntry(NetInterface *interface, Ipv4Addr ipAddr);
+void arpDeleteEntry(NetInterface *interface, ArpCacheEntry *entry);
+void arpGetStats(NetInterface *interface, ArpStats *stats);
+
+uint_t arpHashAddr(Ipv4Addr ipAddr);
+void arpLruInsert(NetInterface *interface, ArpCacheEntry *entry);
+void arpLruAppend(NetInterface *interface, ArpCacheEntry *entry);
+void arpLruRemove(NetInterface *interface, ArpCacheEntry *entry);
 
 void arpSendQueuedPackets(NetInterface *interface, ArpCacheEntry *entry);
 void arpFlushQueuedPackets(NetInterface *interface, ArpCacheEntry *entry);
@@ -82,6 +82,8 @@ void icmpProcessMessage(NetInterface *interface,
    {
       //Debug message
       TRACE_WARNING("Wrong ICMP header checksum!\r\n");
+      //Update statistics
+      interface->stats.checksumErrors++;
       //Drop incoming message
       return;
    }
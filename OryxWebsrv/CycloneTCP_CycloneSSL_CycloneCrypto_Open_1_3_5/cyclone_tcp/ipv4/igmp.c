@@ -306,6 +306,8 @@ void igmpProcessMessage(NetInterface *interface,
    {
       //Debug message
       TRACE_WARNING("Wrong IGMP header checksum!\r\n");
+      //Update statistics
+      interface->stats.checksumErrors++;
       //Drop incoming message
       return;
    }
@@ -91,6 +91,13 @@ error_t ipv4Init(NetInterface *interface)
 
    //Clear the reassembly queue
    memset(interface->ipv4FragQueue, 0, sizeof(interface->ipv4FragQueue));
+   memset(interface->ipv4FragHashTable, 0, sizeof(interface->ipv4FragHashTable));
+   memset(&interface->ipv4FragStats, 0, sizeof(Ipv4FragStats));
+
+   //The reassembly queue is initially empty
+   interface->ipv4FragAgeHead = NULL;
+   interface->ipv4FragAgeTail = NULL;
+   interface->ipv4FragMemUsage = 0;
 #endif
 
    //Successful initialization
@@ -143,6 +150,8 @@ void ipv4ProcessPacket(NetInterface *interface,
    {
       //Debug message
       TRACE_WARNING("Wrong IP header checksum!\r\n");
+      //Update statistics
+      interface->stats.checksumErrors++;
       //Discard incoming packet
       return;
    }
@@ -171,6 +180,8 @@ void ipv4ProcessPacket(NetInterface *interface,
       buffer.maxChunkCount = 1;
       buffer.chunk[0].address = packet;
       buffer.chunk[0].length = length;
+      buffer.chunk[0].size = 0;
+      buffer.chunk[0].flags = 0;
 
       //Pass the IPv4 datagram to the higher protocol layer
       ipv4ProcessDatagram(interface, srcMacAddr, (ChunkedBuffer *) &buffer);
@@ -29,7 +29,7 @@
  * transmission unit (MTU) than the original datagram size. Refer to the
  * following RFCs for complete details:
  * - RFC 791: Internet Protocol specification
- * - RFC 815: IP datagram reassembly algorithms
+ * - RFC 1122: Requirements for Internet Hosts - Communication Layers
  *
  * @author Oryx Embedded (www.oryx-embedded.com)
  * @version 1.3.5
@@ -139,8 +139,9 @@ void ipv4ReassembleDatagram(NetInterface *interface,
    uint16_t dataFirst;
    uint16_t dataLast;
    Ipv4FragDesc *frag;
-   Ipv4HoleDesc *hole;
-   Ipv4HoleDesc *prevHole;
+
+   //Update statistics
+   interface->ipv4FragStats.reasmReqds++;
 
    //Get the length of the payload
    length -= packet->headerLength * 4;
@@ -148,7 +149,15 @@ void ipv4ReassembleDatagram(NetInterface *interface,
    offset = ntohs(packet->fragmentOffset);
 
    //Every fragment except the last must contain a multiple of 8 bytes of data
-   if((offset & IPV4_FLAG_MF) && (length % 8))
+   if((offset & IPV4_FLAG_MF) && (length % 8 || !length))
+   {
+      //Drop incoming packet
+      return;
+   }
+
+   //Enforce the size of the reconstructed datagram
+   if((packet->headerLength * 4 + (offset & IPV4_OFFSET_MASK) * 8 + length) >
+      IPV4_MAX_FRAG_DATAGRAM_SIZE)
    {
       //Drop incoming packet
       return;
@@ -164,200 +173,338 @@ void ipv4ReassembleDatagram(NetInterface *interface,
    //No matching entry in the reassembly queue?
    if(!frag) return;
 
-   //The very first fragment requires special handling
-   if(!(offset & IPV4_OFFSET_MASK))
+   //The last fragment determines the length of the payload
+   if(!(offset & IPV4_FLAG_MF))
+   {
+      //Make sure the length is consistent with previously received fragments
+      if(frag->dataLength != 0 && frag->dataLength != dataLast)
+         error = ERROR_INVALID_LENGTH;
+      else if(frag->rangeCount > 0 && frag->range[frag->rangeCount - 1].last > dataLast)
+         error = ERROR_INVALID_LENGTH;
+      else
+         error = NO_ERROR;
+
+      //Save the length of the payload
+      frag->dataLength = dataLast;
+   }
+   else
+   {
+      //No data can follow the last fragment
+      if(frag->dataLength != 0 && dataLast > frag->dataLength)
+         error = ERROR_INVALID_LENGTH;
+      else
+         error = NO_ERROR;
+   }
+
+   //Check status code
+   if(!error && length > 0)
+   {
+      //Add the fragment to the datagram being reassembled
+      error = ipv4InsertFragment(interface, frag, packet, dataFirst, dataLast);
+   }
+
+   //Any error to report?
+   if(error)
+   {
+      //Update statistics
+      interface->ipv4FragStats.reasmFails++;
+      //Drop the partially reconstructed datagram
+      ipv4DeleteFragDesc(interface, frag);
+      //Exit immediately
+      return;
+   }
+
+   //Dump fragment list
+   ipv4DumpFragList(frag);
+
+   //Since fragments never overlap, the reassembly process is complete
+   //as soon as the whole payload has been received
+   if(frag->dataLength != 0 && frag->receivedLength == frag->dataLength)
+   {
+      //Pass the original IPv4 datagram to the higher protocol layer
+      ipv4CompleteDatagram(interface, srcMacAddr, frag);
+      //Release previously allocated memory
+      ipv4DeleteFragDesc(interface, frag);
+   }
+}
+
+
+/**
+ * @brief Add a fragment to the datagram being reassembled
+ *
+ * The fragment list is kept sorted and free of overlaps. Data received
+ * earlier takes precedence over the beginning of the new fragment, while
+ * the new fragment replaces any data that follows it
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag IPv4 fragment descriptor
+ * @param[in] packet Pointer to the IPv4 fragmented packet
+ * @param[in] dataFirst Index of the first byte
+ * @param[in] dataLast Index immediately following the last byte
+ * @return Error code
+ **/
+
+error_t ipv4InsertFragment(NetInterface *interface, Ipv4FragDesc *frag,
+   const Ipv4Header *packet, uint16_t dataFirst, uint16_t dataLast)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   size_t size;
+   size_t headerLength;
+   uint8_t *block;
+   const uint8_t *data;
+   Ipv4FragRange *range;
+
+   //Point to the data carried by the fragment
+   data = IPV4_DATA(packet);
+
+   //Find the position of the new fragment in the sorted list
+   for(i = 0; i < frag->rangeCount; i++)
+   {
+      //Fragments are sorted by increasing offset
+      if(frag->range[i].first > dataFirst)
+         break;
+   }
+
+   //Does the preceding fragment overlap the new one?
+   if(i > 0 && frag->range[i - 1].last > dataFirst)
+   {
+      //Update statistics
+      interface->ipv4FragStats.overlaps++;
+
+      //Duplicate fragment?
+      if(frag->range[i - 1].last >= dataLast)
+         return NO_ERROR;
+
+      //Discard the beginning of the new fragment
+      data += frag->range[i - 1].last - dataFirst;
+      dataFirst = frag->range[i - 1].last;
+   }
+
+   //Skip the fragments that are entirely covered by the new one
+   for(j = i; j < frag->rangeCount; j++)
+   {
+      //Check whether the current fragment extends beyond the new one
+      if(frag->range[j].last > dataLast)
+         break;
+   }
+
+   //Limit the number of fragments per datagram
+   if((frag->rangeCount - (j - i) + 1) > IPV4_MAX_FRAG_COUNT)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Fragment zero is stored along with the IP header
+   if(dataFirst == 0)
    {
       //Calculate the length of the IP header including options
-      frag->headerLength = packet->headerLength * 4;
+      headerLength = packet->headerLength * 4;
 
-      //Enforce the size of the reconstructed datagram
-      if((frag->headerLength + frag->dataLength) > IPV4_MAX_FRAG_DATAGRAM_SIZE)
-      {
-         //Drop any allocated resources
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+      //Make sure the header and the data fit in a single block
+      if((headerLength + dataLast) > MEM_POOL_BUFFER_SIZE)
+         return ERROR_INVALID_LENGTH;
 
-      //Make sure the IP header entirely fits in the first chunk
-      if(frag->headerLength > frag->buffer.chunk[0].size)
-      {
-         //Drop the reconstructed datagram
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+      //Reserve a full block so that subsequent data can be pulled up
+      size = MEM_POOL_BUFFER_SIZE;
+   }
+   else
+   {
+      //Other fragments only hold their own data
+      headerLength = 0;
+      size = dataLast - dataFirst;
+   }
+
+   //Enforce the memory budget of the reassembly queue
+   if(!ipv4ReclaimFragMem(interface, frag, size))
+      return ERROR_OUT_OF_MEMORY;
+
+   //Allocate a memory block to hold the fragment
+   block = memPoolAlloc(size);
+   //Failed to allocate memory?
+   if(!block)
+      return ERROR_OUT_OF_MEMORY;
 
-      //Fix the length of the first chunk
-      frag->buffer.chunk[0].length = frag->headerLength;
+   //Update memory usage
+   interface->ipv4FragMemUsage += size;
+   frag->memSize += size;
+
+   //Fragment zero?
+   if(headerLength > 0)
+   {
       //Always take the IP header from the first fragment
-      chunkedBufferWrite((ChunkedBuffer *) &frag->buffer, 0, packet, frag->headerLength);
+      memcpy(block, packet, headerLength);
+      //Save the length of the IP header
+      frag->headerLength = headerLength;
    }
 
-   //It may be necessary to increase the size of the buffer...
-   if(dataLast > frag->dataLength)
+   //Copy fragment data
+   memcpy(block + headerLength, data, dataLast - dataFirst);
+
+   //Release the fragments that are entirely covered by the new one
+   for(k = i; k < j; k++)
    {
-      //Enforce the size of the reconstructed datagram
-      if((frag->headerLength + dataLast) > IPV4_MAX_FRAG_DATAGRAM_SIZE)
-      {
-         //Drop any allocated resources
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+      //Point to the current fragment
+      range = &frag->range[k];
 
-      //Adjust the size of the reconstructed datagram
-      error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-         frag->headerLength + dataLast + sizeof(Ipv4HoleDesc));
+      //Update statistics
+      interface->ipv4FragStats.overlaps++;
 
-      //Any error to report?
-      if(error)
-      {
-         //Drop the reconstructed datagram
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+      //Update the amount of data received so far
+      frag->receivedLength -= range->last - range->first;
+      //Update memory usage
+      interface->ipv4FragMemUsage -= range->size;
+      frag->memSize -= range->size;
 
-      //Actual length of the payload
-      frag->dataLength = dataLast;
+      //Free memory block
+      memPoolFree(range->block);
    }
 
-   //Select the first hole descriptor from the list
-   hole = ipv4FindHole(frag, frag->firstHole);
-   //Keep track of the previous hole in the list
-   prevHole = NULL;
-
-   //Iterate through the hole descriptors
-   while(hole != NULL)
+   //Does the new fragment overlap the beginning of the next one?
+   if(j < frag->rangeCount && frag->range[j].first < dataLast)
    {
-      //Save lower and upper boundaries for later use
-      uint16_t holeFirst = hole->first;
-      uint16_t holeLast = hole->last;
+      //Point to the next fragment
+      range = &frag->range[j];
 
-      //Check whether the newly arrived fragment
-      //interacts with this hole in some way
-      if(dataFirst < holeLast && dataLast > holeFirst)
-      {
-         //The current descriptor is no longer valid. We will destroy
-         //it, and in the next two steps, we will determine whether
-         //or not it is necessary to create any new hole descriptors
-         if(prevHole != NULL)
-            prevHole->next = hole->next;
-         else
-            frag->firstHole = hole->next;
-
-         //Is there still a hole at the beginning of the segment?
-         if(dataFirst > holeFirst)
-         {
-            //Create a new entry that describes this hole
-            hole = ipv4FindHole(frag, holeFirst);
-            hole->first = holeFirst;
-            hole->last = dataFirst;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
-
-         //Is there still a hole at the end of the segment?
-         if(dataLast < holeLast && (offset & IPV4_FLAG_MF))
-         {
-            //Create a new entry that describes this hole
-            hole = ipv4FindHole(frag, dataLast);
-            hole->first = dataLast;
-            hole->last = holeLast;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
-      }
-      else
-      {
-         //The newly arrived fragment does not interact with the current hole
-         prevHole = hole;
-      }
+      //Update statistics
+      interface->ipv4FragStats.overlaps++;
 
-      //Select the next hole descriptor from the list
-      hole = ipv4FindHole(frag, prevHole ? prevHole->next : frag->firstHole);
+      //Discard the beginning of the next fragment
+      frag->receivedLength -= dataLast - range->first;
+      range->data += dataLast - range->first;
+      range->first = dataLast;
    }
 
-   //Copy data from the fragment to the reassembly buffer
-   chunkedBufferWrite((ChunkedBuffer *) &frag->buffer,
-      frag->headerLength + dataFirst, IPV4_DATA(packet), length);
+   //Make room for the new fragment
+   memmove(&frag->range[i + 1], &frag->range[j],
+      (frag->rangeCount - j) * sizeof(Ipv4FragRange));
+
+   //Update the number of fragments
+   frag->rangeCount = frag->rangeCount - (j - i) + 1;
+
+   //Point to the new entry
+   range = &frag->range[i];
+
+   //Save fragment information
+   range->first = dataFirst;
+   range->last = dataLast;
+   range->data = block + headerLength;
+   range->block = block;
+   range->size = size;
+
+   //Update the amount of data received so far
+   frag->receivedLength += dataLast - dataFirst;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Hand a fully reassembled datagram over to the higher protocol layer
+ *
+ * The fragments are chained together without copying them. Fragment zero
+ * holds the IP header, and is completed with data pulled up from the
+ * subsequent fragments whenever it is too short to hold the headers
+ * of the upper layers
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] srcMacAddr MAC address of the source
+ * @param[in] frag IPv4 fragment descriptor
+ **/
+
+void ipv4CompleteDatagram(NetInterface *interface,
+   const MacAddr *srcMacAddr, Ipv4FragDesc *frag)
+{
+   uint_t i;
+   uint_t j;
+   size_t n;
+   size_t pullupLength;
+   Ipv4Header *datagram;
+   Ipv4ReassemblyBuffer buffer;
+
+   //Point to the IP header
+   datagram = frag->range[0].block;
 
-   //Dump hole descriptor list
-   ipv4DumpHoleList(frag);
+   //Number of chunks that comprise the reassembly buffer
+   buffer.chunkCount = frag->rangeCount;
+   buffer.maxChunkCount = arraysize(buffer.chunk);
 
-   //If the hole descriptor list is empty, the reassembly process is now complete
-   if(!ipv4FindHole(frag, frag->firstHole))
+   //Chain the fragments together
+   for(i = 0; i < frag->rangeCount; i++)
    {
-      //Discard the extra hole descriptor that follows the reconstructed datagram
-      error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-         frag->headerLength + frag->dataLength);
+      buffer.chunk[i].address = frag->range[i].data;
+      buffer.chunk[i].length = frag->range[i].last - frag->range[i].first;
+      buffer.chunk[i].size = 0;
+      buffer.chunk[i].flags = 0;
+   }
 
-      //Check status code
-      if(!error)
-      {
-         //Point to the IP header
-         Ipv4Header *datagram = chunkedBufferAt((ChunkedBuffer *) &frag->buffer, 0);
+   //The first chunk begins with the IP header
+   buffer.chunk[0].address = datagram;
+   buffer.chunk[0].length += frag->headerLength;
 
-         //Fix IP header
-         datagram->totalLength = htons(frag->headerLength + frag->dataLength);
-         datagram->fragmentOffset = 0;
-         datagram->headerChecksum = 0;
+   //Amount of data that must immediately follow the IP header
+   pullupLength = min(frag->dataLength, IPV4_FRAG_PULLUP_SIZE);
+   pullupLength = min(pullupLength, MEM_POOL_BUFFER_SIZE - frag->headerLength);
+   pullupLength += frag->headerLength;
+
+   //Pull up data from the subsequent fragments if necessary
+   for(i = 1, j = 1; i < buffer.chunkCount; i++)
+   {
+      //Fragment zero is too short?
+      if(buffer.chunk[0].length < pullupLength)
+      {
+         //Number of bytes to move
+         n = min(pullupLength - buffer.chunk[0].length, buffer.chunk[i].length);
 
-         //Recalculate IP header checksum
-         datagram->headerChecksum = ipCalcChecksum(datagram, frag->buffer.chunk[0].length);
+         //Append them to fragment zero
+         memcpy((uint8_t *) datagram + buffer.chunk[0].length, buffer.chunk[i].address, n);
+         buffer.chunk[0].length += n;
 
-         //Pass the original IPv4 datagram to the higher protocol layer
-         ipv4ProcessDatagram(interface, srcMacAddr, (ChunkedBuffer *) &frag->buffer);
+         //Skip the data that has been moved
+         buffer.chunk[i].address = (uint8_t *) buffer.chunk[i].address + n;
+         buffer.chunk[i].length -= n;
       }
 
-      //Release previously allocated memory
-      chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
+      //Discard empty chunks
+      if(buffer.chunk[i].length > 0)
+         buffer.chunk[j++] = buffer.chunk[i];
    }
+
+   //Actual number of chunks
+   buffer.chunkCount = j;
+
+   //Fix IP header
+   datagram->totalLength = htons(frag->headerLength + frag->dataLength);
+   datagram->fragmentOffset = 0;
+   datagram->headerChecksum = 0;
+
+   //Recalculate IP header checksum
+   datagram->headerChecksum = ipCalcChecksum(datagram, frag->headerLength);
+
+   //Update statistics
+   interface->ipv4FragStats.reasmOks++;
+
+   //Pass the original IPv4 datagram to the higher protocol layer
+   ipv4ProcessDatagram(interface, srcMacAddr, (ChunkedBuffer *) &buffer);
 }
 
 
 /**
  * @brief Fragment reassembly timeout handler
  *
- * This routine must be periodically called by the TCP/IP stack to
- * handle IPv4 fragment reassembly timeout
+ * This routine is invoked by the timer wheel when the reassembly timer of
+ * a datagram runs out. The timer is then re-armed with the earliest deadline
+ * left in the reassembly queue
  *
  * @param[in] interface Underlying network interface
  **/
 
 void ipv4FragTick(NetInterface *interface)
 {
-   error_t error;
-   uint_t i;
    time_t time;
-   Ipv4HoleDesc *hole;
+   int32_t delay;
+   Ipv4FragDesc *frag;
+   ChunkedBuffer1 buffer;
 
    //Acquire exclusive access to the reassembly queue
    osMutexAcquire(interface->ipv4FragQueueMutex);
@@ -365,48 +512,54 @@ void ipv4FragTick(NetInterface *interface)
    //Get current time
    time = osGetTickCount();
 
-   //Loop through the reassembly queue
-   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   //The age list is sorted by creation time, hence
+   //the datagrams that expire first are at its head
+   while(interface->ipv4FragAgeHead != NULL)
    {
-      //Point to the current entry in the reassembly queue
-      Ipv4FragDesc *frag = &interface->ipv4FragQueue[i];
+      //Point to the oldest datagram
+      frag = interface->ipv4FragAgeHead;
+
+      //Time remaining before the reassembly timer runs out
+      delay = timeCompare(frag->timestamp + IPV4_FRAG_TIME_TO_LIVE, time);
+
+      //The remaining datagrams are still waiting for their missing fragments
+      if(delay > 0)
+      {
+         //Re-arm the reassembly timer
+         netTimerSchedule(&interface->ipv4FragTimer, delay);
+         //We are done
+         break;
+      }
+
+      //Debug message
+      TRACE_INFO("IPv4 fragment reassembly timeout...\r\n");
 
-      //Make sure the entry is currently in use
-      if(frag->buffer.chunkCount > 0)
+      //Make sure the fragment zero has been received
+      //before sending an ICMP message
+      if(frag->headerLength > 0)
       {
-         //If the timer runs out, the partially-reassembled datagram must be
-         //discarded and ICMP Time Exceeded message sent to the source host
-         if((time - frag->timestamp) >= IPV4_FRAG_TIME_TO_LIVE)
-         {
-            //Debug message
-            TRACE_INFO("IPv4 fragment reassembly timeout...\r\n");
-            //Dump IP header contents for debugging purpose
-            ipv4DumpHeader(frag->buffer.chunk[0].address);
-
-            //Point to the first hole descriptor
-            hole = ipv4FindHole(frag, frag->firstHole);
-
-            //Make sure the fragment zero has been received
-            //before sending an ICMP message
-            if(hole != NULL && hole->first > 0)
-            {
-               //Fix the size of the reconstructed datagram
-               error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-                  frag->headerLength + hole->first);
-
-               //Check status code
-               if(!error)
-               {
-                  //Send an ICMP Time Exceeded message
-                  icmpSendErrorMessage(interface, ICMP_TYPE_TIME_EXCEEDED,
-                     ICMP_CODE_REASSEMBLY_TIME_EXCEEDED, 0, (ChunkedBuffer *) &frag->buffer);
-               }
-            }
-
-            //Drop the partially reconstructed datagram
-            chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         }
+         //Fragment zero fits in a single chunk
+         buffer.chunkCount = 1;
+         buffer.maxChunkCount = 1;
+         buffer.chunk[0].address = frag->range[0].block;
+         buffer.chunk[0].length = frag->headerLength + frag->range[0].last;
+         buffer.chunk[0].size = 0;
+         buffer.chunk[0].flags = 0;
+
+         //Dump IP header contents for debugging purpose
+         ipv4DumpHeader(buffer.chunk[0].address);
+
+         //Send an ICMP Time Exceeded message
+         icmpSendErrorMessage(interface, ICMP_TYPE_TIME_EXCEEDED,
+            ICMP_CODE_REASSEMBLY_TIME_EXCEEDED, 0, (ChunkedBuffer *) &buffer);
       }
+
+      //Update statistics
+      interface->ipv4FragStats.timeouts++;
+      interface->ipv4FragStats.reasmFails++;
+
+      //Drop the partially reconstructed datagram
+      ipv4DeleteFragDesc(interface, frag);
    }
 
    //Release exclusive access to the reassembly queue
@@ -416,6 +569,11 @@ void ipv4FragTick(NetInterface *interface)
 
 /**
  * @brief Search for a matching datagram in the reassembly queue
+ *
+ * A new entry is created if no datagram matches the incoming packet. When
+ * the reassembly queue is full, the oldest datagram is dropped to make room
+ * for the new one
+ *
  * @param[in] interface Underlying network interface
  * @param[in] packet Incoming IPv4 packet
  * @return Matching fragment descriptor
@@ -423,98 +581,92 @@ void ipv4FragTick(NetInterface *interface)
 
 Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *packet)
 {
-   error_t error;
    uint_t i;
-   Ipv4Header *datagram;
+   uint_t j;
    Ipv4FragDesc *frag;
-   Ipv4HoleDesc *hole;
 
-   //Search for a matching IP datagram being reassembled
-   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
-   {
-      //Point to the current entry in the reassembly queue
-      frag = &interface->ipv4FragQueue[i];
+   //Datagrams are identified by source, destination, protocol and identification
+   i = ipv4FragHash(packet->srcAddr, packet->destAddr,
+      packet->identification, packet->protocol);
 
-      //Check whether the current entry is used?
-      if(frag->buffer.chunkCount > 0)
-      {
-         //Point to the corresponding datagram
-         datagram = chunkedBufferAt((ChunkedBuffer *) &frag->buffer, 0);
-
-         //Check source and destination addresses
-         if(datagram->srcAddr != packet->srcAddr)
-            continue;
-         if(datagram->destAddr != packet->destAddr)
-            continue;
-         //Compare identification and protocol fields
-         if(datagram->identification != packet->identification)
-            continue;
-         if(datagram->protocol != packet->protocol)
-            continue;
-
-         //A matching entry has been found in the reassembly queue
-         return frag;
-      }
+   //Search the hash bucket for a matching IP datagram being reassembled
+   for(frag = interface->ipv4FragHashTable[i]; frag != NULL; frag = frag->hashNext)
+   {
+      //Check source and destination addresses
+      if(frag->srcAddr != packet->srcAddr)
+         continue;
+      if(frag->destAddr != packet->destAddr)
+         continue;
+      //Compare identification and protocol fields
+      if(frag->identification != packet->identification)
+         continue;
+      if(frag->protocol != packet->protocol)
+         continue;
+
+      //A matching entry has been found in the reassembly queue
+      return frag;
    }
 
    //If the current packet does not match an existing entry
    //in the reassembly queue, then create a new entry
-   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   for(frag = NULL, j = 0; j < IPV4_MAX_FRAG_DATAGRAMS; j++)
    {
-      //Point to the current entry in the reassembly queue
-      frag = &interface->ipv4FragQueue[i];
-
       //The current entry is free?
-      if(!frag->buffer.chunkCount)
+      if(!interface->ipv4FragQueue[j].used)
       {
-         //Number of chunks that comprise the reassembly buffer
-         frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
-
-         //Allocate sufficient memory to hold the IPv4 header and
-         //the first hole descriptor
-         error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-            MEM_POOL_BUFFER_SIZE + sizeof(Ipv4HoleDesc));
-
-         //Failed to allocate memory?
-         if(error)
-         {
-            //Clean up side effects
-            chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-            //Exit immediately
-            return NULL;
-         }
-
-         //Initial length of the reconstructed datagram
-         frag->headerLength = packet->headerLength * 4;
-         frag->dataLength = 0;
-
-         //Fix the length of the first chunk
-         frag->buffer.chunk[0].length = frag->headerLength;
-         //Copy IPv4 header from the incoming fragment
-         chunkedBufferWrite((ChunkedBuffer *) &frag->buffer, 0, packet, frag->headerLength);
-
-         //Save current time
-         frag->timestamp = osGetTickCount();
-         //Create a new entry in the hole descriptor list
-         frag->firstHole = 0;
-
-         //Point to first hole descriptor
-         hole = ipv4FindHole(frag, frag->firstHole);
-         //The entry describes the datagram  as  being completely missing
-         hole->first = 0;
-         hole->last = IPV4_INFINITY;
-         hole->next = IPV4_INFINITY;
-
-         //Dump hole descriptor list
-         ipv4DumpHoleList(frag);
-
-         //Return the matching fragment descriptor
-         return frag;
+         frag = &interface->ipv4FragQueue[j];
+         break;
       }
    }
 
-   //The reassembly queue is full
-   return NULL;
+   //The reassembly queue is full?
+   if(frag == NULL)
+   {
+      //Point to the oldest datagram
+      frag = interface->ipv4FragAgeHead;
+
+      //Update statistics
+      interface->ipv4FragStats.evictions++;
+      interface->ipv4FragStats.reasmFails++;
+
+      //Drop it to make room for the new one
+      ipv4DeleteFragDesc(interface, frag);
+   }
+
+   //Initialize the new entry
+   frag->used = TRUE;
+   frag->srcAddr = packet->srcAddr;
+   frag->destAddr = packet->destAddr;
+   frag->identification = packet->identification;
+   frag->protocol = packet->protocol;
+   frag->headerLength = 0;
+   frag->dataLength = 0;
+   frag->receivedLength = 0;
+   frag->memSize = 0;
+   frag->rangeCount = 0;
+
+   //Insert the entry in the hash bucket
+   frag->hashNext = interface->ipv4FragHashTable[i];
+   interface->ipv4FragHashTable[i] = frag;
+
+   //The newest datagram is appended to the age list
+   frag->agePrev = interface->ipv4FragAgeTail;
+   frag->ageNext = NULL;
+
+   if(interface->ipv4FragAgeTail != NULL)
+      interface->ipv4FragAgeTail->ageNext = frag;
+   else
+      interface->ipv4FragAgeHead = frag;
+
+   interface->ipv4FragAgeTail = frag;
+
+   //Save current time
+   frag->timestamp = osGetTickCount();
+   //Start the reassembly timer
+   netTimerSchedule(&interface->ipv4FragTimer, IPV4_FRAG_TIME_TO_LIVE);
+
+   //Return the matching fragment descriptor
+   return frag;
 }
 
 
@@ -525,61 +677,168 @@ Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *pac
 
 void ipv4FlushFragQueue(NetInterface *interface)
 {
-   uint_t i;
-
    //Acquire exclusive access to the reassembly queue
    osMutexAcquire(interface->ipv4FragQueueMutex);
 
-   //Loop through the reassembly queue
-   for(i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+   //Drop any partially reconstructed datagram
+   while(interface->ipv4FragAgeHead != NULL)
+      ipv4DeleteFragDesc(interface, interface->ipv4FragAgeHead);
+
+   //Release exclusive access to the reassembly queue
+   osMutexRelease(interface->ipv4FragQueueMutex);
+}
+
+
+/**
+ * @brief Remove a datagram from the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] frag IPv4 fragment descriptor
+ **/
+
+void ipv4DeleteFragDesc(NetInterface *interface, Ipv4FragDesc *frag)
+{
+   uint_t i;
+   Ipv4FragDesc **p;
+
+   //Release the memory blocks holding the fragments
+   for(i = 0; i < frag->rangeCount; i++)
+      memPoolFree(frag->range[i].block);
+
+   //Update memory usage
+   interface->ipv4FragMemUsage -= frag->memSize;
+
+   //Unlink the entry from its hash bucket
+   for(p = &interface->ipv4FragHashTable[ipv4FragHash(frag->srcAddr,
+      frag->destAddr, frag->identification, frag->protocol)]; *p != NULL; p = &(*p)->hashNext)
    {
-      //Drop any partially reconstructed datagram
-      chunkedBufferSetLength((ChunkedBuffer *) &interface->ipv4FragQueue[i].buffer, 0);
+      //Matching entry?
+      if(*p == frag)
+      {
+         *p = frag->hashNext;
+         break;
+      }
    }
 
+   //Unlink the entry from the age list
+   if(frag->agePrev != NULL)
+      frag->agePrev->ageNext = frag->ageNext;
+   else
+      interface->ipv4FragAgeHead = frag->ageNext;
+
+   if(frag->ageNext != NULL)
+      frag->ageNext->agePrev = frag->agePrev;
+   else
+      interface->ipv4FragAgeTail = frag->agePrev;
+
+   //The entry is now free
+   frag->used = FALSE;
+   frag->rangeCount = 0;
+   frag->memSize = 0;
+}
+
+
+/**
+ * @brief Make room for a new fragment within the memory budget
+ *
+ * The oldest datagrams are dropped first, since they are the most likely
+ * to have lost a fragment. The datagram being reassembled is never dropped
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Datagram the new fragment belongs to
+ * @param[in] size Number of bytes required
+ * @return TRUE if the fragment fits within the budget, else FALSE
+ **/
+
+bool_t ipv4ReclaimFragMem(NetInterface *interface, Ipv4FragDesc *frag, size_t size)
+{
+   Ipv4FragDesc *oldest;
+
+   //Enforce the memory budget of the reassembly queue
+   while((interface->ipv4FragMemUsage + size) > IPV4_FRAG_MEM_LIMIT)
+   {
+      //Point to the oldest datagram
+      oldest = interface->ipv4FragAgeHead;
+
+      //Skip the datagram being reassembled
+      if(oldest == frag)
+         oldest = oldest->ageNext;
+      //No other datagram to evict?
+      if(oldest == NULL)
+         return FALSE;
+
+      //Update statistics
+      interface->ipv4FragStats.evictions++;
+      interface->ipv4FragStats.reasmFails++;
+
+      //Drop the oldest datagram
+      ipv4DeleteFragDesc(interface, oldest);
+   }
+
+   //The new fragment fits within the budget
+   return TRUE;
+}
+
+
+/**
+ * @brief Retrieve reassembly statistics
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Snapshot of the reassembly counters
+ **/
+
+void ipv4FragGetStats(NetInterface *interface, Ipv4FragStats *stats)
+{
+   //Acquire exclusive access to the reassembly queue
+   osMutexAcquire(interface->ipv4FragQueueMutex);
+   //Take a consistent snapshot of the counters
+   *stats = interface->ipv4FragStats;
    //Release exclusive access to the reassembly queue
    osMutexRelease(interface->ipv4FragQueueMutex);
 }
 
 
 /**
- * @brief Retrieve hole descriptor
- * @param[in] frag IPv4 fragment descriptor
- * @param[in] offset Offset of the hole
- * @return A pointer to the hole descriptor is returned if the
- *   specified offset is valid. Otherwise NULL is returned
+ * @brief Hash function used to index the reassembly queue
+ * @param[in] srcAddr Source address
+ * @param[in] destAddr Destination address
+ * @param[in] id Identification field
+ * @param[in] protocol Protocol field
+ * @return Index of the hash bucket
  **/
 
-Ipv4HoleDesc *ipv4FindHole(Ipv4FragDesc *frag, uint16_t offset)
+uint_t ipv4FragHash(Ipv4Addr srcAddr, Ipv4Addr destAddr, uint16_t id, uint8_t protocol)
 {
-   //Return a pointer to the hole descriptor
-   return chunkedBufferAt((ChunkedBuffer *) &frag->buffer, frag->headerLength + offset);
+   uint32_t h;
+
+   //Successive datagrams from a given host differ in their identification
+   //field, which is folded regardless of the byte order
+   h = srcAddr ^ destAddr ^ id ^ protocol;
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (IPV4_FRAG_HASH_TABLE_SIZE - 1);
 }
 
 
 /**
- * @brief Dump hole descriptor list
+ * @brief Dump fragment list
  * @param[in] frag IPv4 fragment descriptor
  **/
 
-void ipv4DumpHoleList(Ipv4FragDesc *frag)
+void ipv4DumpFragList(Ipv4FragDesc *frag)
 {
 //Check debugging level
 #if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
-   Ipv4HoleDesc *hole;
+   uint_t i;
 
    //Debug message
-   TRACE_DEBUG("Hole descriptor list:\r\n");
-   //Select the first hole descriptor from the list
-   hole = ipv4FindHole(frag, frag->firstHole);
+   TRACE_DEBUG("Fragment list:\r\n");
 
-   //Loop through the hole descriptor list
-   while(hole != NULL)
+   //Loop through the fragment list
+   for(i = 0; i < frag->rangeCount; i++)
    {
-      //Display current hole
-      TRACE_DEBUG("  %u - %u\r\n", hole->first, hole->last);
-      //Select the next hole descriptor from the list
-      hole = ipv4FindHole(frag, hole->next);
+      //Display current fragment
+      TRACE_DEBUG("  %u - %u\r\n", frag->range[i].first, frag->range[i].last);
    }
 #endif
 }
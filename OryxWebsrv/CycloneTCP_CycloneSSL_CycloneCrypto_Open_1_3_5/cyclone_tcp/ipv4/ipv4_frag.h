@@ -40,13 +40,6 @@
    #error IPV4_FRAG_SUPPORT parameter is invalid
 #endif
 
-//Reassembly algorithm tick interval
-#ifndef IPV4_FRAG_TICK_INTERVAL
-   #define IPV4_FRAG_TICK_INTERVAL 1000
-#elif (IPV4_FRAG_TICK_INTERVAL < 100)
-   #error IPV4_FRAG_TICK_INTERVAL parameter is invalid
-#endif
-
 //Maximum number of fragmented packets the host will accept
 //and hold in the reassembly queue simultaneously
 #ifndef IPV4_MAX_FRAG_DATAGRAMS
@@ -69,34 +62,49 @@
    #error IPV4_FRAG_TIME_TO_LIVE parameter is invalid
 #endif
 
-//Maximum payload size for fragmented packets (shall be a multiple of 8-byte blocks)
-#define IPV4_MAX_FRAG_SIZE (IPV4_MAX_PAYLOAD_SIZE & ~0x0007)
-//Infinity is implemented by a very large integer
-#define IPV4_INFINITY 0xFFFF
+//Maximum number of fragments held for a given datagram
+#ifndef IPV4_MAX_FRAG_COUNT
+   #define IPV4_MAX_FRAG_COUNT 8
+#elif (IPV4_MAX_FRAG_COUNT < 1 || IPV4_MAX_FRAG_COUNT > 64)
+   #error IPV4_MAX_FRAG_COUNT parameter is invalid
+#endif
 
+//Memory that the reassembly queue may use, in bytes
+#ifndef IPV4_FRAG_MEM_LIMIT
+   #define IPV4_FRAG_MEM_LIMIT 16384
+#elif (IPV4_FRAG_MEM_LIMIT < (IPV4_MAX_FRAG_DATAGRAM_SIZE + MEM_POOL_BUFFER_SIZE))
+   #error IPV4_FRAG_MEM_LIMIT parameter is invalid
+#endif
 
-#if (defined(__GNUC__) || defined(_WIN32))
-   #define __packed
-   #pragma pack(push, 1)
+//Size of the hash table used to index the reassembly queue
+#ifndef IPV4_FRAG_HASH_TABLE_SIZE
+   #define IPV4_FRAG_HASH_TABLE_SIZE 8
+#elif (IPV4_FRAG_HASH_TABLE_SIZE < 1 || (IPV4_FRAG_HASH_TABLE_SIZE & (IPV4_FRAG_HASH_TABLE_SIZE - 1)) != 0)
+   #error IPV4_FRAG_HASH_TABLE_SIZE parameter is invalid
 #endif
 
+//Maximum payload size for fragmented packets (shall be a multiple of 8-byte blocks)
+#define IPV4_MAX_FRAG_SIZE (IPV4_MAX_PAYLOAD_SIZE & ~0x0007)
+//Amount of data that must immediately follow the header of a reassembled datagram
+#define IPV4_FRAG_PULLUP_SIZE 128
+
 
 /**
- * @brief Hole descriptor
+ * @brief Fragment descriptor
+ *
+ * Each fragment is copied once in a memory block of its own. Overlapping
+ * data is trimmed upon insertion so that the fragments of a given datagram
+ * never overlap and can be chained without any further copy
  **/
 
-__packed typedef struct
+typedef struct
 {
-   uint16_t first;
-   uint16_t last;
-   uint16_t next;
-} Ipv4HoleDesc;
-
-
-#if (defined(__GNUC__) || defined(_WIN32))
-   #undef __packed
-   #pragma pack(pop)
-#endif
+   uint16_t first;  ///<Offset of the first byte
+   uint16_t last;   ///<Offset immediately following the last byte
+   uint8_t *data;   ///<Data of the fragment, starting at offset first
+   void *block;     ///<Memory block holding the fragment
+   size_t size;     ///<Bytes charged against the memory budget
+} Ipv4FragRange;
 
 
 /**
@@ -107,7 +115,7 @@ typedef struct
 {
    uint_t chunkCount;
    uint_t maxChunkCount;
-   ChunkDesc chunk[N(IPV4_MAX_FRAG_DATAGRAM_SIZE) + 1];
+   ChunkDesc chunk[IPV4_MAX_FRAG_COUNT];
 } Ipv4ReassemblyBuffer;
 
 
@@ -115,16 +123,41 @@ typedef struct
  * @brief Fragmented packet descriptor
  **/
 
-typedef struct
+typedef struct _Ipv4FragDesc
 {
-   time_t timestamp;            ///<Time at which the first fragment was received
-   size_t headerLength;         ///<Length of the header
-   size_t dataLength;           ///<Length of the payload
-   uint16_t firstHole;          ///<Index of the first hole
-   Ipv4ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
+   struct _Ipv4FragDesc *hashNext;             ///<Next datagram in the same hash bucket
+   struct _Ipv4FragDesc *agePrev;              ///<Datagram created just before this one
+   struct _Ipv4FragDesc *ageNext;              ///<Datagram created just after this one
+   bool_t used;                                ///<The descriptor is in use
+   time_t timestamp;                           ///<Time at which the first fragment was received
+   Ipv4Addr srcAddr;                           ///<Source address
+   Ipv4Addr destAddr;                          ///<Destination address
+   uint16_t identification;                    ///<Identification field
+   uint8_t protocol;                           ///<Protocol field
+   size_t headerLength;                        ///<Length of the header (0 until fragment zero is received)
+   size_t dataLength;                          ///<Length of the payload (0 until the last fragment is received)
+   size_t receivedLength;                      ///<Number of payload bytes received so far
+   size_t memSize;                             ///<Bytes charged against the memory budget
+   uint_t rangeCount;                          ///<Number of fragments
+   Ipv4FragRange range[IPV4_MAX_FRAG_COUNT];   ///<Fragments, sorted by offset
 } Ipv4FragDesc;
 
 
+/**
+ * @brief Reassembly statistics
+ **/
+
+typedef struct
+{
+   uint32_t reasmReqds;   ///<Fragments received
+   uint32_t reasmOks;     ///<Datagrams successfully reassembled
+   uint32_t reasmFails;   ///<Datagrams dropped for any reason
+   uint32_t timeouts;     ///<Datagrams dropped upon expiration of the reassembly timer
+   uint32_t evictions;    ///<Datagrams dropped to make room for newer ones
+   uint32_t overlaps;     ///<Fragments that overlapped previously received data
+} Ipv4FragStats;
+
+
 //IPv4 datagram fragmentation and reassembly
 error_t ipv4FragmentDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
    uint16_t id, const ChunkedBuffer *payload, size_t payloadOffset, uint8_t timeToLive);
@@ -132,12 +165,22 @@ error_t ipv4FragmentDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHe
 void ipv4ReassembleDatagram(NetInterface *interface,
    const MacAddr *srcMacAddr, const Ipv4Header *packet, size_t length);
 
+error_t ipv4InsertFragment(NetInterface *interface, Ipv4FragDesc *frag,
+   const Ipv4Header *packet, uint16_t dataFirst, uint16_t dataLast);
+
+void ipv4CompleteDatagram(NetInterface *interface,
+   const MacAddr *srcMacAddr, Ipv4FragDesc *frag);
+
 void ipv4FragTick(NetInterface *interface);
 
 Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *packet);
 void ipv4FlushFragQueue(NetInterface *interface);
+void ipv4DeleteFragDesc(NetInterface *interface, Ipv4FragDesc *frag);
+bool_t ipv4ReclaimFragMem(NetInterface *interface, Ipv4FragDesc *frag, size_t size);
+
+void ipv4FragGetStats(NetInterface *interface, Ipv4FragStats *stats);
+uint_t ipv4FragHash(Ipv4Addr srcAddr, Ipv4Addr destAddr, uint16_t id, uint8_t protocol);
 
-Ipv4HoleDesc *ipv4FindHole(Ipv4FragDesc *frag, uint16_t offset);
-void ipv4DumpHoleList(Ipv4FragDesc *frag);
+void ipv4DumpFragList(Ipv4FragDesc *frag);
 
 #endif
@@ -0,0 +1,738 @@
+/**
+ * @file ipv4_frag_fuzz.c
+ * @brief IPv4 reassembly fuzzer and benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Random UDP datagrams are cut into fragments, which are shuffled and handed
+ * over to the IPv4 layer of the server end of the loopback link, as if they
+ * had been received by its network interface. Some rounds interleave several datagrams, duplicate
+ * fragments, add overlapping fragments carrying the same data, or mix in
+ * random fragments. Every datagram that comes out of the reassembly engine
+ * is read from a UDP socket and compared with the original, and the
+ * bookkeeping of the reassembly queue is checked after each fragment.
+ * The reassembly timeout is then checked, and the number of datagrams
+ * reassembled per second is measured for in-order, shuffled and
+ * interleaved fragments
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "ip.h"
+#include "ipv4.h"
+#include "ipv4_frag.h"
+#include "udp.h"
+#include "loopback_link.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//UDP port of the datagrams
+#define FUZZ_PORT 7000
+//Maximum number of datagrams per round
+#define FUZZ_MAX_DATAGRAMS 8
+//Maximum number of fragments per round
+#define FUZZ_MAX_FRAGS 256
+//Size of the largest UDP payload
+#define FUZZ_MAX_PAYLOAD_SIZE (IPV4_MAX_FRAG_DATAGRAM_SIZE - 60 - sizeof(UdpHeader))
+//Number of datagrams per benchmark
+#define BENCH_DATAGRAMS 100000
+
+
+/**
+ * @brief Original datagram
+ **/
+
+typedef struct
+{
+   uint8_t header[60];                       ///<IPv4 header, options included
+   size_t headerLength;                      ///<Length of the IPv4 header
+   uint8_t data[IPV4_MAX_FRAG_DATAGRAM_SIZE]; ///<UDP header and payload
+   size_t length;                            ///<Length of the IPv4 payload
+   uint_t received;                          ///<Number of times the datagram was delivered
+} FuzzDatagram;
+
+
+/**
+ * @brief Fragment of an original datagram
+ **/
+
+typedef struct
+{
+   uint_t index;   ///<Index of the datagram
+   size_t first;   ///<Offset of the first byte
+   size_t last;    ///<Offset immediately following the last byte
+} FuzzFrag;
+
+
+//Global variables
+static FuzzDatagram datagram[FUZZ_MAX_DATAGRAMS];
+static FuzzFrag frag[FUZZ_MAX_FRAGS];
+static uint_t fragCount;
+static uint8_t packet[IPV4_MAX_FRAG_DATAGRAM_SIZE];
+static uint8_t buffer[IPV4_MAX_FRAG_DATAGRAM_SIZE];
+static uint16_t identification;
+static uint32_t seed = 1;
+static uint_t failures;
+static Socket *udpSocket;
+
+
+/**
+ * @brief Pseudo-random number generator (xorshift)
+ * @return Random value
+ **/
+
+static uint32_t fuzzRand(void)
+{
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+
+/**
+ * @brief Report a failure
+ * @param[in] message Description of the failure
+ **/
+
+static void fuzzFail(const char_t *message)
+{
+   //Only the first failures are displayed
+   if(failures++ < 10)
+      printf("FAILED: %s\r\n", message);
+}
+
+
+/**
+ * @brief Generate a random UDP datagram
+ * @param[in] index Index of the datagram
+ * @param[in] length Length of the UDP payload
+ **/
+
+static void fuzzNewDatagram(uint_t index, size_t length)
+{
+   size_t i;
+   Ipv4Header *header;
+   UdpHeader *udpHeader;
+   FuzzDatagram *d;
+
+   //Point to the datagram
+   d = &datagram[index];
+   d->received = 0;
+
+   //IPv4 header, followed by a random number of NOP options
+   header = (Ipv4Header *) d->header;
+   d->headerLength = sizeof(Ipv4Header) + 4 * (fuzzRand() % 11);
+   memset(d->header, IPV4_OPTION_NOP, sizeof(d->header));
+   memset(header, 0, sizeof(Ipv4Header));
+   header->version = IPV4_VERSION;
+   header->headerLength = d->headerLength / 4;
+   header->identification = htons(identification++);
+   header->timeToLive = 64;
+   header->protocol = IPV4_PROTOCOL_UDP;
+   ipv4StringToAddr(LOOPBACK_LINK_CLIENT_ADDR, &header->srcAddr);
+   ipv4StringToAddr(LOOPBACK_LINK_SERVER_ADDR, &header->destAddr);
+
+   //UDP header (the source port identifies the datagram, no checksum)
+   d->length = sizeof(UdpHeader) + length;
+   udpHeader = (UdpHeader *) d->data;
+   udpHeader->srcPort = htons(FUZZ_PORT + 1 + index);
+   udpHeader->destPort = htons(FUZZ_PORT);
+   udpHeader->length = htons(d->length);
+   udpHeader->checksum = 0;
+
+   //Random payload
+   for(i = sizeof(UdpHeader); i < d->length; i++)
+      d->data[i] = fuzzRand();
+}
+
+
+/**
+ * @brief Cut a datagram into fragments
+ * @param[in] index Index of the datagram
+ * @param[in] overlaps Add overlapping and duplicate fragments
+ **/
+
+static void fuzzCutDatagram(uint_t index, bool_t overlaps)
+{
+   uint_t i;
+   size_t first;
+   size_t last;
+   size_t size;
+   FuzzDatagram *d;
+
+   //Point to the datagram
+   d = &datagram[index];
+
+   //Fragments of 1000 to 1440 bytes, so that fragment zero fits in a 1500-byte MTU
+   for(first = 0; first < d->length && fragCount < FUZZ_MAX_FRAGS; first = last)
+   {
+      size = (1000 + fuzzRand() % 441) & ~7;
+      last = min(first + size, d->length);
+      frag[fragCount].index = index;
+      frag[fragCount].first = first;
+      frag[fragCount].last = last;
+      fragCount++;
+   }
+
+   //Add fragments overlapping the previous ones with the same data
+   for(i = 0; overlaps && i < 3 && fragCount < (FUZZ_MAX_FRAGS - 1); i++)
+   {
+      first = (fuzzRand() % d->length) & ~7;
+      size = 8 + ((fuzzRand() % 1400) & ~7);
+      last = min(first + size, d->length);
+
+      frag[fragCount].index = index;
+      frag[fragCount].first = first;
+      frag[fragCount].last = last;
+      fragCount++;
+
+      //Duplicate fragment
+      if(fuzzRand() & 1)
+      {
+         frag[fragCount] = frag[fragCount - 1];
+         fragCount++;
+      }
+   }
+}
+
+
+/**
+ * @brief Shuffle the fragments of the round
+ **/
+
+static void fuzzShuffle(void)
+{
+   uint_t i;
+   uint_t j;
+   FuzzFrag temp;
+
+   //Fisher-Yates shuffle
+   for(i = fragCount; i > 1; i--)
+   {
+      j = fuzzRand() % i;
+      temp = frag[i - 1];
+      frag[i - 1] = frag[j];
+      frag[j] = temp;
+   }
+}
+
+
+/**
+ * @brief Feed a fragment to the reassembly engine
+ * @param[in] f Fragment to send
+ **/
+
+static void fuzzSendFrag(const FuzzFrag *f)
+{
+   size_t n;
+   uint16_t offset;
+   Ipv4Header *header;
+   FuzzDatagram *d;
+
+   //Point to the datagram
+   d = &datagram[f->index];
+   header = (Ipv4Header *) packet;
+
+   //Options are only copied in the first fragment
+   n = f->first ? sizeof(Ipv4Header) : d->headerLength;
+   memcpy(packet, d->header, n);
+   header->headerLength = n / 4;
+
+   //Copy the data
+   memcpy(packet + n, d->data + f->first, f->last - f->first);
+
+   //Fragment offset and More Fragments flag
+   offset = f->first / 8;
+   if(f->last < d->length)
+      offset |= IPV4_FLAG_MF;
+
+   //Complete the header
+   header->fragmentOffset = htons(offset);
+   header->totalLength = htons(n + f->last - f->first);
+   header->headerChecksum = 0;
+   header->headerChecksum = ipCalcChecksum(header, n);
+
+   //Process the fragment as if it had been received by the server end
+   ipv4ProcessPacket(LOOPBACK_LINK_SERVER, NULL, header, n + f->last - f->first);
+}
+
+
+/**
+ * @brief Feed a random fragment to the reassembly engine
+ **/
+
+static void fuzzSendGarbage(void)
+{
+   size_t i;
+   size_t n;
+   size_t length;
+   Ipv4Header *header;
+
+   //Random contents
+   n = sizeof(Ipv4Header) + 4 * (fuzzRand() % 11);
+   length = fuzzRand() % 1500;
+   for(i = 0; i < (n + length); i++)
+      packet[i] = fuzzRand();
+
+   //Random fragments from another host, with an unused protocol
+   header = (Ipv4Header *) packet;
+   header->version = IPV4_VERSION;
+   header->headerLength = n / 4;
+   header->identification = htons(fuzzRand() % 4);
+   header->protocol = 253;
+   ipv4StringToAddr("10.0.0.99", &header->srcAddr);
+   ipv4StringToAddr(LOOPBACK_LINK_SERVER_ADDR, &header->destAddr);
+   header->fragmentOffset = htons((fuzzRand() & IPV4_OFFSET_MASK) | IPV4_FLAG_MF);
+   header->totalLength = htons(n + length);
+
+   //Some of them are last fragments
+   if(fuzzRand() & 1)
+      header->fragmentOffset &= ~htons(IPV4_FLAG_MF);
+   //Small offsets are more likely to hit the datagrams being reassembled
+   if(fuzzRand() & 1)
+      header->fragmentOffset &= ~htons(0x1F00);
+   //Make sure the packet is actually a fragment
+   if(!header->fragmentOffset)
+      header->fragmentOffset = htons(IPV4_FLAG_MF);
+
+   //Valid header checksum
+   header->headerChecksum = 0;
+   header->headerChecksum = ipCalcChecksum(header, n);
+
+   //Process the fragment as if it had been received by the server end
+   ipv4ProcessPacket(LOOPBACK_LINK_SERVER, NULL, header, n + length);
+}
+
+
+/**
+ * @brief Read and check the reassembled datagrams
+ **/
+
+static void fuzzReceive(void)
+{
+   error_t error;
+   size_t n;
+   uint_t index;
+   uint16_t port;
+   IpAddr ipAddr;
+   FuzzDatagram *d;
+
+   //Read all the datagrams waiting in the socket
+   while(1)
+   {
+      //Read a datagram (the socket does not block)
+      error = socketReceiveFrom(udpSocket, &ipAddr, &port, buffer, sizeof(buffer), &n, 0);
+      //No more datagrams?
+      if(error) break;
+
+      //The source port identifies the datagram
+      index = port - FUZZ_PORT - 1;
+
+      //Unknown datagram?
+      if(index >= FUZZ_MAX_DATAGRAMS)
+      {
+         fuzzFail("unknown datagram");
+         continue;
+      }
+
+      //Point to the original datagram
+      d = &datagram[index];
+      d->received++;
+
+      //Compare the payload with the original
+      if(n != (d->length - sizeof(UdpHeader)) || memcmp(buffer, d->data + sizeof(UdpHeader), n))
+         fuzzFail("reassembled datagram differs from the original");
+   }
+}
+
+
+/**
+ * @brief Check the bookkeeping of the reassembly queue
+ **/
+
+static void fuzzCheckQueue(void)
+{
+   uint_t i;
+   uint_t n;
+   uint_t m;
+   size_t memSize;
+   Ipv4FragDesc *f;
+   NetInterface *interface;
+
+   //Point to the server end
+   interface = LOOPBACK_LINK_SERVER;
+
+   //Acquire exclusive access to the reassembly queue
+   osMutexAcquire(interface->ipv4FragQueueMutex);
+
+   //Walk through the age list
+   for(n = 0, memSize = 0, f = interface->ipv4FragAgeHead; f; f = f->ageNext, n++)
+   {
+      //Memory charged against the budget
+      memSize += f->memSize;
+
+      //The age list is sorted by creation time
+      if(f->ageNext && timeCompare(f->ageNext->timestamp, f->timestamp) < 0)
+         fuzzFail("age list out of order");
+
+      //Fragments are sorted and never overlap
+      for(i = 1; i < f->rangeCount; i++)
+      {
+         if(f->range[i - 1].last > f->range[i].first)
+            fuzzFail("overlapping fragments in the list");
+      }
+   }
+
+   //Count the descriptors in use
+   for(m = 0, i = 0; i < IPV4_MAX_FRAG_DATAGRAMS; i++)
+      m += interface->ipv4FragQueue[i].used;
+
+   //Check the memory budget
+   if(n != m || memSize != interface->ipv4FragMemUsage || memSize > IPV4_FRAG_MEM_LIMIT)
+      fuzzFail("inconsistent memory accounting");
+
+   //Release exclusive access to the reassembly queue
+   osMutexRelease(interface->ipv4FragQueueMutex);
+}
+
+
+/**
+ * @brief Fuzz the reassembly engine
+ * @param[in] name Description of the scenario
+ * @param[in] count Number of datagrams per round
+ * @param[in] overlaps Add overlapping and duplicate fragments
+ * @param[in] garbage Mix random fragments in
+ * @param[in] rounds Number of rounds
+ **/
+
+static void fuzzRun(const char_t *name, uint_t count, bool_t overlaps,
+   bool_t garbage, uint_t rounds)
+{
+   uint_t i;
+   uint_t r;
+   uint_t lost;
+   uint_t sent;
+   uint_t reassembled;
+   Ipv4FragStats before;
+   Ipv4FragStats after;
+
+   //Run the rounds
+   for(sent = 0, reassembled = 0, r = 0; r < rounds; r++)
+   {
+      //Retrieve reassembly statistics
+      ipv4FragGetStats(LOOPBACK_LINK_SERVER, &before);
+
+      //Generate the datagrams and their fragments
+      for(fragCount = 0, i = 0; i < count; i++)
+      {
+         fuzzNewDatagram(i, 1 + fuzzRand() % FUZZ_MAX_PAYLOAD_SIZE);
+         fuzzCutDatagram(i, overlaps);
+      }
+
+      //Fragments arrive in random order
+      fuzzShuffle();
+
+      //Feed the fragments
+      for(i = 0; i < fragCount; i++)
+      {
+         //Random fragment
+         if(garbage && !(fuzzRand() % 4))
+            fuzzSendGarbage();
+
+         //Next fragment
+         fuzzSendFrag(&frag[i]);
+         //Read the reassembled datagrams
+         fuzzReceive();
+         //Check the reassembly queue
+         fuzzCheckQueue();
+      }
+
+      //Check the outcome of the round
+      for(lost = 0, i = 0; i < count; i++)
+      {
+         //Duplicates arriving after the datagram has been reassembled may
+         //form the same datagram again, otherwise it is only delivered once
+         if(datagram[i].received > 1 && !overlaps)
+            fuzzFail("datagram delivered twice");
+
+         //Update statistics
+         sent++;
+         reassembled += datagram[i].received ? 1 : 0;
+         lost += datagram[i].received ? 0 : 1;
+      }
+
+      //Retrieve reassembly statistics
+      ipv4FragGetStats(LOOPBACK_LINK_SERVER, &after);
+
+      //Every datagram that has been lost must have been dropped by the
+      //reassembly engine (too many fragments, memory budget or eviction)
+      if(lost > (after.reasmFails - before.reasmFails))
+         fuzzFail("datagram lost without being dropped");
+
+      //Drop the datagrams left over
+      ipv4FlushFragQueue(LOOPBACK_LINK_SERVER);
+
+      //The queue must not hold any memory anymore
+      if(LOOPBACK_LINK_SERVER->ipv4FragMemUsage)
+         fuzzFail("memory left in the reassembly queue");
+   }
+
+   //Display results
+   printf("%-32s %7u %7u %6.1f%%\r\n", name, sent, reassembled, 100.0 * reassembled / sent);
+}
+
+
+/**
+ * @brief Check the reassembly timeout
+ **/
+
+static void fuzzTimeout(void)
+{
+   Ipv4FragStats before;
+   Ipv4FragStats after;
+
+   //Retrieve reassembly statistics
+   ipv4FragGetStats(LOOPBACK_LINK_SERVER, &before);
+
+   //Send the first fragment only
+   fragCount = 0;
+   fuzzNewDatagram(0, 4000);
+   fuzzCutDatagram(0, FALSE);
+   fuzzSendFrag(&frag[0]);
+
+   //The datagram must be waiting for its missing fragments
+   if(!LOOPBACK_LINK_SERVER->ipv4FragAgeHead)
+      fuzzFail("incomplete datagram not queued");
+
+   //Wait for the reassembly timer to run out
+   osDelay(IPV4_FRAG_TIME_TO_LIVE + 2 * NIC_TICK_INTERVAL);
+
+   //Retrieve reassembly statistics
+   ipv4FragGetStats(LOOPBACK_LINK_SERVER, &after);
+
+   //The datagram must have been dropped
+   if(after.timeouts != (before.timeouts + 1) || LOOPBACK_LINK_SERVER->ipv4FragAgeHead ||
+      LOOPBACK_LINK_SERVER->ipv4FragMemUsage)
+   {
+      fuzzFail("incomplete datagram not dropped upon timeout");
+   }
+
+   //Display result
+   printf("%-32s %s\r\n", "Reassembly timeout",
+      (after.timeouts == (before.timeouts + 1)) ? "OK" : "FAILED");
+}
+
+
+/**
+ * @brief Measure the reassembly rate
+ * @param[in] name Description of the case
+ * @param[in] length Length of the UDP payload
+ * @param[in] shuffle Fragments arrive in random order
+ * @param[in] count Number of datagrams in flight
+ **/
+
+static void benchRun(const char_t *name, size_t length, bool_t shuffle, uint_t count)
+{
+   uint_t i;
+   uint_t k;
+   uint_t n;
+   uint64_t time;
+
+   //Generate the datagrams and their fragments once
+   for(fragCount = 0, i = 0; i < count; i++)
+   {
+      fuzzNewDatagram(i, length);
+      fuzzCutDatagram(i, FALSE);
+   }
+
+   //Fragments arrive in random order
+   if(shuffle)
+      fuzzShuffle();
+
+   //Start of the measurement
+   time = benchGetTime();
+
+   //Reassemble the datagrams over and over
+   for(n = 0; n < BENCH_DATAGRAMS; n += count)
+   {
+      //A new identification for each datagram
+      for(i = 0; i < count; i++)
+         ((Ipv4Header *) datagram[i].header)->identification = htons(identification++);
+
+      //Feed the fragments
+      for(k = 0; k < fragCount; k++)
+         fuzzSendFrag(&frag[k]);
+
+      //Read the reassembled datagrams
+      fuzzReceive();
+   }
+
+   //End of the measurement
+   time = benchGetTime() - time;
+
+   //Display results
+   printf("%-36s %11.0f\r\n", name, n * 1e9 / (time ? time : 1));
+}
+
+
+/**
+ * @brief Wait for the loopback link to carry datagrams
+ *
+ * The link state change event flushes the reassembly queue of the server
+ * end. It is processed before any frame that crosses the link, hence the
+ * fuzzer may start as soon as a datagram sent by the client end has been
+ * received
+ *
+ * @return Error code
+ **/
+
+static error_t fuzzWaitLink(void)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   uint16_t port;
+   IpAddr ipAddr;
+   IpAddr serverIpAddr;
+   Socket *socket;
+
+   //Open a UDP socket on the client end
+   socket = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_PROTOCOL_UDP);
+   //Failed to open socket?
+   if(!socket) return ERROR_OPEN_FAILED;
+
+   //Bind the socket to the client end
+   socketBindToInterface(socket, LOOPBACK_LINK_CLIENT);
+
+   //Destination of the datagram
+   serverIpAddr.length = sizeof(Ipv4Addr);
+   ipv4StringToAddr(LOOPBACK_LINK_SERVER_ADDR, &serverIpAddr.ipv4Addr);
+
+   //Wait for the server end to receive the datagram
+   socketSetTimeout(udpSocket, 100);
+
+   //The first datagrams may be lost while the address is being resolved
+   for(error = ERROR_TIMEOUT, i = 0; error && i < 50; i++)
+   {
+      //Send a datagram to the server end
+      error = socketSendTo(socket, &serverIpAddr, FUZZ_PORT, "sync", 4, NULL, 0);
+      //Wait for the datagram to cross the link
+      if(!error)
+         error = socketReceiveFrom(udpSocket, &ipAddr, &port, buffer, sizeof(buffer), &n, 0);
+   }
+
+   //The socket does not block
+   socketSetTimeout(udpSocket, 0);
+   //Close the client socket
+   socketClose(socket);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Main entry point
+ * @return Exit status
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   Ipv4FragStats stats;
+
+   //Initialize debug output
+   debugInit();
+
+   //Bring up the loopback link
+   error = loopbackLinkStart(NULL, NULL);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the loopback link!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Open the UDP socket that receives the reassembled datagrams
+   udpSocket = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_PROTOCOL_UDP);
+   //Failed to open socket?
+   if(!udpSocket) return EXIT_FAILURE;
+
+   //Bind the socket to the server end
+   socketBindToInterface(udpSocket, LOOPBACK_LINK_SERVER);
+   socketBind(udpSocket, &IP_ADDR_ANY, FUZZ_PORT);
+
+   //Wait for the link to be up
+   error = fuzzWaitLink();
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("The loopback link does not carry datagrams!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Display header
+   printf("%-32s %7s %7s %7s\r\n", "Fuzzing", "sent", "rebuilt", "ratio");
+
+   //Fuzz the reassembly engine
+   fuzzRun("shuffled", 1, FALSE, FALSE, 20000);
+   fuzzRun("shuffled, 3 interleaved", 3, FALSE, FALSE, 5000);
+   fuzzRun("overlapping and duplicate", 1, TRUE, FALSE, 20000);
+   fuzzRun("8 interleaved (eviction)", 8, FALSE, FALSE, 2000);
+   fuzzRun("overlaps and random fragments", 2, TRUE, TRUE, 10000);
+
+   //Check the reassembly timeout
+   fuzzTimeout();
+
+   //Retrieve reassembly statistics
+   ipv4FragGetStats(LOOPBACK_LINK_SERVER, &stats);
+
+   //Display statistics
+   printf("Fragments %u, reassembled %u, failed %u (timeouts %u, evictions %u), overlaps %u\r\n",
+      stats.reasmReqds, stats.reasmOks, stats.reasmFails, stats.timeouts,
+      stats.evictions, stats.overlaps);
+
+   //Display header
+   printf("%-36s %11s\r\n", "Reassembly", "datagrams/s");
+
+   //Measure the reassembly rate
+   benchRun("2 fragments, in order", 2 * 1480 - sizeof(UdpHeader), FALSE, 1);
+   benchRun("6 fragments, in order", 8000 - sizeof(UdpHeader), FALSE, 1);
+   benchRun("6 fragments, shuffled", 8000 - sizeof(UdpHeader), TRUE, 1);
+   benchRun("3 fragments, shuffled, 4 in flight", 4000 - sizeof(UdpHeader), TRUE, 4);
+
+   //Display result
+   printf("IPv4 reassembly: %s (%u failures)\r\n", failures ? "FAILED" : "OK", failures);
+
+   //Return status code
+   return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
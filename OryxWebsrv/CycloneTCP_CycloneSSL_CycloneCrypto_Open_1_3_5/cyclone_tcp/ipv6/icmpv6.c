@@ -93,6 +93,8 @@ void icmpv6ProcessMessage(NetInterface *interface, Ipv6PseudoHeader *pseudoHeade
    {
       //Debug message
       TRACE_WARNING("Wrong ICMPv6 header checksum!\r\n");
+      //Update statistics
+      interface->stats.checksumErrors++;
       //Exit immediately
       return;
    }
@@ -107,6 +107,13 @@ error_t ipv6Init(NetInterface *interface)
 
    //Clear the reassembly queue
    memset(interface->ipv6FragQueue, 0, sizeof(interface->ipv6FragQueue));
+   memset(interface->ipv6FragHashTable, 0, sizeof(interface->ipv6FragHashTable));
+   memset(&interface->ipv6FragStats, 0, sizeof(Ipv6FragStats));
+
+   //The reassembly queue is initially empty
+   interface->ipv6FragAgeHead = NULL;
+   interface->ipv6FragAgeTail = NULL;
+   interface->ipv6FragMemUsage = 0;
 #endif
 
    //Successful initialization
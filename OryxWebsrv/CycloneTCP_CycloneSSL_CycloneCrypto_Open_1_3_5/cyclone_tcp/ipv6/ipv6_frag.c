@@ -130,13 +130,12 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
    const ChunkedBuffer *buffer, size_t fragHeaderOffset, size_t nextHeaderOffset)
 {
    error_t error;
+   size_t n;
    size_t length;
    uint16_t offset;
    uint16_t dataFirst;
    uint16_t dataLast;
    Ipv6FragDesc *frag;
-   Ipv6HoleDesc *hole;
-   Ipv6HoleDesc *prevHole;
    Ipv6Header *packet;
    Ipv6FragmentHeader *header;
 
@@ -157,16 +156,19 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
    //Sanity check
    if(!header) return;
 
+   //Update statistics
+   interface->ipv6FragStats.reasmReqds++;
+
    //Calculate the length of the fragment
    length -= sizeof(Ipv6FragmentHeader);
    //Convert the fragment offset from network byte order
    offset = ntohs(header->fragmentOffset);
 
    //Every fragment except the last must contain a multiple of 8 bytes of data
-   if((offset & IPV6_FLAG_M) && (length % 8))
+   if((offset & IPV6_FLAG_M) && (length % 8 || !length))
    {
       //Compute the offset of the Payload Length field within the packet
-      size_t n = (uint8_t *) &packet->payloadLength - (uint8_t *) packet;
+      n = (uint8_t *) &packet->payloadLength - (uint8_t *) packet;
 
       //The fragment must be discarded and an ICMP Parameter Problem
       //message should be sent to the source of the fragment, pointing
@@ -178,6 +180,22 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
       return;
    }
 
+   //The size of the reconstructed datagram exceeds the maximum value?
+   if((fragHeaderOffset + (offset & IPV6_OFFSET_MASK) + length) > IPV6_MAX_FRAG_DATAGRAM_SIZE)
+   {
+      //Compute the offset of the Fragment Offset field within the packet
+      n = fragHeaderOffset + (uint8_t *) &header->fragmentOffset - (uint8_t *) header;
+
+      //The fragment must be discarded and an ICMP Parameter Problem
+      //message should be sent to the source of the fragment, pointing
+      //to the Fragment Offset field of the fragment packet
+      icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
+         ICMPV6_CODE_INVALID_HEADER_FIELD, n, buffer);
+
+      //Exit immediately
+      return;
+   }
+
    //Calculate the index of the first byte
    dataFirst = offset & IPV6_OFFSET_MASK;
    //Calculate the index immediately following the last byte
@@ -188,228 +206,302 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
    //No matching entry in the reassembly queue?
    if(!frag) return;
 
-   //The very first fragment requires special handling
-   if(!(offset & IPV6_OFFSET_MASK))
+   //The last fragment determines the length of the fragmentable part
+   if(!(offset & IPV6_FLAG_M))
+   {
+      //Make sure the length is consistent with previously received fragments
+      if(frag->fragPartLength != 0 && frag->fragPartLength != dataLast)
+         error = ERROR_INVALID_LENGTH;
+      else if(frag->rangeCount > 0 && frag->range[frag->rangeCount - 1].last > dataLast)
+         error = ERROR_INVALID_LENGTH;
+      else
+         error = NO_ERROR;
+
+      //Save the length of the fragmentable part
+      frag->fragPartLength = dataLast;
+   }
+   else
+   {
+      //No data can follow the last fragment
+      if(frag->fragPartLength != 0 && dataLast > frag->fragPartLength)
+         error = ERROR_INVALID_LENGTH;
+      else
+         error = NO_ERROR;
+   }
+
+   //Check status code
+   if(!error && length > 0)
+   {
+      //Add the fragment to the datagram being reassembled
+      error = ipv6InsertFragment(interface, frag, buffer,
+         fragHeaderOffset, nextHeaderOffset, dataFirst, dataLast);
+   }
+
+   //Any error to report?
+   if(error)
+   {
+      //Update statistics
+      interface->ipv6FragStats.reasmFails++;
+      //Drop the partially reconstructed datagram
+      ipv6DeleteFragDesc(interface, frag);
+      //Exit immediately
+      return;
+   }
+
+   //Dump fragment list
+   ipv6DumpFragList(frag);
+
+   //Since fragments never overlap, the reassembly process is complete
+   //as soon as the whole fragmentable part has been received
+   if(frag->fragPartLength != 0 && frag->receivedLength == frag->fragPartLength)
+   {
+      //Pass the original IPv6 datagram to the higher protocol layer
+      ipv6CompleteDatagram(interface, srcMacAddr, frag);
+      //Release previously allocated memory
+      ipv6DeleteFragDesc(interface, frag);
+   }
+}
+
+
+/**
+ * @brief Add a fragment to the datagram being reassembled
+ *
+ * The fragment list is kept sorted. Overlapping fragments cause the
+ * reassembly of the whole datagram to be abandoned (refer to RFC 5722),
+ * whereas exact duplicates are silently ignored
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag IPv6 fragment descriptor
+ * @param[in] buffer Multi-part buffer containing the incoming IPv6 packet
+ * @param[in] fragHeaderOffset Offset to the Fragment header
+ * @param[in] nextHeaderOffset Offset to the Next Header field of the previous header
+ * @param[in] dataFirst Index of the first byte
+ * @param[in] dataLast Index immediately following the last byte
+ * @return Error code
+ **/
+
+error_t ipv6InsertFragment(NetInterface *interface, Ipv6FragDesc *frag,
+   const ChunkedBuffer *buffer, size_t fragHeaderOffset, size_t nextHeaderOffset,
+   uint16_t dataFirst, uint16_t dataLast)
+{
+   uint_t i;
+   size_t size;
+   size_t unfragPartLength;
+   uint8_t *block;
+   Ipv6FragRange *range;
+   Ipv6FragmentHeader *header;
+
+   //Find the position of the new fragment in the sorted list
+   for(i = 0; i < frag->rangeCount; i++)
+   {
+      //Fragments are sorted by increasing offset
+      if(frag->range[i].first > dataFirst)
+         break;
+   }
+
+   //Duplicate fragment?
+   if(i > 0 && frag->range[i - 1].first == dataFirst && frag->range[i - 1].last == dataLast)
+      return NO_ERROR;
+
+   //Check whether the new fragment overlaps the preceding or the next one
+   if((i > 0 && frag->range[i - 1].last > dataFirst) ||
+      (i < frag->rangeCount && frag->range[i].first < dataLast))
    {
-      uint8_t *p;
+      //Update statistics
+      interface->ipv6FragStats.overlaps++;
+      //Reassembly of the datagram must be abandoned
+      return ERROR_INVALID_MESSAGE;
+   }
+
+   //Limit the number of fragments per datagram
+   if(frag->rangeCount >= IPV6_MAX_FRAG_COUNT)
+      return ERROR_OUT_OF_RESOURCES;
 
+   //Fragment zero is stored along with the unfragmentable part
+   if(dataFirst == 0)
+   {
       //Calculate the length of the unfragmentable part
-      frag->unfragPartLength = fragHeaderOffset;
+      unfragPartLength = fragHeaderOffset;
 
-      //The size of the reconstructed datagram exceeds the maximum value?
-      if((frag->unfragPartLength + frag->fragPartLength) > IPV6_MAX_FRAG_DATAGRAM_SIZE)
-      {
-         //Compute the offset of the Fragment Offset field within the packet
-         size_t n = fragHeaderOffset + (uint8_t *) &header->fragmentOffset -
-            (uint8_t *) header;
-
-         //The fragment must be discarded and an ICMP Parameter Problem
-         //message should be sent to the source of the fragment, pointing
-         //to the Fragment Offset field of the fragment packet
-         icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
-            ICMPV6_CODE_INVALID_HEADER_FIELD, n, buffer);
-
-         //Drop any allocated resources
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+      //Make sure the unfragmentable part and the data fit in a single block
+      if((unfragPartLength + dataLast) > MEM_POOL_BUFFER_SIZE)
+         return ERROR_INVALID_LENGTH;
 
-      //Make sure the unfragmentable part entirely fits in the first chunk
-      if(frag->unfragPartLength > frag->buffer.chunk[0].size)
-      {
-         //Drop the reconstructed datagram
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+      //Reserve a full block so that subsequent data can be pulled up
+      size = MEM_POOL_BUFFER_SIZE;
+   }
+   else
+   {
+      //Other fragments only hold their own data
+      unfragPartLength = 0;
+      size = dataLast - dataFirst;
+   }
+
+   //Enforce the memory budget of the reassembly queue
+   if(!ipv6ReclaimFragMem(interface, frag, size))
+      return ERROR_OUT_OF_MEMORY;
+
+   //Allocate a memory block to hold the fragment
+   block = memPoolAlloc(size);
+   //Failed to allocate memory?
+   if(!block)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Update memory usage
+   interface->ipv6FragMemUsage += size;
+   frag->memSize += size;
 
-      //Fix the length of the first chunk
-      frag->buffer.chunk[0].length = frag->unfragPartLength;
+   //Fragment zero?
+   if(unfragPartLength > 0)
+   {
+      //Point to the IPv6 Fragment header
+      header = chunkedBufferAt(buffer, fragHeaderOffset);
 
       //The unfragmentable part of the reassembled packet consists
       //of all headers up to, but not including, the Fragment header
       //of the first fragment packet
-      chunkedBufferCopy((ChunkedBuffer *) &frag->buffer, 0, buffer, 0, frag->unfragPartLength);
-
-      //Point to the Next Header field of the last header
-      p = chunkedBufferAt((ChunkedBuffer *) &frag->buffer, nextHeaderOffset);
+      chunkedBufferRead(block, buffer, 0, unfragPartLength);
 
       //The Next Header field of the last header of the unfragmentable
       //part is obtained from the Next Header field of the first
       //fragment's Fragment header
-      *p = header->nextHeader;
+      block[nextHeaderOffset] = header->nextHeader;
+
+      //Save the length of the unfragmentable part
+      frag->unfragPartLength = unfragPartLength;
    }
 
-   //It may be necessary to increase the size of the buffer...
-   if(dataLast > frag->fragPartLength)
-   {
-      //The size of the reconstructed datagram exceeds the maximum value?
-      if((frag->unfragPartLength + dataLast) > IPV6_MAX_FRAG_DATAGRAM_SIZE)
-      {
-         //Compute the offset of the Fragment Offset field within the packet
-         size_t n = fragHeaderOffset + (uint8_t *) &header->fragmentOffset - (uint8_t *) header;
-
-         //The fragment must be discarded and an ICMP Parameter Problem
-         //message should be sent to the source of the fragment, pointing
-         //to the Fragment Offset field of the fragment packet
-         icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
-            ICMPV6_CODE_INVALID_HEADER_FIELD, n, buffer);
-
-         //Drop any allocated resources
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+   //Copy fragment data
+   chunkedBufferRead(block + unfragPartLength, buffer,
+      fragHeaderOffset + sizeof(Ipv6FragmentHeader), dataLast - dataFirst);
 
-      //Adjust the size of the reconstructed datagram
-      error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-         frag->unfragPartLength + dataLast + sizeof(Ipv6HoleDesc));
+   //Make room for the new fragment
+   memmove(&frag->range[i + 1], &frag->range[i],
+      (frag->rangeCount - i) * sizeof(Ipv6FragRange));
 
-      //Any error to report?
-      if(error)
-      {
-         //Drop the reconstructed datagram
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+   //Update the number of fragments
+   frag->rangeCount++;
 
-      //Actual length of the fragmentable part
-      frag->fragPartLength = dataLast;
-   }
+   //Point to the new entry
+   range = &frag->range[i];
 
-   //Select the first hole descriptor from the list
-   hole = ipv6FindHole(frag, frag->firstHole);
-   //Keep track of the previous hole in the list
-   prevHole = NULL;
+   //Save fragment information
+   range->first = dataFirst;
+   range->last = dataLast;
+   range->data = block + unfragPartLength;
+   range->block = block;
+   range->size = size;
 
-   //Iterate through the hole descriptors
-   while(hole != NULL)
-   {
-      //Save lower and upper boundaries for later use
-      uint16_t holeFirst = hole->first;
-      uint16_t holeLast = hole->last;
+   //Update the amount of data received so far
+   frag->receivedLength += dataLast - dataFirst;
 
-      //Check whether the newly arrived fragment
-      //interacts with this hole in some way
-      if(dataFirst < holeLast && dataLast > holeFirst)
-      {
-         //The current descriptor is no longer valid. We will destroy
-         //it, and in the next two steps, we will determine whether
-         //or not it is necessary to create any new hole descriptors
-         if(prevHole != NULL)
-            prevHole->next = hole->next;
-         else
-            frag->firstHole = hole->next;
-
-         //Is there still a hole at the beginning of the segment?
-         if(dataFirst > holeFirst)
-         {
-            //Create a new entry that describes this hole
-            hole = ipv6FindHole(frag, holeFirst);
-            hole->first = holeFirst;
-            hole->last = dataFirst;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
-
-         //Is there still a hole at the end of the segment?
-         if(dataLast < holeLast && (offset & IPV6_FLAG_M))
-         {
-            //Create a new entry that describes this hole
-            hole = ipv6FindHole(frag, dataLast);
-            hole->first = dataLast;
-            hole->last = holeLast;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
-      }
-      else
-      {
-         //The newly arrived fragment does not interact with the current hole
-         prevHole = hole;
-      }
+   //Successful processing
+   return NO_ERROR;
+}
 
-      //Select the next hole descriptor from the list
-      hole = ipv6FindHole(frag, prevHole ? prevHole->next : frag->firstHole);
-   }
 
-   //Copy data from the fragment to the reassembly buffer
-   chunkedBufferCopy((ChunkedBuffer *) &frag->buffer, frag->unfragPartLength + dataFirst,
-      buffer, fragHeaderOffset + sizeof(Ipv6FragmentHeader), length);
+/**
+ * @brief Hand a fully reassembled datagram over to the higher protocol layer
+ *
+ * The fragments are chained together without copying them. Fragment zero
+ * holds the unfragmentable part, and is completed with data pulled up from
+ * the subsequent fragments whenever it is too short to hold the headers
+ * of the upper layers
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] srcMacAddr MAC address of the source
+ * @param[in] frag IPv6 fragment descriptor
+ **/
+
+void ipv6CompleteDatagram(NetInterface *interface,
+   const MacAddr *srcMacAddr, Ipv6FragDesc *frag)
+{
+   uint_t i;
+   uint_t j;
+   size_t n;
+   size_t pullupLength;
+   Ipv6Header *datagram;
+   Ipv6ReassemblyBuffer buffer;
+
+   //Point to the IPv6 header
+   datagram = frag->range[0].block;
 
-   //Dump hole descriptor list
-   ipv6DumpHoleList(frag);
+   //Number of chunks that comprise the reassembly buffer
+   buffer.chunkCount = frag->rangeCount;
+   buffer.maxChunkCount = arraysize(buffer.chunk);
 
-   //If the hole descriptor list is empty, the reassembly process is now complete
-   if(!ipv6FindHole(frag, frag->firstHole))
+   //Chain the fragments together
+   for(i = 0; i < frag->rangeCount; i++)
    {
-      //Discard the extra hole descriptor that follows the reconstructed datagram
-      error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-         frag->unfragPartLength + frag->fragPartLength);
+      buffer.chunk[i].address = frag->range[i].data;
+      buffer.chunk[i].length = frag->range[i].last - frag->range[i].first;
+      buffer.chunk[i].size = 0;
+      buffer.chunk[i].flags = 0;
+   }
+
+   //The first chunk begins with the unfragmentable part
+   buffer.chunk[0].address = datagram;
+   buffer.chunk[0].length += frag->unfragPartLength;
 
-      //Check status code
-      if(!error)
+   //Amount of data that must immediately follow the unfragmentable part
+   pullupLength = min(frag->fragPartLength, IPV6_FRAG_PULLUP_SIZE);
+   pullupLength = min(pullupLength, MEM_POOL_BUFFER_SIZE - frag->unfragPartLength);
+   pullupLength += frag->unfragPartLength;
+
+   //Pull up data from the subsequent fragments if necessary
+   for(i = 1, j = 1; i < buffer.chunkCount; i++)
+   {
+      //Fragment zero is too short?
+      if(buffer.chunk[0].length < pullupLength)
       {
-         //Point to the IPv6 header
-         Ipv6Header *datagram = chunkedBufferAt((ChunkedBuffer *) &frag->buffer, 0);
+         //Number of bytes to move
+         n = min(pullupLength - buffer.chunk[0].length, buffer.chunk[i].length);
 
-         //Fix the Payload Length field
-         datagram->payloadLength = htons(frag->unfragPartLength +
-            frag->fragPartLength - sizeof(Ipv6Header));
+         //Append them to fragment zero
+         memcpy((uint8_t *) datagram + buffer.chunk[0].length, buffer.chunk[i].address, n);
+         buffer.chunk[0].length += n;
 
-         //Pass the original IPv6 datagram to the higher protocol layer
-         ipv6ProcessPacket(interface, srcMacAddr, (ChunkedBuffer *) &frag->buffer);
+         //Skip the data that has been moved
+         buffer.chunk[i].address = (uint8_t *) buffer.chunk[i].address + n;
+         buffer.chunk[i].length -= n;
       }
 
-      //Release previously allocated memory
-      chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
+      //Discard empty chunks
+      if(buffer.chunk[i].length > 0)
+         buffer.chunk[j++] = buffer.chunk[i];
    }
+
+   //Actual number of chunks
+   buffer.chunkCount = j;
+
+   //Fix the Payload Length field
+   datagram->payloadLength = htons(frag->unfragPartLength +
+      frag->fragPartLength - sizeof(Ipv6Header));
+
+   //Update statistics
+   interface->ipv6FragStats.reasmOks++;
+
+   //Pass the original IPv6 datagram to the higher protocol layer
+   ipv6ProcessPacket(interface, srcMacAddr, (ChunkedBuffer *) &buffer);
 }
 
 
 /**
  * @brief Fragment reassembly timeout handler
  *
- * This routine must be periodically called by the TCP/IP stack to
- * handle IPv6 fragment reassembly timeout
+ * This routine is invoked by the timer wheel when the reassembly timer of
+ * a datagram runs out. The timer is then re-armed with the earliest deadline
+ * left in the reassembly queue
  *
  * @param[in] interface Underlying network interface
  **/
 
 void ipv6FragTick(NetInterface *interface)
 {
-   error_t error;
-   uint_t i;
    time_t time;
-   Ipv6HoleDesc *hole;
+   int32_t delay;
+   Ipv6FragDesc *frag;
+   ChunkedBuffer1 buffer;
 
    //Acquire exclusive access to the reassembly queue
    osMutexAcquire(interface->ipv6FragQueueMutex);
@@ -417,48 +509,54 @@ void ipv6FragTick(NetInterface *interface)
    //Get current time
    time = osGetTickCount();
 
-   //Loop through the reassembly queue
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   //The age list is sorted by creation time, hence
+   //the datagrams that expire first are at its head
+   while(interface->ipv6FragAgeHead != NULL)
    {
-      //Point to the current entry in the reassembly queue
-      Ipv6FragDesc *frag = &interface->ipv6FragQueue[i];
+      //Point to the oldest datagram
+      frag = interface->ipv6FragAgeHead;
+
+      //Time remaining before the reassembly timer runs out
+      delay = timeCompare(frag->timestamp + IPV6_FRAG_TIME_TO_LIVE, time);
 
-      //Make sure the entry is currently in use
-      if(frag->buffer.chunkCount > 0)
+      //The remaining datagrams are still waiting for their missing fragments
+      if(delay > 0)
       {
-         //If the timer runs out, the partially-reassembled datagram must be
-         //discarded and ICMPv6 Time Exceeded message sent to the source host
-         if((time - frag->timestamp) >= IPV6_FRAG_TIME_TO_LIVE)
-         {
-            //Debug message
-            TRACE_INFO("IPv6 fragment reassembly timeout...\r\n");
-            //Dump IP header contents for debugging purpose
-            ipv6DumpHeader(frag->buffer.chunk[0].address);
-
-            //Point to the first hole descriptor
-            hole = ipv6FindHole(frag, frag->firstHole);
-
-            //Make sure the fragment zero has been received
-            //before sending an ICMPv6 message
-            if(hole != NULL && hole->first > 0)
-            {
-               //Fix the size of the reconstructed datagram
-               error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-                  frag->unfragPartLength + hole->first);
-
-               //Check status code
-               if(!error)
-               {
-                  //Send an ICMPv6 Time Exceeded message
-                  icmpv6SendErrorMessage(interface, ICMPV6_TYPE_TIME_EXCEEDED,
-                     ICMPV6_CODE_REASSEMBLY_TIME_EXCEEDED, 0, (ChunkedBuffer *) &frag->buffer);
-               }
-            }
-
-            //Drop the partially reconstructed datagram
-            chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         }
+         //Re-arm the reassembly timer
+         netTimerSchedule(&interface->ipv6FragTimer, delay);
+         //We are done
+         break;
       }
+
+      //Debug message
+      TRACE_INFO("IPv6 fragment reassembly timeout...\r\n");
+
+      //Make sure the fragment zero has been received
+      //before sending an ICMPv6 message
+      if(frag->unfragPartLength > 0)
+      {
+         //Fragment zero fits in a single chunk
+         buffer.chunkCount = 1;
+         buffer.maxChunkCount = 1;
+         buffer.chunk[0].address = frag->range[0].block;
+         buffer.chunk[0].length = frag->unfragPartLength + frag->range[0].last;
+         buffer.chunk[0].size = 0;
+         buffer.chunk[0].flags = 0;
+
+         //Dump IP header contents for debugging purpose
+         ipv6DumpHeader(buffer.chunk[0].address);
+
+         //Send an ICMPv6 Time Exceeded message
+         icmpv6SendErrorMessage(interface, ICMPV6_TYPE_TIME_EXCEEDED,
+            ICMPV6_CODE_REASSEMBLY_TIME_EXCEEDED, 0, (ChunkedBuffer *) &buffer);
+      }
+
+      //Update statistics
+      interface->ipv6FragStats.timeouts++;
+      interface->ipv6FragStats.reasmFails++;
+
+      //Drop the partially reconstructed datagram
+      ipv6DeleteFragDesc(interface, frag);
    }
 
    //Release exclusive access to the reassembly queue
@@ -468,6 +566,11 @@ void ipv6FragTick(NetInterface *interface)
 
 /**
  * @brief Search for a matching datagram in the reassembly queue
+ *
+ * A new entry is created if no datagram matches the incoming packet. When
+ * the reassembly queue is full, the oldest datagram is dropped to make room
+ * for the new one
+ *
  * @param[in] interface Underlying network interface
  * @param[in] packet Incoming IPv6 packet
  * @param[in] header Pointer to the Fragment header
@@ -477,98 +580,88 @@ void ipv6FragTick(NetInterface *interface)
 Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
    Ipv6Header *packet, Ipv6FragmentHeader *header)
 {
-   error_t error;
    uint_t i;
-   Ipv6Header *datagram;
+   uint_t j;
    Ipv6FragDesc *frag;
-   Ipv6HoleDesc *hole;
 
-   //Search for a matching IP datagram being reassembled
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
-   {
-      //Point to the current entry in the reassembly queue
-      frag = &interface->ipv6FragQueue[i];
+   //Datagrams are identified by source, destination and identification
+   i = ipv6FragHash(&packet->srcAddr, &packet->destAddr, header->identification);
 
-      //Check whether the current entry is used?
-      if(frag->buffer.chunkCount > 0)
-      {
-         //Point to the corresponding datagram
-         datagram = chunkedBufferAt((ChunkedBuffer *) &frag->buffer, 0);
-
-         //Check source and destination addresses
-         if(!ipv6CompAddr(&datagram->srcAddr, &packet->srcAddr))
-            continue;
-         if(!ipv6CompAddr(&datagram->destAddr, &packet->destAddr))
-            continue;
-         //Compare fragment identification fields
-         if(frag->identification != header->identification)
-            continue;
-
-         //A matching entry has been found in the reassembly queue
-         return frag;
-      }
+   //Search the hash bucket for a matching IP datagram being reassembled
+   for(frag = interface->ipv6FragHashTable[i]; frag != NULL; frag = frag->hashNext)
+   {
+      //Compare fragment identification fields
+      if(frag->identification != header->identification)
+         continue;
+      //Check source and destination addresses
+      if(!ipv6CompAddr(&frag->srcAddr, &packet->srcAddr))
+         continue;
+      if(!ipv6CompAddr(&frag->destAddr, &packet->destAddr))
+         continue;
+
+      //A matching entry has been found in the reassembly queue
+      return frag;
    }
 
    //If the current packet does not match an existing entry
    //in the reassembly queue, then create a new entry
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   for(frag = NULL, j = 0; j < IPV6_MAX_FRAG_DATAGRAMS; j++)
    {
-      //Point to the current entry in the reassembly queue
-      frag = &interface->ipv6FragQueue[i];
-
       //The current entry is free?
-      if(!frag->buffer.chunkCount)
+      if(!interface->ipv6FragQueue[j].used)
       {
-         //Number of chunks that comprise the reassembly buffer
-         frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
-
-         //Allocate sufficient memory to hold the IPv6 header and
-         //the first hole descriptor
-         error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-            MEM_POOL_BUFFER_SIZE + sizeof(Ipv6HoleDesc));
-
-         //Failed to allocate memory?
-         if(error)
-         {
-            //Clean up side effects
-            chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-            //Exit immediately
-            return NULL;
-         }
-
-         //Initial length of the reconstructed datagram
-         frag->unfragPartLength = sizeof(Ipv6Header);
-         frag->fragPartLength = 0;
-
-         //Fix the length of the first chunk
-         frag->buffer.chunk[0].length = frag->unfragPartLength;
-         //Copy IPv6 header from the incoming fragment
-         chunkedBufferWrite((ChunkedBuffer *) &frag->buffer, 0, packet, frag->unfragPartLength);
-
-         //Save current time
-         frag->timestamp = osGetTickCount();
-         //Record fragment identification field
-         frag->identification = header->identification;
-         //Create a new entry in the hole descriptor list
-         frag->firstHole = 0;
-
-         //Point to first hole descriptor
-         hole = ipv6FindHole(frag, frag->firstHole);
-         //The entry describes the datagram  as  being completely missing
-         hole->first = 0;
-         hole->last = IPV6_INFINITY;
-         hole->next = IPV6_INFINITY;
-
-         //Dump hole descriptor list
-         ipv6DumpHoleList(frag);
-
-         //Return the matching fragment descriptor
-         return frag;
+         frag = &interface->ipv6FragQueue[j];
+         break;
       }
    }
 
-   //The reassembly queue is full
-   return NULL;
+   //The reassembly queue is full?
+   if(frag == NULL)
+   {
+      //Point to the oldest datagram
+      frag = interface->ipv6FragAgeHead;
+
+      //Update statistics
+      interface->ipv6FragStats.evictions++;
+      interface->ipv6FragStats.reasmFails++;
+
+      //Drop it to make room for the new one
+      ipv6DeleteFragDesc(interface, frag);
+   }
+
+   //Initialize the new entry
+   frag->used = TRUE;
+   ipv6CopyAddr(&frag->srcAddr, &packet->srcAddr);
+   ipv6CopyAddr(&frag->destAddr, &packet->destAddr);
+   frag->identification = header->identification;
+   frag->unfragPartLength = 0;
+   frag->fragPartLength = 0;
+   frag->receivedLength = 0;
+   frag->memSize = 0;
+   frag->rangeCount = 0;
+
+   //Insert the entry in the hash bucket
+   frag->hashNext = interface->ipv6FragHashTable[i];
+   interface->ipv6FragHashTable[i] = frag;
+
+   //The newest datagram is appended to the age list
+   frag->agePrev = interface->ipv6FragAgeTail;
+   frag->ageNext = NULL;
+
+   if(interface->ipv6FragAgeTail != NULL)
+      interface->ipv6FragAgeTail->ageNext = frag;
+   else
+      interface->ipv6FragAgeHead = frag;
+
+   interface->ipv6FragAgeTail = frag;
+
+   //Save current time
+   frag->timestamp = osGetTickCount();
+   //Start the reassembly timer
+   netTimerSchedule(&interface->ipv6FragTimer, IPV6_FRAG_TIME_TO_LIVE);
+
+   //Return the matching fragment descriptor
+   return frag;
 }
 
 
@@ -579,61 +672,168 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
 
 void ipv6FlushFragQueue(NetInterface *interface)
 {
-   uint_t i;
-
    //Acquire exclusive access to the reassembly queue
    osMutexAcquire(interface->ipv6FragQueueMutex);
 
-   //Loop through the reassembly queue
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   //Drop any partially reconstructed datagram
+   while(interface->ipv6FragAgeHead != NULL)
+      ipv6DeleteFragDesc(interface, interface->ipv6FragAgeHead);
+
+   //Release exclusive access to the reassembly queue
+   osMutexRelease(interface->ipv6FragQueueMutex);
+}
+
+
+/**
+ * @brief Remove a datagram from the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] frag IPv6 fragment descriptor
+ **/
+
+void ipv6DeleteFragDesc(NetInterface *interface, Ipv6FragDesc *frag)
+{
+   uint_t i;
+   Ipv6FragDesc **p;
+
+   //Release the memory blocks holding the fragments
+   for(i = 0; i < frag->rangeCount; i++)
+      memPoolFree(frag->range[i].block);
+
+   //Update memory usage
+   interface->ipv6FragMemUsage -= frag->memSize;
+
+   //Unlink the entry from its hash bucket
+   for(p = &interface->ipv6FragHashTable[ipv6FragHash(&frag->srcAddr,
+      &frag->destAddr, frag->identification)]; *p != NULL; p = &(*p)->hashNext)
+   {
+      //Matching entry?
+      if(*p == frag)
+      {
+         *p = frag->hashNext;
+         break;
+      }
+   }
+
+   //Unlink the entry from the age list
+   if(frag->agePrev != NULL)
+      frag->agePrev->ageNext = frag->ageNext;
+   else
+      interface->ipv6FragAgeHead = frag->ageNext;
+
+   if(frag->ageNext != NULL)
+      frag->ageNext->agePrev = frag->agePrev;
+   else
+      interface->ipv6FragAgeTail = frag->agePrev;
+
+   //The entry is now free
+   frag->used = FALSE;
+   frag->rangeCount = 0;
+   frag->memSize = 0;
+}
+
+
+/**
+ * @brief Make room for a new fragment within the memory budget
+ *
+ * The oldest datagrams are dropped first, since they are the most likely
+ * to have lost a fragment. The datagram being reassembled is never dropped
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Datagram the new fragment belongs to
+ * @param[in] size Number of bytes required
+ * @return TRUE if the fragment fits within the budget, else FALSE
+ **/
+
+bool_t ipv6ReclaimFragMem(NetInterface *interface, Ipv6FragDesc *frag, size_t size)
+{
+   Ipv6FragDesc *oldest;
+
+   //Enforce the memory budget of the reassembly queue
+   while((interface->ipv6FragMemUsage + size) > IPV6_FRAG_MEM_LIMIT)
    {
-      //Drop any partially reconstructed datagram
-      chunkedBufferSetLength((ChunkedBuffer *) &interface->ipv6FragQueue[i].buffer, 0);
+      //Point to the oldest datagram
+      oldest = interface->ipv6FragAgeHead;
+
+      //Skip the datagram being reassembled
+      if(oldest == frag)
+         oldest = oldest->ageNext;
+      //No other datagram to evict?
+      if(oldest == NULL)
+         return FALSE;
+
+      //Update statistics
+      interface->ipv6FragStats.evictions++;
+      interface->ipv6FragStats.reasmFails++;
+
+      //Drop the oldest datagram
+      ipv6DeleteFragDesc(interface, oldest);
    }
 
+   //The new fragment fits within the budget
+   return TRUE;
+}
+
+
+/**
+ * @brief Retrieve reassembly statistics
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Snapshot of the reassembly counters
+ **/
+
+void ipv6FragGetStats(NetInterface *interface, Ipv6FragStats *stats)
+{
+   //Acquire exclusive access to the reassembly queue
+   osMutexAcquire(interface->ipv6FragQueueMutex);
+   //Take a consistent snapshot of the counters
+   *stats = interface->ipv6FragStats;
    //Release exclusive access to the reassembly queue
    osMutexRelease(interface->ipv6FragQueueMutex);
 }
 
 
 /**
- * @brief Retrieve hole descriptor
- * @param[in] frag IPv6 fragment descriptor
- * @param[in] offset Offset of the hole
- * @return A pointer to the hole descriptor is returned if the
- *   specified offset is valid. Otherwise NULL is returned
+ * @brief Hash function used to index the reassembly queue
+ * @param[in] srcAddr Source address
+ * @param[in] destAddr Destination address
+ * @param[in] id Fragment identification field
+ * @return Index of the hash bucket
  **/
 
-Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset)
+uint_t ipv6FragHash(const Ipv6Addr *srcAddr, const Ipv6Addr *destAddr, uint32_t id)
 {
-   //Return a pointer to the hole descriptor
-   return chunkedBufferAt((ChunkedBuffer *) &frag->buffer, frag->unfragPartLength + offset);
+   uint32_t h;
+
+   //Successive datagrams from a given host differ in their identification
+   //field, which is folded regardless of the byte order. Only the interface
+   //identifiers of the addresses are used, since prefixes are often shared
+   h = srcAddr->dw[2] ^ srcAddr->dw[3] ^ destAddr->dw[2] ^ destAddr->dw[3] ^ id;
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (IPV6_FRAG_HASH_TABLE_SIZE - 1);
 }
 
 
 /**
- * @brief Dump hole descriptor list
+ * @brief Dump fragment list
  * @param[in] frag IPv6 fragment descriptor
  **/
 
-void ipv6DumpHoleList(Ipv6FragDesc *frag)
+void ipv6DumpFragList(Ipv6FragDesc *frag)
 {
 //Check debugging level
 #if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
-   Ipv6HoleDesc *hole;
+   uint_t i;
 
    //Debug message
-   TRACE_DEBUG("Hole descriptor list:\r\n");
-   //Select the first hole descriptor from the list
-   hole = ipv6FindHole(frag, frag->firstHole);
+   TRACE_DEBUG("Fragment list:\r\n");
 
-   //Loop through the hole descriptor list
-   while(hole != NULL)
+   //Loop through the fragment list
+   for(i = 0; i < frag->rangeCount; i++)
    {
-      //Display current hole
-      TRACE_DEBUG("  %u - %u\r\n", hole->first, hole->last);
-      //Select the next hole descriptor from the list
-      hole = ipv6FindHole(frag, hole->next);
+      //Display current fragment
+      TRACE_DEBUG("  %u - %u\r\n", frag->range[i].first, frag->range[i].last);
    }
 #endif
 }
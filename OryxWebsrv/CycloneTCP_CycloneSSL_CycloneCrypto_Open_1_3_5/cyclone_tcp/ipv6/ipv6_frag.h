@@ -40,13 +40,6 @@
    #error IPV6_FRAG_SUPPORT parameter is invalid
 #endif
 
-//Reassembly algorithm tick interval
-#ifndef IPV6_FRAG_TICK_INTERVAL
-   #define IPV6_FRAG_TICK_INTERVAL 1000
-#elif (IPV6_FRAG_TICK_INTERVAL < 100)
-   #error IPV6_FRAG_TICK_INTERVAL parameter is invalid
-#endif
-
 //Maximum number of fragmented packets the host will accept
 //and hold in the reassembly queue simultaneously
 #ifndef IPV6_MAX_FRAG_DATAGRAMS
@@ -69,34 +62,48 @@
    #error IPV6_FRAG_TIME_TO_LIVE parameter is invalid
 #endif
 
-//Maximum payload size for fragmented packets (shall be a multiple of 8-byte blocks)
-#define IPV6_MAX_FRAG_SIZE ((IPV6_MAX_PAYLOAD_SIZE - sizeof(Ipv6FragmentHeader)) & ~0x0007)
-//Infinity is implemented by a very large integer
-#define IPV6_INFINITY 0xFFFF
+//Maximum number of fragments held for a given datagram
+#ifndef IPV6_MAX_FRAG_COUNT
+   #define IPV6_MAX_FRAG_COUNT 8
+#elif (IPV6_MAX_FRAG_COUNT < 1 || IPV6_MAX_FRAG_COUNT > 64)
+   #error IPV6_MAX_FRAG_COUNT parameter is invalid
+#endif
 
+//Memory that the reassembly queue may use, in bytes
+#ifndef IPV6_FRAG_MEM_LIMIT
+   #define IPV6_FRAG_MEM_LIMIT 16384
+#elif (IPV6_FRAG_MEM_LIMIT < (IPV6_MAX_FRAG_DATAGRAM_SIZE + MEM_POOL_BUFFER_SIZE))
+   #error IPV6_FRAG_MEM_LIMIT parameter is invalid
+#endif
 
-#if (defined(__GNUC__) || defined(_WIN32))
-   #define __packed
-   #pragma pack(push, 1)
+//Size of the hash table used to index the reassembly queue
+#ifndef IPV6_FRAG_HASH_TABLE_SIZE
+   #define IPV6_FRAG_HASH_TABLE_SIZE 8
+#elif (IPV6_FRAG_HASH_TABLE_SIZE < 1 || (IPV6_FRAG_HASH_TABLE_SIZE & (IPV6_FRAG_HASH_TABLE_SIZE - 1)) != 0)
+   #error IPV6_FRAG_HASH_TABLE_SIZE parameter is invalid
 #endif
 
+//Maximum payload size for fragmented packets (shall be a multiple of 8-byte blocks)
+#define IPV6_MAX_FRAG_SIZE ((IPV6_MAX_PAYLOAD_SIZE - sizeof(Ipv6FragmentHeader)) & ~0x0007)
+//Amount of data that must immediately follow the unfragmentable part of a reassembled datagram
+#define IPV6_FRAG_PULLUP_SIZE 128
+
 
 /**
- * @brief Hole descriptor
+ * @brief Fragment descriptor
+ *
+ * Each fragment is copied once in a memory block of its own, so that the
+ * fragments of a given datagram can be chained without any further copy
  **/
 
-__packed typedef struct
+typedef struct
 {
-   uint16_t first;
-   uint16_t last;
-   uint16_t next;
-} Ipv6HoleDesc;
-
-
-#if (defined(__GNUC__) || defined(_WIN32))
-   #undef __packed
-   #pragma pack(pop)
-#endif
+   uint16_t first;  ///<Offset of the first byte
+   uint16_t last;   ///<Offset immediately following the last byte
+   uint8_t *data;   ///<Data of the fragment, starting at offset first
+   void *block;     ///<Memory block holding the fragment
+   size_t size;     ///<Bytes charged against the memory budget
+} Ipv6FragRange;
 
 
 /**
@@ -107,7 +114,7 @@ typedef struct
 {
    uint_t chunkCount;
    uint_t maxChunkCount;
-   ChunkDesc chunk[N(IPV6_MAX_FRAG_DATAGRAM_SIZE) + 1];
+   ChunkDesc chunk[IPV6_MAX_FRAG_COUNT];
 } Ipv6ReassemblyBuffer;
 
 
@@ -115,17 +122,40 @@ typedef struct
  * @brief Fragmented packet descriptor
  **/
 
-typedef struct
+typedef struct _Ipv6FragDesc
 {
-   time_t timestamp;            ///<Time at which the first fragment was received
-   uint32_t identification;     ///<Fragment identification field
-   size_t unfragPartLength;     ///<Length of the unfragmentable part
-   size_t fragPartLength;       ///<Length of the fragmentable part
-   uint16_t firstHole;          ///<Index of the first hole
-   Ipv6ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
+   struct _Ipv6FragDesc *hashNext;             ///<Next datagram in the same hash bucket
+   struct _Ipv6FragDesc *agePrev;              ///<Datagram created just before this one
+   struct _Ipv6FragDesc *ageNext;              ///<Datagram created just after this one
+   bool_t used;                                ///<The descriptor is in use
+   time_t timestamp;                           ///<Time at which the first fragment was received
+   Ipv6Addr srcAddr;                           ///<Source address
+   Ipv6Addr destAddr;                          ///<Destination address
+   uint32_t identification;                    ///<Fragment identification field
+   size_t unfragPartLength;                    ///<Length of the unfragmentable part (0 until fragment zero is received)
+   size_t fragPartLength;                      ///<Length of the fragmentable part (0 until the last fragment is received)
+   size_t receivedLength;                      ///<Number of bytes of the fragmentable part received so far
+   size_t memSize;                             ///<Bytes charged against the memory budget
+   uint_t rangeCount;                          ///<Number of fragments
+   Ipv6FragRange range[IPV6_MAX_FRAG_COUNT];   ///<Fragments, sorted by offset
 } Ipv6FragDesc;
 
 
+/**
+ * @brief Reassembly statistics
+ **/
+
+typedef struct
+{
+   uint32_t reasmReqds;   ///<Fragments received
+   uint32_t reasmOks;     ///<Datagrams successfully reassembled
+   uint32_t reasmFails;   ///<Datagrams dropped for any reason
+   uint32_t timeouts;     ///<Datagrams dropped upon expiration of the reassembly timer
+   uint32_t evictions;    ///<Datagrams dropped to make room for newer ones
+   uint32_t overlaps;     ///<Datagrams dropped because of overlapping fragments
+} Ipv6FragStats;
+
+
 //IPv6 datagram fragmentation and reassembly
 error_t ipv6FragmentDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
    const ChunkedBuffer *payload, size_t payloadOffset, uint8_t hopLimit);
@@ -133,14 +163,25 @@ error_t ipv6FragmentDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHe
 void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
    const ChunkedBuffer *buffer, size_t fragHeaderOffset, size_t nextHeaderOffset);
 
+error_t ipv6InsertFragment(NetInterface *interface, Ipv6FragDesc *frag,
+   const ChunkedBuffer *buffer, size_t fragHeaderOffset, size_t nextHeaderOffset,
+   uint16_t dataFirst, uint16_t dataLast);
+
+void ipv6CompleteDatagram(NetInterface *interface,
+   const MacAddr *srcMacAddr, Ipv6FragDesc *frag);
+
 void ipv6FragTick(NetInterface *interface);
 
 Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
    Ipv6Header *packet, Ipv6FragmentHeader *header);
 
 void ipv6FlushFragQueue(NetInterface *interface);
+void ipv6DeleteFragDesc(NetInterface *interface, Ipv6FragDesc *frag);
+bool_t ipv6ReclaimFragMem(NetInterface *interface, Ipv6FragDesc *frag, size_t size);
+
+void ipv6FragGetStats(NetInterface *interface, Ipv6FragStats *stats);
+uint_t ipv6FragHash(const Ipv6Addr *srcAddr, const Ipv6Addr *destAddr, uint32_t id);
 
-Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset);
-void ipv6DumpHoleList(Ipv6FragDesc *frag);
+void ipv6DumpFragList(Ipv6FragDesc *frag);
 
 #endif
@@ -57,6 +57,8 @@
 
 error_t ndpInit(NetInterface *interface)
 {
+   uint_t i;
+
    //Create a mutex to prevent simultaneous access to Neighbor cache
    interface->ndpCacheMutex = osMutexCreate(FALSE);
    //Any error to report?
@@ -65,6 +67,17 @@ error_t ndpInit(NetInterface *interface)
 
    //Initialize Neighbor cache
    memset(interface->ndpCache, 0, sizeof(interface->ndpCache));
+   memset(interface->ndpHashTable, 0, sizeof(interface->ndpHashTable));
+   memset(&interface->ndpStats, 0, sizeof(NdpStats));
+
+   //Free entries are chained at the end of the LRU list
+   interface->ndpLruHead = NULL;
+   interface->ndpLruTail = NULL;
+   interface->ndpLastEntry = NULL;
+
+   //Build the LRU list
+   for(i = 0; i < NDP_CACHE_SIZE; i++)
+      ndpLruAppend(interface, &interface->ndpCache[i]);
 
    //Successful initialization
    return NO_ERROR;
@@ -90,10 +103,9 @@ void ndpFlushCache(NetInterface *interface)
       //Point to the current entry
       entry = &interface->ndpCache[i];
 
-      //Drop packets that are waiting for address resolution
-      ndpFlushQueuedPackets(interface, entry);
       //Release Neighbor cache entry
-      entry->state = NDP_STATE_NONE;
+      if(entry->state != NDP_STATE_NONE)
+         ndpDeleteEntry(interface, entry);
    }
 
    //Release exclusive access to Neighbor cache
@@ -103,45 +115,49 @@ void ndpFlushCache(NetInterface *interface)
 
 /**
  * @brief Create a new entry in the Neighbor cache
+ *
+ * Free entries are kept at the tail of the LRU list. When the cache is
+ * full, the least recently used entry is reclaimed
+ *
  * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv6 address
  * @return Pointer to the newly created entry
  **/
 
-NdpCacheEntry *ndpCreateEntry(NetInterface *interface)
+NdpCacheEntry *ndpCreateEntry(NetInterface *interface, const Ipv6Addr *ipAddr)
 {
    uint_t i;
    NdpCacheEntry *entry;
-   NdpCacheEntry *oldestEntry;
 
-   //Keep track of the oldest entry
-   oldestEntry = &interface->ndpCache[0];
+   //Point to the least recently used entry
+   entry = interface->ndpLruTail;
 
-   //Loop through Neighbor cache entries
-   for(i = 0; i < NDP_CACHE_SIZE; i++)
+   //The table runs out of space?
+   if(entry->state != NDP_STATE_NONE)
    {
-      //Point to the current entry
-      entry = &interface->ndpCache[i];
+      //Update statistics
+      interface->ndpStats.evictions++;
+      //Drop any pending packets and remove the entry from the hash table
+      ndpDeleteEntry(interface, entry);
+   }
 
-      //Check whether the entry is currently in used or not
-      if(entry->state == NDP_STATE_NONE)
-      {
-         //Erase contents
-         memset(entry, 0, sizeof(NdpCacheEntry));
-         //Return a pointer to the Neighbor cache entry
-         return entry;
-      }
+   //Remove the entry from the LRU list
+   ndpLruRemove(interface, entry);
+   //Erase contents
+   memset(entry, 0, sizeof(NdpCacheEntry));
 
-      //Keep track of the oldest entry in the table
-      if(timeCompare(entry->timestamp, oldestEntry->timestamp) < 0)
-         oldestEntry = entry;
-   }
+   //Record the IPv6 address
+   entry->ipAddr = *ipAddr;
+   //The entry becomes the most recently used one
+   ndpLruInsert(interface, entry);
+
+   //Insert the entry in the hash table
+   i = ndpHashAddr(ipAddr);
+   entry->hashNext = interface->ndpHashTable[i];
+   interface->ndpHashTable[i] = entry;
 
-   //Drop any pending packets
-   ndpFlushQueuedPackets(interface, oldestEntry);
-   //The oldest entry is removed whenever the table runs out of space
-   memset(oldestEntry, 0, sizeof(NdpCacheEntry));
    //Return a pointer to the Neighbor cache entry
-   return oldestEntry;
+   return entry;
 }
 
 
@@ -155,26 +171,193 @@ NdpCacheEntry *ndpCreateEntry(NetInterface *interface)
 
 NdpCacheEntry *ndpFindEntry(NetInterface *interface, const Ipv6Addr *ipAddr)
 {
-   uint_t i;
    NdpCacheEntry *entry;
 
-   //Loop through Neighbor cache entries
-   for(i = 0; i < NDP_CACHE_SIZE; i++)
-   {
-      //Point to the current entry
-      entry = &interface->ndpCache[i];
+   //Consecutive packets are usually sent to the same destination
+   entry = interface->ndpLastEntry;
 
-      //Check whether the entry is currently in used
-      if(entry->state != NDP_STATE_NONE)
+   //Last destination matches the specified address?
+   if(entry != NULL && entry->state != NDP_STATE_NONE &&
+      ipv6CompAddr(&entry->ipAddr, ipAddr))
+   {
+      //Update statistics
+      interface->ndpStats.fastPathHits++;
+   }
+   else
+   {
+      //Walk through the relevant hash bucket
+      for(entry = interface->ndpHashTable[ndpHashAddr(ipAddr)];
+         entry != NULL; entry = entry->hashNext)
       {
          //Current entry matches the specified address?
          if(ipv6CompAddr(&entry->ipAddr, ipAddr))
-            return entry;
+            break;
       }
+
+      //No matching entry in Neighbor cache...
+      if(entry == NULL)
+         return NULL;
+
+      //Save the last destination
+      interface->ndpLastEntry = entry;
    }
 
-   //No matching entry in Neighbor cache...
-   return NULL;
+   //The entry becomes the most recently used one
+   if(interface->ndpLruHead != entry)
+   {
+      ndpLruRemove(interface, entry);
+      ndpLruInsert(interface, entry);
+   }
+
+   //Return a pointer to the Neighbor cache entry
+   return entry;
+}
+
+
+/**
+ * @brief Delete an entry from the Neighbor cache
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the Neighbor cache entry to be released
+ **/
+
+void ndpDeleteEntry(NetInterface *interface, NdpCacheEntry *entry)
+{
+   NdpCacheEntry **p;
+
+   //Drop packets that are waiting for address resolution
+   ndpFlushQueuedPackets(interface, entry);
+
+   //Remove the entry from the hash table
+   for(p = &interface->ndpHashTable[ndpHashAddr(&entry->ipAddr)]; *p != NULL; p = &(*p)->hashNext)
+   {
+      if(*p == entry)
+      {
+         *p = entry->hashNext;
+         break;
+      }
+   }
+
+   //Forget the last destination if necessary
+   if(interface->ndpLastEntry == entry)
+      interface->ndpLastEntry = NULL;
+
+   //Release Neighbor cache entry
+   entry->hashNext = NULL;
+   entry->state = NDP_STATE_NONE;
+
+   //Free entries are reused first
+   ndpLruRemove(interface, entry);
+   ndpLruAppend(interface, entry);
+}
+
+
+/**
+ * @brief Retrieve Neighbor cache statistics
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Snapshot of the Neighbor cache counters
+ **/
+
+void ndpGetStats(NetInterface *interface, NdpStats *stats)
+{
+   //Acquire exclusive access to Neighbor cache
+   osMutexAcquire(interface->ndpCacheMutex);
+   //Take a consistent snapshot of the counters
+   *stats = interface->ndpStats;
+   //Release exclusive access to Neighbor cache
+   osMutexRelease(interface->ndpCacheMutex);
+}
+
+
+/**
+ * @brief Hash function used to index the Neighbor cache
+ * @param[in] ipAddr IPv6 address
+ * @return Index of the hash bucket
+ **/
+
+uint_t ndpHashAddr(const Ipv6Addr *ipAddr)
+{
+   uint32_t h;
+
+   //Neighbors on the same link share the same prefix, hence
+   //the interface identifier is used to compute the hash
+   h = ipAddr->dw[2] ^ ipAddr->dw[3];
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (NDP_HASH_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief Insert an entry at the head of the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the Neighbor cache entry
+ **/
+
+void ndpLruInsert(NetInterface *interface, NdpCacheEntry *entry)
+{
+   //The entry becomes the most recently used one
+   entry->lruPrev = NULL;
+   entry->lruNext = interface->ndpLruHead;
+
+   //Update the links of the former head
+   if(interface->ndpLruHead != NULL)
+      interface->ndpLruHead->lruPrev = entry;
+   else
+      interface->ndpLruTail = entry;
+
+   //Update the head of the list
+   interface->ndpLruHead = entry;
+}
+
+
+/**
+ * @brief Insert an entry at the tail of the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the Neighbor cache entry
+ **/
+
+void ndpLruAppend(NetInterface *interface, NdpCacheEntry *entry)
+{
+   //The entry will be the first one to be reused
+   entry->lruPrev = interface->ndpLruTail;
+   entry->lruNext = NULL;
+
+   //Update the links of the former tail
+   if(interface->ndpLruTail != NULL)
+      interface->ndpLruTail->lruNext = entry;
+   else
+      interface->ndpLruHead = entry;
+
+   //Update the tail of the list
+   interface->ndpLruTail = entry;
+}
+
+
+/**
+ * @brief Remove an entry from the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the Neighbor cache entry
+ **/
+
+void ndpLruRemove(NetInterface *interface, NdpCacheEntry *entry)
+{
+   //Update the link of the previous entry
+   if(entry->lruPrev != NULL)
+      entry->lruPrev->lruNext = entry->lruNext;
+   else
+      interface->ndpLruHead = entry->lruNext;
+
+   //Update the link of the next entry
+   if(entry->lruNext != NULL)
+      entry->lruNext->lruPrev = entry->lruPrev;
+   else
+      interface->ndpLruTail = entry->lruPrev;
+
+   //The entry is not linked anymore
+   entry->lruPrev = NULL;
+   entry->lruNext = NULL;
 }
 
 
@@ -251,6 +434,9 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
    //Check whether a matching entry has been found
    if(entry)
    {
+      //Update statistics
+      interface->ndpStats.hits++;
+
       //Check the state of the Neighbor cache entry
       if(entry->state == NDP_STATE_INCOMPLETE)
       {
@@ -268,6 +454,8 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
          entry->timestamp = osGetTickCount();
          //Delay before sending the first probe
          entry->timeout = NDP_DELAY_FIRST_PROBE_TIME;
+         //Register the deadline with the timer wheel
+         netTimerSchedule(&interface->ndpTimer, entry->timeout);
          //Switch to the DELAY state
          entry->state = NDP_STATE_DELAY;
 
@@ -288,8 +476,11 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
       }
    }
 
+   //Update statistics
+   interface->ndpStats.misses++;
+
    //If no entry exists, then create a new one
-   entry = ndpCreateEntry(interface);
+   entry = ndpCreateEntry(interface, ipAddr);
 
    //Any error to report?
    if(!entry)
@@ -300,8 +491,7 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
       return ERROR_OUT_OF_RESOURCES;
    }
 
-   //Record the IPv6 address whose MAC address is unknown
-   entry->ipAddr = *ipAddr;
+   //The MAC address is not known yet
    entry->macAddr = MAC_UNSPECIFIED_ADDR;
 
    //Reset retransmission counter
@@ -316,6 +506,8 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
    entry->timestamp = osGetTickCount();
    //Set timeout value
    entry->timeout = NDP_RETRANS_TIMER;
+   //Register the deadline with the timer wheel
+   netTimerSchedule(&interface->ndpTimer, entry->timeout);
    //Enter INCOMPLETE state
    entry->state = NDP_STATE_INCOMPLETE;
 
@@ -419,8 +611,9 @@ error_t ndpEnqueuePacket(NetInterface *interface,
 /**
  * @brief Neighbor Discovery timer handler
  *
- * This routine must be periodically called by the TCP/IP stack to
- * manage Neighbor cache
+ * This routine is invoked by the timer wheel when the deadline of an entry
+ * has been reached. The timer is then re-armed with the earliest deadline
+ * left in the Neighbor cache
  *
  * @param[in] interface Underlying network interface
  **/
@@ -429,10 +622,14 @@ void ndpTick(NetInterface *interface)
 {
    uint_t i;
    time_t time;
+   int32_t delay;
+   int32_t nextDelay;
    NdpCacheEntry *entry;
 
    //Get current time
    time = osGetTickCount();
+   //No deadline found yet
+   nextDelay = -1;
 
    //Acquire exclusive access to Neighbor cache
    osMutexAcquire(interface->ndpCacheMutex);
@@ -465,10 +662,8 @@ void ndpTick(NetInterface *interface)
             }
             else
             {
-               //Drop packets that are waiting for address resolution
-               ndpFlushQueuedPackets(interface, entry);
                //The entry should be deleted since address resolution has failed
-               entry->state = NDP_STATE_NONE;
+               ndpDeleteEntry(interface, entry);
             }
          }
       }
@@ -524,12 +719,28 @@ void ndpTick(NetInterface *interface)
             else
             {
                //The entry should be deleted since the host is not reachable anymore
-               entry->state = NDP_STATE_NONE;
+               ndpDeleteEntry(interface, entry);
             }
          }
       }
+
+      //Entries in INCOMPLETE, REACHABLE, DELAY and PROBE states have a deadline
+      if(entry->state == NDP_STATE_INCOMPLETE || entry->state == NDP_STATE_REACHABLE ||
+         entry->state == NDP_STATE_DELAY || entry->state == NDP_STATE_PROBE)
+      {
+         //Time remaining before the deadline
+         delay = max(timeCompare(entry->timestamp + entry->timeout, time), 0);
+
+         //Keep track of the earliest deadline
+         if(nextDelay < 0 || delay < nextDelay)
+            nextDelay = delay;
+      }
    }
 
+   //Any deadline left in the Neighbor cache?
+   if(nextDelay >= 0)
+      netTimerSchedule(&interface->ndpTimer, nextDelay);
+
    //Release exclusive access to Neighbor cache
    osMutexRelease(interface->ndpCacheMutex);
 }
@@ -627,13 +838,12 @@ void ndpProcessNeighborSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
       if(!entry)
       {
          //Create an entry
-         entry = ndpCreateEntry(interface);
+         entry = ndpCreateEntry(interface, &pseudoHeader->srcAddr);
 
          //Neighbor cache entry successfully created?
          if(entry)
          {
-            //Record the IPv6 and the corresponding MAC address
-            entry->ipAddr = pseudoHeader->srcAddr;
+            //Record the corresponding MAC address
             entry->macAddr = option->linkLayerAddr;
             //Save current time
             entry->timestamp = osGetTickCount();
@@ -790,6 +1000,8 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
             {
                //Computing the random ReachableTime value
                entry->timeout = NDP_REACHABLE_TIME;
+               //Register the deadline with the timer wheel
+               netTimerSchedule(&interface->ndpTimer, entry->timeout);
                //Switch to the REACHABLE state
                entry->state = NDP_STATE_REACHABLE;
             }
@@ -813,6 +1025,8 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
                   entry->timestamp = osGetTickCount();
                   //Computing the random ReachableTime value
                   entry->timeout = NDP_REACHABLE_TIME;
+                  //Register the deadline with the timer wheel
+                  netTimerSchedule(&interface->ndpTimer, entry->timeout);
                   //Switch to the REACHABLE state
                   entry->state = NDP_STATE_REACHABLE;
                }
@@ -838,6 +1052,8 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
                entry->timestamp = osGetTickCount();
                //Computing the random ReachableTime value
                entry->timeout = NDP_REACHABLE_TIME;
+               //Register the deadline with the timer wheel
+               netTimerSchedule(&interface->ndpTimer, entry->timeout);
                //Switch to the REACHABLE state
                entry->state = NDP_STATE_REACHABLE;
             }
@@ -32,13 +32,6 @@
 //Dependencies
 #include "tcp_ip_stack.h"
 
-//NDP tick interval
-#ifndef NDP_TICK_INTERVAL
-   #define NDP_TICK_INTERVAL 200
-#elif (NDP_TICK_INTERVAL < 100)
-   #error NDP_TICK_INTERVAL parameter is invalid
-#endif
-
 //Neighbor cache size
 #ifndef NDP_CACHE_SIZE
    #define NDP_CACHE_SIZE 8
@@ -46,6 +39,13 @@
    #error NDP_CACHE_SIZE parameter is invalid
 #endif
 
+//Size of the hash table used to index the Neighbor cache
+#ifndef NDP_HASH_TABLE_SIZE
+   #define NDP_HASH_TABLE_SIZE 16
+#elif (NDP_HASH_TABLE_SIZE < 1 || (NDP_HASH_TABLE_SIZE & (NDP_HASH_TABLE_SIZE - 1)) != 0)
+   #error NDP_HASH_TABLE_SIZE parameter is invalid
+#endif
+
 //Maximum number of packets waiting for address resolution to complete
 #ifndef NDP_MAX_PENDING_PACKETS
    #define NDP_MAX_PENDING_PACKETS 2
@@ -287,8 +287,11 @@ typedef struct
  * @brief Neighbor cache entry
  **/
 
-typedef struct
+typedef struct _NdpCacheEntry
 {
+   struct _NdpCacheEntry *hashNext;             //Next entry in the same hash bucket
+   struct _NdpCacheEntry *lruPrev;              //More recently used entry
+   struct _NdpCacheEntry *lruNext;              //Less recently used entry
    NdpState state;                              //Reachability state
    Ipv6Addr ipAddr;                             //Unicast IPv6 address
    MacAddr macAddr;                             //Link layer address associated with the IPv6 address
@@ -300,12 +303,32 @@ typedef struct
 } NdpCacheEntry;
 
 
+/**
+ * @brief Neighbor cache statistics
+ **/
+
+typedef struct
+{
+   uint32_t hits;                               //Address resolutions satisfied by the cache
+   uint32_t misses;                             //Address resolutions that required a new entry
+   uint32_t fastPathHits;                       //Lookups satisfied by the last destination entry
+   uint32_t evictions;                          //Entries reclaimed to make room for a new one
+} NdpStats;
+
+
 //NDP related functions
 error_t ndpInit(NetInterface *interface);
 void ndpFlushCache(NetInterface *interface);
 
-NdpCacheEntry *ndpCreateEntry(NetInterface *interface);
+NdpCacheEntry *ndpCreateEntry(NetInterface *interface, const Ipv6Addr *ipAddr);
 NdpCacheEntry *ndpFindEntry(NetInterface *interface, const Ipv6Addr *ipAddr);
+void ndpDeleteEntry(NetInterface *interface, NdpCacheEntry *entry);
+void ndpGetStats(NetInterface *interface, NdpStats *stats);
+
+uint_t ndpHashAddr(const Ipv6Addr *ipAddr);
+void ndpLruInsert(NetInterface *interface, NdpCacheEntry *entry);
+void ndpLruAppend(NetInterface *interface, NdpCacheEntry *entry);
+void ndpLruRemove(NetInterface *interface, NdpCacheEntry *entry);
 
 void ndpSendQueuedPackets(NetInterface *interface, NdpCacheEntry *entry);
 void ndpFlushQueuedPackets(NetInterface *interface, NdpCacheEntry *entry);
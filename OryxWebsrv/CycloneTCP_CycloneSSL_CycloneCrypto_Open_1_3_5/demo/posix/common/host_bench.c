@@ -0,0 +1,179 @@
+/**
+ * @file host_bench.c
+ * @brief Timing helpers for the host benchmarks
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Cycle counts are read from the time stamp counter on x86 hosts. Other
+ * hosts fall back to the monotonic clock, in which case one cycle stands
+ * for one nanosecond
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <time.h>
+#include "host_bench.h"
+
+//Cycles per second, once calibrated
+static double benchCycleRate = 0;
+
+
+/**
+ * @brief Read the monotonic clock
+ * @return Current time, in nanoseconds
+ **/
+
+uint64_t benchGetTime(void)
+{
+   struct timespec ts;
+
+   //Get current time
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   //Convert it to nanoseconds
+   return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Read the cycle counter
+ * @return Current value of the cycle counter
+ **/
+
+uint64_t benchGetCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+   uint32_t low;
+   uint32_t high;
+
+   //Read the time stamp counter
+   __asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
+   //Return the 64-bit value
+   return ((uint64_t) high << 32) | low;
+#else
+   //Use the monotonic clock instead
+   return benchGetTime();
+#endif
+}
+
+
+/**
+ * @brief Frequency of the cycle counter
+ *
+ * The rate is measured against the monotonic clock over 100 ms
+ * the first time this function is called
+ *
+ * @return Cycles per second
+ **/
+
+double benchGetCycleRate(void)
+{
+   uint64_t t0;
+   uint64_t t1;
+   uint64_t c0;
+   uint64_t c1;
+
+   //Calibrate the cycle counter only once
+   if(benchCycleRate == 0)
+   {
+      //Sample both counters
+      t0 = benchGetTime();
+      c0 = benchGetCycles();
+      //Busy wait for 100 ms
+      do t1 = benchGetTime(); while((t1 - t0) < 100000000);
+      c1 = benchGetCycles();
+
+      //Compute the number of cycles per second
+      benchCycleRate = (double) (c1 - c0) * 1e9 / (double) (t1 - t0);
+   }
+
+   //Return the frequency of the cycle counter
+   return benchCycleRate;
+}
+
+
+/**
+ * @brief Compute a throughput
+ * @param[in] bytes Number of bytes processed
+ * @param[in] time Elapsed time, in nanoseconds
+ * @return Throughput, in megabytes per second
+ **/
+
+double benchMbps(uint64_t bytes, uint64_t time)
+{
+   //Avoid dividing by zero
+   if(time == 0)
+      return 0;
+
+   //1 MB = 1048576 bytes
+   return (double) bytes * 1e9 / (double) time / 1048576.0;
+}
+
+
+/**
+ * @brief Compare two samples (qsort callback)
+ **/
+
+static int benchCompareValues(const void *a, const void *b)
+{
+   uint32_t x = *(const uint32_t *) a;
+   uint32_t y = *(const uint32_t *) b;
+
+   //Sort in ascending order
+   return (x > y) - (x < y);
+}
+
+
+/**
+ * @brief Compute a percentile of a set of samples
+ *
+ * The array is sorted in place
+ *
+ * @param[in,out] values Samples
+ * @param[in] count Number of samples
+ * @param[in] percent Requested percentile (0 to 100)
+ * @return Value below which the given percentage of samples fall
+ **/
+
+uint32_t benchPercentile(uint32_t *values, uint_t count, uint_t percent)
+{
+   uint_t i;
+
+   //No samples?
+   if(count == 0)
+      return 0;
+
+   //Sort the samples
+   qsort(values, count, sizeof(uint32_t), benchCompareValues);
+
+   //Nearest rank method
+   i = (count * percent + 99) / 100;
+   //Make sure the index is valid
+   if(i > 0) i--;
+   if(i >= count) i = count - 1;
+
+   //Return the corresponding sample
+   return values[i];
+}
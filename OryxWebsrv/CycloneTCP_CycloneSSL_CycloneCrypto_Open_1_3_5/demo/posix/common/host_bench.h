@@ -0,0 +1,44 @@
+/**
+ * @file host_bench.h
+ * @brief Timing helpers for the host benchmarks
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _HOST_BENCH_H
+#define _HOST_BENCH_H
+
+//Dependencies
+#include <stdint.h>
+#include "os.h"
+
+//Bench related functions
+uint64_t benchGetTime(void);
+uint64_t benchGetCycles(void);
+double benchGetCycleRate(void);
+
+double benchMbps(uint64_t bytes, uint64_t time);
+uint32_t benchPercentile(uint32_t *values, uint_t count, uint_t percent);
+
+#endif
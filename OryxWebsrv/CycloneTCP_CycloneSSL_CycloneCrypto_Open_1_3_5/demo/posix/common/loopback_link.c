@@ -0,0 +1,287 @@
+/**
+ * @file loopback_link.c
+ * @brief Two network interfaces joined by the loopback Ethernet link
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The first interface plays the client role and the second one the
+ * server role. Both belong to the same subnet, so that traffic flows
+ * through ARP, IPv4 and TCP exactly as it would on a real network
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "loopback_eth.h"
+#include "loopback_link.h"
+#include "ipv4.h"
+#include "debug.h"
+
+
+/**
+ * @brief Bring up the TCP/IP stack and the loopback link
+ * @param[in] clientDriver Driver of the client end (NULL for the plain loopback driver)
+ * @param[in] serverDriver Driver of the server end (NULL for the plain loopback driver)
+ * @return Error code
+ **/
+
+error_t loopbackLinkStart(const NicDriver *clientDriver, const NicDriver *serverDriver)
+{
+   error_t error;
+   NetInterface *client;
+   NetInterface *server;
+
+   //TCP/IP stack initialization
+   error = tcpIpStackInit();
+   //Any error to report?
+   if(error) return error;
+
+   //Point to both ends of the link
+   client = LOOPBACK_LINK_CLIENT;
+   server = LOOPBACK_LINK_SERVER;
+
+   //Select the drivers (a test may wrap the loopback driver)
+   client->nicDriver = clientDriver ? clientDriver : &loopbackEthDriver;
+   server->nicDriver = serverDriver ? serverDriver : &loopbackEthDriver;
+
+   //Set MAC addresses
+   macStringToAddr("00-AB-CD-EF-00-01", &client->macAddr);
+   macStringToAddr("00-AB-CD-EF-00-02", &server->macAddr);
+
+   //Plug the virtual cable
+   error = loopbackEthConnect(client, server);
+   //Any error to report?
+   if(error) return error;
+
+   //Configure both interfaces
+   error = tcpIpStackConfigInterface(client);
+   //Any error to report?
+   if(error) return error;
+
+   error = tcpIpStackConfigInterface(server);
+   //Any error to report?
+   if(error) return error;
+
+   //Static IPv4 configuration of the client end
+   ipv4StringToAddr(LOOPBACK_LINK_CLIENT_ADDR, &client->ipv4Config.addr);
+   ipv4StringToAddr(LOOPBACK_LINK_SUBNET_MASK, &client->ipv4Config.subnetMask);
+
+   //Static IPv4 configuration of the server end
+   ipv4StringToAddr(LOOPBACK_LINK_SERVER_ADDR, &server->ipv4Config.addr);
+   ipv4StringToAddr(LOOPBACK_LINK_SUBNET_MASK, &server->ipv4Config.subnetMask);
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Connect the client end to a TCP port of the server end
+ * @param[in] port Port number
+ * @param[in] timeout Timeout value for subsequent socket operations
+ * @return Connected socket, or NULL on failure
+ **/
+
+Socket *loopbackLinkConnect(uint16_t port, time_t timeout)
+{
+   error_t error;
+   IpAddr ipAddr;
+   Socket *socket;
+
+   //Open a TCP socket
+   socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_PROTOCOL_TCP);
+   //Failed to open socket?
+   if(!socket) return NULL;
+
+   //Set timeout for blocking functions
+   socketSetTimeout(socket, timeout);
+   //Traffic must leave through the client end
+   socketBindToInterface(socket, LOOPBACK_LINK_CLIENT);
+
+   //Address of the server end
+   ipAddr.length = sizeof(Ipv4Addr);
+   ipv4StringToAddr(LOOPBACK_LINK_SERVER_ADDR, &ipAddr.ipv4Addr);
+
+   //Establish connection
+   error = socketConnect(socket, &ipAddr, port);
+
+   //Failed to connect?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Connection to port %u failed (%d)\r\n", port, error);
+      //Clean up side effects
+      socketClose(socket);
+      return NULL;
+   }
+
+   //Return the connected socket
+   return socket;
+}
+
+
+/**
+ * @brief Open a listening TCP socket on the server end
+ * @param[in] port Port number
+ * @return Listening socket, or NULL on failure
+ **/
+
+Socket *loopbackLinkListen(uint16_t port)
+{
+   error_t error;
+   Socket *socket;
+
+   //Open a TCP socket
+   socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_PROTOCOL_TCP);
+   //Failed to open socket?
+   if(!socket) return NULL;
+
+   //Only accept connections on the server end
+   error = socketBindToInterface(socket, LOOPBACK_LINK_SERVER);
+
+   //Bind the socket to the port
+   if(!error)
+      error = socketBind(socket, &IP_ADDR_ANY, port);
+
+   //Place the socket in the listening state
+   if(!error)
+      error = socketListen(socket);
+
+   //Any error to report?
+   if(error)
+   {
+      //Clean up side effects
+      socketClose(socket);
+      return NULL;
+   }
+
+   //Return the listening socket
+   return socket;
+}
+
+
+/**
+ * @brief Issue an HTTP GET request to the server end
+ *
+ * The connection is closed after the response, so that the whole
+ * response can be read up to the end of the stream
+ *
+ * @param[in] uri Requested URI
+ * @param[in] headers Additional header fields, each one terminated with CRLF (may be NULL)
+ * @param[out] response Buffer where to store the response, header included
+ * @param[in] size Size of the buffer
+ * @param[out] statusCode Status code of the response
+ * @param[out] body Pointer to the body of the response
+ * @param[out] length Length of the body
+ * @return Error code
+ **/
+
+error_t loopbackLinkHttpGet(const char_t *uri, const char_t *headers,
+   char_t *response, size_t size, uint_t *statusCode, char_t **body, size_t *length)
+{
+   error_t error;
+   size_t n;
+   size_t total;
+   char_t *p;
+   Socket *socket;
+
+   //Connect to the HTTP server
+   socket = loopbackLinkConnect(80, 5000);
+   //Failed to connect?
+   if(!socket) return ERROR_CONNECTION_FAILED;
+
+   //Format the request
+   sprintf(response, "GET %s HTTP/1.1\r\nHost: %s\r\n%sConnection: close\r\n\r\n",
+      uri, LOOPBACK_LINK_SERVER_ADDR, headers ? headers : "");
+
+   //Send the request
+   error = socketSend(socket, response, strlen(response), NULL, 0);
+
+   //Read the response until the server closes the connection
+   for(total = 0; !error && total < (size - 1); total += n)
+      error = socketReceive(socket, response + total, size - 1 - total, &n, 0);
+
+   //Close the connection
+   socketClose(socket);
+
+   //The end of the stream is the expected outcome
+   if(error != ERROR_END_OF_STREAM)
+      return error ? error : ERROR_OUT_OF_RESOURCES;
+
+   //Properly terminate the response
+   response[total] = '\0';
+
+   //Check the status line
+   if(strncmp(response, "HTTP/1.", 7) || total < 12)
+      return ERROR_INVALID_SYNTAX;
+
+   //Retrieve the status code
+   *statusCode = strtoul(response + 9, NULL, 10);
+
+   //Search for the end of the header
+   p = strstr(response, "\r\n\r\n");
+   //Malformed response?
+   if(!p) return ERROR_INVALID_SYNTAX;
+
+   //Point to the body
+   *body = p + 4;
+   *length = total - (*body - response);
+
+   //Chunked transfer encoding?
+   if(strcasestr(response, "Transfer-Encoding: chunked") &&
+      strcasestr(response, "Transfer-Encoding: chunked") < *body)
+   {
+      //Decode the body in place
+      for(p = *body, total = 0; ; p += n + 2)
+      {
+         //Parse the size of the current chunk
+         n = strtoul(p, &p, 16);
+         //Skip the end of the chunk-size line
+         p = strstr(p, "\r\n");
+         //Malformed chunk?
+         if(!p || (p + 2 + n) > (*body + *length)) return ERROR_INVALID_SYNTAX;
+         p += 2;
+
+         //The last chunk has a size of zero
+         if(!n) break;
+
+         //Move the data of the chunk
+         memmove(*body + total, p, n);
+         total += n;
+      }
+
+      //Length of the decoded body
+      *length = total;
+      //Properly terminate the body
+      (*body)[total] = '\0';
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
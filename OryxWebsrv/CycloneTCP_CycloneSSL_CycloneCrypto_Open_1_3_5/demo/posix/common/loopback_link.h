@@ -0,0 +1,54 @@
+/**
+ * @file loopback_link.h
+ * @brief Two network interfaces joined by the loopback Ethernet link
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _LOOPBACK_LINK_H
+#define _LOOPBACK_LINK_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "socket.h"
+
+//Addresses of both ends of the link
+#define LOOPBACK_LINK_CLIENT_ADDR "10.0.0.1"
+#define LOOPBACK_LINK_SERVER_ADDR "10.0.0.2"
+#define LOOPBACK_LINK_SUBNET_MASK "255.255.255.0"
+
+//Interface on each end of the link
+#define LOOPBACK_LINK_CLIENT (&netInterface[0])
+#define LOOPBACK_LINK_SERVER (&netInterface[1])
+
+//Loopback link related functions
+error_t loopbackLinkStart(const NicDriver *clientDriver, const NicDriver *serverDriver);
+
+Socket *loopbackLinkConnect(uint16_t port, time_t timeout);
+Socket *loopbackLinkListen(uint16_t port);
+
+error_t loopbackLinkHttpGet(const char_t *uri, const char_t *headers,
+   char_t *response, size_t size, uint_t *statusCode, char_t **body, size_t *length);
+
+#endif
@@ -0,0 +1,713 @@
+/**
+ * @file lossy_link.c
+ * @brief Loopback link with delay, bottleneck and segment losses
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Both ends of the loopback link send their frames through a delay line.
+ * Each direction has its own bottleneck, that serializes frames at a given
+ * rate and drops them when its queue is full, followed by a constant
+ * propagation delay. A task releases the frames to the peer once their
+ * delivery time is reached.
+ *
+ * TCP segments carrying data are lost according to a hash of their offset
+ * in the stream, so that a given seed always loses the same segments,
+ * whatever the initial sequence number and the scheduling of the tasks.
+ * Acknowledgments are never lost. The link also times the recovery of
+ * each lost segment, from the loss to the first acknowledgment that
+ * covers it
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "ethernet.h"
+#include "ipv4.h"
+#include "tcp.h"
+#include "loopback_eth.h"
+#include "loopback_link.h"
+#include "lossy_link.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Port used by bulk transfers
+#define LOSSY_LINK_PORT 5002
+//Size of the buffers used by bulk transfers
+#define LOSSY_LINK_CHUNK_SIZE 8192
+//Bulk transfers must complete within this delay
+#define LOSSY_LINK_TIMEOUT 300000
+
+
+/**
+ * @brief Frame travelling through the delay line
+ **/
+
+typedef struct _LossyLinkFrame
+{
+   struct _LossyLinkFrame *next;  ///<Next frame in the same direction
+   uint64_t time;                 ///<Delivery time (ns)
+   size_t length;                 ///<Length of the frame
+   uint8_t data[];                ///<Frame contents
+} LossyLinkFrame;
+
+
+/**
+ * @brief State of one direction of the link
+ **/
+
+typedef struct
+{
+   LossyLinkFrame *head;                            ///<Oldest frame in the delay line
+   LossyLinkFrame *tail;                            ///<Newest frame in the delay line
+   uint64_t departure;                              ///<Time at which the bottleneck becomes idle (ns)
+   uint32_t isn;                                    ///<Initial sequence number
+   bool_t seqValid;                                 ///<A data segment has been sent
+   uint32_t highSeq;                                ///<Highest sequence number sent so far
+   uint32_t resent;                                 ///<Number of segments resent so far
+   uint_t pendingCount;                             ///<Number of lost segments not yet acknowledged
+   uint32_t pendingSeq[LOSSY_LINK_MAX_PENDING_LOSSES];  ///<End of each lost segment
+   uint64_t pendingTime[LOSSY_LINK_MAX_PENDING_LOSSES]; ///<Time of each loss (ns)
+} LossyLinkDirection;
+
+
+//Forward declaration of functions
+error_t lossyLinkSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+void lossyLinkTask(void *param);
+void lossyLinkSinkTask(void *param);
+
+//Loopback driver sending through the delay line
+static NicDriver lossyLinkDriver;
+
+//Link model and state
+static LossyLinkSettings lossyLinkSettings;
+static LossyLinkDirection lossyLinkDirection[2];
+static LossyLinkStats lossyLinkStats;
+
+//Bulk transfers
+static Socket *lossyLinkListenSocket;
+static OsEvent *lossyLinkSinkEvent;
+static size_t lossyLinkSinkLength;
+static error_t lossyLinkSinkError;
+
+
+/**
+ * @brief Bring up the TCP/IP stack and the lossy link
+ * @param[in] settings Link model
+ * @return Error code
+ **/
+
+error_t lossyLinkStart(const LossyLinkSettings *settings)
+{
+   error_t error;
+
+   //Both ends only differ from the loopback driver in the way frames are sent
+   lossyLinkDriver = loopbackEthDriver;
+   lossyLinkDriver.sendPacket = lossyLinkSendPacket;
+
+   //Save the link model
+   lossyLinkConfig(settings);
+
+   //Bring up the loopback link
+   error = loopbackLinkStart(&lossyLinkDriver, &lossyLinkDriver);
+   //Any error to report?
+   if(error) return error;
+
+   //Create the event used to wait for the sink task
+   lossyLinkSinkEvent = osEventCreate(FALSE, FALSE);
+   //Out of resources?
+   if(lossyLinkSinkEvent == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Open the listening socket used by bulk transfers
+   lossyLinkListenSocket = loopbackLinkListen(LOSSY_LINK_PORT);
+   //Failed to open socket?
+   if(!lossyLinkListenSocket)
+      return ERROR_OPEN_FAILED;
+
+   //Create the task that releases the frames
+   if(!osTaskCreate("Lossy link", lossyLinkTask, NULL, 500, 2))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Create the sink task
+   if(!osTaskCreate("Sink", lossyLinkSinkTask, NULL, 500, 1))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Change the link model
+ *
+ * Statistics are cleared. This function is meant to be called
+ * when no transfer is in progress
+ *
+ * @param[in] settings Link model
+ **/
+
+void lossyLinkConfig(const LossyLinkSettings *settings)
+{
+   uint_t i;
+
+   //Get exclusive access to the link
+   osTaskSuspendAll();
+
+   //Save the link model
+   lossyLinkSettings = *settings;
+
+   //Forget the segments sent in each direction
+   for(i = 0; i < 2; i++)
+   {
+      lossyLinkDirection[i].seqValid = FALSE;
+      lossyLinkDirection[i].resent = 0;
+      lossyLinkDirection[i].pendingCount = 0;
+   }
+
+   //Clear statistics
+   memset(&lossyLinkStats, 0, sizeof(LossyLinkStats));
+
+   //Release exclusive access to the link
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Retrieve link statistics
+ * @param[out] stats Statistics
+ **/
+
+void lossyLinkGetStats(LossyLinkStats *stats)
+{
+   //Get exclusive access to the statistics
+   osTaskSuspendAll();
+   //Copy statistics
+   *stats = lossyLinkStats;
+   //Release exclusive access to the statistics
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Loss model
+ * @param[in] offset Offset of the segment in the stream
+ * @param[in] resent Number of segments resent before this one (0 for a first transmission)
+ * @return TRUE if the segment is lost
+ **/
+
+static bool_t lossyLinkLose(uint32_t offset, uint32_t resent)
+{
+   uint32_t h;
+
+   //No loss?
+   if(!lossyLinkSettings.lossRate)
+      return FALSE;
+
+   //Mix the seed, the offset and the number of retransmissions
+   h = lossyLinkSettings.seed ^ (offset * 0x9E3779B1) ^ (resent * 0x85EBCA77);
+   h ^= h >> 16;
+   h *= 0x7FEB352D;
+   h ^= h >> 15;
+   h *= 0x846CA68B;
+   h ^= h >> 16;
+
+   //Compare the hash against the loss rate
+   return (h % 10000) < lossyLinkSettings.lossRate;
+}
+
+
+/**
+ * @brief Inspect a TCP segment and apply the loss model
+ * @param[in] index Direction of the frame
+ * @param[in] frame Ethernet frame
+ * @param[in] length Length of the frame
+ * @param[in] time Current time (ns)
+ * @return TRUE if the segment is lost
+ **/
+
+static bool_t lossyLinkInspect(uint_t index, const uint8_t *frame, size_t length, uint64_t time)
+{
+   uint_t i;
+   uint_t j;
+   size_t n;
+   uint32_t seq;
+   uint32_t ack;
+   bool_t lost;
+   bool_t resent;
+   const EthHeader *ethHeader;
+   const Ipv4Header *ipHeader;
+   const TcpHeader *tcpHeader;
+   LossyLinkDirection *direction;
+   LossyLinkDirection *reverse;
+
+   //Point to the Ethernet header
+   ethHeader = (const EthHeader *) frame;
+   //Only IPv4 frames carry TCP segments on this link
+   if(length < sizeof(EthHeader) || ntohs(ethHeader->type) != ETH_TYPE_IPV4)
+      return FALSE;
+
+   //Point to the IPv4 header
+   ipHeader = (const Ipv4Header *) (frame + sizeof(EthHeader));
+   //Check the protocol and the length of the datagram
+   if(ipHeader->protocol != IPV4_PROTOCOL_TCP || ntohs(ipHeader->totalLength) >
+      (length - sizeof(EthHeader)))
+      return FALSE;
+
+   //Point to the TCP header
+   tcpHeader = (const TcpHeader *) ((const uint8_t *) ipHeader + ipHeader->headerLength * 4);
+   //Length of the data carried by the segment
+   n = ntohs(ipHeader->totalLength) - ipHeader->headerLength * 4 - tcpHeader->dataOffset * 4;
+
+   //Point to both directions of the link
+   direction = &lossyLinkDirection[index];
+   reverse = &lossyLinkDirection[index ^ 1];
+
+   //A SYN segment starts a new connection
+   if(tcpHeader->flags & TCP_FLAG_SYN)
+   {
+      direction->isn = ntohl(tcpHeader->seqNum);
+      direction->seqValid = FALSE;
+      direction->pendingCount = 0;
+   }
+
+   //Does the segment acknowledge lost segments of the reverse direction?
+   if(tcpHeader->flags & TCP_FLAG_ACK)
+   {
+      //Acknowledgment number
+      ack = ntohl(tcpHeader->ackNum);
+
+      //Loop through the lost segments
+      for(i = 0, j = 0; i < reverse->pendingCount; i++)
+      {
+         //The whole segment has been acknowledged?
+         if(TCP_CMP_SEQ(ack, reverse->pendingSeq[i]) >= 0)
+         {
+            //Update statistics
+            lossyLinkStats.recoveries++;
+            lossyLinkStats.recoveryTime += time - reverse->pendingTime[i];
+            lossyLinkStats.maxRecoveryTime = max(lossyLinkStats.maxRecoveryTime,
+               time - reverse->pendingTime[i]);
+         }
+         else
+         {
+            //Keep the segment in the list
+            reverse->pendingSeq[j] = reverse->pendingSeq[i];
+            reverse->pendingTime[j] = reverse->pendingTime[i];
+            j++;
+         }
+      }
+
+      //Number of lost segments still pending
+      reverse->pendingCount = j;
+   }
+
+   //Acknowledgments are never lost
+   if(!n) return FALSE;
+
+   //Sequence number of the first byte
+   seq = ntohl(tcpHeader->seqNum);
+
+   //Has the data already been sent?
+   resent = direction->seqValid && TCP_CMP_SEQ(seq, direction->highSeq) < 0;
+
+   //Update statistics
+   lossyLinkStats.dataSegments++;
+
+   //Keep track of the highest sequence number
+   if(resent)
+   {
+      lossyLinkStats.resentSegments++;
+      direction->resent++;
+   }
+   else
+   {
+      direction->highSeq = seq + n;
+      direction->seqValid = TRUE;
+   }
+
+   //Apply the loss model
+   lost = lossyLinkLose(seq - direction->isn, resent ? direction->resent : 0);
+
+   //Time the recovery of the segment
+   if(lost)
+   {
+      //Update statistics
+      lossyLinkStats.lossDrops++;
+
+      //Only the first loss of a segment is timed
+      for(i = 0; i < direction->pendingCount; i++)
+      {
+         if(direction->pendingSeq[i] == seq + n)
+            break;
+      }
+
+      //Add the segment to the list
+      if(i == direction->pendingCount && i < LOSSY_LINK_MAX_PENDING_LOSSES)
+      {
+         direction->pendingSeq[i] = seq + n;
+         direction->pendingTime[i] = time;
+         direction->pendingCount++;
+      }
+   }
+
+   //Return TRUE if the segment is lost
+   return lost;
+}
+
+
+/**
+ * @brief Send a packet through the delay line
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+error_t lossyLinkSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   uint_t index;
+   size_t length;
+   uint64_t time;
+   uint64_t start;
+   LossyLinkFrame *frame;
+   LossyLinkDirection *direction;
+
+   //Retrieve the length of the packet
+   length = chunkedBufferGetLength(buffer) - offset;
+
+   //Check the frame length
+   if(length > (LOOPBACK_ETH_RX_BUFFER_SIZE - ETH_CRC_SIZE))
+   {
+      //The transmitter can accept another packet
+      osEventSet(interface->nicTxEvent);
+      //Report an error
+      return ERROR_INVALID_LENGTH;
+   }
+
+   //Allocate a frame
+   frame = osMemAlloc(sizeof(LossyLinkFrame) + length);
+
+   //Successful allocation?
+   if(frame)
+   {
+      //Copy the frame
+      chunkedBufferRead(frame->data, buffer, offset, length);
+      frame->length = length;
+      frame->next = NULL;
+
+      //Direction of the frame
+      index = (interface == LOOPBACK_LINK_CLIENT) ? 0 : 1;
+      direction = &lossyLinkDirection[index];
+
+      //Current time
+      time = benchGetTime();
+
+      //Get exclusive access to the link
+      osTaskSuspendAll();
+
+      //Update statistics
+      lossyLinkStats.frames++;
+
+      //Lost segment?
+      if(lossyLinkInspect(index, frame->data, length, time))
+      {
+         //Discard the frame
+         osMemFree(frame);
+         frame = NULL;
+      }
+      //Any bottleneck?
+      else if(lossyLinkSettings.rate)
+      {
+         //The frame is serialized once the previous ones are gone
+         start = max(time, direction->departure);
+
+         //Queue full (the queue is measured in full-size frames)?
+         if((start - time) * lossyLinkSettings.rate >
+            (uint64_t) lossyLinkSettings.queueSize * ETH_MAX_FRAME_SIZE * 1000000000)
+         {
+            //Update statistics
+            lossyLinkStats.queueDrops++;
+            //Discard the frame
+            osMemFree(frame);
+            frame = NULL;
+         }
+         else
+         {
+            //Serialize the frame
+            direction->departure = start +
+               (uint64_t) (length + ETH_CRC_SIZE) * 1000000000 / lossyLinkSettings.rate;
+            //The frame reaches the peer after the propagation delay
+            frame->time = direction->departure + (uint64_t) lossyLinkSettings.delay * 1000000;
+         }
+      }
+      else
+      {
+         //Propagation delay only
+         frame->time = time + (uint64_t) lossyLinkSettings.delay * 1000000;
+      }
+
+      //Append the frame to the delay line
+      if(frame)
+      {
+         if(direction->tail)
+            direction->tail->next = frame;
+         else
+            direction->head = frame;
+
+         direction->tail = frame;
+      }
+
+      //Release exclusive access to the link
+      osTaskResumeAll();
+   }
+
+   //The transmitter can accept another packet
+   osEventSet(interface->nicTxEvent);
+
+   //Frames are lost silently, as on a real link
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Delay line task
+ *
+ * Releases the frames to the peer once their delivery time is reached
+ *
+ * @param[in] param Unused parameter
+ **/
+
+void lossyLinkTask(void *param)
+{
+   uint_t i;
+   uint64_t time;
+   LossyLinkFrame *frame;
+   ChunkedBuffer1 buffer;
+
+   //Endless loop
+   while(1)
+   {
+      //The delay line is scanned every millisecond
+      osDelay(1);
+
+      //Current time
+      time = benchGetTime();
+
+      //Get exclusive access to the link
+      osTaskSuspendAll();
+
+      //Process both directions
+      for(i = 0; i < 2; i++)
+      {
+         //Release the frames that have reached the peer
+         while(lossyLinkDirection[i].head && lossyLinkDirection[i].head->time <= time)
+         {
+            //Remove the oldest frame from the delay line
+            frame = lossyLinkDirection[i].head;
+            lossyLinkDirection[i].head = frame->next;
+
+            //The delay line is now empty?
+            if(!lossyLinkDirection[i].head)
+               lossyLinkDirection[i].tail = NULL;
+
+            //Describe the frame
+            buffer.chunkCount = 1;
+            buffer.maxChunkCount = 1;
+            buffer.chunk[0].address = frame->data;
+            buffer.chunk[0].length = frame->length;
+            buffer.chunk[0].flags = 0;
+
+            //Hand the frame to the peer
+            loopbackEthSendPacket(i ? LOOPBACK_LINK_SERVER : LOOPBACK_LINK_CLIENT,
+               (ChunkedBuffer *) &buffer, 0);
+
+            //Release the frame
+            osMemFree(frame);
+         }
+      }
+
+      //Release exclusive access to the link
+      osTaskResumeAll();
+   }
+}
+
+
+/**
+ * @brief Sink task
+ *
+ * Accepts connections one after the other, drains them and
+ * checks the data against the pattern sent by lossyLinkTransfer()
+ *
+ * @param[in] param Unused parameter
+ **/
+
+void lossyLinkSinkTask(void *param)
+{
+   error_t error;
+   size_t i;
+   size_t n;
+   IpAddr clientIpAddr;
+   uint16_t clientPort;
+   Socket *socket;
+   static uint8_t buffer[LOSSY_LINK_CHUNK_SIZE];
+
+   //Endless loop
+   while(1)
+   {
+      //Wait for the client to connect
+      socket = socketAccept(lossyLinkListenSocket, &clientIpAddr, &clientPort);
+      //Connection failed?
+      if(!socket) continue;
+
+      //Set timeout for blocking functions
+      socketSetTimeout(socket, LOSSY_LINK_TIMEOUT);
+
+      //Receive data until the client shuts down the connection
+      for(lossyLinkSinkLength = 0, lossyLinkSinkError = NO_ERROR; ; lossyLinkSinkLength += n)
+      {
+         //Read incoming data
+         error = socketReceive(socket, buffer, sizeof(buffer), &n, 0);
+
+         //End of stream or error?
+         if(error)
+         {
+            //The end of the stream is the expected outcome
+            if(error != ERROR_END_OF_STREAM)
+               lossyLinkSinkError = error;
+            break;
+         }
+
+         //Check the data
+         for(i = 0; i < n; i++)
+         {
+            if(buffer[i] != (uint8_t) ((lossyLinkSinkLength + i) % 251))
+               lossyLinkSinkError = ERROR_WRONG_CHECKSUM;
+         }
+      }
+
+      //Close the connection
+      socketClose(socket);
+      //Notify the sender
+      osEventSet(lossyLinkSinkEvent);
+   }
+}
+
+
+/**
+ * @brief Bulk transfer from the client end to the server end
+ * @param[in] algo Congestion control algorithm of the sender
+ * @param[in] length Number of bytes to transfer
+ * @param[out] transfer Outcome of the transfer
+ * @return Error code
+ **/
+
+error_t lossyLinkTransfer(TcpCongestionControl algo, size_t length,
+   LossyLinkTransfer *transfer)
+{
+   error_t error;
+   size_t i;
+   size_t n;
+   size_t sent;
+   uint64_t time;
+   IpAddr ipAddr;
+   Socket *socket;
+   static uint8_t buffer[LOSSY_LINK_CHUNK_SIZE];
+
+   //Clear the outcome of the transfer
+   memset(transfer, 0, sizeof(LossyLinkTransfer));
+   //Forget the end of a previous transfer that timed out
+   osEventReset(lossyLinkSinkEvent);
+
+   //Open a TCP socket
+   socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_PROTOCOL_TCP);
+   //Failed to open socket?
+   if(!socket) return ERROR_OPEN_FAILED;
+
+   //Set timeout for blocking functions
+   socketSetTimeout(socket, LOSSY_LINK_TIMEOUT);
+   //Traffic must leave through the client end
+   socketBindToInterface(socket, LOOPBACK_LINK_CLIENT);
+
+   //Select the congestion control algorithm before connecting
+   error = socketSetCongestionControl(socket, algo);
+
+   //Address of the server end
+   ipAddr.length = sizeof(Ipv4Addr);
+   ipv4StringToAddr(LOOPBACK_LINK_SERVER_ADDR, &ipAddr.ipv4Addr);
+
+   //Start of the transfer
+   time = benchGetTime();
+
+   //Establish connection
+   if(!error)
+      error = socketConnect(socket, &ipAddr, LOSSY_LINK_PORT);
+
+   //Send the data
+   for(sent = 0; !error && sent < length; sent += n)
+   {
+      //Number of bytes to send
+      n = min(length - sent, sizeof(buffer));
+
+      //Generate the pattern checked by the sink
+      for(i = 0; i < n; i++)
+         buffer[i] = (uint8_t) ((sent + i) % 251);
+
+      //Send data
+      error = socketSend(socket, buffer, n, &n, 0);
+   }
+
+   //Graceful shutdown
+   if(!error)
+      error = socketShutdown(socket, SOCKET_SD_SEND);
+
+   //Wait for the sink to drain the connection
+   if(!error && !osEventWait(lossyLinkSinkEvent, LOSSY_LINK_TIMEOUT))
+      error = ERROR_TIMEOUT;
+
+   //Duration of the transfer
+   transfer->time = benchGetTime() - time;
+   //Amount of data checked by the sink
+   transfer->length = lossyLinkSinkLength;
+
+   //Save the state of the sender
+   transfer->stats = socket->stats;
+   transfer->srtt = socket->srtt;
+   transfer->rto = socket->rto;
+
+   //Close the connection
+   socketClose(socket);
+
+   //Any error to report?
+   if(error) return error;
+   //Data corrupted?
+   if(lossyLinkSinkError) return lossyLinkSinkError;
+
+   //Check the amount of data
+   return (lossyLinkSinkLength == length) ? NO_ERROR : ERROR_FAILURE;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file lossy_link.h
+ * @brief Loopback link with delay, bottleneck and segment losses
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _LOSSY_LINK_H
+#define _LOSSY_LINK_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "socket.h"
+
+//Maximum number of lost segments whose recovery is being timed
+#define LOSSY_LINK_MAX_PENDING_LOSSES 256
+
+
+/**
+ * @brief Link model
+ **/
+
+typedef struct
+{
+   time_t delay;       ///<One-way propagation delay, in milliseconds
+   uint32_t rate;      ///<Rate of the bottleneck, in bytes per second (0 for no bottleneck)
+   uint_t queueSize;   ///<Number of frames the bottleneck can queue before dropping
+   uint_t lossRate;    ///<Data segments lost per 10000
+   uint32_t seed;      ///<Seed of the loss pattern
+} LossyLinkSettings;
+
+
+/**
+ * @brief Link statistics
+ **/
+
+typedef struct
+{
+   uint32_t frames;           ///<Frames sent over the link
+   uint32_t dataSegments;     ///<TCP segments carrying data
+   uint32_t resentSegments;   ///<TCP segments carrying data that was already sent
+   uint32_t lossDrops;        ///<Data segments dropped by the loss model
+   uint32_t queueDrops;       ///<Frames dropped because the bottleneck queue was full
+   uint32_t recoveries;       ///<Lost segments acknowledged by the receiver
+   uint64_t recoveryTime;     ///<Time from loss to acknowledgment, summed over recoveries (ns)
+   uint64_t maxRecoveryTime;  ///<Longest time from loss to acknowledgment (ns)
+} LossyLinkStats;
+
+
+/**
+ * @brief Outcome of a bulk transfer
+ **/
+
+typedef struct
+{
+   size_t length;          ///<Number of bytes received and checked by the sink
+   uint64_t time;          ///<Duration of the transfer (ns)
+   TcpSocketStats stats;   ///<Loss recovery statistics of the sender
+   time_t srtt;            ///<Smoothed round-trip time of the sender at the end
+   time_t rto;             ///<Retransmission timeout of the sender at the end
+} LossyLinkTransfer;
+
+
+//Lossy link related functions
+error_t lossyLinkStart(const LossyLinkSettings *settings);
+void lossyLinkConfig(const LossyLinkSettings *settings);
+
+void lossyLinkGetStats(LossyLinkStats *stats);
+
+error_t lossyLinkTransfer(TcpCongestionControl algo, size_t length,
+   LossyLinkTransfer *transfer);
+
+#endif
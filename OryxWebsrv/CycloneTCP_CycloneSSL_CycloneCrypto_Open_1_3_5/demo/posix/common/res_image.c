@@ -0,0 +1,425 @@
+/**
+ * @file res_image.c
+ * @brief Resource images built at run time
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The resource compiler only runs on Windows. The host demos and benchmarks
+ * lay out their resources the same way (., .. and 4-byte aligned contents),
+ * from a table of files held in memory, and optionally append the hashed
+ * path index
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <string.h>
+#include <ctype.h>
+#include "resource_manager.h"
+#include "res_image.h"
+
+
+/**
+ * @brief Image being built
+ **/
+
+typedef struct
+{
+   uint8_t *data;             ///<Resource image
+   size_t size;               ///<Size of the buffer
+   const ResImageFile *files; ///<Files to be stored
+   uint_t count;              ///<Number of files
+   uint32_t *entryStart;      ///<Location of the entry of each file
+} ResImageContext;
+
+
+/**
+ * @brief Look for a file or a directory whose path starts with a prefix
+ * @param[in] path Path of the file
+ * @param[in] prefix Directory prefix, terminated with a separator unless empty
+ * @param[out] nameLength Length of the component that follows the prefix
+ * @return TRUE if the path is located under the directory, else FALSE
+ **/
+
+static bool_t resImageMatch(const char_t *path, const char_t *prefix, uint_t *nameLength)
+{
+   uint_t n;
+
+   //Length of the prefix
+   n = strlen(prefix);
+
+   //Check the prefix
+   if(strncmp(path, prefix, n))
+      return FALSE;
+
+   //Length of the next component
+   for(*nameLength = 0; path[n + *nameLength] != '/' && path[n + *nameLength] != '\0'; (*nameLength)++);
+
+   //Empty components are not allowed
+   return (*nameLength > 0) ? TRUE : FALSE;
+}
+
+
+/**
+ * @brief Add a directory to the image
+ * @param[in] context Image being built
+ * @param[in] parentStart Location of the parent directory (0 for the root)
+ * @param[in] parentLength Length of the parent directory
+ * @param[in] prefix Path of the directory, terminated with a separator unless empty
+ * @param[out] length Length of the directory
+ * @return Error code
+ **/
+
+static error_t resImageAddDirectory(ResImageContext *context, uint32_t parentStart,
+   uint32_t parentLength, const char_t *prefix, uint32_t *length)
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   uint_t m;
+   uint32_t pos;
+   uint32_t offset;
+   uint32_t dirLength;
+   bool_t duplicate;
+   ResEntry *entry;
+   const char_t *path;
+   char_t subdir[RES_IMAGE_MAX_PATH];
+
+   //Point to the header of the resource image
+   ResHeader *resHeader = (ResHeader *) context->data;
+   //Location of the directory contents
+   pos = resHeader->totalSize;
+   offset = pos;
+
+   //Check the size of the image
+   if((offset + 2 * (sizeof(ResEntry) + 2)) > context->size)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Current directory
+   entry = (ResEntry *) (context->data + offset);
+   entry->type = RES_TYPE_DIR;
+   entry->dataStart = pos;
+   entry->dataLength = 0;
+   entry->nameLength = 1;
+   entry->name[0] = '.';
+   offset += sizeof(ResEntry) + 1;
+
+   //Add a link to the parent directory?
+   if(parentStart && parentLength)
+   {
+      //Parent directory
+      entry = (ResEntry *) (context->data + offset);
+      entry->type = RES_TYPE_DIR;
+      entry->dataStart = parentStart;
+      entry->dataLength = parentLength;
+      entry->nameLength = 2;
+      entry->name[0] = '.';
+      entry->name[1] = '.';
+      offset += sizeof(ResEntry) + 2;
+   }
+
+   //Loop through the files
+   for(i = 0; i < context->count; i++)
+   {
+      //Point to the path of the current file
+      path = context->files[i].path;
+
+      //Skip the files that lie outside the directory
+      if(!resImageMatch(path, prefix, &n))
+         continue;
+
+      //Each subdirectory is listed once
+      for(duplicate = FALSE, j = 0; !duplicate && j < i; j++)
+      {
+         if(resImageMatch(context->files[j].path, prefix, &m) && m == n &&
+            !strncmp(context->files[j].path + strlen(prefix), path + strlen(prefix), n))
+         {
+            duplicate = TRUE;
+         }
+      }
+
+      //Already listed?
+      if(duplicate)
+         continue;
+
+      //Check the size of the image
+      if((offset + sizeof(ResEntry) + n) > context->size || n > UINT8_MAX)
+         return ERROR_OUT_OF_RESOURCES;
+
+      //Add a new entry
+      entry = (ResEntry *) (context->data + offset);
+      entry->type = (path[strlen(prefix) + n] == '/') ? RES_TYPE_DIR : RES_TYPE_FILE;
+      entry->dataStart = 0;
+      entry->dataLength = 0;
+      entry->nameLength = n;
+      memcpy(entry->name, path + strlen(prefix), n);
+
+      //Jump to the following entry
+      offset += sizeof(ResEntry) + n;
+   }
+
+   //Length of the directory
+   *length = offset - pos;
+   //Update the length of the "." entry
+   ((ResEntry *) (context->data + pos))->dataLength = *length;
+   //Update the total size of the image
+   resHeader->totalSize = offset;
+
+   //Parse the newly added entries
+   for(offset = pos; offset < (pos + *length); offset += sizeof(ResEntry) + entry->nameLength)
+   {
+      //Point to the current entry
+      entry = (ResEntry *) (context->data + offset);
+
+      //Skip the . and .. directories
+      if(entry->name[0] == '.' && (entry->nameLength == 1 ||
+         (entry->nameLength == 2 && entry->name[1] == '.')))
+      {
+         continue;
+      }
+
+      //Data must be aligned on 4-byte boundaries
+      resHeader->totalSize = (resHeader->totalSize + 3) / 4 * 4;
+      //Set data offset
+      entry->dataStart = resHeader->totalSize;
+
+      //Form the full path to the item
+      n = strlen(prefix);
+      //Check the length of the resulting path
+      if((n + entry->nameLength + 2) > RES_IMAGE_MAX_PATH)
+         return ERROR_OUT_OF_RESOURCES;
+
+      strcpy(subdir, prefix);
+      memcpy(subdir + n, entry->name, entry->nameLength);
+      subdir[n + entry->nameLength] = '\0';
+
+      //Check entry type
+      if(entry->type == RES_TYPE_DIR)
+      {
+         //Subdirectories are terminated with a separator
+         strcat(subdir, "/");
+         //Add the contents of the subdirectory
+         error = resImageAddDirectory(context, pos, *length, subdir, &dirLength);
+         //Any error to report?
+         if(error) return error;
+
+         //Save the length of the subdirectory
+         entry->dataLength = dirLength;
+      }
+      else
+      {
+         //Retrieve the file
+         for(i = 0; i < context->count && strcmp(context->files[i].path, subdir); i++);
+
+         //Check the size of the image
+         if((resHeader->totalSize + context->files[i].length) > context->size)
+            return ERROR_OUT_OF_RESOURCES;
+
+         //Copy the contents of the file
+         memcpy(context->data + resHeader->totalSize, context->files[i].data,
+            context->files[i].length);
+
+         //Save the length of the file
+         entry->dataLength = context->files[i].length;
+         //Remember where the entry lies, for the index
+         context->entryStart[i] = offset;
+         //Update the total size of the image
+         resHeader->totalSize += context->files[i].length;
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Append the hashed path index to the image
+ *
+ * Same layout as the one produced by the resource compiler: the lowercase
+ * paths, then an open addressing table with at least twice as many slots
+ * as files
+ *
+ * @param[in] context Image being built
+ * @return Error code
+ **/
+
+static error_t resImageAddIndex(ResImageContext *context)
+{
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   uint32_t h;
+   uint32_t slotCount;
+   uint32_t pathStart;
+   char_t *p;
+   ResIndex *index;
+   ResIndexSlot *slot;
+   ResIndexDesc *desc;
+
+   //Point to the header of the resource image
+   ResHeader *resHeader = (ResHeader *) context->data;
+
+   //The number of slots is a power of two
+   for(slotCount = 1; slotCount < (2 * context->count); slotCount <<= 1);
+
+   //Normalized paths are stored right after the files
+   pathStart = resHeader->totalSize;
+
+   //Append the normalized paths
+   for(i = 0; i < context->count; i++)
+   {
+      //Length of the path, including the terminating NULL character
+      n = strlen(context->files[i].path) + 1;
+
+      //Check the size of the image
+      if((resHeader->totalSize + n) > context->size)
+         return ERROR_OUT_OF_RESOURCES;
+
+      //Paths are compared in a case insensitive way
+      p = (char_t *) context->data + resHeader->totalSize;
+      for(j = 0; j < n; j++)
+         p[j] = tolower((uint8_t) context->files[i].path[j]);
+
+      //Update the total size of the image
+      resHeader->totalSize += n;
+   }
+
+   //Data must be aligned on 4-byte boundaries
+   resHeader->totalSize = (resHeader->totalSize + 3) / 4 * 4;
+
+   //Check the size of the image
+   if((resHeader->totalSize + sizeof(ResIndex) + slotCount * sizeof(ResIndexSlot)) > context->size)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Point to the index
+   index = (ResIndex *) (context->data + resHeader->totalSize);
+   index->slotCount = slotCount;
+   memset(index->slot, 0, slotCount * sizeof(ResIndexSlot));
+
+   //Insert the files in the hash table
+   for(i = 0; i < context->count; i++)
+   {
+      //Point to the normalized path
+      p = (char_t *) context->data + pathStart;
+
+      //FNV-1a over the normalized path (same as the runtime lookup)
+      for(h = 2166136261UL, j = 0; p[j] != '\0'; j++)
+         h = (h ^ (uint8_t) p[j]) * 16777619UL;
+
+      //Find an empty slot
+      for(j = h & (slotCount - 1); index->slot[j].entryStart != 0; j = (j + 1) & (slotCount - 1));
+
+      //Fill the slot
+      slot = &index->slot[j];
+      slot->hash = h;
+      slot->entryStart = context->entryStart[i];
+      slot->pathStart = pathStart;
+
+      //The tag identifies the contents of the file
+      for(h = 2166136261UL, j = 0; j < context->files[i].length; j++)
+         h = (h ^ ((const uint8_t *) context->files[i].data)[j]) * 16777619UL;
+
+      //Save the tag
+      slot->tag = h;
+
+      //Point to the next path
+      pathStart += strlen(p) + 1;
+   }
+
+   //Fill the index descriptor
+   desc = (ResIndexDesc *) resHeader->rootEntry.name;
+   memcpy(desc->magic, RES_INDEX_MAGIC, sizeof(desc->magic));
+   desc->indexStart = resHeader->totalSize;
+   desc->indexLength = sizeof(ResIndex) + slotCount * sizeof(ResIndexSlot);
+
+   //Update the total size of the image
+   resHeader->totalSize += desc->indexLength;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Build a resource image
+ * @param[out] image Buffer where to store the image
+ * @param[in] size Size of the buffer
+ * @param[in] files Files to be stored (paths relative to the root)
+ * @param[in] count Number of files
+ * @param[in] index Append the hashed path index
+ * @return Error code
+ **/
+
+error_t resImageBuild(uint8_t *image, size_t size,
+   const ResImageFile *files, uint_t count, bool_t index)
+{
+   error_t error;
+   uint_t n;
+   uint32_t dirLength;
+   ResImageContext context;
+   ResHeader *resHeader;
+
+   //The index descriptor is stored as the name of the root entry
+   n = index ? sizeof(ResIndexDesc) : 0;
+
+   //Check the size of the buffer
+   if(size < (sizeof(ResHeader) + n))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Initialize context
+   context.data = image;
+   context.size = size;
+   context.files = files;
+   context.count = count;
+
+   //Location of the entry of each file
+   context.entryStart = osMemAlloc(count * sizeof(uint32_t) + 1);
+   //Failed to allocate memory?
+   if(!context.entryStart)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Format the header
+   resHeader = (ResHeader *) image;
+   resHeader->totalSize = sizeof(ResHeader) + n;
+   resHeader->rootEntry.type = RES_TYPE_DIR;
+   resHeader->rootEntry.dataStart = sizeof(ResHeader) + n;
+   resHeader->rootEntry.dataLength = 0;
+   resHeader->rootEntry.nameLength = n;
+
+   //Add the contents of the root directory
+   error = resImageAddDirectory(&context, 0, 0, "", &dirLength);
+   //Save the length of the root directory
+   resHeader->rootEntry.dataLength = dirLength;
+
+   //Append the index if necessary
+   if(!error && index)
+      error = resImageAddIndex(&context);
+
+   //Release previously allocated memory
+   osMemFree(context.entryStart);
+   //Return status code
+   return error;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file res_image.h
+ * @brief Resource images built at run time
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _RES_IMAGE_H
+#define _RES_IMAGE_H
+
+//Dependencies
+#include "os.h"
+#include "error.h"
+
+//Maximum length of a path
+#define RES_IMAGE_MAX_PATH 128
+
+
+/**
+ * @brief File to be stored in a resource image
+ **/
+
+typedef struct
+{
+   const char_t *path;   ///<Path relative to the root, using forward slashes
+   const void *data;     ///<Contents of the file
+   size_t length;        ///<Length of the file
+} ResImageFile;
+
+
+//Resource image related functions
+error_t resImageBuild(uint8_t *image, size_t size,
+   const ResImageFile *files, uint_t count, bool_t index);
+
+#endif
@@ -0,0 +1,184 @@
+/**
+ * @file tcp_ip_stack_config.h
+ * @brief CycloneTCP configuration file
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _TCP_IP_STACK_CONFIG_H
+#define _TCP_IP_STACK_CONFIG_H
+
+//Trace level for TCP/IP stack debugging (warnings and errors only,
+//so that the output of the benchmarks stays readable)
+#define MEM_TRACE_LEVEL          2
+#define NIC_TRACE_LEVEL          2
+#define ETH_TRACE_LEVEL          2
+#define ARP_TRACE_LEVEL          2
+#define IP_TRACE_LEVEL           2
+#define IPV4_TRACE_LEVEL         2
+#define IPV6_TRACE_LEVEL         2
+#define ICMP_TRACE_LEVEL         2
+#define IGMP_TRACE_LEVEL         2
+#define ICMPV6_TRACE_LEVEL       2
+#define MLD_TRACE_LEVEL          2
+#define NDP_TRACE_LEVEL          2
+#define UDP_TRACE_LEVEL          2
+#define TCP_TRACE_LEVEL          2
+#define SOCKET_TRACE_LEVEL       2
+#define RAW_SOCKET_TRACE_LEVEL   2
+#define BSD_SOCKET_TRACE_LEVEL   2
+#define SLAAC_TRACE_LEVEL        2
+#define DHCP_TRACE_LEVEL         2
+#define DHCPV6_TRACE_LEVEL       2
+#define DNS_TRACE_LEVEL          2
+#define STD_SERVICES_TRACE_LEVEL 2
+#define FTP_TRACE_LEVEL          2
+#define HTTP_TRACE_LEVEL         2
+#define SMTP_TRACE_LEVEL         2
+
+//Number of network adapters
+#define NET_INTERFACE_COUNT 2
+
+//Maximum size of the MAC filter table
+#define MAC_FILTER_MAX_SIZE 16
+
+//IPv4 support
+#define IPV4_SUPPORT ENABLED
+//Maximum size of the IPv4 filter table
+#define IPV4_FILTER_MAX_SIZE 8
+
+//IPv4 fragmentation support
+#define IPV4_FRAG_SUPPORT ENABLED
+//Maximum number of fragmented packets the host will accept
+//and hold in the reassembly queue simultaneously
+#define IPV4_MAX_FRAG_DATAGRAMS 4
+//Maximum datagram size the host will accept when reassembling fragments
+#define IPV4_MAX_FRAG_DATAGRAM_SIZE 8192
+
+//Size of ARP cache
+#define ARP_CACHE_SIZE 8
+//Maximum number of packets waiting for address resolution to complete
+#define ARP_MAX_PENDING_PACKETS 2
+
+//IGMP support
+#define IGMP_SUPPORT ENABLED
+
+//IPv6 support
+#define IPV6_SUPPORT DISABLED
+//Maximum size of the IPv6 filter table
+#define IPV6_FILTER_MAX_SIZE 8
+
+//IPv6 fragmentation support
+#define IPV6_FRAG_SUPPORT DISABLED
+//Maximum number of fragmented packets the host will accept
+//and hold in the reassembly queue simultaneously
+#define IPV6_MAX_FRAG_DATAGRAMS 4
+//Maximum datagram size the host will accept when reassembling fragments
+#define IPV6_MAX_FRAG_DATAGRAM_SIZE 8192
+
+//MLD support
+#define MLD_SUPPORT DISABLED
+
+//Neighbor cache size
+#define NDP_CACHE_SIZE 8
+//Maximum number of packets waiting for address resolution to complete
+#define NDP_MAX_PENDING_PACKETS 2
+
+//TCP support
+#define TCP_SUPPORT ENABLED
+//Maximum buffer sizes (a window larger than 64 KB requires window scaling)
+#ifndef TCP_MAX_TX_BUFFER_SIZE
+   #define TCP_MAX_TX_BUFFER_SIZE 65535
+#endif
+#ifndef TCP_MAX_RX_BUFFER_SIZE
+   #define TCP_MAX_RX_BUFFER_SIZE 65535
+#endif
+//Default buffer size for transmission
+#ifndef TCP_DEFAULT_TX_BUFFER_SIZE
+   #define TCP_DEFAULT_TX_BUFFER_SIZE 16384
+#endif
+//Default buffer size for reception
+#ifndef TCP_DEFAULT_RX_BUFFER_SIZE
+   #define TCP_DEFAULT_RX_BUFFER_SIZE 16384
+#endif
+//SYN queue size for listening sockets
+#ifndef TCP_SYN_QUEUE_SIZE
+   #define TCP_SYN_QUEUE_SIZE 4
+#endif
+//Maximum number of retransmissions
+#define TCP_MAX_RETRIES 5
+//Selective acknowledgment support
+#ifndef TCP_SACK_SUPPORT
+   #define TCP_SACK_SUPPORT ENABLED
+#endif
+//Window scale option support
+#ifndef TCP_WINDOW_SCALE_SUPPORT
+   #define TCP_WINDOW_SCALE_SUPPORT ENABLED
+#endif
+//Timestamp option support
+#ifndef TCP_TIMESTAMP_SUPPORT
+   #define TCP_TIMESTAMP_SUPPORT ENABLED
+#endif
+//CUBIC congestion control support
+#ifndef TCP_CUBIC_SUPPORT
+   #define TCP_CUBIC_SUPPORT ENABLED
+#endif
+
+//UDP support
+#define UDP_SUPPORT ENABLED
+//Receive queue depth for connectionless sockets
+#define UDP_RX_QUEUE_SIZE 8
+
+//Raw socket support
+#define RAW_SOCKET_SUPPORT ENABLED
+//Receive queue depth for raw sockets
+#define RAW_SOCKET_RX_QUEUE_SIZE 8
+
+//Number of sockets that can be opened simultaneously
+#ifndef SOCKET_MAX_COUNT
+   #define SOCKET_MAX_COUNT 10
+#endif
+
+//Maximum number of simultaneous  connections
+#ifndef HTTP_SERVER_MAX_CONNECTIONS
+   #define HTTP_SERVER_MAX_CONNECTIONS 4
+#endif
+//Event-driven mode (one task multiplexing all the connections)
+#ifndef HTTP_SERVER_EVENT_DRIVEN_SUPPORT
+   #define HTTP_SERVER_EVENT_DRIVEN_SUPPORT DISABLED
+#endif
+//Server Side Includes support
+#define HTTP_SERVER_SSI_SUPPORT ENABLED
+//Precompressed resources (rc -z) support
+#define HTTP_SERVER_GZIP_TYPE_SUPPORT ENABLED
+
+//Table-driven CRC calculation
+#ifndef ETH_FAST_CRC_SUPPORT
+   #define ETH_FAST_CRC_SUPPORT ENABLED
+#endif
+
+//Stack-wide statistics
+#define NET_STATS_SUPPORT ENABLED
+
+#endif
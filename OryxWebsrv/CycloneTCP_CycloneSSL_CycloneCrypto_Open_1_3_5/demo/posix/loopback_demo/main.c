@@ -0,0 +1,366 @@
+/**
+ * @file main.c
+ * @brief Main routine
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Two network interfaces of the same process are joined by the loopback
+ * Ethernet link. A TCP client on the first interface streams a bulk
+ * transfer to a sink task on the second one, then fetches a static page
+ * and the statistics from the HTTP server running on the second interface.
+ * The process exits with a non-zero status if any byte is lost or corrupted
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Dependencies
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "os.h"
+
+#include "tcp_ip_stack.h"
+#include "loopback_eth.h"
+#include "http_server.h"
+#include "resource_manager.h"
+#include "loopback_link.h"
+#include "res_image.h"
+#include "host_bench.h"
+#include "debug.h"
+
+//Constant definitions
+#define DEMO_BULK_PORT 5001
+#define DEMO_BULK_SIZE (64 * 1024 * 1024)
+#define DEMO_CHUNK_SIZE 8192
+
+//Forward declaration of functions
+void sinkTask(void *param);
+
+//Static page served by the HTTP server
+static const char_t indexPage[] =
+   "<html><head><title>CycloneTCP</title></head>\r\n"
+   "<body><p>Served over the loopback link</p></body></html>\r\n";
+
+//Contents of the resource image
+static const ResImageFile resFiles[] =
+{
+   {"www/index.htm", indexPage, sizeof(indexPage) - 1}
+};
+
+//Global variables
+uint8_t res[4096];
+HttpServerSettings httpServerSettings;
+HttpServerContext httpServerContext;
+OsEvent *sinkEvent;
+Socket *sinkSocket;
+size_t sinkReceived;
+bool_t sinkCorrupted;
+
+
+/**
+ * @brief Byte expected at a given position of the bulk transfer
+ **/
+
+static uint8_t bulkPattern(size_t position)
+{
+   //251 is prime, so that the pattern never lines up with the segments
+   return position % 251;
+}
+
+
+/**
+ * @brief Sink task
+ *
+ * Accepts a single connection and checks every byte it receives
+ *
+ * @param[in] param Unused parameter
+ **/
+
+void sinkTask(void *param)
+{
+   error_t error;
+   size_t i;
+   size_t n;
+   IpAddr clientIpAddr;
+   uint16_t clientPort;
+   Socket *socket;
+   static uint8_t buffer[DEMO_CHUNK_SIZE];
+
+   //Wait for the client to connect
+   socket = socketAccept(sinkSocket, &clientIpAddr, &clientPort);
+
+   //Connection established?
+   if(socket)
+   {
+      //Set timeout for blocking functions
+      socketSetTimeout(socket, 10000);
+
+      //Receive data until the client shuts down the connection
+      while(1)
+      {
+         //Read incoming data
+         error = socketReceive(socket, buffer, sizeof(buffer), &n, 0);
+         //End of stream or error?
+         if(error) break;
+
+         //Check the contents of the data
+         for(i = 0; i < n; i++)
+         {
+            if(buffer[i] != bulkPattern(sinkReceived + i))
+               sinkCorrupted = TRUE;
+         }
+
+         //Total number of bytes received
+         sinkReceived += n;
+      }
+
+      //Close the connection
+      socketClose(socket);
+   }
+
+   //Notify the client
+   osEventSet(sinkEvent);
+   //Kill ourselves
+   osTaskDelete(NULL);
+}
+
+
+/**
+ * @brief Bulk TCP transfer through the loopback link
+ * @param[in] size Number of bytes to send
+ * @return Error code
+ **/
+
+error_t bulkTest(size_t size)
+{
+   error_t error;
+   size_t i;
+   size_t n;
+   size_t sent;
+   uint64_t time;
+   Socket *socket;
+   LoopbackEthStats stats;
+   static uint8_t buffer[DEMO_CHUNK_SIZE];
+
+   //Open the listening socket
+   sinkSocket = loopbackLinkListen(DEMO_BULK_PORT);
+   //Failed to open socket?
+   if(!sinkSocket) return ERROR_OPEN_FAILED;
+
+   //Create the sink task
+   if(!osTaskCreate("Sink", sinkTask, NULL, 500, 1))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Connect to the sink
+   socket = loopbackLinkConnect(DEMO_BULK_PORT, 10000);
+   //Failed to connect?
+   if(!socket) return ERROR_CONNECTION_FAILED;
+
+   //Start of the transfer
+   time = benchGetTime();
+
+   //Send data
+   for(error = NO_ERROR, sent = 0; !error && sent < size; sent += n)
+   {
+      //Size of the current chunk
+      n = min(size - sent, DEMO_CHUNK_SIZE);
+
+      //Fill the buffer with the expected pattern
+      for(i = 0; i < n; i++)
+         buffer[i] = bulkPattern(sent + i);
+
+      //Send the chunk
+      error = socketSend(socket, buffer, n, &n, 0);
+   }
+
+   //Graceful shutdown
+   if(!error)
+      error = socketShutdown(socket, SOCKET_SD_SEND);
+
+   //Wait for the sink to drain the connection
+   if(!osEventWait(sinkEvent, 30000))
+      error = ERROR_TIMEOUT;
+
+   //End of the transfer
+   time = benchGetTime() - time;
+   //Close the connection
+   socketClose(socket);
+
+   //Retrieve link statistics
+   loopbackEthGetStats(LOOPBACK_LINK_SERVER, &stats);
+
+   //Display results
+   printf("TCP: %u bytes sent, %u bytes received in %.3f s (%.1f Mbit/s)\r\n",
+      (uint_t) sent, (uint_t) sinkReceived, time / 1e9, sinkReceived * 8e3 / (time ? time : 1));
+   printf("Link: %u frames received, %u overruns\r\n", stats.rxPackets, stats.rxOverruns);
+
+   //Any error to report?
+   if(error) return error;
+
+   //Check the data
+   if(sinkReceived != size || sinkCorrupted)
+      return ERROR_FAILURE;
+
+   //Successful transfer
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief HTTP requests through the loopback link
+ * @return Error code
+ **/
+
+error_t httpTest(void)
+{
+   error_t error;
+   uint_t statusCode;
+   size_t length;
+   char_t *body;
+   static char_t buffer[16384];
+
+   //Fetch the default document
+   error = loopbackLinkHttpGet("/", NULL, buffer, sizeof(buffer), &statusCode, &body, &length);
+   //Any error to report?
+   if(error) return error;
+
+   //Display result
+   printf("HTTP: GET / -> %u (%u bytes)\r\n", statusCode, (uint_t) length);
+
+   //Check the page
+   if(statusCode != 200 || length != strlen(indexPage) || memcmp(body, indexPage, length))
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //Fetch the statistics of the stack
+   error = loopbackLinkHttpGet(HTTP_SERVER_STATS_URI, NULL, buffer,
+      sizeof(buffer), &statusCode, &body, &length);
+   //Any error to report?
+   if(error) return error;
+
+   //Display result
+   printf("HTTP: GET %s -> %u (%u bytes)\r\n", HTTP_SERVER_STATS_URI, statusCode, (uint_t) length);
+
+   //The statistics are formatted as a JSON object
+   if(statusCode != 200 || length == 0 || body[0] != '{')
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //Unknown URIs are still reported as such
+   error = loopbackLinkHttpGet("/missing.htm", NULL, buffer,
+      sizeof(buffer), &statusCode, &body, &length);
+   //Any error to report?
+   if(error) return error;
+
+   //Display result
+   printf("HTTP: GET /missing.htm -> %u\r\n", statusCode);
+
+   //Check status code
+   if(statusCode != 404)
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Main entry point
+ * @param[in] argc Number of arguments
+ * @param[in] argv Size of the bulk transfer, in megabytes (optional)
+ * @return Exit status
+ **/
+
+int_t main(int_t argc, char_t *argv[])
+{
+   error_t error;
+   size_t size;
+
+   //Size of the bulk transfer
+   size = (argc > 1) ? (size_t) atoi(argv[1]) * 1024 * 1024 : DEMO_BULK_SIZE;
+
+   //Initialize debug output
+   debugInit();
+
+   //Build the resource image
+   error = resImageBuild(res, sizeof(res), resFiles, arraysize(resFiles), TRUE);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to build resource image!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Create the event used to wait for the sink task
+   sinkEvent = osEventCreate(FALSE, FALSE);
+   //Out of resources?
+   if(sinkEvent == OS_INVALID_HANDLE)
+      return EXIT_FAILURE;
+
+   //Bring up the loopback link
+   error = loopbackLinkStart(NULL, NULL);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start the loopback link!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Clear HTTP server settings
+   memset(&httpServerSettings, 0, sizeof(httpServerSettings));
+   //Bind HTTP server to the server end of the link
+   httpServerSettings.interface = LOOPBACK_LINK_SERVER;
+   //Listen to port 80
+   httpServerSettings.port = 80;
+   //Specify the server's root directory
+   strcpy(httpServerSettings.rootDirectory, "/www/");
+   //Set default home page
+   strcpy(httpServerSettings.defaultDocument, "index.htm");
+   //Serve the statistics of the stack
+   httpServerSettings.uriNotFoundCallback = httpStatsCallback;
+
+   //Start HTTP server
+   error = httpServerStart(&httpServerContext, &httpServerSettings);
+   //Failed to start HTTP server?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to start HTTP server!\r\n");
+      return EXIT_FAILURE;
+   }
+
+   //Bulk transfer
+   error = bulkTest(size);
+   //Display result
+   printf("TCP bulk transfer: %s\r\n", error ? "FAILED" : "OK");
+
+   //HTTP requests
+   if(!error)
+   {
+      error = httpTest();
+      //Display result
+      printf("HTTP requests: %s\r\n", error ? "FAILED" : "OK");
+   }
+
+   //Return status code
+   return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
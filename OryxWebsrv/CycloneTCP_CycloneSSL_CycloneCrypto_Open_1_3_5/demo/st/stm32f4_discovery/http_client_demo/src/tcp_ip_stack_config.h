@@ -134,6 +134,8 @@
 #define HTTP_SERVER_MAX_CONNECTIONS 4
 //Server Side Includes support
 #define HTTP_SERVER_SSI_SUPPORT ENABLED
+//Precompressed resources (rc -z) support
+#define HTTP_SERVER_GZIP_TYPE_SUPPORT ENABLED
 
 #define ETH_FAST_CRC_SUPPORT ENABLED
 
@@ -0,0 +1,844 @@
+/**
+ *@file deflate.c
+ *@brief Gzip compression (deflate)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Minimal DEFLATE encoder (RFC 1951) producing gzip members (RFC 1952).
+ * Each file is encoded as a single block using either the fixed or a
+ * dynamic Huffman code, whichever is smaller. Back references never
+ * reach further than DEFLATE_WINDOW_SIZE bytes
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+//Disable compiler warning
+#define _CRT_SECURE_NO_WARNINGS
+
+//Dependencies
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#include "deflate.h"
+
+//Error codes
+#ifndef ERROR_FAILURE
+   #define ERROR_FAILURE 1
+#endif
+
+//Hash table used to find matches
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+//Maximum number of candidates examined for each position
+#define DEFLATE_MAX_CHAIN 256
+//Shortest and longest matches
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+
+
+/**
+ *@brief LZ77 token (literal byte or length/distance pair)
+ **/
+
+typedef struct
+{
+   unsigned short value;
+   unsigned short distance;
+} tDeflateToken;
+
+
+/**
+ *@brief Bit writer
+ **/
+
+typedef struct
+{
+   unsigned char *data;
+   unsigned long size;
+   unsigned long pos;
+   unsigned long bitBuffer;
+   unsigned int bitCount;
+   int overflow;
+} tBitWriter;
+
+
+//Base lengths for length codes 257..285
+static const unsigned short lengthBase[29] =
+{
+   3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+   35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+//Extra bits for length codes 257..285
+static const unsigned char lengthExtra[29] =
+{
+   0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+   3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+//Base distances for distance codes 0..29
+static const unsigned short distBase[30] =
+{
+   1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+   257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+//Extra bits for distance codes 0..29
+static const unsigned char distExtra[30] =
+{
+   0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+   7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+//Order in which code length code lengths are transmitted
+static const unsigned char codeLengthOrder[19] =
+{
+   16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+/**
+ *@brief Append bits to the output stream
+ *@param[in] writer Bit writer
+ *@param[in] value Bits to write (least significant bit first)
+ *@param[in] n Number of bits
+ **/
+
+static void writeBits(tBitWriter *writer, unsigned long value, unsigned int n)
+{
+   //Append the bits to the bit buffer
+   writer->bitBuffer |= value << writer->bitCount;
+   writer->bitCount += n;
+
+   //Flush complete bytes
+   while(writer->bitCount >= 8)
+   {
+      if(writer->pos < writer->size)
+         writer->data[writer->pos++] = (unsigned char) writer->bitBuffer;
+      else
+         writer->overflow = 1;
+
+      writer->bitBuffer >>= 8;
+      writer->bitCount -= 8;
+   }
+}
+
+
+/**
+ *@brief Pad the output stream to a byte boundary
+ *@param[in] writer Bit writer
+ **/
+
+static void alignBits(tBitWriter *writer)
+{
+   if(writer->bitCount > 0)
+      writeBits(writer, 0, 8 - writer->bitCount);
+}
+
+
+/**
+ *@brief Compute CRC-32 of the uncompressed data
+ *@param[in] data Pointer to the data
+ *@param[in] length Length of the data
+ *@return CRC-32 value
+ **/
+
+static unsigned long crc32(const unsigned char *data, unsigned long length)
+{
+   unsigned int i;
+   unsigned int j;
+   unsigned long crc;
+   static unsigned long table[256];
+
+   //Build the lookup table the first time
+   if(table[1] == 0)
+   {
+      for(i = 0; i < 256; i++)
+      {
+         for(crc = i, j = 0; j < 8; j++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320UL : (crc >> 1);
+         table[i] = crc;
+      }
+   }
+
+   //Process data
+   for(crc = 0xFFFFFFFFUL, i = 0; i < length; i++)
+      crc = (crc >> 8) ^ table[(crc ^ data[i]) & 0xFF];
+
+   //Return the final value
+   return crc ^ 0xFFFFFFFFUL;
+}
+
+
+/**
+ *@brief Insert a position in the hash chains
+ **/
+
+static void insertPosition(const unsigned char *input, unsigned long length,
+   unsigned long pos, long *head, long *prev)
+{
+   unsigned int h;
+
+   //Three bytes are needed to compute the hash
+   if((pos + DEFLATE_MIN_MATCH) > length)
+      return;
+
+   //Hash the three bytes at the current position
+   h = ((input[pos] << 10) ^ (input[pos + 1] << 5) ^ input[pos + 2]) & (DEFLATE_HASH_SIZE - 1);
+
+   //Link the position
+   prev[pos] = head[h];
+   head[h] = pos;
+}
+
+
+/**
+ *@brief Find the longest match at a given position
+ **/
+
+static unsigned int findMatch(const unsigned char *input, unsigned long length,
+   unsigned long pos, const long *head, const long *prev, unsigned int *distance)
+{
+   unsigned int h;
+   unsigned int n;
+   unsigned int maxLength;
+   unsigned int bestLength;
+   unsigned int chain;
+   long candidate;
+
+   //Three bytes are needed to compute the hash
+   if((pos + DEFLATE_MIN_MATCH) > length)
+      return 0;
+
+   //Limit the length of the match
+   maxLength = (unsigned int) min(length - pos, DEFLATE_MAX_MATCH);
+   bestLength = 0;
+
+   //Walk through the hash chain
+   h = ((input[pos] << 10) ^ (input[pos + 1] << 5) ^ input[pos + 2]) & (DEFLATE_HASH_SIZE - 1);
+   candidate = head[h];
+
+   for(chain = 0; candidate >= 0 && chain < DEFLATE_MAX_CHAIN; chain++)
+   {
+      //Matches must lie within the sliding window
+      if((pos - candidate) > DEFLATE_WINDOW_SIZE)
+         break;
+
+      //Compute the length of the match
+      for(n = 0; n < maxLength && input[candidate + n] == input[pos + n]; n++);
+
+      //Longest match so far?
+      if(n > bestLength)
+      {
+         bestLength = n;
+         *distance = (unsigned int) (pos - candidate);
+
+         //No need to search any further
+         if(n == maxLength)
+            break;
+      }
+
+      //Next candidate
+      candidate = prev[candidate];
+   }
+
+   //Return the length of the longest match
+   return (bestLength >= DEFLATE_MIN_MATCH) ? bestLength : 0;
+}
+
+
+/**
+ *@brief Turn the input into a sequence of literals and matches
+ *@return Number of tokens, or 0 on failure
+ **/
+
+static unsigned long lz77(const unsigned char *input, unsigned long length, tDeflateToken *tokens)
+{
+   unsigned long i;
+   unsigned long j;
+   unsigned long count;
+   unsigned int matchLength;
+   unsigned int matchDistance;
+   unsigned int nextLength;
+   unsigned int nextDistance;
+   long *head;
+   long *prev;
+
+   //Allocate hash chains
+   head = malloc(DEFLATE_HASH_SIZE * sizeof(long));
+   prev = malloc((length + 1) * sizeof(long));
+
+   //Failed to allocate memory?
+   if(!head || !prev)
+   {
+      free(head);
+      free(prev);
+      return 0;
+   }
+
+   //Hash chains are initially empty
+   for(i = 0; i < DEFLATE_HASH_SIZE; i++)
+      head[i] = -1;
+
+   //Process the input
+   for(i = 0, count = 0; i < length; )
+   {
+      //Longest match at the current position
+      matchLength = findMatch(input, length, i, head, prev, &matchDistance);
+
+      //Literal byte?
+      if(matchLength == 0)
+      {
+         insertPosition(input, length, i, head, prev);
+         tokens[count].value = input[i++];
+         tokens[count++].distance = 0;
+         continue;
+      }
+
+      //Lazy evaluation: check whether the next position gives a longer match
+      insertPosition(input, length, i, head, prev);
+      nextLength = findMatch(input, length, i + 1, head, prev, &nextDistance);
+
+      //Emit a literal and take the longer match instead
+      if(nextLength > matchLength)
+      {
+         tokens[count].value = input[i++];
+         tokens[count++].distance = 0;
+         continue;
+      }
+
+      //Emit the match
+      tokens[count].value = matchLength;
+      tokens[count++].distance = matchDistance;
+
+      //Insert the positions covered by the match
+      for(j = 1; j < matchLength; j++)
+         insertPosition(input, length, i + j, head, prev);
+
+      //Skip the matched bytes
+      i += matchLength;
+   }
+
+   //Release hash chains
+   free(head);
+   free(prev);
+
+   //Return the number of tokens
+   return count;
+}
+
+
+/**
+ *@brief Compute length-limited Huffman code lengths
+ *@param[in] freq Frequency of each symbol
+ *@param[in] n Number of symbols
+ *@param[in] maxBits Maximum code length
+ *@param[out] lengths Code length of each symbol
+ **/
+
+static void buildLengths(const unsigned long *freq, unsigned int n,
+   unsigned int maxBits, unsigned char *lengths)
+{
+   unsigned int i;
+   unsigned int k;
+   unsigned int m;
+   unsigned int depth;
+   unsigned int nodeCount;
+   unsigned int maxDepth;
+   int a;
+   int b;
+   unsigned long weight[2 * 288];
+   int parent[2 * 288];
+   int active[2 * 288];
+
+   //Copy frequencies
+   for(i = 0; i < n; i++)
+      weight[i] = freq[i];
+
+   while(1)
+   {
+      //Clear code lengths
+      memset(lengths, 0, n);
+
+      //Count used symbols
+      for(m = 0, i = 0; i < n; i++)
+      {
+         active[i] = (weight[i] > 0);
+         parent[i] = -1;
+         if(active[i]) m++;
+      }
+
+      //Trivial cases
+      if(m == 0)
+         return;
+
+      if(m == 1)
+      {
+         for(i = 0; i < n; i++)
+            if(active[i]) lengths[i] = 1;
+         return;
+      }
+
+      //Merge the two lightest nodes until a single tree remains
+      for(nodeCount = n, k = 1; k < m; k++, nodeCount++)
+      {
+         a = -1;
+         b = -1;
+
+         for(i = 0; i < nodeCount; i++)
+         {
+            if(!active[i]) continue;
+
+            if(a < 0 || weight[i] < weight[a])
+            {
+               b = a;
+               a = i;
+            }
+            else if(b < 0 || weight[i] < weight[b])
+            {
+               b = i;
+            }
+         }
+
+         weight[nodeCount] = weight[a] + weight[b];
+         parent[nodeCount] = -1;
+         active[nodeCount] = 1;
+         parent[a] = nodeCount;
+         parent[b] = nodeCount;
+         active[a] = 0;
+         active[b] = 0;
+      }
+
+      //The depth of each leaf gives its code length
+      for(maxDepth = 0, i = 0; i < n; i++)
+      {
+         if(weight[i] == 0) continue;
+
+         for(depth = 0, a = i; parent[a] >= 0; a = parent[a])
+            depth++;
+
+         lengths[i] = depth;
+         maxDepth = max(maxDepth, depth);
+      }
+
+      //Valid code?
+      if(maxDepth <= maxBits)
+         return;
+
+      //Flatten the distribution and try again
+      for(i = 0; i < n; i++)
+         weight[i] = (weight[i] + 1) / 2;
+   }
+}
+
+
+/**
+ *@brief Assign canonical codes (bit-reversed for LSB-first output)
+ **/
+
+static void buildCodes(const unsigned char *lengths, unsigned int n, unsigned short *codes)
+{
+   unsigned int i;
+   unsigned int j;
+   unsigned int code;
+   unsigned int count[16];
+   unsigned int next[16];
+
+   //Count the number of codes of each length
+   memset(count, 0, sizeof(count));
+   for(i = 0; i < n; i++)
+      count[lengths[i]]++;
+   count[0] = 0;
+
+   //Smallest code of each length
+   for(code = 0, i = 1; i < 16; i++)
+   {
+      code = (code + count[i - 1]) << 1;
+      next[i] = code;
+   }
+
+   //Assign codes
+   for(i = 0; i < n; i++)
+   {
+      if(lengths[i] == 0) continue;
+
+      code = next[lengths[i]]++;
+
+      //Huffman codes are packed starting with the most significant bit
+      for(codes[i] = 0, j = 0; j < lengths[i]; j++)
+         codes[i] |= ((code >> j) & 1) << (lengths[i] - 1 - j);
+   }
+}
+
+
+/**
+ *@brief Get the length code of a match
+ **/
+
+static unsigned int getLengthCode(unsigned int length)
+{
+   unsigned int i;
+
+   for(i = 28; lengthBase[i] > length; i--);
+   return i;
+}
+
+
+/**
+ *@brief Get the distance code of a match
+ **/
+
+static unsigned int getDistanceCode(unsigned int distance)
+{
+   unsigned int i;
+
+   for(i = 29; distBase[i] > distance; i--);
+   return i;
+}
+
+
+/**
+ *@brief Encode the tokens as a single final block
+ *@param[in] writer Bit writer
+ *@param[in] tokens LZ77 tokens
+ *@param[in] count Number of tokens
+ *@param[in] dynamic Use a dynamic Huffman code rather than the fixed one
+ **/
+
+static void writeBlock(tBitWriter *writer, const tDeflateToken *tokens,
+   unsigned long count, int dynamic)
+{
+   unsigned long i;
+   unsigned int j;
+   unsigned int n;
+   unsigned int code;
+   unsigned int hlit;
+   unsigned int hdist;
+   unsigned int hclen;
+   unsigned int rleCount;
+   unsigned long litFreq[288];
+   unsigned long distFreq[30];
+   unsigned long clFreq[19];
+   unsigned char litLengths[288];
+   unsigned char distLengths[30];
+   unsigned char clLengths[19];
+   unsigned short litCodes[288];
+   unsigned short distCodes[30];
+   unsigned short clCodes[19];
+   unsigned char all[316];
+   unsigned char rleSymbol[316];
+   unsigned char rleExtra[316];
+
+   //BFINAL and BTYPE fields
+   writeBits(writer, 1, 1);
+   writeBits(writer, dynamic ? 2 : 1, 2);
+
+   //Dynamic Huffman codes?
+   if(dynamic)
+   {
+      //Gather symbol statistics
+      memset(litFreq, 0, sizeof(litFreq));
+      memset(distFreq, 0, sizeof(distFreq));
+
+      for(i = 0; i < count; i++)
+      {
+         if(tokens[i].distance == 0)
+         {
+            litFreq[tokens[i].value]++;
+         }
+         else
+         {
+            litFreq[257 + getLengthCode(tokens[i].value)]++;
+            distFreq[getDistanceCode(tokens[i].distance)]++;
+         }
+      }
+
+      //End-of-block code
+      litFreq[256] = 1;
+
+      //Compute code lengths
+      buildLengths(litFreq, 286, 15, litLengths);
+      buildLengths(distFreq, 30, 15, distLengths);
+      litLengths[286] = 0;
+      litLengths[287] = 0;
+
+      //At least one distance code must be defined
+      for(j = 0; j < 30 && distLengths[j] == 0; j++);
+      if(j == 30) distLengths[0] = 1;
+
+      //Trim unused trailing codes
+      for(hlit = 286; hlit > 257 && litLengths[hlit - 1] == 0; hlit--);
+      for(hdist = 30; hdist > 1 && distLengths[hdist - 1] == 0; hdist--);
+
+      //Code lengths are sent as a single sequence
+      memcpy(all, litLengths, hlit);
+      memcpy(all + hlit, distLengths, hdist);
+      n = hlit + hdist;
+
+      //Run-length encode the code lengths
+      memset(clFreq, 0, sizeof(clFreq));
+
+      for(j = 0, rleCount = 0; j < n; rleCount++)
+      {
+         unsigned int run;
+
+         //Length of the run starting at the current position
+         for(run = 1; (j + run) < n && all[j + run] == all[j]; run++);
+
+         //Long run of zeros?
+         if(all[j] == 0 && run >= 11)
+         {
+            run = min(run, 138);
+            rleSymbol[rleCount] = 18;
+            rleExtra[rleCount] = run - 11;
+         }
+         //Short run of zeros?
+         else if(all[j] == 0 && run >= 3)
+         {
+            rleSymbol[rleCount] = 17;
+            rleExtra[rleCount] = run - 3;
+         }
+         //Repeat the previous length?
+         else if(j > 0 && all[j - 1] == all[j] && run >= 3)
+         {
+            run = min(run, 6);
+            rleSymbol[rleCount] = 16;
+            rleExtra[rleCount] = run - 3;
+         }
+         //Single length
+         else
+         {
+            run = 1;
+            rleSymbol[rleCount] = all[j];
+            rleExtra[rleCount] = 0;
+         }
+
+         clFreq[rleSymbol[rleCount]]++;
+         j += run;
+      }
+
+      //Code length code
+      buildLengths(clFreq, 19, 7, clLengths);
+      buildCodes(clLengths, 19, clCodes);
+
+      //Trim unused trailing code length codes
+      for(hclen = 19; hclen > 4 && clLengths[codeLengthOrder[hclen - 1]] == 0; hclen--);
+
+      //HLIT, HDIST and HCLEN fields
+      writeBits(writer, hlit - 257, 5);
+      writeBits(writer, hdist - 1, 5);
+      writeBits(writer, hclen - 4, 4);
+
+      //Code length code lengths
+      for(j = 0; j < hclen; j++)
+         writeBits(writer, clLengths[codeLengthOrder[j]], 3);
+
+      //Literal/length and distance code lengths
+      for(j = 0; j < rleCount; j++)
+      {
+         writeBits(writer, clCodes[rleSymbol[j]], clLengths[rleSymbol[j]]);
+
+         if(rleSymbol[j] == 16)
+            writeBits(writer, rleExtra[j], 2);
+         else if(rleSymbol[j] == 17)
+            writeBits(writer, rleExtra[j], 3);
+         else if(rleSymbol[j] == 18)
+            writeBits(writer, rleExtra[j], 7);
+      }
+   }
+   else
+   {
+      //Fixed literal/length code
+      for(j = 0; j < 144; j++) litLengths[j] = 8;
+      for(; j < 256; j++) litLengths[j] = 9;
+      for(; j < 280; j++) litLengths[j] = 7;
+      for(; j < 288; j++) litLengths[j] = 8;
+
+      //Fixed distance code
+      for(j = 0; j < 30; j++) distLengths[j] = 5;
+   }
+
+   //Assign codes
+   buildCodes(litLengths, 288, litCodes);
+   buildCodes(distLengths, 30, distCodes);
+
+   //Encode tokens
+   for(i = 0; i < count; i++)
+   {
+      //Literal byte?
+      if(tokens[i].distance == 0)
+      {
+         writeBits(writer, litCodes[tokens[i].value], litLengths[tokens[i].value]);
+      }
+      else
+      {
+         //Length
+         code = getLengthCode(tokens[i].value);
+         writeBits(writer, litCodes[257 + code], litLengths[257 + code]);
+         writeBits(writer, tokens[i].value - lengthBase[code], lengthExtra[code]);
+
+         //Distance
+         code = getDistanceCode(tokens[i].distance);
+         writeBits(writer, distCodes[code], distLengths[code]);
+         writeBits(writer, tokens[i].distance - distBase[code], distExtra[code]);
+      }
+   }
+
+   //End of block
+   writeBits(writer, litCodes[256], litLengths[256]);
+   alignBits(writer);
+}
+
+
+/**
+ *@brief Store the input in uncompressed blocks
+ **/
+
+static void writeStoredBlocks(tBitWriter *writer, const unsigned char *input, unsigned long length)
+{
+   unsigned long n;
+
+   do
+   {
+      //A stored block holds at most 65535 bytes
+      n = min(length, 65535);
+
+      //BFINAL and BTYPE fields
+      writeBits(writer, (n == length) ? 1 : 0, 1);
+      writeBits(writer, 0, 2);
+      alignBits(writer);
+
+      //LEN and NLEN fields
+      writeBits(writer, n, 16);
+      writeBits(writer, ~n & 0xFFFF, 16);
+
+      //Copy data
+      for(; n > 0; n--, length--)
+         writeBits(writer, *(input++), 8);
+
+   } while(length > 0);
+}
+
+
+/**
+ *@brief Compress data into a gzip member
+ *@param[in] input Data to compress
+ *@param[in] inputLength Length of the data
+ *@param[out] output Buffer where to store the gzip member
+ *@param[in] outputSize Size of the output buffer
+ *@param[out] outputLength Length of the gzip member
+ *@return Status code
+ **/
+
+int gzipCompress(const unsigned char *input, unsigned long inputLength,
+   unsigned char *output, unsigned long outputSize, unsigned long *outputLength)
+{
+   int i;
+   int best;
+   unsigned long n;
+   unsigned long count;
+   unsigned long crc;
+   unsigned long size;
+   tDeflateToken *tokens;
+   tBitWriter writer[3];
+
+   //Allocate memory to hold the tokens
+   tokens = malloc((inputLength + 1) * sizeof(tDeflateToken));
+   //Failed to allocate memory?
+   if(!tokens)
+      return ERROR_FAILURE;
+
+   //Find matches
+   count = lz77(input, inputLength, tokens);
+   //Any error to report?
+   if(inputLength > 0 && count == 0)
+   {
+      free(tokens);
+      return ERROR_FAILURE;
+   }
+
+   //Worst case size of the encoded stream
+   size = 2 * inputLength + 1024;
+
+   //Try the dynamic code, the fixed code and stored blocks
+   for(i = 0; i < 3; i++)
+   {
+      memset(&writer[i], 0, sizeof(tBitWriter));
+      writer[i].data = malloc(size);
+      writer[i].size = size;
+
+      if(!writer[i].data)
+         writer[i].overflow = 1;
+      else if(i < 2)
+         writeBlock(&writer[i], tokens, count, i == 0);
+      else
+         writeStoredBlocks(&writer[i], input, inputLength);
+   }
+
+   //Keep the shortest encoding
+   for(best = -1, i = 0; i < 3; i++)
+   {
+      if(!writer[i].overflow && (best < 0 || writer[i].pos < writer[best].pos))
+         best = i;
+   }
+
+   //Gzip header (10 bytes), DEFLATE stream and trailer (8 bytes)
+   n = (best >= 0) ? (10 + writer[best].pos + 8) : 0;
+
+   //Make sure the output buffer is large enough
+   if(best >= 0 && n <= outputSize)
+   {
+      //ID1, ID2, CM (deflate), FLG, MTIME, XFL and OS (unknown)
+      memcpy(output, "\x1F\x8B\x08\x00\x00\x00\x00\x00\x00\xFF", 10);
+      //Compressed blocks
+      memcpy(output + 10, writer[best].data, writer[best].pos);
+
+      //CRC-32 of the uncompressed data
+      crc = crc32(input, inputLength);
+      output[n - 8] = (unsigned char) crc;
+      output[n - 7] = (unsigned char) (crc >> 8);
+      output[n - 6] = (unsigned char) (crc >> 16);
+      output[n - 5] = (unsigned char) (crc >> 24);
+
+      //Size of the uncompressed data
+      output[n - 4] = (unsigned char) inputLength;
+      output[n - 3] = (unsigned char) (inputLength >> 8);
+      output[n - 2] = (unsigned char) (inputLength >> 16);
+      output[n - 1] = (unsigned char) (inputLength >> 24);
+
+      //Return the length of the gzip member
+      *outputLength = n;
+   }
+
+   //Release previously allocated memory
+   for(i = 0; i < 3; i++)
+      free(writer[i].data);
+   free(tokens);
+
+   //Return status code
+   if(best < 0)
+      return ERROR_FAILURE;
+   else if(n > outputSize)
+      return ERROR_FILE_TOO_LARGE;
+   else
+      return NO_ERROR;
+}
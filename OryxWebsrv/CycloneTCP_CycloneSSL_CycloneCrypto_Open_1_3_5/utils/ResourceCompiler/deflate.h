@@ -0,0 +1,38 @@
+/**
+ *@file deflate.h
+ *@brief Gzip compression (deflate)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.5
+ **/
+
+#ifndef _DEFLATE_H
+#define _DEFLATE_H
+
+//Maximum distance of back references. The firmware decompresses
+//the resources with a sliding window of the same size
+#define DEFLATE_WINDOW_SIZE 4096
+
+//Gzip compression
+int gzipCompress(const unsigned char *input, unsigned long inputLength,
+   unsigned char *output, unsigned long outputSize, unsigned long *outputLength);
+
+#endif
@@ -31,8 +31,10 @@
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <direct.h>
 #include <shlwapi.h>
+#include "deflate.h"
 
 //Libraries
 #pragma comment(lib, "shlwapi.lib")
@@ -79,10 +81,98 @@ typedef struct
    tResEntry rootEntry;
 } tResHeader;
 
+
+/**
+ *@brief Path index descriptor (stored as the name of the root entry)
+ **/
+
+typedef struct
+{
+   char magic[4];
+   unsigned long indexOffset;
+   unsigned long indexLength;
+} tResIndexDesc;
+
+
+/**
+ *@brief Path index slot
+ **/
+
+typedef struct
+{
+   unsigned long hash;
+   unsigned long entryOffset;
+   unsigned long pathOffset;
+   unsigned long tag;
+} tResIndexSlot;
+
+
+/**
+ *@brief Path index
+ **/
+
+typedef struct
+{
+   unsigned long slotCount;
+   tResIndexSlot slot[];
+} tResIndex;
+
 //Restore previous settings for data aligment
 #pragma pack(pop)
 
 
+/**
+ *@brief File referenced by the path index
+ **/
+
+typedef struct
+{
+   unsigned long entryOffset;
+   unsigned long pathOffset;
+   unsigned long hash;
+   unsigned long tag;
+   char path[MAX_PATH];
+} tIndexItem;
+
+
+//Store compressible files as gzip members
+static int compressFiles = 0;
+
+//Extensions of the files that are worth compressing
+static const char *compressibleExtensions[] =
+{
+   ".htm", ".html", ".css", ".js", ".json", ".xml", ".svg", ".txt", ".csv"
+};
+
+
+/**
+ *@brief Check whether a file should be compressed
+ *@param[in] filename Name of the file
+ *@param[in] length Length of the name
+ *@return Non-zero if the file should be compressed
+ **/
+
+int isCompressible(const char *filename, unsigned int length)
+{
+   unsigned int i;
+   unsigned int n;
+
+   //Loop through the list of extensions
+   for(i = 0; i < sizeof(compressibleExtensions) / sizeof(compressibleExtensions[0]); i++)
+   {
+      //Length of the current extension
+      n = strlen(compressibleExtensions[i]);
+
+      //Compare extensions
+      if(length > n && !_strnicmp(filename + length - n, compressibleExtensions[i], n))
+         return 1;
+   }
+
+   //Server-side scripts and binary files are stored as is
+   return 0;
+}
+
+
 /**
  *@brief Add the contents of a file to the resource data
  *@param[in] filename Path to the filename
@@ -149,6 +239,75 @@ int addFile(const char *filename, unsigned char *data, unsigned long maxSize, un
 }
 
 
+/**
+ *@brief Add the gzip-compressed contents of a file to the resource data
+ *@param[in] filename Path to the filename
+ *@param[in] data Pointer to the resource data
+ *@param[in] maxSize Maximum size of the resulting resource file
+ *@param[out] length Actual length of the gzip member
+ *@return Status code
+ **/
+
+int addCompressedFile(const char *filename, unsigned char *data, unsigned long maxSize, unsigned long *length)
+{
+   int error;
+   unsigned long n;
+   unsigned char *buffer;
+   FILE *fp;
+
+   //Point to the header of the resource data
+   tResHeader *ResHeader = (tResHeader *) data;
+
+   //Open the specified file
+   fp = fopen(filename, "rb");
+   //Cannot open file?
+   if(!fp)
+      return ERROR_OPEN_FAILED;
+
+   //Get the length of the file
+   fseek(fp, 0, SEEK_END);
+   n = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+
+   //Allocate a memory buffer to hold the file contents
+   buffer = malloc(n + 1);
+   //Failed to allocate memory?
+   if(!buffer)
+   {
+      fclose(fp);
+      return ERROR_FAILURE;
+   }
+
+   //Read file contents
+   if(fread(buffer, 1, n, fp) != n)
+   {
+      free(buffer);
+      fclose(fp);
+      return ERROR_FAILURE;
+   }
+
+   //Close file
+   fclose(fp);
+
+   //Compress the file contents
+   error = gzipCompress(buffer, n, data + ResHeader->totalSize,
+      maxSize - ResHeader->totalSize, length);
+
+   //Release previoulsy allocated memory
+   free(buffer);
+
+   //Any error to report?
+   if(error)
+      return error;
+
+   //Update the total length of the resource data
+   ResHeader->totalSize += *length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  *@brief Add the contents of a directory to the resource data
  *@param[in] parentOffset Offset of the parent directory
@@ -249,7 +408,7 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
          continue;
 
       //Make sure the maximum size is not exceeded
-      if((i + sizeof(tResEntry) + strlen(findFileData.cFileName)) >= maxSize)
+      if((i + sizeof(tResEntry) + strlen(findFileData.cFileName) + 3) >= maxSize)
       {
          FindClose(hFind);
          return ERROR_FILE_TOO_LARGE;
@@ -263,6 +422,14 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
       entry->nameLength = strlen(findFileData.cFileName);
       strncpy(entry->name, findFileData.cFileName, entry->nameLength);
 
+      //Compressed files are stored with a .gz suffix
+      if(compressFiles && entry->type == RES_TYPE_FILE &&
+         isCompressible(entry->name, entry->nameLength))
+      {
+         strncpy(entry->name + entry->nameLength, ".gz", 3);
+         entry->nameLength += 3;
+      }
+
       //Jump to the following entry
       i += sizeof(tResEntry) + entry->nameLength;
       //Update the length of the directory
@@ -315,6 +482,15 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
             //Add the contents of the directory to the resource data
             error = addDirectory(pos, *length, path, data, maxSize, &entry->dataLength);
          }
+         //File to be compressed?
+         else if(compressFiles && entry->nameLength > 3 && !PathFileExists(path) &&
+            isCompressible(entry->name, entry->nameLength - 3))
+         {
+            //Remove the .gz suffix to get the path to the source file
+            path[strlen(path) - 3] = '\0';
+            //Add the compressed contents of the file to the resource data
+            error = addCompressedFile(path, data, maxSize, &entry->dataLength);
+         }
          else
          {
             //Add the contents of the file to the resource data
@@ -337,6 +513,264 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
 }
 
 
+/**
+ *@brief Compute the hash of a normalized path
+ *
+ * Must match the runtime lookup (FNV-1a over the lowercase path,
+ * components separated with forward slashes)
+ *
+ *@param[in] path Normalized path
+ *@return Hash value
+ **/
+
+unsigned long hashPath(const char *path)
+{
+   unsigned long h;
+
+   //FNV offset basis
+   h = 2166136261UL;
+
+   //Loop through the path
+   while(*path != '\0')
+   {
+      //Update hash value
+      h = (h ^ (unsigned char) *path) * 16777619UL;
+      //Next character
+      path++;
+   }
+
+   //Return the resulting hash value
+   return h;
+}
+
+
+/**
+ *@brief Compute the tag identifying the contents of a file
+ *
+ * The HTTP server uses it as entity tag (FNV-1a over the data,
+ * compressed or not, as stored in the resource file)
+ *
+ *@param[in] data Pointer to the file contents
+ *@param[in] length Length of the file
+ *@return Tag value
+ **/
+
+unsigned long hashData(const unsigned char *data, unsigned long length)
+{
+   unsigned long h;
+
+   //FNV offset basis
+   h = 2166136261UL;
+
+   //Loop through the data
+   while(length-- > 0)
+      h = (h ^ *(data++)) * 16777619UL;
+
+   //Return the resulting hash value
+   return h;
+}
+
+
+/**
+ *@brief Collect the files that belong to a directory
+ *@param[in] data Pointer to the resource data
+ *@param[in] directory Directory to process
+ *@param[in] prefix Normalized path of the directory
+ *@param[out] items Array where to store the files
+ *@param[in,out] count Number of files collected so far
+ *@param[in] maxCount Maximum number of files
+ *@return Status code
+ **/
+
+int collectFiles(const unsigned char *data, tResEntry *directory,
+   const char *prefix, tIndexItem *items, unsigned int *count, unsigned int maxCount)
+{
+   int error;
+   unsigned int i;
+   unsigned int n;
+   char path[MAX_PATH];
+   tResEntry *entry;
+
+   //Retrieve the length of the directory
+   n = directory->dataLength;
+   //Point to the first entry
+   entry = (tResEntry *) (data + directory->dataOffset);
+
+   //Loop through the directory
+   while(n > 0)
+   {
+      //Make sure the entry is valid
+      if(n < (sizeof(tResEntry) + entry->nameLength))
+         return ERROR_INVALID_RESOURCE;
+
+      //Discard . and .. directories
+      if(!(entry->nameLength == 1 && entry->name[0] == '.') &&
+         !(entry->nameLength == 2 && entry->name[0] == '.' && entry->name[1] == '.'))
+      {
+         //Check the length of the resulting path
+         if((strlen(prefix) + entry->nameLength + 2) > MAX_PATH)
+            return ERROR_FAILURE;
+
+         //Form the normalized path to the item
+         strcpy(path, prefix);
+         if(path[0] != '\0') strcat(path, "/");
+         i = strlen(path);
+         strncpy(path + i, entry->name, entry->nameLength);
+         path[i + entry->nameLength] = '\0';
+
+         //Paths are compared in a case insensitive way
+         for(i = 0; path[i] != '\0'; i++)
+            path[i] = tolower((unsigned char) path[i]);
+
+         //Check entry type
+         if(entry->type == RES_TYPE_DIR)
+         {
+            //Recursively process the contents of the directory
+            error = collectFiles(data, entry, path, items, count, maxCount);
+            //Any error to report?
+            if(error) return error;
+         }
+         else
+         {
+            //Too many files?
+            if(*count >= maxCount)
+               return ERROR_FAILURE;
+
+            //Save the location of the entry
+            items[*count].entryOffset = (unsigned long) ((unsigned char *) entry - data);
+            items[*count].hash = hashPath(path);
+            items[*count].tag = hashData(data + entry->dataOffset, entry->dataLength);
+            strcpy(items[*count].path, path);
+            //Increment the number of files
+            (*count)++;
+         }
+      }
+
+      //Remaining bytes to process
+      n -= sizeof(tResEntry) + entry->nameLength;
+      //Point to the next entry
+      entry = (tResEntry *) ((unsigned char *) entry + sizeof(tResEntry) + entry->nameLength);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ *@brief Append a hashed path index to the resource data
+ *
+ * The index is an open addressing hash table (linear probing) with
+ * at least twice as many slots as files
+ *
+ *@param[in] data Pointer to the resource data
+ *@param[in] maxSize Maximum size of the resulting resource file
+ *@param[out] fileCount Number of files in the index
+ *@return Status code
+ **/
+
+int addIndex(unsigned char *data, unsigned long maxSize, unsigned int *fileCount)
+{
+   int error;
+   unsigned int i;
+   unsigned int j;
+   unsigned int n;
+   unsigned int maxCount;
+   unsigned long slotCount;
+   tIndexItem *items;
+   tResIndex *index;
+   tResIndexDesc *desc;
+
+   //Point to the header of the resource data
+   tResHeader *resHeader = (tResHeader *) data;
+
+   //Upper bound for the number of files
+   maxCount = resHeader->totalSize / sizeof(tResEntry) + 1;
+
+   //Allocate a memory buffer to hold the list of files
+   items = malloc(maxCount * sizeof(tIndexItem));
+   //Failed to allocate memory?
+   if(!items)
+      return ERROR_FAILURE;
+
+   //Collect all the files
+   n = 0;
+   error = collectFiles(data, &resHeader->rootEntry, "", items, &n, maxCount);
+   //Any error to report?
+   if(error)
+   {
+      free(items);
+      return error;
+   }
+
+   //Append the normalized paths
+   for(i = 0; i < n; i++)
+   {
+      //Make sure the maximum size is not exceeded
+      if((resHeader->totalSize + strlen(items[i].path) + 1) > maxSize)
+      {
+         free(items);
+         return ERROR_FILE_TOO_LARGE;
+      }
+
+      //Save the location of the path
+      items[i].pathOffset = resHeader->totalSize;
+      //Copy the path, including the terminating NULL character
+      strcpy((char *) data + resHeader->totalSize, items[i].path);
+      resHeader->totalSize += strlen(items[i].path) + 1;
+   }
+
+   //The number of slots is a power of two
+   for(slotCount = 1; slotCount < (2 * n); slotCount <<= 1);
+
+   //Data must be aligned on 4-byte boundaries
+   resHeader->totalSize = (resHeader->totalSize + 3) / 4 * 4;
+
+   //Make sure the maximum size is not exceeded
+   if((resHeader->totalSize + sizeof(tResIndex) + slotCount * sizeof(tResIndexSlot)) > maxSize)
+   {
+      free(items);
+      return ERROR_FILE_TOO_LARGE;
+   }
+
+   //Point to the index
+   index = (tResIndex *) (data + resHeader->totalSize);
+   index->slotCount = slotCount;
+   memset(index->slot, 0, slotCount * sizeof(tResIndexSlot));
+
+   //Insert the files in the hash table
+   for(i = 0; i < n; i++)
+   {
+      //Find an empty slot
+      for(j = items[i].hash & (slotCount - 1); index->slot[j].entryOffset != 0;
+         j = (j + 1) & (slotCount - 1));
+
+      //Fill the slot
+      index->slot[j].hash = items[i].hash;
+      index->slot[j].entryOffset = items[i].entryOffset;
+      index->slot[j].pathOffset = items[i].pathOffset;
+      index->slot[j].tag = items[i].tag;
+   }
+
+   //Fill the index descriptor
+   desc = (tResIndexDesc *) resHeader->rootEntry.name;
+   memcpy(desc->magic, "RIDX", 4);
+   desc->indexOffset = resHeader->totalSize;
+   desc->indexLength = sizeof(tResIndex) + slotCount * sizeof(tResIndexSlot);
+
+   //Update the total size of the resource file
+   resHeader->totalSize += desc->indexLength;
+
+   //Release previoulsy allocated memory
+   free(items);
+
+   //Return the number of files
+   *fileCount = n;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  *@brief Dump the contents of a directory
  *@param[in] directory Directory to dump
@@ -420,18 +854,32 @@ int main(int argc, char* argv[])
    int error;
    unsigned int i;
    unsigned int maxSize;
+   unsigned int fileCount;
    unsigned char *data;
+   char **arg;
    const char *destFile;
    char *p;
    char *c;
    tResHeader *resHeader;
    FILE *fp;
 
+   //Point to the first argument
+   arg = argv + 1;
+
+   //Compress HTML, CSS and JavaScript files?
+   if(argc > 1 && !strcmp(argv[1], "-z"))
+   {
+      compressFiles = 1;
+      argc--;
+      arg++;
+   }
+
    //Check parameters
    if(argc != 3 && argc != 4)
    {
       //Print command syntax
-      printf("Usage: rc.exe input output [maxsize]\r\n");
+      printf("Usage: rc.exe [-z] input output [maxsize]\r\n");
+      printf("  - -z:      Store text files as gzip members (name.gz)\r\n");
       printf("  - input:   Source directory to include in resource file\r\n");
       printf("  - output:  Compiled resource file\r\n");
       printf("  - maxsize: Maximum size of the resource file\r\n");
@@ -441,23 +889,23 @@ int main(int argc, char* argv[])
    }
 
    //Source directory to process
-   if(PathIsRelative(argv[1]))
+   if(PathIsRelative(arg[0]))
    {
       //Get current working directory
       _getcwd(sourceDir, MAX_PATH);
       //Retrieve the full path
-      PathAppend(sourceDir, argv[1]);
+      PathAppend(sourceDir, arg[0]);
    }
    else
    {
       //Copy the path to the source directory
-      strcpy(sourceDir, argv[1]);
+      strcpy(sourceDir, arg[0]);
    }
 
    //Destination resource file
-   destFile = argv[2];
+   destFile = arg[1];
    //Maximum size of the resulting resource file
-   maxSize = (argc == 4) ? atoi(argv[3]) : (1024 * 1024);
+   maxSize = (argc == 4) ? atoi(arg[2]) : (1024 * 1024);
 
    //Allocate a memory buffer to hold the resulting data
    data = malloc(maxSize);
@@ -475,11 +923,12 @@ int main(int argc, char* argv[])
 
    //Initialize resource data header
    resHeader = (tResHeader *) data;
-   resHeader->totalSize = sizeof(tResHeader);
+   resHeader->totalSize = sizeof(tResHeader) + sizeof(tResIndexDesc);
    resHeader->rootEntry.type = RES_TYPE_DIR;
-   resHeader->rootEntry.dataOffset = sizeof(tResHeader);
+   resHeader->rootEntry.dataOffset = sizeof(tResHeader) + sizeof(tResIndexDesc);
    resHeader->rootEntry.dataLength = 0;
-   resHeader->rootEntry.nameLength = 0;
+   //The name of the root entry holds the path index descriptor
+   resHeader->rootEntry.nameLength = sizeof(tResIndexDesc);
 
    //Add the contents of the specified directory to the resource file
    error = addDirectory(0, 0, sourceDir, data, maxSize, &resHeader->rootEntry.dataLength);
@@ -504,6 +953,29 @@ int main(int argc, char* argv[])
       return ERROR_FAILURE;
    }
 
+   //Append the hashed path index
+   error = addIndex(data, maxSize, &fileCount);
+
+   //Any error to report?
+   if(error == ERROR_FILE_TOO_LARGE)
+   {
+      //User message
+      printf("Error: Maximum size exceeded (%u bytes)!\r\n", maxSize);
+      //Release previoulsy allocated memory
+      free(data);
+      //Report an error
+      return ERROR_FAILURE;
+   }
+   else if(error)
+   {
+      //User message
+      printf("Error: Unable to build path index!\r\n");
+      //Release previoulsy allocated memory
+      free(data);
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
    //Open output file
    fp = fopen(destFile, "w+");
 
@@ -557,7 +1029,8 @@ int main(int argc, char* argv[])
    //Dump the contents of the resource file
    dumpDirectory(data, &resHeader->rootEntry, 0);
    //User message
-   printf("\r\n%u bytes successfully written !\r\n", resHeader->totalSize);
+   printf("\r\n%u files indexed\r\n", fileCount);
+   printf("%u bytes successfully written !\r\n", resHeader->totalSize);
 
    //Release previoulsy allocated memory
    free(data);